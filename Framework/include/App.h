@@ -19,9 +19,13 @@
 #include <ColorTarget.h>
 #include <DepthTarget.h>
 #include <CommandList.h>
+#include <CommandListPool.h>
 #include <Fence.h>
+#include <FrameScheduler.h>
 #include <Mesh.h>
 #include <Texture.h>
+#include <UploadAllocator.h>
+#include <TextureStreamer.h>
 #include <InlineUtil.h>
 #include <WindowEvent.h>
 #include <DirectXMath.h>
@@ -77,7 +81,9 @@ public:
     //-------------------------------------------------------------------------
     void Run();
 
-    static constexpr uint32_t FrameCount = 2;   // フレームバッファ数です.
+    static constexpr uint32_t FrameCount = 3;   // フレームバッファ数です. フレームごとの資源もこの数だけ用意します.
+    static constexpr uint32_t DefaultFrameLatency = 2;  // GPUに先行して投入できるフレーム数の既定値です.
+    static constexpr uint32_t DefaultResourceHeapSize = 65536;  // CBV/SRV/UAV ヒープに確保するディスクリプタ数の既定値です.
     //float                           m_zoomscale = 10.0f;
     //float                           m_movescale = 10.0f;
 
@@ -125,7 +131,18 @@ protected:
     DepthTarget                 m_DepthTarget;               // 深度ターゲットです.
     DescriptorPool*             m_pPool[POOL_COUNT];         // ディスクリプタプールです.
     CommandList                 m_CommandList;               // コマンドリストです.
+    D3D12CommandListBackend     m_CommandListBackend;        // フレーム描画用コマンドリストの実体です.
+    CommandListPool             m_CommandListPool;           // フレーム描画用のコマンドリストです. 複数スレッドから記録できます.
     Fence                       m_Fence;                     // フェンスです.
+    QueueFrameTimeline          m_FrameTimeline;             // フレーム終了時のシグナルを積みます.
+    FrameScheduler              m_FrameScheduler;            // フレームの投入を管理します.
+    uint32_t                    m_FrameLatency;              // GPUに先行して投入できるフレーム数です(1 ～ FrameCount). Init前に設定します.
+    uint32_t                    m_ResourceHeapSize;          // CBV/SRV/UAV ヒープに確保するディスクリプタ数です. デバイスの上限に丸めます. Init前に設定します.
+    uint32_t                    m_FrameSlot;                 // フレームごとの資源の番号です.
+    D3D12UploadPageBackend      m_UploadBackend;             // アップロードページの生成を行います.
+    UploadAllocator             m_UploadAllocator;           // 定数バッファ・頂点バッファ用のアップロードアロケータです.
+    D3D12TextureStreamBackend   m_TextureStreamBackend;      // ストリーミングテクスチャの生成とアップロードを行います.
+    TextureStreamer             m_TextureStreamer;           // DDS テクスチャのミップを予算内で常駐させます.
     uint32_t                    m_FrameIndex;                // フレーム番号です.
     D3D12_VIEWPORT              m_Viewport;                  // ビューポートです.
     D3D12_RECT                  m_Scissor;                   // シザー矩形です.
@@ -0,0 +1,50 @@
+﻿//-----------------------------------------------------------------------------
+// File : BRDF.h
+// Desc : GGX BRDF Terms.
+// Copyright(c) Pocol. All right reserved.
+//-----------------------------------------------------------------------------
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <DirectXMath.h>
+#include <cmath>
+
+
+//-----------------------------------------------------------------------------
+// Constant Values
+//-----------------------------------------------------------------------------
+//! GGXPS.hlsl の F_PI と同じ値です. 結果を一致させるためシェーダ側と揃えてください.
+constexpr float F_PI = 3.141596535f;
+
+//-----------------------------------------------------------------------------
+//      Schlick
+//-----------------------------------------------------------------------------
+inline DirectX::XMFLOAT3 SchlickFresnel(const DirectX::XMFLOAT3& specular, float VH)
+{
+    float f = powf(1.0f - VH, 5.0f);
+    return DirectX::XMFLOAT3(
+        specular.x + (1.0f - specular.x) * f,
+        specular.y + (1.0f - specular.y) * f,
+        specular.z + (1.0f - specular.z) * f);
+}
+
+//-----------------------------------------------------------------------------
+//      GGX
+//-----------------------------------------------------------------------------
+inline float D_GGX(float m2, float NH)
+{
+    float f = (NH * m2 - NH) * NH + 1;
+    return m2 / (F_PI * f * f);
+}
+
+//-----------------------------------------------------------------------------
+//      Height Correlated Smith
+//-----------------------------------------------------------------------------
+inline float G2_Smith(float NL, float NV, float m2)
+{
+    float G_light = 2.0f * NL / (NL + sqrtf(m2 + (1.0f + m2) * NL * NL));
+    float G_view  = 2.0f * NV / (NV + sqrtf(m2 + (1.0f + m2) * NV * NV));
+    return G_light * G_view;
+}
@@ -0,0 +1,256 @@
+﻿//-----------------------------------------------------------------------------
+// File : BVH.h
+// Desc : CPU Bounding Volume Hierarchy Module.
+// Copyright(c) Pocol. All right reserved.
+//-----------------------------------------------------------------------------
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <ResMesh.h>
+#include <DirectXMath.h>
+#include <cstdint>
+#include <vector>
+
+
+///////////////////////////////////////////////////////////////////////////////
+// BVHRay structure
+///////////////////////////////////////////////////////////////////////////////
+struct BVHRay
+{
+    DirectX::XMFLOAT3   Origin;         //!< レイの原点です.
+    float               TMin;           //!< 最小距離です.
+    DirectX::XMFLOAT3   Direction;      //!< レイの方向です(正規化不要).
+    float               TMax;           //!< 最大距離です.
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// BVHHit structure
+///////////////////////////////////////////////////////////////////////////////
+struct BVHHit
+{
+    float               Distance;       //!< 交差距離です.
+    float               U;              //!< 重心座標 U (頂点1の重み) です.
+    float               V;              //!< 重心座標 V (頂点2の重み) です.
+    uint32_t            PrimitiveId;    //!< 三角形番号です. 交差しなかった場合は UINT32_MAX です.
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// BVHRayPacket4 structure
+///////////////////////////////////////////////////////////////////////////////
+struct alignas(16) BVHRayPacket4
+{
+    float   OriginX[4];     //!< レイの原点 X です.
+    float   OriginY[4];     //!< レイの原点 Y です.
+    float   OriginZ[4];     //!< レイの原点 Z です.
+    float   DirectionX[4];  //!< レイの方向 X です.
+    float   DirectionY[4];  //!< レイの方向 Y です.
+    float   DirectionZ[4];  //!< レイの方向 Z です.
+    float   TMin[4];        //!< 最小距離です.
+    float   TMax[4];        //!< 最大距離です.
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// BVHHitPacket4 structure
+///////////////////////////////////////////////////////////////////////////////
+struct alignas(16) BVHHitPacket4
+{
+    float       Distance[4];    //!< 交差距離です.
+    float       U[4];           //!< 重心座標 U です.
+    float       V[4];           //!< 重心座標 V です.
+    uint32_t    PrimitiveId[4]; //!< 三角形番号です. 交差しなかった場合は UINT32_MAX です.
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// WideBVH class
+///////////////////////////////////////////////////////////////////////////////
+//! @brief      ビニングSAHで構築し, N分木に変換したBVHです.
+//!
+//! @note       三角形番号はメッシュ配列を先頭から順に連結したときの通し番号(インデックス / 3)です.
+//!             N は 4 (SSE) または 8 (AVX) のみ対応しています.
+template<uint32_t N>
+class WideBVH
+{
+    //=========================================================================
+    // list of friend classes and methods.
+    //=========================================================================
+    /* NOTHING */
+
+public:
+    //=========================================================================
+    // public variables.
+    //=========================================================================
+    static constexpr uint32_t Width = N;    //!< 分岐数です.
+
+    //=========================================================================
+    // public methods.
+    //=========================================================================
+
+    //-------------------------------------------------------------------------
+    //! @brief      コンストラクタです.
+    //-------------------------------------------------------------------------
+    WideBVH();
+
+    //-------------------------------------------------------------------------
+    //! @brief      デストラクタです.
+    //-------------------------------------------------------------------------
+    ~WideBVH();
+
+    //-------------------------------------------------------------------------
+    //! @brief      初期化処理を行います.
+    //!
+    //! @param[in]      meshes      構築対象のメッシュです.
+    //! @retval true    初期化に成功.
+    //! @retval false   初期化に失敗.
+    //-------------------------------------------------------------------------
+    bool Init(const std::vector<ResMesh>& meshes);
+
+    //-------------------------------------------------------------------------
+    //! @brief      初期化処理を行います.
+    //!
+    //! @param[in]      mesh        構築対象のメッシュです.
+    //! @retval true    初期化に成功.
+    //! @retval false   初期化に失敗.
+    //-------------------------------------------------------------------------
+    bool Init(const ResMesh& mesh);
+
+    //-------------------------------------------------------------------------
+    //! @brief      終了処理を行います.
+    //-------------------------------------------------------------------------
+    void Term();
+
+    //-------------------------------------------------------------------------
+    //! @brief      最近接交差を求めます.
+    //!
+    //! @param[in]      ray         レイです.
+    //! @param[out]     hit         交差情報の格納先です.
+    //! @retval true    交差あり.
+    //! @retval false   交差なし.
+    //-------------------------------------------------------------------------
+    bool Intersect(const BVHRay& ray, BVHHit& hit) const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      いずれかの三角形と交差するかどうかチェックします.
+    //!
+    //! @param[in]      ray         レイです.
+    //! @retval true    交差あり.
+    //! @retval false   交差なし.
+    //-------------------------------------------------------------------------
+    bool Occluded(const BVHRay& ray) const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      4本のレイの最近接交差をまとめて求めます.
+    //!
+    //! @param[in]      rays        レイパケットです.
+    //! @param[out]     hits        交差情報の格納先です.
+    //! @return     交差したレイのビットマスクを返却します.
+    //-------------------------------------------------------------------------
+    uint32_t Intersect4(const BVHRayPacket4& rays, BVHHitPacket4& hits) const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      4本のレイの遮蔽をまとめて判定します.
+    //!
+    //! @param[in]      rays        レイパケットです.
+    //! @return     遮蔽されたレイのビットマスクを返却します.
+    //-------------------------------------------------------------------------
+    uint32_t Occluded4(const BVHRayPacket4& rays) const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      全体のバウンディングボックスを取得します.
+    //!
+    //! @param[out]     boxMin      最小値の格納先です.
+    //! @param[out]     boxMax      最大値の格納先です.
+    //-------------------------------------------------------------------------
+    void GetBounds(DirectX::XMFLOAT3& boxMin, DirectX::XMFLOAT3& boxMax) const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      ノード数を取得します.
+    //!
+    //! @return     ノード数を返却します.
+    //-------------------------------------------------------------------------
+    size_t GetNodeCount() const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      三角形数を取得します.
+    //!
+    //! @return     三角形数を返却します.
+    //-------------------------------------------------------------------------
+    size_t GetPrimitiveCount() const;
+
+private:
+    ///////////////////////////////////////////////////////////////////////////
+    // Node structure
+    ///////////////////////////////////////////////////////////////////////////
+    struct alignas(32) Node
+    {
+        float       MinX[N];        //!< 子のバウンディングボックス最小値 X です.
+        float       MinY[N];        //!< 子のバウンディングボックス最小値 Y です.
+        float       MinZ[N];        //!< 子のバウンディングボックス最小値 Z です.
+        float       MaxX[N];        //!< 子のバウンディングボックス最大値 X です.
+        float       MaxY[N];        //!< 子のバウンディングボックス最大値 Y です.
+        float       MaxZ[N];        //!< 子のバウンディングボックス最大値 Z です.
+        uint32_t    Child[N];       //!< 葉なら先頭三角形番号, 節なら子ノード番号です.
+        uint32_t    Count[N];       //!< 三角形数です. 0 の場合は節です.
+        uint32_t    ChildCount;     //!< 有効な子の数です(先頭から詰めて格納).
+    };
+
+    ///////////////////////////////////////////////////////////////////////////
+    // Triangle structure
+    ///////////////////////////////////////////////////////////////////////////
+    struct Triangle
+    {
+        DirectX::XMFLOAT3   P0;             //!< 頂点0の位置です.
+        uint32_t            PrimitiveId;    //!< 三角形番号です.
+        DirectX::XMFLOAT3   E1;             //!< 頂点0から頂点1へのエッジです.
+        DirectX::XMFLOAT3   E2;             //!< 頂点0から頂点2へのエッジです.
+    };
+
+    //=========================================================================
+    // private variables.
+    //=========================================================================
+    std::vector<Node>       m_Nodes;        //!< ノードです(先頭がルート).
+    std::vector<Triangle>   m_Triangles;    //!< 葉の順に並べた三角形です.
+    DirectX::XMFLOAT3       m_BoxMin;       //!< 全体のバウンディングボックス最小値です.
+    DirectX::XMFLOAT3       m_BoxMax;       //!< 全体のバウンディングボックス最大値です.
+
+    //=========================================================================
+    // private methods.
+    //=========================================================================
+    WideBVH         (const WideBVH&) = delete;  // アクセス禁止.
+    void operator = (const WideBVH&) = delete;  // アクセス禁止.
+
+    //-------------------------------------------------------------------------
+    //! @brief      三角形を収集してBVHを構築します.
+    //!
+    //! @param[in]      pMeshes     メッシュの先頭です.
+    //! @param[in]      count       メッシュ数です.
+    //! @retval true    構築に成功.
+    //! @retval false   構築に失敗.
+    //-------------------------------------------------------------------------
+    bool Build(const ResMesh* pMeshes, size_t count);
+
+    //-------------------------------------------------------------------------
+    //! @brief      単一レイの走査を行います.
+    //!
+    //! @param[in]      ray         レイです.
+    //! @param[in,out]  hit         交差情報です.
+    //! @param[in]      anyHit      最初の交差で打ち切る場合は true.
+    //! @retval true    交差あり.
+    //! @retval false   交差なし.
+    //-------------------------------------------------------------------------
+    bool Traverse(const BVHRay& ray, BVHHit& hit, bool anyHit) const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      4本のレイの走査を行います.
+    //!
+    //! @param[in]      rays        レイパケットです.
+    //! @param[in,out]  hits        交差情報です.
+    //! @param[in]      anyHit      最初の交差で打ち切る場合は true.
+    //! @return     交差したレイのビットマスクを返却します.
+    //-------------------------------------------------------------------------
+    uint32_t Traverse4(const BVHRayPacket4& rays, BVHHitPacket4& hits, bool anyHit) const;
+};
+
+using BVH4 = WideBVH<4>;
+using BVH8 = WideBVH<8>;
@@ -0,0 +1,105 @@
+﻿//-----------------------------------------------------------------------------
+// File : BlasBuildPlanner.h
+// Desc : Bottom Level Acceleration Structure Build Planner Module.
+// Copyright(c) Pocol. All right reserved.
+//-----------------------------------------------------------------------------
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <cstdint>
+#include <vector>
+
+
+///////////////////////////////////////////////////////////////////////////////
+// BlasSizeInfo structure
+///////////////////////////////////////////////////////////////////////////////
+struct BlasSizeInfo
+{
+    uint64_t    ScratchSize;    //!< 構築に必要なスクラッチサイズです.
+    uint64_t    ResultSize;     //!< 圧縮前の BLAS のサイズです.
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// BlasBuildItem structure
+///////////////////////////////////////////////////////////////////////////////
+struct BlasBuildItem
+{
+    uint32_t    Index;          //!< 入力での BLAS 番号です.
+    uint64_t    ScratchOffset;  //!< スクラッチアリーナ内のオフセットです.
+    uint64_t    ResultOffset;   //!< 結果アリーナ内のオフセットです.
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// BlasBuildBatch structure
+///////////////////////////////////////////////////////////////////////////////
+struct BlasBuildBatch
+{
+    uint32_t    First;          //!< BlasBuildPlan::Items の先頭番号です.
+    uint32_t    Count;          //!< バッチ内の BLAS 数です.
+    uint64_t    ScratchSize;    //!< バッチが使用するスクラッチサイズです.
+    uint64_t    ResultSize;     //!< バッチが使用する結果サイズです.
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// BlasBuildPlan structure
+///////////////////////////////////////////////////////////////////////////////
+struct BlasBuildPlan
+{
+    std::vector<BlasBuildItem>  Items;              //!< バッチ順に並んだ構築項目です.
+    std::vector<BlasBuildBatch> Batches;            //!< バッチです.
+    uint64_t                    ScratchArenaSize;   //!< 全バッチで共有するスクラッチアリーナのサイズです.
+    uint64_t                    ResultArenaSize;    //!< 全バッチで共有する結果アリーナのサイズです.
+    uint32_t                    MaxBatchCount;      //!< バッチ内の BLAS 数の最大値です.
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// BlasCompactionPlan structure
+///////////////////////////////////////////////////////////////////////////////
+struct BlasCompactionPlan
+{
+    std::vector<uint64_t>   Offsets;        //!< 圧縮後バッファ内のオフセットです.
+    uint64_t                TotalSize;      //!< 圧縮後バッファのサイズです.
+    uint64_t                SourceSize;     //!< 圧縮前のサイズの合計です.
+};
+
+//-----------------------------------------------------------------------------
+//! @brief      アクセラレーション構造のアライメントにサイズを揃えます.
+//!
+//! @param[in]      size        サイズです.
+//! @return     256 バイト単位に切り上げたサイズを返却します.
+//-----------------------------------------------------------------------------
+uint64_t AlignBlasSize(uint64_t size);
+
+//-----------------------------------------------------------------------------
+//! @brief      BLAS の構築をバッチに分け, スクラッチと結果の配置を決めます.
+//!
+//! @param[in]      pSizes      BLAS ごとのプリビルド情報です.
+//! @param[in]      count       BLAS 数です.
+//! @param[in]      budget      1バッチで使用するスクラッチと結果の合計サイズの上限です.
+//! @param[out]     plan        構築計画の格納先です.
+//! @retval true    計画に成功.
+//! @retval false   計画に失敗.
+//! @note       入力順のまま上限に収まるだけ詰めます. 1つで上限を超える BLAS は単独のバッチにし,
+//!             アリーナはそのバッチに合わせて大きくなります.
+//-----------------------------------------------------------------------------
+bool PlanBlasBuild(
+    const BlasSizeInfo* pSizes,
+    uint32_t            count,
+    uint64_t            budget,
+    BlasBuildPlan&      plan);
+
+//-----------------------------------------------------------------------------
+//! @brief      圧縮後の BLAS を1つのバッファに詰める配置を決めます.
+//!
+//! @param[in]      pCompactedSizes     ポストビルド情報で得た圧縮後のサイズです.
+//! @param[in]      pSourceSizes        圧縮前のサイズです. nullptr の場合は SourceSize を 0 にします.
+//! @param[in]      count               BLAS 数です.
+//! @param[out]     plan                配置の格納先です.
+//-----------------------------------------------------------------------------
+void PlanBlasCompaction(
+    const uint64_t*     pCompactedSizes,
+    const uint64_t*     pSourceSizes,
+    uint32_t            count,
+    BlasCompactionPlan& plan);
@@ -0,0 +1,149 @@
+﻿//-----------------------------------------------------------------------------
+// File : BlasManager.h
+// Desc : Bottom Level Acceleration Structure Manager Module.
+// Copyright(c) Pocol. All right reserved.
+//-----------------------------------------------------------------------------
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <d3d12.h>
+#include <ComPtr.h>
+#include <BlasBuildPlanner.h>
+#include <CommandList.h>
+#include <Fence.h>
+#include <cstdint>
+#include <vector>
+
+
+//-----------------------------------------------------------------------------
+// Forward Declarations.
+//-----------------------------------------------------------------------------
+class Mesh;
+
+
+///////////////////////////////////////////////////////////////////////////////
+// BlasManager class
+///////////////////////////////////////////////////////////////////////////////
+//! @brief      メッシュごとの BLAS をまとめて構築し, 圧縮して保持します.
+//!
+//! @note       1バッチの構築は1つのスクラッチアリーナと結果アリーナを共有し, 構築と同時に
+//!             ポストビルド情報で圧縮後のサイズを取得します. 圧縮コピーが終わったらアリーナは
+//!             次のバッチで使い回し, 全バッチの完了後に解放します.
+class BlasManager
+{
+    //=========================================================================
+    // list of friend classes and methods.
+    //=========================================================================
+    /* NOTHING */
+
+public:
+    //=========================================================================
+    // public variables.
+    //=========================================================================
+    static constexpr uint32_t InvalidIndex  = UINT32_MAX;               //!< 無効な BLAS 番号です.
+    static constexpr uint64_t DefaultBudget = 64ull * 1024 * 1024;      //!< 1バッチのアリーナサイズの既定値です.
+
+    //=========================================================================
+    // public methods.
+    //=========================================================================
+
+    //-------------------------------------------------------------------------
+    //! @brief      コンストラクタです.
+    //-------------------------------------------------------------------------
+    BlasManager();
+
+    //-------------------------------------------------------------------------
+    //! @brief      デストラクタです.
+    //-------------------------------------------------------------------------
+    ~BlasManager();
+
+    //-------------------------------------------------------------------------
+    //! @brief      初期化処理を行います.
+    //!
+    //! @param[in]      pDevice     デバイスです.
+    //! @param[in]      budget      1バッチで使用するスクラッチと結果の合計サイズの上限です.
+    //! @retval true    初期化に成功.
+    //! @retval false   初期化に失敗.
+    //-------------------------------------------------------------------------
+    bool Init(ID3D12Device5* pDevice, uint64_t budget = DefaultBudget);
+
+    //-------------------------------------------------------------------------
+    //! @brief      終了処理を行います.
+    //-------------------------------------------------------------------------
+    void Term();
+
+    //-------------------------------------------------------------------------
+    //! @brief      メッシュの BLAS を登録します. 構築は Build() で行います.
+    //!
+    //! @param[in]      pMesh       メッシュです. Build() が終わるまで頂点・インデックスバッファを保持する必要があります.
+    //! @return     BLAS 番号を返却します. 登録できない場合は InvalidIndex を返却します.
+    //! @note       PackedVertex 形式の位置は DXR 1.1 が必要な形式なので登録しません.
+    //-------------------------------------------------------------------------
+    uint32_t AddMesh(const Mesh* pMesh);
+
+    //-------------------------------------------------------------------------
+    //! @brief      未構築の BLAS を構築して圧縮します. 完了するまで待機します.
+    //!
+    //! @param[in]      pQueue      コマンドキューです.
+    //! @param[in]      cmdList     記録に使用するコマンドリストです.
+    //! @param[in]      fence       完了待ちに使用するフェンスです.
+    //! @retval true    構築に成功.
+    //! @retval false   構築に失敗.
+    //-------------------------------------------------------------------------
+    bool Build(ID3D12CommandQueue* pQueue, CommandList& cmdList, Fence& fence);
+
+    //-------------------------------------------------------------------------
+    //! @brief      BLAS のGPU仮想アドレスを取得します.
+    //!
+    //! @param[in]      index       BLAS 番号です.
+    //! @return     構築済みの BLAS のアドレスを返却します. 未構築の場合は 0 を返却します.
+    //-------------------------------------------------------------------------
+    D3D12_GPU_VIRTUAL_ADDRESS GetAddress(uint32_t index) const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      登録されている BLAS 数を取得します.
+    //-------------------------------------------------------------------------
+    uint32_t GetCount() const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      圧縮前のサイズの合計を取得します.
+    //-------------------------------------------------------------------------
+    uint64_t GetSourceSize() const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      圧縮後のサイズの合計を取得します.
+    //-------------------------------------------------------------------------
+    uint64_t GetCompactedSize() const;
+
+private:
+    ///////////////////////////////////////////////////////////////////////////
+    // Entry structure
+    ///////////////////////////////////////////////////////////////////////////
+    struct Entry
+    {
+        D3D12_RAYTRACING_GEOMETRY_DESC  Geometry;   //!< ジオメトリ記述子です.
+        uint32_t                        Buffer;     //!< 圧縮後バッファの番号です.
+        uint64_t                        Offset;     //!< 圧縮後バッファ内のオフセットです.
+        bool                            Built;      //!< 構築済みかどうか.
+    };
+
+    //=========================================================================
+    // private variables.
+    //=========================================================================
+    ComPtr<ID3D12Device5>                   m_pDevice;          //!< デバイスです.
+    std::vector<ComPtr<ID3D12Resource>>     m_pBuffers;         //!< バッチごとの圧縮後バッファです.
+    std::vector<Entry>                      m_Entries;          //!< 登録された BLAS です.
+    uint64_t                                m_Budget;           //!< 1バッチのアリーナサイズの上限です.
+    uint64_t                                m_SourceSize;       //!< 圧縮前のサイズの合計です.
+    uint64_t                                m_CompactedSize;    //!< 圧縮後のサイズの合計です.
+
+    //=========================================================================
+    // private methods.
+    //=========================================================================
+    BlasManager         (const BlasManager&) = delete;  // アクセス禁止.
+    void operator =     (const BlasManager&) = delete;  // アクセス禁止.
+
+    void GetInputs(uint32_t index, D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS& inputs) const;
+};
@@ -0,0 +1,244 @@
+﻿//-----------------------------------------------------------------------------
+// File : BlockCompressor.h
+// Desc : Block Compression Module.
+// Copyright(c) Pocol. All right reserved.
+//-----------------------------------------------------------------------------
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <dxgiformat.h>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+///////////////////////////////////////////////////////////////////////////////
+// BC_TEXTURE_TYPE enum
+///////////////////////////////////////////////////////////////////////////////
+enum BC_TEXTURE_TYPE
+{
+    BC_TEXTURE_COLOR = 0,       //!< カラーマップです. BC1 (高品質の場合は BC7) で圧縮し, ミップはリニア空間で平均します.
+    BC_TEXTURE_COLOR_ALPHA,     //!< アルファ付きのカラーマップです. BC3 (高品質の場合は BC7) で圧縮します.
+    BC_TEXTURE_NORMAL,          //!< 法線マップです. XY を BC5 で圧縮し, ミップは正規化し直します.
+    BC_TEXTURE_MASK,            //!< ラフネス・メタリックなどの1チャンネルのマップです. R を BC4 で圧縮します.
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// BcCompressDesc structure
+///////////////////////////////////////////////////////////////////////////////
+struct BcCompressDesc
+{
+    DXGI_FORMAT         Format          = DXGI_FORMAT_BC1_UNORM;    //!< 出力フォーマットです(BC1/BC3/BC4/BC5/BC7).
+    BC_TEXTURE_TYPE     Type            = BC_TEXTURE_COLOR;         //!< ミップ生成時のフィルタを決める種類です.
+    bool                GenerateMips    = true;                     //!< 1x1 までのミップを生成するかどうか.
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// BcCompressStats structure
+///////////////////////////////////////////////////////////////////////////////
+struct BcCompressStats
+{
+    double      Psnr;                   //!< ミップ0の圧縮前後の PSNR (dB) です. 圧縮するチャンネルだけで求めます.
+    double      Seconds;                //!< 圧縮にかかった時間(秒)です. ファイルの入出力は含みません.
+    double      MegaPixelsPerSecond;    //!< 全ミップの合計ピクセル数による処理速度です.
+    uint64_t    SourceBytes;            //!< 圧縮前 (RGBA8) の全ミップの合計サイズです.
+    uint64_t    CompressedBytes;        //!< 圧縮後の全ミップの合計サイズです.
+};
+
+//-----------------------------------------------------------------------------
+//! @brief      テクスチャの種類に合わせた圧縮フォーマットを選びます.
+//!
+//! @param[in]      type        テクスチャの種類です.
+//! @param[in]      highQuality カラーマップを BC7 で圧縮するかどうか.
+//! @return     圧縮フォーマットを返却します.
+//-----------------------------------------------------------------------------
+DXGI_FORMAT SelectBcFormat(BC_TEXTURE_TYPE type, bool highQuality = false);
+
+//-----------------------------------------------------------------------------
+//! @brief      4x4 ピクセルを BC1 で圧縮します.
+//!
+//! @param[in]      pRGBA       16ピクセル分の RGBA8 です(行優先).
+//! @param[out]     pBlock      8バイトのブロックの格納先です.
+//! @note       主成分の軸上で端点を求め, 最小二乗法で1回補正した結果と比べて誤差の小さい方を採用します.
+//!             常に4色モードで出力するので BC3 のカラーブロックとしても使えます.
+//-----------------------------------------------------------------------------
+void CompressBlockBC1(const uint8_t* pRGBA, uint8_t* pBlock);
+
+//-----------------------------------------------------------------------------
+//! @brief      4x4 ピクセルを BC3 で圧縮します.
+//!
+//! @param[in]      pRGBA       16ピクセル分の RGBA8 です(行優先).
+//! @param[out]     pBlock      16バイトのブロックの格納先です.
+//-----------------------------------------------------------------------------
+void CompressBlockBC3(const uint8_t* pRGBA, uint8_t* pBlock);
+
+//-----------------------------------------------------------------------------
+//! @brief      4x4 ピクセルの1チャンネルを BC4 で圧縮します.
+//!
+//! @param[in]      pValues     先頭ピクセルの値です.
+//! @param[in]      stride      ピクセル間のバイト数です. RGBA8 の R なら 4.
+//! @param[out]     pBlock      8バイトのブロックの格納先です.
+//-----------------------------------------------------------------------------
+void CompressBlockBC4(const uint8_t* pValues, size_t stride, uint8_t* pBlock);
+
+//-----------------------------------------------------------------------------
+//! @brief      4x4 ピクセルの RG を BC5 で圧縮します.
+//!
+//! @param[in]      pRGBA       16ピクセル分の RGBA8 です(行優先).
+//! @param[out]     pBlock      16バイトのブロックの格納先です.
+//-----------------------------------------------------------------------------
+void CompressBlockBC5(const uint8_t* pRGBA, uint8_t* pBlock);
+
+//-----------------------------------------------------------------------------
+//! @brief      4x4 ピクセルを BC7 で圧縮します.
+//!
+//! @param[in]      pRGBA       16ピクセル分の RGBA8 です(行優先).
+//! @param[out]     pBlock      16バイトのブロックの格納先です.
+//! @note       分割の探索をしない高速版で, RGBA を1組の端点で表すモード6だけを使います.
+//-----------------------------------------------------------------------------
+void CompressBlockBC7(const uint8_t* pRGBA, uint8_t* pBlock);
+
+//-----------------------------------------------------------------------------
+//! @brief      4x4 ピクセルを展開します.
+//!
+//! @param[in]      format      ブロックのフォーマットです.
+//! @param[in]      pBlock      ブロックです.
+//! @param[out]     pRGBA       16ピクセル分の RGBA8 の格納先です. 持たないチャンネルは G,B = 0, A = 255.
+//! @retval true    展開に成功.
+//! @retval false   対応していないフォーマット. BC7 はモード6だけに対応します.
+//-----------------------------------------------------------------------------
+bool DecompressBlock(DXGI_FORMAT format, const uint8_t* pBlock, uint8_t* pRGBA);
+
+//-----------------------------------------------------------------------------
+//! @brief      画像を圧縮します.
+//!
+//! @param[in]      pPixels     RGBA8 のピクセルです.
+//! @param[in]      width       横幅です.
+//! @param[in]      height      縦幅です.
+//! @param[in]      rowPitch    1行あたりのバイト数です.
+//! @param[in]      format      圧縮フォーマットです.
+//! @param[out]     result      ブロックの格納先です.
+//! @retval true    圧縮に成功.
+//! @retval false   対応していないフォーマット.
+//! @note       ブロック行ごとにワーカースレッドで並列に処理します.
+//!             4の倍数でない端のブロックは端のピクセルを繰り返して埋めます.
+//-----------------------------------------------------------------------------
+bool CompressImage(
+    const uint8_t*          pPixels,
+    uint32_t                width,
+    uint32_t                height,
+    size_t                  rowPitch,
+    DXGI_FORMAT             format,
+    std::vector<uint8_t>&   result);
+
+//-----------------------------------------------------------------------------
+//! @brief      画像を展開します.
+//!
+//! @param[in]      pBlocks     ブロックです.
+//! @param[in]      width       横幅です.
+//! @param[in]      height      縦幅です.
+//! @param[in]      format      圧縮フォーマットです.
+//! @param[out]     result      RGBA8 のピクセルの格納先です.
+//! @retval true    展開に成功.
+//! @retval false   対応していないフォーマット.
+//-----------------------------------------------------------------------------
+bool DecompressImage(
+    const uint8_t*          pBlocks,
+    uint32_t                width,
+    uint32_t                height,
+    DXGI_FORMAT             format,
+    std::vector<uint8_t>&   result);
+
+//-----------------------------------------------------------------------------
+//! @brief      2枚の RGBA8 画像の PSNR を求めます.
+//!
+//! @param[in]      pLhs            1枚目のピクセルです(詰めて格納).
+//! @param[in]      pRhs            2枚目のピクセルです(詰めて格納).
+//! @param[in]      width           横幅です.
+//! @param[in]      height          縦幅です.
+//! @param[in]      channelCount    先頭から比べるチャンネル数です(1～4).
+//! @return     PSNR (dB) を返却します. 一致する場合は無限大.
+//-----------------------------------------------------------------------------
+double CalcPsnr(
+    const uint8_t*  pLhs,
+    const uint8_t*  pRhs,
+    uint32_t        width,
+    uint32_t        height,
+    uint32_t        channelCount);
+
+//-----------------------------------------------------------------------------
+//! @brief      画像を圧縮して DDS ファイルに保存します.
+//!
+//! @param[in]      pPixels     RGBA8 のピクセルです.
+//! @param[in]      width       横幅です(4の倍数).
+//! @param[in]      height      縦幅です(4の倍数).
+//! @param[in]      rowPitch    1行あたりのバイト数です.
+//! @param[in]      desc        圧縮設定です.
+//! @param[in]      path        出力ファイルパスです.
+//! @param[out]     pStats      統計の格納先です. 不要な場合は nullptr.
+//! @retval true    保存に成功.
+//! @retval false   保存に失敗.
+//! @note       DX10 拡張ヘッダの DDS を出力するので, DirectX::CreateDDSTextureFromFileEx() で読み込めます.
+//-----------------------------------------------------------------------------
+bool CompressTexture(
+    const uint8_t*          pPixels,
+    uint32_t                width,
+    uint32_t                height,
+    size_t                  rowPitch,
+    const BcCompressDesc&   desc,
+    const wchar_t*          path,
+    BcCompressStats*        pStats = nullptr);
+
+//-----------------------------------------------------------------------------
+//! @brief      非圧縮の DDS ファイルを圧縮したキャッシュを用意します.
+//!
+//! @param[in]      path        DDS ファイルパスです.
+//! @param[in]      type        テクスチャの種類です.
+//! @param[out]     result      読み込むべきファイルパスの格納先です.
+//! @param[out]     pStats      統計の格納先です. 圧縮した場合だけ設定されます. 不要な場合は nullptr.
+//! @retval true    ブロック圧縮済みのファイルパスを設定した.
+//! @retval false   圧縮できないため, 元のファイルパスを設定した.
+//! @note       キャッシュは元のファイルと同じフォルダに "_bc1.dds" などの名前で保存し,
+//!             元のファイルより古い場合は作り直します. 既にブロック圧縮済みのファイルはそのまま使います.
+//!             対応する入力は RGBA8・BGRA8・BGRX8・RG8・R8 です.
+//-----------------------------------------------------------------------------
+bool PrepareCompressedTexture(
+    const std::wstring&     path,
+    BC_TEXTURE_TYPE         type,
+    std::wstring&           result,
+    BcCompressStats*        pStats = nullptr);
+
+//-----------------------------------------------------------------------------
+//! @brief      作成済みのブロック圧縮したキャッシュを検索します.
+//!
+//! @param[in]      path        DDS ファイルパスです.
+//! @param[in]      type        テクスチャの種類です.
+//! @param[out]     result      読み込むべきファイルパスの格納先です.
+//! @retval true    ブロック圧縮済みのファイルパスを設定した.
+//! @retval false   元のファイルより新しいキャッシュが無いため, 元のファイルパスを設定した.
+//! @note       PrepareCompressedTexture() と異なり圧縮は行わないので, 描画中に呼び出しても止まりません.
+//-----------------------------------------------------------------------------
+bool FindCompressedTexture(
+    const std::wstring&     path,
+    BC_TEXTURE_TYPE         type,
+    std::wstring&           result);
+
+//-----------------------------------------------------------------------------
+//! @brief      DDS ファイルのミップ0を RGBA8 として読み込みます.
+//!
+//! @param[in]      path        DDS ファイルパスです.
+//! @param[out]     width       横幅の格納先です.
+//! @param[out]     height      縦幅の格納先です.
+//! @param[out]     result      RGBA8 のピクセルの格納先です(詰めて格納).
+//! @retval true    読み込みに成功.
+//! @retval false   読み込みに失敗. または対応していないフォーマット.
+//! @note       非圧縮は PrepareCompressedTexture() と同じフォーマットに, 圧縮済みは BC1・BC3・BC4・BC5 と BC7 のモード6に対応します.
+//-----------------------------------------------------------------------------
+bool LoadTextureRGBA8(
+    const wchar_t*          path,
+    uint32_t&               width,
+    uint32_t&               height,
+    std::vector<uint8_t>&   result);
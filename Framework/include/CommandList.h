@@ -68,6 +68,14 @@ public:
     //ID3D12GraphicsCommandList* Reset();
     ID3D12GraphicsCommandList4* Reset();
 
+    //-------------------------------------------------------------------------
+    //! @brief      指定したアロケータでリセット処理を行ったコマンドリストを取得します.
+    //!
+    //! @param[in]      index       アロケータ番号です. FrameScheduler のスロット番号を渡します.
+    //! @return     リセット処理を行ったコマンドリストを返却します.
+    //-------------------------------------------------------------------------
+    ID3D12GraphicsCommandList4* Reset(uint32_t index);
+
     ID3D12GraphicsCommandList4* GetCommandList() const
     {
         return m_pCmdList.Get();
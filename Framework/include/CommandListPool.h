@@ -0,0 +1,358 @@
+﻿//-----------------------------------------------------------------------------
+// File : CommandListPool.h
+// Desc : Command List Pool Module.
+// Copyright(c) Pocol. All right reserved.
+//-----------------------------------------------------------------------------
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <d3d12.h>
+#include <ComPtr.h>
+#include <ParallelUtil.h>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+
+///////////////////////////////////////////////////////////////////////////////
+// CommandListBackend class
+///////////////////////////////////////////////////////////////////////////////
+//! @brief      コマンドリストの生成・記録・実行を行うインタフェースです.
+//!
+//! @note       Begin() / End() は異なるリストに対してであれば複数スレッドから同時に呼び出されます.
+//!             AddList() と Execute() はメインスレッドからのみ呼び出されます.
+class CommandListBackend
+{
+public:
+    virtual ~CommandListBackend() = default;
+
+    //-------------------------------------------------------------------------
+    //! @brief      コマンドリストを1つ追加します.
+    //!
+    //! @param[in]      frameCount  リストごとに用意するアロケータの数です.
+    //! @retval true    追加に成功.
+    //! @retval false   追加に失敗.
+    //-------------------------------------------------------------------------
+    virtual bool AddList(uint32_t frameCount) = 0;
+
+    //-------------------------------------------------------------------------
+    //! @brief      アロケータをリセットして記録を開始します.
+    //!
+    //! @param[in]      list        リスト番号です.
+    //! @param[in]      frame       フレームのスロット番号です.
+    //! @param[out]     ppCmdList   記録先のコマンドリストの格納先です. 記録先が無い場合は nullptr が設定されます.
+    //! @retval true    記録の開始に成功.
+    //! @retval false   記録の開始に失敗. この場合 End() は呼び出されません.
+    //-------------------------------------------------------------------------
+    virtual bool Begin(uint32_t list, uint32_t frame, ID3D12GraphicsCommandList4** ppCmdList) = 0;
+
+    //-------------------------------------------------------------------------
+    //! @brief      記録を終了します.
+    //!
+    //! @param[in]      list        リスト番号です.
+    //-------------------------------------------------------------------------
+    virtual void End(uint32_t list) = 0;
+
+    //-------------------------------------------------------------------------
+    //! @brief      コマンドリストを指定順に実行します.
+    //!
+    //! @param[in]      pLists      リスト番号の配列です.
+    //! @param[in]      count       リスト数です.
+    //-------------------------------------------------------------------------
+    virtual void Execute(const uint32_t* pLists, uint32_t count) = 0;
+
+    //-------------------------------------------------------------------------
+    //! @brief      全てのコマンドリストを破棄します.
+    //-------------------------------------------------------------------------
+    virtual void Clear() = 0;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// D3D12CommandListBackend class
+///////////////////////////////////////////////////////////////////////////////
+class D3D12CommandListBackend : public CommandListBackend
+{
+    //=========================================================================
+    // list of friend classes and methods.
+    //=========================================================================
+    /* NOTHING */
+
+public:
+    //=========================================================================
+    // public variables.
+    //=========================================================================
+    /* NOTHING */
+
+    //=========================================================================
+    // public methods.
+    //=========================================================================
+
+    //-------------------------------------------------------------------------
+    //! @brief      コンストラクタです.
+    //-------------------------------------------------------------------------
+    D3D12CommandListBackend();
+
+    //-------------------------------------------------------------------------
+    //! @brief      デストラクタです.
+    //-------------------------------------------------------------------------
+    ~D3D12CommandListBackend();
+
+    //-------------------------------------------------------------------------
+    //! @brief      初期化処理を行います.
+    //!
+    //! @param[in]      pDevice     デバイスです.
+    //! @param[in]      pQueue      実行先のコマンドキューです.
+    //! @param[in]      type        コマンドリストタイプです.
+    //! @retval true    初期化に成功.
+    //! @retval false   初期化に失敗.
+    //-------------------------------------------------------------------------
+    bool Init(ID3D12Device* pDevice, ID3D12CommandQueue* pQueue, D3D12_COMMAND_LIST_TYPE type);
+
+    //-------------------------------------------------------------------------
+    //! @brief      終了処理を行います.
+    //-------------------------------------------------------------------------
+    void Term();
+
+    bool AddList(uint32_t frameCount) override;
+    bool Begin(uint32_t list, uint32_t frame, ID3D12GraphicsCommandList4** ppCmdList) override;
+    void End(uint32_t list) override;
+    void Execute(const uint32_t* pLists, uint32_t count) override;
+    void Clear() override;
+
+private:
+    ///////////////////////////////////////////////////////////////////////////
+    // Entry structure
+    ///////////////////////////////////////////////////////////////////////////
+    struct Entry
+    {
+        ComPtr<ID3D12GraphicsCommandList4>          pCmdList;       //!< コマンドリストです.
+        std::vector<ComPtr<ID3D12CommandAllocator>> pAllocators;    //!< フレームごとのアロケータです.
+    };
+
+    //=========================================================================
+    // private variables.
+    //=========================================================================
+    ID3D12Device*                   m_pDevice;      //!< デバイスです.
+    ID3D12CommandQueue*             m_pQueue;       //!< コマンドキューです.
+    D3D12_COMMAND_LIST_TYPE         m_Type;         //!< コマンドリストタイプです.
+    std::vector<Entry>              m_Entries;      //!< コマンドリストです.
+    std::vector<ID3D12CommandList*> m_Submit;       //!< 実行用の作業領域です.
+
+    //=========================================================================
+    // private methods.
+    //=========================================================================
+    D3D12CommandListBackend (const D3D12CommandListBackend&) = delete;  // アクセス禁止.
+    void operator =         (const D3D12CommandListBackend&) = delete;  // アクセス禁止.
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// NullCommandListBackend class
+///////////////////////////////////////////////////////////////////////////////
+//! @brief      デバイスを使用せずに呼び出しだけを記録するバックエンドです.
+//!
+//! @note       記録先のコマンドリストは nullptr になるので, 記録処理側はリスト番号と範囲だけを扱ってください.
+//!             分割や実行順序, Begin() が失敗した場合の扱いをデバイス無しで確認するために使用します.
+class NullCommandListBackend : public CommandListBackend
+{
+public:
+    NullCommandListBackend();
+
+    bool AddList(uint32_t frameCount) override;
+    bool Begin(uint32_t list, uint32_t frame, ID3D12GraphicsCommandList4** ppCmdList) override;
+    void End(uint32_t list) override;
+    void Execute(const uint32_t* pLists, uint32_t count) override;
+    void Clear() override;
+
+    //-------------------------------------------------------------------------
+    //! @brief      生成済みのリスト数を取得します.
+    //-------------------------------------------------------------------------
+    uint32_t GetListCount() const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      Begin() された回数を取得します.
+    //-------------------------------------------------------------------------
+    uint32_t GetBeginCount() const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      End() された回数を取得します.
+    //-------------------------------------------------------------------------
+    uint32_t GetEndCount() const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      これまでに実行されたリスト番号を実行順に取得します.
+    //-------------------------------------------------------------------------
+    const std::vector<uint32_t>& GetExecuted() const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      指定したリストの Begin() を失敗させるかどうかを設定します.
+    //!
+    //! @param[in]      list        リスト番号です.
+    //! @param[in]      fail        失敗させる場合は true を指定します.
+    //-------------------------------------------------------------------------
+    void SetBeginFailure(uint32_t list, bool fail);
+
+private:
+    uint32_t                m_ListCount;    //!< リスト数です.
+    std::atomic<uint32_t>   m_BeginCount;   //!< Begin() された回数です.
+    std::atomic<uint32_t>   m_EndCount;     //!< End() された回数です.
+    std::vector<uint32_t>   m_Executed;     //!< 実行されたリスト番号です.
+    std::vector<uint8_t>    m_FailBegin;    //!< Begin() を失敗させるリストです.
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// CommandListPool class
+///////////////////////////////////////////////////////////////////////////////
+//! @brief      フレームごとのアロケータを持つコマンドリストを貸し出し, 予約順に実行します.
+//!
+//! @note       Reserve() はメインスレッドから呼び出し, 返された連番が実行順になります.
+//!             記録の完了順に関係なく, Submit() は必ず連番の順に実行するので結果は決定的です.
+//!             このフレームで記録を開始できなかったリストは実行しません.
+class CommandListPool
+{
+    //=========================================================================
+    // list of friend classes and methods.
+    //=========================================================================
+    /* NOTHING */
+
+public:
+    //=========================================================================
+    // public variables.
+    //=========================================================================
+    static constexpr size_t DefaultMinItemsPerList = 64;    //!< 1リストあたりの最小描画数の既定値です.
+
+    //=========================================================================
+    // public methods.
+    //=========================================================================
+
+    //-------------------------------------------------------------------------
+    //! @brief      コンストラクタです.
+    //-------------------------------------------------------------------------
+    CommandListPool();
+
+    //-------------------------------------------------------------------------
+    //! @brief      デストラクタです.
+    //-------------------------------------------------------------------------
+    ~CommandListPool();
+
+    //-------------------------------------------------------------------------
+    //! @brief      初期化処理を行います.
+    //!
+    //! @param[in]      pBackend    バックエンドです.
+    //! @param[in]      frameCount  フレームごとの資源の数です.
+    //! @retval true    初期化に成功.
+    //! @retval false   初期化に失敗.
+    //-------------------------------------------------------------------------
+    bool Init(CommandListBackend* pBackend, uint32_t frameCount);
+
+    //-------------------------------------------------------------------------
+    //! @brief      終了処理を行います.
+    //-------------------------------------------------------------------------
+    void Term();
+
+    //-------------------------------------------------------------------------
+    //! @brief      フレームを開始します.
+    //!
+    //! @param[in]      frame       FrameScheduler のスロット番号です.
+    //-------------------------------------------------------------------------
+    void BeginFrame(uint32_t frame);
+
+    //-------------------------------------------------------------------------
+    //! @brief      実行順の連番を予約します. メインスレッドから呼び出してください.
+    //!
+    //! @param[in]      count       予約するリスト数です.
+    //! @return     予約した先頭の連番を返却します.
+    //-------------------------------------------------------------------------
+    uint32_t Reserve(uint32_t count);
+
+    //-------------------------------------------------------------------------
+    //! @brief      予約したリストの記録を開始します.
+    //!
+    //! @param[in]      sequence    Reserve() で予約した連番です.
+    //! @return     記録先のコマンドリストを返却します. 記録を開始できなかった場合は nullptr を返却します.
+    //-------------------------------------------------------------------------
+    ID3D12GraphicsCommandList4* Begin(uint32_t sequence);
+
+    //-------------------------------------------------------------------------
+    //! @brief      予約したリストの記録を終了します.
+    //!
+    //! @param[in]      sequence    Reserve() で予約した連番です.
+    //-------------------------------------------------------------------------
+    void End(uint32_t sequence);
+
+    //-------------------------------------------------------------------------
+    //! @brief      予約したリストが記録中かどうかを取得します.
+    //!
+    //! @param[in]      sequence    Reserve() で予約した連番です.
+    //! @retval true    このフレームで Begin() に成功し, まだ End() していません.
+    //! @retval false   記録中ではありません.
+    //-------------------------------------------------------------------------
+    bool IsRecording(uint32_t sequence) const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      このフレームで記録を終えたリストを連番の順に実行します.
+    //-------------------------------------------------------------------------
+    void Submit();
+
+    //-------------------------------------------------------------------------
+    //! @brief      描画数から並列に記録するリスト数を求めます.
+    //!
+    //! @param[in]      itemCount       描画数です.
+    //! @param[in]      minItemsPerList 1リストあたりの最小描画数です.
+    //! @return     リスト数を返却します(1 ～ ワーカースレッド数).
+    //-------------------------------------------------------------------------
+    static uint32_t GetParallelListCount(size_t itemCount, size_t minItemsPerList = DefaultMinItemsPerList);
+
+    //-------------------------------------------------------------------------
+    //! @brief      [0, itemCount) を連続した範囲に分割し, 範囲ごとに別のリストへ並列に記録します.
+    //!
+    //! @param[in]      listCount   リスト数です.
+    //! @param[in]      itemCount   描画数です.
+    //! @param[in]      func        記録処理です. func(pCmd, listIndex, begin, end) の形式で,
+    //!                             リストの状態は引き継がれないので毎回パイプラインの設定から行ってください.
+    //!                             記録を開始できなかったリストでは呼び出されません.
+    //! @return     予約した先頭の連番を返却します.
+    //-------------------------------------------------------------------------
+    template<typename Func>
+    uint32_t RecordParallel(uint32_t listCount, size_t itemCount, Func&& func)
+    {
+        if (listCount == 0)
+        { listCount = 1; }
+
+        // ParallelFor() は常駐のワーカープールで実行されるので, フレームごとにスレッドは生成されない.
+        auto first = Reserve(listCount);
+        ParallelFor(listCount, [&](size_t index)
+        {
+            auto begin = itemCount *  index      / listCount;
+            auto end   = itemCount * (index + 1) / listCount;
+
+            auto pCmd = Begin(first + uint32_t(index));
+            if (!IsRecording(first + uint32_t(index)))
+            { return; }
+
+            func(pCmd, uint32_t(index), begin, end);
+            End(first + uint32_t(index));
+        }, listCount);
+
+        return first;
+    }
+
+private:
+    //=========================================================================
+    // private variables.
+    //=========================================================================
+    CommandListBackend*     m_pBackend;     //!< バックエンドです.
+    uint32_t                m_FrameCount;   //!< フレームごとの資源の数です.
+    uint32_t                m_Frame;        //!< 現在のフレームのスロット番号です.
+    uint32_t                m_ListCount;    //!< 生成済みのリスト数です.
+    uint32_t                m_Reserved;     //!< このフレームで予約したリスト数です.
+    std::vector<uint8_t>    m_State;        //!< このフレームでのリストの記録状態です.
+    std::vector<uint32_t>   m_Order;        //!< 実行順のリスト番号です.
+
+    //=========================================================================
+    // private methods.
+    //=========================================================================
+    CommandListPool (const CommandListPool&) = delete;  // アクセス禁止.
+    void operator = (const CommandListPool&) = delete;  // アクセス禁止.
+};
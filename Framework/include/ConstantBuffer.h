@@ -10,6 +10,7 @@
 //-----------------------------------------------------------------------------
 #include <d3d12.h>
 #include <ComPtr.h>
+#include <UploadAllocator.h>
 #include <vector>
 
 
@@ -55,13 +56,16 @@ public:
     //!
     //! @param[in]      pDevice     デバイスです.
     //! @param[in]      pPool       ディスクリプタプールです.
+    //! @param[in]      size        バッファサイズです.
+    //! @param[in]      pAllocator  アップロードアロケータです. nullptr の場合は専用のリソースを生成します.
     //! @retval true    初期化に成功.
     //! @retval false   初期化に失敗.
     //-------------------------------------------------------------------------
     bool Init(
-        ID3D12Device*   pDevice,
-        DescriptorPool* pPool,
-        size_t          size);
+        ID3D12Device*       pDevice,
+        DescriptorPool*     pPool,
+        size_t              size,
+        UploadAllocator*    pAllocator = nullptr);
 
     //-------------------------------------------------------------------------
     //! @brief      終了処理を行います.
@@ -128,6 +132,8 @@ private:
     DescriptorPool*                 m_pPool;        //!< ディスクリプタプールです.
     D3D12_CONSTANT_BUFFER_VIEW_DESC m_Desc;         //!< 定数バッファビューの構成設定.
     void*                           m_pMappedPtr;   //!< マップ済みポインタ.
+    UploadAllocator*                m_pAllocator;   //!< アップロードアロケータです.
+    UploadAllocation                m_Allocation;   //!< アップロードアロケータからの割り当てです.
 
     //=========================================================================
     // private methods.
@@ -0,0 +1,190 @@
+﻿//-----------------------------------------------------------------------------
+// File : DdsFile.h
+// Desc : DDS File Parser Module.
+// Copyright(c) Pocol. All right reserved.
+//-----------------------------------------------------------------------------
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <dxgiformat.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+//-----------------------------------------------------------------------------
+// Constant Values
+//-----------------------------------------------------------------------------
+constexpr uint32_t DdsMagic                 = 0x20534444;   // 'DDS '
+constexpr uint32_t DdsFourCCDX10            = 0x30315844;   // 'DX10'
+constexpr uint32_t DdsFlagCaps              = 0x1;
+constexpr uint32_t DdsFlagHeight            = 0x2;
+constexpr uint32_t DdsFlagWidth             = 0x4;
+constexpr uint32_t DdsFlagPitch             = 0x8;
+constexpr uint32_t DdsFlagPixelFormat       = 0x1000;
+constexpr uint32_t DdsFlagMipMapCount       = 0x20000;
+constexpr uint32_t DdsFlagLinearSize        = 0x80000;
+constexpr uint32_t DdsFlagDepth             = 0x800000;
+constexpr uint32_t DdsPixelAlphaPixels      = 0x1;
+constexpr uint32_t DdsPixelFourCC           = 0x4;
+constexpr uint32_t DdsPixelRGB              = 0x40;
+constexpr uint32_t DdsPixelLuminance        = 0x20000;
+constexpr uint32_t DdsCapsComplex           = 0x8;
+constexpr uint32_t DdsCapsTexture           = 0x1000;
+constexpr uint32_t DdsCapsMipMap            = 0x400000;
+constexpr uint32_t DdsCaps2CubeMap          = 0x200;
+constexpr uint32_t DdsCaps2CubeAllFaces     = 0xFE00;
+constexpr uint32_t DdsCaps2Volume           = 0x200000;
+constexpr uint32_t DdsDimensionTexture1D    = 2;
+constexpr uint32_t DdsDimensionTexture2D    = 3;
+constexpr uint32_t DdsDimensionTexture3D    = 4;
+constexpr uint32_t DdsMiscTextureCube       = 0x4;
+
+///////////////////////////////////////////////////////////////////////////////
+// DdsPixelFormat structure
+///////////////////////////////////////////////////////////////////////////////
+struct DdsPixelFormat
+{
+    uint32_t    Size;
+    uint32_t    Flags;
+    uint32_t    FourCC;
+    uint32_t    RGBBitCount;
+    uint32_t    RBitMask;
+    uint32_t    GBitMask;
+    uint32_t    BBitMask;
+    uint32_t    ABitMask;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// DdsHeader structure
+///////////////////////////////////////////////////////////////////////////////
+struct DdsHeader
+{
+    uint32_t        Size;
+    uint32_t        Flags;
+    uint32_t        Height;
+    uint32_t        Width;
+    uint32_t        PitchOrLinearSize;
+    uint32_t        Depth;
+    uint32_t        MipMapCount;
+    uint32_t        Reserved1[11];
+    DdsPixelFormat  PixelFormat;
+    uint32_t        Caps;
+    uint32_t        Caps2;
+    uint32_t        Caps3;
+    uint32_t        Caps4;
+    uint32_t        Reserved2;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// DdsHeaderDX10 structure
+///////////////////////////////////////////////////////////////////////////////
+struct DdsHeaderDX10
+{
+    uint32_t    Format;
+    uint32_t    ResourceDimension;
+    uint32_t    MiscFlag;
+    uint32_t    ArraySize;
+    uint32_t    MiscFlags2;
+};
+
+static_assert(sizeof(DdsHeader)     == 124, "DdsHeader size mismatch.");
+static_assert(sizeof(DdsHeaderDX10) == 20,  "DdsHeaderDX10 size mismatch.");
+
+///////////////////////////////////////////////////////////////////////////////
+// DdsInfo structure
+///////////////////////////////////////////////////////////////////////////////
+struct DdsInfo
+{
+    uint32_t    Width;          //!< ミップ0の横幅です.
+    uint32_t    Height;         //!< ミップ0の縦幅です.
+    uint32_t    Depth;          //!< ミップ0の奥行きです(ボリュームテクスチャ以外は 1).
+    uint32_t    ArraySize;      //!< 配列数です. キューブマップは面の数を含みます.
+    uint32_t    MipLevels;      //!< ミップ数です.
+    DXGI_FORMAT Format;         //!< フォーマットです.
+    bool        IsCube;         //!< キューブマップかどうか.
+    size_t      DataOffset;     //!< ファイル先頭からピクセルデータまでのオフセットです.
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// DdsSubresource structure
+///////////////////////////////////////////////////////////////////////////////
+struct DdsSubresource
+{
+    size_t      Offset;         //!< ファイル先頭からのオフセットです.
+    size_t      Size;           //!< サイズです(ボリュームテクスチャは全スライス分).
+    size_t      RowPitch;       //!< 1行(ブロック圧縮は1ブロック行)あたりのサイズです.
+    size_t      SlicePitch;     //!< 1スライスあたりのサイズです.
+    uint32_t    RowCount;       //!< 行数(ブロック圧縮はブロック行数)です.
+    uint32_t    Width;          //!< 横幅です.
+    uint32_t    Height;         //!< 縦幅です.
+    uint32_t    Depth;          //!< 奥行きです.
+};
+
+//-----------------------------------------------------------------------------
+//! @brief      DDS ファイルのヘッダを解析します.
+//!
+//! @param[in]      pData       ファイルの先頭です.
+//! @param[in]      size        ファイルサイズです.
+//! @param[out]     result      解析結果の格納先です.
+//! @retval true    解析に成功.
+//! @retval false   DDS ファイルでないか, 対応していないフォーマット.
+//! @note       DX10 拡張ヘッダと, DXT1～5・ATI1/ATI2・BC4/BC5・一般的な非圧縮の旧形式ヘッダに対応します.
+//-----------------------------------------------------------------------------
+bool ParseDdsHeader(const uint8_t* pData, size_t size, DdsInfo& result);
+
+//-----------------------------------------------------------------------------
+//! @brief      ブロック圧縮フォーマットかどうかチェックします.
+//!
+//! @param[in]      format      フォーマットです.
+//! @retval true    BC1～BC7 のいずれか.
+//! @retval false   非圧縮フォーマット.
+//-----------------------------------------------------------------------------
+bool IsDdsBlockCompressed(DXGI_FORMAT format);
+
+//-----------------------------------------------------------------------------
+//! @brief      1枚のサーフェイスのサイズを求めます.
+//!
+//! @param[in]      format      フォーマットです.
+//! @param[in]      width       横幅です.
+//! @param[in]      height      縦幅です.
+//! @param[out]     rowPitch    1行(ブロック圧縮は1ブロック行)あたりのサイズの格納先です.
+//! @param[out]     rowCount    行数(ブロック圧縮はブロック行数)の格納先です.
+//! @param[out]     slicePitch  サーフェイスのサイズの格納先です.
+//! @retval true    計算に成功.
+//! @retval false   対応していないフォーマット.
+//-----------------------------------------------------------------------------
+bool GetDdsSurfaceInfo(
+    DXGI_FORMAT format,
+    uint32_t    width,
+    uint32_t    height,
+    size_t&     rowPitch,
+    uint32_t&   rowCount,
+    size_t&     slicePitch);
+
+//-----------------------------------------------------------------------------
+//! @brief      サブリソースごとのファイル内の配置を求めます.
+//!
+//! @param[in]      info        ParseDdsHeader() の解析結果です.
+//! @param[in]      fileSize    ファイルサイズです.
+//! @param[out]     result      サブリソースの格納先です. D3D12 と同じく配列要素ごとにミップ0から並べます.
+//! @retval true    計算に成功.
+//! @retval false   ファイルサイズが足りないか, 対応していないフォーマット.
+//-----------------------------------------------------------------------------
+bool ComputeDdsLayout(const DdsInfo& info, size_t fileSize, std::vector<DdsSubresource>& result);
+
+//-----------------------------------------------------------------------------
+//! @brief      DDS ファイルに保存します.
+//!
+//! @param[in]      path        出力ファイルパスです.
+//! @param[in]      info        テクスチャの情報です. DataOffset は使用しません.
+//! @param[in]      pData       ピクセルデータです. ComputeDdsLayout() と同じ並びで格納します.
+//! @param[in]      dataSize    ピクセルデータのサイズです.
+//! @retval true    保存に成功.
+//! @retval false   保存に失敗.
+//! @note       常に DX10 拡張ヘッダで書き出します. 書き込み途中のファイルを読まれないように
+//!             一時ファイルに書いてから置き換えます. ボリュームテクスチャには対応していません.
+//-----------------------------------------------------------------------------
+bool SaveDdsFile(const wchar_t* path, const DdsInfo& info, const void* pData, size_t dataSize);
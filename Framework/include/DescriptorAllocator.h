@@ -0,0 +1,178 @@
+﻿//-----------------------------------------------------------------------------
+// File : DescriptorAllocator.h
+// Desc : Descriptor Range Allocator Module.
+// Copyright(c) Pocol. All right reserved.
+//-----------------------------------------------------------------------------
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <cstdint>
+#include <vector>
+
+
+///////////////////////////////////////////////////////////////////////////////
+// DescriptorRange structure
+///////////////////////////////////////////////////////////////////////////////
+struct DescriptorRange
+{
+    uint32_t    Offset;     //!< ヒープ先頭からの番号です.
+    uint32_t    Count;      //!< 連続したディスクリプタ数です.
+    uint32_t    Node;       //!< アロケータ内部のブロック番号です. 解放時に使います.
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// DescriptorAllocatorStats structure
+///////////////////////////////////////////////////////////////////////////////
+struct DescriptorAllocatorStats
+{
+    uint32_t    Capacity;           //!< 総ディスクリプタ数です.
+    uint32_t    UsedCount;          //!< 割り当て済みのディスクリプタ数です.
+    uint32_t    AllocationCount;    //!< 割り当て数です.
+    uint32_t    FreeBlockCount;     //!< 空きブロック数です.
+    uint32_t    LargestFreeBlock;   //!< 最大の空きブロックのディスクリプタ数です.
+    float       Fragmentation;      //!< 断片化率です. 1 - 最大の空きブロック / 空きディスクリプタ数.
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// DescriptorRangeAllocator class
+///////////////////////////////////////////////////////////////////////////////
+//! @brief      ディスクリプタ番号の連続した範囲を TLSF (Two-Level Segregated Fit) で割り当てます.
+//!
+//! @note       ヒープを持たず番号だけを扱うので, GPU 無しで動作を確認できます.
+//!             割り当てと解放は O(1) で, 解放時に隣接する空きブロックと結合します.
+//!             スレッドセーフではありません.
+class DescriptorRangeAllocator
+{
+    //=========================================================================
+    // list of friend classes and methods.
+    //=========================================================================
+    /* NOTHING */
+
+public:
+    //=========================================================================
+    // public variables.
+    //=========================================================================
+    static constexpr uint32_t InvalidNode = UINT32_MAX;    //!< 無効なブロック番号です.
+
+    //=========================================================================
+    // public methods.
+    //=========================================================================
+
+    //-------------------------------------------------------------------------
+    //! @brief      コンストラクタです.
+    //-------------------------------------------------------------------------
+    DescriptorRangeAllocator();
+
+    //-------------------------------------------------------------------------
+    //! @brief      デストラクタです.
+    //-------------------------------------------------------------------------
+    ~DescriptorRangeAllocator();
+
+    //-------------------------------------------------------------------------
+    //! @brief      初期化処理を行います.
+    //!
+    //! @param[in]      capacity    総ディスクリプタ数です.
+    //! @retval true    初期化に成功.
+    //! @retval false   初期化に失敗.
+    //-------------------------------------------------------------------------
+    bool Init(uint32_t capacity);
+
+    //-------------------------------------------------------------------------
+    //! @brief      終了処理を行います.
+    //-------------------------------------------------------------------------
+    void Term();
+
+    //-------------------------------------------------------------------------
+    //! @brief      連続した範囲を割り当てます.
+    //!
+    //! @param[in]      count       ディスクリプタ数です.
+    //! @param[out]     result      割り当て結果の格納先です.
+    //! @retval true    割り当てに成功.
+    //! @retval false   十分な大きさの空きブロックが無い.
+    //-------------------------------------------------------------------------
+    bool Allocate(uint32_t count, DescriptorRange& result);
+
+    //-------------------------------------------------------------------------
+    //! @brief      範囲を解放します.
+    //!
+    //! @param[in]      range       Allocate() で割り当てた範囲です.
+    //-------------------------------------------------------------------------
+    void Free(const DescriptorRange& range);
+
+    //-------------------------------------------------------------------------
+    //! @brief      総ディスクリプタ数を増やします.
+    //!
+    //! @param[in]      capacity    新しい総ディスクリプタ数です. 現在より大きい値を指定します.
+    //! @retval true    拡張に成功.
+    //! @retval false   拡張に失敗.
+    //! @note       割り当て済みの範囲はそのままで, 末尾に空きが追加されます.
+    //-------------------------------------------------------------------------
+    bool Grow(uint32_t capacity);
+
+    //-------------------------------------------------------------------------
+    //! @brief      総ディスクリプタ数を取得します.
+    //!
+    //! @return     総ディスクリプタ数を返却します.
+    //-------------------------------------------------------------------------
+    uint32_t GetCapacity() const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      割り当て済みのディスクリプタ数を取得します.
+    //!
+    //! @return     割り当て済みのディスクリプタ数を返却します.
+    //-------------------------------------------------------------------------
+    uint32_t GetUsedCount() const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      統計を取得します.
+    //!
+    //! @return     統計を返却します.
+    //-------------------------------------------------------------------------
+    DescriptorAllocatorStats GetStats() const;
+
+private:
+    //=========================================================================
+    // private variables.
+    //=========================================================================
+    static constexpr uint32_t SecondLevelBits   = 4;                        //!< 第2レベルの分割数のビット数です.
+    static constexpr uint32_t SecondLevelCount  = 1u << SecondLevelBits;    //!< 第2レベルの分割数です.
+    static constexpr uint32_t FirstLevelCount   = 32 - SecondLevelBits + 1; //!< 第1レベルの分割数です.
+
+    ///////////////////////////////////////////////////////////////////////////
+    // Node structure
+    ///////////////////////////////////////////////////////////////////////////
+    struct Node
+    {
+        uint32_t    Offset;     //!< 先頭の番号です.
+        uint32_t    Size;       //!< ディスクリプタ数です.
+        uint32_t    PrevPhys;   //!< 番号順で前のブロックです.
+        uint32_t    NextPhys;   //!< 番号順で次のブロックです.
+        uint32_t    PrevFree;   //!< フリーリスト上の前のブロックです.
+        uint32_t    NextFree;   //!< フリーリスト上の次のブロックです.
+        bool        Free;       //!< 空きブロックかどうか.
+    };
+
+    uint32_t                m_Capacity;                                         //!< 総ディスクリプタ数です.
+    uint32_t                m_UsedCount;                                        //!< 割り当て済みのディスクリプタ数です.
+    uint32_t                m_AllocationCount;                                  //!< 割り当て数です.
+    uint32_t                m_FreeBlockCount;                                   //!< 空きブロック数です.
+    uint32_t                m_FirstLevelMap;                                    //!< 空きのある第1レベルのビットマップです.
+    uint32_t                m_SecondLevelMap[FirstLevelCount];                  //!< 空きのある第2レベルのビットマップです.
+    uint32_t                m_FreeHead[FirstLevelCount][SecondLevelCount];      //!< フリーリストの先頭です.
+    std::vector<Node>       m_Nodes;                                            //!< ブロックです.
+    std::vector<uint32_t>   m_FreeNodes;                                        //!< 再利用可能なブロック番号です.
+
+    //=========================================================================
+    // private methods.
+    //=========================================================================
+    DescriptorRangeAllocator(const DescriptorRangeAllocator&) = delete;    // アクセス禁止.
+    void operator =         (const DescriptorRangeAllocator&) = delete;    // アクセス禁止.
+
+    uint32_t CreateNode(uint32_t offset, uint32_t size);
+    void     DestroyNode(uint32_t index);
+    void     InsertFree(uint32_t index);
+    void     RemoveFree(uint32_t index);
+    uint32_t FindFree(uint32_t size) const;
+};
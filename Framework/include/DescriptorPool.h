@@ -10,8 +10,12 @@
 //-----------------------------------------------------------------------------
 #include <d3d12.h>
 #include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
 #include <ComPtr.h>
-#include <Pool.h>
+#include <DescriptorAllocator.h>
 
 ///////////////////////////////////////////////////////////////////////////////
 // DescriptorHandle class
@@ -21,17 +25,174 @@ class DescriptorHandle
 public:
     D3D12_CPU_DESCRIPTOR_HANDLE HandleCPU;  //!< CPUディスクリプタハンドルです.
     D3D12_GPU_DESCRIPTOR_HANDLE HandleGPU;  //!< GPUディスクリプタハンドルです.
+    uint32_t                    HeapIndex;  //!< 所属するヒープの番号です.
+    uint32_t                    Increment;  //!< ディスクリプタ間のバイト数です.
+    DescriptorRange             Range;      //!< ヒープ内の範囲です.
 
     bool HasCPU() const
     { return HandleCPU.ptr != 0; }
 
     bool HasGPU() const
     { return HandleGPU.ptr != 0; }
+
+    D3D12_CPU_DESCRIPTOR_HANDLE GetCPU(uint32_t index) const
+    { return D3D12_CPU_DESCRIPTOR_HANDLE{ HandleCPU.ptr + size_t(Increment) * index }; }
+
+    D3D12_GPU_DESCRIPTOR_HANDLE GetGPU(uint32_t index) const
+    { return D3D12_GPU_DESCRIPTOR_HANDLE{ HasGPU() ? HandleGPU.ptr + uint64_t(Increment) * index : 0 }; }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// DescriptorHeapPage structure
+///////////////////////////////////////////////////////////////////////////////
+struct DescriptorHeapPage
+{
+    ID3D12DescriptorHeap*       pHeap;      //!< ディスクリプタヒープです.
+    D3D12_CPU_DESCRIPTOR_HANDLE HandleCPU;  //!< 先頭のCPUディスクリプタハンドルです.
+    D3D12_GPU_DESCRIPTOR_HANDLE HandleGPU;  //!< 先頭のGPUディスクリプタハンドルです. シェーダから見えない場合は 0.
+    uint32_t                    Count;      //!< ディスクリプタ数です.
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// DescriptorHeapBackend class
+///////////////////////////////////////////////////////////////////////////////
+//! @brief      ディスクリプタヒープの生成・破棄を行うインタフェースです.
+//!
+//! @note       DescriptorPool の割り当てやヒープの連結は番号だけで完結するので,
+//!             ここを差し替えれば GPU 無しで動作を確認できます.
+class DescriptorHeapBackend
+{
+public:
+    virtual ~DescriptorHeapBackend() = default;
+
+    //-------------------------------------------------------------------------
+    //! @brief      ディスクリプタヒープを生成します.
+    //!
+    //! @param[in]      count       ディスクリプタ数です.
+    //! @param[out]     page        ヒープの格納先です.
+    //! @retval true    生成に成功.
+    //! @retval false   生成に失敗.
+    //-------------------------------------------------------------------------
+    virtual bool CreateHeap(uint32_t count, DescriptorHeapPage& page) = 0;
+
+    //-------------------------------------------------------------------------
+    //! @brief      ディスクリプタヒープを破棄します.
+    //!
+    //! @param[in,out]  page        破棄するヒープです.
+    //-------------------------------------------------------------------------
+    virtual void DestroyHeap(DescriptorHeapPage& page) = 0;
+
+    //-------------------------------------------------------------------------
+    //! @brief      ディスクリプタ間のバイト数を取得します.
+    //!
+    //! @return     ディスクリプタ間のバイト数を返却します.
+    //-------------------------------------------------------------------------
+    virtual uint32_t GetIncrementSize() const = 0;
+
+    //-------------------------------------------------------------------------
+    //! @brief      1ヒープあたりのディスクリプタ数の上限を取得します.
+    //!
+    //! @return     デバイスが許すディスクリプタ数の上限を返却します.
+    //-------------------------------------------------------------------------
+    virtual uint32_t GetMaxHeapSize() const = 0;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// D3D12DescriptorHeapBackend class
+///////////////////////////////////////////////////////////////////////////////
+class D3D12DescriptorHeapBackend : public DescriptorHeapBackend
+{
+    //=========================================================================
+    // list of friend classes and methods.
+    //=========================================================================
+    /* NOTHING */
+
+public:
+    //=========================================================================
+    // public variables.
+    //=========================================================================
+    /* NOTHING */
+
+    //=========================================================================
+    // public methods.
+    //=========================================================================
+
+    //-------------------------------------------------------------------------
+    //! @brief      コンストラクタです.
+    //-------------------------------------------------------------------------
+    D3D12DescriptorHeapBackend();
+
+    //-------------------------------------------------------------------------
+    //! @brief      デストラクタです.
+    //-------------------------------------------------------------------------
+    ~D3D12DescriptorHeapBackend();
+
+    //-------------------------------------------------------------------------
+    //! @brief      初期化処理を行います.
+    //!
+    //! @param[in]      pDevice     デバイスです.
+    //! @param[in]      pDesc       ディスクリプタヒープの構成設定です. NumDescriptors は使いません.
+    //! @retval true    初期化に成功.
+    //! @retval false   初期化に失敗.
+    //-------------------------------------------------------------------------
+    bool Init(ID3D12Device* pDevice, const D3D12_DESCRIPTOR_HEAP_DESC* pDesc);
+
+    //-------------------------------------------------------------------------
+    //! @brief      終了処理を行います.
+    //-------------------------------------------------------------------------
+    void Term();
+
+    //-------------------------------------------------------------------------
+    //! @brief      ID3D12DescriptorHeap を生成します.
+    //-------------------------------------------------------------------------
+    bool CreateHeap(uint32_t count, DescriptorHeapPage& page) override;
+
+    //-------------------------------------------------------------------------
+    //! @brief      ID3D12DescriptorHeap を破棄します.
+    //-------------------------------------------------------------------------
+    void DestroyHeap(DescriptorHeapPage& page) override;
+
+    //-------------------------------------------------------------------------
+    //! @brief      ディスクリプタ間のバイト数を取得します.
+    //-------------------------------------------------------------------------
+    uint32_t GetIncrementSize() const override;
+
+    //-------------------------------------------------------------------------
+    //! @brief      1ヒープあたりのディスクリプタ数の上限を取得します.
+    //!
+    //! @note       シェーダから見えるヒープはリソースバインディングティアで決まる上限を返します.
+    //-------------------------------------------------------------------------
+    uint32_t GetMaxHeapSize() const override;
+
+private:
+    //=========================================================================
+    // private variables.
+    //=========================================================================
+    ID3D12Device*               m_pDevice;          //!< デバイスです.
+    D3D12_DESCRIPTOR_HEAP_DESC  m_Desc;             //!< ディスクリプタヒープの構成設定です.
+    uint32_t                    m_IncrementSize;    //!< ディスクリプタ間のバイト数です.
+    uint32_t                    m_MaxHeapSize;      //!< 1ヒープあたりのディスクリプタ数の上限です.
+
+    //=========================================================================
+    // private methods.
+    //=========================================================================
+    D3D12DescriptorHeapBackend  (const D3D12DescriptorHeapBackend&) = delete;  // アクセス禁止.
+    void operator =             (const D3D12DescriptorHeapBackend&) = delete;  // アクセス禁止.
 };
 
 ///////////////////////////////////////////////////////////////////////////////
 // DescriptorPool class
 ///////////////////////////////////////////////////////////////////////////////
+//! @brief      ディスクリプタヒープから連続した範囲を割り当てます.
+//!
+//! @note       ヒープ内の割り当ては DescriptorRangeAllocator で行います.
+//!             先頭のヒープは生成時に最大数で確保し, 空きが無くなると割り当て可能な範囲を倍々に広げます.
+//!             ヒープを作り直さないので, 割り当て済みのハンドルやヒープ先頭からの番号は変わりません.
+//!             シェーダから見えないヒープは最大数に達すると同じ設定のヒープを追加して連結します.
+//!             シェーダから見えるヒープは同時に1つしか設定できないので連結せず, 最大数に達すると割り当てに失敗します.
+//!             最大数はバックエンドが返すデバイスの上限に丸めます.
+//!             AllocTransient() の範囲は FrameEnd() で渡したフェンス値に紐づき,
+//!             Retire() にそのフェンス値以上の完了値を渡すまで回収されません.
 class DescriptorPool
 {
     //=========================================================================
@@ -43,7 +204,7 @@ public:
     //=========================================================================
     // public variables.
     //=========================================================================
-    /* NOTHING */
+    static constexpr uint32_t TransientChunkSize = 64;     //!< 一時的な範囲をまとめて確保する単位です.
 
     //=========================================================================
     // public methods.
@@ -63,6 +224,52 @@ public:
         const D3D12_DESCRIPTOR_HEAP_DESC*   pDesc,
         DescriptorPool**                    ppPool);
 
+    //-------------------------------------------------------------------------
+    //! @brief      先頭のヒープの最大数を指定して生成処理を行います.
+    //!
+    //! @param[in]      pDevice     デバイスです.
+    //! @param[in]      pDesc       ディスクリプタヒープの構成設定です. NumDescriptors は最初に割り当て可能な数です.
+    //! @param[in]      maxCount    先頭のヒープに確保するディスクリプタ数です. デバイスの上限に丸めます.
+    //! @param[out]     ppPool      ディスクリプタプールの格納先です.
+    //! @retval true    生成処理に成功.
+    //! @retval false   生成処理に失敗.
+    //-------------------------------------------------------------------------
+    static bool Create(
+        ID3D12Device*                       pDevice,
+        const D3D12_DESCRIPTOR_HEAP_DESC*   pDesc,
+        uint32_t                            maxCount,
+        DescriptorPool**                    ppPool);
+
+    //-------------------------------------------------------------------------
+    //! @brief      バックエンドを指定して生成処理を行います.
+    //!
+    //! @param[in]      pBackend    ヒープの生成・破棄を行うバックエンドです. プールより長く生存させてください.
+    //! @param[in]      heapSize    1ヒープあたりのディスクリプタ数です.
+    //! @param[out]     ppPool      ディスクリプタプールの格納先です.
+    //! @retval true    生成処理に成功.
+    //! @retval false   生成処理に失敗.
+    //-------------------------------------------------------------------------
+    static bool Create(
+        DescriptorHeapBackend*              pBackend,
+        uint32_t                            heapSize,
+        DescriptorPool**                    ppPool);
+
+    //-------------------------------------------------------------------------
+    //! @brief      バックエンドと先頭のヒープの最大数を指定して生成処理を行います.
+    //!
+    //! @param[in]      pBackend    ヒープの生成・破棄を行うバックエンドです. プールより長く生存させてください.
+    //! @param[in]      heapSize    最初に割り当て可能なディスクリプタ数です. 連結するヒープの大きさにも使います.
+    //! @param[in]      maxCount    先頭のヒープに確保するディスクリプタ数です. デバイスの上限に丸めます.
+    //! @param[out]     ppPool      ディスクリプタプールの格納先です.
+    //! @retval true    生成処理に成功.
+    //! @retval false   生成処理に失敗.
+    //-------------------------------------------------------------------------
+    static bool Create(
+        DescriptorHeapBackend*              pBackend,
+        uint32_t                            heapSize,
+        uint32_t                            maxCount,
+        DescriptorPool**                    ppPool);
+
     //-------------------------------------------------------------------------
     //! @brief      参照カウントを増やします.
     //-------------------------------------------------------------------------
@@ -87,6 +294,15 @@ public:
     //-------------------------------------------------------------------------
     DescriptorHandle* AllocHandle();
 
+    //-------------------------------------------------------------------------
+    //! @brief      連続したディスクリプタを割り当てます.
+    //!
+    //! @param[in]      count       ディスクリプタ数です.
+    //! @return     先頭のディスクリプタハンドルを返却します. 失敗した場合は nullptr を返却します.
+    //! @note       i 番目のディスクリプタは DescriptorHandle::GetCPU(i), GetGPU(i) で取得します.
+    //-------------------------------------------------------------------------
+    DescriptorHandle* AllocRange(uint32_t count);
+
     //-------------------------------------------------------------------------
     //! @brief      ディスクリプタハンドルを解放します.
     //!
@@ -94,6 +310,31 @@ public:
     //-------------------------------------------------------------------------
     void FreeHandle(DescriptorHandle*& pHandle);
 
+    //-------------------------------------------------------------------------
+    //! @brief      現在のフレームの間だけ有効な連続したディスクリプタを割り当てます.
+    //!
+    //! @param[in]      count       ディスクリプタ数です.
+    //! @param[out]     result      先頭のディスクリプタハンドルの格納先です.
+    //! @retval true    割り当てに成功.
+    //! @retval false   割り当てに失敗.
+    //! @note       TransientChunkSize 単位で確保した範囲から線形に切り出します. 解放は不要です.
+    //-------------------------------------------------------------------------
+    bool AllocTransient(uint32_t count, DescriptorHandle& result);
+
+    //-------------------------------------------------------------------------
+    //! @brief      フレームを終了します.
+    //!
+    //! @param[in]      fenceValue  このフレームのコマンドの完了時にシグナルされるフェンス値です.
+    //-------------------------------------------------------------------------
+    void FrameEnd(uint64_t fenceValue);
+
+    //-------------------------------------------------------------------------
+    //! @brief      GPUの処理が完了した一時的な範囲を回収します.
+    //!
+    //! @param[in]      completedValue  完了済みのフェンス値です.
+    //-------------------------------------------------------------------------
+    void Retire(uint64_t completedValue);
+
     //-------------------------------------------------------------------------
     //! @brief      利用可能なハンドル数を取得します.
     //!
@@ -111,25 +352,98 @@ public:
     //-------------------------------------------------------------------------
     //! @brief      ハンドル総数を取得します.
     //!
-    //! @return     ハンドル総数を返却します.
+    //! @return     現在割り当て可能なハンドル総数を返却します.
     //-------------------------------------------------------------------------
     uint32_t GetHandleCount() const;
 
+    //-------------------------------------------------------------------------
+    //! @brief      拡張できるハンドル総数を取得します.
+    //!
+    //! @return     確保済みのヒープのディスクリプタ数の合計を返却します.
+    //-------------------------------------------------------------------------
+    uint32_t GetMaxHandleCount() const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      使用状況の統計を取得します.
+    //!
+    //! @return     全てのヒープを合算した統計を返却します. 断片化率はヒープごとの最大値です.
+    //-------------------------------------------------------------------------
+    DescriptorAllocatorStats GetStats() const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      ディスクリプタヒープ数を取得します.
+    //!
+    //! @return     連結されたディスクリプタヒープ数を返却します. シェーダから見えるプールは常に 1 です.
+    //-------------------------------------------------------------------------
+    uint32_t GetHeapCount() const;
+
     //-------------------------------------------------------------------------
     //! @brief      ディスクリプタヒープを取得します.
     //!
-    //! @return     ディスクリプタヒープを返却します.
+    //! @return     先頭のディスクリプタヒープを返却します.
     //-------------------------------------------------------------------------
     ID3D12DescriptorHeap* const GetHeap() const;
 
+    //-------------------------------------------------------------------------
+    //! @brief      ディスクリプタヒープを取得します.
+    //!
+    //! @param[in]      index       ヒープ番号(DescriptorHandle::HeapIndex)です.
+    //! @return     ディスクリプタヒープを返却します. 範囲外の場合は nullptr を返却します.
+    //-------------------------------------------------------------------------
+    ID3D12DescriptorHeap* const GetHeap(uint32_t index) const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      ヒープ先頭からのディスクリプタ番号を取得します.
+    //!
+    //! @param[in]      handle      このプールから割り当てたGPUディスクリプタハンドルです.
+    //! @return     ディスクリプタ番号を返却します. ヒープ外のハンドルやシェーダから見えないプールの場合は UINT32_MAX を返却します.
+    //! @note       シェーダからヒープ先頭を起点としたテーブルを番号で参照する際に使います.
+    //-------------------------------------------------------------------------
+    uint32_t GetHandleIndex(D3D12_GPU_DESCRIPTOR_HANDLE handle) const;
+
 private:
+    ///////////////////////////////////////////////////////////////////////////
+    // HeapState structure
+    ///////////////////////////////////////////////////////////////////////////
+    struct HeapState
+    {
+        DescriptorHeapPage                          Page;       //!< ディスクリプタヒープです.
+        std::unique_ptr<DescriptorRangeAllocator>   pAllocator; //!< ヒープ内の割り当てを行うアロケータです.
+    };
+
+    ///////////////////////////////////////////////////////////////////////////
+    // HeapRange structure
+    ///////////////////////////////////////////////////////////////////////////
+    struct HeapRange
+    {
+        uint32_t            HeapIndex;  //!< ヒープ番号です.
+        DescriptorRange     Range;      //!< ヒープ内の範囲です.
+    };
+
+    ///////////////////////////////////////////////////////////////////////////
+    // PendingFrame structure
+    ///////////////////////////////////////////////////////////////////////////
+    struct PendingFrame
+    {
+        uint64_t                        FenceValue;     //!< 完了を待つフェンス値です.
+        std::vector<HeapRange>          Ranges;         //!< 解放する範囲です.
+    };
+
     //=========================================================================
     // private varaibles.
     //=========================================================================
     std::atomic<uint32_t>           m_RefCount;         //!< 参照カウントです.
-    Pool<DescriptorHandle>          m_Pool;             //!< ディスクリプタハンドルプールです.
-    ComPtr<ID3D12DescriptorHeap>    m_pHeap;            //!< ディスクリプタヒープです.
+    D3D12DescriptorHeapBackend      m_D3D12Backend;     //!< デバイスから生成した場合のバックエンドです.
+    DescriptorHeapBackend*          m_pBackend;         //!< バックエンドです.
+    uint32_t                        m_HeapSize;         //!< 1ヒープあたりのディスクリプタ数です.
     uint32_t                        m_DescriptorSize;   //!< ディスクリプタサイズです.
+    bool                            m_ShaderVisible;    //!< シェーダから見えるヒープかどうか.
+    std::vector<HeapState>          m_Heaps;            //!< 連結したディスクリプタヒープです.
+    HeapRange                       m_Transient;        //!< 一時的な範囲を切り出し中のチャンクです.
+    uint32_t                        m_TransientOffset;  //!< チャンク内で次に切り出す位置です.
+    std::vector<HeapRange>          m_FrameRelease;     //!< 現在のフレームで解放する範囲です.
+    std::deque<PendingFrame>        m_Pending;          //!< フェンス完了待ちのフレームです.
+    mutable std::mutex              m_Mutex;            //!< 排他制御用です.
 
     //=========================================================================
     // private methods.
@@ -147,4 +461,10 @@ private:
 
     DescriptorPool  (const DescriptorPool&) = delete;   // アクセス禁止.
     void operator = (const DescriptorPool&) = delete;   // アクセス禁止.
+
+    bool Init(DescriptorHeapBackend* pBackend, uint32_t heapSize, uint32_t maxCount);
+    bool AllocateInternal(uint32_t count, HeapRange& result);
+    bool AddHeap(uint32_t capacity, uint32_t count);
+    bool GrowHeap(uint32_t index, uint32_t count);
+    void FillHandle(const HeapRange& range, uint32_t offset, uint32_t count, DescriptorHandle& handle) const;
 };
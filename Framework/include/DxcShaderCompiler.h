@@ -0,0 +1,89 @@
+﻿//-----------------------------------------------------------------------------
+// File : DxcShaderCompiler.h
+// Desc : DXC Shader Compiler Module.
+// Copyright(c) Pocol. All right reserved.
+//-----------------------------------------------------------------------------
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <ShaderCache.h>
+#include <dxcapi.h>
+
+
+///////////////////////////////////////////////////////////////////////////////
+// DxcShaderCompiler class
+///////////////////////////////////////////////////////////////////////////////
+//! @brief      DXC でシェーダをコンパイルします.
+//!
+//! @note       DXC のオブジェクトはスレッドセーフではないので, Compile() の呼び出しごとに生成します.
+class DxcShaderCompiler : public ShaderCompiler
+{
+    //=========================================================================
+    // list of friend classes and methods.
+    //=========================================================================
+    /* NOTHING */
+
+public:
+    //=========================================================================
+    // public variables.
+    //=========================================================================
+    /* NOTHING */
+
+    //=========================================================================
+    // public methods.
+    //=========================================================================
+
+    //-------------------------------------------------------------------------
+    //! @brief      コンストラクタです.
+    //-------------------------------------------------------------------------
+    DxcShaderCompiler();
+
+    //-------------------------------------------------------------------------
+    //! @brief      デストラクタです.
+    //-------------------------------------------------------------------------
+    ~DxcShaderCompiler();
+
+    //-------------------------------------------------------------------------
+    //! @brief      初期化処理を行います. コンパイラのバージョンを取得します.
+    //!
+    //! @retval true    初期化に成功.
+    //! @retval false   初期化に失敗.
+    //-------------------------------------------------------------------------
+    bool Init();
+
+    //-------------------------------------------------------------------------
+    //! @brief      終了処理を行います.
+    //-------------------------------------------------------------------------
+    void Term();
+
+    std::string GetVersion() const override;
+    bool Compile(
+        const ShaderDesc&       desc,
+        const std::string&      source,
+        std::vector<uint8_t>&   binary,
+        std::string&            message) override;
+
+private:
+    //=========================================================================
+    // private variables.
+    //=========================================================================
+    std::string     m_Version;      //!< バージョン文字列です.
+
+    //=========================================================================
+    // private methods.
+    //=========================================================================
+    DxcShaderCompiler   (const DxcShaderCompiler&) = delete;    // アクセス禁止.
+    void operator =     (const DxcShaderCompiler&) = delete;    // アクセス禁止.
+};
+
+//-----------------------------------------------------------------------------
+//! @brief      シェーダバイナリを参照する IDxcBlob を生成します.
+//!
+//! @param[in]      binary      シェーダバイナリです. 生成した IDxcBlob が解放されるまで保持されます.
+//! @param[out]     ppBlob      IDxcBlob の格納先です.
+//! @retval true    生成に成功.
+//! @retval false   生成に失敗.
+//-----------------------------------------------------------------------------
+bool CreateShaderBlob(const std::shared_ptr<ShaderBinary>& binary, IDxcBlob** ppBlob);
@@ -73,6 +73,22 @@ public:
 
     void Sync_(ID3D12CommandQueue* pQueue);
 
+    //-------------------------------------------------------------------------
+    //! @brief      待機せずにシグナルだけを積みます.
+    //!
+    //! @param[in]      pQueue          コマンドキューです.
+    //! @return     シグナルしたフェンス値を返却します. 失敗した場合は 0 を返却します.
+    //-------------------------------------------------------------------------
+    UINT64 Signal(ID3D12CommandQueue* pQueue);
+
+    //-------------------------------------------------------------------------
+    //! @brief      指定したフェンス値が完了するまで待機します.
+    //!
+    //! @param[in]      value           待機するフェンス値です.
+    //! @param[in]      timeout         タイムアウト時間(ミリ秒).
+    //-------------------------------------------------------------------------
+    void WaitValue(UINT64 value, UINT timeout);
+
     UINT GetFenceCounter() const {
         return m_Counter;
     }
@@ -89,6 +105,10 @@ public:
         return m_pFence.Get();
     }
 
+    UINT64 GetCompletedValue() const {
+        return (m_pFence != nullptr) ? m_pFence->GetCompletedValue() : 0;
+    }
+
 
 
 private:
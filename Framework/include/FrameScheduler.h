@@ -0,0 +1,311 @@
+﻿//-----------------------------------------------------------------------------
+// File : FrameScheduler.h
+// Desc : Frame Scheduler Module.
+// Copyright(c) Pocol. All right reserved.
+//-----------------------------------------------------------------------------
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <d3d12.h>
+#include <cstdint>
+#include <vector>
+
+
+//-----------------------------------------------------------------------------
+// Forward Declarations.
+//-----------------------------------------------------------------------------
+class Fence;
+
+
+///////////////////////////////////////////////////////////////////////////////
+// FrameTimeline class
+///////////////////////////////////////////////////////////////////////////////
+//! @brief      フェンス値のタイムラインを表すインタフェースです.
+//!
+//! @note       FrameScheduler はこのインタフェースだけを使用するので,
+//!             SimulatedFrameTimeline に差し替えればデバイス無しで動作を確認できます.
+class FrameTimeline
+{
+public:
+    virtual ~FrameTimeline() = default;
+
+    //-------------------------------------------------------------------------
+    //! @brief      投入済みのコマンドの後にシグナルを積みます.
+    //!
+    //! @return     シグナルするフェンス値を返却します. 失敗した場合は 0 を返却します.
+    //-------------------------------------------------------------------------
+    virtual uint64_t Signal() = 0;
+
+    //-------------------------------------------------------------------------
+    //! @brief      完了済みのフェンス値を取得します.
+    //!
+    //! @return     完了済みのフェンス値を返却します.
+    //-------------------------------------------------------------------------
+    virtual uint64_t GetCompletedValue() const = 0;
+
+    //-------------------------------------------------------------------------
+    //! @brief      指定したフェンス値が完了するまで待機します.
+    //!
+    //! @param[in]      value       待機するフェンス値です.
+    //-------------------------------------------------------------------------
+    virtual void Wait(uint64_t value) = 0;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// QueueFrameTimeline class
+///////////////////////////////////////////////////////////////////////////////
+class QueueFrameTimeline : public FrameTimeline
+{
+    //=========================================================================
+    // list of friend classes and methods.
+    //=========================================================================
+    /* NOTHING */
+
+public:
+    //=========================================================================
+    // public variables.
+    //=========================================================================
+    /* NOTHING */
+
+    //=========================================================================
+    // public methods.
+    //=========================================================================
+
+    //-------------------------------------------------------------------------
+    //! @brief      コンストラクタです.
+    //-------------------------------------------------------------------------
+    QueueFrameTimeline();
+
+    //-------------------------------------------------------------------------
+    //! @brief      デストラクタです.
+    //-------------------------------------------------------------------------
+    ~QueueFrameTimeline();
+
+    //-------------------------------------------------------------------------
+    //! @brief      初期化処理を行います.
+    //!
+    //! @param[in]      pFence      フェンスです.
+    //! @param[in]      pQueue      シグナルを積むコマンドキューです.
+    //! @retval true    初期化に成功.
+    //! @retval false   初期化に失敗.
+    //-------------------------------------------------------------------------
+    bool Init(Fence* pFence, ID3D12CommandQueue* pQueue);
+
+    //-------------------------------------------------------------------------
+    //! @brief      終了処理を行います.
+    //-------------------------------------------------------------------------
+    void Term();
+
+    uint64_t Signal() override;
+    uint64_t GetCompletedValue() const override;
+    void     Wait(uint64_t value) override;
+
+private:
+    //=========================================================================
+    // private variables.
+    //=========================================================================
+    Fence*              m_pFence;   //!< フェンスです.
+    ID3D12CommandQueue* m_pQueue;   //!< コマンドキューです.
+
+    //=========================================================================
+    // private methods.
+    //=========================================================================
+    QueueFrameTimeline  (const QueueFrameTimeline&) = delete;   // アクセス禁止.
+    void operator =     (const QueueFrameTimeline&) = delete;   // アクセス禁止.
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// SimulatedFrameTimeline class
+///////////////////////////////////////////////////////////////////////////////
+//! @brief      CPU上でGPUのフェンスタイムラインを模擬します.
+//!
+//! @note       GPUはシグナルまでのコマンドを投入順に1つずつ処理し, 1フレームあたり
+//!             SetGpuCost() で指定した時間がかかるものとします. CPUの処理時間は
+//!             AdvanceCpu() で進め, Wait() でブロックした時間はストール時間として集計します.
+class SimulatedFrameTimeline : public FrameTimeline
+{
+    //=========================================================================
+    // list of friend classes and methods.
+    //=========================================================================
+    /* NOTHING */
+
+public:
+    //=========================================================================
+    // public variables.
+    //=========================================================================
+    /* NOTHING */
+
+    //=========================================================================
+    // public methods.
+    //=========================================================================
+
+    //-------------------------------------------------------------------------
+    //! @brief      コンストラクタです.
+    //-------------------------------------------------------------------------
+    SimulatedFrameTimeline();
+
+    //-------------------------------------------------------------------------
+    //! @brief      次に Signal() するまでのGPU処理時間を設定します.
+    //!
+    //! @param[in]      cost        GPU処理時間です.
+    //-------------------------------------------------------------------------
+    void SetGpuCost(double cost);
+
+    //-------------------------------------------------------------------------
+    //! @brief      CPU時間を進めます.
+    //!
+    //! @param[in]      time        CPUの処理時間です.
+    //-------------------------------------------------------------------------
+    void AdvanceCpu(double time);
+
+    //-------------------------------------------------------------------------
+    //! @brief      現在のCPU時間を取得します.
+    //-------------------------------------------------------------------------
+    double GetCpuTime() const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      Wait() でCPUがブロックした合計時間を取得します.
+    //-------------------------------------------------------------------------
+    double GetStallTime() const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      CPUとGPUが共に処理を行っていた合計時間を取得します.
+    //-------------------------------------------------------------------------
+    double GetOverlapTime() const;
+
+    uint64_t Signal() override;
+    uint64_t GetCompletedValue() const override;
+    void     Wait(uint64_t value) override;
+
+private:
+    //=========================================================================
+    // private variables.
+    //=========================================================================
+    std::vector<double> m_StartTime;        //!< フェンス値ごとのGPU処理の開始時刻です(インデックス = 値 - 1).
+    std::vector<double> m_CompleteTime;     //!< フェンス値ごとの完了時刻です(インデックス = 値 - 1).
+    double              m_CpuTime;          //!< 現在のCPU時刻です.
+    double              m_GpuBusyUntil;     //!< GPUが最後のコマンドを終える時刻です.
+    double              m_GpuCost;          //!< 1シグナルあたりのGPU処理時間です.
+    double              m_StallTime;        //!< CPUのストール時間です.
+    double              m_OverlapTime;      //!< CPUとGPUの並行動作時間です.
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// FrameScheduler class
+///////////////////////////////////////////////////////////////////////////////
+//! @brief      最大 N フレームをGPUに先行して投入するためのスケジューラです.
+//!
+//! @note       フレームごとの資源(コマンドアロケータや定数バッファ)は GetFrameSlot() 番目を使用します.
+//!             BeginFrame() はそのスロットを前回使用したフレームの完了だけを待つので,
+//!             CPUは最大 latency フレームだけGPUに先行できます.
+class FrameScheduler
+{
+    //=========================================================================
+    // list of friend classes and methods.
+    //=========================================================================
+    /* NOTHING */
+
+public:
+    //=========================================================================
+    // public variables.
+    //=========================================================================
+    static constexpr uint32_t MaxLatency = 3;   //!< 最大フレームレイテンシです.
+
+    //=========================================================================
+    // public methods.
+    //=========================================================================
+
+    //-------------------------------------------------------------------------
+    //! @brief      コンストラクタです.
+    //-------------------------------------------------------------------------
+    FrameScheduler();
+
+    //-------------------------------------------------------------------------
+    //! @brief      デストラクタです.
+    //-------------------------------------------------------------------------
+    ~FrameScheduler();
+
+    //-------------------------------------------------------------------------
+    //! @brief      初期化処理を行います.
+    //!
+    //! @param[in]      pTimeline   フェンスタイムラインです.
+    //! @param[in]      latency     GPUに先行して投入できるフレーム数です(1 ～ MaxLatency).
+    //! @retval true    初期化に成功.
+    //! @retval false   初期化に失敗.
+    //-------------------------------------------------------------------------
+    bool Init(FrameTimeline* pTimeline, uint32_t latency);
+
+    //-------------------------------------------------------------------------
+    //! @brief      終了処理を行います. GPUの処理完了を待機します.
+    //-------------------------------------------------------------------------
+    void Term();
+
+    //-------------------------------------------------------------------------
+    //! @brief      フレームを開始します. スロットが使用中であれば完了を待機します.
+    //!
+    //! @return     このフレームで使用するスロット番号を返却します.
+    //-------------------------------------------------------------------------
+    uint32_t BeginFrame();
+
+    //-------------------------------------------------------------------------
+    //! @brief      フレームを終了します. コマンドを投入した後に呼び出してください.
+    //!
+    //! @return     このフレームの完了時にシグナルされるフェンス値を返却します.
+    //-------------------------------------------------------------------------
+    uint64_t EndFrame();
+
+    //-------------------------------------------------------------------------
+    //! @brief      投入済みのフレームが全て完了するまで待機します.
+    //-------------------------------------------------------------------------
+    void WaitIdle();
+
+    //-------------------------------------------------------------------------
+    //! @brief      フレームレイテンシを変更します. フレーム外でのみ呼び出せます.
+    //!
+    //! @param[in]      latency     GPUに先行して投入できるフレーム数です(1 ～ MaxLatency).
+    //! @retval true    変更に成功.
+    //! @retval false   変更に失敗.
+    //-------------------------------------------------------------------------
+    bool SetLatency(uint32_t latency);
+
+    //-------------------------------------------------------------------------
+    //! @brief      フレームレイテンシを取得します.
+    //-------------------------------------------------------------------------
+    uint32_t GetLatency() const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      現在のフレームのスロット番号を取得します.
+    //-------------------------------------------------------------------------
+    uint32_t GetFrameSlot() const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      これまでに終了したフレーム数を取得します.
+    //-------------------------------------------------------------------------
+    uint64_t GetFrameNumber() const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      BeginFrame() で実際に待機した回数を取得します.
+    //-------------------------------------------------------------------------
+    uint64_t GetWaitCount() const;
+
+private:
+    //=========================================================================
+    // private variables.
+    //=========================================================================
+    FrameTimeline*  m_pTimeline;                //!< フェンスタイムラインです.
+    uint64_t        m_SlotFence[MaxLatency];    //!< スロットを最後に使用したフレームのフェンス値です.
+    uint64_t        m_LastFence;                //!< 最後にシグナルしたフェンス値です.
+    uint64_t        m_FrameNumber;              //!< 終了したフレーム数です.
+    uint64_t        m_WaitCount;                //!< 待機した回数です.
+    uint32_t        m_Latency;                  //!< フレームレイテンシです.
+    uint32_t        m_Slot;                     //!< 現在のスロット番号です.
+    bool            m_InFrame;                  //!< BeginFrame() ～ EndFrame() の間かどうか.
+
+    //=========================================================================
+    // private methods.
+    //=========================================================================
+    FrameScheduler  (const FrameScheduler&) = delete;   // アクセス禁止.
+    void operator = (const FrameScheduler&) = delete;   // アクセス禁止.
+};
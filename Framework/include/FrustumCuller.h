@@ -0,0 +1,133 @@
+﻿//-----------------------------------------------------------------------------
+// File : FrustumCuller.h
+// Desc : Frustum Culling Module.
+// Copyright(c) Pocol. All right reserved.
+//-----------------------------------------------------------------------------
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <MeshBounds.h>
+#include <OcclusionBuffer.h>
+#include <DirectXMath.h>
+#include <cstdint>
+#include <vector>
+
+
+///////////////////////////////////////////////////////////////////////////////
+// CullingStats structure
+///////////////////////////////////////////////////////////////////////////////
+struct CullingStats
+{
+    uint32_t    Tested;             //!< 判定したボリューム数です.
+    uint32_t    FrustumCulled;      //!< 視錐台の外にあったボリューム数です.
+    uint32_t    OcclusionCulled;    //!< 遮蔽されていたボリューム数です.
+    uint32_t    Visible;            //!< 可視と判定したボリューム数です.
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// FrustumCuller class
+///////////////////////////////////////////////////////////////////////////////
+//! @brief      ワールド空間のバウンディングボリュームを SoA で保持し, 4つずつ視錐台と判定します.
+//!
+//! @note       各平面に対して AABB の射影半径と境界球の半径の小さい方を使うので,
+//!             どちらか一方だけで判定するより多くのボリュームを除外できます.
+class FrustumCuller
+{
+    //=========================================================================
+    // list of friend classes and methods.
+    //=========================================================================
+    /* NOTHING */
+
+public:
+    //=========================================================================
+    // public variables.
+    //=========================================================================
+    /* NOTHING */
+
+    //=========================================================================
+    // public methods.
+    //=========================================================================
+
+    //-------------------------------------------------------------------------
+    //! @brief      コンストラクタです.
+    //-------------------------------------------------------------------------
+    FrustumCuller();
+
+    //-------------------------------------------------------------------------
+    //! @brief      デストラクタです.
+    //-------------------------------------------------------------------------
+    ~FrustumCuller();
+
+    //-------------------------------------------------------------------------
+    //! @brief      全てのボリュームを削除します.
+    //-------------------------------------------------------------------------
+    void Clear();
+
+    //-------------------------------------------------------------------------
+    //! @brief      メモリを予約します.
+    //!
+    //! @param[in]      count       ボリューム数です.
+    //-------------------------------------------------------------------------
+    void Reserve(uint32_t count);
+
+    //-------------------------------------------------------------------------
+    //! @brief      ボリュームを追加します.
+    //!
+    //! @param[in]      bounds      ワールド空間のバウンディングボリュームです.
+    //! @return     ボリューム番号を返却します.
+    //-------------------------------------------------------------------------
+    uint32_t Add(const MeshBounds& bounds);
+
+    //-------------------------------------------------------------------------
+    //! @brief      ボリュームを更新します.
+    //!
+    //! @param[in]      index       ボリューム番号です.
+    //! @param[in]      bounds      ワールド空間のバウンディングボリュームです.
+    //-------------------------------------------------------------------------
+    void Set(uint32_t index, const MeshBounds& bounds);
+
+    //-------------------------------------------------------------------------
+    //! @brief      可視のボリュームを求めます.
+    //!
+    //! @param[in]      viewProj    ビュー射影行列です.
+    //! @param[in]      pOcclusion  遮蔽判定に使うバッファです. nullptr の場合は視錐台だけで判定します.
+    //! @param[out]     visible     可視のボリューム番号の格納先です.
+    //! @return     可視のボリューム数を返却します.
+    //-------------------------------------------------------------------------
+    uint32_t Cull(
+        const DirectX::XMMATRIX&    viewProj,
+        const OcclusionBuffer*      pOcclusion,
+        std::vector<uint32_t>&      visible);
+
+    //-------------------------------------------------------------------------
+    //! @brief      ボリューム数を取得します.
+    //-------------------------------------------------------------------------
+    uint32_t GetCount() const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      直前の Cull() の統計を取得します.
+    //-------------------------------------------------------------------------
+    const CullingStats& GetStats() const;
+
+private:
+    //=========================================================================
+    // private variables.
+    //=========================================================================
+    std::vector<float>  m_CenterX;      //!< 中心の X 成分です.
+    std::vector<float>  m_CenterY;      //!< 中心の Y 成分です.
+    std::vector<float>  m_CenterZ;      //!< 中心の Z 成分です.
+    std::vector<float>  m_ExtentX;      //!< AABB の X 半径です.
+    std::vector<float>  m_ExtentY;      //!< AABB の Y 半径です.
+    std::vector<float>  m_ExtentZ;      //!< AABB の Z 半径です.
+    std::vector<float>  m_Radius;       //!< 境界球の半径です.
+    uint32_t            m_Count;        //!< ボリューム数です.
+    CullingStats        m_Stats;        //!< 統計です.
+
+    //=========================================================================
+    // private methods.
+    //=========================================================================
+    FrustumCuller   (const FrustumCuller&) = delete;    // アクセス禁止.
+    void operator = (const FrustumCuller&) = delete;    // アクセス禁止.
+};
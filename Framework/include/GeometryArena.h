@@ -0,0 +1,141 @@
+﻿//-----------------------------------------------------------------------------
+// File : GeometryArena.h
+// Desc : Merged Geometry Arena Module.
+// Copyright(c) Pocol. All right reserved.
+//-----------------------------------------------------------------------------
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <ResMesh.h>
+#include <VertexBuffer.h>
+#include <IndexBuffer.h>
+#include <cstdint>
+#include <vector>
+
+
+///////////////////////////////////////////////////////////////////////////////
+// GeometryArenaRange structure
+///////////////////////////////////////////////////////////////////////////////
+struct GeometryArenaRange
+{
+    uint32_t            BaseVertex;     //!< 結合した頂点バッファ内の先頭頂点番号です.
+    uint32_t            VertexCount;    //!< 頂点数です.
+    uint32_t            MaterialId;     //!< マテリアル番号です.
+    std::vector<ResLod> Lods;           //!< 詳細度です. 先頭は LOD0 で, オフセットは結合したインデックスバッファ内の位置です.
+};
+
+//-----------------------------------------------------------------------------
+//! @brief      メッシュの頂点とインデックスをそれぞれ1つの配列に結合します.
+//!
+//! @param[in]      meshes      メッシュです.
+//! @param[out]     vertices    結合した頂点の格納先です.
+//! @param[out]     indices     結合したインデックスの格納先です. 値はメッシュ内の頂点番号のままです.
+//! @param[out]     ranges      メッシュごとの範囲の格納先です. 要素番号がメッシュ番号になります.
+//! @retval true    結合に成功.
+//! @retval false   頂点数またはインデックス数が 32bit を超える.
+//! @note       メッシュごとに LOD0 の後ろに LOD1 以降のインデックスを並べます(Mesh と同じ並び).
+//!             描画時は BaseVertexLocation に GeometryArenaRange::BaseVertex を指定してください.
+//-----------------------------------------------------------------------------
+bool BuildGeometryArena(
+    const std::vector<ResMesh>&         meshes,
+    std::vector<MeshVertex>&            vertices,
+    std::vector<uint32_t>&              indices,
+    std::vector<GeometryArenaRange>&    ranges);
+
+///////////////////////////////////////////////////////////////////////////////
+// GeometryArena class
+///////////////////////////////////////////////////////////////////////////////
+//! @brief      全メッシュのジオメトリを1組の頂点・インデックスバッファにまとめます.
+//!
+//! @note       バッファの切り替えが無くなるので, ExecuteIndirect() の1回の呼び出しで全メッシュを描画できます.
+class GeometryArena
+{
+    //=========================================================================
+    // list of friend classes and methods.
+    //=========================================================================
+    /* NOTHING */
+
+public:
+    //=========================================================================
+    // public variables.
+    //=========================================================================
+    /* NOTHING */
+
+    //=========================================================================
+    // public methods.
+    //=========================================================================
+
+    //-------------------------------------------------------------------------
+    //! @brief      コンストラクタです.
+    //-------------------------------------------------------------------------
+    GeometryArena();
+
+    //-------------------------------------------------------------------------
+    //! @brief      デストラクタです.
+    //-------------------------------------------------------------------------
+    ~GeometryArena();
+
+    //-------------------------------------------------------------------------
+    //! @brief      初期化処理を行います.
+    //!
+    //! @param[in]      pDevice         デバイスです.
+    //! @param[in]      meshes          メッシュです. 要素番号がメッシュ番号になります.
+    //! @param[in]      packed          PackedVertex 形式で頂点バッファを作成する場合は true.
+    //! @retval true    初期化に成功.
+    //! @retval false   初期化に失敗.
+    //! @note       圧縮時の量子化パラメータはメッシュごとに ComputeQuantization() で求めるので,
+    //!             同じメッシュから作成した Mesh::GetQuantization() と一致します.
+    //-------------------------------------------------------------------------
+    bool Init(ID3D12Device* pDevice, const std::vector<ResMesh>& meshes, bool packed = false);
+
+    //-------------------------------------------------------------------------
+    //! @brief      終了処理を行います.
+    //-------------------------------------------------------------------------
+    void Term();
+
+    //-------------------------------------------------------------------------
+    //! @brief      頂点バッファとインデックスバッファを設定します.
+    //!
+    //! @param[in]      pCmdList        コマンドリストです.
+    //-------------------------------------------------------------------------
+    void Bind(ID3D12GraphicsCommandList* pCmdList) const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      メッシュごとの範囲を取得します.
+    //-------------------------------------------------------------------------
+    const std::vector<GeometryArenaRange>& GetRanges() const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      結合した頂点数を取得します.
+    //-------------------------------------------------------------------------
+    uint32_t GetVertexCount() const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      結合したインデックス数を取得します.
+    //-------------------------------------------------------------------------
+    uint32_t GetIndexCount() const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      頂点バッファが PackedVertex 形式かどうかを取得します.
+    //-------------------------------------------------------------------------
+    bool IsPacked() const;
+
+private:
+    //=========================================================================
+    // private variables.
+    //=========================================================================
+    VertexBuffer                    m_VB;           //!< 頂点バッファです.
+    IndexBuffer                     m_IB;           //!< インデックスバッファです.
+    std::vector<GeometryArenaRange> m_Ranges;       //!< メッシュごとの範囲です.
+    uint32_t                        m_VertexCount;  //!< 頂点数です.
+    uint32_t                        m_IndexCount;   //!< インデックス数です.
+    bool                            m_Packed;       //!< PackedVertex 形式かどうか.
+
+    //=========================================================================
+    // private methods.
+    //=========================================================================
+    GeometryArena   (const GeometryArena&) = delete;    // アクセス禁止.
+    void operator = (const GeometryArena&) = delete;    // アクセス禁止.
+};
@@ -0,0 +1,180 @@
+﻿//-----------------------------------------------------------------------------
+// File : IblBaker.h
+// Desc : Image Based Lighting Baker Module.
+// Copyright(c) Pocol. All right reserved.
+//-----------------------------------------------------------------------------
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <DirectXMath.h>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+
+///////////////////////////////////////////////////////////////////////////////
+// IblBakeDesc structure
+///////////////////////////////////////////////////////////////////////////////
+struct IblBakeDesc
+{
+    uint32_t    LutSize             = 128;  //!< BRDF LUT の1辺のテクセル数です.
+    uint32_t    LutSamples          = 512;  //!< BRDF LUT の1テクセルあたりのサンプル数です.
+    uint32_t    EnvironmentSize     = 128;  //!< 入力をキャプチャするキューブマップの1辺のテクセル数です(2のべき乗).
+    uint32_t    SpecularSize        = 128;  //!< 事前フィルタ済みキューブマップのミップ0の1辺のテクセル数です.
+    uint32_t    SpecularMipLevels   = 6;    //!< 事前フィルタ済みキューブマップのミップ数です. ミップ m のラフネスは m / (数 - 1).
+    uint32_t    SpecularSamples     = 256;  //!< 事前フィルタの1テクセルあたりのサンプル数です.
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// IblCubeMap structure
+///////////////////////////////////////////////////////////////////////////////
+struct IblCubeMap
+{
+    uint32_t                        Size;       //!< ミップ0の1辺のテクセル数です.
+    uint32_t                        MipLevels;  //!< ミップ数です.
+    std::vector<DirectX::XMFLOAT4>  Texels;     //!< テクセルです. DDS と同じく面ごとにミップ0から並べます.
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// IblSH9 structure
+///////////////////////////////////////////////////////////////////////////////
+struct IblSH9
+{
+    DirectX::XMFLOAT3   Coeffs[9];  //!< 余弦ローブで畳み込み済みの放射照度の球面調和係数です.
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// IblCachePaths structure
+///////////////////////////////////////////////////////////////////////////////
+struct IblCachePaths
+{
+    std::wstring    BrdfLut;        //!< BRDF LUT (R16G16_FLOAT) のパスです.
+    std::wstring    Specular;       //!< 事前フィルタ済みキューブマップ (R16G16B16A16_FLOAT) のパスです.
+    std::wstring    Irradiance;     //!< 放射照度の球面調和係数 (9x1 R32G32B32A32_FLOAT) のパスです.
+};
+
+//-----------------------------------------------------------------------------
+// Type Definitions
+//-----------------------------------------------------------------------------
+using IblSourceFunc = std::function<DirectX::XMFLOAT3(const DirectX::XMFLOAT3& dir)>;    //!< 方向から放射輝度を返す環境光源です.
+
+//-----------------------------------------------------------------------------
+//! @brief      キューブマップのテクセルの先頭位置を求めます.
+//!
+//! @param[in]      cube        キューブマップです.
+//! @param[in]      face        面番号(+X, -X, +Y, -Y, +Z, -Z の順)です.
+//! @param[in]      mip         ミップ番号です.
+//! @return     Texels 内の先頭位置を返却します.
+//-----------------------------------------------------------------------------
+size_t GetCubeMapOffset(const IblCubeMap& cube, uint32_t face, uint32_t mip);
+
+//-----------------------------------------------------------------------------
+//! @brief      キューブマップの面上の座標から方向を求めます.
+//!
+//! @param[in]      face        面番号です.
+//! @param[in]      u           面の横方向の座標です(範囲は[-1,1]).
+//! @param[in]      v           面の縦方向の座標です(範囲は[-1,1], 下向きが正).
+//! @return     正規化した方向を返却します. D3D のキューブマップと同じ向きです.
+//-----------------------------------------------------------------------------
+DirectX::XMFLOAT3 GetCubeMapDirection(uint32_t face, float u, float v);
+
+//-----------------------------------------------------------------------------
+//! @brief      キューブマップを方向でトライリニアサンプリングします.
+//!
+//! @param[in]      cube        キューブマップです.
+//! @param[in]      dir         方向です. 正規化されていなくても構いません.
+//! @param[in]      lod         ミップレベルです.
+//! @return     サンプリングした値を返却します. 面の境界はクランプします.
+//-----------------------------------------------------------------------------
+DirectX::XMFLOAT3 SampleCubeMap(const IblCubeMap& cube, const DirectX::XMFLOAT3& dir, float lod);
+
+//-----------------------------------------------------------------------------
+//! @brief      環境光源をキューブマップにキャプチャし, ボックスフィルタでミップを生成します.
+//!
+//! @param[in]      source      環境光源です. ワーカースレッドから呼ばれます.
+//! @param[in]      size        ミップ0の1辺のテクセル数です(2のべき乗).
+//! @param[out]     result      キューブマップの格納先です.
+//! @retval true    キャプチャに成功.
+//! @retval false   引数が不正.
+//-----------------------------------------------------------------------------
+bool CaptureEnvironment(const IblSourceFunc& source, uint32_t size, IblCubeMap& result);
+
+//-----------------------------------------------------------------------------
+//! @brief      スプリットサム近似の BRDF 積分テーブルを生成します.
+//!
+//! @param[in]      size        1辺のテクセル数です.
+//! @param[in]      sampleCount 1テクセルあたりの重点サンプル数です.
+//! @param[out]     result      size * size 個のテーブルの格納先です. x が F0 の係数, y がバイアスです.
+//! @retval true    生成に成功.
+//! @retval false   引数が不正.
+//! @note       横方向が N・V, 縦方向がラフネスです. D と G は BRDF.h の項を使います.
+//-----------------------------------------------------------------------------
+bool BakeBrdfLut(uint32_t size, uint32_t sampleCount, std::vector<DirectX::XMFLOAT2>& result);
+
+//-----------------------------------------------------------------------------
+//! @brief      GGX で事前フィルタしたキューブマップのミップチェインを生成します.
+//!
+//! @param[in]      environment CaptureEnvironment() で生成したキューブマップです.
+//! @param[in]      size        ミップ0の1辺のテクセル数です.
+//! @param[in]      mipLevels   ミップ数です. ミップ m のラフネスは m / (mipLevels - 1) です.
+//! @param[in]      sampleCount 1テクセルあたりの重点サンプル数です.
+//! @param[out]     result      キューブマップの格納先です.
+//! @retval true    生成に成功.
+//! @retval false   引数が不正.
+//! @note       サンプルの確率密度に応じて入力のミップを選ぶフィルタ付き重点サンプリングでノイズを抑えます.
+//-----------------------------------------------------------------------------
+bool PrefilterEnvironment(
+    const IblCubeMap&   environment,
+    uint32_t            size,
+    uint32_t            mipLevels,
+    uint32_t            sampleCount,
+    IblCubeMap&         result);
+
+//-----------------------------------------------------------------------------
+//! @brief      キューブマップを3次までの球面調和関数に射影し, 放射照度に変換します.
+//!
+//! @param[in]      environment CaptureEnvironment() で生成したキューブマップです.
+//! @param[out]     result      係数の格納先です.
+//! @retval true    射影に成功.
+//! @retval false   引数が不正.
+//-----------------------------------------------------------------------------
+bool ProjectIrradianceSH9(const IblCubeMap& environment, IblSH9& result);
+
+//-----------------------------------------------------------------------------
+//! @brief      球面調和係数から放射照度を求めます.
+//!
+//! @param[in]      sh          ProjectIrradianceSH9() で求めた係数です.
+//! @param[in]      normal      正規化した法線です.
+//! @return     放射照度を返却します. ランバート反射の放射輝度は albedo / π を掛けたものです.
+//-----------------------------------------------------------------------------
+DirectX::XMFLOAT3 EvaluateIrradianceSH9(const IblSH9& sh, const DirectX::XMFLOAT3& normal);
+
+//-----------------------------------------------------------------------------
+//! @brief      キャッシュファイルのパスを求めます.
+//!
+//! @param[in]      basePath    パスの先頭です.
+//! @param[in]      sourceKey   環境光源を識別する値です. 光源を変えた場合は別の値にします.
+//! @param[in]      desc        生成設定です.
+//! @return     設定ごとに異なるパスを返却します.
+//-----------------------------------------------------------------------------
+IblCachePaths GetIblCachePaths(const wchar_t* basePath, uint64_t sourceKey, const IblBakeDesc& desc);
+
+//-----------------------------------------------------------------------------
+//! @brief      IBL の各テクスチャを生成し, DDS ファイルとして保存します.
+//!
+//! @param[in]      source      環境光源です.
+//! @param[in]      desc        生成設定です.
+//! @param[in]      paths       保存先です.
+//! @param[in]      force       true の場合はキャッシュがあっても生成し直します.
+//! @retval true    全てのファイルが揃った.
+//! @retval false   生成か保存に失敗.
+//! @note       保存したファイルは Texture::Init() でそのままロードできます.
+//-----------------------------------------------------------------------------
+bool BakeIbl(
+    const IblSourceFunc&    source,
+    const IblBakeDesc&      desc,
+    const IblCachePaths&    paths,
+    bool                    force = false);
@@ -10,6 +10,7 @@
 //-----------------------------------------------------------------------------
 #include <d3d12.h>
 #include <ComPtr.h>
+#include <UploadAllocator.h>
 #include <cstdint>
 
 
@@ -49,10 +50,15 @@ public:
     //! @param[in]      pDevice         デバイスです.
     //! @param[in]      size            インデックスバッファサイズです.
     //! @param[in]      pInitData       初期化データです.
+    //! @param[in]      pAllocator      アップロードアロケータです. nullptr の場合は専用のリソースを生成します.
     //! @retval true    初期化に成功.
     //! @retval false   初期化に失敗.
     //-------------------------------------------------------------------------
-    bool Init(ID3D12Device* pDevice, size_t size, const uint32_t* pInitData = nullptr);
+    bool Init(
+        ID3D12Device*       pDevice,
+        size_t              size,
+        const uint32_t*     pInitData  = nullptr,
+        UploadAllocator*    pAllocator = nullptr);
 
     //-------------------------------------------------------------------------
     //! @brief      終了処理を行います.
@@ -85,12 +91,22 @@ public:
         return m_pIB;
     };
 
+    //-------------------------------------------------------------------------
+    //! @brief      リソース先頭からのオフセットを取得します.
+    //!
+    //! @return     アロケータから切り出した場合はページ内のオフセット, それ以外は 0 を返却します.
+    //-------------------------------------------------------------------------
+    uint64_t GetOffset() const
+    { return m_Allocation.Offset; }
+
 private:
     //=========================================================================
     // private variables.
     //=========================================================================
-    ComPtr<ID3D12Resource>      m_pIB;      //!< インデックスバッファです.
-    D3D12_INDEX_BUFFER_VIEW     m_View;     //!< インデックスバッファビューです.
+    ComPtr<ID3D12Resource>      m_pIB;          //!< インデックスバッファです.
+    D3D12_INDEX_BUFFER_VIEW     m_View;         //!< インデックスバッファビューです.
+    UploadAllocator*            m_pAllocator;   //!< アップロードアロケータです.
+    UploadAllocation            m_Allocation;   //!< アップロードアロケータからの割り当てです.
 
     //=========================================================================
     // private methods.
@@ -0,0 +1,94 @@
+﻿//-----------------------------------------------------------------------------
+// File : IndirectDraw.h
+// Desc : Indirect Draw Argument Module.
+// Copyright(c) Pocol. All right reserved.
+//-----------------------------------------------------------------------------
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <d3d12.h>
+#include <GeometryArena.h>
+#include <cstdint>
+#include <vector>
+
+
+///////////////////////////////////////////////////////////////////////////////
+// IndirectDrawArgs structure
+///////////////////////////////////////////////////////////////////////////////
+//! @brief      CreateIndirectDrawSignature() で生成したコマンドシグニチャの1ドロー分の引数です.
+struct IndirectDrawArgs
+{
+    D3D12_GPU_VIRTUAL_ADDRESS       Transform;      //!< 変換行列の定数バッファのアドレスです(ルートCBV).
+    uint32_t                        MaterialId;     //!< マテリアル番号です(ルート定数).
+    D3D12_DRAW_INDEXED_ARGUMENTS    Draw;           //!< ドローの引数です.
+};
+static_assert(sizeof(IndirectDrawArgs) == 32, "IndirectDrawArgs layout mismatch.");
+
+///////////////////////////////////////////////////////////////////////////////
+// IndirectDrawItem structure
+///////////////////////////////////////////////////////////////////////////////
+struct IndirectDrawItem
+{
+    uint32_t                    Mesh;           //!< メッシュ番号です.
+    uint32_t                    Lod;            //!< 詳細度です. 範囲外の場合は最も粗いレベルを描画します.
+    D3D12_GPU_VIRTUAL_ADDRESS   Transform;      //!< 変換行列の定数バッファのアドレスです.
+};
+
+//-----------------------------------------------------------------------------
+//! @brief      ドローの引数を詰めます.
+//!
+//! @param[in]      ranges          GeometryArena のメッシュごとの範囲です.
+//! @param[in]      pItems          描画するインスタンスです.
+//! @param[in]      count           インスタンス数です.
+//! @param[in]      materialCount   マテリアル数です. 範囲外のマテリアル番号は 0 にします.
+//! @param[out]     result          引数の格納先です.
+//! @return     詰めた三角形数を返却します.
+//! @note       範囲外のメッシュ番号と空の詳細度は詰めないので, result の要素数は count 以下になります.
+//!             Mesh::Draw() と同じ範囲を描画するので, 結果を比べれば GPU 無しで確認できます.
+//-----------------------------------------------------------------------------
+uint32_t BuildIndirectDrawArgs(
+    const std::vector<GeometryArenaRange>&  ranges,
+    const IndirectDrawItem*                 pItems,
+    size_t                                  count,
+    uint32_t                                materialCount,
+    std::vector<IndirectDrawArgs>&          result);
+
+//-----------------------------------------------------------------------------
+//! @brief      ドローの引数が結合したバッファの範囲内を指しているかチェックします.
+//!
+//! @param[in]      pArgs           引数です.
+//! @param[in]      count           引数の数です.
+//! @param[in]      pIndices        結合したインデックスです. nullptr の場合は頂点番号の範囲をチェックしません.
+//! @param[in]      indexCount      結合したインデックス数です.
+//! @param[in]      vertexCount     結合した頂点数です.
+//! @param[in]      materialCount   マテリアル数です.
+//! @retval true    すべての引数が有効.
+//! @retval false   範囲外を指す引数がある.
+//-----------------------------------------------------------------------------
+bool ValidateIndirectDrawArgs(
+    const IndirectDrawArgs* pArgs,
+    size_t                  count,
+    const uint32_t*         pIndices,
+    uint32_t                indexCount,
+    uint32_t                vertexCount,
+    uint32_t                materialCount);
+
+//-----------------------------------------------------------------------------
+//! @brief      IndirectDrawArgs を解釈するコマンドシグニチャを生成します.
+//!
+//! @param[in]      pDevice         デバイスです.
+//! @param[in]      pRootSig        ルートシグニチャです.
+//! @param[in]      transformParam  変換行列のルートCBVのパラメータ番号です.
+//! @param[in]      materialParam   マテリアル番号のルート定数のパラメータ番号です.
+//! @param[out]     ppSignature     コマンドシグニチャの格納先です.
+//! @retval true    生成に成功.
+//! @retval false   生成に失敗.
+//-----------------------------------------------------------------------------
+bool CreateIndirectDrawSignature(
+    ID3D12Device*               pDevice,
+    ID3D12RootSignature*        pRootSig,
+    uint32_t                    transformParam,
+    uint32_t                    materialParam,
+    ID3D12CommandSignature**    ppSignature);
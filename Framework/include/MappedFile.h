@@ -0,0 +1,95 @@
+﻿//-----------------------------------------------------------------------------
+// File : MappedFile.h
+// Desc : Memory Mapped File Module.
+// Copyright(c) Pocol. All right reserved.
+//-----------------------------------------------------------------------------
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <Windows.h>
+#include <cstdint>
+
+
+///////////////////////////////////////////////////////////////////////////////
+// MappedFile class
+///////////////////////////////////////////////////////////////////////////////
+class MappedFile
+{
+    //=========================================================================
+    // list of friend classes and methods.
+    //=========================================================================
+    /* NOTHING */
+
+public:
+    //=========================================================================
+    // public variables.
+    //=========================================================================
+    /* NOTHING */
+
+    //=========================================================================
+    // public methods.
+    //=========================================================================
+
+    //-------------------------------------------------------------------------
+    //! @brief      コンストラクタです.
+    //-------------------------------------------------------------------------
+    MappedFile();
+
+    //-------------------------------------------------------------------------
+    //! @brief      デストラクタです.
+    //-------------------------------------------------------------------------
+    ~MappedFile();
+
+    //-------------------------------------------------------------------------
+    //! @brief      ファイルを読み取り専用でメモリマッピングします.
+    //!
+    //! @param[in]      filename        ファイルパスです.
+    //! @retval true    マッピングに成功.
+    //! @retval false   マッピングに失敗.
+    //-------------------------------------------------------------------------
+    bool Open(const wchar_t* filename);
+
+    //-------------------------------------------------------------------------
+    //! @brief      マッピングを解除してファイルを閉じます.
+    //-------------------------------------------------------------------------
+    void Close();
+
+    //-------------------------------------------------------------------------
+    //! @brief      マッピング済みの先頭ポインタを取得します.
+    //!
+    //! @return     マッピング済みの先頭ポインタを返却します.
+    //-------------------------------------------------------------------------
+    const uint8_t* GetData() const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      ファイルサイズを取得します.
+    //!
+    //! @return     ファイルサイズを返却します.
+    //-------------------------------------------------------------------------
+    uint64_t GetSize() const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      ファイルがマッピング済みかどうかチェックします.
+    //!
+    //! @retval true    マッピング済み.
+    //! @retval false   未マッピング.
+    //-------------------------------------------------------------------------
+    bool IsOpen() const;
+
+private:
+    //=========================================================================
+    // private variables.
+    //=========================================================================
+    HANDLE          m_File;         //!< ファイルハンドルです.
+    HANDLE          m_Mapping;      //!< ファイルマッピングハンドルです.
+    const uint8_t*  m_pData;        //!< マッピング済みポインタです.
+    uint64_t        m_Size;         //!< ファイルサイズです.
+
+    //=========================================================================
+    // private methods.
+    //=========================================================================
+    MappedFile      (const MappedFile&) = delete;   // アクセス禁止.
+    void operator = (const MappedFile&) = delete;   // アクセス禁止.
+};
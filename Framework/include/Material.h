@@ -12,7 +12,10 @@
 #include <ResourceUploadBatch.h>
 #include <Texture.h>
 #include <ConstantBuffer.h>
+#include <MaterialTable.h>
+#include <TextureStreamer.h>
 #include <map>
+#include <vector>
 
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -37,8 +40,9 @@ public:
         TEXTURE_USAGE_NORMAL,       //!< 法線マップとして利用します.
 
         TEXTURE_USAGE_BASE_COLOR,   //!< ベースカラーマップとして利用します.
-        TEXTURE_USAGE_METALLIC,     //!< メタリックマップとして利用します.
-        TEXTURE_USAGE_ROUGHNESS,    //!< ラフネスマップとして利用します.
+        TEXTURE_USAGE_METALLIC,     //!< メタリックマップとして利用します. マテリアルテーブルには含まれないので ORM に詰めて使います.
+        TEXTURE_USAGE_ROUGHNESS,    //!< ラフネスマップとして利用します. マテリアルテーブルには含まれないので ORM に詰めて使います.
+        TEXTURE_USAGE_ORM,          //!< PrepareOrmTexture() で詰めたオクルージョン・ラフネス・メタリックマップとして利用します.
 
         TEXTURE_USAGE_COUNT
     };
@@ -69,14 +73,16 @@ public:
     //! @param[in]      pPool           ディスクリプタプールです(CBV_UAV_SRV用のものを設定します).
     //! @param[in]      bufferSize      1マテリアルあたりの定数バッファのサイズです.
     //! @param[in]      count           マテリアル数です.
+    //! @param[in]      pAllocator      定数バッファを切り出すアップロードアロケータです. nullptr の場合はサブセットごとにリソースを生成します.
     //! @retval true    初期化に成功.
     //! @retval false   初期化に失敗.
     //-------------------------------------------------------------------------
     bool Init(
-        ID3D12Device*   pDevice,
-        DescriptorPool* pPool,
-        size_t          bufferSize,
-        size_t          count);
+        ID3D12Device*       pDevice,
+        DescriptorPool*     pPool,
+        size_t              bufferSize,
+        size_t              count,
+        UploadAllocator*    pAllocator = nullptr);
 
     //-------------------------------------------------------------------------
     //! @brief      終了処理を行います.
@@ -92,6 +98,8 @@ public:
     //! @param[out]     batch       リソースアップロードバッチです.
     //! @retval true    設定に成功.
     //! @retval false   設定に失敗.
+    //! @note       ブロック圧縮は行わず, 作成済みのキャッシュがある場合だけ使います.
+    //!             圧縮が必要な場合は SetTextureAsync() を使うか, 事前に PrepareCompressedTexture() を呼び出します.
     //-------------------------------------------------------------------------
     bool SetTexture(
         size_t                          index,
@@ -99,6 +107,89 @@ public:
         const std::wstring&             path,
         DirectX::ResourceUploadBatch&   batch);
 
+    //-------------------------------------------------------------------------
+    //! @brief      テクスチャの非同期ロードを要求します.
+    //!
+    //! @param[in]      index       マテリアル番号です.
+    //! @param[in]      usage       テクスチャの使用用途です.
+    //! @param[in]      path        テクスチャパスです.
+    //! @retval true    要求に成功.
+    //! @retval false   要求に失敗.
+    //! @note       実際のロードは CommitTextures() でまとめて行われます.
+    //!             ロード済みまたは要求済みのテクスチャは共有されます.
+    //-------------------------------------------------------------------------
+    bool SetTextureAsync(
+        size_t                          index,
+        TEXTURE_USAGE                   usage,
+        const std::wstring&             path);
+
+    //-------------------------------------------------------------------------
+    //! @brief      要求済みのテクスチャをワーカースレッドでロードし, アップロードバッチに積みます.
+    //!
+    //! @param[out]     batch       リソースアップロードバッチです.
+    //! @retval true    全てのテクスチャのロードに成功.
+    //! @retval false   ロードに失敗したテクスチャがある(ダミーテクスチャが設定されます).
+    //! @note       非圧縮のテクスチャのブロック圧縮もワーカースレッドで行います.
+    //!             SetTextureStreamed() で要求したテクスチャのストリーマーへの登録もここで行います.
+    //-------------------------------------------------------------------------
+    bool CommitTextures(DirectX::ResourceUploadBatch& batch);
+
+    //-------------------------------------------------------------------------
+    //! @brief      テクスチャをストリーミングで設定します.
+    //!
+    //! @param[in]      index       マテリアル番号です.
+    //! @param[in]      usage       テクスチャの使用用途です.
+    //! @param[in]      path        テクスチャパスです.
+    //! @param[in]      pStreamer   テクスチャストリーマーです. 全てのテクスチャで同じものを指定します.
+    //! @retval true    要求に成功.
+    //! @retval false   要求に失敗.
+    //! @note       ストリーマーへの登録は CommitTextures() でまとめて行われ, それまではダミーテクスチャが設定されます.
+    //!             登録時は末尾ミップだけが常駐します. RequestTextures() で必要なミップを要求し,
+    //!             TextureStreamer::Update() で変化があった場合は RefreshStreamedTextures() を呼び出します.
+    //-------------------------------------------------------------------------
+    bool SetTextureStreamed(
+        size_t                          index,
+        TEXTURE_USAGE                   usage,
+        const std::wstring&             path,
+        TextureStreamer*                pStreamer);
+
+    //-------------------------------------------------------------------------
+    //! @brief      ストリーミングテクスチャのミップを要求します.
+    //!
+    //! @param[in]      index       マテリアル番号です.
+    //! @param[in]      screenSize  マテリアルを使うメッシュの画面上の大きさ(ピクセル)です.
+    //-------------------------------------------------------------------------
+    void RequestTextures(size_t index, float screenSize);
+
+    //-------------------------------------------------------------------------
+    //! @brief      ストリーミングテクスチャのハンドルを更新し, マテリアルテーブルを再構築します.
+    //!
+    //! @retval true    再構築に成功.
+    //! @retval false   再構築に失敗.
+    //-------------------------------------------------------------------------
+    bool RefreshStreamedTextures();
+
+    //-------------------------------------------------------------------------
+    //! @brief      マテリアルパラメータを設定します.
+    //!
+    //! @param[in]      index       マテリアル番号です.
+    //! @param[in]      param       マテリアルパラメータです.
+    //! @note       シェーダに反映するには CommitTable() を呼び出します.
+    //-------------------------------------------------------------------------
+    void SetParam(size_t index, const MaterialParam& param);
+
+    //-------------------------------------------------------------------------
+    //! @brief      マテリアルテーブルを構築します.
+    //!
+    //! @retval true    構築に成功.
+    //! @retval false   構築に失敗.
+    //! @note       テクスチャはディスクリプタヒープ先頭からの番号で格納されるので, シェーダは
+    //!             ヒープ先頭を起点とした1つのテーブルとマテリアル番号だけで全てのマテリアルを参照できます.
+    //!             テーブルは Init() に渡したアップロードアロケータから確保するので, アロケータが必要です.
+    //!             再構築した場合, 古いテーブルは現在のフレームの完了後に回収されます.
+    //-------------------------------------------------------------------------
+    bool CommitTable();
+
     //-------------------------------------------------------------------------
     //! @brief      定数バッファのポインタを取得します.
     //!
@@ -136,6 +227,14 @@ public:
     //-------------------------------------------------------------------------
     D3D12_GPU_DESCRIPTOR_HANDLE GetTextureHandle(size_t index, TEXTURE_USAGE usage) const;
 
+    //-------------------------------------------------------------------------
+    //! @brief      マテリアルテーブルのGPU仮想アドレスを取得します.
+    //!
+    //! @return     StructuredBuffer<MaterialEntry> として参照するGPU仮想アドレスを返却します.
+    //!             CommitTable() を呼び出していない場合は 0 を返却します.
+    //-------------------------------------------------------------------------
+    D3D12_GPU_VIRTUAL_ADDRESS GetTableAddress() const;
+
     //-------------------------------------------------------------------------
     //! @brief      マテリアル数を取得します.
     //!
@@ -151,21 +250,57 @@ private:
     {
         ConstantBuffer*                 pCostantBuffer;                     //!< 定数バッファです.
         D3D12_GPU_DESCRIPTOR_HANDLE     TextureHandle[TEXTURE_USAGE_COUNT]; //!< テクスチャハンドルです.
+        uint32_t                        StreamId[TEXTURE_USAGE_COUNT];      //!< ストリーミングテクスチャの番号です.
+        MaterialParam                   Param;                              //!< マテリアルパラメータです.
+    };
+
+    ///////////////////////////////////////////////////////////////////////////
+    // TextureTarget structure
+    ///////////////////////////////////////////////////////////////////////////
+    struct TextureTarget
+    {
+        size_t          Index;      //!< マテリアル番号です.
+        TEXTURE_USAGE   Usage;      //!< テクスチャの使用用途です.
+    };
+
+    ///////////////////////////////////////////////////////////////////////////
+    // TextureRequest structure
+    ///////////////////////////////////////////////////////////////////////////
+    struct TextureRequest
+    {
+        std::wstring                FindPath;   //!< 検索済みのファイルパスです.
+        TEXTURE_USAGE               Usage;      //!< ブロック圧縮の種類を決める使用用途です.
+        bool                        IsSRGB;     //!< sRGBフォーマットでロードするかどうか.
+        std::vector<TextureTarget>  Targets;    //!< ロード後にハンドルを設定する対象です.
     };
 
     //=========================================================================
     // private variables.
     //=========================================================================
-    std::map<std::wstring, Texture*>    m_pTexture;     //!< テクスチャです.
-    std::vector<Subset>                 m_Subset;       //!< サブセットです.
-    ID3D12Device*                       m_pDevice;      //!< デバイスです.
-    DescriptorPool*                     m_pPool;        //!< ディスクリプタプールです(CBV_UAV_SRV).
+    std::map<std::wstring, Texture*>        m_pTexture;     //!< テクスチャです.
+    std::map<std::wstring, TextureRequest>  m_Request;      //!< ロード待ちのテクスチャです.
+    std::map<std::wstring, TextureRequest>  m_StreamReq;    //!< 登録待ちのストリーミングテクスチャです.
+    std::map<std::wstring, uint32_t>        m_Streamed;     //!< ストリーミングテクスチャの番号です.
+    std::vector<Subset>                     m_Subset;       //!< サブセットです.
+    ID3D12Device*                           m_pDevice;      //!< デバイスです.
+    DescriptorPool*                         m_pPool;        //!< ディスクリプタプールです(CBV_UAV_SRV).
+    UploadAllocator*                        m_pAllocator;   //!< アップロードアロケータです.
+    UploadAllocation                        m_Table;        //!< マテリアルテーブルです.
+    TextureStreamer*                        m_pStreamer;    //!< テクスチャストリーマーです.
 
     //=========================================================================
     // private methods.
     //=========================================================================
     Material        (const Material&) = delete;
     void operator = (const Material&) = delete;
+
+    //-------------------------------------------------------------------------
+    //! @brief      要求済みのストリーミングテクスチャをストリーマーに登録します.
+    //!
+    //! @retval true    全てのテクスチャの登録に成功.
+    //! @retval false   登録に失敗したテクスチャがある(ダミーテクスチャのままになります).
+    //-------------------------------------------------------------------------
+    bool CommitStreamedTextures();
 };
 
 constexpr auto TU_DIFFUSE    = Material::TEXTURE_USAGE_DIFFUSE;
@@ -175,4 +310,5 @@ constexpr auto TU_NORMAL     = Material::TEXTURE_USAGE_NORMAL;
 
 constexpr auto TU_BASE_COLOR = Material::TEXTURE_USAGE_BASE_COLOR;
 constexpr auto TU_METALLIC = Material::TEXTURE_USAGE_METALLIC;
-constexpr auto TU_ROUGHNESS = Material::TEXTURE_USAGE_ROUGHNESS;
\ No newline at end of file
+constexpr auto TU_ROUGHNESS = Material::TEXTURE_USAGE_ROUGHNESS;
+constexpr auto TU_ORM = Material::TEXTURE_USAGE_ORM;
\ No newline at end of file
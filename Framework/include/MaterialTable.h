@@ -0,0 +1,93 @@
+﻿//-----------------------------------------------------------------------------
+// File : MaterialTable.h
+// Desc : Bindless Material Table Module.
+// Copyright(c) Pocol. All right reserved.
+//-----------------------------------------------------------------------------
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <DirectXMath.h>
+#include <cstdint>
+#include <vector>
+
+
+//-----------------------------------------------------------------------------
+// Constant Values
+//-----------------------------------------------------------------------------
+constexpr uint32_t InvalidTextureIndex = UINT32_MAX;   //!< テクスチャが未設定であることを表す番号です.
+
+///////////////////////////////////////////////////////////////////////////////
+// MATERIAL_MAP enum
+///////////////////////////////////////////////////////////////////////////////
+enum MATERIAL_MAP
+{
+    MATERIAL_MAP_BASE_COLOR = 0,    //!< ベースカラーマップです.
+    MATERIAL_MAP_NORMAL,            //!< 法線マップです.
+    MATERIAL_MAP_ORM,               //!< オクルージョン(R)・ラフネス(G)・メタリック(B)を詰めたマップです.
+
+    MATERIAL_MAP_COUNT
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// MaterialParam structure
+///////////////////////////////////////////////////////////////////////////////
+struct MaterialParam
+{
+    DirectX::XMFLOAT3   BaseColor   = DirectX::XMFLOAT3(1.0f, 1.0f, 1.0f);  //!< ベースカラーマップに乗算する色です.
+    float               Alpha       = 1.0f;     //!< 透過度です.
+    float               Roughness   = 1.0f;     //!< ラフネスマップに乗算する係数です(範囲は[0,1]).
+    float               Metallic    = 1.0f;     //!< メタリックマップに乗算する係数です(範囲は[0,1]).
+    float               Occlusion   = 1.0f;     //!< オクルージョンマップを適用する強さです(範囲は[0,1]).
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// MaterialEntry structure
+///////////////////////////////////////////////////////////////////////////////
+//! @brief      シェーダの StructuredBuffer<MaterialEntry> と同じレイアウトです.
+//!             GGXPS.hlsl の MaterialEntry を変更した場合は合わせて更新すること.
+struct MaterialEntry
+{
+    DirectX::XMFLOAT3   BaseColor;                  //!< ベースカラーです.
+    float               Alpha;                      //!< 透過度です.
+    float               Roughness;                  //!< ラフネス係数です.
+    float               Metallic;                   //!< メタリック係数です.
+    float               Occlusion;                  //!< オクルージョンの強さです.
+    uint32_t            Maps[MATERIAL_MAP_COUNT];   //!< ディスクリプタヒープ先頭からのテクスチャ番号です.
+    uint32_t            Reserved[2];                //!< 予約領域です.
+};
+static_assert(sizeof(MaterialEntry) == 48, "MaterialEntry layout mismatch.");
+
+//-----------------------------------------------------------------------------
+//! @brief      1マテリアル分のエントリを詰めます.
+//!
+//! @param[in]      param       マテリアルパラメータです.
+//! @param[in]      pMaps       MATERIAL_MAP_COUNT 個のテクスチャ番号です. 未設定の場合は InvalidTextureIndex.
+//! @param[in]      fallback    未設定または範囲外の番号の代わりに使うテクスチャ番号です.
+//! @param[in]      limit       テクスチャ番号の上限(ディスクリプタ数)です.
+//! @return     詰めたエントリを返却します. 係数は [0,1] に丸めます.
+//-----------------------------------------------------------------------------
+MaterialEntry PackMaterialEntry(
+    const MaterialParam&    param,
+    const uint32_t*         pMaps,
+    uint32_t                fallback,
+    uint32_t                limit);
+
+//-----------------------------------------------------------------------------
+//! @brief      マテリアルテーブルを詰めます.
+//!
+//! @param[in]      params      マテリアルパラメータです.
+//! @param[in]      maps        テクスチャ番号です. マテリアルごとに MATERIAL_MAP_COUNT 個並べます.
+//! @param[in]      fallback    未設定または範囲外の番号の代わりに使うテクスチャ番号です.
+//! @param[in]      limit       テクスチャ番号の上限(ディスクリプタ数)です.
+//! @param[out]     result      テーブルの格納先です. 要素番号がマテリアル番号になります.
+//! @retval true    詰めるのに成功.
+//! @retval false   要素数が一致しないか fallback が範囲外.
+//-----------------------------------------------------------------------------
+bool PackMaterialTable(
+    const std::vector<MaterialParam>&   params,
+    const std::vector<uint32_t>&        maps,
+    uint32_t                            fallback,
+    uint32_t                            limit,
+    std::vector<MaterialEntry>&         result);
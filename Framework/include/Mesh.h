@@ -9,8 +9,10 @@
 // Includes
 //-----------------------------------------------------------------------------
 #include <ResMesh.h>
+#include <PackedVertex.h>
 #include <VertexBuffer.h>
 #include <IndexBuffer.h>
+#include <MeshBounds.h>
 
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -48,10 +50,16 @@ public:
     //!
     //! @param[in]      pDevice         デバイスです.
     //! @param[in]      resource        リソースメッシュです.
+    //! @param[in]      packed          PackedVertex 形式で頂点バッファを作成する場合は true.
+    //! @param[in]      pAllocator      アップロードアロケータです. nullptr の場合は専用のリソースを生成します.
     //! @retval true    初期化に成功.
     //! @retval false   初期化に失敗.
     //-------------------------------------------------------------------------
-    bool Init(ID3D12Device* pDevice, const ResMesh& resource);
+    bool Init(
+        ID3D12Device*       pDevice,
+        const ResMesh&      resource,
+        bool                packed     = false,
+        UploadAllocator*    pAllocator = nullptr);
 
     //-------------------------------------------------------------------------
     //! @brief      終了処理を行います.
@@ -62,8 +70,28 @@ public:
     //! @brief      描画処理を行います.
     //!
     //! @param[in]      pCmdList        コマンドリストです.
+    //! @param[in]      lod             描画する詳細度です. 範囲外の場合は最も粗いレベルを描画します.
     //-------------------------------------------------------------------------
-    void Draw(ID3D12GraphicsCommandList* pCmdList);
+    void Draw(ID3D12GraphicsCommandList* pCmdList, uint32_t lod = 0);
+
+    //-------------------------------------------------------------------------
+    //! @brief      投影後の誤差が閾値以下になる最も粗い詳細度を選択します.
+    //!
+    //! @param[in]      pixelsPerUnit   メッシュの位置でローカル空間の単位長さが画面上で何ピクセルになるかです.
+    //! @param[in]      threshold       許容する誤差のピクセル数です.
+    //! @return     詳細度を返却します. LOD が無い場合は 0 を返却します.
+    //-------------------------------------------------------------------------
+    uint32_t SelectLod(float pixelsPerUnit, float threshold) const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      詳細度の数を取得します. LOD0 を含みます.
+    //-------------------------------------------------------------------------
+    uint32_t GetLodCount() const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      詳細度のインデックス数を取得します.
+    //-------------------------------------------------------------------------
+    uint32_t GetLodIndexCount(uint32_t lod) const;
 
     //-------------------------------------------------------------------------
     //! @brief      マテリアルIDを取得します.
@@ -108,6 +136,28 @@ public:
         return m_VertexCount;
     };
 
+    //-------------------------------------------------------------------------
+    //! @brief      頂点バッファが PackedVertex 形式かどうかを取得します.
+    //!
+    //! @retval true    PackedVertex 形式.
+    //! @retval false   MeshVertex 形式.
+    //-------------------------------------------------------------------------
+    bool IsPacked() const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      位置の復元パラメータを取得します.
+    //!
+    //! @return     PackedVertex 形式の場合の復元パラメータを返却します.
+    //-------------------------------------------------------------------------
+    const PackedVertexQuantization& GetQuantization() const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      ローカル空間のバウンディングボリュームを取得します.
+    //!
+    //! @return     ロード時に頂点から求めたバウンディングボリュームを返却します.
+    //-------------------------------------------------------------------------
+    const MeshBounds& GetBounds() const;
+
 
 
 private:
@@ -119,6 +169,10 @@ private:
     uint32_t        m_MaterialId;       //!< マテリアルIDです.
     uint32_t        m_IndexCount;       //!< インデックス数です.
     uint32_t        m_VertexCount;        //!< 頂点数です.
+    bool            m_Packed;           //!< PackedVertex 形式かどうか.
+    PackedVertexQuantization m_Quantization;    //!< 位置の復元パラメータです.
+    MeshBounds      m_Bounds;           //!< ローカル空間のバウンディングボリュームです.
+    std::vector<ResLod> m_Lods;         //!< 詳細度です. 先頭は LOD0 で, オフセットはインデックスバッファ内の位置です.
 
     //=========================================================================
     // private methods.
@@ -0,0 +1,58 @@
+﻿//-----------------------------------------------------------------------------
+// File : MeshBounds.h
+// Desc : Mesh Bounding Volume Module.
+// Copyright(c) Pocol. All right reserved.
+//-----------------------------------------------------------------------------
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <DirectXMath.h>
+#include <cstddef>
+#include <cstdint>
+
+
+///////////////////////////////////////////////////////////////////////////////
+// MeshBounds structure
+///////////////////////////////////////////////////////////////////////////////
+struct MeshBounds
+{
+    DirectX::XMFLOAT3   Center;     //!< AABB の中心です. 境界球の中心も兼ねます.
+    float               Radius;     //!< 境界球の半径です.
+    DirectX::XMFLOAT3   Extent;     //!< AABB の各軸の半径です.
+};
+
+//-----------------------------------------------------------------------------
+//! @brief      頂点位置からバウンディングボックスと境界球を求めます.
+//!
+//! @param[in]      pPositions  先頭の頂点位置です.
+//! @param[in]      count       頂点数です.
+//! @param[in]      stride      頂点間のバイト数です.
+//! @return     バウンディングボリュームを返却します. 頂点が無い場合は半径 0 を返却します.
+//-----------------------------------------------------------------------------
+MeshBounds ComputeMeshBounds(const DirectX::XMFLOAT3* pPositions, size_t count, size_t stride);
+
+//-----------------------------------------------------------------------------
+//! @brief      インデックスで参照される頂点からバウンディングボリュームを求めます.
+//!
+//! @param[in]      pPositions  先頭の頂点位置です.
+//! @param[in]      stride      頂点間のバイト数です.
+//! @param[in]      pIndices    頂点インデックスです.
+//! @param[in]      indexCount  インデックス数です.
+//! @return     バウンディングボリュームを返却します.
+//-----------------------------------------------------------------------------
+MeshBounds ComputeMeshBounds(
+    const DirectX::XMFLOAT3*    pPositions,
+    size_t                      stride,
+    const uint32_t*             pIndices,
+    size_t                      indexCount);
+
+//-----------------------------------------------------------------------------
+//! @brief      バウンディングボリュームを行列で変換します.
+//!
+//! @param[in]      bounds      ローカル空間のバウンディングボリュームです.
+//! @param[in]      transform   変換行列です.
+//! @return     変換後の空間で元のボリュームを包むバウンディングボリュームを返却します.
+//-----------------------------------------------------------------------------
+MeshBounds TransformMeshBounds(const MeshBounds& bounds, const DirectX::XMMATRIX& transform);
@@ -0,0 +1,87 @@
+﻿//-----------------------------------------------------------------------------
+// File : MeshCache.h
+// Desc : Binary Mesh Cache Module.
+// Copyright(c) Pocol. All right reserved.
+//-----------------------------------------------------------------------------
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <ResMesh.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+///////////////////////////////////////////////////////////////////////////////
+// MeshCacheKey structure
+///////////////////////////////////////////////////////////////////////////////
+struct MeshCacheKey
+{
+    std::wstring    SourcePath;     //!< ソースファイルのフルパスです.
+    uint64_t        SourceTime;     //!< ソースファイルの最終更新時刻です.
+    uint64_t        SourceSize;     //!< ソースファイルのサイズです.
+    uint32_t        ImportFlags;    //!< インポート時のポストプロセスフラグです.
+    uint32_t        Options;        //!< ロード後に適用した処理のフラグです.
+};
+
+//-----------------------------------------------------------------------------
+//! @brief      キャッシュキーを取得します.
+//!
+//! @param[in]      filename        ソースファイルパスです.
+//! @param[in]      importFlags     インポート時のポストプロセスフラグです.
+//! @param[in]      options         ロード後に適用する処理のフラグです.
+//! @param[out]     key             キャッシュキーの格納先です.
+//! @retval true    取得に成功.
+//! @retval false   取得に失敗.
+//-----------------------------------------------------------------------------
+bool GetMeshCacheKey(
+    const wchar_t*  filename,
+    uint32_t        importFlags,
+    uint32_t        options,
+    MeshCacheKey&   key);
+
+//-----------------------------------------------------------------------------
+//! @brief      ソースファイルに対応するキャッシュファイルパスを取得します.
+//!
+//! @param[in]      filename        ソースファイルパスです.
+//! @return     キャッシュファイルパスを返却します.
+//-----------------------------------------------------------------------------
+std::wstring GetMeshCachePath(const wchar_t* filename);
+
+//-----------------------------------------------------------------------------
+//! @brief      キャッシュファイルからメッシュをロードします.
+//!
+//! @param[in]      cachePath       キャッシュファイルパスです.
+//! @param[in]      key             期待するキャッシュキーです.
+//! @param[out]     meshes          メッシュの格納先です.
+//! @param[out]     materials       マテリアルの格納先です.
+//! @param[out]     nodes           ノードの格納先です.
+//! @retval true    ロードに成功.
+//! @retval false   キャッシュが存在しないか, 古いか, 壊れている.
+//-----------------------------------------------------------------------------
+bool LoadMeshCache(
+    const wchar_t*              cachePath,
+    const MeshCacheKey&         key,
+    std::vector<ResMesh>&       meshes,
+    std::vector<ResMaterial>&   materials,
+    std::vector<ResNode>&       nodes);
+
+//-----------------------------------------------------------------------------
+//! @brief      メッシュをキャッシュファイルに保存します.
+//!
+//! @param[in]      cachePath       キャッシュファイルパスです.
+//! @param[in]      key             キャッシュキーです.
+//! @param[in]      meshes          保存するメッシュです.
+//! @param[in]      materials       保存するマテリアルです.
+//! @param[in]      nodes           保存するノードです.
+//! @retval true    保存に成功.
+//! @retval false   保存に失敗.
+//-----------------------------------------------------------------------------
+bool SaveMeshCache(
+    const wchar_t*                  cachePath,
+    const MeshCacheKey&             key,
+    const std::vector<ResMesh>&     meshes,
+    const std::vector<ResMaterial>& materials,
+    const std::vector<ResNode>&     nodes);
@@ -0,0 +1,101 @@
+﻿//-----------------------------------------------------------------------------
+// File : MeshOptimizer.h
+// Desc : Mesh Optimization Module.
+// Copyright(c) Pocol. All right reserved.
+//-----------------------------------------------------------------------------
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <ResMesh.h>
+#include <cstdint>
+#include <vector>
+
+
+///////////////////////////////////////////////////////////////////////////////
+// MeshOptimizeDesc structure
+///////////////////////////////////////////////////////////////////////////////
+struct MeshOptimizeDesc
+{
+    uint32_t    CacheSize           = 16;       //!< 想定する頂点キャッシュのサイズです(FIFO).
+    float       OverdrawThreshold   = 1.05f;    //!< オーバードロー最適化で許容する ACMR の悪化率です.
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// MeshOptimizeStats structure
+///////////////////////////////////////////////////////////////////////////////
+struct MeshOptimizeStats
+{
+    float   ACMRBefore;     //!< 最適化前の ACMR (三角形あたりのキャッシュミス数) です.
+    float   ACMRAfter;      //!< 最適化後の ACMR です.
+    float   ATVRBefore;     //!< 最適化前の ATVR (頂点あたりのキャッシュミス数) です.
+    float   ATVRAfter;      //!< 最適化後の ATVR です.
+};
+
+//-----------------------------------------------------------------------------
+//! @brief      ACMR (Average Cache Miss Ratio) を求めます.
+//!
+//! @param[in]      indices         頂点インデックスです.
+//! @param[in]      cacheSize       頂点キャッシュのサイズです.
+//! @return     三角形あたりのキャッシュミス数を返却します. 理想値は 0.5 です.
+//-----------------------------------------------------------------------------
+float ComputeACMR(const std::vector<uint32_t>& indices, uint32_t cacheSize);
+
+//-----------------------------------------------------------------------------
+//! @brief      ATVR (Average Transformed Vertex Ratio) を求めます.
+//!
+//! @param[in]      indices         頂点インデックスです.
+//! @param[in]      cacheSize       頂点キャッシュのサイズです.
+//! @return     参照される頂点あたりのキャッシュミス数を返却します. 理想値は 1.0 です.
+//-----------------------------------------------------------------------------
+float ComputeATVR(const std::vector<uint32_t>& indices, uint32_t cacheSize);
+
+//-----------------------------------------------------------------------------
+//! @brief      Tipsify 法でインデックスを頂点キャッシュ向けに並べ替えます.
+//!
+//! @param[in,out]  indices         頂点インデックスです.
+//! @param[in]      vertexCount     頂点数です.
+//! @param[in]      cacheSize       頂点キャッシュのサイズです.
+//! @param[out]     pClusters       途切れた位置の三角形番号の格納先です. 不要な場合は nullptr.
+//-----------------------------------------------------------------------------
+void OptimizeVertexCache(
+    std::vector<uint32_t>&  indices,
+    size_t                  vertexCount,
+    uint32_t                cacheSize,
+    std::vector<uint32_t>*  pClusters = nullptr);
+
+//-----------------------------------------------------------------------------
+//! @brief      外側を向いたクラスタから描画されるように並べ替えます.
+//!
+//! @param[in,out]  mesh            メッシュです. OptimizeVertexCache() 済みであること.
+//! @param[in]      clusters        OptimizeVertexCache() が返したクラスタ境界です.
+//! @param[in]      cacheSize       頂点キャッシュのサイズです.
+//! @param[in]      threshold       クラスタを細分化する際に許容する ACMR の悪化率です.
+//-----------------------------------------------------------------------------
+void OptimizeOverdraw(
+    ResMesh&                        mesh,
+    const std::vector<uint32_t>&    clusters,
+    uint32_t                        cacheSize,
+    float                           threshold);
+
+//-----------------------------------------------------------------------------
+//! @brief      インデックスの参照順に頂点を並べ替えます.
+//!
+//! @param[in,out]  mesh            メッシュです. 参照されない頂点は削除されます.
+//-----------------------------------------------------------------------------
+void OptimizeVertexFetch(ResMesh& mesh);
+
+//-----------------------------------------------------------------------------
+//! @brief      頂点キャッシュ・オーバードロー・頂点フェッチの順に最適化します.
+//!
+//! @param[in,out]  mesh            メッシュです.
+//! @param[in]      desc            最適化設定です.
+//! @param[out]     pStats          最適化前後の統計の格納先です. 不要な場合は nullptr.
+//! @retval true    最適化に成功.
+//! @retval false   インデックスが不正なため最適化しなかった.
+//-----------------------------------------------------------------------------
+bool OptimizeMesh(
+    ResMesh&                    mesh,
+    const MeshOptimizeDesc&     desc,
+    MeshOptimizeStats*          pStats = nullptr);
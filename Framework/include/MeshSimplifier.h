@@ -0,0 +1,70 @@
+﻿//-----------------------------------------------------------------------------
+// File : MeshSimplifier.h
+// Desc : Mesh Simplification Module.
+// Copyright(c) Pocol. All right reserved.
+//-----------------------------------------------------------------------------
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <ResMesh.h>
+#include <cstdint>
+#include <vector>
+
+
+///////////////////////////////////////////////////////////////////////////////
+// MeshLodDesc structure
+///////////////////////////////////////////////////////////////////////////////
+struct MeshLodDesc
+{
+    uint32_t    MaxLevels       = 4;        //!< 生成する LOD の最大数です(LOD0 を除く).
+    float       Reduction       = 0.5f;     //!< 1つ前のレベルに対する目標の三角形数の比率です.
+    float       MinReduction    = 0.9f;     //!< この比率より減らせなかった場合は以降のレベルを生成しません.
+    uint32_t    MinTriangles    = 32;       //!< これより三角形数が少ないレベルは生成しません.
+    float       MaxError        = 0.05f;    //!< メッシュの境界球の半径に対する許容誤差の比率です.
+    uint32_t    CacheSize       = 16;       //!< 各レベルの頂点キャッシュ最適化で想定するキャッシュサイズです.
+};
+
+//-----------------------------------------------------------------------------
+//! @brief      二次誤差計量 (QEM) による辺の縮約でインデックスを簡略化します.
+//!
+//! @param[in]      mesh            メッシュです. 頂点は変更しません.
+//! @param[in]      indices         簡略化するインデックスです.
+//! @param[in]      targetCount     目標のインデックス数です.
+//! @param[in]      maxError        許容する誤差(距離)です.
+//! @param[out]     result          簡略化したインデックスの格納先です. mesh.Vertices を参照します.
+//! @param[out]     pError          実際の誤差(距離)の格納先です. 不要な場合は nullptr.
+//! @retval true    簡略化に成功. 目標に届かなかった場合も true を返却します.
+//! @retval false   インデックスが不正.
+//! @note       頂点は既存の頂点へ寄せるだけで新しい頂点は作りません. 同じ位置で属性の異なる頂点
+//!             (UV・法線・接線の継ぎ目) と開いた境界上の頂点は動かさないので, 継ぎ目はそのまま残ります.
+//-----------------------------------------------------------------------------
+bool SimplifyMesh(
+    const ResMesh&                  mesh,
+    const std::vector<uint32_t>&    indices,
+    uint32_t                        targetCount,
+    float                           maxError,
+    std::vector<uint32_t>&          result,
+    float*                          pError = nullptr);
+
+//-----------------------------------------------------------------------------
+//! @brief      LOD チェインを生成します.
+//!
+//! @param[in,out]  mesh            メッシュです. Lods と LodIndices が設定されます.
+//! @param[in]      desc            生成設定です.
+//! @retval true    生成に成功.
+//! @retval false   インデックスが不正なため生成しなかった.
+//! @note       各レベルは1つ前のレベルから簡略化し, 誤差は LOD0 に対する値として積算します.
+//-----------------------------------------------------------------------------
+bool BuildMeshLods(ResMesh& mesh, const MeshLodDesc& desc);
+
+//-----------------------------------------------------------------------------
+//! @brief      複数のメッシュの LOD チェインをメッシュごとに並列に生成します.
+//!
+//! @param[in,out]  meshes          メッシュです.
+//! @param[in]      desc            生成設定です.
+//! @retval true    全てのメッシュの生成に成功.
+//! @retval false   生成できなかったメッシュがある.
+//-----------------------------------------------------------------------------
+bool BuildMeshLods(std::vector<ResMesh>& meshes, const MeshLodDesc& desc);
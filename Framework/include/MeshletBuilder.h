@@ -0,0 +1,70 @@
+﻿//-----------------------------------------------------------------------------
+// File : MeshletBuilder.h
+// Desc : Meshlet Builder Module.
+// Copyright(c) Pocol. All right reserved.
+//-----------------------------------------------------------------------------
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <ResMesh.h>
+#include <cstdint>
+#include <vector>
+
+
+///////////////////////////////////////////////////////////////////////////////
+// MeshletDesc structure
+///////////////////////////////////////////////////////////////////////////////
+struct MeshletDesc
+{
+    uint32_t    MaxVertices     = 64;       //!< 1メッシュレットあたりの最大頂点数です(256 以下).
+    uint32_t    MaxTriangles    = 124;      //!< 1メッシュレットあたりの最大三角形数です(4 の倍数を推奨).
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// MeshletStats structure
+///////////////////////////////////////////////////////////////////////////////
+struct MeshletStats
+{
+    uint32_t    MeshletCount;       //!< メッシュレット数です.
+    uint32_t    VertexCount;        //!< メッシュレットが参照する頂点数の合計です(重複を含む).
+    uint32_t    TriangleCount;      //!< 三角形数の合計です.
+    uint32_t    ConeCount;          //!< 法線コーンが有効なメッシュレット数です.
+};
+
+//-----------------------------------------------------------------------------
+//! @brief      メッシュの三角形をメッシュレットに分割します.
+//!
+//! @param[in,out]  mesh            メッシュです. Meshlets, MeshletVertices, MeshletTriangles が設定されます.
+//! @param[in]      desc            分割設定です.
+//! @retval true    分割に成功.
+//! @retval false   設定かインデックスが不正なため分割しなかった.
+//! @note       共有頂点の多い隣接三角形から優先して詰めるので, 頂点キャッシュ最適化の前後を問わず使えます.
+//-----------------------------------------------------------------------------
+bool BuildMeshlets(ResMesh& mesh, const MeshletDesc& desc);
+
+//-----------------------------------------------------------------------------
+//! @brief      複数のメッシュをメッシュレットに分割します.
+//!
+//! @param[in,out]  meshes          メッシュです.
+//! @param[in]      desc            分割設定です.
+//! @param[out]     pStats          統計の格納先です. 不要な場合は nullptr.
+//! @retval true    全てのメッシュの分割に成功.
+//! @retval false   分割できなかったメッシュがある.
+//! @note       分割はメッシュごとに, バウンディングボリュームの計算はメッシュレットごとに並列に処理します.
+//-----------------------------------------------------------------------------
+bool BuildMeshlets(
+    std::vector<ResMesh>&   meshes,
+    const MeshletDesc&      desc,
+    MeshletStats*           pStats = nullptr);
+
+//-----------------------------------------------------------------------------
+//! @brief      メッシュレットの三角形からローカル頂点番号を取り出します.
+//!
+//! @param[in]      packed          ResMesh::MeshletTriangles の要素です.
+//! @param[in]      corner          頂点の番号(0～2)です.
+//! @return     メッシュレット内のローカル頂点番号を返却します.
+//-----------------------------------------------------------------------------
+inline uint32_t UnpackMeshletIndex(uint32_t packed, uint32_t corner)
+{ return (packed >> (corner * 8)) & 0xff; }
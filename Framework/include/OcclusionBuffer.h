@@ -0,0 +1,151 @@
+﻿//-----------------------------------------------------------------------------
+// File : OcclusionBuffer.h
+// Desc : Software Occlusion Buffer Module.
+// Copyright(c) Pocol. All right reserved.
+//-----------------------------------------------------------------------------
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <MeshBounds.h>
+#include <DirectXMath.h>
+#include <cstdint>
+#include <vector>
+
+
+///////////////////////////////////////////////////////////////////////////////
+// OcclusionBuffer class
+///////////////////////////////////////////////////////////////////////////////
+//! @brief      遮蔽物をCPUで低解像度の深度バッファにラスタライズし, 階層Zでボックスの遮蔽判定を行います.
+//!
+//! @note       深度は 0 が手前, 1 が奥です. 階層Zの各レベルは下位レベルの 2x2 の最大値(最も奥)を保持し,
+//!             ボックスの最も手前の深度がそれより奥であれば遮蔽されていると判定します.
+//!             ニアクリップ面をまたぐ遮蔽物は描画せず, またぐボックスは可視とするので判定は保守的です.
+class OcclusionBuffer
+{
+    //=========================================================================
+    // list of friend classes and methods.
+    //=========================================================================
+    /* NOTHING */
+
+public:
+    //=========================================================================
+    // public variables.
+    //=========================================================================
+    static constexpr uint32_t DefaultWidth  = 256;  //!< 既定の横幅です.
+    static constexpr uint32_t DefaultHeight = 128;  //!< 既定の縦幅です.
+
+    //=========================================================================
+    // public methods.
+    //=========================================================================
+
+    //-------------------------------------------------------------------------
+    //! @brief      コンストラクタです.
+    //-------------------------------------------------------------------------
+    OcclusionBuffer();
+
+    //-------------------------------------------------------------------------
+    //! @brief      デストラクタです.
+    //-------------------------------------------------------------------------
+    ~OcclusionBuffer();
+
+    //-------------------------------------------------------------------------
+    //! @brief      初期化処理を行います.
+    //!
+    //! @param[in]      width       横幅です(2のべき乗).
+    //! @param[in]      height      縦幅です(2のべき乗).
+    //! @retval true    初期化に成功.
+    //! @retval false   初期化に失敗.
+    //-------------------------------------------------------------------------
+    bool Init(uint32_t width = DefaultWidth, uint32_t height = DefaultHeight);
+
+    //-------------------------------------------------------------------------
+    //! @brief      終了処理を行います.
+    //-------------------------------------------------------------------------
+    void Term();
+
+    //-------------------------------------------------------------------------
+    //! @brief      深度をクリアして描画を開始します.
+    //!
+    //! @param[in]      viewProj    ビュー射影行列です.
+    //-------------------------------------------------------------------------
+    void Begin(const DirectX::XMMATRIX& viewProj);
+
+    //-------------------------------------------------------------------------
+    //! @brief      遮蔽物のメッシュを描画します.
+    //!
+    //! @param[in]      pPositions  先頭の頂点位置です.
+    //! @param[in]      stride      頂点間のバイト数です.
+    //! @param[in]      pIndices    頂点インデックスです.
+    //! @param[in]      indexCount  インデックス数です.
+    //! @param[in]      world       ワールド行列です.
+    //! @return     描画した三角形数を返却します.
+    //-------------------------------------------------------------------------
+    uint32_t RasterizeMesh(
+        const DirectX::XMFLOAT3*    pPositions,
+        size_t                      stride,
+        const uint32_t*             pIndices,
+        uint32_t                    indexCount,
+        const DirectX::XMMATRIX&    world);
+
+    //-------------------------------------------------------------------------
+    //! @brief      描画を終了し, 階層Zを構築します.
+    //-------------------------------------------------------------------------
+    void End();
+
+    //-------------------------------------------------------------------------
+    //! @brief      ボックスが遮蔽されていないかどうかを判定します. End() の後に呼び出します.
+    //!
+    //! @param[in]      bounds      ワールド空間のバウンディングボリュームです.
+    //! @retval true    可視の可能性がある.
+    //! @retval false   遮蔽されている.
+    //-------------------------------------------------------------------------
+    bool IsVisible(const MeshBounds& bounds) const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      横幅を取得します.
+    //-------------------------------------------------------------------------
+    uint32_t GetWidth() const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      縦幅を取得します.
+    //-------------------------------------------------------------------------
+    uint32_t GetHeight() const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      階層Zのレベル数を取得します.
+    //-------------------------------------------------------------------------
+    uint32_t GetLevelCount() const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      指定レベルの深度を取得します.
+    //-------------------------------------------------------------------------
+    const float* GetDepth(uint32_t level) const;
+
+private:
+    ///////////////////////////////////////////////////////////////////////////
+    // Level structure
+    ///////////////////////////////////////////////////////////////////////////
+    struct Level
+    {
+        uint32_t    Offset;     //!< m_Depth 内の先頭位置です.
+        uint32_t    Width;      //!< 横幅です.
+        uint32_t    Height;     //!< 縦幅です.
+    };
+
+    //=========================================================================
+    // private variables.
+    //=========================================================================
+    std::vector<float>      m_Depth;        //!< 全レベルの深度です.
+    std::vector<Level>      m_Levels;       //!< レベルです.
+    DirectX::XMFLOAT4X4     m_ViewProj;     //!< ビュー射影行列です.
+
+    //=========================================================================
+    // private methods.
+    //=========================================================================
+    OcclusionBuffer (const OcclusionBuffer&) = delete;  // アクセス禁止.
+    void operator = (const OcclusionBuffer&) = delete;  // アクセス禁止.
+
+    void RasterizeTriangle(const float* v0, const float* v1, const float* v2);
+};
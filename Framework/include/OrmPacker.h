@@ -0,0 +1,93 @@
+﻿//-----------------------------------------------------------------------------
+// File : OrmPacker.h
+// Desc : Occlusion/Roughness/Metallic Texture Packer Module.
+// Copyright(c) Pocol. All right reserved.
+//-----------------------------------------------------------------------------
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <BlockCompressor.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+///////////////////////////////////////////////////////////////////////////////
+// ORM_CHANNEL enum
+///////////////////////////////////////////////////////////////////////////////
+enum ORM_CHANNEL
+{
+    ORM_CHANNEL_OCCLUSION = 0,  //!< アンビエントオクルージョンです(R).
+    ORM_CHANNEL_ROUGHNESS,      //!< ラフネスです(G).
+    ORM_CHANNEL_METALLIC,       //!< メタリックです(B).
+
+    ORM_CHANNEL_COUNT
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// OrmSourceImage structure
+///////////////////////////////////////////////////////////////////////////////
+struct OrmSourceImage
+{
+    const uint8_t*  pPixels = nullptr;  //!< RGBA8 のピクセルです(詰めて格納). nullptr の場合は 255 で埋めます.
+    uint32_t        Width   = 0;        //!< 横幅です.
+    uint32_t        Height  = 0;        //!< 縦幅です.
+    uint32_t        Channel = 0;        //!< 取り出すチャンネル番号です(0:R, 1:G, 2:B, 3:A).
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// OrmSourcePaths structure
+///////////////////////////////////////////////////////////////////////////////
+struct OrmSourcePaths
+{
+    std::wstring    Paths[ORM_CHANNEL_COUNT];   //!< 各チャンネルの DDS ファイルパスです. 空の場合は 255 で埋めます.
+};
+
+//-----------------------------------------------------------------------------
+// Constant Values
+//-----------------------------------------------------------------------------
+constexpr DXGI_FORMAT OrmTextureFormat = DXGI_FORMAT_BC7_UNORM;    //!< ORM テクスチャの圧縮フォーマットです.
+
+//-----------------------------------------------------------------------------
+//! @brief      3枚の画像を1枚の ORM 画像に詰めます.
+//!
+//! @param[in]      sources     チャンネルごとの入力画像です.
+//! @param[out]     width       横幅の格納先です.
+//! @param[out]     height      縦幅の格納先です.
+//! @param[out]     result      RGBA8 のピクセルの格納先です. A は 255 です.
+//! @retval true    詰めるのに成功.
+//! @retval false   入力画像が1枚もない.
+//! @note       出力は入力の最大サイズを4の倍数に切り上げた大きさで, サイズの異なる入力は最近傍で拡大します.
+//-----------------------------------------------------------------------------
+bool PackOrmImage(
+    const OrmSourceImage    (&sources)[ORM_CHANNEL_COUNT],
+    uint32_t&               width,
+    uint32_t&               height,
+    std::vector<uint8_t>&   result);
+
+//-----------------------------------------------------------------------------
+//! @brief      ORM テクスチャのキャッシュファイルのパスを求めます.
+//!
+//! @param[in]      sources     各チャンネルのファイルパスです.
+//! @return     最初に設定されている入力と同じフォルダの "orm_<ハッシュ値>.dds" を返却します.
+//!             入力が1つも設定されていない場合は空文字を返却します.
+//! @note       同じ組み合わせの入力を持つマテリアルは同じパスになるので, テクスチャを共有できます.
+//-----------------------------------------------------------------------------
+std::wstring GetOrmCachePath(const OrmSourcePaths& sources);
+
+//-----------------------------------------------------------------------------
+//! @brief      ORM テクスチャを用意します.
+//!
+//! @param[in]      sources     各チャンネルのファイルパスです.
+//! @param[out]     result      読み込むべきファイルパスの格納先です.
+//! @param[out]     pStats      統計の格納先です. 圧縮した場合だけ設定されます. 不要な場合は nullptr.
+//! @retval true    ORM テクスチャのパスを設定した.
+//! @retval false   入力が1つも読み込めないか, 保存に失敗した.
+//! @note       キャッシュがすべての入力より新しい場合はそのまま使い, それ以外は詰め直して BC7 で保存します.
+//-----------------------------------------------------------------------------
+bool PrepareOrmTexture(
+    const OrmSourcePaths&   sources,
+    std::wstring&           result,
+    BcCompressStats*        pStats = nullptr);
@@ -0,0 +1,118 @@
+﻿//-----------------------------------------------------------------------------
+// File : PackedVertex.h
+// Desc : Packed Vertex Module.
+// Copyright(c) Pocol. All right reserved.
+//-----------------------------------------------------------------------------
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <ResMesh.h>
+#include <cstdint>
+#include <vector>
+
+
+///////////////////////////////////////////////////////////////////////////////
+// PackedVertex structure
+///////////////////////////////////////////////////////////////////////////////
+//! @brief      MeshVertex (44 byte) を 20 byte に圧縮した頂点です.
+//!
+//! @note       Position : R16G16B16A16_UNORM. xyz はメッシュAABB内の量子化位置, w は接線の符号(0 : -1, 1 : +1)です.
+//!             Normal   : R16G16_SNORM. 八面体エンコードした法線です.
+//!             Tangent  : R16G16_SNORM. 八面体エンコードした接線です.
+//!             TexCoord : R16G16_FLOAT. 半精度のテクスチャ座標です.
+class PackedVertex
+{
+public:
+    uint16_t    Position[4];
+    int16_t     Normal  [2];
+    int16_t     Tangent [2];
+    uint16_t    TexCoord[2];
+
+    static const D3D12_INPUT_LAYOUT_DESC InputLayout;
+
+private:
+    static const int InputElementCount = 4;
+    static const D3D12_INPUT_ELEMENT_DESC InputElements[InputElementCount];
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// PackedVertexQuantization structure
+///////////////////////////////////////////////////////////////////////////////
+//! @brief      位置の復元パラメータです. 復元位置 = Offset + Position.xyz * Scale です.
+//!
+//! @note       アフィン変換なのでワールド行列に事前に乗算しておけばシェーダ側での復元は不要です.
+//!             その場合, 法線の変換にはスケールを含まない行列を使用してください.
+struct PackedVertexQuantization
+{
+    DirectX::XMFLOAT3   Offset;     //!< AABBの最小値です.
+    DirectX::XMFLOAT3   Scale;      //!< AABBの大きさ / 65535 です.
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// PackedVertexError structure
+///////////////////////////////////////////////////////////////////////////////
+struct PackedVertexError
+{
+    DirectX::XMFLOAT3   Position;   //!< 位置の最大誤差です(各軸の絶対値).
+    float               Direction;  //!< 法線・接線の最大角度誤差です(ラジアン).
+    float               TexCoord;   //!< テクスチャ座標の最大誤差です(絶対値).
+};
+
+//-----------------------------------------------------------------------------
+//! @brief      メッシュのAABBから量子化パラメータを求めます.
+//!
+//! @param[in]      vertices        頂点データです.
+//! @return     量子化パラメータを返却します.
+//-----------------------------------------------------------------------------
+PackedVertexQuantization ComputeQuantization(const std::vector<MeshVertex>& vertices);
+
+//-----------------------------------------------------------------------------
+//! @brief      頂点を圧縮します.
+//!
+//! @param[in]      vertex          頂点です.
+//! @param[in]      quantization    量子化パラメータです.
+//! @param[in]      tangentSign     接線の符号(従法線の向き)です.
+//! @return     圧縮した頂点を返却します.
+//-----------------------------------------------------------------------------
+PackedVertex EncodeVertex(
+    const MeshVertex&               vertex,
+    const PackedVertexQuantization& quantization,
+    float                           tangentSign = 1.0f);
+
+//-----------------------------------------------------------------------------
+//! @brief      頂点を復元します.
+//!
+//! @param[in]      vertex          圧縮した頂点です.
+//! @param[in]      quantization    量子化パラメータです.
+//! @param[out]     pTangentSign    接線の符号の格納先です. 不要な場合は nullptr.
+//! @return     復元した頂点を返却します.
+//-----------------------------------------------------------------------------
+MeshVertex DecodeVertex(
+    const PackedVertex&             vertex,
+    const PackedVertexQuantization& quantization,
+    float*                          pTangentSign = nullptr);
+
+//-----------------------------------------------------------------------------
+//! @brief      メッシュの頂点をまとめて圧縮します.
+//!
+//! @param[in]      vertices        頂点データです.
+//! @param[out]     packed          圧縮した頂点の格納先です.
+//! @param[out]     quantization    量子化パラメータの格納先です.
+//-----------------------------------------------------------------------------
+void PackVertices(
+    const std::vector<MeshVertex>&  vertices,
+    std::vector<PackedVertex>&      packed,
+    PackedVertexQuantization&       quantization);
+
+//-----------------------------------------------------------------------------
+//! @brief      圧縮による最大誤差を求めます.
+//!
+//! @param[in]      quantization    量子化パラメータです.
+//! @param[in]      maxTexCoord     テクスチャ座標の絶対値の最大値です.
+//! @return     エンコード→デコードで生じる誤差の上限を返却します.
+//-----------------------------------------------------------------------------
+PackedVertexError GetPackedVertexError(
+    const PackedVertexQuantization& quantization,
+    float                           maxTexCoord = 1.0f);
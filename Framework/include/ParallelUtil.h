@@ -0,0 +1,215 @@
+﻿//-----------------------------------------------------------------------------
+// File : ParallelUtil.h
+// Desc : Parallel Utility.
+// Copyright(c) Pocol. All right reserved.
+//-----------------------------------------------------------------------------
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <cstdint>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <deque>
+#include <vector>
+#include <algorithm>
+
+
+//-----------------------------------------------------------------------------
+//      並列実行に使用するワーカースレッド数を取得します.
+//-----------------------------------------------------------------------------
+inline uint32_t GetWorkerThreadCount()
+{
+    auto count = std::thread::hardware_concurrency();
+    return (count > 0) ? count : 1;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// WorkerPool class
+///////////////////////////////////////////////////////////////////////////////
+class WorkerPool
+{
+public:
+    //-------------------------------------------------------------------------
+    //! @brief      コンストラクタです.
+    //!
+    //! @param[in]      threadCount     ワーカースレッド数です.
+    //-------------------------------------------------------------------------
+    explicit WorkerPool(uint32_t threadCount)
+    : m_Stop(false)
+    {
+        m_Threads.reserve(threadCount);
+        for(auto i=0u; i<threadCount; ++i)
+        { m_Threads.emplace_back([this]() { Run(); }); }
+    }
+
+    //-------------------------------------------------------------------------
+    //! @brief      デストラクタです.
+    //!
+    //! @note       積まれているジョブを全て実行してからスレッドを終了します.
+    //-------------------------------------------------------------------------
+    ~WorkerPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Stop = true;
+        }
+        m_Cond.notify_all();
+
+        for(auto& thread : m_Threads)
+        { thread.join(); }
+    }
+
+    //-------------------------------------------------------------------------
+    //! @brief      ジョブを積みます.
+    //!
+    //! @param[in]      job         ワーカースレッドで実行する処理です.
+    //-------------------------------------------------------------------------
+    void Submit(std::function<void()> job)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Jobs.push_back(std::move(job));
+        }
+        m_Cond.notify_one();
+    }
+
+    //-------------------------------------------------------------------------
+    //! @brief      ワーカースレッド数を取得します.
+    //!
+    //! @return     ワーカースレッド数を返却します.
+    //-------------------------------------------------------------------------
+    uint32_t GetThreadCount() const
+    { return uint32_t(m_Threads.size()); }
+
+    //-------------------------------------------------------------------------
+    //! @brief      プロセス共通のワーカープールを取得します.
+    //!
+    //! @return     論理コア数 - 1 のスレッドを持つワーカープールを返却します.
+    //! @note       初回の呼び出しで生成し, 以降はスレッドを使い回します.
+    //!             呼び出し元スレッドも処理に参加する前提なので1スレッド少なく生成します.
+    //-------------------------------------------------------------------------
+    static WorkerPool& GetDefault()
+    {
+        static WorkerPool s_Pool(GetWorkerThreadCount() - 1);
+        return s_Pool;
+    }
+
+private:
+    //=========================================================================
+    // private variables.
+    //=========================================================================
+    std::vector<std::thread>            m_Threads;  //!< ワーカースレッドです.
+    std::deque<std::function<void()>>   m_Jobs;     //!< 実行待ちのジョブです.
+    std::mutex                          m_Mutex;    //!< ジョブキューのミューテックスです.
+    std::condition_variable             m_Cond;     //!< ジョブ投入と終了の通知です.
+    bool                                m_Stop;     //!< 終了要求フラグです.
+
+    //=========================================================================
+    // private methods.
+    //=========================================================================
+    WorkerPool      (const WorkerPool&) = delete;
+    void operator = (const WorkerPool&) = delete;
+
+    //-------------------------------------------------------------------------
+    //! @brief      ワーカースレッドの処理です.
+    //-------------------------------------------------------------------------
+    void Run()
+    {
+        for(;;)
+        {
+            std::function<void()> job;
+            {
+                std::unique_lock<std::mutex> lock(m_Mutex);
+                m_Cond.wait(lock, [this]() { return m_Stop || !m_Jobs.empty(); });
+                if (m_Jobs.empty())
+                { return; }
+
+                job = std::move(m_Jobs.front());
+                m_Jobs.pop_front();
+            }
+
+            job();
+        }
+    }
+};
+
+//-----------------------------------------------------------------------------
+//      [0, count) の各インデックスに対して func(index) を並列に実行します.
+//      呼び出し元スレッドも処理に参加し, 全て完了するまで戻りません.
+//      threadCount に 0 を指定した場合は論理コア数を使用します.
+//      スレッドは WorkerPool::GetDefault() のものを使い回すので, 呼び出しごとの生成コストはかかりません.
+//-----------------------------------------------------------------------------
+template<typename Func>
+inline void ParallelFor(size_t count, Func&& func, uint32_t threadCount = 0)
+{
+    if (count == 0)
+    { return; }
+
+    if (threadCount == 0)
+    { threadCount = GetWorkerThreadCount(); }
+
+    threadCount = uint32_t(std::min<size_t>(threadCount, count));
+
+    auto& pool        = WorkerPool::GetDefault();
+    auto  helperCount = std::min(threadCount - 1, pool.GetThreadCount());
+
+    // 1スレッドで十分な場合はそのまま実行.
+    if (helperCount == 0)
+    {
+        for(size_t i=0; i<count; ++i)
+        { func(i); }
+        return;
+    }
+
+    ///////////////////////////////////////////////////////////////////////////
+    // State structure
+    ///////////////////////////////////////////////////////////////////////////
+    struct State
+    {
+        std::atomic<size_t>     Next { 0 };     //!< 次に処理するインデックスです.
+        std::atomic<size_t>     Done { 0 };     //!< 処理済みのインデックス数です.
+        std::mutex              Mutex;          //!< 完了通知のミューテックスです.
+        std::condition_variable Cond;           //!< 完了通知です.
+    };
+
+    // 呼び出しが戻った後にキューから取り出されるジョブもあるので共有で持たせます.
+    auto state = std::make_shared<State>();
+    auto pFunc = &func;
+
+    // 空いたスレッドから順に次のインデックスを取りに行きます.
+    // インデックスを取れた時点で呼び出し元は完了を待っているので func は有効です.
+    auto worker = [state, pFunc, count]()
+    {
+        for(;;)
+        {
+            auto index = state->Next.fetch_add(1, std::memory_order_relaxed);
+            if (index >= count)
+            { break; }
+
+            (*pFunc)(index);
+
+            if (state->Done.fetch_add(1, std::memory_order_acq_rel) + 1 == count)
+            {
+                { std::lock_guard<std::mutex> lock(state->Mutex); }
+                state->Cond.notify_all();
+            }
+        }
+    };
+
+    for(auto i=0u; i<helperCount; ++i)
+    { pool.Submit(worker); }
+
+    // 呼び出し元も処理に参加します. ワーカーが入れ子の ParallelFor を呼び出しても,
+    // 取り出されていないインデックスは呼び出し元が処理するので待ち合わせで止まることはありません.
+    worker();
+
+    std::unique_lock<std::mutex> lock(state->Mutex);
+    state->Cond.wait(lock, [&]() { return state->Done.load(std::memory_order_acquire) == count; });
+}
@@ -0,0 +1,227 @@
+﻿//-----------------------------------------------------------------------------
+// File : PathTracer.h
+// Desc : CPU Reference Path Tracer Module.
+// Copyright(c) Pocol. All right reserved.
+//-----------------------------------------------------------------------------
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <ResMesh.h>
+#include <BVH.h>
+#include <DirectXMath.h>
+#include <cstdint>
+#include <vector>
+
+
+///////////////////////////////////////////////////////////////////////////////
+// PathTracerCamera structure
+///////////////////////////////////////////////////////////////////////////////
+struct PathTracerCamera
+{
+    DirectX::XMFLOAT3   Position;       //!< 視点位置です.
+    DirectX::XMFLOAT3   Target;         //!< 注視点です.
+    DirectX::XMFLOAT3   Upward;         //!< 上向きベクトルです.
+    float               FovY;           //!< 垂直画角です(ラジアン).
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// PathTracerLight structure
+///////////////////////////////////////////////////////////////////////////////
+struct PathTracerLight
+{
+    DirectX::XMFLOAT3   Position;       //!< 点光源の位置です.
+    DirectX::XMFLOAT3   Color;          //!< ライトカラーです.
+    float               Intensity;      //!< ライト強度です.
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// PathTracerMaterial structure
+///////////////////////////////////////////////////////////////////////////////
+struct PathTracerMaterial
+{
+    DirectX::XMFLOAT3   BaseColor;      //!< ベースカラーです.
+    float               Roughness;      //!< 面の粗さです(範囲は[0,1]).
+    float               Metallic;       //!< 金属度です(範囲は[0,1]).
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// PathTracerDesc structure
+///////////////////////////////////////////////////////////////////////////////
+struct PathTracerDesc
+{
+    uint32_t            Width;          //!< 出力画像の横幅です.
+    uint32_t            Height;         //!< 出力画像の縦幅です.
+    uint32_t            SampleCount;    //!< 1ピクセルあたりのサンプル数です.
+    uint32_t            MaxBounce;      //!< 最大反射回数です.
+    uint32_t            TileSize;       //!< タイルのサイズです(ピクセル).
+    uint32_t            ThreadCount;    //!< スレッド数です. 0 の場合は論理コア数を使用します.
+    uint32_t            Seed;           //!< 乱数シードです.
+    PathTracerCamera    Camera;         //!< カメラです.
+    PathTracerLight     Light;          //!< ライトです.
+    DirectX::XMFLOAT3   SkyColor;       //!< 何にも当たらなかった場合の放射輝度です.
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// PathTracer class
+///////////////////////////////////////////////////////////////////////////////
+class PathTracer
+{
+    //=========================================================================
+    // list of friend classes and methods.
+    //=========================================================================
+    /* NOTHING */
+
+public:
+    //=========================================================================
+    // public variables.
+    //=========================================================================
+    /* NOTHING */
+
+    //=========================================================================
+    // public methods.
+    //=========================================================================
+
+    //-------------------------------------------------------------------------
+    //! @brief      コンストラクタです.
+    //-------------------------------------------------------------------------
+    PathTracer();
+
+    //-------------------------------------------------------------------------
+    //! @brief      デストラクタです.
+    //-------------------------------------------------------------------------
+    ~PathTracer();
+
+    //-------------------------------------------------------------------------
+    //! @brief      初期化処理を行います.
+    //!
+    //! @param[in]      meshes      LoadMesh() で読み込んだメッシュです.
+    //! @param[in]      materials   LoadMesh() で読み込んだマテリアルです.
+    //! @retval true    初期化に成功.
+    //! @retval false   初期化に失敗.
+    //-------------------------------------------------------------------------
+    bool Init(
+        const std::vector<ResMesh>&     meshes,
+        const std::vector<ResMaterial>& materials);
+
+    //-------------------------------------------------------------------------
+    //! @brief      終了処理を行います.
+    //-------------------------------------------------------------------------
+    void Term();
+
+    //-------------------------------------------------------------------------
+    //! @brief      マテリアルを上書きします.
+    //!
+    //! @param[in]      index       マテリアル番号です.
+    //! @param[in]      material    設定するマテリアルです.
+    //! @retval true    設定に成功.
+    //! @retval false   設定に失敗.
+    //-------------------------------------------------------------------------
+    bool SetMaterial(size_t index, const PathTracerMaterial& material);
+
+    //-------------------------------------------------------------------------
+    //! @brief      レンダリングを行います.
+    //!
+    //! @param[in]      desc        レンダリング設定です.
+    //! @param[out]     pixels      HDRの出力先です(Width * Height 要素).
+    //! @retval true    レンダリングに成功.
+    //! @retval false   レンダリングに失敗.
+    //! @note       乱数はピクセル毎に決まるため, スレッド数によらず同じ結果になります.
+    //-------------------------------------------------------------------------
+    bool Render(
+        const PathTracerDesc&           desc,
+        std::vector<DirectX::XMFLOAT3>& pixels) const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      三角形数を取得します.
+    //!
+    //! @return     三角形数を返却します.
+    //-------------------------------------------------------------------------
+    size_t GetTriangleCount() const;
+
+private:
+    ///////////////////////////////////////////////////////////////////////////
+    // Triangle structure
+    ///////////////////////////////////////////////////////////////////////////
+    struct Triangle
+    {
+        DirectX::XMFLOAT3   P0;         //!< 頂点0の位置です.
+        DirectX::XMFLOAT3   E1;         //!< 頂点0から頂点1へのエッジです.
+        DirectX::XMFLOAT3   E2;         //!< 頂点0から頂点2へのエッジです.
+        DirectX::XMFLOAT3   N0;         //!< 頂点0の法線です.
+        DirectX::XMFLOAT3   N1;         //!< 頂点1の法線です.
+        DirectX::XMFLOAT3   N2;         //!< 頂点2の法線です.
+        uint32_t            MaterialId; //!< マテリアル番号です.
+    };
+
+    ///////////////////////////////////////////////////////////////////////////
+    // HitRecord structure
+    ///////////////////////////////////////////////////////////////////////////
+    struct HitRecord
+    {
+        float       Distance;           //!< 交差距離です.
+        float       U;                  //!< 重心座標 U です.
+        float       V;                  //!< 重心座標 V です.
+        uint32_t    TriangleId;         //!< 三角形番号です.
+    };
+
+    //=========================================================================
+    // private variables.
+    //=========================================================================
+    std::vector<Triangle>           m_Triangles;    //!< 三角形です(BVHの三角形番号順).
+    BVH8                            m_BVH;          //!< 交差判定用のBVHです.
+    std::vector<PathTracerMaterial> m_Materials;    //!< マテリアルです.
+
+    //=========================================================================
+    // private methods.
+    //=========================================================================
+    PathTracer      (const PathTracer&) = delete;   // アクセス禁止.
+    void operator = (const PathTracer&) = delete;   // アクセス禁止.
+
+    //-------------------------------------------------------------------------
+    //! @brief      最近接交差を求めます.
+    //!
+    //! @param[in]      origin      レイの原点です.
+    //! @param[in]      dir         レイの方向です.
+    //! @param[in]      tmax        最大距離です.
+    //! @param[out]     hit         交差情報の格納先です.
+    //! @retval true    交差あり.
+    //! @retval false   交差なし.
+    //-------------------------------------------------------------------------
+    bool Intersect(
+        const DirectX::XMFLOAT3&    origin,
+        const DirectX::XMFLOAT3&    dir,
+        float                       tmax,
+        HitRecord&                  hit) const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      遮蔽されているかどうかチェックします.
+    //!
+    //! @param[in]      origin      レイの原点です.
+    //! @param[in]      dir         レイの方向です.
+    //! @param[in]      tmax        最大距離です.
+    //! @retval true    遮蔽されている.
+    //! @retval false   遮蔽されていない.
+    //-------------------------------------------------------------------------
+    bool Occluded(
+        const DirectX::XMFLOAT3&    origin,
+        const DirectX::XMFLOAT3&    dir,
+        float                       tmax) const;
+};
+
+//-----------------------------------------------------------------------------
+//! @brief      HDR画像を Radiance HDR (.hdr) 形式で保存します.
+//!
+//! @param[in]      filename    出力ファイルパスです.
+//! @param[in]      width       画像の横幅です.
+//! @param[in]      height      画像の縦幅です.
+//! @param[in]      pixels      画素データです.
+//! @retval true    保存に成功.
+//! @retval false   保存に失敗.
+//-----------------------------------------------------------------------------
+bool SaveHDR(
+    const wchar_t*                          filename,
+    uint32_t                                width,
+    uint32_t                                height,
+    const std::vector<DirectX::XMFLOAT3>&   pixels);
@@ -9,9 +9,11 @@
 // Includes
 //-----------------------------------------------------------------------------
 #include <cstdint>
-#include <mutex>
+#include <cstdlib>
+#include <atomic>
 #include <cassert>
-#include <functional>
+#include <new>
+#include <utility>
 
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -35,8 +37,7 @@ public:
     //-------------------------------------------------------------------------
     Pool()
     : m_pBuffer (nullptr)
-    , m_pActive (nullptr)
-    , m_pFree   (nullptr)
+    , m_Head    (MakeHead(InvalidIndex, 0))
     , m_Capacity(0)
     , m_Count   (0)
     { /* DO_NOTHING */ }
@@ -53,40 +54,29 @@ public:
     //! @param[in]      count       確保するアイテム数です.
     //! @retval true    初期化に成功.
     //! @retval false   初期化に失敗.
+    //! @note       Init() と Term() はスレッドセーフではありません.
     //-------------------------------------------------------------------------
     bool Init(uint32_t count)
     {
-        std::lock_guard<std::mutex> guard(m_Mutex);
+        if (count == 0 || count >= InvalidIndex)
+        { return false; }
 
-        m_pBuffer = static_cast<uint8_t*>(malloc(sizeof(Item) * (count + 2)));
+        m_pBuffer = static_cast<uint8_t*>(malloc(sizeof(Item) * count));
         if ( m_pBuffer == nullptr )
         { return false; }
 
         m_Capacity = count;
 
-        // インデックスを振る.
-        for(auto i=2u, j=0u; i<m_Capacity + 2; ++i, ++j)
+        // インデックスを振り, フリーリストを連結する.
+        for(auto i=0u; i<m_Capacity; ++i)
         {
             auto item = GetItem(i);
-            item->m_Index = j;
+            item->m_Index = i;
+            new (&item->m_Next) std::atomic<uint32_t>( (i + 1 < m_Capacity) ? i + 1 : InvalidIndex );
         }
 
-        m_pActive = GetItem(0);
-        m_pActive->m_pPrev = m_pActive->m_pNext = m_pActive;
-        m_pActive->m_Index = uint32_t(-1);
-
-        m_pFree = GetItem(1);
-        m_pFree->m_Index = uint32_t(-2);
-
-        for(auto i=1u; i<m_Capacity + 2; ++i)
-        {
-            GetItem(i)->m_pPrev = nullptr;
-            GetItem(i)->m_pNext = GetItem( i + 1 );
-        }
-
-        GetItem( m_Capacity + 1 )->m_pPrev = m_pFree;
-
-        m_Count = 0;
+        m_Head .store(MakeHead(0, 0), std::memory_order_relaxed);
+        m_Count.store(0, std::memory_order_relaxed);
 
         return true;
     }
@@ -96,52 +86,54 @@ public:
     //-------------------------------------------------------------------------
     void Term()
     {
-        std::lock_guard<std::mutex> guard(m_Mutex);
-
         if ( m_pBuffer )
         {
             free(m_pBuffer);
             m_pBuffer = nullptr;
         }
 
-        m_pActive   = nullptr;
-        m_pFree     = nullptr;
-        m_Capacity  = 0;
-        m_Count     = 0;
+        m_Head .store(MakeHead(InvalidIndex, 0), std::memory_order_relaxed);
+        m_Count.store(0, std::memory_order_relaxed);
+        m_Capacity = 0;
     }
 
     //-------------------------------------------------------------------------
     //! @brief      アイテムを確保します.
     //!
-    //! @param[in]      func        ユーザによる初期化処理です.
+    //! @param[in]      func        ユーザによる初期化処理です. void(uint32_t, T*) として呼び出されます.
     //! @return     確保したアイテムへのポインタ. 確保に失敗した場合は nullptr が返却されます.
     //-------------------------------------------------------------------------
-    T* Alloc(std::function<void(uint32_t, T*)> func = nullptr)
+    template<typename Func>
+    T* Alloc(Func&& func)
     {
-        std::lock_guard<std::mutex> guard(m_Mutex);
-
-        if ( m_pFree->m_pNext == m_pFree || m_Count + 1 > m_Capacity )
+        auto item = Pop();
+        if (item == nullptr)
         { return nullptr; }
 
-        auto item = m_pFree->m_pNext;
-        m_pFree->m_pNext = item->m_pNext;
-
-        item->m_pPrev = m_pActive->m_pPrev;
-        item->m_pNext = m_pActive;
-        item->m_pPrev->m_pNext = item->m_pNext->m_pPrev = item;
-
-        m_Count++;
-
         // メモリ割り当て.
-        auto val = new ((void*)item) T();
+        auto val = new ((void*)&item->m_Value) T();
 
-        // 初期化の必要があれば呼び出す.
-        if (func != nullptr)
-        { func(item->m_Index, val); }
+        // 初期化処理を呼び出す.
+        func(item->m_Index, val);
 
         return val;
     }
 
+    //-------------------------------------------------------------------------
+    //! @brief      アイテムを確保します.
+    //!
+    //! @return     確保したアイテムへのポインタ. 確保に失敗した場合は nullptr が返却されます.
+    //-------------------------------------------------------------------------
+    T* Alloc()
+    {
+        auto item = Pop();
+        if (item == nullptr)
+        { return nullptr; }
+
+        // メモリ割り当て.
+        return new ((void*)&item->m_Value) T();
+    }
+
     //-------------------------------------------------------------------------
     //! @brief      アイテムを解放します.
     //!
@@ -152,18 +144,11 @@ public:
         if (pValue == nullptr)
         { return; }
 
-        std::lock_guard<std::mutex> guard(m_Mutex);
-
         auto item = reinterpret_cast<Item*>(pValue);
+        assert( item->m_Index < m_Capacity && GetItem(item->m_Index) == item );
 
-        item->m_pPrev->m_pNext = item->m_pNext;
-        item->m_pNext->m_pPrev = item->m_pPrev;
-
-        item->m_pPrev = nullptr;
-        item->m_pNext = m_pFree->m_pNext;
-
-        m_pFree->m_pNext = item;
-        m_Count--;
+        pValue->~T();
+        Push(item);
     }
 
     //-------------------------------------------------------------------------
@@ -180,7 +165,7 @@ public:
     //! @return     使用中のアイテム数を返却します.
     //-------------------------------------------------------------------------
     uint32_t GetUsedCount() const
-    { return m_Count; }
+    { return m_Count.load(std::memory_order_relaxed); }
 
     //-------------------------------------------------------------------------
     //! @brief      利用可能なアイテム数を取得します.
@@ -188,67 +173,108 @@ public:
     //! @return     利用可能なアイテム数を返却します.
     //-------------------------------------------------------------------------
     uint32_t GetAvailableCount() const
-    { return m_Capacity - m_Count; }
+    { return m_Capacity - GetUsedCount(); }
 
 private:
+    //=========================================================================
+    // private variables.
+    //=========================================================================
+    static constexpr uint32_t InvalidIndex = UINT32_MAX;   //!< 無効なインデックスです.
+
     ///////////////////////////////////////////////////////////////////////////
     // Item structure
     ///////////////////////////////////////////////////////////////////////////
     struct Item
     {
-        T           m_Value;        //!< 値です.
-        uint32_t    m_Index;        //!< インデックスです.
-        Item*       m_pNext;        //!< 次のアイテムへのポインタ.
-        Item*       m_pPrev;        //!< 前のアイテムへのポインタ.
-
-        Item()
-        : m_Value()
-        , m_Index(0)
-        , m_pNext(nullptr)
-        , m_pPrev(nullptr)
-        { /* DO_NOTHING */ }
-
-        ~Item()
-        { /* DO_NOTHING */ }
+        T                       m_Value;    //!< 値です.
+        uint32_t                m_Index;    //!< インデックスです.
+        std::atomic<uint32_t>   m_Next;     //!< フリーリスト上の次のアイテムのインデックスです.
     };
 
-    //=========================================================================
-    // private variables.
-    //=========================================================================
-    uint8_t*    m_pBuffer;      //!< バッファです.
-    Item*       m_pActive;      //!< アクティブアイテムの先頭です.
-    Item*       m_pFree;        //!< フリーアイテムの先頭です.
-    uint32_t    m_Capacity;     //!< 総アイテム数です.
-    uint32_t    m_Count;        //!< 確保したアイテム数です.
-    std::mutex  m_Mutex;        //!< ミューテックスです.
+    uint8_t*                m_pBuffer;      //!< バッファです.
+    std::atomic<uint64_t>   m_Head;         //!< フリーリストの先頭です(上位32bit:タグ, 下位32bit:インデックス).
+    uint32_t                m_Capacity;     //!< 総アイテム数です.
+    std::atomic<uint32_t>   m_Count;        //!< 確保したアイテム数です.
 
     //=========================================================================
     // private methods.
     //=========================================================================
 
     //-------------------------------------------------------------------------
-    //! @brief      アイテムを取得します.
+    //! @brief      フリーリストの先頭値を生成します.
     //!
-    //! @param[in]      index       取得するアイテムのインデックス.
-    //! @return     アイテムへのポインタを返却します.
+    //! @param[in]      index       先頭アイテムのインデックス.
+    //! @param[in]      tag         ABA問題を回避するためのタグ.
+    //! @return     先頭値を返却します.
+    //-------------------------------------------------------------------------
+    static uint64_t MakeHead(uint32_t index, uint32_t tag)
+    { return (uint64_t(tag) << 32) | index; }
+
+    //-------------------------------------------------------------------------
+    //! @brief      フリーリストからアイテムを取り出します.
+    //!
+    //! @return     アイテムへのポインタ. 空の場合は nullptr を返却します.
     //-------------------------------------------------------------------------
-    Item* GetItem( uint32_t index )
+    Item* Pop()
     {
-        assert( 0 <= index && index <= m_Capacity + 2 );
-        return reinterpret_cast<Item*>( m_pBuffer + sizeof(Item) * index );
+        auto head = m_Head.load(std::memory_order_acquire);
+        for(;;)
+        {
+            auto index = uint32_t(head);
+            if (index == InvalidIndex)
+            { return nullptr; }
+
+            // 他スレッドに先に取られていた場合は古い値を読むことになるが,
+            // タグが変わっているため CAS が失敗してやり直しになる.
+            auto item = GetItem(index);
+            auto next = item->m_Next.load(std::memory_order_relaxed);
+            auto tag  = uint32_t(head >> 32) + 1;
+
+            if (m_Head.compare_exchange_weak(
+                head, MakeHead(next, tag),
+                std::memory_order_acquire,
+                std::memory_order_acquire))
+            {
+                m_Count.fetch_add(1, std::memory_order_relaxed);
+                return item;
+            }
+        }
     }
 
     //-------------------------------------------------------------------------
-    //! @brief      アイテムにメモリを割り当てます.
+    //! @brief      フリーリストにアイテムを戻します.
+    //!
+    //! @param[in]      item        戻すアイテムへのポインタ.
+    //-------------------------------------------------------------------------
+    void Push(Item* item)
+    {
+        auto head = m_Head.load(std::memory_order_relaxed);
+        for(;;)
+        {
+            item->m_Next.store(uint32_t(head), std::memory_order_relaxed);
+            auto tag = uint32_t(head >> 32) + 1;
+
+            if (m_Head.compare_exchange_weak(
+                head, MakeHead(item->m_Index, tag),
+                std::memory_order_release,
+                std::memory_order_relaxed))
+            {
+                m_Count.fetch_sub(1, std::memory_order_relaxed);
+                return;
+            }
+        }
+    }
+
+    //-------------------------------------------------------------------------
+    //! @brief      アイテムを取得します.
     //!
     //! @param[in]      index       取得するアイテムのインデックス.
     //! @return     アイテムへのポインタを返却します.
     //-------------------------------------------------------------------------
-    Item* AssignItem( uint32_t index )
+    Item* GetItem( uint32_t index ) const
     {
-        assert( 0 <= index && index <= m_Capacity + 2 );
-        auto buf = (m_pBuffer + sizeof(Item) * index);
-        return new (buf) Item;
+        assert( index < m_Capacity );
+        return reinterpret_cast<Item*>( m_pBuffer + sizeof(Item) * index );
     }
 
     Pool            (const Pool&) = delete;
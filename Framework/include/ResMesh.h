@@ -60,14 +60,64 @@ private:
     static const D3D12_INPUT_ELEMENT_DESC InputElements[InputElementCount];
 };
 
+///////////////////////////////////////////////////////////////////////////////
+// ResMeshlet structure
+///////////////////////////////////////////////////////////////////////////////
+//! @brief      メッシュレット(クラスタ)です.
+//!
+//! @note       コーンによる裏面カリングは, カメラ位置を eye として
+//!             dot(normalize(ConeApex - eye), ConeAxis) >= ConeCutoff
+//!             が成り立つ場合にメッシュレット全体が裏向きと判定できます.
+//!             法線のばらつきが大きい場合は ConeCutoff が 1 になり, 常に判定が失敗します.
+struct ResMeshlet
+{
+    uint32_t                    VertexOffset;   //!< ResMesh::MeshletVertices 内の開始位置です.
+    uint32_t                    VertexCount;    //!< 頂点数です.
+    uint32_t                    TriangleOffset; //!< ResMesh::MeshletTriangles 内の開始位置です.
+    uint32_t                    TriangleCount;  //!< 三角形数です.
+    DirectX::XMFLOAT3           Center;         //!< 境界球の中心です.
+    float                       Radius;         //!< 境界球の半径です.
+    DirectX::XMFLOAT3           ConeApex;       //!< 法線コーンの頂点です.
+    float                       ConeCutoff;     //!< 法線コーンの判定に使う sin(角度) です.
+    DirectX::XMFLOAT3           ConeAxis;       //!< 法線コーンの軸です.
+    uint32_t                    Reserved;       //!< 予約領域です.
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// ResLod structure
+///////////////////////////////////////////////////////////////////////////////
+struct ResLod
+{
+    uint32_t                    IndexOffset;    //!< ResMesh::LodIndices 内の開始位置です.
+    uint32_t                    IndexCount;     //!< インデックス数です.
+    float                       Error;          //!< LOD0 に対する誤差(メッシュのローカル空間での距離)です.
+    uint32_t                    Reserved;       //!< 予約領域です.
+};
+
 ///////////////////////////////////////////////////////////////////////////////
 // ResMesh structure
 ///////////////////////////////////////////////////////////////////////////////
 struct ResMesh
 {
-    std::vector<MeshVertex>     Vertices;     //!< 頂点データです.
-    std::vector<uint32_t>       Indices;      //!< 頂点インデックスです.
-    uint32_t                    MaterialId;   //!< マテリアル番号です.
+    std::vector<MeshVertex>     Vertices;           //!< 頂点データです.
+    std::vector<uint32_t>       Indices;            //!< 頂点インデックスです.
+    uint32_t                    MaterialId;         //!< マテリアル番号です.
+    std::vector<ResMeshlet>     Meshlets;           //!< メッシュレットです. 生成しない場合は空です.
+    std::vector<uint32_t>       MeshletVertices;    //!< メッシュレットのローカル頂点番号から Vertices への変換です.
+    std::vector<uint32_t>       MeshletTriangles;   //!< メッシュレットのローカル頂点番号を 8bit ずつ3つ詰めた三角形です.
+    std::vector<ResLod>         Lods;               //!< LOD1 以降の詳細度です. 生成しない場合は空です.
+    std::vector<uint32_t>       LodIndices;         //!< LOD1 以降の頂点インデックスです. Vertices を参照します.
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// ResNode structure
+///////////////////////////////////////////////////////////////////////////////
+struct ResNode
+{
+    std::wstring                Name;         //!< ノード名です.
+    uint32_t                    Parent;       //!< 親ノード番号です. ルートは UINT32_MAX です.
+    DirectX::XMFLOAT4X4         Transform;    //!< 親ノードからの相対変換行列です.
+    std::vector<uint32_t>       Meshes;       //!< 参照するメッシュ番号です.
 };
 
 //-----------------------------------------------------------------------------
@@ -76,10 +126,59 @@ struct ResMesh
 //! @param[in]      filename        ファイルパス.
 //! @param[out]     meshes          メッシュの格納先です.
 //! @param[out]     materials       マテリアルの格納先です.
+//! @param[in]      optimize        頂点キャッシュ・オーバードロー最適化を行う場合は true.
+//! @param[in]      meshlet         メッシュレットを生成する場合は true.
+//! @param[in]      lod             LOD チェインを生成する場合は true.
+//! @retval true    ロードに成功.
+//! @retval false   ロードに失敗.
+//-----------------------------------------------------------------------------
+bool LoadMesh(
+    const wchar_t*             filename,
+    std::vector<ResMesh>&      meshes,
+    std::vector<ResMaterial>&  materials,
+    bool                       optimize = false,
+    bool                       meshlet  = false,
+    bool                       lod      = false);
+
+//-----------------------------------------------------------------------------
+//! @brief      ノード階層を保ったままメッシュをロードします.
+//!
+//! @param[in]      filename        ファイルパス.
+//! @param[out]     meshes          メッシュの格納先です. 頂点はメッシュのローカル空間のままです.
+//! @param[out]     materials       マテリアルの格納先です.
+//! @param[out]     nodes           ノードの格納先です. 親ノードは常に子ノードより前に並びます.
+//! @param[in]      optimize        頂点キャッシュ・オーバードロー最適化を行う場合は true.
+//! @param[in]      meshlet         メッシュレットを生成する場合は true.
+//! @param[in]      lod             LOD チェインを生成する場合は true.
 //! @retval true    ロードに成功.
 //! @retval false   ロードに失敗.
+//! @note       複数のノードから参照されるメッシュは1つだけ格納されます.
 //-----------------------------------------------------------------------------
 bool LoadMesh(
     const wchar_t*             filename,
     std::vector<ResMesh>&      meshes,
-    std::vector<ResMaterial>&  materials);
+    std::vector<ResMaterial>&  materials,
+    std::vector<ResNode>&      nodes,
+    bool                       optimize = false,
+    bool                       meshlet  = false,
+    bool                       lod      = false);
+
+//-----------------------------------------------------------------------------
+//! @brief      キャッシュを使わずに Assimp でメッシュを読み込みます.
+//!
+//! @param[in]      filename        ファイルパス.
+//! @param[out]     meshes          メッシュの格納先です.
+//! @param[out]     materials       マテリアルの格納先です.
+//! @param[out]     pNodes          ノードの格納先です. nullptr の場合は頂点をワールド空間に変換します.
+//! @param[in]      threadCount     メッシュとマテリアルの変換に使うスレッド数です.
+//!                                 0 の場合は論理コア数, 1 の場合は逐次処理になります.
+//! @retval true    ロードに成功.
+//! @retval false   ロードに失敗.
+//! @note       最適化・メッシュレット・LOD の生成は行いません. スレッド数によらず結果は同一です.
+//-----------------------------------------------------------------------------
+bool ImportMesh(
+    const wchar_t*             filename,
+    std::vector<ResMesh>&      meshes,
+    std::vector<ResMaterial>&  materials,
+    std::vector<ResNode>*      pNodes      = nullptr,
+    uint32_t                   threadCount = 0);
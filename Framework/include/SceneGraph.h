@@ -0,0 +1,153 @@
+﻿//-----------------------------------------------------------------------------
+// File : SceneGraph.h
+// Desc : Scene Graph Module.
+// Copyright(c) Pocol. All right reserved.
+//-----------------------------------------------------------------------------
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <ResMesh.h>
+#include <DirectXMath.h>
+#include <cstdint>
+#include <vector>
+
+
+///////////////////////////////////////////////////////////////////////////////
+// SceneGraph class
+///////////////////////////////////////////////////////////////////////////////
+//! @brief      変換行列の階層を SoA で保持し, 変更されたノードのワールド行列をまとめて更新します.
+//!
+//! @note       内部ではノードを深さ順に並べ替えて保持するので, 親は常に子より前にあり,
+//!             同じ深さのノードは連続した範囲になります. ダーティフラグの伝播は1回の線形走査で済み,
+//!             行列の乗算は深さごとに独立しているので並列に処理できます.
+//!             ノード番号は追加順の値で, 並べ替えの影響を受けません.
+class SceneGraph
+{
+    //=========================================================================
+    // list of friend classes and methods.
+    //=========================================================================
+    /* NOTHING */
+
+public:
+    //=========================================================================
+    // public variables.
+    //=========================================================================
+    static constexpr uint32_t InvalidNode       = UINT32_MAX;   //!< 無効なノード番号です.
+    static constexpr uint32_t ParallelThreshold = 4096;         //!< 並列に更新する1階層あたりのノード数です.
+
+    //=========================================================================
+    // public methods.
+    //=========================================================================
+
+    //-------------------------------------------------------------------------
+    //! @brief      コンストラクタです.
+    //-------------------------------------------------------------------------
+    SceneGraph();
+
+    //-------------------------------------------------------------------------
+    //! @brief      デストラクタです.
+    //-------------------------------------------------------------------------
+    ~SceneGraph();
+
+    //-------------------------------------------------------------------------
+    //! @brief      全てのノードを削除します.
+    //-------------------------------------------------------------------------
+    void Clear();
+
+    //-------------------------------------------------------------------------
+    //! @brief      メモリを予約します.
+    //!
+    //! @param[in]      count       ノード数です.
+    //-------------------------------------------------------------------------
+    void Reserve(uint32_t count);
+
+    //-------------------------------------------------------------------------
+    //! @brief      ノードを追加します.
+    //!
+    //! @param[in]      parent      親ノード番号です. ルートの場合は InvalidNode を指定します.
+    //! @param[in]      local       親ノードからの相対変換行列です.
+    //! @return     ノード番号を返却します. 親ノードが無効な場合は InvalidNode を返却します.
+    //-------------------------------------------------------------------------
+    uint32_t AddNode(uint32_t parent, const DirectX::XMMATRIX& local);
+
+    //-------------------------------------------------------------------------
+    //! @brief      LoadMesh() で読み込んだノード階層を追加します.
+    //!
+    //! @param[in]      nodes       ノードです. 親ノードが子ノードより前に並んでいる必要があります.
+    //! @param[in]      parent      ルートノードの親ノード番号です.
+    //! @return     先頭のノード番号を返却します. nodes[i] のノード番号は戻り値 + i です.
+    //!             追加できない場合は InvalidNode を返却します.
+    //-------------------------------------------------------------------------
+    uint32_t AddNodes(const std::vector<ResNode>& nodes, uint32_t parent = InvalidNode);
+
+    //-------------------------------------------------------------------------
+    //! @brief      親ノードからの相対変換行列を設定します. ノードとその子孫がダーティになります.
+    //!
+    //! @param[in]      node        ノード番号です.
+    //! @param[in]      local       親ノードからの相対変換行列です.
+    //-------------------------------------------------------------------------
+    void SetLocal(uint32_t node, const DirectX::XMMATRIX& local);
+
+    //-------------------------------------------------------------------------
+    //! @brief      ダーティなノードのワールド行列を更新します.
+    //!
+    //! @return     更新したノード数を返却します.
+    //-------------------------------------------------------------------------
+    uint32_t Update();
+
+    //-------------------------------------------------------------------------
+    //! @brief      親ノードからの相対変換行列を取得します.
+    //-------------------------------------------------------------------------
+    DirectX::XMMATRIX GetLocal(uint32_t node) const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      ワールド行列を取得します. Update() 後の値を返却します.
+    //-------------------------------------------------------------------------
+    DirectX::XMMATRIX GetWorld(uint32_t node) const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      親ノード番号を取得します.
+    //-------------------------------------------------------------------------
+    uint32_t GetParent(uint32_t node) const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      ノードの深さを取得します. ルートは 0 です.
+    //-------------------------------------------------------------------------
+    uint32_t GetDepth(uint32_t node) const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      ノード数を取得します.
+    //-------------------------------------------------------------------------
+    uint32_t GetCount() const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      直前の Update() でワールド行列が更新されたノード番号を取得します.
+    //-------------------------------------------------------------------------
+    const std::vector<uint32_t>& GetUpdatedNodes() const;
+
+private:
+    //=========================================================================
+    // private variables.
+    //=========================================================================
+    std::vector<DirectX::XMMATRIX>  m_Local;        //!< 相対変換行列です(格納順).
+    std::vector<DirectX::XMMATRIX>  m_World;        //!< ワールド行列です(格納順).
+    std::vector<uint32_t>           m_Parent;       //!< 親ノードの格納位置です(格納順).
+    std::vector<uint8_t>            m_Dirty;        //!< ダーティフラグです(格納順).
+    std::vector<uint32_t>           m_Node;         //!< 格納位置からノード番号への変換です.
+    std::vector<uint32_t>           m_Slot;         //!< ノード番号から格納位置への変換です.
+    std::vector<uint32_t>           m_Depth;        //!< ノードの深さです(ノード番号順).
+    std::vector<uint32_t>           m_Levels;       //!< 深さごとの格納位置の開始位置です.
+    std::vector<uint32_t>           m_Work;         //!< 更新する格納位置の作業領域です.
+    std::vector<uint32_t>           m_Updated;      //!< 更新されたノード番号です.
+    bool                            m_NeedSort;     //!< 並べ替えが必要かどうか.
+
+    //=========================================================================
+    // private methods.
+    //=========================================================================
+    SceneGraph      (const SceneGraph&) = delete;   // アクセス禁止.
+    void operator = (const SceneGraph&) = delete;   // アクセス禁止.
+
+    void Sort();
+};
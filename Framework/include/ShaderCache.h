@@ -0,0 +1,280 @@
+﻿//-----------------------------------------------------------------------------
+// File : ShaderCache.h
+// Desc : Shader Cache Module.
+// Copyright(c) Pocol. All right reserved.
+//-----------------------------------------------------------------------------
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <MappedFile.h>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+///////////////////////////////////////////////////////////////////////////////
+// ShaderDefine structure
+///////////////////////////////////////////////////////////////////////////////
+struct ShaderDefine
+{
+    std::wstring    Name;       //!< マクロ名です.
+    std::wstring    Value;      //!< 値です.
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// ShaderDesc structure
+///////////////////////////////////////////////////////////////////////////////
+struct ShaderDesc
+{
+    std::wstring                Path;           //!< ソースファイルパスです.
+    std::wstring                Target;         //!< ターゲットプロファイルです(例 : lib_6_3).
+    std::vector<ShaderDefine>   Defines;        //!< マクロ定義です.
+    std::vector<std::wstring>   IncludeDirs;    //!< インクルードの検索ディレクトリです.
+    std::vector<std::wstring>   Arguments;      //!< 追加のコンパイル引数です.
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// ShaderCacheKey structure
+///////////////////////////////////////////////////////////////////////////////
+struct ShaderCacheKey
+{
+    uint64_t                    Hash;           //!< ソース, インクルード, マクロ, コンパイラバージョンのハッシュ値です.
+    std::string                 Source;         //!< ソースファイルの内容です.
+    std::vector<std::wstring>   Dependencies;   //!< 解決できたインクルードファイルのパスです(発見順).
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// ShaderBinary class
+///////////////////////////////////////////////////////////////////////////////
+//! @brief      コンパイル済みのシェーダバイナリです.
+//!
+//! @note       キャッシュからロードした場合はマッピングしたファイルを直接参照します.
+class ShaderBinary
+{
+    //=========================================================================
+    // list of friend classes and methods.
+    //=========================================================================
+    /* NOTHING */
+
+public:
+    //=========================================================================
+    // public variables.
+    //=========================================================================
+    /* NOTHING */
+
+    //=========================================================================
+    // public methods.
+    //=========================================================================
+
+    //-------------------------------------------------------------------------
+    //! @brief      コンストラクタです.
+    //-------------------------------------------------------------------------
+    ShaderBinary();
+
+    //-------------------------------------------------------------------------
+    //! @brief      キャッシュファイルをマッピングして参照します.
+    //!
+    //! @param[in]      path        キャッシュファイルパスです.
+    //! @param[in]      headerSize  ファイル先頭のヘッダのサイズです.
+    //! @param[out]     pHeader     ヘッダのコピー先です. 残りの領域がバイナリになります.
+    //! @retval true    マッピングに成功.
+    //! @retval false   マッピングに失敗.
+    //-------------------------------------------------------------------------
+    bool Map(const wchar_t* path, size_t headerSize, void* pHeader);
+
+    //-------------------------------------------------------------------------
+    //! @brief      キャッシュファイルのマッピングを解除します.
+    //-------------------------------------------------------------------------
+    void Unmap();
+
+    //-------------------------------------------------------------------------
+    //! @brief      メモリ上のバイナリを設定します.
+    //!
+    //! @param[in]      data        バイナリです.
+    //-------------------------------------------------------------------------
+    void Assign(std::vector<uint8_t>&& data);
+
+    //-------------------------------------------------------------------------
+    //! @brief      バイナリの先頭ポインタを取得します.
+    //-------------------------------------------------------------------------
+    const uint8_t* GetData() const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      バイナリのサイズを取得します.
+    //-------------------------------------------------------------------------
+    size_t GetSize() const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      キャッシュファイルをマッピングしているかどうかチェックします.
+    //-------------------------------------------------------------------------
+    bool IsMapped() const;
+
+private:
+    //=========================================================================
+    // private variables.
+    //=========================================================================
+    MappedFile              m_File;     //!< マッピングしたキャッシュファイルです.
+    std::vector<uint8_t>    m_Data;     //!< コンパイル直後のバイナリです.
+    const uint8_t*          m_pData;    //!< バイナリの先頭です.
+    size_t                  m_Size;     //!< バイナリのサイズです.
+
+    //=========================================================================
+    // private methods.
+    //=========================================================================
+    ShaderBinary    (const ShaderBinary&) = delete;     // アクセス禁止.
+    void operator = (const ShaderBinary&) = delete;     // アクセス禁止.
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// ShaderCompiler class
+///////////////////////////////////////////////////////////////////////////////
+//! @brief      シェーダコンパイラのインタフェースです.
+//!
+//! @note       Compile() は ShaderCache::LoadParallel() から複数スレッドで同時に呼び出されます.
+class ShaderCompiler
+{
+public:
+    virtual ~ShaderCompiler() = default;
+
+    //-------------------------------------------------------------------------
+    //! @brief      コンパイラのバージョン文字列を取得します. キャッシュキーに含まれます.
+    //-------------------------------------------------------------------------
+    virtual std::string GetVersion() const = 0;
+
+    //-------------------------------------------------------------------------
+    //! @brief      シェーダをコンパイルします.
+    //!
+    //! @param[in]      desc        シェーダの設定です.
+    //! @param[in]      source      ソースファイルの内容です.
+    //! @param[out]     binary      バイナリの格納先です.
+    //! @param[out]     message     エラーメッセージの格納先です.
+    //! @retval true    コンパイルに成功.
+    //! @retval false   コンパイルに失敗.
+    //-------------------------------------------------------------------------
+    virtual bool Compile(
+        const ShaderDesc&       desc,
+        const std::string&      source,
+        std::vector<uint8_t>&   binary,
+        std::string&            message) = 0;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// ShaderCache class
+///////////////////////////////////////////////////////////////////////////////
+//! @brief      ソースの内容をキーにしてコンパイル済みのシェーダをディスクに保存します.
+//!
+//! @note       キーはソース, インクルードファイルの内容, マクロ, 引数, コンパイラバージョンから求めるので,
+//!             どれかが変わればキャッシュファイル名が変わり, 古いキャッシュは参照されなくなります.
+//!             インクルードは #include 行を走査して解決するので, 条件コンパイルで使われない物も含まれます.
+class ShaderCache
+{
+    //=========================================================================
+    // list of friend classes and methods.
+    //=========================================================================
+    /* NOTHING */
+
+public:
+    //=========================================================================
+    // public variables.
+    //=========================================================================
+    /* NOTHING */
+
+    //=========================================================================
+    // public methods.
+    //=========================================================================
+
+    //-------------------------------------------------------------------------
+    //! @brief      コンストラクタです.
+    //-------------------------------------------------------------------------
+    ShaderCache();
+
+    //-------------------------------------------------------------------------
+    //! @brief      デストラクタです.
+    //-------------------------------------------------------------------------
+    ~ShaderCache();
+
+    //-------------------------------------------------------------------------
+    //! @brief      初期化処理を行います.
+    //!
+    //! @param[in]      pCompiler   シェーダコンパイラです.
+    //! @param[in]      cacheDir    キャッシュファイルを保存するディレクトリです.
+    //! @retval true    初期化に成功.
+    //! @retval false   初期化に失敗.
+    //-------------------------------------------------------------------------
+    bool Init(ShaderCompiler* pCompiler, const wchar_t* cacheDir);
+
+    //-------------------------------------------------------------------------
+    //! @brief      終了処理を行います.
+    //-------------------------------------------------------------------------
+    void Term();
+
+    //-------------------------------------------------------------------------
+    //! @brief      キャッシュキーを求めます.
+    //!
+    //! @param[in]      desc        シェーダの設定です.
+    //! @param[out]     key         キャッシュキーの格納先です.
+    //! @retval true    取得に成功.
+    //! @retval false   ソースファイルが読み込めなかった.
+    //-------------------------------------------------------------------------
+    bool GetKey(const ShaderDesc& desc, ShaderCacheKey& key) const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      ハッシュ値に対応するキャッシュファイルパスを取得します.
+    //!
+    //! @param[in]      hash        キャッシュキーのハッシュ値です.
+    //! @return     キャッシュファイルパスを返却します.
+    //-------------------------------------------------------------------------
+    std::wstring GetCachePath(uint64_t hash) const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      シェーダをロードします. キャッシュが無ければコンパイルして保存します.
+    //!
+    //! @param[in]      desc        シェーダの設定です.
+    //! @return     バイナリを返却します. 失敗した場合は nullptr を返却します.
+    //-------------------------------------------------------------------------
+    std::shared_ptr<ShaderBinary> Load(const ShaderDesc& desc);
+
+    //-------------------------------------------------------------------------
+    //! @brief      独立した複数のシェーダを並列にロードします.
+    //!
+    //! @param[in]      pDescs      シェーダの設定の配列です.
+    //! @param[in]      count       シェーダ数です.
+    //! @param[out]     pResults    バイナリの格納先です(count 個).
+    //! @retval true    全てのロードに成功.
+    //! @retval false   1つ以上のロードに失敗.
+    //-------------------------------------------------------------------------
+    bool LoadParallel(
+        const ShaderDesc*               pDescs,
+        size_t                          count,
+        std::shared_ptr<ShaderBinary>*  pResults);
+
+    //-------------------------------------------------------------------------
+    //! @brief      キャッシュからロードできた回数を取得します.
+    //-------------------------------------------------------------------------
+    uint32_t GetHitCount() const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      コンパイラを呼び出した回数を取得します.
+    //-------------------------------------------------------------------------
+    uint32_t GetCompileCount() const;
+
+private:
+    //=========================================================================
+    // private variables.
+    //=========================================================================
+    ShaderCompiler*         m_pCompiler;        //!< シェーダコンパイラです.
+    std::wstring            m_CacheDir;         //!< キャッシュディレクトリです.
+    std::string             m_CompilerVersion;  //!< コンパイラのバージョンです.
+    std::atomic<uint32_t>   m_HitCount;         //!< キャッシュからロードできた回数です.
+    std::atomic<uint32_t>   m_CompileCount;     //!< コンパイラを呼び出した回数です.
+
+    //=========================================================================
+    // private methods.
+    //=========================================================================
+    ShaderCache     (const ShaderCache&) = delete;  // アクセス禁止.
+    void operator = (const ShaderCache&) = delete;  // アクセス禁止.
+};
@@ -86,6 +86,22 @@ public:
         bool                        isSRGB,
         bool                        isCube);
 
+    //-------------------------------------------------------------------------
+    //! @brief      生成済みのリソースを用いて初期化処理を行います.
+    //!
+    //! @param[in]      pDevice     デバイスです.
+    //! @param[in]      pPool       ディスクリプタプールです.
+    //! @param[in]      pResource   テクスチャリソースです. 参照カウントを増やして保持します.
+    //! @param[in]      isCube      キューブマップである場合には true を指定します.
+    //! @retval true    初期化に成功.
+    //! @retval false   初期化に失敗.
+    //-------------------------------------------------------------------------
+    bool Init(
+        ID3D12Device*               pDevice,
+        DescriptorPool*             pPool,
+        ID3D12Resource*             pResource,
+        bool                        isCube);
+
     //-------------------------------------------------------------------------
     //! @brief      終了処理を行います.
     //-------------------------------------------------------------------------
@@ -0,0 +1,405 @@
+﻿//-----------------------------------------------------------------------------
+// File : TextureStreamer.h
+// Desc : Texture Mip Streaming Module.
+// Copyright(c) Pocol. All right reserved.
+//-----------------------------------------------------------------------------
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <d3d12.h>
+#include <ComPtr.h>
+#include <DdsFile.h>
+#include <DescriptorPool.h>
+#include <MappedFile.h>
+#include <ResourceUploadBatch.h>
+#include <cmath>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <memory>
+#include <vector>
+
+
+///////////////////////////////////////////////////////////////////////////////
+// TextureStreamDesc structure
+///////////////////////////////////////////////////////////////////////////////
+struct TextureStreamDesc
+{
+    uint64_t    BudgetBytes     = 256ull * 1024 * 1024; //!< 常駐させるミップの合計サイズの上限です.
+    uint64_t    TailBytes       = 64ull * 1024;         //!< テクスチャごとに常に常駐させる末尾ミップの合計サイズの上限です.
+    uint64_t    MaxUploadBytes  = 16ull * 1024 * 1024;  //!< 1回の更新でアップロードするサイズの目安です.
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// TextureResidency structure
+///////////////////////////////////////////////////////////////////////////////
+struct TextureResidency
+{
+    std::vector<uint64_t>   MipBytes;           //!< ミップごとのサイズです(配列要素の合計).
+    uint32_t                TailMip;            //!< 常に常駐させる末尾ミップの先頭です.
+    uint32_t                ResidentMip;        //!< 現在常駐している最も詳細なミップです.
+    uint32_t                RequestedMip;       //!< 画面上の要求から求めた最も詳細なミップです. 要求が無い場合は TailMip 以上.
+    float                   Priority;           //!< 画面上の要求の大きさ(投影面積など)です.
+    uint64_t                LastRequestFrame;   //!< 最後に要求があった更新番号です.
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// TextureStreamStats structure
+///////////////////////////////////////////////////////////////////////////////
+struct TextureStreamStats
+{
+    uint32_t    TextureCount;       //!< 登録されているテクスチャ数です.
+    uint64_t    ResidentBytes;      //!< 常駐しているミップの合計サイズです.
+    uint64_t    BudgetBytes;        //!< 予算です.
+    uint64_t    UploadedBytes;      //!< 直前の更新でアップロードしたサイズです.
+    uint32_t    EvictedCount;       //!< 直前の更新でミップを手放したテクスチャ数です.
+};
+
+//-----------------------------------------------------------------------------
+//! @brief      予算内で常駐させるミップを決めます.
+//!
+//! @param[in]      textures    テクスチャごとの常駐状態です.
+//! @param[in]      budget      予算です.
+//! @param[out]     result      テクスチャごとに常駐させる最も詳細なミップの格納先です.
+//! @return     決めたミップの合計サイズを返却します. 末尾ミップだけで予算を超える場合は予算より大きくなります.
+//! @note       末尾ミップは必ず常駐させます. 要求のあるミップは粗い方から1段ずつ, 優先度の高いテクスチャから
+//!             順に割り当てるので, 予算が足りない場合も全てのテクスチャが均等に詳細になります.
+//!             余った予算で要求の無くなったミップを最後の要求が新しい順に残し, 予算を超えた分だけ手放します.
+//-----------------------------------------------------------------------------
+uint64_t SelectResidentMips(
+    const std::vector<TextureResidency>&    textures,
+    uint64_t                                budget,
+    std::vector<uint32_t>&                  result);
+
+//-----------------------------------------------------------------------------
+//! @brief      画面上のサイズから必要なミップを求めます.
+//!
+//! @param[in]      width       ミップ0の横幅です.
+//! @param[in]      height      ミップ0の縦幅です.
+//! @param[in]      screenSize  テクスチャを貼ったオブジェクトの画面上のサイズ(ピクセル)です.
+//! @return     1ピクセルに1テクセル以上が対応する最も粗いミップを返却します.
+//-----------------------------------------------------------------------------
+inline uint32_t CalcStreamingMip(uint32_t width, uint32_t height, float screenSize)
+{
+    auto ratio = float(width > height ? width : height) / (screenSize > 1.0f ? screenSize : 1.0f);
+    return (ratio > 1.0f) ? uint32_t(log2f(ratio)) : 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// StreamTexture structure
+///////////////////////////////////////////////////////////////////////////////
+struct StreamTexture
+{
+    ID3D12Resource*     pResource;      //!< リソースです.
+    DescriptorHandle*   pHandle;        //!< シェーダリソースビューのハンドルです.
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// TextureStreamBackend class
+///////////////////////////////////////////////////////////////////////////////
+//! @brief      テクスチャの生成・破棄を行うインタフェースです.
+//!
+//! @note       TextureStreamer のミップの選択やファイル内の配置の計算は CPU だけで完結するので,
+//!             ここを差し替えれば GPU 無しで動作を確認できます.
+class TextureStreamBackend
+{
+public:
+    virtual ~TextureStreamBackend() = default;
+
+    //-------------------------------------------------------------------------
+    //! @brief      指定ミップ以降だけを持つテクスチャを生成し, アップロードを要求します.
+    //!
+    //! @param[in]      info            DDS ファイルの情報です.
+    //! @param[in]      firstMip        生成するテクスチャのミップ0に対応するミップです.
+    //! @param[in]      isSRGB          sRGBフォーマットにする場合は true を指定.
+    //! @param[in]      pSubresources   アップロードするサブリソースです. 配列要素ごとに firstMip から並べます.
+    //! @param[in]      count           サブリソース数です.
+    //! @param[out]     result          テクスチャの格納先です.
+    //! @retval true    生成に成功.
+    //! @retval false   生成に失敗.
+    //-------------------------------------------------------------------------
+    virtual bool CreateTexture(
+        const DdsInfo&                  info,
+        uint32_t                        firstMip,
+        bool                            isSRGB,
+        const D3D12_SUBRESOURCE_DATA*   pSubresources,
+        uint32_t                        count,
+        StreamTexture&                  result) = 0;
+
+    //-------------------------------------------------------------------------
+    //! @brief      テクスチャを破棄します.
+    //!
+    //! @param[in,out]  texture     破棄するテクスチャです.
+    //-------------------------------------------------------------------------
+    virtual void DestroyTexture(StreamTexture& texture) = 0;
+
+    //-------------------------------------------------------------------------
+    //! @brief      要求済みのアップロードを GPU に投入します.
+    //-------------------------------------------------------------------------
+    virtual void Flush() = 0;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// D3D12TextureStreamBackend class
+///////////////////////////////////////////////////////////////////////////////
+class D3D12TextureStreamBackend : public TextureStreamBackend
+{
+    //=========================================================================
+    // list of friend classes and methods.
+    //=========================================================================
+    /* NOTHING */
+
+public:
+    //=========================================================================
+    // public variables.
+    //=========================================================================
+    /* NOTHING */
+
+    //=========================================================================
+    // public methods.
+    //=========================================================================
+
+    //-------------------------------------------------------------------------
+    //! @brief      コンストラクタです.
+    //-------------------------------------------------------------------------
+    D3D12TextureStreamBackend();
+
+    //-------------------------------------------------------------------------
+    //! @brief      デストラクタです.
+    //-------------------------------------------------------------------------
+    ~D3D12TextureStreamBackend();
+
+    //-------------------------------------------------------------------------
+    //! @brief      初期化処理を行います.
+    //!
+    //! @param[in]      pDevice     デバイスです.
+    //! @param[in]      pPool       シェーダリソースビューを確保するディスクリプタプールです.
+    //! @param[in]      pQueue      アップロードを投入するコマンドキューです. 描画と同じキューを指定します.
+    //! @retval true    初期化に成功.
+    //! @retval false   初期化に失敗.
+    //-------------------------------------------------------------------------
+    bool Init(ID3D12Device* pDevice, DescriptorPool* pPool, ID3D12CommandQueue* pQueue);
+
+    //-------------------------------------------------------------------------
+    //! @brief      終了処理を行います. 投入済みのアップロードの完了を待ちます.
+    //-------------------------------------------------------------------------
+    void Term();
+
+    //-------------------------------------------------------------------------
+    //! @brief      DEFAULTヒープにテクスチャを生成し, アップロードバッチに積みます.
+    //-------------------------------------------------------------------------
+    bool CreateTexture(
+        const DdsInfo&                  info,
+        uint32_t                        firstMip,
+        bool                            isSRGB,
+        const D3D12_SUBRESOURCE_DATA*   pSubresources,
+        uint32_t                        count,
+        StreamTexture&                  result) override;
+
+    //-------------------------------------------------------------------------
+    //! @brief      テクスチャとディスクリプタを解放します.
+    //-------------------------------------------------------------------------
+    void DestroyTexture(StreamTexture& texture) override;
+
+    //-------------------------------------------------------------------------
+    //! @brief      アップロードバッチをコマンドキューに投入します.
+    //-------------------------------------------------------------------------
+    void Flush() override;
+
+private:
+    //=========================================================================
+    // private variables.
+    //=========================================================================
+    ID3D12Device*                                   m_pDevice;      //!< デバイスです.
+    DescriptorPool*                                 m_pPool;        //!< ディスクリプタプールです.
+    ID3D12CommandQueue*                             m_pQueue;       //!< コマンドキューです.
+    std::unique_ptr<DirectX::ResourceUploadBatch>   m_pBatch;       //!< アップロードバッチです.
+    bool                                            m_Recording;    //!< バッチを開始済みかどうか.
+    std::vector<std::future<void>>                  m_Futures;      //!< 投入済みのバッチの完了通知です.
+
+    //=========================================================================
+    // private methods.
+    //=========================================================================
+    D3D12TextureStreamBackend   (const D3D12TextureStreamBackend&) = delete;    // アクセス禁止.
+    void operator =             (const D3D12TextureStreamBackend&) = delete;    // アクセス禁止.
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// TextureStreamer class
+///////////////////////////////////////////////////////////////////////////////
+//! @brief      DDS ファイルのミップを必要な分だけ常駐させます.
+//!
+//! @note       ファイルはメモリマッピングしたまま保持し, 常駐させるミップが変わった時点で
+//!             そのミップ以降だけを持つテクスチャを作り直して差し替えます. ディスクリプタも
+//!             作り直すので, 差し替え後は GetHandleGPU() でハンドルを取得し直してください.
+//!             古いテクスチャは FrameEnd() で渡したフェンス値に紐づき, Retire() にそのフェンス値以上の
+//!             完了値を渡すまで破棄されません. そのため差し替えたフレームの間だけ予算を超えることがあります.
+class TextureStreamer
+{
+    //=========================================================================
+    // list of friend classes and methods.
+    //=========================================================================
+    /* NOTHING */
+
+public:
+    //=========================================================================
+    // public variables.
+    //=========================================================================
+    static constexpr uint32_t InvalidId = UINT32_MAX;  //!< 無効なテクスチャ番号です.
+
+    //=========================================================================
+    // public methods.
+    //=========================================================================
+
+    //-------------------------------------------------------------------------
+    //! @brief      コンストラクタです.
+    //-------------------------------------------------------------------------
+    TextureStreamer();
+
+    //-------------------------------------------------------------------------
+    //! @brief      デストラクタです.
+    //-------------------------------------------------------------------------
+    ~TextureStreamer();
+
+    //-------------------------------------------------------------------------
+    //! @brief      初期化処理を行います.
+    //!
+    //! @param[in]      pBackend    テクスチャの生成・破棄を行うバックエンドです.
+    //! @param[in]      desc        設定です.
+    //! @retval true    初期化に成功.
+    //! @retval false   初期化に失敗.
+    //-------------------------------------------------------------------------
+    bool Init(TextureStreamBackend* pBackend, const TextureStreamDesc& desc = TextureStreamDesc());
+
+    //-------------------------------------------------------------------------
+    //! @brief      終了処理を行います. 全てのテクスチャを破棄します.
+    //-------------------------------------------------------------------------
+    void Term();
+
+    //-------------------------------------------------------------------------
+    //! @brief      テクスチャを登録し, 末尾ミップを常駐させます.
+    //!
+    //! @param[in]      filename    DDS ファイルのパスです.
+    //! @param[in]      isSRGB      sRGBフォーマットにする場合は true を指定.
+    //! @return     テクスチャ番号を返却します. 失敗した場合は InvalidId を返却します.
+    //! @note       キューブマップ・配列・ボリュームテクスチャは全てのミップを常駐させます.
+    //-------------------------------------------------------------------------
+    uint32_t Register(const wchar_t* filename, bool isSRGB);
+
+    //-------------------------------------------------------------------------
+    //! @brief      テクスチャの登録を解除します.
+    //!
+    //! @param[in]      id          テクスチャ番号です.
+    //-------------------------------------------------------------------------
+    void Unregister(uint32_t id);
+
+    //-------------------------------------------------------------------------
+    //! @brief      このフレームで必要なミップを要求します.
+    //!
+    //! @param[in]      id          テクスチャ番号です.
+    //! @param[in]      mip         必要な最も詳細なミップです.
+    //! @param[in]      priority    優先度(画面上の面積など)です. 同じフレームの要求は合算します.
+    //-------------------------------------------------------------------------
+    void Request(uint32_t id, uint32_t mip, float priority);
+
+    //-------------------------------------------------------------------------
+    //! @brief      要求と予算に合わせて常駐させるミップを更新します.
+    //!
+    //! @retval true    差し替えたテクスチャがある.
+    //! @retval false   差し替えたテクスチャは無い.
+    //! @note       描画を記録する前に呼び出します. 要求は次のフレームのためにクリアされます.
+    //-------------------------------------------------------------------------
+    bool Update();
+
+    //-------------------------------------------------------------------------
+    //! @brief      フレームを終了します.
+    //!
+    //! @param[in]      fenceValue  このフレームの完了時にシグナルされるフェンス値です.
+    //-------------------------------------------------------------------------
+    void FrameEnd(uint64_t fenceValue);
+
+    //-------------------------------------------------------------------------
+    //! @brief      GPUの処理が完了した古いテクスチャを破棄します.
+    //!
+    //! @param[in]      completedValue  完了済みのフェンス値です.
+    //-------------------------------------------------------------------------
+    void Retire(uint64_t completedValue);
+
+    //-------------------------------------------------------------------------
+    //! @brief      GPUディスクリプタハンドルを取得します.
+    //!
+    //! @param[in]      id          テクスチャ番号です.
+    //! @return     GPUディスクリプタハンドルを返却します. 無効な番号の場合は ptr が 0 のハンドルを返却します.
+    //-------------------------------------------------------------------------
+    D3D12_GPU_DESCRIPTOR_HANDLE GetHandleGPU(uint32_t id) const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      DDS ファイルの情報を取得します.
+    //!
+    //! @param[in]      id          テクスチャ番号です.
+    //! @return     DDS ファイルの情報を返却します. 無効な番号の場合は nullptr を返却します.
+    //-------------------------------------------------------------------------
+    const DdsInfo* GetInfo(uint32_t id) const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      常駐している最も詳細なミップを取得します.
+    //!
+    //! @param[in]      id          テクスチャ番号です.
+    //! @return     常駐している最も詳細なミップを返却します.
+    //-------------------------------------------------------------------------
+    uint32_t GetResidentMip(uint32_t id) const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      統計を取得します.
+    //!
+    //! @return     統計を返却します.
+    //-------------------------------------------------------------------------
+    TextureStreamStats GetStats() const;
+
+private:
+    ///////////////////////////////////////////////////////////////////////////
+    // Entry structure
+    ///////////////////////////////////////////////////////////////////////////
+    struct Entry
+    {
+        std::unique_ptr<MappedFile>     pFile;      //!< メモリマッピングしたファイルです.
+        DdsInfo                         Info;       //!< DDS ファイルの情報です.
+        std::vector<DdsSubresource>     Layout;     //!< サブリソースの配置です.
+        TextureResidency                Residency;  //!< 常駐状態です.
+        StreamTexture                   Texture;    //!< 現在のテクスチャです.
+        bool                            IsSRGB;     //!< sRGBフォーマットかどうか.
+    };
+
+    ///////////////////////////////////////////////////////////////////////////
+    // PendingFrame structure
+    ///////////////////////////////////////////////////////////////////////////
+    struct PendingFrame
+    {
+        uint64_t                    FenceValue;     //!< 解放を含むフレームのフェンス値です.
+        std::vector<StreamTexture>  Textures;       //!< 破棄するテクスチャです.
+    };
+
+    //=========================================================================
+    // private variables.
+    //=========================================================================
+    TextureStreamBackend*           m_pBackend;         //!< バックエンドです.
+    TextureStreamDesc               m_Desc;             //!< 設定です.
+    std::vector<Entry>              m_Entries;          //!< テクスチャです.
+    std::vector<uint32_t>           m_FreeIds;          //!< 再利用できるテクスチャ番号です.
+    std::vector<StreamTexture>      m_FrameRelease;     //!< 現在のフレームで差し替えたテクスチャです.
+    std::deque<PendingFrame>        m_Pending;          //!< GPUの完了待ちのテクスチャです.
+    uint64_t                        m_UpdateCount;      //!< 更新回数です.
+    uint64_t                        m_UploadedBytes;    //!< 直前の更新でアップロードしたサイズです.
+    uint32_t                        m_EvictedCount;     //!< 直前の更新でミップを手放したテクスチャ数です.
+
+    //=========================================================================
+    // private methods.
+    //=========================================================================
+    bool IsValid(uint32_t id) const;
+    bool Recreate(Entry& entry, uint32_t firstMip);
+
+    TextureStreamer     (const TextureStreamer&) = delete;  // アクセス禁止.
+    void operator =     (const TextureStreamer&) = delete;  // アクセス禁止.
+};
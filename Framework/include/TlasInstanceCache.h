@@ -0,0 +1,193 @@
+﻿//-----------------------------------------------------------------------------
+// File : TlasInstanceCache.h
+// Desc : Top Level Acceleration Structure Instance Cache Module.
+// Copyright(c) Pocol. All right reserved.
+//-----------------------------------------------------------------------------
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <d3d12.h>
+#include <DirectXMath.h>
+#include <cstdint>
+#include <vector>
+
+
+///////////////////////////////////////////////////////////////////////////////
+// TlasInstanceBounds structure
+///////////////////////////////////////////////////////////////////////////////
+struct TlasInstanceBounds
+{
+    DirectX::XMFLOAT3   Min;    //!< BLAS のローカル空間での最小値です.
+    DirectX::XMFLOAT3   Max;    //!< BLAS のローカル空間での最大値です.
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// TlasInstanceCache class
+///////////////////////////////////////////////////////////////////////////////
+//! @brief      TLAS のインスタンス記述子をCPU側に保持し, 変更された分だけを書き込みます.
+//!
+//! @note       リフィットでは TLAS のノードが作り直されないので, インスタンスが構築時の位置から
+//!             離れるほどバウンディングボックスが膨らみます. 構築時のワールド AABB と現在の
+//!             AABB の和集合の表面積の増加量を累積し, 構築時の合計に対する比率が閾値を超えたら
+//!             リビルドを選びます.
+class TlasInstanceCache
+{
+    //=========================================================================
+    // list of friend classes and methods.
+    //=========================================================================
+    /* NOTHING */
+
+public:
+    ///////////////////////////////////////////////////////////////////////////
+    // UPDATE_MODE enum
+    ///////////////////////////////////////////////////////////////////////////
+    enum UPDATE_MODE
+    {
+        UPDATE_MODE_NONE = 0,   //!< 変更が無いので構築は不要です.
+        UPDATE_MODE_REFIT,      //!< 変更されたインスタンスだけを書き込んでリフィットします.
+        UPDATE_MODE_REBUILD,    //!< 全てのインスタンスを書き込んでリビルドします.
+    };
+
+    //=========================================================================
+    // public variables.
+    //=========================================================================
+    static constexpr float DefaultRebuildRatio = 1.5f;  //!< リビルドを行う表面積比の既定値です.
+
+    //=========================================================================
+    // public methods.
+    //=========================================================================
+
+    //-------------------------------------------------------------------------
+    //! @brief      コンストラクタです.
+    //-------------------------------------------------------------------------
+    TlasInstanceCache();
+
+    //-------------------------------------------------------------------------
+    //! @brief      デストラクタです.
+    //-------------------------------------------------------------------------
+    ~TlasInstanceCache();
+
+    //-------------------------------------------------------------------------
+    //! @brief      全てのインスタンスを削除します.
+    //-------------------------------------------------------------------------
+    void Clear();
+
+    //-------------------------------------------------------------------------
+    //! @brief      インスタンスを追加します. 次の更新はリビルドになります.
+    //!
+    //! @param[in]      blas            BLAS のGPU仮想アドレスです.
+    //! @param[in]      transform       ワールド行列です.
+    //! @param[in]      bounds          BLAS のローカル空間でのバウンディングボックスです.
+    //! @param[in]      instanceId      シェーダから InstanceID() で参照できる値です.
+    //! @param[in]      hitGroupIndex   ヒットグループのインデックスです.
+    //! @param[in]      mask            インスタンスマスクです.
+    //! @param[in]      flags           D3D12_RAYTRACING_INSTANCE_FLAGS です.
+    //! @return     インスタンス番号を返却します.
+    //-------------------------------------------------------------------------
+    uint32_t AddInstance(
+        D3D12_GPU_VIRTUAL_ADDRESS   blas,
+        const DirectX::XMMATRIX&    transform,
+        const TlasInstanceBounds&   bounds,
+        uint32_t                    instanceId,
+        uint32_t                    hitGroupIndex,
+        uint8_t                     mask  = 0xFF,
+        uint32_t                    flags = 0);
+
+    //-------------------------------------------------------------------------
+    //! @brief      ワールド行列を設定します. 値が変わった場合だけダーティになります.
+    //!
+    //! @param[in]      index       インスタンス番号です.
+    //! @param[in]      transform   ワールド行列です.
+    //! @retval true    値が変わった.
+    //! @retval false   値が同じだった.
+    //-------------------------------------------------------------------------
+    bool SetTransform(uint32_t index, const DirectX::XMMATRIX& transform);
+
+    //-------------------------------------------------------------------------
+    //! @brief      書き込み先のバッファ数を設定します.
+    //!
+    //! @param[in]      count       フレームごとに切り替えるバッファの数です(1 ～ 32).
+    //-------------------------------------------------------------------------
+    void SetBufferCount(uint32_t count);
+
+    //-------------------------------------------------------------------------
+    //! @brief      リビルドを行う表面積比を設定します.
+    //!
+    //! @param[in]      ratio       構築時に対する表面積比です(1.0 以上).
+    //-------------------------------------------------------------------------
+    void SetRebuildRatio(float ratio);
+
+    //-------------------------------------------------------------------------
+    //! @brief      次の更新方法を求めます.
+    //!
+    //! @param[in]      allowRefit  リフィットを許可するかどうか.
+    //! @return     更新方法を返却します.
+    //-------------------------------------------------------------------------
+    UPDATE_MODE GetUpdateMode(bool allowRefit = true) const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      インスタンス記述子を書き込みます.
+    //!
+    //! @param[in]      pDescs      書き込み先です. このバッファに前回書き込んだ内容が残っている必要があります.
+    //! @param[in]      mode        GetUpdateMode() で求めた更新方法です.
+    //! @param[in]      bufferIndex 書き込み先のバッファ番号です. 他のバッファに書き込んだ変更も反映されます.
+    //! @return     書き込んだインスタンス数を返却します.
+    //-------------------------------------------------------------------------
+    uint32_t Write(D3D12_RAYTRACING_INSTANCE_DESC* pDescs, UPDATE_MODE mode, uint32_t bufferIndex = 0);
+
+    //-------------------------------------------------------------------------
+    //! @brief      インスタンス数を取得します.
+    //-------------------------------------------------------------------------
+    uint32_t GetCount() const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      ダーティなインスタンス数を取得します.
+    //-------------------------------------------------------------------------
+    uint32_t GetDirtyCount() const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      構築時に対する現在の表面積比を取得します.
+    //-------------------------------------------------------------------------
+    float GetGrowthRatio() const;
+
+private:
+    ///////////////////////////////////////////////////////////////////////////
+    // Bounds structure
+    ///////////////////////////////////////////////////////////////////////////
+    struct alignas(16) Bounds
+    {
+        float   LocalCenter[4];     //!< ローカル空間での中心です.
+        float   LocalExtent[4];     //!< ローカル空間での半径です.
+        float   WorldMin   [4];     //!< 現在のワールド空間での最小値です.
+        float   WorldMax   [4];     //!< 現在のワールド空間での最大値です.
+        float   BuildMin   [4];     //!< 構築時のワールド空間での最小値です.
+        float   BuildMax   [4];     //!< 構築時のワールド空間での最大値です.
+        double  Growth;             //!< 構築時からの表面積の増加量です.
+    };
+
+    //=========================================================================
+    // private variables.
+    //=========================================================================
+    std::vector<D3D12_RAYTRACING_INSTANCE_DESC> m_Descs;        //!< インスタンス記述子です.
+    std::vector<Bounds>                         m_Bounds;       //!< バウンディングボックスです.
+    std::vector<uint8_t>                        m_Dirty;        //!< ダーティフラグです.
+    std::vector<uint32_t>                       m_DirtyList;    //!< ダーティなインスタンス番号です.
+    std::vector<uint32_t>                       m_StaleMask;    //!< 最新の記述子が未反映のバッファのビットマスクです.
+    std::vector<uint32_t>                       m_StaleList;    //!< いずれかのバッファに未反映のインスタンス番号です.
+    uint32_t                                    m_BufferMask;   //!< 全てのバッファのビットマスクです.
+    uint32_t                                    m_FullWriteMask;//!< 全て書き込む必要があるバッファのビットマスクです.
+    double                                      m_BuildArea;    //!< 構築時の表面積の合計です.
+    double                                      m_GrowthArea;   //!< 表面積の増加量の合計です.
+    float                                       m_RebuildRatio; //!< リビルドを行う表面積比です.
+    bool                                        m_NeedRebuild;  //!< 構成が変わったかどうか.
+
+    //=========================================================================
+    // private methods.
+    //=========================================================================
+    TlasInstanceCache   (const TlasInstanceCache&) = delete;    // アクセス禁止.
+    void operator =     (const TlasInstanceCache&) = delete;    // アクセス禁止.
+
+    void UpdateWorldBounds(uint32_t index, const DirectX::XMMATRIX& transform);
+};
@@ -0,0 +1,294 @@
+﻿//-----------------------------------------------------------------------------
+// File : UploadAllocator.h
+// Desc : Upload Heap Allocator Module.
+// Copyright(c) Pocol. All right reserved.
+//-----------------------------------------------------------------------------
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <d3d12.h>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+
+///////////////////////////////////////////////////////////////////////////////
+// UploadPage structure
+///////////////////////////////////////////////////////////////////////////////
+struct UploadPage
+{
+    ID3D12Resource*             pResource;      //!< リソースです.
+    uint8_t*                    pCpu;           //!< マップ済みポインタです.
+    D3D12_GPU_VIRTUAL_ADDRESS   GpuAddress;     //!< GPU仮想アドレスです.
+    uint64_t                    Size;           //!< サイズです.
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// UploadAllocation structure
+///////////////////////////////////////////////////////////////////////////////
+struct UploadAllocation
+{
+    ID3D12Resource*             pResource;      //!< 所属するページのリソースです.
+    uint8_t*                    pCpu;           //!< 書き込み先です.
+    D3D12_GPU_VIRTUAL_ADDRESS   GpuAddress;     //!< GPU仮想アドレスです.
+    uint64_t                    Offset;         //!< ページ先頭からのオフセットです.
+    uint64_t                    Size;           //!< サイズです.
+    uint32_t                    PageIndex;      //!< ページ番号です.
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// UploadPageBackend class
+///////////////////////////////////////////////////////////////////////////////
+//! @brief      ページの生成・破棄を行うインタフェースです.
+//!
+//! @note       UploadAllocator のオフセット計算や回収処理は CPU だけで完結するので,
+//!             ここを差し替えれば GPU 無しで動作を確認できます.
+class UploadPageBackend
+{
+public:
+    virtual ~UploadPageBackend() = default;
+
+    //-------------------------------------------------------------------------
+    //! @brief      ページを生成します.
+    //!
+    //! @param[in]      size        ページサイズです.
+    //! @param[out]     page        ページの格納先です.
+    //! @retval true    生成に成功.
+    //! @retval false   生成に失敗.
+    //-------------------------------------------------------------------------
+    virtual bool CreatePage(uint64_t size, UploadPage& page) = 0;
+
+    //-------------------------------------------------------------------------
+    //! @brief      ページを破棄します.
+    //!
+    //! @param[in,out]  page        破棄するページです.
+    //-------------------------------------------------------------------------
+    virtual void DestroyPage(UploadPage& page) = 0;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// D3D12UploadPageBackend class
+///////////////////////////////////////////////////////////////////////////////
+class D3D12UploadPageBackend : public UploadPageBackend
+{
+    //=========================================================================
+    // list of friend classes and methods.
+    //=========================================================================
+    /* NOTHING */
+
+public:
+    //=========================================================================
+    // public variables.
+    //=========================================================================
+    /* NOTHING */
+
+    //=========================================================================
+    // public methods.
+    //=========================================================================
+
+    //-------------------------------------------------------------------------
+    //! @brief      コンストラクタです.
+    //-------------------------------------------------------------------------
+    D3D12UploadPageBackend();
+
+    //-------------------------------------------------------------------------
+    //! @brief      デストラクタです.
+    //-------------------------------------------------------------------------
+    ~D3D12UploadPageBackend();
+
+    //-------------------------------------------------------------------------
+    //! @brief      初期化処理を行います.
+    //!
+    //! @param[in]      pDevice     デバイスです.
+    //! @retval true    初期化に成功.
+    //! @retval false   初期化に失敗.
+    //-------------------------------------------------------------------------
+    bool Init(ID3D12Device* pDevice);
+
+    //-------------------------------------------------------------------------
+    //! @brief      終了処理を行います.
+    //-------------------------------------------------------------------------
+    void Term();
+
+    //-------------------------------------------------------------------------
+    //! @brief      UPLOADヒープにバッファを生成し, マップします.
+    //-------------------------------------------------------------------------
+    bool CreatePage(uint64_t size, UploadPage& page) override;
+
+    //-------------------------------------------------------------------------
+    //! @brief      バッファのマップを解除して破棄します.
+    //-------------------------------------------------------------------------
+    void DestroyPage(UploadPage& page) override;
+
+private:
+    //=========================================================================
+    // private variables.
+    //=========================================================================
+    ID3D12Device*   m_pDevice;      //!< デバイスです.
+
+    //=========================================================================
+    // private methods.
+    //=========================================================================
+    D3D12UploadPageBackend  (const D3D12UploadPageBackend&) = delete;  // アクセス禁止.
+    void operator =         (const D3D12UploadPageBackend&) = delete;  // アクセス禁止.
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// UploadAllocator class
+///////////////////////////////////////////////////////////////////////////////
+//! @brief      UPLOADヒープの大きなページから線形にサブアロケートします.
+//!
+//! @note       ページは先頭から詰めて使用し, 隙間は再利用しません. ページ内の割り当てが全て
+//!             解放され, その解放を含むフレームのフェンスが完了した時点でページごと回収して
+//!             再利用します(ページ単位のリングバッファとして動作します).
+//!             Free() や AllocateTransient() の解放は FrameEnd() で渡したフェンス値に紐づき,
+//!             Retire() にそのフェンス値以上の完了値を渡すまで回収されません.
+class UploadAllocator
+{
+    //=========================================================================
+    // list of friend classes and methods.
+    //=========================================================================
+    /* NOTHING */
+
+public:
+    //=========================================================================
+    // public variables.
+    //=========================================================================
+    static constexpr uint64_t DefaultPageSize   = 4 * 1024 * 1024;  //!< 既定のページサイズです.
+    static constexpr uint32_t MaxFreePages      = 4;                //!< 破棄せずに保持する空きページ数です.
+
+    //=========================================================================
+    // public methods.
+    //=========================================================================
+
+    //-------------------------------------------------------------------------
+    //! @brief      コンストラクタです.
+    //-------------------------------------------------------------------------
+    UploadAllocator();
+
+    //-------------------------------------------------------------------------
+    //! @brief      デストラクタです.
+    //-------------------------------------------------------------------------
+    ~UploadAllocator();
+
+    //-------------------------------------------------------------------------
+    //! @brief      初期化処理を行います.
+    //!
+    //! @param[in]      pBackend    ページの生成・破棄を行うバックエンドです.
+    //! @param[in]      pageSize    ページサイズです.
+    //! @retval true    初期化に成功.
+    //! @retval false   初期化に失敗.
+    //-------------------------------------------------------------------------
+    bool Init(UploadPageBackend* pBackend, uint64_t pageSize = DefaultPageSize);
+
+    //-------------------------------------------------------------------------
+    //! @brief      終了処理を行います. 全てのページを破棄します.
+    //-------------------------------------------------------------------------
+    void Term();
+
+    //-------------------------------------------------------------------------
+    //! @brief      Free() するまで有効な領域を確保します.
+    //!
+    //! @param[in]      size        サイズです.
+    //! @param[in]      alignment   アライメントです(2のべき乗).
+    //! @param[out]     result      確保結果の格納先です.
+    //! @retval true    確保に成功.
+    //! @retval false   確保に失敗.
+    //-------------------------------------------------------------------------
+    bool Allocate(uint64_t size, uint64_t alignment, UploadAllocation& result);
+
+    //-------------------------------------------------------------------------
+    //! @brief      現在のフレームの間だけ有効な領域を確保します.
+    //!
+    //! @param[in]      size        サイズです.
+    //! @param[in]      alignment   アライメントです(2のべき乗).
+    //! @param[out]     result      確保結果の格納先です.
+    //! @retval true    確保に成功.
+    //! @retval false   確保に失敗.
+    //-------------------------------------------------------------------------
+    bool AllocateTransient(uint64_t size, uint64_t alignment, UploadAllocation& result);
+
+    //-------------------------------------------------------------------------
+    //! @brief      領域を解放します. 実際の回収は現在のフレームのフェンス完了後です.
+    //!
+    //! @param[in]      allocation  Allocate() で確保した領域です.
+    //-------------------------------------------------------------------------
+    void Free(const UploadAllocation& allocation);
+
+    //-------------------------------------------------------------------------
+    //! @brief      フレームを終了します.
+    //!
+    //! @param[in]      fenceValue  このフレームのコマンドの完了時にシグナルされるフェンス値です.
+    //-------------------------------------------------------------------------
+    void FrameEnd(uint64_t fenceValue);
+
+    //-------------------------------------------------------------------------
+    //! @brief      GPUの処理が完了した領域を回収します.
+    //!
+    //! @param[in]      completedValue  完了済みのフェンス値です.
+    //-------------------------------------------------------------------------
+    void Retire(uint64_t completedValue);
+
+    //-------------------------------------------------------------------------
+    //! @brief      生成済みのページ数を取得します.
+    //!
+    //! @return     生成済みのページ数を返却します.
+    //-------------------------------------------------------------------------
+    uint32_t GetPageCount() const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      ページサイズを取得します.
+    //!
+    //! @return     ページサイズを返却します.
+    //-------------------------------------------------------------------------
+    uint64_t GetPageSize() const;
+
+private:
+    ///////////////////////////////////////////////////////////////////////////
+    // PageState structure
+    ///////////////////////////////////////////////////////////////////////////
+    struct PageState
+    {
+        UploadPage  Page;           //!< ページです.
+        uint64_t    Offset;         //!< 次に割り当てるオフセットです.
+        uint32_t    LiveCount;      //!< 回収されていない割り当て数です.
+        bool        Dedicated;      //!< ページサイズを超える割り当て専用のページかどうか.
+        bool        Valid;          //!< ページが生成済みかどうか.
+    };
+
+    ///////////////////////////////////////////////////////////////////////////
+    // PendingFrame structure
+    ///////////////////////////////////////////////////////////////////////////
+    struct PendingFrame
+    {
+        uint64_t                FenceValue;     //!< 完了を待つフェンス値です.
+        std::vector<uint32_t>   Pages;          //!< 解放する割り当てのページ番号です.
+    };
+
+    //=========================================================================
+    // private variables.
+    //=========================================================================
+    UploadPageBackend*          m_pBackend;         //!< バックエンドです.
+    uint64_t                    m_PageSize;         //!< ページサイズです.
+    std::vector<PageState>      m_Pages;            //!< ページです.
+    std::vector<uint32_t>       m_FreePages;        //!< 再利用可能なページ番号です.
+    std::vector<uint32_t>       m_FreeSlots;        //!< 破棄済みで再利用可能なページ番号です.
+    uint32_t                    m_CurrentPage;      //!< 割り当て中のページ番号です.
+    std::vector<uint32_t>       m_FrameRelease;     //!< 現在のフレームで解放する割り当てのページ番号です.
+    std::deque<PendingFrame>    m_Pending;          //!< フェンス完了待ちのフレームです.
+    mutable std::mutex          m_Mutex;            //!< 排他制御用です.
+
+    //=========================================================================
+    // private methods.
+    //=========================================================================
+    UploadAllocator (const UploadAllocator&) = delete;  // アクセス禁止.
+    void operator = (const UploadAllocator&) = delete;  // アクセス禁止.
+
+    bool AllocateInternal(uint64_t size, uint64_t alignment, UploadAllocation& result);
+    bool CreatePage(uint64_t size, bool dedicated, uint32_t& index);
+    void DestroyPage(uint32_t index);
+    void Release(uint32_t index);
+};
@@ -10,6 +10,7 @@
 //-----------------------------------------------------------------------------
 #include <d3d12.h>
 #include <ComPtr.h>
+#include <UploadAllocator.h>
 
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -49,10 +50,16 @@ public:
     //! @param[in]      size            頂点バッファサイズです.
     //! @param[in]      stride          1頂点あたりのサイズです.
     //! @param[in]      pInitData       初期化データです.
+    //! @param[in]      pAllocator      アップロードアロケータです. nullptr の場合は専用のリソースを生成します.
     //! @retval true    初期化に成功.
     //! @retval false   初期化に失敗.
     //-------------------------------------------------------------------------
-    bool Init(ID3D12Device* pDevice, size_t size, size_t stride, const void* pInitData = nullptr);
+    bool Init(
+        ID3D12Device*       pDevice,
+        size_t              size,
+        size_t              stride,
+        const void*         pInitData  = nullptr,
+        UploadAllocator*    pAllocator = nullptr);
 
     //-------------------------------------------------------------------------
     //! @brief      初期化処理を行います.
@@ -60,12 +67,13 @@ public:
     //! @param[in]      pDevice         デバイスです.
     //! @param[in]      size            頂点バッファサイズです.
     //! @param[in]      pInitData       初期化データです.
+    //! @param[in]      pAllocator      アップロードアロケータです. nullptr の場合は専用のリソースを生成します.
     //! @retval true    初期化に成功.
     //! @retval false   初期化に失敗.
     //-------------------------------------------------------------------------
     template<typename T>
-    bool Init(ID3D12Device* pDevice, size_t size, const T* pInitData = nullptr)
-    { return Init(pDevice, size, sizeof(T), pInitData ); }
+    bool Init(ID3D12Device* pDevice, size_t size, const T* pInitData = nullptr, UploadAllocator* pAllocator = nullptr)
+    { return Init(pDevice, size, sizeof(T), pInitData, pAllocator); }
 
     //-------------------------------------------------------------------------
     //! @brief      終了処理を行います.
@@ -105,12 +113,22 @@ public:
         return m_pVB;
     };
 
+    //-------------------------------------------------------------------------
+    //! @brief      リソース先頭からのオフセットを取得します.
+    //!
+    //! @return     アロケータから切り出した場合はページ内のオフセット, それ以外は 0 を返却します.
+    //-------------------------------------------------------------------------
+    uint64_t GetOffset() const
+    { return m_Allocation.Offset; }
+
 private:
     //=========================================================================
     // private variables.
     //=========================================================================
-    ComPtr<ID3D12Resource>      m_pVB;      //!< 頂点バッファです.
-    D3D12_VERTEX_BUFFER_VIEW    m_View;     //!< 頂点バッファビューです.
+    ComPtr<ID3D12Resource>      m_pVB;          //!< 頂点バッファです.
+    D3D12_VERTEX_BUFFER_VIEW    m_View;         //!< 頂点バッファビューです.
+    UploadAllocator*            m_pAllocator;   //!< アップロードアロケータです.
+    UploadAllocation            m_Allocation;   //!< アップロードアロケータからの割り当てです.
 
     //=========================================================================
     // private methods.
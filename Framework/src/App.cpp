@@ -38,6 +38,9 @@ App::App(uint32_t width, uint32_t height)
 , m_Width           (width)
 , m_Height          (height)
 , m_FrameIndex      (0)
+, m_FrameLatency    (DefaultFrameLatency)
+, m_ResourceHeapSize(DefaultResourceHeapSize)
+, m_FrameSlot       (0)
 , m_RenderType      (RENDER_TYPE::RAYTRACE)
 //, m_WindowEvent     (m_hWnd)
 { /* DO_NOTHING */
@@ -271,13 +274,15 @@ bool App::InitD3D()
         desc.Type           = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
         desc.NumDescriptors = 512;
         desc.Flags          = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
-        if (!DescriptorPool::Create(m_pDevice.Get(), &desc, &m_pPool[POOL_TYPE_RES]))
+
+        // シェーダから見えるヒープは連結できないので, 最大数で確保しておき使う範囲だけを広げる.
+        if (!DescriptorPool::Create(m_pDevice.Get(), &desc, m_ResourceHeapSize, &m_pPool[POOL_TYPE_RES]))
         { return false; }
 
         desc.Type           = D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER;
         desc.NumDescriptors = 256;
         desc.Flags          = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
-        if (!DescriptorPool::Create(m_pDevice.Get(), &desc, &m_pPool[POOL_TYPE_SMP]))
+        if (!DescriptorPool::Create(m_pDevice.Get(), &desc, D3D12_MAX_SHADER_VISIBLE_SAMPLER_HEAP_SIZE, &m_pPool[POOL_TYPE_SMP]))
         { return false; }
 
         desc.Type           = D3D12_DESCRIPTOR_HEAP_TYPE_RTV;
@@ -302,6 +307,18 @@ bool App::InitD3D()
         { return false; }
     }
 
+    // フレーム描画用のコマンドリストプールの生成.
+    {
+        if (!m_CommandListBackend.Init(
+            m_pDevice.Get(),
+            m_pQueue.Get(),
+            D3D12_COMMAND_LIST_TYPE_DIRECT))
+        { return false; }
+
+        if (!m_CommandListPool.Init(&m_CommandListBackend, FrameCount))
+        { return false; }
+    }
+
     // レンダーターゲットビューの生成.
     {
         for (auto i=0u; i<FrameCount; ++i)
@@ -332,6 +349,32 @@ bool App::InitD3D()
     if (!m_Fence.Init(m_pDevice.Get()))
     { return false; }
 
+    // フレームスケジューラの生成.
+    static_assert(FrameCount >= FrameScheduler::MaxLatency, "Per-frame resources must cover the max frame latency.");
+
+    if (!m_FrameTimeline.Init(&m_Fence, m_pQueue.Get()))
+    { return false; }
+
+    if (!m_FrameScheduler.Init(&m_FrameTimeline, m_FrameLatency))
+    { return false; }
+
+    m_FrameSlot = m_FrameScheduler.BeginFrame();
+    m_CommandListPool.BeginFrame(m_FrameSlot);
+
+    // アップロードアロケータの生成.
+    if (!m_UploadBackend.Init(m_pDevice.Get()))
+    { return false; }
+
+    if (!m_UploadAllocator.Init(&m_UploadBackend))
+    { return false; }
+
+    // テクスチャストリーマーの生成.
+    if (!m_TextureStreamBackend.Init(m_pDevice.Get(), m_pPool[POOL_TYPE_RES], m_pQueue.Get()))
+    { return false; }
+
+    if (!m_TextureStreamer.Init(&m_TextureStreamBackend))
+    { return false; }
+
     // ビューポートの設定.
     {
         m_Viewport.TopLeftX = 0.0f;
@@ -362,6 +405,18 @@ void App::TermD3D()
     // GPU処理の完了を待機.
     m_Fence.Sync(m_pQueue.Get());
 
+    // フレームスケジューラの破棄.
+    m_FrameScheduler.Term();
+    m_FrameTimeline.Term();
+
+    // アップロードアロケータの破棄.
+    m_UploadAllocator.Term();
+    m_UploadBackend.Term();
+
+    // テクスチャストリーマーの破棄.
+    m_TextureStreamer.Term();
+    m_TextureStreamBackend.Term();
+
     // フェンス破棄.
     m_Fence.Term();
 
@@ -374,6 +429,8 @@ void App::TermD3D()
 
     // コマンドリストの破棄.
     m_CommandList.Term();
+    m_CommandListPool.Term();
+    m_CommandListBackend.Term();
 
     for(auto i=0; i<POOL_COUNT; ++i)
     {
@@ -423,11 +480,26 @@ void App::Present(uint32_t interval)
     // 画面に表示.
     m_pSwapChain->Present(interval, 0);
 
-    // 完了待ち.
-    m_Fence.Wait( m_pQueue.Get(), INFINITE );
+    // フレームの終了をシグナル. GPUの完了は待たない.
+    auto fenceValue = m_FrameScheduler.EndFrame();
+
+    // このフレームで解放された領域はフレームの完了後に回収.
+    m_UploadAllocator.FrameEnd(fenceValue);
+    m_TextureStreamer.FrameEnd(fenceValue);
+    for(auto i=0; i<POOL_COUNT; ++i)
+    { m_pPool[i]->FrameEnd(fenceValue); }
 
     // フレーム番号を更新.
     m_FrameIndex = m_pSwapChain->GetCurrentBackBufferIndex();
+
+    // 次のフレームの資源が使用中であれば, ここで完了を待機.
+    m_FrameSlot = m_FrameScheduler.BeginFrame();
+    m_CommandListPool.BeginFrame(m_FrameSlot);
+    auto completedValue = m_FrameTimeline.GetCompletedValue();
+    m_UploadAllocator.Retire(completedValue);
+    m_TextureStreamer.Retire(completedValue);
+    for(auto i=0; i<POOL_COUNT; ++i)
+    { m_pPool[i]->Retire(completedValue); }
 }
 
 //-----------------------------------------------------------------------------
@@ -0,0 +1,973 @@
+﻿//-----------------------------------------------------------------------------
+// File : BVH.cpp
+// Desc : CPU Bounding Volume Hierarchy Module.
+// Copyright(c) Pocol. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include "BVH.h"
+#include "ParallelUtil.h"
+#include "Logger.h"
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+#include <thread>
+#include <immintrin.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+constexpr uint32_t  BinCount            = 16;       // SAH のビン数です.
+constexpr uint32_t  MaxLeafSize         = 8;        // 葉ノードあたりの最大三角形数です.
+constexpr float     TraversalCost       = 1.0f;     // ノード走査コストです(三角形判定を1とした相対値).
+constexpr uint32_t  ParallelThreshold   = 4096;     // この三角形数以上の部分木は別スレッドで構築します.
+constexpr uint32_t  StackSize           = 512;      // 走査スタックのサイズです.
+constexpr uint32_t  InvalidIndex        = UINT32_MAX;
+constexpr float     BoxPadding          = 1e-6f;    // ノードのボックスを広げる割合です(境界上を通るレイの取りこぼし防止).
+
+///////////////////////////////////////////////////////////////////////////////
+// Bounds structure
+///////////////////////////////////////////////////////////////////////////////
+struct Bounds
+{
+    float Min[3];
+    float Max[3];
+
+    void Reset()
+    {
+        Min[0] = Min[1] = Min[2] =  FLT_MAX;
+        Max[0] = Max[1] = Max[2] = -FLT_MAX;
+    }
+
+    void Grow(const float* p)
+    {
+        for(auto i=0; i<3; ++i)
+        {
+            Min[i] = std::min(Min[i], p[i]);
+            Max[i] = std::max(Max[i], p[i]);
+        }
+    }
+
+    void Grow(const Bounds& b)
+    {
+        for(auto i=0; i<3; ++i)
+        {
+            Min[i] = std::min(Min[i], b.Min[i]);
+            Max[i] = std::max(Max[i], b.Max[i]);
+        }
+    }
+
+    float Area() const
+    {
+        auto dx = Max[0] - Min[0];
+        auto dy = Max[1] - Min[1];
+        auto dz = Max[2] - Min[2];
+        if (dx < 0.0f || dy < 0.0f || dz < 0.0f)
+        { return 0.0f; }
+        return 2.0f * (dx * dy + dy * dz + dz * dx);
+    }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// PrimRef structure
+///////////////////////////////////////////////////////////////////////////////
+struct PrimRef
+{
+    Bounds      Box;        //!< 三角形のバウンディングボックスです.
+    float       Center[3];  //!< バウンディングボックスの中心です.
+    uint32_t    Index;      //!< 収集した三角形配列上の番号です.
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// BuildNode structure
+///////////////////////////////////////////////////////////////////////////////
+struct BuildNode
+{
+    Bounds      Box;        //!< バウンディングボックスです.
+    uint32_t    Left;       //!< 左の子ノード番号です.
+    uint32_t    Right;      //!< 右の子ノード番号です.
+    uint32_t    Begin;      //!< 葉の先頭プリミティブ番号です.
+    uint32_t    Count;      //!< 葉のプリミティブ数です. 0 の場合は節です.
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// BinaryBuilder class
+///////////////////////////////////////////////////////////////////////////////
+class BinaryBuilder
+{
+public:
+    BinaryBuilder(std::vector<PrimRef>& refs)
+    : m_Refs        (refs)
+    , m_NodeCount   (1)
+    , m_MaxDepth    (0)
+    {
+        // 葉は1つ以上のプリミティブを持つので, ノード数は 2n - 1 を超えません.
+        m_Nodes.resize(std::max<size_t>(refs.size() * 2, 1));
+
+        // 論理コア数を使い切る程度の深さまで並列に分岐させます.
+        auto threads = GetWorkerThreadCount();
+        while((1u << m_MaxDepth) < threads)
+        { m_MaxDepth++; }
+    }
+
+    void Build()
+    {
+        Subdivide(0, 0, uint32_t(m_Refs.size()), 0);
+        m_Nodes.resize(m_NodeCount.load());
+    }
+
+    const std::vector<BuildNode>& GetNodes() const
+    { return m_Nodes; }
+
+private:
+    std::vector<PrimRef>&   m_Refs;
+    std::vector<BuildNode>  m_Nodes;
+    std::atomic<uint32_t>   m_NodeCount;
+    uint32_t                m_MaxDepth;
+
+    void MakeLeaf(BuildNode& node, uint32_t begin, uint32_t end)
+    {
+        node.Left  = InvalidIndex;
+        node.Right = InvalidIndex;
+        node.Begin = begin;
+        node.Count = end - begin;
+    }
+
+    void Subdivide(uint32_t nodeIndex, uint32_t begin, uint32_t end, uint32_t depth)
+    {
+        auto& node  = m_Nodes[nodeIndex];
+        auto  count = end - begin;
+
+        // バウンディングボックスと中心の範囲を求める.
+        Bounds centerBox;
+        node.Box.Reset();
+        centerBox.Reset();
+        for(auto i=begin; i<end; ++i)
+        {
+            node.Box.Grow(m_Refs[i].Box);
+            centerBox.Grow(m_Refs[i].Center);
+        }
+
+        if (count <= 1)
+        {
+            MakeLeaf(node, begin, end);
+            return;
+        }
+
+        // ビニングSAHで最良の分割を探します.
+        auto bestAxis  = -1;
+        auto bestSplit = 0u;
+        auto bestCost  = FLT_MAX;
+
+        for(auto axis=0; axis<3; ++axis)
+        {
+            auto extent = centerBox.Max[axis] - centerBox.Min[axis];
+            if (extent <= 0.0f)
+            { continue; }
+
+            Bounds   binBox  [BinCount];
+            uint32_t binCount[BinCount] = {};
+            for(auto& box : binBox)
+            { box.Reset(); }
+
+            auto scale = float(BinCount) / extent;
+            for(auto i=begin; i<end; ++i)
+            {
+                auto bin = std::min(uint32_t((m_Refs[i].Center[axis] - centerBox.Min[axis]) * scale), BinCount - 1);
+                binBox  [bin].Grow(m_Refs[i].Box);
+                binCount[bin]++;
+            }
+
+            // 右側から累積したコストを求めておく.
+            float    rightCost[BinCount] = {};
+            Bounds   rightBox;
+            uint32_t rightCount = 0;
+            rightBox.Reset();
+            for(auto i=BinCount - 1; i>0; --i)
+            {
+                rightBox.Grow(binBox[i]);
+                rightCount += binCount[i];
+                rightCost[i] = rightBox.Area() * rightCount;
+            }
+
+            Bounds   leftBox;
+            uint32_t leftCount = 0;
+            leftBox.Reset();
+            for(auto i=1u; i<BinCount; ++i)
+            {
+                leftBox.Grow(binBox[i - 1]);
+                leftCount += binCount[i - 1];
+
+                auto cost = leftBox.Area() * leftCount + rightCost[i];
+                if (cost < bestCost)
+                {
+                    bestCost  = cost;
+                    bestAxis  = axis;
+                    bestSplit = i;
+                }
+            }
+        }
+
+        // 全ての中心が一致している場合.
+        if (bestAxis < 0)
+        {
+            if (count <= MaxLeafSize)
+            {
+                MakeLeaf(node, begin, end);
+                return;
+            }
+
+            SplitChildren(nodeIndex, begin, begin + count / 2, end, depth);
+            return;
+        }
+
+        // 葉にした方が安い場合は分割しない.
+        auto area      = node.Box.Area();
+        auto splitCost = TraversalCost + ((area > 0.0f) ? bestCost / area : 0.0f);
+        if (count <= MaxLeafSize && float(count) <= splitCost)
+        {
+            MakeLeaf(node, begin, end);
+            return;
+        }
+
+        // 分割位置で振り分け.
+        auto minValue = centerBox.Min[bestAxis];
+        auto scale    = float(BinCount) / (centerBox.Max[bestAxis] - minValue);
+        auto itr = std::partition(m_Refs.begin() + begin, m_Refs.begin() + end,
+            [&](const PrimRef& ref)
+            {
+                auto bin = std::min(uint32_t((ref.Center[bestAxis] - minValue) * scale), BinCount - 1);
+                return bin < bestSplit;
+            });
+
+        auto mid = uint32_t(itr - m_Refs.begin());
+        if (mid == begin || mid == end)
+        {
+            // 偏りすぎた場合は中央値で分割します.
+            mid = begin + count / 2;
+            std::nth_element(m_Refs.begin() + begin, m_Refs.begin() + mid, m_Refs.begin() + end,
+                [&](const PrimRef& lhs, const PrimRef& rhs)
+                { return lhs.Center[bestAxis] < rhs.Center[bestAxis]; });
+        }
+
+        SplitChildren(nodeIndex, begin, mid, end, depth);
+    }
+
+    void SplitChildren(uint32_t nodeIndex, uint32_t begin, uint32_t mid, uint32_t end, uint32_t depth)
+    {
+        auto left  = m_NodeCount.fetch_add(2);
+        auto right = left + 1;
+
+        auto& node = m_Nodes[nodeIndex];
+        node.Left  = left;
+        node.Right = right;
+        node.Begin = 0;
+        node.Count = 0;
+
+        // 大きな部分木は片方を別スレッドで構築します.
+        if (depth < m_MaxDepth && (end - begin) >= ParallelThreshold)
+        {
+            std::thread thread([=]() { Subdivide(left, begin, mid, depth + 1); });
+            Subdivide(right, mid, end, depth + 1);
+            thread.join();
+            return;
+        }
+
+        Subdivide(left,  begin, mid, depth + 1);
+        Subdivide(right, mid,   end, depth + 1);
+    }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// RayData structure
+///////////////////////////////////////////////////////////////////////////////
+struct RayData
+{
+    float   Origin[3];
+    float   Dir[3];
+    float   InvDir[3];
+};
+
+//-----------------------------------------------------------------------------
+//      ボックスの最小値を広げます.
+//-----------------------------------------------------------------------------
+inline float PadMin(float value)
+{ return value - BoxPadding * std::max(1.0f, fabsf(value)); }
+
+//-----------------------------------------------------------------------------
+//      ボックスの最大値を広げます.
+//-----------------------------------------------------------------------------
+inline float PadMax(float value)
+{ return value + BoxPadding * std::max(1.0f, fabsf(value)); }
+
+//-----------------------------------------------------------------------------
+//      ゼロ除算を避けて逆数を求めます.
+//-----------------------------------------------------------------------------
+inline float SafeInverse(float value)
+{
+    if (fabsf(value) < 1e-20f)
+    { value = copysignf(1e-20f, value); }
+    return 1.0f / value;
+}
+
+//-----------------------------------------------------------------------------
+//      ゼロ除算を避けて逆数を求めます(SSE版).
+//-----------------------------------------------------------------------------
+inline __m128 SafeInverse4(__m128 value)
+{
+    auto sign = _mm_and_ps(value, _mm_set1_ps(-0.0f));
+    auto absv = _mm_andnot_ps(_mm_set1_ps(-0.0f), value);
+    auto tiny = _mm_cmplt_ps(absv, _mm_set1_ps(1e-20f));
+    value = _mm_or_ps(_mm_and_ps(tiny, _mm_or_ps(sign, _mm_set1_ps(1e-20f))), _mm_andnot_ps(tiny, value));
+    return _mm_div_ps(_mm_set1_ps(1.0f), value);
+}
+
+//-----------------------------------------------------------------------------
+//      最下位のセットされたビット位置を求めます.
+//-----------------------------------------------------------------------------
+inline uint32_t FirstBitLow(uint32_t mask)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return uint32_t(index);
+#else
+    return uint32_t(__builtin_ctz(mask));
+#endif
+}
+
+//-----------------------------------------------------------------------------
+//      条件に応じて値を選択します.
+//-----------------------------------------------------------------------------
+inline __m128 Select(__m128 mask, __m128 a, __m128 b)
+{ return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+
+} // namespace
+
+
+///////////////////////////////////////////////////////////////////////////////
+// WideBVH class
+///////////////////////////////////////////////////////////////////////////////
+
+//-----------------------------------------------------------------------------
+//      コンストラクタです.
+//-----------------------------------------------------------------------------
+template<uint32_t N>
+WideBVH<N>::WideBVH()
+: m_BoxMin(0.0f, 0.0f, 0.0f)
+, m_BoxMax(0.0f, 0.0f, 0.0f)
+{
+    static_assert(N == 4 || N == 8, "WideBVH supports only 4 or 8 children.");
+}
+
+//-----------------------------------------------------------------------------
+//      デストラクタです.
+//-----------------------------------------------------------------------------
+template<uint32_t N>
+WideBVH<N>::~WideBVH()
+{ Term(); }
+
+//-----------------------------------------------------------------------------
+//      初期化処理を行います.
+//-----------------------------------------------------------------------------
+template<uint32_t N>
+bool WideBVH<N>::Init(const std::vector<ResMesh>& meshes)
+{ return Build(meshes.data(), meshes.size()); }
+
+//-----------------------------------------------------------------------------
+//      初期化処理を行います.
+//-----------------------------------------------------------------------------
+template<uint32_t N>
+bool WideBVH<N>::Init(const ResMesh& mesh)
+{ return Build(&mesh, 1); }
+
+//-----------------------------------------------------------------------------
+//      終了処理を行います.
+//-----------------------------------------------------------------------------
+template<uint32_t N>
+void WideBVH<N>::Term()
+{
+    m_Nodes    .clear();
+    m_Triangles.clear();
+    m_BoxMin = DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f);
+    m_BoxMax = DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f);
+}
+
+//-----------------------------------------------------------------------------
+//      BVHを構築します.
+//-----------------------------------------------------------------------------
+template<uint32_t N>
+bool WideBVH<N>::Build(const ResMesh* pMeshes, size_t meshCount)
+{
+    Term();
+
+    // 三角形を収集.
+    std::vector<Triangle> triangles;
+    {
+        size_t count = 0;
+        for(size_t i=0; i<meshCount; ++i)
+        { count += pMeshes[i].Indices.size() / 3; }
+        triangles.reserve(count);
+    }
+
+    uint32_t primitiveId = 0;
+    for(size_t m=0; m<meshCount; ++m)
+    {
+        auto& mesh = pMeshes[m];
+        for(size_t i=0; i + 2<mesh.Indices.size(); i+=3, ++primitiveId)
+        {
+            auto i0 = mesh.Indices[i + 0];
+            auto i1 = mesh.Indices[i + 1];
+            auto i2 = mesh.Indices[i + 2];
+
+            // 不正なインデックスは番号だけ進めて除外します.
+            if (i0 >= mesh.Vertices.size() || i1 >= mesh.Vertices.size() || i2 >= mesh.Vertices.size())
+            { continue; }
+
+            auto& p0 = mesh.Vertices[i0].Position;
+            auto& p1 = mesh.Vertices[i1].Position;
+            auto& p2 = mesh.Vertices[i2].Position;
+
+            Triangle tri;
+            tri.P0          = p0;
+            tri.PrimitiveId = primitiveId;
+            tri.E1          = DirectX::XMFLOAT3(p1.x - p0.x, p1.y - p0.y, p1.z - p0.z);
+            tri.E2          = DirectX::XMFLOAT3(p2.x - p0.x, p2.y - p0.y, p2.z - p0.z);
+            triangles.push_back(tri);
+        }
+    }
+
+    if (triangles.empty())
+    {
+        ELOG( "Error : Invalid Argument." );
+        return false;
+    }
+
+    // プリミティブ参照を生成.
+    std::vector<PrimRef> refs(triangles.size());
+    ParallelFor(refs.size(), [&](size_t i)
+    {
+        auto& tri = triangles[i];
+        float p0[3] = { tri.P0.x, tri.P0.y, tri.P0.z };
+        float p1[3] = { tri.P0.x + tri.E1.x, tri.P0.y + tri.E1.y, tri.P0.z + tri.E1.z };
+        float p2[3] = { tri.P0.x + tri.E2.x, tri.P0.y + tri.E2.y, tri.P0.z + tri.E2.z };
+
+        auto& ref = refs[i];
+        ref.Box.Reset();
+        ref.Box.Grow(p0);
+        ref.Box.Grow(p1);
+        ref.Box.Grow(p2);
+        for(auto j=0; j<3; ++j)
+        { ref.Center[j] = (ref.Box.Min[j] + ref.Box.Max[j]) * 0.5f; }
+        ref.Index = uint32_t(i);
+    });
+
+    // 2分木を構築.
+    BinaryBuilder builder(refs);
+    builder.Build();
+    auto& binary = builder.GetNodes();
+
+    // 葉の順に三角形を並べ替え.
+    m_Triangles.resize(refs.size());
+    for(size_t i=0; i<refs.size(); ++i)
+    { m_Triangles[i] = triangles[refs[i].Index]; }
+
+    auto& root = binary[0].Box;
+    m_BoxMin = DirectX::XMFLOAT3(root.Min[0], root.Min[1], root.Min[2]);
+    m_BoxMax = DirectX::XMFLOAT3(root.Max[0], root.Max[1], root.Max[2]);
+
+    // N分木に変換します. 表面積の大きい子から展開して N 個まで詰めます.
+    m_Nodes.reserve(binary.size() / (N - 1) + 1);
+
+    struct CollapseTask
+    {
+        uint32_t BinaryIndex;
+        uint32_t WideIndex;
+    };
+
+    std::vector<CollapseTask> tasks;
+    m_Nodes.emplace_back();
+    tasks.push_back({ 0, 0 });
+
+    while(!tasks.empty())
+    {
+        auto task = tasks.back();
+        tasks.pop_back();
+
+        uint32_t children[N];
+        uint32_t childCount = 0;
+
+        if (binary[task.BinaryIndex].Count > 0)
+        {
+            // ルートが葉の場合.
+            children[childCount++] = task.BinaryIndex;
+        }
+        else
+        {
+            children[childCount++] = binary[task.BinaryIndex].Left;
+            children[childCount++] = binary[task.BinaryIndex].Right;
+
+            while(childCount < N)
+            {
+                auto best     = -1;
+                auto bestArea = -1.0f;
+                for(auto i=0u; i<childCount; ++i)
+                {
+                    auto& child = binary[children[i]];
+                    if (child.Count == 0 && child.Box.Area() > bestArea)
+                    {
+                        best     = int(i);
+                        bestArea = child.Box.Area();
+                    }
+                }
+
+                if (best < 0)
+                { break; }
+
+                auto& expand = binary[children[best]];
+                children[best]         = expand.Left;
+                children[childCount++] = expand.Right;
+            }
+        }
+
+        Node node = {};
+        node.ChildCount = childCount;
+        for(auto i=0u; i<N; ++i)
+        {
+            if (i >= childCount)
+            {
+                // 空きレーンは判定されないように反転したボックスにしておく.
+                node.MinX[i] = node.MinY[i] = node.MinZ[i] =  FLT_MAX;
+                node.MaxX[i] = node.MaxY[i] = node.MaxZ[i] = -FLT_MAX;
+                node.Child[i] = InvalidIndex;
+                node.Count[i] = 0;
+                continue;
+            }
+
+            // 軸に平行なレイがボックスの面上を通ると, スラブの距離が 0 になって外れと判定されるので少し広げておく.
+            auto& child = binary[children[i]];
+            node.MinX[i] = PadMin(child.Box.Min[0]);
+            node.MinY[i] = PadMin(child.Box.Min[1]);
+            node.MinZ[i] = PadMin(child.Box.Min[2]);
+            node.MaxX[i] = PadMax(child.Box.Max[0]);
+            node.MaxY[i] = PadMax(child.Box.Max[1]);
+            node.MaxZ[i] = PadMax(child.Box.Max[2]);
+
+            if (child.Count > 0)
+            {
+                node.Child[i] = child.Begin;
+                node.Count[i] = child.Count;
+            }
+            else
+            {
+                auto wideIndex = uint32_t(m_Nodes.size());
+                m_Nodes.emplace_back();
+                tasks.push_back({ children[i], wideIndex });
+
+                node.Child[i] = wideIndex;
+                node.Count[i] = 0;
+            }
+        }
+
+        m_Nodes[task.WideIndex] = node;
+    }
+
+    m_Nodes.shrink_to_fit();
+
+    // 正常終了.
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      最近接交差を求めます.
+//-----------------------------------------------------------------------------
+template<uint32_t N>
+bool WideBVH<N>::Intersect(const BVHRay& ray, BVHHit& hit) const
+{ return Traverse(ray, hit, false); }
+
+//-----------------------------------------------------------------------------
+//      いずれかの三角形と交差するかどうかチェックします.
+//-----------------------------------------------------------------------------
+template<uint32_t N>
+bool WideBVH<N>::Occluded(const BVHRay& ray) const
+{
+    BVHHit hit;
+    return Traverse(ray, hit, true);
+}
+
+//-----------------------------------------------------------------------------
+//      4本のレイの最近接交差をまとめて求めます.
+//-----------------------------------------------------------------------------
+template<uint32_t N>
+uint32_t WideBVH<N>::Intersect4(const BVHRayPacket4& rays, BVHHitPacket4& hits) const
+{ return Traverse4(rays, hits, false); }
+
+//-----------------------------------------------------------------------------
+//      4本のレイの遮蔽をまとめて判定します.
+//-----------------------------------------------------------------------------
+template<uint32_t N>
+uint32_t WideBVH<N>::Occluded4(const BVHRayPacket4& rays) const
+{
+    BVHHitPacket4 hits;
+    return Traverse4(rays, hits, true);
+}
+
+//-----------------------------------------------------------------------------
+//      単一レイの走査を行います.
+//-----------------------------------------------------------------------------
+template<uint32_t N>
+bool WideBVH<N>::Traverse(const BVHRay& ray, BVHHit& hit, bool anyHit) const
+{
+    hit.Distance    = ray.TMax;
+    hit.U           = 0.0f;
+    hit.V           = 0.0f;
+    hit.PrimitiveId = InvalidIndex;
+
+    if (m_Nodes.empty())
+    { return false; }
+
+    RayData r;
+    r.Origin[0] = ray.Origin.x;
+    r.Origin[1] = ray.Origin.y;
+    r.Origin[2] = ray.Origin.z;
+    r.Dir[0]    = ray.Direction.x;
+    r.Dir[1]    = ray.Direction.y;
+    r.Dir[2]    = ray.Direction.z;
+    for(auto i=0; i<3; ++i)
+    { r.InvDir[i] = SafeInverse(r.Dir[i]); }
+
+    const auto ox = _mm_set1_ps(r.Origin[0]);
+    const auto oy = _mm_set1_ps(r.Origin[1]);
+    const auto oz = _mm_set1_ps(r.Origin[2]);
+    const auto ix = _mm_set1_ps(r.InvDir[0]);
+    const auto iy = _mm_set1_ps(r.InvDir[1]);
+    const auto iz = _mm_set1_ps(r.InvDir[2]);
+    const auto t0 = _mm_set1_ps(ray.TMin);
+
+#if defined(__AVX__)
+    const auto ox8 = _mm256_set1_ps(r.Origin[0]);
+    const auto oy8 = _mm256_set1_ps(r.Origin[1]);
+    const auto oz8 = _mm256_set1_ps(r.Origin[2]);
+    const auto ix8 = _mm256_set1_ps(r.InvDir[0]);
+    const auto iy8 = _mm256_set1_ps(r.InvDir[1]);
+    const auto iz8 = _mm256_set1_ps(r.InvDir[2]);
+    const auto t08 = _mm256_set1_ps(ray.TMin);
+#endif
+
+    struct StackEntry
+    {
+        uint32_t    Index;
+        float       Distance;
+    };
+
+    StackEntry stack[StackSize];
+    uint32_t   top = 0;
+    stack[top++] = { 0, ray.TMin };
+
+    auto found = false;
+
+    while(top > 0)
+    {
+        auto entry = stack[--top];
+        if (entry.Distance > hit.Distance)
+        { continue; }
+
+        auto& node = m_Nodes[entry.Index];
+
+        // 子のバウンディングボックスをまとめて判定.
+        alignas(32) float tnear[N];
+        uint32_t mask = 0;
+
+#if defined(__AVX__)
+        if constexpr (N == 8)
+        {
+            auto tmax = _mm256_set1_ps(hit.Distance);
+            auto x0 = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(node.MinX), ox8), ix8);
+            auto x1 = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(node.MaxX), ox8), ix8);
+            auto y0 = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(node.MinY), oy8), iy8);
+            auto y1 = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(node.MaxY), oy8), iy8);
+            auto z0 = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(node.MinZ), oz8), iz8);
+            auto z1 = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(node.MaxZ), oz8), iz8);
+
+            auto tn = _mm256_max_ps(_mm256_max_ps(_mm256_min_ps(x0, x1), _mm256_min_ps(y0, y1)), _mm256_max_ps(_mm256_min_ps(z0, z1), t08));
+            auto tf = _mm256_min_ps(_mm256_min_ps(_mm256_max_ps(x0, x1), _mm256_max_ps(y0, y1)), _mm256_min_ps(_mm256_max_ps(z0, z1), tmax));
+
+            _mm256_store_ps(tnear, tn);
+            mask = uint32_t(_mm256_movemask_ps(_mm256_cmp_ps(tn, tf, _CMP_LE_OQ)));
+        }
+        else
+#endif
+        {
+            auto tmax = _mm_set1_ps(hit.Distance);
+            for(auto c=0u; c<N; c+=4)
+            {
+                auto x0 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.MinX + c), ox), ix);
+                auto x1 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.MaxX + c), ox), ix);
+                auto y0 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.MinY + c), oy), iy);
+                auto y1 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.MaxY + c), oy), iy);
+                auto z0 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.MinZ + c), oz), iz);
+                auto z1 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.MaxZ + c), oz), iz);
+
+                auto tn = _mm_max_ps(_mm_max_ps(_mm_min_ps(x0, x1), _mm_min_ps(y0, y1)), _mm_max_ps(_mm_min_ps(z0, z1), t0));
+                auto tf = _mm_min_ps(_mm_min_ps(_mm_max_ps(x0, x1), _mm_max_ps(y0, y1)), _mm_min_ps(_mm_max_ps(z0, z1), tmax));
+
+                _mm_store_ps(tnear + c, tn);
+                mask |= uint32_t(_mm_movemask_ps(_mm_cmple_ps(tn, tf))) << c;
+            }
+        }
+
+        mask &= (1u << node.ChildCount) - 1u;
+
+        // 葉は即座に判定し, 節は近い順に取り出せるように積みます.
+        auto base = top;
+        while(mask != 0)
+        {
+            auto i = FirstBitLow(mask);
+            mask &= mask - 1;
+
+            if (node.Count[i] == 0)
+            {
+                if (top >= StackSize)
+                {
+                    assert(false && "BVH stack overflow");
+                    continue;
+                }
+
+                // 挿入ソート(距離の降順).
+                auto pos = top++;
+                while(pos > base && stack[pos - 1].Distance < tnear[i])
+                {
+                    stack[pos] = stack[pos - 1];
+                    pos--;
+                }
+                stack[pos] = { node.Child[i], tnear[i] };
+                continue;
+            }
+
+            // Moller-Trumbore 法で三角形と判定.
+            auto end = node.Child[i] + node.Count[i];
+            for(auto t=node.Child[i]; t<end; ++t)
+            {
+                auto& tri = m_Triangles[t];
+                float e1[3] = { tri.E1.x, tri.E1.y, tri.E1.z };
+                float e2[3] = { tri.E2.x, tri.E2.y, tri.E2.z };
+
+                float p[3] = {
+                    r.Dir[1] * e2[2] - r.Dir[2] * e2[1],
+                    r.Dir[2] * e2[0] - r.Dir[0] * e2[2],
+                    r.Dir[0] * e2[1] - r.Dir[1] * e2[0] };
+                auto det = e1[0] * p[0] + e1[1] * p[1] + e1[2] * p[2];
+                if (fabsf(det) < 1e-12f)
+                { continue; }
+
+                auto invDet = 1.0f / det;
+                float s[3] = { r.Origin[0] - tri.P0.x, r.Origin[1] - tri.P0.y, r.Origin[2] - tri.P0.z };
+                auto u = (s[0] * p[0] + s[1] * p[1] + s[2] * p[2]) * invDet;
+                if (u < 0.0f || u > 1.0f)
+                { continue; }
+
+                float q[3] = {
+                    s[1] * e1[2] - s[2] * e1[1],
+                    s[2] * e1[0] - s[0] * e1[2],
+                    s[0] * e1[1] - s[1] * e1[0] };
+                auto v = (r.Dir[0] * q[0] + r.Dir[1] * q[1] + r.Dir[2] * q[2]) * invDet;
+                if (v < 0.0f || u + v > 1.0f)
+                { continue; }
+
+                auto dist = (e2[0] * q[0] + e2[1] * q[1] + e2[2] * q[2]) * invDet;
+                if (dist <= ray.TMin || dist >= hit.Distance)
+                { continue; }
+
+                hit.Distance    = dist;
+                hit.U           = u;
+                hit.V           = v;
+                hit.PrimitiveId = tri.PrimitiveId;
+                found = true;
+
+                if (anyHit)
+                { return true; }
+            }
+        }
+    }
+
+    return found;
+}
+
+//-----------------------------------------------------------------------------
+//      4本のレイの走査を行います.
+//-----------------------------------------------------------------------------
+template<uint32_t N>
+uint32_t WideBVH<N>::Traverse4(const BVHRayPacket4& rays, BVHHitPacket4& hits, bool anyHit) const
+{
+    auto ox   = _mm_load_ps(rays.OriginX);
+    auto oy   = _mm_load_ps(rays.OriginY);
+    auto oz   = _mm_load_ps(rays.OriginZ);
+    auto dx   = _mm_load_ps(rays.DirectionX);
+    auto dy   = _mm_load_ps(rays.DirectionY);
+    auto dz   = _mm_load_ps(rays.DirectionZ);
+    auto ix   = SafeInverse4(dx);
+    auto iy   = SafeInverse4(dy);
+    auto iz   = SafeInverse4(dz);
+    auto tmin = _mm_load_ps(rays.TMin);
+    auto tmax = _mm_load_ps(rays.TMax);
+
+    auto dist = tmax;
+    auto hitU = _mm_setzero_ps();
+    auto hitV = _mm_setzero_ps();
+    auto prim = _mm_castsi128_ps(_mm_set1_epi32(-1));
+
+    auto active   = uint32_t(_mm_movemask_ps(_mm_cmplt_ps(tmin, tmax)));
+    auto occluded = 0u;
+
+    uint32_t stack[StackSize];
+    uint32_t top = 0;
+    if (!m_Nodes.empty() && active != 0)
+    { stack[top++] = 0; }
+
+    while(top > 0 && active != 0)
+    {
+        auto& node = m_Nodes[stack[--top]];
+
+        for(auto i=0u; i<node.ChildCount; ++i)
+        {
+            // 1つの子に対して4本のレイを同時に判定.
+            auto x0 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.MinX[i]), ox), ix);
+            auto x1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.MaxX[i]), ox), ix);
+            auto y0 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.MinY[i]), oy), iy);
+            auto y1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.MaxY[i]), oy), iy);
+            auto z0 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.MinZ[i]), oz), iz);
+            auto z1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.MaxZ[i]), oz), iz);
+
+            auto tn = _mm_max_ps(_mm_max_ps(_mm_min_ps(x0, x1), _mm_min_ps(y0, y1)), _mm_max_ps(_mm_min_ps(z0, z1), tmin));
+            auto tf = _mm_min_ps(_mm_min_ps(_mm_max_ps(x0, x1), _mm_max_ps(y0, y1)), _mm_min_ps(_mm_max_ps(z0, z1), dist));
+
+            auto mask = uint32_t(_mm_movemask_ps(_mm_cmple_ps(tn, tf))) & active;
+            if (mask == 0)
+            { continue; }
+
+            if (node.Count[i] == 0)
+            {
+                if (top < StackSize)
+                { stack[top++] = node.Child[i]; }
+                else
+                { assert(false && "BVH stack overflow"); }
+                continue;
+            }
+
+            // 三角形と4本のレイを同時に判定.
+            auto end = node.Child[i] + node.Count[i];
+            for(auto t=node.Child[i]; t<end; ++t)
+            {
+                auto& tri = m_Triangles[t];
+                auto e1x = _mm_set1_ps(tri.E1.x), e1y = _mm_set1_ps(tri.E1.y), e1z = _mm_set1_ps(tri.E1.z);
+                auto e2x = _mm_set1_ps(tri.E2.x), e2y = _mm_set1_ps(tri.E2.y), e2z = _mm_set1_ps(tri.E2.z);
+
+                auto px = _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(dz, e2y));
+                auto py = _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(dx, e2z));
+                auto pz = _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(dy, e2x));
+                auto det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+                auto invDet = _mm_div_ps(_mm_set1_ps(1.0f), det);
+
+                auto sx = _mm_sub_ps(ox, _mm_set1_ps(tri.P0.x));
+                auto sy = _mm_sub_ps(oy, _mm_set1_ps(tri.P0.y));
+                auto sz = _mm_sub_ps(oz, _mm_set1_ps(tri.P0.z));
+                auto u  = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, px), _mm_mul_ps(sy, py)), _mm_mul_ps(sz, pz)), invDet);
+
+                auto qx = _mm_sub_ps(_mm_mul_ps(sy, e1z), _mm_mul_ps(sz, e1y));
+                auto qy = _mm_sub_ps(_mm_mul_ps(sz, e1x), _mm_mul_ps(sx, e1z));
+                auto qz = _mm_sub_ps(_mm_mul_ps(sx, e1y), _mm_mul_ps(sy, e1x));
+                auto v  = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, qx), _mm_mul_ps(dy, qy)), _mm_mul_ps(dz, qz)), invDet);
+                auto d  = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)), invDet);
+
+                auto absDet = _mm_andnot_ps(_mm_set1_ps(-0.0f), det);
+                auto valid  = _mm_cmpge_ps(absDet, _mm_set1_ps(1e-12f));
+                valid = _mm_and_ps(valid, _mm_cmpge_ps(u, _mm_setzero_ps()));
+                valid = _mm_and_ps(valid, _mm_cmpge_ps(v, _mm_setzero_ps()));
+                valid = _mm_and_ps(valid, _mm_cmple_ps(_mm_add_ps(u, v), _mm_set1_ps(1.0f)));
+                valid = _mm_and_ps(valid, _mm_cmpgt_ps(d, tmin));
+                valid = _mm_and_ps(valid, _mm_cmplt_ps(d, dist));
+
+                auto hitMask = uint32_t(_mm_movemask_ps(valid)) & active;
+                if (hitMask == 0)
+                { continue; }
+
+                static const uint32_t LaneMask[16][4] = {
+                    {0,0,0,0},{~0u,0,0,0},{0,~0u,0,0},{~0u,~0u,0,0},
+                    {0,0,~0u,0},{~0u,0,~0u,0},{0,~0u,~0u,0},{~0u,~0u,~0u,0},
+                    {0,0,0,~0u},{~0u,0,0,~0u},{0,~0u,0,~0u},{~0u,~0u,0,~0u},
+                    {0,0,~0u,~0u},{~0u,0,~0u,~0u},{0,~0u,~0u,~0u},{~0u,~0u,~0u,~0u} };
+                valid = _mm_loadu_ps(reinterpret_cast<const float*>(LaneMask[hitMask]));
+
+                dist = Select(valid, d, dist);
+                hitU = Select(valid, u, hitU);
+                hitV = Select(valid, v, hitV);
+                prim = Select(valid, _mm_castsi128_ps(_mm_set1_epi32(int(tri.PrimitiveId))), prim);
+
+                if (anyHit)
+                {
+                    // 遮蔽が確定したレイは以降の走査から外します.
+                    occluded |= hitMask;
+                    active   &= ~hitMask;
+                    if (active == 0)
+                    { break; }
+                }
+            }
+
+            if (active == 0)
+            { break; }
+        }
+    }
+
+    _mm_store_ps(hits.Distance, dist);
+    _mm_store_ps(hits.U, hitU);
+    _mm_store_ps(hits.V, hitV);
+    _mm_store_ps(reinterpret_cast<float*>(hits.PrimitiveId), prim);
+
+    if (anyHit)
+    { return occluded; }
+
+    // 全ビットが立った値は NaN になるので整数として比較します.
+    auto miss = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_castps_si128(prim), _mm_set1_epi32(-1)));
+    return uint32_t(~_mm_movemask_ps(miss)) & 0xFu;
+}
+
+//-----------------------------------------------------------------------------
+//      全体のバウンディングボックスを取得します.
+//-----------------------------------------------------------------------------
+template<uint32_t N>
+void WideBVH<N>::GetBounds(DirectX::XMFLOAT3& boxMin, DirectX::XMFLOAT3& boxMax) const
+{
+    boxMin = m_BoxMin;
+    boxMax = m_BoxMax;
+}
+
+//-----------------------------------------------------------------------------
+//      ノード数を取得します.
+//-----------------------------------------------------------------------------
+template<uint32_t N>
+size_t WideBVH<N>::GetNodeCount() const
+{ return m_Nodes.size(); }
+
+//-----------------------------------------------------------------------------
+//      三角形数を取得します.
+//-----------------------------------------------------------------------------
+template<uint32_t N>
+size_t WideBVH<N>::GetPrimitiveCount() const
+{ return m_Triangles.size(); }
+
+//-----------------------------------------------------------------------------
+// Explicit Instantiation.
+//-----------------------------------------------------------------------------
+template class WideBVH<4>;
+template class WideBVH<8>;
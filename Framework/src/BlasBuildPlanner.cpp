@@ -0,0 +1,119 @@
+﻿//-----------------------------------------------------------------------------
+// File : BlasBuildPlanner.cpp
+// Desc : Bottom Level Acceleration Structure Build Planner Module.
+// Copyright(c) Pocol. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include "BlasBuildPlanner.h"
+#include <algorithm>
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+constexpr uint64_t kBlasAlignment = 256;    // D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BYTE_ALIGNMENT.
+
+} // namespace
+
+
+//-----------------------------------------------------------------------------
+//      アクセラレーション構造のアライメントにサイズを揃えます.
+//-----------------------------------------------------------------------------
+uint64_t AlignBlasSize(uint64_t size)
+{ return (size + kBlasAlignment - 1) & ~(kBlasAlignment - 1); }
+
+//-----------------------------------------------------------------------------
+//      BLAS の構築をバッチに分け, スクラッチと結果の配置を決めます.
+//-----------------------------------------------------------------------------
+bool PlanBlasBuild
+(
+    const BlasSizeInfo* pSizes,
+    uint32_t            count,
+    uint64_t            budget,
+    BlasBuildPlan&      plan
+)
+{
+    plan.Items  .clear();
+    plan.Batches.clear();
+    plan.ScratchArenaSize = 0;
+    plan.ResultArenaSize  = 0;
+    plan.MaxBatchCount    = 0;
+
+    if (pSizes == nullptr && count > 0)
+    { return false; }
+
+    plan.Items.reserve(count);
+
+    BlasBuildBatch batch = {};
+    for(auto i=0u; i<count; ++i)
+    {
+        auto scratch = AlignBlasSize(pSizes[i].ScratchSize);
+        auto result  = AlignBlasSize(pSizes[i].ResultSize);
+        if (result == 0)
+        { return false; }
+
+        // 上限を超えるなら現在のバッチを閉じる. 空のバッチには必ず1つは入れる.
+        auto used = batch.ScratchSize + batch.ResultSize;
+        if (batch.Count > 0 && used + scratch + result > budget)
+        {
+            plan.Batches.push_back(batch);
+
+            batch = {};
+            batch.First = uint32_t(plan.Items.size());
+        }
+
+        BlasBuildItem item = {};
+        item.Index         = i;
+        item.ScratchOffset = batch.ScratchSize;
+        item.ResultOffset  = batch.ResultSize;
+        plan.Items.push_back(item);
+
+        batch.ScratchSize += scratch;
+        batch.ResultSize  += result;
+        batch.Count++;
+    }
+
+    if (batch.Count > 0)
+    { plan.Batches.push_back(batch); }
+
+    // アリーナはバッチ間で使い回すので最大値に合わせる.
+    for(auto& itr : plan.Batches)
+    {
+        plan.ScratchArenaSize = std::max(plan.ScratchArenaSize, itr.ScratchSize);
+        plan.ResultArenaSize  = std::max(plan.ResultArenaSize,  itr.ResultSize);
+        plan.MaxBatchCount    = std::max(plan.MaxBatchCount,    itr.Count);
+    }
+
+    // 正常終了.
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      圧縮後の BLAS を1つのバッファに詰める配置を決めます.
+//-----------------------------------------------------------------------------
+void PlanBlasCompaction
+(
+    const uint64_t*     pCompactedSizes,
+    const uint64_t*     pSourceSizes,
+    uint32_t            count,
+    BlasCompactionPlan& plan
+)
+{
+    plan.Offsets.resize(count);
+    plan.TotalSize  = 0;
+    plan.SourceSize = 0;
+
+    for(auto i=0u; i<count; ++i)
+    {
+        plan.Offsets[i]  = plan.TotalSize;
+        plan.TotalSize  += AlignBlasSize(pCompactedSizes[i]);
+
+        if (pSourceSizes != nullptr)
+        { plan.SourceSize += AlignBlasSize(pSourceSizes[i]); }
+    }
+}
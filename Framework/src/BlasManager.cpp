@@ -0,0 +1,425 @@
+﻿//-----------------------------------------------------------------------------
+// File : BlasManager.cpp
+// Desc : Bottom Level Acceleration Structure Manager Module.
+// Copyright(c) Pocol. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include "BlasManager.h"
+#include "Mesh.h"
+#include "Logger.h"
+#include <cassert>
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+constexpr D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAGS kBuildFlags =
+    D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_ALLOW_COMPACTION |
+    D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PREFER_FAST_TRACE;
+
+//-----------------------------------------------------------------------------
+//      バッファを生成します.
+//-----------------------------------------------------------------------------
+bool CreateBuffer
+(
+    ID3D12Device*           pDevice,
+    D3D12_HEAP_TYPE         type,
+    uint64_t                size,
+    D3D12_RESOURCE_FLAGS    flags,
+    D3D12_RESOURCE_STATES   state,
+    ID3D12Resource**        ppResource
+)
+{
+    // ヒーププロパティ.
+    D3D12_HEAP_PROPERTIES prop = {};
+    prop.Type                   = type;
+    prop.CPUPageProperty        = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+    prop.MemoryPoolPreference   = D3D12_MEMORY_POOL_UNKNOWN;
+    prop.CreationNodeMask       = 1;
+    prop.VisibleNodeMask        = 1;
+
+    // リソースの設定.
+    D3D12_RESOURCE_DESC desc = {};
+    desc.Dimension          = D3D12_RESOURCE_DIMENSION_BUFFER;
+    desc.Alignment          = 0;
+    desc.Width              = UINT64(size);
+    desc.Height             = 1;
+    desc.DepthOrArraySize   = 1;
+    desc.MipLevels          = 1;
+    desc.Format             = DXGI_FORMAT_UNKNOWN;
+    desc.SampleDesc.Count   = 1;
+    desc.SampleDesc.Quality = 0;
+    desc.Layout             = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+    desc.Flags              = flags;
+
+    auto hr = pDevice->CreateCommittedResource(
+        &prop,
+        D3D12_HEAP_FLAG_NONE,
+        &desc,
+        state,
+        nullptr,
+        IID_PPV_ARGS(ppResource));
+    if (FAILED(hr))
+    {
+        ELOG( "Error : ID3D12Device::CreateCommittedResource() Failed. retcode = 0x%x", hr );
+        return false;
+    }
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      コマンドリストを実行して完了を待ちます.
+//-----------------------------------------------------------------------------
+bool ExecuteAndWait(ID3D12CommandQueue* pQueue, ID3D12GraphicsCommandList4* pCmd, Fence& fence)
+{
+    auto hr = pCmd->Close();
+    if (FAILED(hr))
+    {
+        ELOG( "Error : ID3D12GraphicsCommandList::Close() Failed. retcode = 0x%x", hr );
+        return false;
+    }
+
+    ID3D12CommandList* pLists[] = { pCmd };
+    pQueue->ExecuteCommandLists(1, pLists);
+    fence.Sync(pQueue);
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      リソースバリアを設定します.
+//-----------------------------------------------------------------------------
+void Transition
+(
+    ID3D12GraphicsCommandList4* pCmd,
+    ID3D12Resource*             pResource,
+    D3D12_RESOURCE_STATES       before,
+    D3D12_RESOURCE_STATES       after
+)
+{
+    D3D12_RESOURCE_BARRIER barrier = {};
+    barrier.Type                   = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+    barrier.Transition.pResource   = pResource;
+    barrier.Transition.StateBefore = before;
+    barrier.Transition.StateAfter  = after;
+    barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+    pCmd->ResourceBarrier(1, &barrier);
+}
+
+} // namespace
+
+
+///////////////////////////////////////////////////////////////////////////////
+// BlasManager class
+///////////////////////////////////////////////////////////////////////////////
+
+//-----------------------------------------------------------------------------
+//      コンストラクタです.
+//-----------------------------------------------------------------------------
+BlasManager::BlasManager()
+: m_pDevice         ()
+, m_Budget          (DefaultBudget)
+, m_SourceSize      (0)
+, m_CompactedSize   (0)
+{ /* DO_NOTHING */ }
+
+//-----------------------------------------------------------------------------
+//      デストラクタです.
+//-----------------------------------------------------------------------------
+BlasManager::~BlasManager()
+{ Term(); }
+
+//-----------------------------------------------------------------------------
+//      初期化処理を行います.
+//-----------------------------------------------------------------------------
+bool BlasManager::Init(ID3D12Device5* pDevice, uint64_t budget)
+{
+    if (pDevice == nullptr || budget == 0)
+    { return false; }
+
+    m_pDevice       = pDevice;
+    m_Budget        = budget;
+    m_SourceSize    = 0;
+    m_CompactedSize = 0;
+
+    // 正常終了.
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      終了処理を行います.
+//-----------------------------------------------------------------------------
+void BlasManager::Term()
+{
+    m_pBuffers.clear();
+    m_Entries .clear();
+    m_pDevice.Reset();
+
+    m_SourceSize    = 0;
+    m_CompactedSize = 0;
+}
+
+//-----------------------------------------------------------------------------
+//      メッシュの BLAS を登録します.
+//-----------------------------------------------------------------------------
+uint32_t BlasManager::AddMesh(const Mesh* pMesh)
+{
+    if (pMesh == nullptr || pMesh->GetVertexCount() == 0)
+    { return InvalidIndex; }
+
+    if (pMesh->IsPacked())
+    {
+        ELOG( "Error : PackedVertex Mesh is not supported for BLAS." );
+        return InvalidIndex;
+    }
+
+    auto vbv = pMesh->GetVertexBuffer().GetView();
+
+    // MeshVertex の位置は先頭の float3.
+    Entry entry = {};
+    entry.Geometry.Type  = D3D12_RAYTRACING_GEOMETRY_TYPE_TRIANGLES;
+    entry.Geometry.Flags = D3D12_RAYTRACING_GEOMETRY_FLAG_OPAQUE;
+    entry.Geometry.Triangles.VertexBuffer.StartAddress  = vbv.BufferLocation;
+    entry.Geometry.Triangles.VertexBuffer.StrideInBytes = vbv.StrideInBytes;
+    entry.Geometry.Triangles.VertexFormat               = DXGI_FORMAT_R32G32B32_FLOAT;
+    entry.Geometry.Triangles.VertexCount                = pMesh->GetVertexCount();
+
+    if (pMesh->GetIndexCount() > 0)
+    {
+        auto ibv = pMesh->GetIndexBuffer().GetView();
+        entry.Geometry.Triangles.IndexBuffer = ibv.BufferLocation;
+        entry.Geometry.Triangles.IndexFormat = ibv.Format;
+        entry.Geometry.Triangles.IndexCount  = pMesh->GetIndexCount();
+    }
+
+    entry.Buffer = InvalidIndex;
+    entry.Offset = 0;
+    entry.Built  = false;
+
+    m_Entries.push_back(entry);
+    return uint32_t(m_Entries.size() - 1);
+}
+
+//-----------------------------------------------------------------------------
+//      未構築の BLAS を構築して圧縮します.
+//-----------------------------------------------------------------------------
+bool BlasManager::Build(ID3D12CommandQueue* pQueue, CommandList& cmdList, Fence& fence)
+{
+    if (m_pDevice == nullptr || pQueue == nullptr)
+    { return false; }
+
+    std::vector<uint32_t> pending;
+    for(auto i=0u; i<m_Entries.size(); ++i)
+    {
+        if (!m_Entries[i].Built)
+        { pending.push_back(i); }
+    }
+
+    if (pending.empty())
+    { return true; }
+
+    // プリビルド情報を取得.
+    std::vector<BlasSizeInfo> sizes(pending.size());
+    for(size_t i=0; i<pending.size(); ++i)
+    {
+        D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS inputs = {};
+        GetInputs(pending[i], inputs);
+
+        D3D12_RAYTRACING_ACCELERATION_STRUCTURE_PREBUILD_INFO info = {};
+        m_pDevice->GetRaytracingAccelerationStructurePrebuildInfo(&inputs, &info);
+
+        sizes[i].ScratchSize = info.ScratchDataSizeInBytes;
+        sizes[i].ResultSize  = info.ResultDataMaxSizeInBytes;
+    }
+
+    BlasBuildPlan plan;
+    if (!PlanBlasBuild(sizes.data(), uint32_t(sizes.size()), m_Budget, plan))
+    {
+        ELOG( "Error : PlanBlasBuild() Failed." );
+        return false;
+    }
+
+    // アリーナは全バッチで使い回し, この関数を抜けるときに解放される.
+    ComPtr<ID3D12Resource> pScratch;
+    ComPtr<ID3D12Resource> pResult;
+    ComPtr<ID3D12Resource> pPostbuild;
+    ComPtr<ID3D12Resource> pReadback;
+
+    auto postbuildSize = uint64_t(plan.MaxBatchCount) * sizeof(uint64_t);
+
+    if (!CreateBuffer(m_pDevice.Get(), D3D12_HEAP_TYPE_DEFAULT, plan.ScratchArenaSize,
+            D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS,
+            D3D12_RESOURCE_STATE_UNORDERED_ACCESS, pScratch.GetAddressOf())
+     || !CreateBuffer(m_pDevice.Get(), D3D12_HEAP_TYPE_DEFAULT, plan.ResultArenaSize,
+            D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS,
+            D3D12_RESOURCE_STATE_RAYTRACING_ACCELERATION_STRUCTURE, pResult.GetAddressOf())
+     || !CreateBuffer(m_pDevice.Get(), D3D12_HEAP_TYPE_DEFAULT, postbuildSize,
+            D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS,
+            D3D12_RESOURCE_STATE_UNORDERED_ACCESS, pPostbuild.GetAddressOf())
+     || !CreateBuffer(m_pDevice.Get(), D3D12_HEAP_TYPE_READBACK, postbuildSize,
+            D3D12_RESOURCE_FLAG_NONE,
+            D3D12_RESOURCE_STATE_COPY_DEST, pReadback.GetAddressOf()))
+    { return false; }
+
+    auto scratchAddress   = pScratch  ->GetGPUVirtualAddress();
+    auto resultAddress    = pResult   ->GetGPUVirtualAddress();
+    auto postbuildAddress = pPostbuild->GetGPUVirtualAddress();
+
+    std::vector<uint64_t> compactedSizes(plan.MaxBatchCount);
+    std::vector<uint64_t> sourceSizes   (plan.MaxBatchCount);
+
+    for(auto& batch : plan.Batches)
+    {
+        auto pCmd = cmdList.Reset();
+        if (pCmd == nullptr)
+        {
+            ELOG( "Error : CommandList::Reset() Failed." );
+            return false;
+        }
+
+        // バッチ内の構築はスクラッチ領域が重ならないので, 間にバリアは不要.
+        for(auto i=0u; i<batch.Count; ++i)
+        {
+            auto& item = plan.Items[batch.First + i];
+
+            D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC desc = {};
+            GetInputs(pending[item.Index], desc.Inputs);
+            desc.DestAccelerationStructureData    = resultAddress  + item.ResultOffset;
+            desc.ScratchAccelerationStructureData = scratchAddress + item.ScratchOffset;
+
+            D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_DESC postbuild = {};
+            postbuild.InfoType   = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_COMPACTED_SIZE;
+            postbuild.DestBuffer = postbuildAddress + i * sizeof(uint64_t);
+
+            pCmd->BuildRaytracingAccelerationStructure(&desc, 1, &postbuild);
+        }
+
+        D3D12_RESOURCE_BARRIER barrier = {};
+        barrier.Type          = D3D12_RESOURCE_BARRIER_TYPE_UAV;
+        barrier.UAV.pResource = pPostbuild.Get();
+        pCmd->ResourceBarrier(1, &barrier);
+
+        Transition(pCmd, pPostbuild.Get(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COPY_SOURCE);
+        pCmd->CopyBufferRegion(pReadback.Get(), 0, pPostbuild.Get(), 0, batch.Count * sizeof(uint64_t));
+        Transition(pCmd, pPostbuild.Get(), D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+
+        if (!ExecuteAndWait(pQueue, pCmd, fence))
+        { return false; }
+
+        // 圧縮後のサイズを読み戻す.
+        void* pData = nullptr;
+        D3D12_RANGE readRange = { 0, size_t(batch.Count * sizeof(uint64_t)) };
+        auto hr = pReadback->Map(0, &readRange, &pData);
+        if (FAILED(hr))
+        {
+            ELOG( "Error : ID3D12Resource::Map() Failed. retcode = 0x%x", hr );
+            return false;
+        }
+
+        auto pSizes = static_cast<const uint64_t*>(pData);
+        for(auto i=0u; i<batch.Count; ++i)
+        {
+            compactedSizes[i] = pSizes[i];
+            sourceSizes   [i] = sizes[plan.Items[batch.First + i].Index].ResultSize;
+        }
+
+        D3D12_RANGE writeRange = { 0, 0 };
+        pReadback->Unmap(0, &writeRange);
+
+        BlasCompactionPlan compaction;
+        PlanBlasCompaction(compactedSizes.data(), sourceSizes.data(), batch.Count, compaction);
+
+        ComPtr<ID3D12Resource> pCompacted;
+        if (!CreateBuffer(m_pDevice.Get(), D3D12_HEAP_TYPE_DEFAULT, compaction.TotalSize,
+                D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS,
+                D3D12_RESOURCE_STATE_RAYTRACING_ACCELERATION_STRUCTURE, pCompacted.GetAddressOf()))
+        { return false; }
+
+        pCmd = cmdList.Reset();
+        if (pCmd == nullptr)
+        {
+            ELOG( "Error : CommandList::Reset() Failed." );
+            return false;
+        }
+
+        auto compactedAddress = pCompacted->GetGPUVirtualAddress();
+        for(auto i=0u; i<batch.Count; ++i)
+        {
+            auto& item = plan.Items[batch.First + i];
+            pCmd->CopyRaytracingAccelerationStructure(
+                compactedAddress + compaction.Offsets[i],
+                resultAddress    + item.ResultOffset,
+                D3D12_RAYTRACING_ACCELERATION_STRUCTURE_COPY_MODE_COMPACT);
+        }
+
+        // コピーが終わるまで結果アリーナは次のバッチに使えない.
+        if (!ExecuteAndWait(pQueue, pCmd, fence))
+        { return false; }
+
+        auto bufferIndex = uint32_t(m_pBuffers.size());
+        m_pBuffers.push_back(pCompacted);
+
+        for(auto i=0u; i<batch.Count; ++i)
+        {
+            auto& entry = m_Entries[pending[plan.Items[batch.First + i].Index]];
+            entry.Buffer = bufferIndex;
+            entry.Offset = compaction.Offsets[i];
+            entry.Built  = true;
+        }
+
+        m_SourceSize    += compaction.SourceSize;
+        m_CompactedSize += compaction.TotalSize;
+    }
+
+    // 正常終了.
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      BLAS のGPU仮想アドレスを取得します.
+//-----------------------------------------------------------------------------
+D3D12_GPU_VIRTUAL_ADDRESS BlasManager::GetAddress(uint32_t index) const
+{
+    assert(index < m_Entries.size());
+    auto& entry = m_Entries[index];
+    if (!entry.Built)
+    { return 0; }
+
+    return m_pBuffers[entry.Buffer]->GetGPUVirtualAddress() + entry.Offset;
+}
+
+//-----------------------------------------------------------------------------
+//      登録されている BLAS 数を取得します.
+//-----------------------------------------------------------------------------
+uint32_t BlasManager::GetCount() const
+{ return uint32_t(m_Entries.size()); }
+
+//-----------------------------------------------------------------------------
+//      圧縮前のサイズの合計を取得します.
+//-----------------------------------------------------------------------------
+uint64_t BlasManager::GetSourceSize() const
+{ return m_SourceSize; }
+
+//-----------------------------------------------------------------------------
+//      圧縮後のサイズの合計を取得します.
+//-----------------------------------------------------------------------------
+uint64_t BlasManager::GetCompactedSize() const
+{ return m_CompactedSize; }
+
+//-----------------------------------------------------------------------------
+//      構築入力を設定します.
+//-----------------------------------------------------------------------------
+void BlasManager::GetInputs(uint32_t index, D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS& inputs) const
+{
+    inputs.Type           = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL;
+    inputs.Flags          = kBuildFlags;
+    inputs.NumDescs       = 1;
+    inputs.DescsLayout    = D3D12_ELEMENTS_LAYOUT_ARRAY;
+    inputs.pGeometryDescs = &m_Entries[index].Geometry;
+}
@@ -0,0 +1,1407 @@
+﻿//-----------------------------------------------------------------------------
+// File : BlockCompressor.cpp
+// Desc : Block Compression Module.
+// Copyright(c) Pocol. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include "BlockCompressor.h"
+#include "DdsFile.h"
+#include "Logger.h"
+#include "MappedFile.h"
+#include "ParallelUtil.h"
+#include <Windows.h>
+#include <algorithm>
+#include <array>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <immintrin.h>
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+constexpr uint32_t BC7Weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+//-----------------------------------------------------------------------------
+// Type Definitions
+//-----------------------------------------------------------------------------
+typedef void (*CompressBlockFunc)(const uint8_t* pRGBA, uint8_t* pBlock);
+
+///////////////////////////////////////////////////////////////////////////////
+// BitWriter structure
+///////////////////////////////////////////////////////////////////////////////
+struct BitWriter
+{
+    uint64_t    Bits[2] = {};
+    uint32_t    Pos     = 0;
+
+    void Write(uint64_t value, uint32_t count)
+    {
+        auto word  = Pos >> 6;
+        auto shift = Pos & 63;
+        Bits[word] |= value << shift;
+        if (shift + count > 64)
+        { Bits[word + 1] |= value >> (64 - shift); }
+        Pos += count;
+    }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// BitReader structure
+///////////////////////////////////////////////////////////////////////////////
+struct BitReader
+{
+    uint64_t    Bits[2];
+    uint32_t    Pos = 0;
+
+    uint32_t Read(uint32_t count)
+    {
+        auto word  = Pos >> 6;
+        auto shift = Pos & 63;
+        auto value = Bits[word] >> shift;
+        if (shift + count > 64)
+        { value |= Bits[word + 1] << (64 - shift); }
+        Pos += count;
+        return uint32_t(value & ((1ull << count) - 1));
+    }
+};
+
+//-----------------------------------------------------------------------------
+//      4要素の内積を求めます.
+//-----------------------------------------------------------------------------
+inline float Dot4(__m128 lhs, __m128 rhs)
+{
+    auto v = _mm_mul_ps(lhs, rhs);
+    v = _mm_add_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+    v = _mm_add_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+    return _mm_cvtss_f32(v);
+}
+
+//-----------------------------------------------------------------------------
+//      4要素の合計を求めます.
+//-----------------------------------------------------------------------------
+inline float HorizontalSum(__m128 value)
+{ return Dot4(value, _mm_set1_ps(1.0f)); }
+
+//-----------------------------------------------------------------------------
+//      対称行列の主成分の軸をべき乗法で求めます.
+//-----------------------------------------------------------------------------
+template<int N>
+void FindPrincipalAxis(const float (&cov)[N][N], float (&axis)[N])
+{
+    for(auto iter=0; iter<8; ++iter)
+    {
+        float next[N] = {};
+        for(auto i=0; i<N; ++i)
+        {
+            for(auto j=0; j<N; ++j)
+            { next[i] += cov[i][j] * axis[j]; }
+        }
+
+        auto length = 0.0f;
+        for(auto i=0; i<N; ++i)
+        { length = std::max(length, fabsf(next[i])); }
+
+        // 分散が無い場合は初期値の軸のままにする.
+        if (length < FLT_EPSILON)
+        { break; }
+
+        for(auto i=0; i<N; ++i)
+        { axis[i] = next[i] / length; }
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      RGB を 565 に量子化します.
+//-----------------------------------------------------------------------------
+inline uint16_t PackColor565(const float (&color)[3])
+{
+    auto r = uint32_t(std::min(std::max(color[0] * (31.0f / 255.0f) + 0.5f, 0.0f), 31.0f));
+    auto g = uint32_t(std::min(std::max(color[1] * (63.0f / 255.0f) + 0.5f, 0.0f), 63.0f));
+    auto b = uint32_t(std::min(std::max(color[2] * (31.0f / 255.0f) + 0.5f, 0.0f), 31.0f));
+    return uint16_t((r << 11) | (g << 5) | b);
+}
+
+//-----------------------------------------------------------------------------
+//      565 を RGB に展開します.
+//-----------------------------------------------------------------------------
+inline void UnpackColor565(uint16_t value, int (&color)[3])
+{
+    auto r = (value >> 11) & 0x1F;
+    auto g = (value >> 5)  & 0x3F;
+    auto b = value & 0x1F;
+    color[0] = (r << 3) | (r >> 2);
+    color[1] = (g << 2) | (g >> 4);
+    color[2] = (b << 3) | (b >> 2);
+}
+
+//-----------------------------------------------------------------------------
+//      BC1 の4色モードのパレットを求めます.
+//-----------------------------------------------------------------------------
+void MakePaletteBC1(uint16_t c0, uint16_t c1, int (&palette)[4][3])
+{
+    UnpackColor565(c0, palette[0]);
+    UnpackColor565(c1, palette[1]);
+    for(auto i=0; i<3; ++i)
+    {
+        palette[2][i] = (2 * palette[0][i] + palette[1][i] + 1) / 3;
+        palette[3][i] = (palette[0][i] + 2 * palette[1][i] + 1) / 3;
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      BC4 のパレットを求めます.
+//-----------------------------------------------------------------------------
+void MakePaletteBC4(int a0, int a1, int (&palette)[8])
+{
+    palette[0] = a0;
+    palette[1] = a1;
+    if (a0 > a1)
+    {
+        for(auto i=2; i<8; ++i)
+        { palette[i] = ((8 - i) * a0 + (i - 1) * a1 + 3) / 7; }
+    }
+    else
+    {
+        for(auto i=2; i<6; ++i)
+        { palette[i] = ((6 - i) * a0 + (i - 1) * a1 + 2) / 5; }
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      最も近いパレットの番号を4ピクセルずつ選びます.
+//-----------------------------------------------------------------------------
+template<int ChannelCount, int PaletteCount>
+float FitIndices
+(
+    const float*    (&channels)[ChannelCount],
+    const int       (&palette)[PaletteCount][ChannelCount],
+    uint32_t        (&indices)[16]
+)
+{
+    auto total = _mm_setzero_ps();
+    for(auto i=0; i<16; i+=4)
+    {
+        __m128 pixel[ChannelCount];
+        for(auto c=0; c<ChannelCount; ++c)
+        { pixel[c] = _mm_load_ps(channels[c] + i); }
+
+        auto best      = _mm_set1_ps(FLT_MAX);
+        auto bestIndex = _mm_setzero_si128();
+        for(auto k=0; k<PaletteCount; ++k)
+        {
+            auto dist = _mm_setzero_ps();
+            for(auto c=0; c<ChannelCount; ++c)
+            {
+                auto d = _mm_sub_ps(pixel[c], _mm_set1_ps(float(palette[k][c])));
+                dist = _mm_add_ps(dist, _mm_mul_ps(d, d));
+            }
+
+            auto mask = _mm_castps_si128(_mm_cmplt_ps(dist, best));
+            best      = _mm_min_ps(dist, best);
+            bestIndex = _mm_or_si128(_mm_andnot_si128(mask, bestIndex), _mm_and_si128(mask, _mm_set1_epi32(k)));
+        }
+
+        total = _mm_add_ps(total, best);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(indices + i), bestIndex);
+    }
+
+    return HorizontalSum(total);
+}
+
+//-----------------------------------------------------------------------------
+//      BC1 のパレットを評価します.
+//-----------------------------------------------------------------------------
+float EvaluateBC1
+(
+    const float*    (&channels)[3],
+    uint16_t        c0,
+    uint16_t        c1,
+    uint32_t        (&indices)[16]
+)
+{
+    int palette[4][3];
+    MakePaletteBC1(c0, c1, palette);
+    return FitIndices(channels, palette, indices);
+}
+
+//-----------------------------------------------------------------------------
+//      番号を固定して端点を最小二乗法で求めます.
+//-----------------------------------------------------------------------------
+bool RefineEndpointsBC1
+(
+    const float*    (&channels)[3],
+    const uint32_t  (&indices)[16],
+    float           (&e0)[3],
+    float           (&e1)[3]
+)
+{
+    static const float kWeight[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+
+    float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+    float ax[3] = {}, bx[3] = {};
+    for(auto i=0; i<16; ++i)
+    {
+        auto a = kWeight[indices[i]];
+        auto b = 1.0f - a;
+        aa += a * a;
+        ab += a * b;
+        bb += b * b;
+        for(auto c=0; c<3; ++c)
+        {
+            ax[c] += a * channels[c][i];
+            bx[c] += b * channels[c][i];
+        }
+    }
+
+    auto det = aa * bb - ab * ab;
+    if (fabsf(det) < FLT_EPSILON)
+    { return false; }
+
+    auto invDet = 1.0f / det;
+    for(auto c=0; c<3; ++c)
+    {
+        e0[c] = (bb * ax[c] - ab * bx[c]) * invDet;
+        e1[c] = (aa * bx[c] - ab * ax[c]) * invDet;
+    }
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      BC1 のカラーブロックを書き込みます.
+//-----------------------------------------------------------------------------
+void WriteBlockBC1(uint16_t c0, uint16_t c1, uint32_t (&indices)[16], uint8_t* pBlock)
+{
+    // 4色モードにするため color0 > color1 にする. 入れ替えるとパレットは 0<->1, 2<->3 になる.
+    if (c0 < c1)
+    {
+        std::swap(c0, c1);
+        for(auto& index : indices)
+        { index ^= 1; }
+    }
+    else if (c0 == c1)
+    {
+        for(auto& index : indices)
+        { index = 0; }
+    }
+
+    uint32_t bits = 0;
+    for(auto i=0; i<16; ++i)
+    { bits |= indices[i] << (i * 2); }
+
+    memcpy(pBlock + 0, &c0,   sizeof(c0));
+    memcpy(pBlock + 2, &c1,   sizeof(c1));
+    memcpy(pBlock + 4, &bits, sizeof(bits));
+}
+
+//-----------------------------------------------------------------------------
+//      BC1 のカラーブロックを展開します.
+//-----------------------------------------------------------------------------
+void DecodeColorBlock(const uint8_t* pBlock, bool forceFourColor, uint8_t* pRGBA)
+{
+    uint16_t c0, c1;
+    uint32_t bits;
+    memcpy(&c0,   pBlock + 0, sizeof(c0));
+    memcpy(&c1,   pBlock + 2, sizeof(c1));
+    memcpy(&bits, pBlock + 4, sizeof(bits));
+
+    int palette[4][3];
+    MakePaletteBC1(c0, c1, palette);
+
+    auto threeColor = !forceFourColor && (c0 <= c1);
+    if (threeColor)
+    {
+        int e0[3], e1[3];
+        UnpackColor565(c0, e0);
+        UnpackColor565(c1, e1);
+        for(auto i=0; i<3; ++i)
+        {
+            palette[2][i] = (e0[i] + e1[i]) / 2;
+            palette[3][i] = 0;
+        }
+    }
+
+    for(auto i=0; i<16; ++i)
+    {
+        auto index = (bits >> (i * 2)) & 0x3;
+        pRGBA[i * 4 + 0] = uint8_t(palette[index][0]);
+        pRGBA[i * 4 + 1] = uint8_t(palette[index][1]);
+        pRGBA[i * 4 + 2] = uint8_t(palette[index][2]);
+        pRGBA[i * 4 + 3] = (threeColor && index == 3) ? 0 : 255;
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      BC4 のブロックを展開します.
+//-----------------------------------------------------------------------------
+void DecodeBlockBC4(const uint8_t* pBlock, uint8_t* pValues, size_t stride)
+{
+    int palette[8];
+    MakePaletteBC4(pBlock[0], pBlock[1], palette);
+
+    uint64_t bits = 0;
+    for(auto i=0; i<6; ++i)
+    { bits |= uint64_t(pBlock[2 + i]) << (i * 8); }
+
+    for(auto i=0; i<16; ++i)
+    { pValues[i * stride] = uint8_t(palette[(bits >> (i * 3)) & 0x7]); }
+}
+
+//-----------------------------------------------------------------------------
+//      BC7 のモード6のブロックを展開します.
+//-----------------------------------------------------------------------------
+bool DecodeBlockBC7(const uint8_t* pBlock, uint8_t* pRGBA)
+{
+    BitReader reader;
+    memcpy(reader.Bits, pBlock, sizeof(reader.Bits));
+
+    if (reader.Read(7) != 0x40)
+    { return false; }
+
+    uint32_t endpoint[2][4];
+    for(auto c=0; c<4; ++c)
+    {
+        endpoint[0][c] = reader.Read(7);
+        endpoint[1][c] = reader.Read(7);
+    }
+
+    auto p0 = reader.Read(1);
+    auto p1 = reader.Read(1);
+    for(auto c=0; c<4; ++c)
+    {
+        endpoint[0][c] = (endpoint[0][c] << 1) | p0;
+        endpoint[1][c] = (endpoint[1][c] << 1) | p1;
+    }
+
+    for(auto i=0; i<16; ++i)
+    {
+        auto index = reader.Read((i == 0) ? 3 : 4);
+        auto w     = BC7Weights4[index];
+        for(auto c=0; c<4; ++c)
+        { pRGBA[i * 4 + c] = uint8_t(((64 - w) * endpoint[0][c] + w * endpoint[1][c] + 32) >> 6); }
+    }
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      BC4 の圧縮を RGBA8 の R に対して行います.
+//-----------------------------------------------------------------------------
+void CompressBlockBC4R(const uint8_t* pRGBA, uint8_t* pBlock)
+{ CompressBlockBC4(pRGBA, 4, pBlock); }
+
+//-----------------------------------------------------------------------------
+//      フォーマットに対応する圧縮関数を取得します.
+//-----------------------------------------------------------------------------
+CompressBlockFunc GetCompressFunc(DXGI_FORMAT format)
+{
+    switch(format)
+    {
+    case DXGI_FORMAT_BC1_UNORM:
+    case DXGI_FORMAT_BC1_UNORM_SRGB:
+        return CompressBlockBC1;
+
+    case DXGI_FORMAT_BC3_UNORM:
+    case DXGI_FORMAT_BC3_UNORM_SRGB:
+        return CompressBlockBC3;
+
+    case DXGI_FORMAT_BC4_UNORM:
+        return CompressBlockBC4R;
+
+    case DXGI_FORMAT_BC5_UNORM:
+        return CompressBlockBC5;
+
+    case DXGI_FORMAT_BC7_UNORM:
+    case DXGI_FORMAT_BC7_UNORM_SRGB:
+        return CompressBlockBC7;
+
+    default:
+        return nullptr;
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      ブロックのバイト数を取得します.
+//-----------------------------------------------------------------------------
+size_t GetBlockBytes(DXGI_FORMAT format)
+{
+    switch(format)
+    {
+    case DXGI_FORMAT_BC1_UNORM:
+    case DXGI_FORMAT_BC1_UNORM_SRGB:
+    case DXGI_FORMAT_BC4_UNORM:
+        return 8;
+
+    default:
+        return 16;
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      圧縮で保持するチャンネル数を取得します.
+//-----------------------------------------------------------------------------
+uint32_t GetChannelCount(DXGI_FORMAT format)
+{
+    switch(format)
+    {
+    case DXGI_FORMAT_BC1_UNORM:
+    case DXGI_FORMAT_BC1_UNORM_SRGB:
+        return 3;
+
+    case DXGI_FORMAT_BC4_UNORM:
+        return 1;
+
+    case DXGI_FORMAT_BC5_UNORM:
+        return 2;
+
+    default:
+        return 4;
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      キャッシュファイル名の接尾辞を取得します.
+//-----------------------------------------------------------------------------
+const wchar_t* GetFormatSuffix(DXGI_FORMAT format)
+{
+    switch(format)
+    {
+    case DXGI_FORMAT_BC1_UNORM:
+    case DXGI_FORMAT_BC1_UNORM_SRGB:
+        return L"_bc1.dds";
+
+    case DXGI_FORMAT_BC3_UNORM:
+    case DXGI_FORMAT_BC3_UNORM_SRGB:
+        return L"_bc3.dds";
+
+    case DXGI_FORMAT_BC4_UNORM:
+        return L"_bc4.dds";
+
+    case DXGI_FORMAT_BC5_UNORM:
+        return L"_bc5.dds";
+
+    default:
+        return L"_bc7.dds";
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      SRGBフォーマットに変換します.
+//-----------------------------------------------------------------------------
+DXGI_FORMAT ConvertToSRGB(DXGI_FORMAT format)
+{
+    switch(format)
+    {
+    case DXGI_FORMAT_BC1_UNORM:         return DXGI_FORMAT_BC1_UNORM_SRGB;
+    case DXGI_FORMAT_BC3_UNORM:         return DXGI_FORMAT_BC3_UNORM_SRGB;
+    case DXGI_FORMAT_BC7_UNORM:         return DXGI_FORMAT_BC7_UNORM_SRGB;
+    default:                            return format;
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      sRGB の値をリニアに変換します.
+//-----------------------------------------------------------------------------
+float SRGBToLinear(uint8_t value)
+{
+    static const auto kTable = []()
+    {
+        std::array<float, 256> table;
+        for(auto i=0; i<256; ++i)
+        {
+            auto v = float(i) / 255.0f;
+            table[i] = (v <= 0.04045f) ? v / 12.92f : powf((v + 0.055f) / 1.055f, 2.4f);
+        }
+        return table;
+    }();
+
+    return kTable[value];
+}
+
+//-----------------------------------------------------------------------------
+//      リニアの値を sRGB に変換します.
+//-----------------------------------------------------------------------------
+uint8_t LinearToSRGB(float value)
+{
+    auto v = (value <= 0.0031308f) ? value * 12.92f : 1.055f * powf(value, 1.0f / 2.4f) - 0.055f;
+    return uint8_t(std::min(std::max(v * 255.0f + 0.5f, 0.0f), 255.0f));
+}
+
+//-----------------------------------------------------------------------------
+//      縦横半分のミップを生成します.
+//-----------------------------------------------------------------------------
+void Downsample
+(
+    const std::vector<uint8_t>& src,
+    uint32_t                    width,
+    uint32_t                    height,
+    BC_TEXTURE_TYPE             type,
+    std::vector<uint8_t>&       result
+)
+{
+    auto w = std::max(width  / 2, 1u);
+    auto h = std::max(height / 2, 1u);
+    result.resize(size_t(w) * h * 4);
+
+    ParallelFor(h, [&](size_t y)
+    {
+        for(auto x=0u; x<w; ++x)
+        {
+            const uint8_t* pSrc[4];
+            for(auto i=0; i<4; ++i)
+            {
+                auto sx = std::min(uint32_t(x * 2 + (i & 1)), width  - 1);
+                auto sy = std::min(uint32_t(y * 2 + (i >> 1)), height - 1);
+                pSrc[i] = &src[(size_t(sy) * width + sx) * 4];
+            }
+
+            auto pDst = &result[(y * w + x) * 4];
+            switch(type)
+            {
+            case BC_TEXTURE_COLOR:
+            case BC_TEXTURE_COLOR_ALPHA:
+                {
+                    // sRGB のまま平均すると暗くなるのでリニアで平均する.
+                    for(auto c=0; c<3; ++c)
+                    {
+                        auto sum = 0.0f;
+                        for(auto i=0; i<4; ++i)
+                        { sum += SRGBToLinear(pSrc[i][c]); }
+                        pDst[c] = LinearToSRGB(sum * 0.25f);
+                    }
+                    pDst[3] = uint8_t((pSrc[0][3] + pSrc[1][3] + pSrc[2][3] + pSrc[3][3] + 2) / 4);
+                }
+                break;
+
+            case BC_TEXTURE_NORMAL:
+                {
+                    // 平均すると短くなるので正規化し直す.
+                    float n[3] = {};
+                    for(auto i=0; i<4; ++i)
+                    {
+                        for(auto c=0; c<3; ++c)
+                        { n[c] += pSrc[i][c] * (2.0f / 255.0f) - 1.0f; }
+                    }
+
+                    auto length = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+                    if (length < FLT_EPSILON)
+                    {
+                        n[0] = n[1] = 0.0f;
+                        n[2] = length = 1.0f;
+                    }
+
+                    for(auto c=0; c<3; ++c)
+                    { pDst[c] = uint8_t(std::min(std::max((n[c] / length * 0.5f + 0.5f) * 255.0f + 0.5f, 0.0f), 255.0f)); }
+                    pDst[3] = 255;
+                }
+                break;
+
+            default:
+                {
+                    for(auto c=0; c<4; ++c)
+                    { pDst[c] = uint8_t((pSrc[0][c] + pSrc[1][c] + pSrc[2][c] + pSrc[3][c] + 2) / 4); }
+                }
+                break;
+            }
+        }
+    });
+}
+
+//-----------------------------------------------------------------------------
+//      DDS のミップ0を RGBA8 に変換します.
+//-----------------------------------------------------------------------------
+bool ConvertToRGBA8
+(
+    const uint8_t*          pData,
+    const DdsInfo&          info,
+    const DdsSubresource&   layout,
+    std::vector<uint8_t>&   result
+)
+{
+    result.resize(size_t(info.Width) * info.Height * 4);
+
+    for(auto y=0u; y<info.Height; ++y)
+    {
+        auto pSrc = pData + layout.Offset + layout.RowPitch * y;
+        auto pDst = &result[size_t(y) * info.Width * 4];
+
+        for(auto x=0u; x<info.Width; ++x, pDst+=4)
+        {
+            switch(info.Format)
+            {
+            case DXGI_FORMAT_R8G8B8A8_UNORM:
+            case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+                memcpy(pDst, pSrc + x * 4, 4);
+                break;
+
+            case DXGI_FORMAT_B8G8R8A8_UNORM:
+            case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+            case DXGI_FORMAT_B8G8R8X8_UNORM:
+            case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
+                {
+                    auto hasAlpha = (info.Format == DXGI_FORMAT_B8G8R8A8_UNORM || info.Format == DXGI_FORMAT_B8G8R8A8_UNORM_SRGB);
+                    pDst[0] = pSrc[x * 4 + 2];
+                    pDst[1] = pSrc[x * 4 + 1];
+                    pDst[2] = pSrc[x * 4 + 0];
+                    pDst[3] = (hasAlpha) ? pSrc[x * 4 + 3] : 255;
+                }
+                break;
+
+            case DXGI_FORMAT_R8G8_UNORM:
+                pDst[0] = pSrc[x * 2 + 0];
+                pDst[1] = pSrc[x * 2 + 1];
+                pDst[2] = 0;
+                pDst[3] = 255;
+                break;
+
+            case DXGI_FORMAT_R8_UNORM:
+                pDst[0] = pDst[1] = pDst[2] = pSrc[x];
+                pDst[3] = 255;
+                break;
+
+            default:
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      ブロック圧縮したキャッシュのパスを求めます. compress が true であれば無い場合に作成します.
+//-----------------------------------------------------------------------------
+bool ResolveCompressedTexture
+(
+    const std::wstring&     path,
+    BC_TEXTURE_TYPE         type,
+    bool                    compress,
+    std::wstring&           result,
+    BcCompressStats*        pStats
+)
+{
+    result = path;
+
+    MappedFile file;
+    if (!file.Open(path.c_str()))
+    { return false; }
+
+    DdsInfo info;
+    std::vector<DdsSubresource> layout;
+    auto size = size_t(file.GetSize());
+    if (!ParseDdsHeader(file.GetData(), size, info) || !ComputeDdsLayout(info, size, layout))
+    { return false; }
+
+    // 既に圧縮済み.
+    if (IsDdsBlockCompressed(info.Format))
+    { return true; }
+
+    if (info.ArraySize != 1 || info.Depth != 1 || (info.Width % 4) != 0 || (info.Height % 4) != 0)
+    {
+        DLOG( "Warning : Texture Can Not Be Block Compressed. path = %ls", path.c_str() );
+        return false;
+    }
+
+    auto isSRGB = (info.Format == DXGI_FORMAT_R8G8B8A8_UNORM_SRGB
+                || info.Format == DXGI_FORMAT_B8G8R8A8_UNORM_SRGB
+                || info.Format == DXGI_FORMAT_B8G8R8X8_UNORM_SRGB);
+
+    BcCompressDesc desc;
+    desc.Format = SelectBcFormat(type);
+    desc.Type   = type;
+    if (isSRGB)
+    { desc.Format = ConvertToSRGB(desc.Format); }
+
+    // 拡張子を差し替えたパスにキャッシュする.
+    auto stem = path;
+    auto dot  = stem.find_last_of(L'.');
+    auto sep  = stem.find_last_of(L"/\\");
+    if (dot != std::wstring::npos && (sep == std::wstring::npos || dot > sep))
+    { stem.resize(dot); }
+    auto cachePath = stem + GetFormatSuffix(desc.Format);
+
+    // 元のファイルより新しいキャッシュがあればそれを使う.
+    WIN32_FILE_ATTRIBUTE_DATA srcAttr   = {};
+    WIN32_FILE_ATTRIBUTE_DATA cacheAttr = {};
+    if (GetFileAttributesExW(path.c_str(), GetFileExInfoStandard, &srcAttr)
+     && GetFileAttributesExW(cachePath.c_str(), GetFileExInfoStandard, &cacheAttr)
+     && CompareFileTime(&cacheAttr.ftLastWriteTime, &srcAttr.ftLastWriteTime) >= 0)
+    {
+        result = cachePath;
+        return true;
+    }
+
+    // 圧縮しない場合は元のファイルのまま.
+    if (!compress)
+    { return false; }
+
+    std::vector<uint8_t> pixels;
+    if (!ConvertToRGBA8(file.GetData(), info, layout[0], pixels))
+    {
+        DLOG( "Warning : Unsupported Source Format. path = %ls, format = %d", path.c_str(), int(info.Format) );
+        return false;
+    }
+
+    BcCompressStats stats;
+    if (!CompressTexture(pixels.data(), info.Width, info.Height, size_t(info.Width) * 4, desc, cachePath.c_str(), &stats))
+    { return false; }
+
+    DLOG( "BC : compressed texture. path = %ls, format = %d, PSNR = %.2f dB, %.1f MPixel/s, %llu -> %llu bytes",
+        cachePath.c_str(), int(desc.Format), stats.Psnr, stats.MegaPixelsPerSecond,
+        (unsigned long long)stats.SourceBytes, (unsigned long long)stats.CompressedBytes );
+
+    if (pStats != nullptr)
+    { *pStats = stats; }
+
+    result = cachePath;
+
+    // 正常終了.
+    return true;
+}
+
+} // namespace
+
+
+//-----------------------------------------------------------------------------
+//      テクスチャの種類に合わせた圧縮フォーマットを選びます.
+//-----------------------------------------------------------------------------
+DXGI_FORMAT SelectBcFormat(BC_TEXTURE_TYPE type, bool highQuality)
+{
+    switch(type)
+    {
+    case BC_TEXTURE_COLOR:          return (highQuality) ? DXGI_FORMAT_BC7_UNORM : DXGI_FORMAT_BC1_UNORM;
+    case BC_TEXTURE_COLOR_ALPHA:    return (highQuality) ? DXGI_FORMAT_BC7_UNORM : DXGI_FORMAT_BC3_UNORM;
+    case BC_TEXTURE_NORMAL:         return DXGI_FORMAT_BC5_UNORM;
+    case BC_TEXTURE_MASK:           return DXGI_FORMAT_BC4_UNORM;
+    default:                        return DXGI_FORMAT_BC1_UNORM;
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      4x4 ピクセルを BC1 で圧縮します.
+//-----------------------------------------------------------------------------
+void CompressBlockBC1(const uint8_t* pRGBA, uint8_t* pBlock)
+{
+    alignas(16) float r[16], g[16], b[16];
+    const float* channels[3] = { r, g, b };
+
+    float mean[3] = {};
+    float minValue[3] = { 255.0f, 255.0f, 255.0f };
+    float maxValue[3] = { 0.0f, 0.0f, 0.0f };
+    for(auto i=0; i<16; ++i)
+    {
+        r[i] = pRGBA[i * 4 + 0];
+        g[i] = pRGBA[i * 4 + 1];
+        b[i] = pRGBA[i * 4 + 2];
+        for(auto c=0; c<3; ++c)
+        {
+            auto v = channels[c][i];
+            mean[c] += v;
+            minValue[c] = std::min(minValue[c], v);
+            maxValue[c] = std::max(maxValue[c], v);
+        }
+    }
+    for(auto c=0; c<3; ++c)
+    { mean[c] /= 16.0f; }
+
+    // 共分散行列の主成分を色の分布の軸にする.
+    float cov[3][3] = {};
+    for(auto i=0; i<16; ++i)
+    {
+        float d[3] = { r[i] - mean[0], g[i] - mean[1], b[i] - mean[2] };
+        for(auto j=0; j<3; ++j)
+        {
+            for(auto k=0; k<3; ++k)
+            { cov[j][k] += d[j] * d[k]; }
+        }
+    }
+
+    float axis[3] = { maxValue[0] - minValue[0], maxValue[1] - minValue[1], maxValue[2] - minValue[2] };
+    FindPrincipalAxis(cov, axis);
+
+    auto minT = FLT_MAX;
+    auto maxT = -FLT_MAX;
+    auto axisLengthSq = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+    for(auto i=0; i<16; ++i)
+    {
+        auto t = (r[i] - mean[0]) * axis[0] + (g[i] - mean[1]) * axis[1] + (b[i] - mean[2]) * axis[2];
+        minT = std::min(minT, t);
+        maxT = std::max(maxT, t);
+    }
+    if (axisLengthSq > FLT_EPSILON)
+    {
+        minT /= axisLengthSq;
+        maxT /= axisLengthSq;
+    }
+    else
+    { minT = maxT = 0.0f; }
+
+    float e0[3], e1[3];
+    for(auto c=0; c<3; ++c)
+    {
+        e0[c] = mean[c] + axis[c] * maxT;
+        e1[c] = mean[c] + axis[c] * minT;
+    }
+
+    uint32_t indices[16];
+    auto c0    = PackColor565(e0);
+    auto c1    = PackColor565(e1);
+    auto error = EvaluateBC1(channels, c0, c1, indices);
+
+    // 選んだ番号で端点を補正し, 誤差が減る場合だけ採用する.
+    if (error > 0.0f && RefineEndpointsBC1(channels, indices, e0, e1))
+    {
+        uint32_t refineIndices[16];
+        auto refine0     = PackColor565(e0);
+        auto refine1     = PackColor565(e1);
+        auto refineError = EvaluateBC1(channels, refine0, refine1, refineIndices);
+        if (refineError < error)
+        {
+            c0 = refine0;
+            c1 = refine1;
+            memcpy(indices, refineIndices, sizeof(indices));
+        }
+    }
+
+    WriteBlockBC1(c0, c1, indices, pBlock);
+}
+
+//-----------------------------------------------------------------------------
+//      4x4 ピクセルを BC3 で圧縮します.
+//-----------------------------------------------------------------------------
+void CompressBlockBC3(const uint8_t* pRGBA, uint8_t* pBlock)
+{
+    CompressBlockBC4(pRGBA + 3, 4, pBlock);
+    CompressBlockBC1(pRGBA, pBlock + 8);
+}
+
+//-----------------------------------------------------------------------------
+//      4x4 ピクセルの1チャンネルを BC4 で圧縮します.
+//-----------------------------------------------------------------------------
+void CompressBlockBC4(const uint8_t* pValues, size_t stride, uint8_t* pBlock)
+{
+    alignas(16) float values[16];
+    const float* channels[1] = { values };
+
+    auto minValue = 255;
+    auto maxValue = 0;
+    for(auto i=0; i<16; ++i)
+    {
+        auto v = int(pValues[i * stride]);
+        values[i] = float(v);
+        minValue  = std::min(minValue, v);
+        maxValue  = std::max(maxValue, v);
+    }
+
+    pBlock[0] = uint8_t(maxValue);
+    pBlock[1] = uint8_t(minValue);
+
+    // 単色の場合は番号0だけで表せる.
+    uint32_t indices[16] = {};
+    if (minValue != maxValue)
+    {
+        int palette[8];
+        MakePaletteBC4(maxValue, minValue, palette);
+
+        int paletteTable[8][1];
+        for(auto i=0; i<8; ++i)
+        { paletteTable[i][0] = palette[i]; }
+
+        FitIndices(channels, paletteTable, indices);
+    }
+
+    uint64_t bits = 0;
+    for(auto i=0; i<16; ++i)
+    { bits |= uint64_t(indices[i]) << (i * 3); }
+
+    for(auto i=0; i<6; ++i)
+    { pBlock[2 + i] = uint8_t(bits >> (i * 8)); }
+}
+
+//-----------------------------------------------------------------------------
+//      4x4 ピクセルの RG を BC5 で圧縮します.
+//-----------------------------------------------------------------------------
+void CompressBlockBC5(const uint8_t* pRGBA, uint8_t* pBlock)
+{
+    CompressBlockBC4(pRGBA + 0, 4, pBlock + 0);
+    CompressBlockBC4(pRGBA + 1, 4, pBlock + 8);
+}
+
+//-----------------------------------------------------------------------------
+//      4x4 ピクセルを BC7 で圧縮します.
+//-----------------------------------------------------------------------------
+void CompressBlockBC7(const uint8_t* pRGBA, uint8_t* pBlock)
+{
+    __m128 pixels[16];
+    auto sum    = _mm_setzero_ps();
+    auto minVec = _mm_set1_ps(255.0f);
+    auto maxVec = _mm_setzero_ps();
+    for(auto i=0; i<16; ++i)
+    {
+        pixels[i] = _mm_setr_ps(pRGBA[i * 4 + 0], pRGBA[i * 4 + 1], pRGBA[i * 4 + 2], pRGBA[i * 4 + 3]);
+        sum    = _mm_add_ps(sum, pixels[i]);
+        minVec = _mm_min_ps(minVec, pixels[i]);
+        maxVec = _mm_max_ps(maxVec, pixels[i]);
+    }
+    auto mean = _mm_mul_ps(sum, _mm_set1_ps(1.0f / 16.0f));
+
+    // RGBA の共分散行列の主成分を軸にする.
+    float cov[4][4] = {};
+    for(auto i=0; i<16; ++i)
+    {
+        alignas(16) float d[4];
+        _mm_store_ps(d, _mm_sub_ps(pixels[i], mean));
+        for(auto j=0; j<4; ++j)
+        {
+            for(auto k=0; k<4; ++k)
+            { cov[j][k] += d[j] * d[k]; }
+        }
+    }
+
+    alignas(16) float axis[4];
+    _mm_store_ps(axis, _mm_sub_ps(maxVec, minVec));
+    FindPrincipalAxis(cov, axis);
+
+    auto axisVec      = _mm_load_ps(axis);
+    auto axisLengthSq = Dot4(axisVec, axisVec);
+    auto minT = 0.0f;
+    auto maxT = 0.0f;
+    if (axisLengthSq > FLT_EPSILON)
+    {
+        minT = FLT_MAX;
+        maxT = -FLT_MAX;
+        for(auto i=0; i<16; ++i)
+        {
+            auto t = Dot4(_mm_sub_ps(pixels[i], mean), axisVec) / axisLengthSq;
+            minT = std::min(minT, t);
+            maxT = std::max(maxT, t);
+        }
+    }
+
+    alignas(16) float ep[2][4];
+    _mm_store_ps(ep[0], _mm_add_ps(mean, _mm_mul_ps(axisVec, _mm_set1_ps(minT))));
+    _mm_store_ps(ep[1], _mm_add_ps(mean, _mm_mul_ps(axisVec, _mm_set1_ps(maxT))));
+
+    // 端点ごとの P ビットの組み合わせを全て試し, 最も誤差の小さいものを選ぶ.
+    auto     bestError = FLT_MAX;
+    uint32_t bestEndpoint[2][4] = {};
+    uint32_t bestP[2] = {};
+    uint32_t bestIndices[16] = {};
+    for(auto p=0u; p<4; ++p)
+    {
+        uint32_t pbit[2] = { p & 1, p >> 1 };
+        uint32_t endpoint[2][4];
+        alignas(16) float value[2][4];
+        for(auto e=0; e<2; ++e)
+        {
+            for(auto c=0; c<4; ++c)
+            {
+                auto q = (ep[e][c] - float(pbit[e])) * 0.5f + 0.5f;
+                endpoint[e][c] = uint32_t(std::min(std::max(q, 0.0f), 127.0f));
+                value[e][c]    = float((endpoint[e][c] << 1) | pbit[e]);
+            }
+        }
+
+        __m128 palette[16];
+        auto v0 = _mm_load_ps(value[0]);
+        auto v1 = _mm_load_ps(value[1]);
+        for(auto i=0; i<16; ++i)
+        {
+            alignas(16) float color[4];
+            for(auto c=0; c<4; ++c)
+            { color[c] = float(uint32_t((64 - BC7Weights4[i]) * uint32_t(value[0][c]) + BC7Weights4[i] * uint32_t(value[1][c]) + 32) >> 6); }
+            palette[i] = _mm_load_ps(color);
+        }
+
+        // 端点を結ぶ直線に射影した位置の前後だけを調べる.
+        auto dir         = _mm_sub_ps(v1, v0);
+        auto dirLengthSq = Dot4(dir, dir);
+        auto error       = 0.0f;
+        uint32_t indices[16];
+        for(auto i=0; i<16; ++i)
+        {
+            auto t = (dirLengthSq > 0.0f) ? Dot4(_mm_sub_ps(pixels[i], v0), dir) / dirLengthSq : 0.0f;
+            auto center = int(std::min(std::max(t * 15.0f + 0.5f, 0.0f), 15.0f));
+
+            auto best      = FLT_MAX;
+            auto bestIndex = 0;
+            for(auto k=std::max(center - 1, 0); k<=std::min(center + 1, 15); ++k)
+            {
+                auto d    = _mm_sub_ps(pixels[i], palette[k]);
+                auto dist = Dot4(d, d);
+                if (dist < best)
+                {
+                    best      = dist;
+                    bestIndex = k;
+                }
+            }
+
+            indices[i] = bestIndex;
+            error += best;
+        }
+
+        if (error < bestError)
+        {
+            bestError = error;
+            memcpy(bestEndpoint, endpoint, sizeof(endpoint));
+            memcpy(bestP, pbit, sizeof(pbit));
+            memcpy(bestIndices, indices, sizeof(indices));
+        }
+    }
+
+    // 先頭ピクセルの番号の最上位ビットは省略されるので 0 にする.
+    if (bestIndices[0] & 0x8)
+    {
+        for(auto c=0; c<4; ++c)
+        { std::swap(bestEndpoint[0][c], bestEndpoint[1][c]); }
+        std::swap(bestP[0], bestP[1]);
+        for(auto& index : bestIndices)
+        { index = 15 - index; }
+    }
+
+    BitWriter writer;
+    writer.Write(0x40, 7);
+    for(auto c=0; c<4; ++c)
+    {
+        writer.Write(bestEndpoint[0][c], 7);
+        writer.Write(bestEndpoint[1][c], 7);
+    }
+    writer.Write(bestP[0], 1);
+    writer.Write(bestP[1], 1);
+    for(auto i=0; i<16; ++i)
+    { writer.Write(bestIndices[i], (i == 0) ? 3 : 4); }
+
+    memcpy(pBlock, writer.Bits, sizeof(writer.Bits));
+}
+
+//-----------------------------------------------------------------------------
+//      4x4 ピクセルを展開します.
+//-----------------------------------------------------------------------------
+bool DecompressBlock(DXGI_FORMAT format, const uint8_t* pBlock, uint8_t* pRGBA)
+{
+    switch(format)
+    {
+    case DXGI_FORMAT_BC1_UNORM:
+    case DXGI_FORMAT_BC1_UNORM_SRGB:
+        DecodeColorBlock(pBlock, false, pRGBA);
+        return true;
+
+    case DXGI_FORMAT_BC3_UNORM:
+    case DXGI_FORMAT_BC3_UNORM_SRGB:
+        DecodeColorBlock(pBlock + 8, true, pRGBA);
+        DecodeBlockBC4(pBlock, pRGBA + 3, 4);
+        return true;
+
+    case DXGI_FORMAT_BC4_UNORM:
+    case DXGI_FORMAT_BC5_UNORM:
+        for(auto i=0; i<16; ++i)
+        {
+            pRGBA[i * 4 + 1] = 0;
+            pRGBA[i * 4 + 2] = 0;
+            pRGBA[i * 4 + 3] = 255;
+        }
+        DecodeBlockBC4(pBlock, pRGBA, 4);
+        if (format == DXGI_FORMAT_BC5_UNORM)
+        { DecodeBlockBC4(pBlock + 8, pRGBA + 1, 4); }
+        return true;
+
+    case DXGI_FORMAT_BC7_UNORM:
+    case DXGI_FORMAT_BC7_UNORM_SRGB:
+        return DecodeBlockBC7(pBlock, pRGBA);
+
+    default:
+        return false;
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      画像を圧縮します.
+//-----------------------------------------------------------------------------
+bool CompressImage
+(
+    const uint8_t*          pPixels,
+    uint32_t                width,
+    uint32_t                height,
+    size_t                  rowPitch,
+    DXGI_FORMAT             format,
+    std::vector<uint8_t>&   result
+)
+{
+    auto compress = GetCompressFunc(format);
+    if (pPixels == nullptr || compress == nullptr || width == 0 || height == 0)
+    { return false; }
+
+    auto blockBytes = GetBlockBytes(format);
+    auto blocksX    = (width  + 3) / 4;
+    auto blocksY    = (height + 3) / 4;
+    result.resize(size_t(blocksX) * blocksY * blockBytes);
+
+    ParallelFor(blocksY, [&](size_t by)
+    {
+        uint8_t tile[16 * 4];
+        for(auto bx=0u; bx<blocksX; ++bx)
+        {
+            for(auto i=0; i<16; ++i)
+            {
+                auto x = std::min(bx * 4 + (i & 3), width  - 1);
+                auto y = std::min(uint32_t(by * 4 + (i >> 2)), height - 1);
+                memcpy(&tile[i * 4], pPixels + rowPitch * y + x * 4, 4);
+            }
+
+            compress(tile, &result[(by * blocksX + bx) * blockBytes]);
+        }
+    });
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      画像を展開します.
+//-----------------------------------------------------------------------------
+bool DecompressImage
+(
+    const uint8_t*          pBlocks,
+    uint32_t                width,
+    uint32_t                height,
+    DXGI_FORMAT             format,
+    std::vector<uint8_t>&   result
+)
+{
+    if (pBlocks == nullptr || GetCompressFunc(format) == nullptr || width == 0 || height == 0)
+    { return false; }
+
+    auto blockBytes = GetBlockBytes(format);
+    auto blocksX    = (width  + 3) / 4;
+    auto blocksY    = (height + 3) / 4;
+    result.resize(size_t(width) * height * 4);
+
+    auto ret = true;
+    for(auto by=0u; by<blocksY; ++by)
+    {
+        for(auto bx=0u; bx<blocksX; ++bx)
+        {
+            uint8_t tile[16 * 4];
+            if (!DecompressBlock(format, pBlocks + (size_t(by) * blocksX + bx) * blockBytes, tile))
+            {
+                ret = false;
+                memset(tile, 0, sizeof(tile));
+            }
+
+            for(auto i=0; i<16; ++i)
+            {
+                auto x = bx * 4 + (i & 3);
+                auto y = by * 4 + (i >> 2);
+                if (x < width && y < height)
+                { memcpy(&result[(size_t(y) * width + x) * 4], &tile[i * 4], 4); }
+            }
+        }
+    }
+
+    return ret;
+}
+
+//-----------------------------------------------------------------------------
+//      2枚の RGBA8 画像の PSNR を求めます.
+//-----------------------------------------------------------------------------
+double CalcPsnr
+(
+    const uint8_t*  pLhs,
+    const uint8_t*  pRhs,
+    uint32_t        width,
+    uint32_t        height,
+    uint32_t        channelCount
+)
+{
+    channelCount = std::min(std::max(channelCount, 1u), 4u);
+
+    uint64_t sum = 0;
+    auto count = size_t(width) * height;
+    for(size_t i=0; i<count; ++i)
+    {
+        for(auto c=0u; c<channelCount; ++c)
+        {
+            auto d = int(pLhs[i * 4 + c]) - int(pRhs[i * 4 + c]);
+            sum += uint64_t(d * d);
+        }
+    }
+
+    if (sum == 0 || count == 0)
+    { return std::numeric_limits<double>::infinity(); }
+
+    auto mse = double(sum) / double(count * channelCount);
+    return 10.0 * log10(255.0 * 255.0 / mse);
+}
+
+//-----------------------------------------------------------------------------
+//      画像を圧縮して DDS ファイルに保存します.
+//-----------------------------------------------------------------------------
+bool CompressTexture
+(
+    const uint8_t*          pPixels,
+    uint32_t                width,
+    uint32_t                height,
+    size_t                  rowPitch,
+    const BcCompressDesc&   desc,
+    const wchar_t*          path,
+    BcCompressStats*        pStats
+)
+{
+    if (pPixels == nullptr || path == nullptr || GetCompressFunc(desc.Format) == nullptr)
+    {
+        ELOG( "Error : Invalid Argument." );
+        return false;
+    }
+
+    // ブロック圧縮のリソースはミップ0の縦横が4の倍数である必要がある.
+    if (width == 0 || height == 0 || (width % 4) != 0 || (height % 4) != 0)
+    {
+        ELOG( "Error : Invalid Texture Size. width = %u, height = %u", width, height );
+        return false;
+    }
+
+    auto mipLevels = 1u;
+    if (desc.GenerateMips)
+    {
+        auto size = std::max(width, height);
+        while (size > 1)
+        {
+            size >>= 1;
+            mipLevels++;
+        }
+    }
+
+    // 詰めて格納し直す.
+    std::vector<uint8_t> level(size_t(width) * height * 4);
+    for(auto y=0u; y<height; ++y)
+    { memcpy(&level[size_t(y) * width * 4], pPixels + rowPitch * y, size_t(width) * 4); }
+
+    BcCompressStats stats = {};
+    std::vector<uint8_t> data;
+    std::vector<uint8_t> blocks;
+    std::vector<uint8_t> next;
+    uint64_t pixelCount = 0;
+
+    auto w = width;
+    auto h = height;
+    for(auto mip=0u; mip<mipLevels; ++mip)
+    {
+        auto begin = std::chrono::steady_clock::now();
+        CompressImage(level.data(), w, h, size_t(w) * 4, desc.Format, blocks);
+        stats.Seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+        data.insert(data.end(), blocks.begin(), blocks.end());
+        pixelCount        += uint64_t(w) * h;
+        stats.SourceBytes += uint64_t(w) * h * 4;
+
+        if (mip == 0)
+        {
+            std::vector<uint8_t> decoded;
+            stats.Psnr = DecompressImage(blocks.data(), w, h, desc.Format, decoded)
+                ? CalcPsnr(level.data(), decoded.data(), w, h, GetChannelCount(desc.Format))
+                : 0.0;
+        }
+
+        if (mip + 1 < mipLevels)
+        {
+            Downsample(level, w, h, desc.Type, next);
+            level.swap(next);
+            w = std::max(w / 2, 1u);
+            h = std::max(h / 2, 1u);
+        }
+    }
+
+    stats.CompressedBytes     = data.size();
+    stats.MegaPixelsPerSecond = (stats.Seconds > 0.0) ? double(pixelCount) / stats.Seconds * 1e-6 : 0.0;
+
+    DdsInfo info = {};
+    info.Width      = width;
+    info.Height     = height;
+    info.Depth      = 1;
+    info.ArraySize  = 1;
+    info.MipLevels  = mipLevels;
+    info.Format     = desc.Format;
+    info.IsCube     = false;
+
+    if (!SaveDdsFile(path, info, data.data(), data.size()))
+    {
+        ELOG( "Error : SaveDdsFile() Failed. path = %ls", path );
+        return false;
+    }
+
+    if (pStats != nullptr)
+    { *pStats = stats; }
+
+    // 正常終了.
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      非圧縮の DDS ファイルを圧縮したキャッシュを用意します.
+//-----------------------------------------------------------------------------
+bool PrepareCompressedTexture
+(
+    const std::wstring&     path,
+    BC_TEXTURE_TYPE         type,
+    std::wstring&           result,
+    BcCompressStats*        pStats
+)
+{ return ResolveCompressedTexture(path, type, true, result, pStats); }
+
+//-----------------------------------------------------------------------------
+//      作成済みのブロック圧縮したキャッシュを検索します.
+//-----------------------------------------------------------------------------
+bool FindCompressedTexture
+(
+    const std::wstring&     path,
+    BC_TEXTURE_TYPE         type,
+    std::wstring&           result
+)
+{ return ResolveCompressedTexture(path, type, false, result, nullptr); }
+
+//-----------------------------------------------------------------------------
+//      DDS ファイルのミップ0を RGBA8 として読み込みます.
+//-----------------------------------------------------------------------------
+bool LoadTextureRGBA8
+(
+    const wchar_t*          path,
+    uint32_t&               width,
+    uint32_t&               height,
+    std::vector<uint8_t>&   result
+)
+{
+    MappedFile file;
+    if (!file.Open(path))
+    { return false; }
+
+    DdsInfo info;
+    std::vector<DdsSubresource> layout;
+    auto size = size_t(file.GetSize());
+    if (!ParseDdsHeader(file.GetData(), size, info) || !ComputeDdsLayout(info, size, layout))
+    { return false; }
+
+    auto ret = (IsDdsBlockCompressed(info.Format))
+        ? DecompressImage(file.GetData() + layout[0].Offset, info.Width, info.Height, info.Format, result)
+        : ConvertToRGBA8(file.GetData(), info, layout[0], result);
+    if (!ret)
+    {
+        DLOG( "Warning : Unsupported Source Format. path = %ls, format = %d", path, int(info.Format) );
+        return false;
+    }
+
+    width  = info.Width;
+    height = info.Height;
+
+    // 正常終了.
+    return true;
+}
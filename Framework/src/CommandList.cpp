@@ -95,3 +95,15 @@ ID3D12GraphicsCommandList4* CommandList::Reset()
     return m_pCmdList.Get();
 }
 
+//-----------------------------------------------------------------------------
+//      指定したアロケータでリセット処理を行います.
+//-----------------------------------------------------------------------------
+ID3D12GraphicsCommandList4* CommandList::Reset(uint32_t index)
+{
+    if (index >= uint32_t(m_pAllocators.size()))
+    { return nullptr; }
+
+    m_Index = index;
+    return Reset();
+}
+
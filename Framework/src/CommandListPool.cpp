@@ -0,0 +1,432 @@
+﻿//-----------------------------------------------------------------------------
+// File : CommandListPool.cpp
+// Desc : Command List Pool Module.
+// Copyright(c) Pocol. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include "CommandListPool.h"
+#include <Logger.h>
+#include <algorithm>
+#include <cassert>
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+constexpr uint8_t   ListStateNone       = 0;    // 記録していません.
+constexpr uint8_t   ListStateRecording  = 1;    // 記録中です.
+constexpr uint8_t   ListStateClosed     = 2;    // 記録を終えて実行できます.
+
+} // namespace
+
+
+///////////////////////////////////////////////////////////////////////////////
+// D3D12CommandListBackend class
+///////////////////////////////////////////////////////////////////////////////
+
+//-----------------------------------------------------------------------------
+//      コンストラクタです.
+//-----------------------------------------------------------------------------
+D3D12CommandListBackend::D3D12CommandListBackend()
+: m_pDevice (nullptr)
+, m_pQueue  (nullptr)
+, m_Type    (D3D12_COMMAND_LIST_TYPE_DIRECT)
+{ /* DO_NOTHING */ }
+
+//-----------------------------------------------------------------------------
+//      デストラクタです.
+//-----------------------------------------------------------------------------
+D3D12CommandListBackend::~D3D12CommandListBackend()
+{ Term(); }
+
+//-----------------------------------------------------------------------------
+//      初期化処理を行います.
+//-----------------------------------------------------------------------------
+bool D3D12CommandListBackend::Init
+(
+    ID3D12Device*           pDevice,
+    ID3D12CommandQueue*     pQueue,
+    D3D12_COMMAND_LIST_TYPE type
+)
+{
+    if (pDevice == nullptr || pQueue == nullptr)
+    { return false; }
+
+    m_pDevice = pDevice;
+    m_pQueue  = pQueue;
+    m_Type    = type;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      終了処理を行います.
+//-----------------------------------------------------------------------------
+void D3D12CommandListBackend::Term()
+{
+    Clear();
+    m_pDevice = nullptr;
+    m_pQueue  = nullptr;
+}
+
+//-----------------------------------------------------------------------------
+//      コマンドリストを1つ追加します.
+//-----------------------------------------------------------------------------
+bool D3D12CommandListBackend::AddList(uint32_t frameCount)
+{
+    if (m_pDevice == nullptr || frameCount == 0)
+    { return false; }
+
+    Entry entry;
+    entry.pAllocators.resize(frameCount);
+
+    for(auto i=0u; i<frameCount; ++i)
+    {
+        auto hr = m_pDevice->CreateCommandAllocator(
+            m_Type, IID_PPV_ARGS(entry.pAllocators[i].GetAddressOf()));
+        if (FAILED(hr))
+        {
+            ELOG("Error : ID3D12Device::CreateCommandAllocator() Failed.");
+            return false;
+        }
+    }
+
+    auto hr = m_pDevice->CreateCommandList(
+        1,
+        m_Type,
+        entry.pAllocators[0].Get(),
+        nullptr,
+        IID_PPV_ARGS(entry.pCmdList.GetAddressOf()));
+    if (FAILED(hr))
+    {
+        ELOG("Error : ID3D12Device::CreateCommandList() Failed.");
+        return false;
+    }
+
+    entry.pCmdList->Close();
+
+    m_Entries.push_back(std::move(entry));
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      記録を開始します.
+//-----------------------------------------------------------------------------
+bool D3D12CommandListBackend::Begin
+(
+    uint32_t                        list,
+    uint32_t                        frame,
+    ID3D12GraphicsCommandList4**    ppCmdList
+)
+{
+    *ppCmdList = nullptr;
+
+    auto& entry = m_Entries[list];
+    auto  pAllocator = entry.pAllocators[frame].Get();
+
+    // フレームスケジューラがこのスロットの完了を待っているので, アロケータは再利用できる.
+    auto hr = pAllocator->Reset();
+    if (FAILED(hr))
+    {
+        ELOG("Error : ID3D12CommandAllocator::Reset() Failed.");
+        return false;
+    }
+
+    hr = entry.pCmdList->Reset(pAllocator, nullptr);
+    if (FAILED(hr))
+    {
+        ELOG("Error : ID3D12GraphicsCommandList::Reset() Failed.");
+        return false;
+    }
+
+    *ppCmdList = entry.pCmdList.Get();
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      記録を終了します.
+//-----------------------------------------------------------------------------
+void D3D12CommandListBackend::End(uint32_t list)
+{ m_Entries[list].pCmdList->Close(); }
+
+//-----------------------------------------------------------------------------
+//      コマンドリストを実行します.
+//-----------------------------------------------------------------------------
+void D3D12CommandListBackend::Execute(const uint32_t* pLists, uint32_t count)
+{
+    if (count == 0)
+    { return; }
+
+    m_Submit.resize(count);
+    for(auto i=0u; i<count; ++i)
+    { m_Submit[i] = m_Entries[pLists[i]].pCmdList.Get(); }
+
+    m_pQueue->ExecuteCommandLists(count, m_Submit.data());
+}
+
+//-----------------------------------------------------------------------------
+//      全てのコマンドリストを破棄します.
+//-----------------------------------------------------------------------------
+void D3D12CommandListBackend::Clear()
+{
+    m_Entries.clear();
+    m_Submit .clear();
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// NullCommandListBackend class
+///////////////////////////////////////////////////////////////////////////////
+
+//-----------------------------------------------------------------------------
+//      コンストラクタです.
+//-----------------------------------------------------------------------------
+NullCommandListBackend::NullCommandListBackend()
+: m_ListCount   (0)
+, m_BeginCount  (0)
+, m_EndCount    (0)
+{ /* DO_NOTHING */ }
+
+//-----------------------------------------------------------------------------
+//      コマンドリストを1つ追加します.
+//-----------------------------------------------------------------------------
+bool NullCommandListBackend::AddList(uint32_t)
+{
+    m_ListCount++;
+    m_FailBegin.resize(m_ListCount, 0);
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      記録を開始します.
+//-----------------------------------------------------------------------------
+bool NullCommandListBackend::Begin(uint32_t list, uint32_t, ID3D12GraphicsCommandList4** ppCmdList)
+{
+    assert(list < m_ListCount);
+    *ppCmdList = nullptr;
+    m_BeginCount.fetch_add(1, std::memory_order_relaxed);
+    return m_FailBegin[list] == 0;
+}
+
+//-----------------------------------------------------------------------------
+//      記録を終了します.
+//-----------------------------------------------------------------------------
+void NullCommandListBackend::End(uint32_t)
+{ m_EndCount.fetch_add(1, std::memory_order_relaxed); }
+
+//-----------------------------------------------------------------------------
+//      コマンドリストを実行します.
+//-----------------------------------------------------------------------------
+void NullCommandListBackend::Execute(const uint32_t* pLists, uint32_t count)
+{ m_Executed.insert(m_Executed.end(), pLists, pLists + count); }
+
+//-----------------------------------------------------------------------------
+//      全てのコマンドリストを破棄します.
+//-----------------------------------------------------------------------------
+void NullCommandListBackend::Clear()
+{
+    m_ListCount = 0;
+    m_FailBegin.clear();
+}
+
+//-----------------------------------------------------------------------------
+//      生成済みのリスト数を取得します.
+//-----------------------------------------------------------------------------
+uint32_t NullCommandListBackend::GetListCount() const
+{ return m_ListCount; }
+
+//-----------------------------------------------------------------------------
+//      Begin() された回数を取得します.
+//-----------------------------------------------------------------------------
+uint32_t NullCommandListBackend::GetBeginCount() const
+{ return m_BeginCount.load(std::memory_order_relaxed); }
+
+//-----------------------------------------------------------------------------
+//      End() された回数を取得します.
+//-----------------------------------------------------------------------------
+uint32_t NullCommandListBackend::GetEndCount() const
+{ return m_EndCount.load(std::memory_order_relaxed); }
+
+//-----------------------------------------------------------------------------
+//      実行されたリスト番号を取得します.
+//-----------------------------------------------------------------------------
+const std::vector<uint32_t>& NullCommandListBackend::GetExecuted() const
+{ return m_Executed; }
+
+//-----------------------------------------------------------------------------
+//      Begin() を失敗させるかどうかを設定します.
+//-----------------------------------------------------------------------------
+void NullCommandListBackend::SetBeginFailure(uint32_t list, bool fail)
+{
+    assert(list < m_ListCount);
+    m_FailBegin[list] = (fail) ? 1 : 0;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// CommandListPool class
+///////////////////////////////////////////////////////////////////////////////
+
+//-----------------------------------------------------------------------------
+//      コンストラクタです.
+//-----------------------------------------------------------------------------
+CommandListPool::CommandListPool()
+: m_pBackend    (nullptr)
+, m_FrameCount  (0)
+, m_Frame       (0)
+, m_ListCount   (0)
+, m_Reserved    (0)
+{ /* DO_NOTHING */ }
+
+//-----------------------------------------------------------------------------
+//      デストラクタです.
+//-----------------------------------------------------------------------------
+CommandListPool::~CommandListPool()
+{ Term(); }
+
+//-----------------------------------------------------------------------------
+//      初期化処理を行います.
+//-----------------------------------------------------------------------------
+bool CommandListPool::Init(CommandListBackend* pBackend, uint32_t frameCount)
+{
+    if (pBackend == nullptr || frameCount == 0)
+    { return false; }
+
+    m_pBackend   = pBackend;
+    m_FrameCount = frameCount;
+    m_Frame      = 0;
+    m_ListCount  = 0;
+    m_Reserved   = 0;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      終了処理を行います.
+//-----------------------------------------------------------------------------
+void CommandListPool::Term()
+{
+    if (m_pBackend != nullptr)
+    { m_pBackend->Clear(); }
+
+    m_pBackend   = nullptr;
+    m_FrameCount = 0;
+    m_ListCount  = 0;
+    m_Reserved   = 0;
+    m_State.clear();
+    m_Order.clear();
+}
+
+//-----------------------------------------------------------------------------
+//      フレームを開始します.
+//-----------------------------------------------------------------------------
+void CommandListPool::BeginFrame(uint32_t frame)
+{
+    assert(frame < m_FrameCount);
+    m_Frame    = frame;
+    m_Reserved = 0;
+    std::fill(m_State.begin(), m_State.end(), ListStateNone);
+}
+
+//-----------------------------------------------------------------------------
+//      実行順の連番を予約します.
+//-----------------------------------------------------------------------------
+uint32_t CommandListPool::Reserve(uint32_t count)
+{
+    auto first = m_Reserved;
+    m_Reserved += count;
+
+    // 足りない分はここで生成しておき, 記録中に配列が伸びないようにする.
+    while(m_ListCount < m_Reserved)
+    {
+        if (!m_pBackend->AddList(m_FrameCount))
+        { break; }
+
+        m_ListCount++;
+    }
+
+    // 記録中に配列が伸びないよう, 状態もここで確保しておく.
+    m_State.resize(m_ListCount, ListStateNone);
+
+    return first;
+}
+
+//-----------------------------------------------------------------------------
+//      予約したリストの記録を開始します.
+//-----------------------------------------------------------------------------
+ID3D12GraphicsCommandList4* CommandListPool::Begin(uint32_t sequence)
+{
+    if (sequence >= m_ListCount)
+    { return nullptr; }
+
+    // 失敗した場合は前のフレームの内容が残っているので, 実行対象にしない.
+    ID3D12GraphicsCommandList4* pCmdList = nullptr;
+    if (!m_pBackend->Begin(sequence, m_Frame, &pCmdList))
+    {
+        m_State[sequence] = ListStateNone;
+        return nullptr;
+    }
+
+    m_State[sequence] = ListStateRecording;
+    return pCmdList;
+}
+
+//-----------------------------------------------------------------------------
+//      予約したリストの記録を終了します.
+//-----------------------------------------------------------------------------
+void CommandListPool::End(uint32_t sequence)
+{
+    if (sequence >= m_ListCount || m_State[sequence] != ListStateRecording)
+    { return; }
+
+    m_pBackend->End(sequence);
+    m_State[sequence] = ListStateClosed;
+}
+
+//-----------------------------------------------------------------------------
+//      予約したリストが記録中かどうかを取得します.
+//-----------------------------------------------------------------------------
+bool CommandListPool::IsRecording(uint32_t sequence) const
+{
+    if (sequence >= m_ListCount)
+    { return false; }
+
+    return m_State[sequence] == ListStateRecording;
+}
+
+//-----------------------------------------------------------------------------
+//      予約したリストを連番の順に実行します.
+//-----------------------------------------------------------------------------
+void CommandListPool::Submit()
+{
+    auto count = std::min(m_Reserved, m_ListCount);
+
+    // このフレームで記録を終えたリストだけを実行する.
+    m_Order.clear();
+    for(auto i=0u; i<count; ++i)
+    {
+        if (m_State[i] == ListStateClosed)
+        { m_Order.push_back(i); }
+
+        m_State[i] = ListStateNone;
+    }
+
+    m_pBackend->Execute(m_Order.data(), uint32_t(m_Order.size()));
+    m_Reserved = 0;
+}
+
+//-----------------------------------------------------------------------------
+//      並列に記録するリスト数を求めます.
+//-----------------------------------------------------------------------------
+uint32_t CommandListPool::GetParallelListCount(size_t itemCount, size_t minItemsPerList)
+{
+    if (minItemsPerList == 0)
+    { minItemsPerList = 1; }
+
+    auto count = (itemCount + minItemsPerList - 1) / minItemsPerList;
+    count = std::min<size_t>(count, GetWorkerThreadCount());
+    return uint32_t(std::max<size_t>(count, 1));
+}
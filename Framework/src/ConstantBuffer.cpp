@@ -23,6 +23,8 @@ ConstantBuffer::ConstantBuffer()
 , m_pHandle     (nullptr)
 , m_pPool       (nullptr)
 , m_pMappedPtr  (nullptr)
+, m_pAllocator  (nullptr)
+, m_Allocation  ()
 { /* DO_NOTHING */ }
 
 //-----------------------------------------------------------------------------
@@ -36,9 +38,10 @@ ConstantBuffer::~ConstantBuffer()
 //-----------------------------------------------------------------------------
 bool ConstantBuffer::Init
 (
-    ID3D12Device*   pDevice,
-    DescriptorPool* pPool,
-    size_t          size
+    ID3D12Device*       pDevice,
+    DescriptorPool*     pPool,
+    size_t              size,
+    UploadAllocator*    pAllocator
 )
 {
     if (pDevice == nullptr || pPool == nullptr || size == 0)
@@ -53,6 +56,26 @@ bool ConstantBuffer::Init
     size_t align = D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT;
     UINT64 sizeAligned  = (size + (align - 1)) & ~(align - 1); // alignに切り上げる.
 
+    // アロケータがあればページから切り出す.
+    if (pAllocator != nullptr)
+    {
+        if (!pAllocator->Allocate(sizeAligned, align, m_Allocation))
+        { return false; }
+
+        m_pAllocator = pAllocator;
+        m_pCB        = m_Allocation.pResource;
+        m_pMappedPtr = m_Allocation.pCpu;
+
+        m_Desc.BufferLocation = m_Allocation.GpuAddress;
+        m_Desc.SizeInBytes    = UINT(sizeAligned);
+        m_pHandle             = pPool->AllocHandle();
+
+        pDevice->CreateConstantBufferView(&m_Desc, m_pHandle->HandleCPU);
+
+        // 正常終了.
+        return true;
+    }
+
     // ヒーププロパティ.
     D3D12_HEAP_PROPERTIES prop = {};
     prop.Type                   = D3D12_HEAP_TYPE_UPLOAD;
@@ -106,6 +129,15 @@ bool ConstantBuffer::Init
 //-----------------------------------------------------------------------------
 void ConstantBuffer::Term()
 {
+    // アロケータから切り出した領域はアロケータに返却します.
+    if (m_pAllocator != nullptr)
+    {
+        m_pAllocator->Free(m_Allocation);
+        m_pAllocator = nullptr;
+        m_Allocation = UploadAllocation();
+        m_pCB.Reset();
+    }
+
     // メモリマッピングを解除して，定数バッファを解放します.
     if (m_pCB != nullptr)
     {
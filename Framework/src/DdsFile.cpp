@@ -0,0 +1,550 @@
+﻿//-----------------------------------------------------------------------------
+// File : DdsFile.cpp
+// Desc : DDS File Parser Module.
+// Copyright(c) Pocol. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include "DdsFile.h"
+#include "Logger.h"
+#include <Windows.h>
+#include <string>
+#include <algorithm>
+#include <cstring>
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+//      FourCC を求めます.
+//-----------------------------------------------------------------------------
+constexpr uint32_t MakeFourCC(char a, char b, char c, char d)
+{
+    return uint32_t(uint8_t(a))
+        | (uint32_t(uint8_t(b)) << 8)
+        | (uint32_t(uint8_t(c)) << 16)
+        | (uint32_t(uint8_t(d)) << 24);
+}
+
+//-----------------------------------------------------------------------------
+//      ビットマスクが一致するかチェックします.
+//-----------------------------------------------------------------------------
+inline bool IsBitMask(const DdsPixelFormat& pf, uint32_t r, uint32_t g, uint32_t b, uint32_t a)
+{ return pf.RBitMask == r && pf.GBitMask == g && pf.BBitMask == b && pf.ABitMask == a; }
+
+//-----------------------------------------------------------------------------
+//      旧形式のピクセルフォーマットから DXGI フォーマットを求めます.
+//-----------------------------------------------------------------------------
+DXGI_FORMAT GetLegacyFormat(const DdsPixelFormat& pf)
+{
+    if (pf.Flags & DdsPixelFourCC)
+    {
+        switch(pf.FourCC)
+        {
+        case MakeFourCC('D', 'X', 'T', '1'): return DXGI_FORMAT_BC1_UNORM;
+        case MakeFourCC('D', 'X', 'T', '2'):
+        case MakeFourCC('D', 'X', 'T', '3'): return DXGI_FORMAT_BC2_UNORM;
+        case MakeFourCC('D', 'X', 'T', '4'):
+        case MakeFourCC('D', 'X', 'T', '5'): return DXGI_FORMAT_BC3_UNORM;
+        case MakeFourCC('A', 'T', 'I', '1'):
+        case MakeFourCC('B', 'C', '4', 'U'): return DXGI_FORMAT_BC4_UNORM;
+        case MakeFourCC('B', 'C', '4', 'S'): return DXGI_FORMAT_BC4_SNORM;
+        case MakeFourCC('A', 'T', 'I', '2'):
+        case MakeFourCC('B', 'C', '5', 'U'): return DXGI_FORMAT_BC5_UNORM;
+        case MakeFourCC('B', 'C', '5', 'S'): return DXGI_FORMAT_BC5_SNORM;
+
+        // D3DFORMAT の値が直接書かれている場合.
+        case 36:  return DXGI_FORMAT_R16G16B16A16_UNORM;
+        case 110: return DXGI_FORMAT_R16G16B16A16_SNORM;
+        case 111: return DXGI_FORMAT_R16_FLOAT;
+        case 112: return DXGI_FORMAT_R16G16_FLOAT;
+        case 113: return DXGI_FORMAT_R16G16B16A16_FLOAT;
+        case 114: return DXGI_FORMAT_R32_FLOAT;
+        case 115: return DXGI_FORMAT_R32G32_FLOAT;
+        case 116: return DXGI_FORMAT_R32G32B32A32_FLOAT;
+
+        default: break;
+        }
+        return DXGI_FORMAT_UNKNOWN;
+    }
+
+    if (pf.Flags & DdsPixelRGB)
+    {
+        switch(pf.RGBBitCount)
+        {
+        case 32:
+            if (IsBitMask(pf, 0x000000ff, 0x0000ff00, 0x00ff0000, 0xff000000)) { return DXGI_FORMAT_R8G8B8A8_UNORM; }
+            if (IsBitMask(pf, 0x00ff0000, 0x0000ff00, 0x000000ff, 0xff000000)) { return DXGI_FORMAT_B8G8R8A8_UNORM; }
+            if (IsBitMask(pf, 0x00ff0000, 0x0000ff00, 0x000000ff, 0x00000000)) { return DXGI_FORMAT_B8G8R8X8_UNORM; }
+            if (IsBitMask(pf, 0x3ff00000, 0x000ffc00, 0x000003ff, 0xc0000000)) { return DXGI_FORMAT_R10G10B10A2_UNORM; }
+            if (IsBitMask(pf, 0x0000ffff, 0xffff0000, 0x00000000, 0x00000000)) { return DXGI_FORMAT_R16G16_UNORM; }
+            if (IsBitMask(pf, 0xffffffff, 0x00000000, 0x00000000, 0x00000000)) { return DXGI_FORMAT_R32_FLOAT; }
+            break;
+
+        case 16:
+            if (IsBitMask(pf, 0xf800, 0x07e0, 0x001f, 0x0000)) { return DXGI_FORMAT_B5G6R5_UNORM; }
+            if (IsBitMask(pf, 0x7c00, 0x03e0, 0x001f, 0x8000)) { return DXGI_FORMAT_B5G5R5A1_UNORM; }
+            if (IsBitMask(pf, 0x0f00, 0x00f0, 0x000f, 0xf000)) { return DXGI_FORMAT_B4G4R4A4_UNORM; }
+            break;
+
+        default:
+            break;
+        }
+        return DXGI_FORMAT_UNKNOWN;
+    }
+
+    if (pf.Flags & DdsPixelLuminance)
+    {
+        if (pf.RGBBitCount == 8  && IsBitMask(pf, 0xff,   0, 0, 0))      { return DXGI_FORMAT_R8_UNORM; }
+        if (pf.RGBBitCount == 16 && IsBitMask(pf, 0xffff, 0, 0, 0))      { return DXGI_FORMAT_R16_UNORM; }
+        if (pf.RGBBitCount == 16 && IsBitMask(pf, 0x00ff, 0, 0, 0xff00)) { return DXGI_FORMAT_R8G8_UNORM; }
+        return DXGI_FORMAT_UNKNOWN;
+    }
+
+    if ((pf.Flags & DdsPixelAlphaPixels) && pf.RGBBitCount == 8)
+    { return DXGI_FORMAT_A8_UNORM; }
+
+    return DXGI_FORMAT_UNKNOWN;
+}
+
+//-----------------------------------------------------------------------------
+//      ブロック圧縮の1ブロックのサイズを求めます. 圧縮フォーマットでなければ 0 を返します.
+//-----------------------------------------------------------------------------
+uint32_t GetBlockSize(DXGI_FORMAT format)
+{
+    switch(format)
+    {
+    case DXGI_FORMAT_BC1_TYPELESS:
+    case DXGI_FORMAT_BC1_UNORM:
+    case DXGI_FORMAT_BC1_UNORM_SRGB:
+    case DXGI_FORMAT_BC4_TYPELESS:
+    case DXGI_FORMAT_BC4_UNORM:
+    case DXGI_FORMAT_BC4_SNORM:
+        return 8;
+
+    case DXGI_FORMAT_BC2_TYPELESS:
+    case DXGI_FORMAT_BC2_UNORM:
+    case DXGI_FORMAT_BC2_UNORM_SRGB:
+    case DXGI_FORMAT_BC3_TYPELESS:
+    case DXGI_FORMAT_BC3_UNORM:
+    case DXGI_FORMAT_BC3_UNORM_SRGB:
+    case DXGI_FORMAT_BC5_TYPELESS:
+    case DXGI_FORMAT_BC5_UNORM:
+    case DXGI_FORMAT_BC5_SNORM:
+    case DXGI_FORMAT_BC6H_TYPELESS:
+    case DXGI_FORMAT_BC6H_UF16:
+    case DXGI_FORMAT_BC6H_SF16:
+    case DXGI_FORMAT_BC7_TYPELESS:
+    case DXGI_FORMAT_BC7_UNORM:
+    case DXGI_FORMAT_BC7_UNORM_SRGB:
+        return 16;
+
+    default:
+        return 0;
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      非圧縮フォーマットの1ピクセルあたりのビット数を求めます. 未対応の場合は 0 を返します.
+//-----------------------------------------------------------------------------
+uint32_t GetBitsPerPixel(DXGI_FORMAT format)
+{
+    switch(format)
+    {
+    case DXGI_FORMAT_R32G32B32A32_TYPELESS:
+    case DXGI_FORMAT_R32G32B32A32_FLOAT:
+    case DXGI_FORMAT_R32G32B32A32_UINT:
+    case DXGI_FORMAT_R32G32B32A32_SINT:
+        return 128;
+
+    case DXGI_FORMAT_R32G32B32_TYPELESS:
+    case DXGI_FORMAT_R32G32B32_FLOAT:
+    case DXGI_FORMAT_R32G32B32_UINT:
+    case DXGI_FORMAT_R32G32B32_SINT:
+        return 96;
+
+    case DXGI_FORMAT_R16G16B16A16_TYPELESS:
+    case DXGI_FORMAT_R16G16B16A16_FLOAT:
+    case DXGI_FORMAT_R16G16B16A16_UNORM:
+    case DXGI_FORMAT_R16G16B16A16_UINT:
+    case DXGI_FORMAT_R16G16B16A16_SNORM:
+    case DXGI_FORMAT_R16G16B16A16_SINT:
+    case DXGI_FORMAT_R32G32_TYPELESS:
+    case DXGI_FORMAT_R32G32_FLOAT:
+    case DXGI_FORMAT_R32G32_UINT:
+    case DXGI_FORMAT_R32G32_SINT:
+        return 64;
+
+    case DXGI_FORMAT_R10G10B10A2_TYPELESS:
+    case DXGI_FORMAT_R10G10B10A2_UNORM:
+    case DXGI_FORMAT_R10G10B10A2_UINT:
+    case DXGI_FORMAT_R11G11B10_FLOAT:
+    case DXGI_FORMAT_R8G8B8A8_TYPELESS:
+    case DXGI_FORMAT_R8G8B8A8_UNORM:
+    case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+    case DXGI_FORMAT_R8G8B8A8_UINT:
+    case DXGI_FORMAT_R8G8B8A8_SNORM:
+    case DXGI_FORMAT_R8G8B8A8_SINT:
+    case DXGI_FORMAT_R16G16_TYPELESS:
+    case DXGI_FORMAT_R16G16_FLOAT:
+    case DXGI_FORMAT_R16G16_UNORM:
+    case DXGI_FORMAT_R16G16_UINT:
+    case DXGI_FORMAT_R16G16_SNORM:
+    case DXGI_FORMAT_R16G16_SINT:
+    case DXGI_FORMAT_R32_TYPELESS:
+    case DXGI_FORMAT_R32_FLOAT:
+    case DXGI_FORMAT_R32_UINT:
+    case DXGI_FORMAT_R32_SINT:
+    case DXGI_FORMAT_R9G9B9E5_SHAREDEXP:
+    case DXGI_FORMAT_B8G8R8A8_TYPELESS:
+    case DXGI_FORMAT_B8G8R8A8_UNORM:
+    case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+    case DXGI_FORMAT_B8G8R8X8_TYPELESS:
+    case DXGI_FORMAT_B8G8R8X8_UNORM:
+    case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
+        return 32;
+
+    case DXGI_FORMAT_R8G8_TYPELESS:
+    case DXGI_FORMAT_R8G8_UNORM:
+    case DXGI_FORMAT_R8G8_UINT:
+    case DXGI_FORMAT_R8G8_SNORM:
+    case DXGI_FORMAT_R8G8_SINT:
+    case DXGI_FORMAT_R16_TYPELESS:
+    case DXGI_FORMAT_R16_FLOAT:
+    case DXGI_FORMAT_R16_UNORM:
+    case DXGI_FORMAT_R16_UINT:
+    case DXGI_FORMAT_R16_SNORM:
+    case DXGI_FORMAT_R16_SINT:
+    case DXGI_FORMAT_B5G6R5_UNORM:
+    case DXGI_FORMAT_B5G5R5A1_UNORM:
+    case DXGI_FORMAT_B4G4R4A4_UNORM:
+        return 16;
+
+    case DXGI_FORMAT_R8_TYPELESS:
+    case DXGI_FORMAT_R8_UNORM:
+    case DXGI_FORMAT_R8_UINT:
+    case DXGI_FORMAT_R8_SNORM:
+    case DXGI_FORMAT_R8_SINT:
+    case DXGI_FORMAT_A8_UNORM:
+        return 8;
+
+    default:
+        return 0;
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      フルミップチェインのミップ数を求めます.
+//-----------------------------------------------------------------------------
+uint32_t CalcMaxMipLevels(uint32_t width, uint32_t height, uint32_t depth)
+{
+    auto size   = std::max(width, std::max(height, depth));
+    auto result = 1u;
+    while (size > 1)
+    {
+        size >>= 1;
+        result++;
+    }
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+//      ファイルに書き込みます.
+//-----------------------------------------------------------------------------
+bool WriteFileData(const std::wstring& path, const std::vector<uint8_t>& buffer)
+{
+    // 書き込み途中のファイルを読まれないように一時ファイルに書いてから置き換えます.
+    std::wstring tempPath = path + L".tmp";
+
+    auto hFile = CreateFileW(
+        tempPath.c_str(),
+        GENERIC_WRITE,
+        0,
+        nullptr,
+        CREATE_ALWAYS,
+        FILE_ATTRIBUTE_NORMAL,
+        nullptr);
+    if (hFile == INVALID_HANDLE_VALUE)
+    {
+        ELOG( "Error : CreateFileW() Failed. path = %ls", tempPath.c_str() );
+        return false;
+    }
+
+    DWORD written = 0;
+    auto result = WriteFile(hFile, buffer.data(), DWORD(buffer.size()), &written, nullptr);
+    CloseHandle(hFile);
+
+    if (!result || written != DWORD(buffer.size()))
+    {
+        ELOG( "Error : WriteFile() Failed. path = %ls", tempPath.c_str() );
+        DeleteFileW(tempPath.c_str());
+        return false;
+    }
+
+    if (!MoveFileExW(tempPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING))
+    {
+        ELOG( "Error : MoveFileExW() Failed. path = %ls", path.c_str() );
+        DeleteFileW(tempPath.c_str());
+        return false;
+    }
+
+    // 正常終了.
+    return true;
+}
+
+} // namespace
+
+
+//-----------------------------------------------------------------------------
+//      DDS ファイルのヘッダを解析します.
+//-----------------------------------------------------------------------------
+bool ParseDdsHeader(const uint8_t* pData, size_t size, DdsInfo& result)
+{
+    if (pData == nullptr || size < sizeof(uint32_t) + sizeof(DdsHeader))
+    { return false; }
+
+    uint32_t magic;
+    memcpy(&magic, pData, sizeof(magic));
+    if (magic != DdsMagic)
+    { return false; }
+
+    DdsHeader header;
+    memcpy(&header, pData + sizeof(uint32_t), sizeof(header));
+    if (header.Size != sizeof(DdsHeader) || header.PixelFormat.Size != sizeof(DdsPixelFormat))
+    { return false; }
+
+    DdsInfo info = {};
+    info.Width      = header.Width;
+    info.Height     = std::max(header.Height, 1u);
+    info.Depth      = 1;
+    info.ArraySize  = 1;
+    info.MipLevels  = std::max(header.MipMapCount, 1u);
+    info.DataOffset = sizeof(uint32_t) + sizeof(DdsHeader);
+
+    if ((header.PixelFormat.Flags & DdsPixelFourCC) && header.PixelFormat.FourCC == DdsFourCCDX10)
+    {
+        if (size < info.DataOffset + sizeof(DdsHeaderDX10))
+        { return false; }
+
+        DdsHeaderDX10 ext;
+        memcpy(&ext, pData + info.DataOffset, sizeof(ext));
+        info.DataOffset += sizeof(DdsHeaderDX10);
+
+        if (ext.ArraySize == 0)
+        { return false; }
+
+        info.Format    = DXGI_FORMAT(ext.Format);
+        info.ArraySize = ext.ArraySize;
+
+        switch(ext.ResourceDimension)
+        {
+        case DdsDimensionTexture1D:
+            {
+                if ((header.Flags & DdsFlagHeight) && header.Height != 1)
+                { return false; }
+                info.Height = 1;
+            }
+            break;
+
+        case DdsDimensionTexture2D:
+            {
+                if (ext.MiscFlag & DdsMiscTextureCube)
+                {
+                    info.ArraySize *= 6;
+                    info.IsCube     = true;
+                }
+            }
+            break;
+
+        case DdsDimensionTexture3D:
+            {
+                if (!(header.Flags & DdsFlagDepth) || ext.ArraySize != 1)
+                { return false; }
+                info.Depth = std::max(header.Depth, 1u);
+            }
+            break;
+
+        default:
+            return false;
+        }
+    }
+    else
+    {
+        info.Format = GetLegacyFormat(header.PixelFormat);
+
+        if (header.Caps2 & DdsCaps2CubeMap)
+        {
+            // 旧形式では一部の面だけのキューブマップも書けるが, D3D12 では扱えない.
+            if ((header.Caps2 & DdsCaps2CubeAllFaces) != DdsCaps2CubeAllFaces)
+            { return false; }
+
+            info.ArraySize = 6;
+            info.IsCube    = true;
+        }
+        else if ((header.Caps2 & DdsCaps2Volume) && (header.Flags & DdsFlagDepth))
+        { info.Depth = std::max(header.Depth, 1u); }
+    }
+
+    if (info.Format == DXGI_FORMAT_UNKNOWN || info.Width == 0)
+    { return false; }
+
+    if (GetBlockSize(info.Format) == 0 && GetBitsPerPixel(info.Format) == 0)
+    { return false; }
+
+    if (info.MipLevels > CalcMaxMipLevels(info.Width, info.Height, info.Depth))
+    { return false; }
+
+    result = info;
+
+    // 正常終了.
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      ブロック圧縮フォーマットかどうかチェックします.
+//-----------------------------------------------------------------------------
+bool IsDdsBlockCompressed(DXGI_FORMAT format)
+{ return GetBlockSize(format) != 0; }
+
+//-----------------------------------------------------------------------------
+//      1枚のサーフェイスのサイズを求めます.
+//-----------------------------------------------------------------------------
+bool GetDdsSurfaceInfo
+(
+    DXGI_FORMAT format,
+    uint32_t    width,
+    uint32_t    height,
+    size_t&     rowPitch,
+    uint32_t&   rowCount,
+    size_t&     slicePitch
+)
+{
+    auto blockSize = GetBlockSize(format);
+    if (blockSize != 0)
+    {
+        auto blockWide = std::max(1u, (width  + 3) / 4);
+        auto blockHigh = std::max(1u, (height + 3) / 4);
+        rowPitch   = size_t(blockWide) * blockSize;
+        rowCount   = blockHigh;
+        slicePitch = rowPitch * blockHigh;
+        return true;
+    }
+
+    auto bpp = GetBitsPerPixel(format);
+    if (bpp == 0)
+    { return false; }
+
+    rowPitch   = (size_t(width) * bpp + 7) / 8;
+    rowCount   = height;
+    slicePitch = rowPitch * height;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      サブリソースごとのファイル内の配置を求めます.
+//-----------------------------------------------------------------------------
+bool ComputeDdsLayout(const DdsInfo& info, size_t fileSize, std::vector<DdsSubresource>& result)
+{
+    result.clear();
+    result.reserve(size_t(info.ArraySize) * info.MipLevels);
+
+    auto offset = info.DataOffset;
+    for(auto item=0u; item<info.ArraySize; ++item)
+    {
+        auto w = info.Width;
+        auto h = info.Height;
+        auto d = info.Depth;
+
+        for(auto mip=0u; mip<info.MipLevels; ++mip)
+        {
+            DdsSubresource sub = {};
+            if (!GetDdsSurfaceInfo(info.Format, w, h, sub.RowPitch, sub.RowCount, sub.SlicePitch))
+            { return false; }
+
+            sub.Offset  = offset;
+            sub.Size    = sub.SlicePitch * d;
+            sub.Width   = w;
+            sub.Height  = h;
+            sub.Depth   = d;
+
+            // ファイルが途中で切れている場合は読み出さない.
+            if (sub.Size > fileSize || offset > fileSize - sub.Size)
+            {
+                result.clear();
+                return false;
+            }
+
+            result.push_back(sub);
+            offset += sub.Size;
+
+            w = std::max(w >> 1, 1u);
+            h = std::max(h >> 1, 1u);
+            d = std::max(d >> 1, 1u);
+        }
+    }
+
+    // 正常終了.
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      DDS ファイルに保存します.
+//-----------------------------------------------------------------------------
+bool SaveDdsFile(const wchar_t* path, const DdsInfo& info, const void* pData, size_t dataSize)
+{
+    if (path == nullptr || pData == nullptr || info.Width == 0 || info.Height == 0 || info.MipLevels == 0)
+    {
+        ELOG( "Error : Invalid Argument." );
+        return false;
+    }
+
+    size_t   rowPitch   = 0;
+    uint32_t rowCount   = 0;
+    size_t   slicePitch = 0;
+    if (!GetDdsSurfaceInfo(info.Format, info.Width, info.Height, rowPitch, rowCount, slicePitch))
+    {
+        ELOG( "Error : Unsupported Format. format = %d", int(info.Format) );
+        return false;
+    }
+
+    auto isCompressed = IsDdsBlockCompressed(info.Format);
+
+    DdsHeader header = {};
+    header.Size                 = sizeof(DdsHeader);
+    header.Flags                = DdsFlagCaps | DdsFlagHeight | DdsFlagWidth | DdsFlagPixelFormat | DdsFlagMipMapCount;
+    header.Flags               |= (isCompressed) ? DdsFlagLinearSize : DdsFlagPitch;
+    header.Height               = info.Height;
+    header.Width                = info.Width;
+    header.PitchOrLinearSize    = uint32_t((isCompressed) ? slicePitch : rowPitch);
+    header.Depth                = 1;
+    header.MipMapCount          = info.MipLevels;
+    header.PixelFormat.Size     = sizeof(DdsPixelFormat);
+    header.PixelFormat.Flags    = DdsPixelFourCC;
+    header.PixelFormat.FourCC   = DdsFourCCDX10;
+    header.Caps                 = DdsCapsTexture;
+    if (info.MipLevels > 1)
+    { header.Caps |= DdsCapsComplex | DdsCapsMipMap; }
+    if (info.IsCube)
+    {
+        header.Caps  |= DdsCapsComplex;
+        header.Caps2 |= DdsCaps2CubeAllFaces;
+    }
+
+    // キューブマップの配列数は面の数を含まない.
+    DdsHeaderDX10 ext = {};
+    ext.Format              = uint32_t(info.Format);
+    ext.ResourceDimension   = DdsDimensionTexture2D;
+    ext.MiscFlag            = (info.IsCube) ? DdsMiscTextureCube : 0;
+    ext.ArraySize           = (info.IsCube) ? std::max(info.ArraySize / 6, 1u) : std::max(info.ArraySize, 1u);
+
+    std::vector<uint8_t> buffer(sizeof(DdsMagic) + sizeof(header) + sizeof(ext) + dataSize);
+    auto pDst = buffer.data();
+    memcpy(pDst, &DdsMagic, sizeof(DdsMagic)); pDst += sizeof(DdsMagic);
+    memcpy(pDst, &header,   sizeof(header));   pDst += sizeof(header);
+    memcpy(pDst, &ext,      sizeof(ext));      pDst += sizeof(ext);
+    memcpy(pDst, pData,     dataSize);
+
+    return WriteFileData(path, buffer);
+}
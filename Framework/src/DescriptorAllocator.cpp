@@ -0,0 +1,426 @@
+﻿//-----------------------------------------------------------------------------
+// File : DescriptorAllocator.cpp
+// Desc : Descriptor Range Allocator Module.
+// Copyright(c) Pocol. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <DescriptorAllocator.h>
+#include <algorithm>
+#include <cassert>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+//      最上位の立っているビット位置を求めます(value != 0).
+//-----------------------------------------------------------------------------
+inline uint32_t FindMSB(uint32_t value)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanReverse(&index, value);
+    return uint32_t(index);
+#else
+    return 31u - uint32_t(__builtin_clz(value));
+#endif
+}
+
+//-----------------------------------------------------------------------------
+//      最下位の立っているビット位置を求めます(value != 0).
+//-----------------------------------------------------------------------------
+inline uint32_t FindLSB(uint32_t value)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, value);
+    return uint32_t(index);
+#else
+    return uint32_t(__builtin_ctz(value));
+#endif
+}
+
+//-----------------------------------------------------------------------------
+//      サイズから第1・第2レベルの番号を求めます.
+//-----------------------------------------------------------------------------
+inline void Mapping(uint32_t size, uint32_t secondBits, uint32_t& fl, uint32_t& sl)
+{
+    if (size < (1u << secondBits))
+    {
+        // 小さいサイズは第1レベル 0 に線形に並べる.
+        fl = 0;
+        sl = size;
+    }
+    else
+    {
+        auto msb = FindMSB(size);
+        fl = msb - secondBits + 1;
+        sl = (size >> (msb - secondBits)) ^ (1u << secondBits);
+    }
+}
+
+} // namespace
+
+
+///////////////////////////////////////////////////////////////////////////////
+// DescriptorRangeAllocator class
+///////////////////////////////////////////////////////////////////////////////
+
+//-----------------------------------------------------------------------------
+//      コンストラクタです.
+//-----------------------------------------------------------------------------
+DescriptorRangeAllocator::DescriptorRangeAllocator()
+: m_Capacity        (0)
+, m_UsedCount       (0)
+, m_AllocationCount (0)
+, m_FreeBlockCount  (0)
+, m_FirstLevelMap   (0)
+{
+    std::fill_n(m_SecondLevelMap, FirstLevelCount, 0u);
+    std::fill_n(&m_FreeHead[0][0], FirstLevelCount * SecondLevelCount, InvalidNode);
+}
+
+//-----------------------------------------------------------------------------
+//      デストラクタです.
+//-----------------------------------------------------------------------------
+DescriptorRangeAllocator::~DescriptorRangeAllocator()
+{ Term(); }
+
+//-----------------------------------------------------------------------------
+//      初期化処理を行います.
+//-----------------------------------------------------------------------------
+bool DescriptorRangeAllocator::Init(uint32_t capacity)
+{
+    // 切り上げで溢れないように上位ビットは使わない.
+    if (capacity == 0 || capacity > (1u << 31))
+    { return false; }
+
+    Term();
+
+    m_Capacity = capacity;
+
+    // 全体を1つの空きブロックにする.
+    auto index = CreateNode(0, capacity);
+    InsertFree(index);
+
+    // 正常終了.
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      終了処理を行います.
+//-----------------------------------------------------------------------------
+void DescriptorRangeAllocator::Term()
+{
+    m_Nodes    .clear();
+    m_FreeNodes.clear();
+
+    std::fill_n(m_SecondLevelMap, FirstLevelCount, 0u);
+    std::fill_n(&m_FreeHead[0][0], FirstLevelCount * SecondLevelCount, InvalidNode);
+
+    m_Capacity        = 0;
+    m_UsedCount       = 0;
+    m_AllocationCount = 0;
+    m_FreeBlockCount  = 0;
+    m_FirstLevelMap   = 0;
+}
+
+//-----------------------------------------------------------------------------
+//      連続した範囲を割り当てます.
+//-----------------------------------------------------------------------------
+bool DescriptorRangeAllocator::Allocate(uint32_t count, DescriptorRange& result)
+{
+    if (count == 0 || count > m_Capacity - m_UsedCount)
+    { return false; }
+
+    auto index = FindFree(count);
+    if (index == InvalidNode)
+    { return false; }
+
+    RemoveFree(index);
+
+    // 余りは後ろ側に新しい空きブロックとして切り出す.
+    if (m_Nodes[index].Size > count)
+    {
+        auto rest = CreateNode(m_Nodes[index].Offset + count, m_Nodes[index].Size - count);
+        auto next = m_Nodes[index].NextPhys;
+
+        m_Nodes[rest].PrevPhys = index;
+        m_Nodes[rest].NextPhys = next;
+        if (next != InvalidNode)
+        { m_Nodes[next].PrevPhys = rest; }
+
+        m_Nodes[index].NextPhys = rest;
+        m_Nodes[index].Size     = count;
+
+        InsertFree(rest);
+    }
+
+    m_UsedCount += count;
+    m_AllocationCount++;
+
+    result.Offset = m_Nodes[index].Offset;
+    result.Count  = count;
+    result.Node   = index;
+
+    // 正常終了.
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      範囲を解放します.
+//-----------------------------------------------------------------------------
+void DescriptorRangeAllocator::Free(const DescriptorRange& range)
+{
+    auto index = range.Node;
+    if (index >= m_Nodes.size())
+    { return; }
+
+    assert(!m_Nodes[index].Free);
+    assert(m_Nodes[index].Offset == range.Offset && m_Nodes[index].Size == range.Count);
+
+    m_UsedCount -= m_Nodes[index].Size;
+    m_AllocationCount--;
+
+    // 後ろの空きブロックと結合.
+    auto next = m_Nodes[index].NextPhys;
+    if (next != InvalidNode && m_Nodes[next].Free)
+    {
+        RemoveFree(next);
+        m_Nodes[index].Size     += m_Nodes[next].Size;
+        m_Nodes[index].NextPhys  = m_Nodes[next].NextPhys;
+        if (m_Nodes[index].NextPhys != InvalidNode)
+        { m_Nodes[m_Nodes[index].NextPhys].PrevPhys = index; }
+        DestroyNode(next);
+    }
+
+    // 前の空きブロックと結合.
+    auto prev = m_Nodes[index].PrevPhys;
+    if (prev != InvalidNode && m_Nodes[prev].Free)
+    {
+        RemoveFree(prev);
+        m_Nodes[prev].Size     += m_Nodes[index].Size;
+        m_Nodes[prev].NextPhys  = m_Nodes[index].NextPhys;
+        if (m_Nodes[prev].NextPhys != InvalidNode)
+        { m_Nodes[m_Nodes[prev].NextPhys].PrevPhys = prev; }
+        DestroyNode(index);
+        index = prev;
+    }
+
+    InsertFree(index);
+}
+
+//-----------------------------------------------------------------------------
+//      総ディスクリプタ数を増やします.
+//-----------------------------------------------------------------------------
+bool DescriptorRangeAllocator::Grow(uint32_t capacity)
+{
+    if (m_Capacity == 0 || capacity <= m_Capacity || capacity > (1u << 31))
+    { return false; }
+
+    // 番号順で末尾のブロックを探す. 拡張はまれなので線形探索で十分.
+    auto last = InvalidNode;
+    for(uint32_t i=0; i<uint32_t(m_Nodes.size()); ++i)
+    {
+        if (m_Nodes[i].Size != 0 && m_Nodes[i].NextPhys == InvalidNode)
+        {
+            last = i;
+            break;
+        }
+    }
+    assert(last != InvalidNode);
+
+    auto extra = capacity - m_Capacity;
+    if (m_Nodes[last].Free)
+    {
+        // 末尾が空きであれば伸ばして入れ直す.
+        RemoveFree(last);
+        m_Nodes[last].Size += extra;
+        InsertFree(last);
+    }
+    else
+    {
+        auto index = CreateNode(m_Capacity, extra);
+        m_Nodes[index].PrevPhys = last;
+        m_Nodes[last ].NextPhys = index;
+        InsertFree(index);
+    }
+
+    m_Capacity = capacity;
+
+    // 正常終了.
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      総ディスクリプタ数を取得します.
+//-----------------------------------------------------------------------------
+uint32_t DescriptorRangeAllocator::GetCapacity() const
+{ return m_Capacity; }
+
+//-----------------------------------------------------------------------------
+//      割り当て済みのディスクリプタ数を取得します.
+//-----------------------------------------------------------------------------
+uint32_t DescriptorRangeAllocator::GetUsedCount() const
+{ return m_UsedCount; }
+
+//-----------------------------------------------------------------------------
+//      統計を取得します.
+//-----------------------------------------------------------------------------
+DescriptorAllocatorStats DescriptorRangeAllocator::GetStats() const
+{
+    DescriptorAllocatorStats stats = {};
+    stats.Capacity        = m_Capacity;
+    stats.UsedCount       = m_UsedCount;
+    stats.AllocationCount = m_AllocationCount;
+    stats.FreeBlockCount  = m_FreeBlockCount;
+
+    // 最大の空きブロックは空きのある最上位のクラスに入っている.
+    if (m_FirstLevelMap != 0)
+    {
+        auto fl = FindMSB(m_FirstLevelMap);
+        auto sl = FindMSB(m_SecondLevelMap[fl]);
+        for(auto i = m_FreeHead[fl][sl]; i != InvalidNode; i = m_Nodes[i].NextFree)
+        { stats.LargestFreeBlock = std::max(stats.LargestFreeBlock, m_Nodes[i].Size); }
+    }
+
+    auto freeCount = m_Capacity - m_UsedCount;
+    stats.Fragmentation = (freeCount > 0)
+        ? 1.0f - float(stats.LargestFreeBlock) / float(freeCount)
+        : 0.0f;
+
+    return stats;
+}
+
+//-----------------------------------------------------------------------------
+//      ブロックを生成します.
+//-----------------------------------------------------------------------------
+uint32_t DescriptorRangeAllocator::CreateNode(uint32_t offset, uint32_t size)
+{
+    Node node = {};
+    node.Offset   = offset;
+    node.Size     = size;
+    node.PrevPhys = InvalidNode;
+    node.NextPhys = InvalidNode;
+    node.PrevFree = InvalidNode;
+    node.NextFree = InvalidNode;
+    node.Free     = false;
+
+    if (!m_FreeNodes.empty())
+    {
+        auto index = m_FreeNodes.back();
+        m_FreeNodes.pop_back();
+        m_Nodes[index] = node;
+        return index;
+    }
+
+    m_Nodes.push_back(node);
+    return uint32_t(m_Nodes.size() - 1);
+}
+
+//-----------------------------------------------------------------------------
+//      ブロックを破棄します.
+//-----------------------------------------------------------------------------
+void DescriptorRangeAllocator::DestroyNode(uint32_t index)
+{
+    m_Nodes[index].Size = 0;
+    m_Nodes[index].Free = false;
+    m_FreeNodes.push_back(index);
+}
+
+//-----------------------------------------------------------------------------
+//      フリーリストに追加します.
+//-----------------------------------------------------------------------------
+void DescriptorRangeAllocator::InsertFree(uint32_t index)
+{
+    uint32_t fl, sl;
+    Mapping(m_Nodes[index].Size, SecondLevelBits, fl, sl);
+
+    auto head = m_FreeHead[fl][sl];
+    m_Nodes[index].Free     = true;
+    m_Nodes[index].PrevFree = InvalidNode;
+    m_Nodes[index].NextFree = head;
+    if (head != InvalidNode)
+    { m_Nodes[head].PrevFree = index; }
+
+    m_FreeHead[fl][sl]    = index;
+    m_FirstLevelMap      |= 1u << fl;
+    m_SecondLevelMap[fl] |= 1u << sl;
+    m_FreeBlockCount++;
+}
+
+//-----------------------------------------------------------------------------
+//      フリーリストから外します.
+//-----------------------------------------------------------------------------
+void DescriptorRangeAllocator::RemoveFree(uint32_t index)
+{
+    uint32_t fl, sl;
+    Mapping(m_Nodes[index].Size, SecondLevelBits, fl, sl);
+
+    auto prev = m_Nodes[index].PrevFree;
+    auto next = m_Nodes[index].NextFree;
+    if (prev != InvalidNode)
+    { m_Nodes[prev].NextFree = next; }
+    else
+    { m_FreeHead[fl][sl] = next; }
+
+    if (next != InvalidNode)
+    { m_Nodes[next].PrevFree = prev; }
+
+    if (m_FreeHead[fl][sl] == InvalidNode)
+    {
+        m_SecondLevelMap[fl] &= ~(1u << sl);
+        if (m_SecondLevelMap[fl] == 0)
+        { m_FirstLevelMap &= ~(1u << fl); }
+    }
+
+    m_Nodes[index].Free     = false;
+    m_Nodes[index].PrevFree = InvalidNode;
+    m_Nodes[index].NextFree = InvalidNode;
+    m_FreeBlockCount--;
+}
+
+//-----------------------------------------------------------------------------
+//      要求を満たす空きブロックを検索します.
+//-----------------------------------------------------------------------------
+uint32_t DescriptorRangeAllocator::FindFree(uint32_t size) const
+{
+    uint32_t fl, sl;
+
+    // クラス内のどのブロックでも足りるように1つ上のクラスから探す.
+    auto rounded = size;
+    if (size >= SecondLevelCount)
+    { rounded += (1u << (FindMSB(size) - SecondLevelBits)) - 1; }
+
+    Mapping(rounded, SecondLevelBits, fl, sl);
+
+    auto slMap = (sl < SecondLevelCount) ? (m_SecondLevelMap[fl] & (~0u << sl)) : 0u;
+    if (slMap == 0)
+    {
+        auto flMap = (fl + 1 < 32) ? (m_FirstLevelMap & (~0u << (fl + 1))) : 0u;
+        if (flMap != 0)
+        {
+            fl    = FindLSB(flMap);
+            slMap = m_SecondLevelMap[fl];
+        }
+    }
+
+    if (slMap != 0)
+    { return m_FreeHead[fl][FindLSB(slMap)]; }
+
+    // 上のクラスが空でも, 要求と同じクラスに足りるブロックが残っている場合がある.
+    Mapping(size, SecondLevelBits, fl, sl);
+    for(auto i = m_FreeHead[fl][sl]; i != InvalidNode; i = m_Nodes[i].NextFree)
+    {
+        if (m_Nodes[i].Size >= size)
+        { return i; }
+    }
+
+    return InvalidNode;
+}
@@ -8,6 +8,137 @@
 // Includes
 //-----------------------------------------------------------------------------
 #include <DescriptorPool.h>
+#include <Logger.h>
+#include <algorithm>
+#include <cassert>
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+constexpr uint32_t InvalidHeap = UINT32_MAX;
+
+} // namespace
+
+
+///////////////////////////////////////////////////////////////////////////////
+// D3D12DescriptorHeapBackend class
+///////////////////////////////////////////////////////////////////////////////
+
+//-----------------------------------------------------------------------------
+//      コンストラクタです.
+//-----------------------------------------------------------------------------
+D3D12DescriptorHeapBackend::D3D12DescriptorHeapBackend()
+: m_pDevice         (nullptr)
+, m_Desc            ()
+, m_IncrementSize   (0)
+, m_MaxHeapSize     (0)
+{ /* DO_NOTHING */ }
+
+//-----------------------------------------------------------------------------
+//      デストラクタです.
+//-----------------------------------------------------------------------------
+D3D12DescriptorHeapBackend::~D3D12DescriptorHeapBackend()
+{ Term(); }
+
+//-----------------------------------------------------------------------------
+//      初期化処理を行います.
+//-----------------------------------------------------------------------------
+bool D3D12DescriptorHeapBackend::Init(ID3D12Device* pDevice, const D3D12_DESCRIPTOR_HEAP_DESC* pDesc)
+{
+    if (pDevice == nullptr || pDesc == nullptr)
+    { return false; }
+
+    m_pDevice       = pDevice;
+    m_Desc          = *pDesc;
+    m_IncrementSize = pDevice->GetDescriptorHandleIncrementSize(pDesc->Type);
+    m_MaxHeapSize   = UINT32_MAX;
+
+    // シェーダから見えるヒープはデバイスの上限を超えて生成できない.
+    if (pDesc->Flags & D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE)
+    {
+        if (pDesc->Type == D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER)
+        { m_MaxHeapSize = D3D12_MAX_SHADER_VISIBLE_SAMPLER_HEAP_SIZE; }
+        else
+        {
+            D3D12_FEATURE_DATA_D3D12_OPTIONS options = {};
+            auto hr = pDevice->CheckFeatureSupport(D3D12_FEATURE_D3D12_OPTIONS, &options, sizeof(options));
+            m_MaxHeapSize = (SUCCEEDED(hr) && options.ResourceBindingTier >= D3D12_RESOURCE_BINDING_TIER_2)
+                ? D3D12_MAX_SHADER_VISIBLE_DESCRIPTOR_HEAP_SIZE_TIER_2
+                : D3D12_MAX_SHADER_VISIBLE_DESCRIPTOR_HEAP_SIZE_TIER_1;
+        }
+    }
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      終了処理を行います.
+//-----------------------------------------------------------------------------
+void D3D12DescriptorHeapBackend::Term()
+{
+    m_pDevice       = nullptr;
+    m_IncrementSize = 0;
+    m_MaxHeapSize   = 0;
+}
+
+//-----------------------------------------------------------------------------
+//      ディスクリプタヒープを生成します.
+//-----------------------------------------------------------------------------
+bool D3D12DescriptorHeapBackend::CreateHeap(uint32_t count, DescriptorHeapPage& page)
+{
+    if (m_pDevice == nullptr || count == 0)
+    { return false; }
+
+    auto desc = m_Desc;
+    desc.NumDescriptors = count;
+
+    ID3D12DescriptorHeap* pHeap = nullptr;
+    auto hr = m_pDevice->CreateDescriptorHeap(&desc, IID_PPV_ARGS(&pHeap));
+    if (FAILED(hr))
+    {
+        ELOG("Error : ID3D12Device::CreateDescriptorHeap() Failed. retcode = 0x%x", hr);
+        return false;
+    }
+
+    page.pHeap     = pHeap;
+    page.HandleCPU = pHeap->GetCPUDescriptorHandleForHeapStart();
+    page.Count     = count;
+
+    // シェーダから見えないヒープ(RTV/DSV等)はGPUハンドルを持たない.
+    if (desc.Flags & D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE)
+    { page.HandleGPU = pHeap->GetGPUDescriptorHandleForHeapStart(); }
+    else
+    { page.HandleGPU.ptr = 0; }
+
+    // 正常終了.
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      ディスクリプタヒープを破棄します.
+//-----------------------------------------------------------------------------
+void D3D12DescriptorHeapBackend::DestroyHeap(DescriptorHeapPage& page)
+{
+    if (page.pHeap != nullptr)
+    { page.pHeap->Release(); }
+
+    page = DescriptorHeapPage();
+}
+
+//-----------------------------------------------------------------------------
+//      ディスクリプタ間のバイト数を取得します.
+//-----------------------------------------------------------------------------
+uint32_t D3D12DescriptorHeapBackend::GetIncrementSize() const
+{ return m_IncrementSize; }
+
+//-----------------------------------------------------------------------------
+//      1ヒープあたりのディスクリプタ数の上限を取得します.
+//-----------------------------------------------------------------------------
+uint32_t D3D12DescriptorHeapBackend::GetMaxHeapSize() const
+{ return m_MaxHeapSize; }
 
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -19,9 +150,13 @@
 //-----------------------------------------------------------------------------
 DescriptorPool::DescriptorPool()
 : m_RefCount        (1)
-, m_Pool            ()
-, m_pHeap           ()
+, m_D3D12Backend    ()
+, m_pBackend        (nullptr)
+, m_HeapSize        (0)
 , m_DescriptorSize  (0)
+, m_ShaderVisible   (false)
+, m_Transient       ({ InvalidHeap, {} })
+, m_TransientOffset (0)
 { /* DO_NOTHING */ }
 
 //-----------------------------------------------------------------------------
@@ -29,9 +164,16 @@ DescriptorPool::DescriptorPool()
 //-----------------------------------------------------------------------------
 DescriptorPool::~DescriptorPool()
 {
-    m_Pool.Term();
-    m_pHeap.Reset();
+    for(auto& heap : m_Heaps)
+    { m_pBackend->DestroyHeap(heap.Page); }
+
+    m_Heaps       .clear();
+    m_FrameRelease.clear();
+    m_Pending     .clear();
+    m_D3D12Backend.Term();
+    m_pBackend       = nullptr;
     m_DescriptorSize = 0;
+    m_ShaderVisible  = false;
 }
 
 //-----------------------------------------------------------------------------
@@ -59,53 +201,29 @@ uint32_t DescriptorPool::GetCount() const
 //-----------------------------------------------------------------------------
 //      ディスクリプタハンドルを割り当てます.
 //-----------------------------------------------------------------------------
-//DescriptorHandle* DescriptorPool::AllocHandle()
-//{
-//    // 初期化関数です.
-//    auto func = [&](uint32_t index, DescriptorHandle* pHandle)
-//    {
-//        auto handleCPU = m_pHeap->GetCPUDescriptorHandleForHeapStart();
-//        handleCPU.ptr += m_DescriptorSize * index;
-//
-//        auto handleGPU = m_pHeap->GetGPUDescriptorHandleForHeapStart();
-//        handleGPU.ptr += m_DescriptorSize * index;
-//
-//        pHandle->HandleCPU = handleCPU;
-//        pHandle->HandleGPU = handleGPU;
-//    };
-//
-//    // 初期化関数を実行してからハンドルを返却します.
-//    return m_Pool.Alloc(func);
-//}
 DescriptorHandle* DescriptorPool::AllocHandle()
+{ return AllocRange(1); }
+
+//-----------------------------------------------------------------------------
+//      連続したディスクリプタを割り当てます.
+//-----------------------------------------------------------------------------
+DescriptorHandle* DescriptorPool::AllocRange(uint32_t count)
 {
-    // 初期化関数です.
-    auto func = [&](uint32_t index, DescriptorHandle* pHandle)
-        {
-            // CPUハンドルは常に取得可能
-            auto handleCPU = m_pHeap->GetCPUDescriptorHandleForHeapStart();
-            handleCPU.ptr += (size_t)m_DescriptorSize * index;
-            pHandle->HandleCPU = handleCPU;
+    auto pHandle = new (std::nothrow) DescriptorHandle();
+    if (pHandle == nullptr)
+    { return nullptr; }
 
-            // ヒープの設定を確認
-            D3D12_DESCRIPTOR_HEAP_DESC desc = m_pHeap->GetDesc();
+    std::lock_guard<std::mutex> locker(m_Mutex);
 
-            // ★ ShaderVisibleフラグがある場合のみ、GPUハンドルを取得する
-            if (desc.Flags & D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE)
-            {
-                auto handleGPU = m_pHeap->GetGPUDescriptorHandleForHeapStart();
-                handleGPU.ptr += (size_t)m_DescriptorSize * index;
-                pHandle->HandleGPU = handleGPU;
-            }
-            else
-            {
-                // ShaderVisibleでない（RTV/DSV等）場合は、GPUハンドルに0（無効値）をセット
-                pHandle->HandleGPU.ptr = 0;
-            }
-        };
+    HeapRange range;
+    if (!AllocateInternal(count, range))
+    {
+        delete pHandle;
+        return nullptr;
+    }
 
-    // 初期化関数を実行してからハンドルを返却します.
-    return m_Pool.Alloc(func);
+    FillHandle(range, 0, count, *pHandle);
+    return pHandle;
 }
 
 //-----------------------------------------------------------------------------
@@ -115,37 +233,226 @@ void DescriptorPool::FreeHandle(DescriptorHandle*& pHandle)
 {
     if (pHandle != nullptr)
     {
-        // ハンドルをプールに戻します.
-        m_Pool.Free(pHandle);
+        {
+            std::lock_guard<std::mutex> locker(m_Mutex);
+            assert(pHandle->HeapIndex < m_Heaps.size());
+            m_Heaps[pHandle->HeapIndex].pAllocator->Free(pHandle->Range);
+        }
+
+        delete pHandle;
 
         // nullptrでクリアしておきます.
         pHandle = nullptr;
     }
 }
 
+//-----------------------------------------------------------------------------
+//      現在のフレームの間だけ有効な連続したディスクリプタを割り当てます.
+//-----------------------------------------------------------------------------
+bool DescriptorPool::AllocTransient(uint32_t count, DescriptorHandle& result)
+{
+    if (count == 0)
+    { return false; }
+
+    std::lock_guard<std::mutex> locker(m_Mutex);
+
+    // チャンクに収まらないものは専用の範囲を割り当てる.
+    if (count > TransientChunkSize)
+    {
+        HeapRange range;
+        if (!AllocateInternal(count, range))
+        { return false; }
+
+        m_FrameRelease.push_back(range);
+        FillHandle(range, 0, count, result);
+        return true;
+    }
+
+    if (m_Transient.HeapIndex == InvalidHeap || m_TransientOffset + count > m_Transient.Range.Count)
+    {
+        // 使い切ったチャンクは現在のフレームの完了後に回収する.
+        if (m_Transient.HeapIndex != InvalidHeap)
+        {
+            m_FrameRelease.push_back(m_Transient);
+            m_Transient.HeapIndex = InvalidHeap;
+        }
+
+        if (!AllocateInternal(TransientChunkSize, m_Transient))
+        {
+            m_Transient.HeapIndex = InvalidHeap;
+            return false;
+        }
+
+        m_TransientOffset = 0;
+    }
+
+    FillHandle(m_Transient, m_TransientOffset, count, result);
+    m_TransientOffset += count;
+
+    // 正常終了.
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      フレームを終了します.
+//-----------------------------------------------------------------------------
+void DescriptorPool::FrameEnd(uint64_t fenceValue)
+{
+    std::lock_guard<std::mutex> locker(m_Mutex);
+
+    // 切り出し中のチャンクもこのフレームで使い終わる.
+    if (m_Transient.HeapIndex != InvalidHeap)
+    {
+        m_FrameRelease.push_back(m_Transient);
+        m_Transient.HeapIndex = InvalidHeap;
+        m_TransientOffset     = 0;
+    }
+
+    if (m_FrameRelease.empty())
+    { return; }
+
+    assert(m_Pending.empty() || m_Pending.back().FenceValue <= fenceValue);
+
+    PendingFrame frame;
+    frame.FenceValue = fenceValue;
+    frame.Ranges.swap(m_FrameRelease);
+    m_Pending.push_back(std::move(frame));
+}
+
+//-----------------------------------------------------------------------------
+//      GPUの処理が完了した一時的な範囲を回収します.
+//-----------------------------------------------------------------------------
+void DescriptorPool::Retire(uint64_t completedValue)
+{
+    std::lock_guard<std::mutex> locker(m_Mutex);
+
+    while(!m_Pending.empty() && m_Pending.front().FenceValue <= completedValue)
+    {
+        for(auto& range : m_Pending.front().Ranges)
+        { m_Heaps[range.HeapIndex].pAllocator->Free(range.Range); }
+
+        m_Pending.pop_front();
+    }
+}
+
 //-----------------------------------------------------------------------------
 //      利用可能なハンドル数を取得します.
 //-----------------------------------------------------------------------------
 uint32_t DescriptorPool::GetAvailableHandleCount() const
-{ return m_Pool.GetAvailableCount(); }
+{ return GetHandleCount() - GetAllocatedHandleCount(); }
 
 //-----------------------------------------------------------------------------
 //      割り当て済みのハンドル数を取得します.
 //-----------------------------------------------------------------------------
 uint32_t DescriptorPool::GetAllocatedHandleCount() const
-{ return m_Pool.GetUsedCount(); }
+{
+    std::lock_guard<std::mutex> locker(m_Mutex);
+
+    uint32_t count = 0;
+    for(auto& heap : m_Heaps)
+    { count += heap.pAllocator->GetUsedCount(); }
+
+    return count;
+}
 
 //-----------------------------------------------------------------------------
 //      ハンドル総数を取得します.
 //-----------------------------------------------------------------------------
 uint32_t DescriptorPool::GetHandleCount() const
-{ return m_Pool.GetSize(); }
+{
+    std::lock_guard<std::mutex> locker(m_Mutex);
+
+    uint32_t count = 0;
+    for(auto& heap : m_Heaps)
+    { count += heap.pAllocator->GetCapacity(); }
+
+    return count;
+}
+
+//-----------------------------------------------------------------------------
+//      拡張できるハンドル総数を取得します.
+//-----------------------------------------------------------------------------
+uint32_t DescriptorPool::GetMaxHandleCount() const
+{
+    std::lock_guard<std::mutex> locker(m_Mutex);
+
+    uint32_t count = 0;
+    for(auto& heap : m_Heaps)
+    { count += heap.Page.Count; }
+
+    return count;
+}
+
+//-----------------------------------------------------------------------------
+//      使用状況の統計を取得します.
+//-----------------------------------------------------------------------------
+DescriptorAllocatorStats DescriptorPool::GetStats() const
+{
+    std::lock_guard<std::mutex> locker(m_Mutex);
+
+    DescriptorAllocatorStats result = {};
+    for(auto& heap : m_Heaps)
+    {
+        auto stats = heap.pAllocator->GetStats();
+        result.Capacity         += stats.Capacity;
+        result.UsedCount        += stats.UsedCount;
+        result.AllocationCount  += stats.AllocationCount;
+        result.FreeBlockCount   += stats.FreeBlockCount;
+        result.LargestFreeBlock  = std::max(result.LargestFreeBlock, stats.LargestFreeBlock);
+        result.Fragmentation     = std::max(result.Fragmentation, stats.Fragmentation);
+    }
+
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+//      ディスクリプタヒープ数を取得します.
+//-----------------------------------------------------------------------------
+uint32_t DescriptorPool::GetHeapCount() const
+{
+    std::lock_guard<std::mutex> locker(m_Mutex);
+    return uint32_t(m_Heaps.size());
+}
 
 //-----------------------------------------------------------------------------
 //      ディスクリプタヒープを取得します.
 //-----------------------------------------------------------------------------
 ID3D12DescriptorHeap* const DescriptorPool::GetHeap() const
-{ return m_pHeap.Get(); }
+{ return GetHeap(0); }
+
+//-----------------------------------------------------------------------------
+//      ディスクリプタヒープを取得します.
+//-----------------------------------------------------------------------------
+ID3D12DescriptorHeap* const DescriptorPool::GetHeap(uint32_t index) const
+{
+    std::lock_guard<std::mutex> locker(m_Mutex);
+    return (index < m_Heaps.size()) ? m_Heaps[index].Page.pHeap : nullptr;
+}
+
+//-----------------------------------------------------------------------------
+//      ヒープ先頭からのディスクリプタ番号を取得します.
+//-----------------------------------------------------------------------------
+uint32_t DescriptorPool::GetHandleIndex(D3D12_GPU_DESCRIPTOR_HANDLE handle) const
+{
+    std::lock_guard<std::mutex> locker(m_Mutex);
+
+    // シェーダから見えないヒープはGPUハンドルを持たない.
+    if (!m_ShaderVisible || m_DescriptorSize == 0)
+    { return UINT32_MAX; }
+
+    // シェーダから見えるプールはヒープを連結しないので, 先頭のヒープだけを見ればよい.
+    assert(m_Heaps.size() == 1);
+    auto& page = m_Heaps[0].Page;
+    if (handle.ptr < page.HandleGPU.ptr)
+    { return UINT32_MAX; }
+
+    auto offset = handle.ptr - page.HandleGPU.ptr;
+    auto index  = offset / m_DescriptorSize;
+    if ((offset % m_DescriptorSize) != 0 || index >= page.Count)
+    { return UINT32_MAX; }
+
+    return uint32_t(index);
+}
 
 //-----------------------------------------------------------------------------
 //      生成処理を行います.
@@ -156,6 +463,23 @@ bool DescriptorPool::Create
     const D3D12_DESCRIPTOR_HEAP_DESC*   pDesc,
     DescriptorPool**                    ppPool
 )
+{
+    if (pDesc == nullptr)
+    { return false; }
+
+    return Create(pDevice, pDesc, pDesc->NumDescriptors, ppPool);
+}
+
+//-----------------------------------------------------------------------------
+//      先頭のヒープの最大数を指定して生成処理を行います.
+//-----------------------------------------------------------------------------
+bool DescriptorPool::Create
+(
+    ID3D12Device*                       pDevice,
+    const D3D12_DESCRIPTOR_HEAP_DESC*   pDesc,
+    uint32_t                            maxCount,
+    DescriptorPool**                    ppPool
+)
 {
     // 引数チェック.
     if (pDevice == nullptr || pDesc == nullptr || ppPool == nullptr)
@@ -166,32 +490,203 @@ bool DescriptorPool::Create
     if (instance == nullptr)
     { return false; }
 
-    // ディスクリプタヒープを生成.
-    auto hr = pDevice->CreateDescriptorHeap(
-        pDesc, 
-        IID_PPV_ARGS(instance->m_pHeap.GetAddressOf()));
-
     // 失敗したら解放処理を行って終了します.
-    if ( FAILED(hr) )
+    if (!instance->m_D3D12Backend.Init(pDevice, pDesc)
+     || !instance->Init(&instance->m_D3D12Backend, pDesc->NumDescriptors, maxCount))
     {
         instance->Release();
         return false;
     }
 
-    // プールを初期化します.
-    if (!instance->m_Pool.Init(pDesc->NumDescriptors))
+    // インスタンスを設定.
+    *ppPool = instance;
+
+    // 正常終了.
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      バックエンドを指定して生成処理を行います.
+//-----------------------------------------------------------------------------
+bool DescriptorPool::Create
+(
+    DescriptorHeapBackend*              pBackend,
+    uint32_t                            heapSize,
+    DescriptorPool**                    ppPool
+)
+{ return Create(pBackend, heapSize, heapSize, ppPool); }
+
+//-----------------------------------------------------------------------------
+//      バックエンドと先頭のヒープの最大数を指定して生成処理を行います.
+//-----------------------------------------------------------------------------
+bool DescriptorPool::Create
+(
+    DescriptorHeapBackend*              pBackend,
+    uint32_t                            heapSize,
+    uint32_t                            maxCount,
+    DescriptorPool**                    ppPool
+)
+{
+    // 引数チェック.
+    if (pBackend == nullptr || ppPool == nullptr)
+    { return false; }
+
+    // インスタンスを生成します.
+    auto instance = new (std::nothrow) DescriptorPool();
+    if (instance == nullptr)
+    { return false; }
+
+    // 失敗したら解放処理を行って終了します.
+    if (!instance->Init(pBackend, heapSize, maxCount))
     {
         instance->Release();
         return false;
     }
 
-    // ディスクリプタの加算サイズを取得します.
-    instance->m_DescriptorSize = 
-        pDevice->GetDescriptorHandleIncrementSize(pDesc->Type);
-
     // インスタンスを設定.
     *ppPool = instance;
 
     // 正常終了.
     return true;
 }
+
+//-----------------------------------------------------------------------------
+//      初期化処理を行います.
+//-----------------------------------------------------------------------------
+bool DescriptorPool::Init(DescriptorHeapBackend* pBackend, uint32_t heapSize, uint32_t maxCount)
+{
+    if (heapSize == 0)
+    { return false; }
+
+    // 先頭のヒープはデバイスの上限まで確保できる.
+    auto limit = pBackend->GetMaxHeapSize();
+    maxCount = std::min(std::max(maxCount, heapSize), limit);
+    if (heapSize > maxCount)
+    {
+        DLOG( "Warning : Descriptor heap size is clamped to device limit. request = %u, limit = %u", heapSize, limit );
+        heapSize = maxCount;
+    }
+
+    m_pBackend       = pBackend;
+    m_HeapSize       = heapSize;
+    m_DescriptorSize = pBackend->GetIncrementSize();
+
+    // 先頭のヒープは最大数で生成しておき, 割り当て可能な範囲だけを広げていく.
+    if (!AddHeap(heapSize, maxCount))
+    { return false; }
+
+    m_ShaderVisible = (m_Heaps[0].Page.HandleGPU.ptr != 0);
+
+    // 正常終了.
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      範囲を割り当てます. 空きが無ければ割り当て可能な範囲を広げ,
+//      シェーダから見えないヒープはそれでも足りなければヒープを追加します.
+//-----------------------------------------------------------------------------
+bool DescriptorPool::AllocateInternal(uint32_t count, HeapRange& result)
+{
+    if (m_pBackend == nullptr || count == 0)
+    { return false; }
+
+    for(uint32_t i=0; i<uint32_t(m_Heaps.size()); ++i)
+    {
+        if (m_Heaps[i].pAllocator->Allocate(count, result.Range))
+        {
+            result.HeapIndex = i;
+            return true;
+        }
+    }
+
+    // ヒープを作り直さないので, 割り当て済みのハンドルはそのまま使える.
+    for(uint32_t i=0; i<uint32_t(m_Heaps.size()); ++i)
+    {
+        if (GrowHeap(i, count) && m_Heaps[i].pAllocator->Allocate(count, result.Range))
+        {
+            result.HeapIndex = i;
+            return true;
+        }
+    }
+
+    // 連結したヒープは先頭のヒープと同時には設定できないので, シェーダから見えるヒープは連結しない.
+    if (m_ShaderVisible)
+    {
+        auto stats = m_Heaps[0].pAllocator->GetStats();
+        ELOG( "Error : Shader visible descriptor heap is full. request = %u, used = %u / %u, largest free block = %u",
+            count, stats.UsedCount, stats.Capacity, stats.LargestFreeBlock );
+        return false;
+    }
+
+    auto size = std::max(count, m_HeapSize);
+    if (!AddHeap(size, size))
+    { return false; }
+
+    result.HeapIndex = uint32_t(m_Heaps.size() - 1);
+    return m_Heaps.back().pAllocator->Allocate(count, result.Range);
+}
+
+//-----------------------------------------------------------------------------
+//      ヒープを追加します.
+//-----------------------------------------------------------------------------
+bool DescriptorPool::AddHeap(uint32_t capacity, uint32_t count)
+{
+    assert(capacity <= count);
+
+    HeapState state = {};
+    state.pAllocator.reset(new (std::nothrow) DescriptorRangeAllocator());
+    if (state.pAllocator == nullptr || !state.pAllocator->Init(capacity))
+    { return false; }
+
+    if (!m_pBackend->CreateHeap(count, state.Page))
+    { return false; }
+
+    m_Heaps.push_back(std::move(state));
+
+    // 正常終了.
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      ヒープ内の割り当て可能な範囲を広げます.
+//-----------------------------------------------------------------------------
+bool DescriptorPool::GrowHeap(uint32_t index, uint32_t count)
+{
+    auto& heap     = m_Heaps[index];
+    auto  capacity = heap.pAllocator->GetCapacity();
+    if (capacity >= heap.Page.Count)
+    { return false; }
+
+    // 倍々に広げ, 少なくとも要求分は末尾に追加する.
+    auto extra = std::max(capacity, count);
+    auto next  = uint32_t(std::min<uint64_t>(uint64_t(capacity) + extra, heap.Page.Count));
+    return heap.pAllocator->Grow(next);
+}
+
+//-----------------------------------------------------------------------------
+//      範囲からディスクリプタハンドルを設定します.
+//-----------------------------------------------------------------------------
+void DescriptorPool::FillHandle
+(
+    const HeapRange&    range,
+    uint32_t            offset,
+    uint32_t            count,
+    DescriptorHandle&   handle
+) const
+{
+    auto& page  = m_Heaps[range.HeapIndex].Page;
+    auto  index = range.Range.Offset + offset;
+
+    handle.HandleCPU     = page.HandleCPU;
+    handle.HandleCPU.ptr += size_t(m_DescriptorSize) * index;
+
+    handle.HandleGPU     = page.HandleGPU;
+    if (handle.HandleGPU.ptr != 0)
+    { handle.HandleGPU.ptr += uint64_t(m_DescriptorSize) * index; }
+
+    handle.HeapIndex    = range.HeapIndex;
+    handle.Increment    = m_DescriptorSize;
+    handle.Range        = range.Range;
+    handle.Range.Offset = index;
+    handle.Range.Count  = count;
+}
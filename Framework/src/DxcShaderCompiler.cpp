@@ -0,0 +1,258 @@
+﻿//-----------------------------------------------------------------------------
+// File : DxcShaderCompiler.cpp
+// Desc : DXC Shader Compiler Module.
+// Copyright(c) Pocol. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include "DxcShaderCompiler.h"
+#include "ComPtr.h"
+#include "Logger.h"
+#include <atomic>
+#include <cstring>
+#include <new>
+
+
+//-----------------------------------------------------------------------------
+// Linker
+//-----------------------------------------------------------------------------
+#pragma comment( lib, "dxcompiler.lib" )
+
+
+namespace {
+
+///////////////////////////////////////////////////////////////////////////////
+// BinaryBlob class
+///////////////////////////////////////////////////////////////////////////////
+class BinaryBlob : public IDxcBlob
+{
+public:
+    BinaryBlob(const std::shared_ptr<ShaderBinary>& binary)
+    : m_RefCount(1)
+    , m_Binary  (binary)
+    { /* DO_NOTHING */ }
+
+    HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** ppvObject) override
+    {
+        if (ppvObject == nullptr)
+        { return E_POINTER; }
+
+        if (riid == __uuidof(IUnknown) || riid == __uuidof(IDxcBlob))
+        {
+            *ppvObject = static_cast<IDxcBlob*>(this);
+            AddRef();
+            return S_OK;
+        }
+
+        *ppvObject = nullptr;
+        return E_NOINTERFACE;
+    }
+
+    ULONG STDMETHODCALLTYPE AddRef() override
+    { return ++m_RefCount; }
+
+    ULONG STDMETHODCALLTYPE Release() override
+    {
+        auto count = --m_RefCount;
+        if (count == 0)
+        { delete this; }
+
+        return count;
+    }
+
+    LPVOID STDMETHODCALLTYPE GetBufferPointer() override
+    { return const_cast<uint8_t*>(m_Binary->GetData()); }
+
+    SIZE_T STDMETHODCALLTYPE GetBufferSize() override
+    { return m_Binary->GetSize(); }
+
+private:
+    std::atomic<ULONG>              m_RefCount;
+    std::shared_ptr<ShaderBinary>   m_Binary;
+};
+
+} // namespace
+
+
+///////////////////////////////////////////////////////////////////////////////
+// DxcShaderCompiler class
+///////////////////////////////////////////////////////////////////////////////
+
+//-----------------------------------------------------------------------------
+//      コンストラクタです.
+//-----------------------------------------------------------------------------
+DxcShaderCompiler::DxcShaderCompiler()
+{ /* DO_NOTHING */ }
+
+//-----------------------------------------------------------------------------
+//      デストラクタです.
+//-----------------------------------------------------------------------------
+DxcShaderCompiler::~DxcShaderCompiler()
+{ Term(); }
+
+//-----------------------------------------------------------------------------
+//      初期化処理を行います.
+//-----------------------------------------------------------------------------
+bool DxcShaderCompiler::Init()
+{
+    ComPtr<IDxcCompiler> pCompiler;
+    auto hr = DxcCreateInstance(CLSID_DxcCompiler, IID_PPV_ARGS(pCompiler.GetAddressOf()));
+    if (FAILED(hr))
+    {
+        ELOG( "Error : DxcCreateInstance() Failed." );
+        return false;
+    }
+
+    // コンパイラが更新されたらキャッシュを無効にしたいので, バージョンとコミットをキーに含める.
+    m_Version = "dxc";
+
+    ComPtr<IDxcVersionInfo> pInfo;
+    hr = pCompiler->QueryInterface(IID_PPV_ARGS(pInfo.GetAddressOf()));
+    if (SUCCEEDED(hr))
+    {
+        UINT32 major = 0;
+        UINT32 minor = 0;
+        if (SUCCEEDED(pInfo->GetVersion(&major, &minor)))
+        { m_Version += " " + std::to_string(major) + "." + std::to_string(minor); }
+    }
+
+    ComPtr<IDxcVersionInfo2> pInfo2;
+    hr = pCompiler->QueryInterface(IID_PPV_ARGS(pInfo2.GetAddressOf()));
+    if (SUCCEEDED(hr))
+    {
+        UINT32 commitCount = 0;
+        char*  pCommitHash = nullptr;
+        if (SUCCEEDED(pInfo2->GetCommitInfo(&commitCount, &pCommitHash)))
+        {
+            m_Version += " " + std::to_string(commitCount);
+            if (pCommitHash != nullptr)
+            {
+                m_Version += " ";
+                m_Version += pCommitHash;
+                CoTaskMemFree(pCommitHash);
+            }
+        }
+    }
+
+    // 正常終了.
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      終了処理を行います.
+//-----------------------------------------------------------------------------
+void DxcShaderCompiler::Term()
+{ m_Version.clear(); }
+
+//-----------------------------------------------------------------------------
+//      バージョン文字列を取得します.
+//-----------------------------------------------------------------------------
+std::string DxcShaderCompiler::GetVersion() const
+{ return m_Version; }
+
+//-----------------------------------------------------------------------------
+//      シェーダをコンパイルします.
+//-----------------------------------------------------------------------------
+bool DxcShaderCompiler::Compile
+(
+    const ShaderDesc&       desc,
+    const std::string&      source,
+    std::vector<uint8_t>&   binary,
+    std::string&            message
+)
+{
+    ComPtr<IDxcCompiler>        pCompiler;
+    ComPtr<IDxcLibrary>         pLibrary;
+    ComPtr<IDxcIncludeHandler>  pIncludeHandler;
+
+    if (FAILED(DxcCreateInstance(CLSID_DxcCompiler, IID_PPV_ARGS(pCompiler.GetAddressOf())))
+     || FAILED(DxcCreateInstance(CLSID_DxcLibrary,  IID_PPV_ARGS(pLibrary.GetAddressOf())))
+     || FAILED(pLibrary->CreateIncludeHandler(pIncludeHandler.GetAddressOf())))
+    {
+        message = "DxcCreateInstance() Failed.";
+        return false;
+    }
+
+    ComPtr<IDxcBlobEncoding> pSource;
+    auto hr = pLibrary->CreateBlobWithEncodingFromPinned(
+        source.data(), UINT32(source.size()), CP_UTF8, pSource.GetAddressOf());
+    if (FAILED(hr))
+    {
+        message = "IDxcLibrary::CreateBlobWithEncodingFromPinned() Failed.";
+        return false;
+    }
+
+    std::vector<LPCWSTR> args;
+    args.push_back(L"-Qunused-arguments");
+    for(auto& dir : desc.IncludeDirs)
+    {
+        args.push_back(L"-I");
+        args.push_back(dir.c_str());
+    }
+    for(auto& arg : desc.Arguments)
+    { args.push_back(arg.c_str()); }
+
+    std::vector<DxcDefine> defines;
+    for(auto& define : desc.Defines)
+    { defines.push_back({ define.Name.c_str(), define.Value.empty() ? nullptr : define.Value.c_str() }); }
+
+    ComPtr<IDxcOperationResult> pResult;
+    hr = pCompiler->Compile(
+        pSource.Get(),
+        desc.Path.c_str(),
+        L"",
+        desc.Target.c_str(),
+        args.data(),
+        UINT32(args.size()),
+        defines.data(),
+        UINT32(defines.size()),
+        pIncludeHandler.Get(),
+        pResult.GetAddressOf());
+    if (FAILED(hr))
+    {
+        message = "IDxcCompiler::Compile() Failed.";
+        return false;
+    }
+
+    HRESULT status = S_OK;
+    pResult->GetStatus(&status);
+    if (FAILED(status))
+    {
+        ComPtr<IDxcBlobEncoding> pError;
+        if (SUCCEEDED(pResult->GetErrorBuffer(pError.GetAddressOf())) && pError != nullptr)
+        { message.assign(static_cast<const char*>(pError->GetBufferPointer()), pError->GetBufferSize()); }
+        return false;
+    }
+
+    ComPtr<IDxcBlob> pBlob;
+    hr = pResult->GetResult(pBlob.GetAddressOf());
+    if (FAILED(hr) || pBlob == nullptr)
+    {
+        message = "IDxcOperationResult::GetResult() Failed.";
+        return false;
+    }
+
+    binary.resize(pBlob->GetBufferSize());
+    memcpy(binary.data(), pBlob->GetBufferPointer(), binary.size());
+
+    // 正常終了.
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      シェーダバイナリを参照する IDxcBlob を生成します.
+//-----------------------------------------------------------------------------
+bool CreateShaderBlob(const std::shared_ptr<ShaderBinary>& binary, IDxcBlob** ppBlob)
+{
+    if (binary == nullptr || ppBlob == nullptr)
+    { return false; }
+
+    auto pBlob = new (std::nothrow) BinaryBlob(binary);
+    if (pBlob == nullptr)
+    { return false; }
+
+    *ppBlob = pBlob;
+    return true;
+}
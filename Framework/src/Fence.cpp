@@ -169,4 +169,42 @@ void Fence::Sync_(ID3D12CommandQueue* pQueue)
 
     // カウンターを増やす.
     m_Counter++;
-}
\ No newline at end of file
+}
+
+//-----------------------------------------------------------------------------
+//      待機せずにシグナルだけを積みます.
+//-----------------------------------------------------------------------------
+UINT64 Fence::Signal(ID3D12CommandQueue* pQueue)
+{
+    if (pQueue == nullptr)
+    { return 0; }
+
+    const auto fenceValue = m_Counter;
+
+    // シグナル処理.
+    auto hr = pQueue->Signal(m_pFence.Get(), fenceValue);
+    if (FAILED(hr))
+    { return 0; }
+
+    // カウンターを増やす.
+    m_Counter++;
+
+    return fenceValue;
+}
+
+//-----------------------------------------------------------------------------
+//      指定したフェンス値が完了するまで待機します.
+//-----------------------------------------------------------------------------
+void Fence::WaitValue(UINT64 value, UINT timeout)
+{
+    if (m_pFence->GetCompletedValue() >= value)
+    { return; }
+
+    // 完了時にイベントを設定.
+    auto hr = m_pFence->SetEventOnCompletion(value, m_Event);
+    if (FAILED(hr))
+    { return; }
+
+    // 待機処理.
+    WaitForSingleObjectEx(m_Event, timeout, FALSE);
+}
@@ -0,0 +1,358 @@
+﻿//-----------------------------------------------------------------------------
+// File : FrameScheduler.cpp
+// Desc : Frame Scheduler Module.
+// Copyright(c) Pocol. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include "FrameScheduler.h"
+#include <Fence.h>
+#include <algorithm>
+#include <cassert>
+
+
+///////////////////////////////////////////////////////////////////////////////
+// QueueFrameTimeline class
+///////////////////////////////////////////////////////////////////////////////
+
+//-----------------------------------------------------------------------------
+//      コンストラクタです.
+//-----------------------------------------------------------------------------
+QueueFrameTimeline::QueueFrameTimeline()
+: m_pFence(nullptr)
+, m_pQueue(nullptr)
+{ /* DO_NOTHING */ }
+
+//-----------------------------------------------------------------------------
+//      デストラクタです.
+//-----------------------------------------------------------------------------
+QueueFrameTimeline::~QueueFrameTimeline()
+{ Term(); }
+
+//-----------------------------------------------------------------------------
+//      初期化処理を行います.
+//-----------------------------------------------------------------------------
+bool QueueFrameTimeline::Init(Fence* pFence, ID3D12CommandQueue* pQueue)
+{
+    if (pFence == nullptr || pQueue == nullptr)
+    { return false; }
+
+    m_pFence = pFence;
+    m_pQueue = pQueue;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      終了処理を行います.
+//-----------------------------------------------------------------------------
+void QueueFrameTimeline::Term()
+{
+    m_pFence = nullptr;
+    m_pQueue = nullptr;
+}
+
+//-----------------------------------------------------------------------------
+//      シグナルを積みます.
+//-----------------------------------------------------------------------------
+uint64_t QueueFrameTimeline::Signal()
+{
+    if (m_pFence == nullptr)
+    { return 0; }
+
+    return m_pFence->Signal(m_pQueue);
+}
+
+//-----------------------------------------------------------------------------
+//      完了済みのフェンス値を取得します.
+//-----------------------------------------------------------------------------
+uint64_t QueueFrameTimeline::GetCompletedValue() const
+{
+    if (m_pFence == nullptr)
+    { return 0; }
+
+    return m_pFence->GetCompletedValue();
+}
+
+//-----------------------------------------------------------------------------
+//      指定したフェンス値が完了するまで待機します.
+//-----------------------------------------------------------------------------
+void QueueFrameTimeline::Wait(uint64_t value)
+{
+    if (m_pFence == nullptr)
+    { return; }
+
+    m_pFence->WaitValue(value, INFINITE);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// SimulatedFrameTimeline class
+///////////////////////////////////////////////////////////////////////////////
+
+//-----------------------------------------------------------------------------
+//      コンストラクタです.
+//-----------------------------------------------------------------------------
+SimulatedFrameTimeline::SimulatedFrameTimeline()
+: m_StartTime   ()
+, m_CompleteTime()
+, m_CpuTime     (0.0)
+, m_GpuBusyUntil(0.0)
+, m_GpuCost     (0.0)
+, m_StallTime   (0.0)
+, m_OverlapTime (0.0)
+{ /* DO_NOTHING */ }
+
+//-----------------------------------------------------------------------------
+//      GPU処理時間を設定します.
+//-----------------------------------------------------------------------------
+void SimulatedFrameTimeline::SetGpuCost(double cost)
+{ m_GpuCost = std::max(cost, 0.0); }
+
+//-----------------------------------------------------------------------------
+//      CPU時間を進めます.
+//-----------------------------------------------------------------------------
+void SimulatedFrameTimeline::AdvanceCpu(double time)
+{
+    if (time <= 0.0)
+    { return; }
+
+    // GPUは投入済みのコマンドを隙間なく処理しているので,
+    // [m_CpuTime, m_GpuBusyUntil] のうちGPUが実際に動いている区間と重なる分が並行動作時間です.
+    auto begin = m_CpuTime;
+    auto end   = m_CpuTime + time;
+    for(auto i = m_CompleteTime.size(); i > 0; --i)
+    {
+        auto gpuEnd   = m_CompleteTime[i - 1];
+        if (gpuEnd <= begin)
+        { break; }
+
+        auto gpuBegin = m_StartTime[i - 1];
+        m_OverlapTime += std::max(0.0, std::min(end, gpuEnd) - std::max(begin, gpuBegin));
+    }
+
+    m_CpuTime = end;
+}
+
+//-----------------------------------------------------------------------------
+//      現在のCPU時間を取得します.
+//-----------------------------------------------------------------------------
+double SimulatedFrameTimeline::GetCpuTime() const
+{ return m_CpuTime; }
+
+//-----------------------------------------------------------------------------
+//      ストール時間を取得します.
+//-----------------------------------------------------------------------------
+double SimulatedFrameTimeline::GetStallTime() const
+{ return m_StallTime; }
+
+//-----------------------------------------------------------------------------
+//      並行動作時間を取得します.
+//-----------------------------------------------------------------------------
+double SimulatedFrameTimeline::GetOverlapTime() const
+{ return m_OverlapTime; }
+
+//-----------------------------------------------------------------------------
+//      シグナルを積みます.
+//-----------------------------------------------------------------------------
+uint64_t SimulatedFrameTimeline::Signal()
+{
+    // GPUは前のコマンドが終わり, かつ投入された後に処理を開始します.
+    auto start = std::max(m_CpuTime, m_GpuBusyUntil);
+    m_GpuBusyUntil = start + m_GpuCost;
+    m_StartTime   .push_back(start);
+    m_CompleteTime.push_back(m_GpuBusyUntil);
+
+    return uint64_t(m_CompleteTime.size());
+}
+
+//-----------------------------------------------------------------------------
+//      完了済みのフェンス値を取得します.
+//-----------------------------------------------------------------------------
+uint64_t SimulatedFrameTimeline::GetCompletedValue() const
+{
+    auto itr = std::upper_bound(m_CompleteTime.begin(), m_CompleteTime.end(), m_CpuTime);
+    return uint64_t(itr - m_CompleteTime.begin());
+}
+
+//-----------------------------------------------------------------------------
+//      指定したフェンス値が完了するまで待機します.
+//-----------------------------------------------------------------------------
+void SimulatedFrameTimeline::Wait(uint64_t value)
+{
+    if (value == 0 || m_CompleteTime.empty())
+    { return; }
+
+    value = std::min(value, uint64_t(m_CompleteTime.size()));
+
+    auto time = m_CompleteTime[size_t(value - 1)];
+    if (time > m_CpuTime)
+    {
+        m_StallTime += time - m_CpuTime;
+        m_CpuTime    = time;
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// FrameScheduler class
+///////////////////////////////////////////////////////////////////////////////
+
+//-----------------------------------------------------------------------------
+//      コンストラクタです.
+//-----------------------------------------------------------------------------
+FrameScheduler::FrameScheduler()
+: m_pTimeline   (nullptr)
+, m_SlotFence   ()
+, m_LastFence   (0)
+, m_FrameNumber (0)
+, m_WaitCount   (0)
+, m_Latency     (0)
+, m_Slot        (0)
+, m_InFrame     (false)
+{ /* DO_NOTHING */ }
+
+//-----------------------------------------------------------------------------
+//      デストラクタです.
+//-----------------------------------------------------------------------------
+FrameScheduler::~FrameScheduler()
+{ Term(); }
+
+//-----------------------------------------------------------------------------
+//      初期化処理を行います.
+//-----------------------------------------------------------------------------
+bool FrameScheduler::Init(FrameTimeline* pTimeline, uint32_t latency)
+{
+    if (pTimeline == nullptr || latency == 0 || latency > MaxLatency)
+    { return false; }
+
+    m_pTimeline   = pTimeline;
+    m_LastFence   = 0;
+    m_FrameNumber = 0;
+    m_WaitCount   = 0;
+    m_Latency     = latency;
+    m_Slot        = 0;
+    m_InFrame     = false;
+
+    for(auto i=0u; i<MaxLatency; ++i)
+    { m_SlotFence[i] = 0; }
+
+    // 正常終了.
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      終了処理を行います.
+//-----------------------------------------------------------------------------
+void FrameScheduler::Term()
+{
+    if (m_pTimeline == nullptr)
+    { return; }
+
+    WaitIdle();
+
+    m_pTimeline = nullptr;
+    m_Latency   = 0;
+    m_InFrame   = false;
+}
+
+//-----------------------------------------------------------------------------
+//      フレームを開始します.
+//-----------------------------------------------------------------------------
+uint32_t FrameScheduler::BeginFrame()
+{
+    assert(m_pTimeline != nullptr);
+    assert(!m_InFrame);
+
+    m_Slot    = uint32_t(m_FrameNumber % m_Latency);
+    m_InFrame = true;
+
+    // このスロットを前回使ったフレームが終わっていなければ待つ.
+    auto value = m_SlotFence[m_Slot];
+    if (value != 0 && m_pTimeline->GetCompletedValue() < value)
+    {
+        m_pTimeline->Wait(value);
+        m_WaitCount++;
+    }
+
+    return m_Slot;
+}
+
+//-----------------------------------------------------------------------------
+//      フレームを終了します.
+//-----------------------------------------------------------------------------
+uint64_t FrameScheduler::EndFrame()
+{
+    assert(m_pTimeline != nullptr);
+    assert(m_InFrame);
+
+    auto value = m_pTimeline->Signal();
+    if (value != 0)
+    {
+        m_SlotFence[m_Slot] = value;
+        m_LastFence         = value;
+    }
+
+    m_FrameNumber++;
+    m_InFrame = false;
+
+    return value;
+}
+
+//-----------------------------------------------------------------------------
+//      投入済みのフレームが全て完了するまで待機します.
+//-----------------------------------------------------------------------------
+void FrameScheduler::WaitIdle()
+{
+    if (m_pTimeline == nullptr || m_LastFence == 0)
+    { return; }
+
+    if (m_pTimeline->GetCompletedValue() < m_LastFence)
+    { m_pTimeline->Wait(m_LastFence); }
+}
+
+//-----------------------------------------------------------------------------
+//      フレームレイテンシを変更します.
+//-----------------------------------------------------------------------------
+bool FrameScheduler::SetLatency(uint32_t latency)
+{
+    if (latency == 0 || latency > MaxLatency || m_InFrame)
+    { return false; }
+
+    if (latency == m_Latency)
+    { return true; }
+
+    // スロットの割り当てが変わるので, 投入済みのフレームを全て完了させる.
+    WaitIdle();
+
+    for(auto i=0u; i<MaxLatency; ++i)
+    { m_SlotFence[i] = 0; }
+
+    m_Latency = latency;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      フレームレイテンシを取得します.
+//-----------------------------------------------------------------------------
+uint32_t FrameScheduler::GetLatency() const
+{ return m_Latency; }
+
+//-----------------------------------------------------------------------------
+//      現在のフレームのスロット番号を取得します.
+//-----------------------------------------------------------------------------
+uint32_t FrameScheduler::GetFrameSlot() const
+{ return m_Slot; }
+
+//-----------------------------------------------------------------------------
+//      終了したフレーム数を取得します.
+//-----------------------------------------------------------------------------
+uint64_t FrameScheduler::GetFrameNumber() const
+{ return m_FrameNumber; }
+
+//-----------------------------------------------------------------------------
+//      待機した回数を取得します.
+//-----------------------------------------------------------------------------
+uint64_t FrameScheduler::GetWaitCount() const
+{ return m_WaitCount; }
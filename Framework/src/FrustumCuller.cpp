@@ -0,0 +1,250 @@
+﻿//-----------------------------------------------------------------------------
+// File : FrustumCuller.cpp
+// Desc : Frustum Culling Module.
+// Copyright(c) Pocol. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include "FrustumCuller.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <immintrin.h>
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+constexpr uint32_t kPlaneCount = 6;     // 左右上下と前後.
+
+///////////////////////////////////////////////////////////////////////////////
+// Plane structure
+///////////////////////////////////////////////////////////////////////////////
+struct Plane
+{
+    __m128  A, B, C, D;         // 平面係数をレーンに複製したものです.
+    __m128  AbsA, AbsB, AbsC;   // 係数の絶対値です.
+    __m128  Length;             // 法線の長さです.
+};
+
+//-----------------------------------------------------------------------------
+//      ビュー射影行列から視錐台の平面を取り出します.
+//-----------------------------------------------------------------------------
+void ExtractPlanes(const DirectX::XMMATRIX& viewProj, Plane* pPlanes)
+{
+    // 行ベクトル形式なので, 転置した行が元の行列の列になる.
+    auto c0 = viewProj.r[0];
+    auto c1 = viewProj.r[1];
+    auto c2 = viewProj.r[2];
+    auto c3 = viewProj.r[3];
+    _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+
+    // クリップ空間の z は 0 から w.
+    const __m128 planes[kPlaneCount] = {
+        _mm_add_ps(c3, c0),
+        _mm_sub_ps(c3, c0),
+        _mm_add_ps(c3, c1),
+        _mm_sub_ps(c3, c1),
+        c2,
+        _mm_sub_ps(c3, c2),
+    };
+
+    for(auto i=0u; i<kPlaneCount; ++i)
+    {
+        alignas(16) float p[4];
+        _mm_store_ps(p, planes[i]);
+
+        auto& dst  = pPlanes[i];
+        dst.A      = _mm_set1_ps(p[0]);
+        dst.B      = _mm_set1_ps(p[1]);
+        dst.C      = _mm_set1_ps(p[2]);
+        dst.D      = _mm_set1_ps(p[3]);
+        dst.AbsA   = _mm_set1_ps(std::fabs(p[0]));
+        dst.AbsB   = _mm_set1_ps(std::fabs(p[1]));
+        dst.AbsC   = _mm_set1_ps(std::fabs(p[2]));
+        dst.Length = _mm_set1_ps(std::sqrt(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]));
+    }
+}
+
+} // namespace
+
+
+///////////////////////////////////////////////////////////////////////////////
+// FrustumCuller class
+///////////////////////////////////////////////////////////////////////////////
+
+//-----------------------------------------------------------------------------
+//      コンストラクタです.
+//-----------------------------------------------------------------------------
+FrustumCuller::FrustumCuller()
+: m_Count   (0)
+, m_Stats   ()
+{ /* DO_NOTHING */ }
+
+//-----------------------------------------------------------------------------
+//      デストラクタです.
+//-----------------------------------------------------------------------------
+FrustumCuller::~FrustumCuller()
+{ Clear(); }
+
+//-----------------------------------------------------------------------------
+//      全てのボリュームを削除します.
+//-----------------------------------------------------------------------------
+void FrustumCuller::Clear()
+{
+    m_CenterX.clear();
+    m_CenterY.clear();
+    m_CenterZ.clear();
+    m_ExtentX.clear();
+    m_ExtentY.clear();
+    m_ExtentZ.clear();
+    m_Radius .clear();
+    m_Count = 0;
+}
+
+//-----------------------------------------------------------------------------
+//      メモリを予約します.
+//-----------------------------------------------------------------------------
+void FrustumCuller::Reserve(uint32_t count)
+{
+    auto size = (count + 3) & ~3u;
+    m_CenterX.reserve(size);
+    m_CenterY.reserve(size);
+    m_CenterZ.reserve(size);
+    m_ExtentX.reserve(size);
+    m_ExtentY.reserve(size);
+    m_ExtentZ.reserve(size);
+    m_Radius .reserve(size);
+}
+
+//-----------------------------------------------------------------------------
+//      ボリュームを追加します.
+//-----------------------------------------------------------------------------
+uint32_t FrustumCuller::Add(const MeshBounds& bounds)
+{
+    // 4つ単位で読めるように, 常に4の倍数の長さを確保しておく.
+    if ((m_Count & 3) == 0)
+    {
+        auto size = m_Count + 4;
+        m_CenterX.resize(size, 0.0f);
+        m_CenterY.resize(size, 0.0f);
+        m_CenterZ.resize(size, 0.0f);
+        m_ExtentX.resize(size, 0.0f);
+        m_ExtentY.resize(size, 0.0f);
+        m_ExtentZ.resize(size, 0.0f);
+        m_Radius .resize(size, 0.0f);
+    }
+
+    auto index = m_Count++;
+    Set(index, bounds);
+    return index;
+}
+
+//-----------------------------------------------------------------------------
+//      ボリュームを更新します.
+//-----------------------------------------------------------------------------
+void FrustumCuller::Set(uint32_t index, const MeshBounds& bounds)
+{
+    assert(index < m_Count);
+    m_CenterX[index] = bounds.Center.x;
+    m_CenterY[index] = bounds.Center.y;
+    m_CenterZ[index] = bounds.Center.z;
+    m_ExtentX[index] = bounds.Extent.x;
+    m_ExtentY[index] = bounds.Extent.y;
+    m_ExtentZ[index] = bounds.Extent.z;
+    m_Radius [index] = bounds.Radius;
+}
+
+//-----------------------------------------------------------------------------
+//      可視のボリュームを求めます.
+//-----------------------------------------------------------------------------
+uint32_t FrustumCuller::Cull
+(
+    const DirectX::XMMATRIX&    viewProj,
+    const OcclusionBuffer*      pOcclusion,
+    std::vector<uint32_t>&      visible
+)
+{
+    visible.clear();
+    m_Stats = CullingStats();
+    m_Stats.Tested = m_Count;
+
+    Plane planes[kPlaneCount];
+    ExtractPlanes(viewProj, planes);
+
+    const auto zero = _mm_setzero_ps();
+
+    for(auto i=0u; i<m_Count; i+=4)
+    {
+        auto cx  = _mm_loadu_ps(&m_CenterX[i]);
+        auto cy  = _mm_loadu_ps(&m_CenterY[i]);
+        auto cz  = _mm_loadu_ps(&m_CenterZ[i]);
+        auto ex  = _mm_loadu_ps(&m_ExtentX[i]);
+        auto ey  = _mm_loadu_ps(&m_ExtentY[i]);
+        auto ez  = _mm_loadu_ps(&m_ExtentZ[i]);
+        auto rad = _mm_loadu_ps(&m_Radius [i]);
+
+        auto outside = _mm_setzero_ps();
+        for(auto& p : planes)
+        {
+            auto dist = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(cx, p.A), _mm_mul_ps(cy, p.B)),
+                _mm_add_ps(_mm_mul_ps(cz, p.C), p.D));
+
+            auto boxRadius = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(ex, p.AbsA), _mm_mul_ps(ey, p.AbsB)),
+                _mm_mul_ps(ez, p.AbsC));
+            auto sphereRadius = _mm_mul_ps(rad, p.Length);
+
+            auto r = _mm_min_ps(boxRadius, sphereRadius);
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(dist, r), zero));
+        }
+
+        auto mask = _mm_movemask_ps(outside);
+        auto end  = std::min(m_Count - i, 4u);
+        for(auto j=0u; j<end; ++j)
+        {
+            if (mask & (1 << j))
+            {
+                m_Stats.FrustumCulled++;
+                continue;
+            }
+
+            auto index = i + j;
+            if (pOcclusion != nullptr)
+            {
+                MeshBounds bounds;
+                bounds.Center = DirectX::XMFLOAT3(m_CenterX[index], m_CenterY[index], m_CenterZ[index]);
+                bounds.Extent = DirectX::XMFLOAT3(m_ExtentX[index], m_ExtentY[index], m_ExtentZ[index]);
+                bounds.Radius = m_Radius[index];
+
+                if (!pOcclusion->IsVisible(bounds))
+                {
+                    m_Stats.OcclusionCulled++;
+                    continue;
+                }
+            }
+
+            visible.push_back(index);
+        }
+    }
+
+    m_Stats.Visible = uint32_t(visible.size());
+    return m_Stats.Visible;
+}
+
+//-----------------------------------------------------------------------------
+//      ボリューム数を取得します.
+//-----------------------------------------------------------------------------
+uint32_t FrustumCuller::GetCount() const
+{ return m_Count; }
+
+//-----------------------------------------------------------------------------
+//      直前の Cull() の統計を取得します.
+//-----------------------------------------------------------------------------
+const CullingStats& FrustumCuller::GetStats() const
+{ return m_Stats; }
@@ -0,0 +1,207 @@
+﻿//-----------------------------------------------------------------------------
+// File : GeometryArena.cpp
+// Desc : Merged Geometry Arena Module.
+// Copyright(c) Pocol. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include "GeometryArena.h"
+#include "PackedVertex.h"
+#include "Logger.h"
+#include <algorithm>
+
+
+//-----------------------------------------------------------------------------
+//      メッシュの頂点とインデックスをそれぞれ1つの配列に結合します.
+//-----------------------------------------------------------------------------
+bool BuildGeometryArena
+(
+    const std::vector<ResMesh>&         meshes,
+    std::vector<MeshVertex>&            vertices,
+    std::vector<uint32_t>&              indices,
+    std::vector<GeometryArenaRange>&    ranges
+)
+{
+    uint64_t vertexCount = 0;
+    uint64_t indexCount  = 0;
+    for(auto& mesh : meshes)
+    {
+        vertexCount += mesh.Vertices.size();
+        indexCount  += mesh.Indices.size() + mesh.LodIndices.size();
+    }
+
+    // ドローの引数は 32bit なので, 超える場合は結合できない.
+    if (vertexCount > UINT32_MAX || indexCount > UINT32_MAX)
+    { return false; }
+
+    vertices.clear();
+    indices .clear();
+    ranges  .clear();
+    vertices.reserve(size_t(vertexCount));
+    indices .reserve(size_t(indexCount));
+    ranges  .resize(meshes.size());
+
+    for(size_t i=0; i<meshes.size(); ++i)
+    {
+        auto& mesh  = meshes[i];
+        auto& range = ranges[i];
+        auto  first = uint32_t(indices.size());
+
+        range.BaseVertex  = uint32_t(vertices.size());
+        range.VertexCount = uint32_t(mesh.Vertices.size());
+        range.MaterialId  = mesh.MaterialId;
+
+        range.Lods.clear();
+        range.Lods.push_back({ first, uint32_t(mesh.Indices.size()), 0.0f, 0 });
+        for(auto lod : mesh.Lods)
+        {
+            lod.IndexOffset += first + uint32_t(mesh.Indices.size());
+            range.Lods.push_back(lod);
+        }
+
+        vertices.insert(vertices.end(), mesh.Vertices  .begin(), mesh.Vertices  .end());
+        indices .insert(indices .end(), mesh.Indices   .begin(), mesh.Indices   .end());
+        indices .insert(indices .end(), mesh.LodIndices.begin(), mesh.LodIndices.end());
+    }
+
+    // 正常終了.
+    return true;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// GeometryArena class
+///////////////////////////////////////////////////////////////////////////////
+
+//-----------------------------------------------------------------------------
+//      コンストラクタです.
+//-----------------------------------------------------------------------------
+GeometryArena::GeometryArena()
+: m_VertexCount (0)
+, m_IndexCount  (0)
+, m_Packed      (false)
+{ /* DO_NOTHING */ }
+
+//-----------------------------------------------------------------------------
+//      デストラクタです.
+//-----------------------------------------------------------------------------
+GeometryArena::~GeometryArena()
+{ Term(); }
+
+//-----------------------------------------------------------------------------
+//      初期化処理を行います.
+//-----------------------------------------------------------------------------
+bool GeometryArena::Init(ID3D12Device* pDevice, const std::vector<ResMesh>& meshes, bool packed)
+{
+    if (pDevice == nullptr)
+    {
+        ELOG( "Error : Invalid Argument." );
+        return false;
+    }
+
+    Term();
+
+    std::vector<MeshVertex> vertices;
+    std::vector<uint32_t>   indices;
+    if (!BuildGeometryArena(meshes, vertices, indices, m_Ranges))
+    {
+        ELOG( "Error : BuildGeometryArena() Failed." );
+        return false;
+    }
+
+    if (vertices.empty() || indices.empty())
+    {
+        ELOG( "Error : Empty Geometry." );
+        return false;
+    }
+
+    // ページより大きくなりやすいので, アロケータは使わずに専用のリソースを生成する.
+    if (packed)
+    {
+        // 量子化はメッシュ単位で行うので, 範囲ごとに圧縮して詰める.
+        std::vector<PackedVertex> packedVertices(vertices.size());
+        std::vector<PackedVertex> meshVertices;
+        for(size_t i=0; i<meshes.size(); ++i)
+        {
+            PackedVertexQuantization quantization;
+            PackVertices(meshes[i].Vertices, meshVertices, quantization);
+            std::copy(meshVertices.begin(), meshVertices.end(), packedVertices.begin() + m_Ranges[i].BaseVertex);
+        }
+
+        if (!m_VB.Init(pDevice, sizeof(PackedVertex) * packedVertices.size(), packedVertices.data()))
+        {
+            ELOG( "Error : VertexBuffer::Init() Failed." );
+            return false;
+        }
+    }
+    else if (!m_VB.Init(pDevice, sizeof(MeshVertex) * vertices.size(), vertices.data()))
+    {
+        ELOG( "Error : VertexBuffer::Init() Failed." );
+        return false;
+    }
+
+    if (!m_IB.Init(pDevice, sizeof(uint32_t) * indices.size(), indices.data()))
+    {
+        ELOG( "Error : IndexBuffer::Init() Failed." );
+        m_VB.Term();
+        return false;
+    }
+
+    m_VertexCount = uint32_t(vertices.size());
+    m_IndexCount  = uint32_t(indices.size());
+    m_Packed      = packed;
+
+    // 正常終了.
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      終了処理を行います.
+//-----------------------------------------------------------------------------
+void GeometryArena::Term()
+{
+    m_VB.Term();
+    m_IB.Term();
+    m_Ranges.clear();
+    m_VertexCount = 0;
+    m_IndexCount  = 0;
+    m_Packed      = false;
+}
+
+//-----------------------------------------------------------------------------
+//      頂点バッファとインデックスバッファを設定します.
+//-----------------------------------------------------------------------------
+void GeometryArena::Bind(ID3D12GraphicsCommandList* pCmdList) const
+{
+    auto VBV = m_VB.GetView();
+    auto IBV = m_IB.GetView();
+    pCmdList->IASetPrimitiveTopology( D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST );
+    pCmdList->IASetVertexBuffers(0, 1, &VBV);
+    pCmdList->IASetIndexBuffer(&IBV);
+}
+
+//-----------------------------------------------------------------------------
+//      メッシュごとの範囲を取得します.
+//-----------------------------------------------------------------------------
+const std::vector<GeometryArenaRange>& GeometryArena::GetRanges() const
+{ return m_Ranges; }
+
+//-----------------------------------------------------------------------------
+//      結合した頂点数を取得します.
+//-----------------------------------------------------------------------------
+uint32_t GeometryArena::GetVertexCount() const
+{ return m_VertexCount; }
+
+//-----------------------------------------------------------------------------
+//      結合したインデックス数を取得します.
+//-----------------------------------------------------------------------------
+uint32_t GeometryArena::GetIndexCount() const
+{ return m_IndexCount; }
+
+//-----------------------------------------------------------------------------
+//      頂点バッファが PackedVertex 形式かどうかを取得します.
+//-----------------------------------------------------------------------------
+bool GeometryArena::IsPacked() const
+{ return m_Packed; }
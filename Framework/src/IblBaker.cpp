@@ -0,0 +1,757 @@
+﻿//-----------------------------------------------------------------------------
+// File : IblBaker.cpp
+// Desc : Image Based Lighting Baker Module.
+// Copyright(c) Pocol. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include "IblBaker.h"
+#include "BRDF.h"
+#include "DdsFile.h"
+#include "ParallelUtil.h"
+#include "FileUtil.h"
+#include "Logger.h"
+#include <DirectXPackedVector.h>
+#include <Windows.h>
+#include <algorithm>
+#include <cfloat>
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+// Using Statements
+//-----------------------------------------------------------------------------
+using namespace DirectX;
+
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+constexpr uint32_t CubeFaceCount = 6;
+
+// 球面調和関数の基底の定数.
+constexpr float SH_Y0   = 0.282095f;    // 1/2 * sqrt(1/π)
+constexpr float SH_Y1   = 0.488603f;    // sqrt(3/(4π))
+constexpr float SH_Y2   = 1.092548f;    // 1/2 * sqrt(15/π)
+constexpr float SH_Y20  = 0.315392f;    // 1/4 * sqrt(5/π)
+constexpr float SH_Y22  = 0.546274f;    // 1/4 * sqrt(15/π)
+
+///////////////////////////////////////////////////////////////////////////////
+// PrefilterSample structure
+///////////////////////////////////////////////////////////////////////////////
+struct PrefilterSample
+{
+    XMFLOAT3    Dir;        //!< 接空間でのライト方向です.
+    float       Weight;     //!< N・L による重みです.
+    float       Lod;        //!< 入力をサンプリングするミップレベルです.
+};
+
+//-----------------------------------------------------------------------------
+//      2のべき乗かどうかチェックします.
+//-----------------------------------------------------------------------------
+inline bool IsPow2(uint32_t value)
+{ return (value != 0) && ((value & (value - 1)) == 0); }
+
+//-----------------------------------------------------------------------------
+//      ミップ数を求めます.
+//-----------------------------------------------------------------------------
+inline uint32_t CalcMipLevels(uint32_t size)
+{
+    uint32_t result = 1;
+    while (size > 1)
+    {
+        size >>= 1;
+        result++;
+    }
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+//      ミップのサイズを求めます.
+//-----------------------------------------------------------------------------
+inline uint32_t GetMipSize(uint32_t size, uint32_t mip)
+{ return std::max(size >> mip, 1u); }
+
+//-----------------------------------------------------------------------------
+//      Hammersley 点列を求めます.
+//-----------------------------------------------------------------------------
+inline XMFLOAT2 Hammersley(uint32_t index, uint32_t count)
+{
+    auto bits = index;
+    bits = (bits << 16) | (bits >> 16);
+    bits = ((bits & 0x55555555u) << 1) | ((bits & 0xAAAAAAAAu) >> 1);
+    bits = ((bits & 0x33333333u) << 2) | ((bits & 0xCCCCCCCCu) >> 2);
+    bits = ((bits & 0x0F0F0F0Fu) << 4) | ((bits & 0xF0F0F0F0u) >> 4);
+    bits = ((bits & 0x00FF00FFu) << 8) | ((bits & 0xFF00FF00u) >> 8);
+    return XMFLOAT2(float(index) / float(count), float(bits) * 2.3283064365386963e-10f);
+}
+
+//-----------------------------------------------------------------------------
+//      GGX 分布に従って接空間のハーフベクトルを求めます.
+//-----------------------------------------------------------------------------
+inline XMFLOAT3 ImportanceSampleGGX(const XMFLOAT2& xi, float a)
+{
+    auto phi      = 2.0f * F_PI * xi.x;
+    auto cosTheta = sqrtf((1.0f - xi.y) / (1.0f + (a * a - 1.0f) * xi.y));
+    auto sinTheta = sqrtf(std::max(1.0f - cosTheta * cosTheta, 0.0f));
+    return XMFLOAT3(sinTheta * cosf(phi), sinTheta * sinf(phi), cosTheta);
+}
+
+//-----------------------------------------------------------------------------
+//      キューブマップのテクセルの立体角を求める際の面積要素です.
+//-----------------------------------------------------------------------------
+inline float AreaElement(float x, float y)
+{ return atan2f(x * y, sqrtf(x * x + y * y + 1.0f)); }
+
+//-----------------------------------------------------------------------------
+//      方向からキューブマップの面と座標を求めます.
+//-----------------------------------------------------------------------------
+uint32_t GetCubeMapFace(const XMFLOAT3& dir, float& u, float& v)
+{
+    auto ax = fabsf(dir.x);
+    auto ay = fabsf(dir.y);
+    auto az = fabsf(dir.z);
+
+    if (ax >= ay && ax >= az)
+    {
+        auto inv = 1.0f / std::max(ax, FLT_MIN);
+        v = -dir.y * inv;
+        if (dir.x >= 0.0f)
+        { u = -dir.z * inv; return 0; }
+        u = dir.z * inv;
+        return 1;
+    }
+
+    if (ay >= az)
+    {
+        auto inv = 1.0f / ay;
+        u = dir.x * inv;
+        if (dir.y >= 0.0f)
+        { v = dir.z * inv; return 2; }
+        v = -dir.z * inv;
+        return 3;
+    }
+
+    auto inv = 1.0f / az;
+    v = -dir.y * inv;
+    if (dir.z >= 0.0f)
+    { u = dir.x * inv; return 4; }
+    u = -dir.x * inv;
+    return 5;
+}
+
+//-----------------------------------------------------------------------------
+//      キューブマップの1つのミップをバイリニアサンプリングします.
+//-----------------------------------------------------------------------------
+XMVECTOR SampleCubeMapLevel(const IblCubeMap& cube, uint32_t face, float u, float v, uint32_t mip)
+{
+    auto size   = GetMipSize(cube.Size, mip);
+    auto limit  = float(size - 1);
+    auto pTexel = cube.Texels.data() + GetCubeMapOffset(cube, face, mip);
+
+    auto s = std::min(std::max((u * 0.5f + 0.5f) * size - 0.5f, 0.0f), limit);
+    auto t = std::min(std::max((v * 0.5f + 0.5f) * size - 0.5f, 0.0f), limit);
+
+    auto x0 = uint32_t(s);
+    auto y0 = uint32_t(t);
+    auto x1 = std::min(x0 + 1, size - 1);
+    auto y1 = std::min(y0 + 1, size - 1);
+    auto fx = s - float(x0);
+    auto fy = t - float(y0);
+
+    auto c00 = XMLoadFloat4(&pTexel[y0 * size + x0]);
+    auto c10 = XMLoadFloat4(&pTexel[y0 * size + x1]);
+    auto c01 = XMLoadFloat4(&pTexel[y1 * size + x0]);
+    auto c11 = XMLoadFloat4(&pTexel[y1 * size + x1]);
+
+    return XMVectorLerp(XMVectorLerp(c00, c10, fx), XMVectorLerp(c01, c11, fx), fy);
+}
+
+//-----------------------------------------------------------------------------
+//      キューブマップをトライリニアサンプリングします.
+//-----------------------------------------------------------------------------
+XMVECTOR SampleCubeMapVector(const IblCubeMap& cube, const XMFLOAT3& dir, float lod)
+{
+    float u, v;
+    auto face = GetCubeMapFace(dir, u, v);
+
+    lod = std::min(std::max(lod, 0.0f), float(cube.MipLevels - 1));
+    auto mip0 = uint32_t(lod);
+    auto mip1 = std::min(mip0 + 1, cube.MipLevels - 1);
+    auto c0   = SampleCubeMapLevel(cube, face, u, v, mip0);
+    if (mip0 == mip1)
+    { return c0; }
+
+    auto c1 = SampleCubeMapLevel(cube, face, u, v, mip1);
+    return XMVectorLerp(c0, c1, lod - float(mip0));
+}
+
+//-----------------------------------------------------------------------------
+//      DDS ファイルに保存します.
+//-----------------------------------------------------------------------------
+bool SaveDDS
+(
+    const std::wstring&     path,
+    uint32_t                width,
+    uint32_t                height,
+    uint32_t                mipLevels,
+    bool                    isCube,
+    DXGI_FORMAT             format,
+    const void*             pData,
+    size_t                  dataSize
+)
+{
+    DdsInfo info = {};
+    info.Width      = width;
+    info.Height     = height;
+    info.Depth      = 1;
+    info.ArraySize  = (isCube) ? 6 : 1;
+    info.MipLevels  = mipLevels;
+    info.Format     = format;
+    info.IsCube     = isCube;
+
+    return SaveDdsFile(path.c_str(), info, pData, dataSize);
+}
+
+//-----------------------------------------------------------------------------
+//      BRDF LUT を保存します.
+//-----------------------------------------------------------------------------
+bool SaveBrdfLut(const std::wstring& path, uint32_t size, const std::vector<XMFLOAT2>& lut)
+{
+    std::vector<uint16_t> texels(lut.size() * 2);
+    for(size_t i=0; i<lut.size(); ++i)
+    {
+        texels[i * 2 + 0] = PackedVector::XMConvertFloatToHalf(lut[i].x);
+        texels[i * 2 + 1] = PackedVector::XMConvertFloatToHalf(lut[i].y);
+    }
+
+    return SaveDDS(
+        path, size, size, 1, false,
+        DXGI_FORMAT_R16G16_FLOAT,
+        texels.data(), texels.size() * sizeof(uint16_t));
+}
+
+//-----------------------------------------------------------------------------
+//      キューブマップを保存します.
+//-----------------------------------------------------------------------------
+bool SaveCubeMap(const std::wstring& path, const IblCubeMap& cube)
+{
+    std::vector<uint16_t> texels(cube.Texels.size() * 4);
+    for(size_t i=0; i<cube.Texels.size(); ++i)
+    {
+        auto& src = cube.Texels[i];
+        texels[i * 4 + 0] = PackedVector::XMConvertFloatToHalf(src.x);
+        texels[i * 4 + 1] = PackedVector::XMConvertFloatToHalf(src.y);
+        texels[i * 4 + 2] = PackedVector::XMConvertFloatToHalf(src.z);
+        texels[i * 4 + 3] = PackedVector::XMConvertFloatToHalf(src.w);
+    }
+
+    return SaveDDS(
+        path, cube.Size, cube.Size, cube.MipLevels, true,
+        DXGI_FORMAT_R16G16B16A16_FLOAT,
+        texels.data(), texels.size() * sizeof(uint16_t));
+}
+
+//-----------------------------------------------------------------------------
+//      球面調和係数を保存します.
+//-----------------------------------------------------------------------------
+bool SaveSH9(const std::wstring& path, const IblSH9& sh)
+{
+    XMFLOAT4 texels[9];
+    for(auto i=0; i<9; ++i)
+    { texels[i] = XMFLOAT4(sh.Coeffs[i].x, sh.Coeffs[i].y, sh.Coeffs[i].z, 0.0f); }
+
+    return SaveDDS(
+        path, 9, 1, 1, false,
+        DXGI_FORMAT_R32G32B32A32_FLOAT,
+        texels, sizeof(texels));
+}
+
+//-----------------------------------------------------------------------------
+//      FNV-1a でハッシュ値を更新します.
+//-----------------------------------------------------------------------------
+inline uint64_t HashValue(uint64_t hash, uint64_t value)
+{
+    for(auto i=0; i<8; ++i)
+    {
+        hash ^= (value >> (i * 8)) & 0xff;
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+} // namespace
+
+
+//-----------------------------------------------------------------------------
+//      キューブマップのテクセルの先頭位置を求めます.
+//-----------------------------------------------------------------------------
+size_t GetCubeMapOffset(const IblCubeMap& cube, uint32_t face, uint32_t mip)
+{
+    size_t faceSize = 0;
+    size_t offset   = 0;
+    for(auto i=0u; i<cube.MipLevels; ++i)
+    {
+        auto size = GetMipSize(cube.Size, i);
+        if (i == mip)
+        { offset = faceSize; }
+        faceSize += size_t(size) * size;
+    }
+
+    return faceSize * face + offset;
+}
+
+//-----------------------------------------------------------------------------
+//      キューブマップの面上の座標から方向を求めます.
+//-----------------------------------------------------------------------------
+XMFLOAT3 GetCubeMapDirection(uint32_t face, float u, float v)
+{
+    XMFLOAT3 dir;
+    switch(face)
+    {
+    case 0:  dir = XMFLOAT3( 1.0f,    -v,    -u); break;
+    case 1:  dir = XMFLOAT3(-1.0f,    -v,     u); break;
+    case 2:  dir = XMFLOAT3(    u,  1.0f,     v); break;
+    case 3:  dir = XMFLOAT3(    u, -1.0f,    -v); break;
+    case 4:  dir = XMFLOAT3(    u,    -v,  1.0f); break;
+    default: dir = XMFLOAT3(   -u,    -v, -1.0f); break;
+    }
+
+    auto inv = 1.0f / sqrtf(dir.x * dir.x + dir.y * dir.y + dir.z * dir.z);
+    return XMFLOAT3(dir.x * inv, dir.y * inv, dir.z * inv);
+}
+
+//-----------------------------------------------------------------------------
+//      キューブマップを方向でトライリニアサンプリングします.
+//-----------------------------------------------------------------------------
+XMFLOAT3 SampleCubeMap(const IblCubeMap& cube, const XMFLOAT3& dir, float lod)
+{
+    XMFLOAT3 result;
+    XMStoreFloat3(&result, SampleCubeMapVector(cube, dir, lod));
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+//      環境光源をキューブマップにキャプチャします.
+//-----------------------------------------------------------------------------
+bool CaptureEnvironment(const IblSourceFunc& source, uint32_t size, IblCubeMap& result)
+{
+    if (!source || !IsPow2(size))
+    { return false; }
+
+    result.Size      = size;
+    result.MipLevels = CalcMipLevels(size);
+    result.Texels.resize(GetCubeMapOffset(result, CubeFaceCount, 0));
+
+    // ミップ0はテクセル中心の方向で光源をサンプリング.
+    ParallelFor(CubeFaceCount * size, [&](size_t row)
+    {
+        auto face   = uint32_t(row / size);
+        auto y      = uint32_t(row % size);
+        auto pDst   = result.Texels.data() + GetCubeMapOffset(result, face, 0) + size_t(y) * size;
+        auto v      = (float(y) + 0.5f) / float(size) * 2.0f - 1.0f;
+
+        for(auto x=0u; x<size; ++x)
+        {
+            auto u     = (float(x) + 0.5f) / float(size) * 2.0f - 1.0f;
+            auto color = source(GetCubeMapDirection(face, u, v));
+            pDst[x] = XMFLOAT4(color.x, color.y, color.z, 1.0f);
+        }
+    });
+
+    // 1つ上のミップの 2x2 テクセルを平均して縮小.
+    for(auto mip=1u; mip<result.MipLevels; ++mip)
+    {
+        auto dstSize = GetMipSize(size, mip);
+        auto srcSize = GetMipSize(size, mip - 1);
+
+        ParallelFor(CubeFaceCount * dstSize, [&](size_t row)
+        {
+            auto face   = uint32_t(row / dstSize);
+            auto y      = uint32_t(row % dstSize);
+            auto pSrc   = result.Texels.data() + GetCubeMapOffset(result, face, mip - 1);
+            auto pDst   = result.Texels.data() + GetCubeMapOffset(result, face, mip) + size_t(y) * dstSize;
+
+            for(auto x=0u; x<dstSize; ++x)
+            {
+                auto p0  = pSrc + size_t(y * 2) * srcSize + x * 2;
+                auto p1  = p0 + srcSize;
+                auto sum = XMVectorAdd(
+                    XMVectorAdd(XMLoadFloat4(&p0[0]), XMLoadFloat4(&p0[1])),
+                    XMVectorAdd(XMLoadFloat4(&p1[0]), XMLoadFloat4(&p1[1])));
+                XMStoreFloat4(&pDst[x], XMVectorScale(sum, 0.25f));
+            }
+        });
+    }
+
+    // 正常終了.
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      スプリットサム近似の BRDF 積分テーブルを生成します.
+//-----------------------------------------------------------------------------
+bool BakeBrdfLut(uint32_t size, uint32_t sampleCount, std::vector<XMFLOAT2>& result)
+{
+    if (size == 0 || sampleCount == 0)
+    { return false; }
+
+    result.resize(size_t(size) * size);
+
+    ParallelFor(size, [&](size_t y)
+    {
+        auto roughness = (float(y) + 0.5f) / float(size);
+        auto a  = roughness * roughness;
+        auto m2 = a * a;
+
+        for(auto x=0u; x<size; ++x)
+        {
+            // 接空間 (N = +Z) で視線ベクトルを決める.
+            auto NV = (float(x) + 0.5f) / float(size);
+            auto V  = XMFLOAT3(sqrtf(1.0f - NV * NV), 0.0f, NV);
+
+            auto A = 0.0f;
+            auto B = 0.0f;
+            for(auto i=0u; i<sampleCount; ++i)
+            {
+                auto H  = ImportanceSampleGGX(Hammersley(i, sampleCount), a);
+                auto VH = V.x * H.x + V.y * H.y + V.z * H.z;
+                auto NL = 2.0f * VH * H.z - V.z;
+                if (NL <= 0.0f)
+                { continue; }
+
+                // pdf = D * NH / (4 * VH) で割った BRDF * NL から F0 の項とバイアスの項を分離する.
+                auto NH    = std::max(H.z, 1e-6f);
+                auto G_Vis = G2_Smith(NL, NV, m2) * VH / (NH * NV);
+                auto Fc    = powf(1.0f - VH, 5.0f);
+                A += (1.0f - Fc) * G_Vis;
+                B += Fc * G_Vis;
+            }
+
+            result[y * size + x] = XMFLOAT2(A / float(sampleCount), B / float(sampleCount));
+        }
+    });
+
+    // 正常終了.
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      GGX で事前フィルタしたキューブマップを生成します.
+//-----------------------------------------------------------------------------
+bool PrefilterEnvironment
+(
+    const IblCubeMap&   environment,
+    uint32_t            size,
+    uint32_t            mipLevels,
+    uint32_t            sampleCount,
+    IblCubeMap&         result
+)
+{
+    if (environment.Texels.empty() || size == 0 || mipLevels == 0 || sampleCount == 0)
+    { return false; }
+
+    result.Size      = size;
+    result.MipLevels = std::min(mipLevels, CalcMipLevels(size));
+    result.Texels.resize(GetCubeMapOffset(result, CubeFaceCount, 0));
+
+    // 入力のミップ0の1テクセルあたりの立体角.
+    auto envSize     = float(environment.Size);
+    auto texelSolid  = 4.0f * F_PI / (6.0f * envSize * envSize);
+
+    for(auto mip=0u; mip<result.MipLevels; ++mip)
+    {
+        auto mipSize   = GetMipSize(size, mip);
+        auto roughness = (result.MipLevels > 1) ? float(mip) / float(result.MipLevels - 1) : 0.0f;
+        auto a         = roughness * roughness;
+        auto m2        = a * a;
+
+        // N = V = R とした接空間のサンプルを事前に求めておく.
+        std::vector<PrefilterSample> samples;
+        if (mip == 0 || roughness <= 0.0f)
+        {
+            // 鏡面反射は出力のテクセルに見合うミップをそのまま参照する.
+            PrefilterSample sample;
+            sample.Dir    = XMFLOAT3(0.0f, 0.0f, 1.0f);
+            sample.Weight = 1.0f;
+            sample.Lod    = std::max(log2f(envSize / float(mipSize)), 0.0f);
+            samples.push_back(sample);
+        }
+        else
+        {
+            samples.reserve(sampleCount);
+            for(auto i=0u; i<sampleCount; ++i)
+            {
+                auto H  = ImportanceSampleGGX(Hammersley(i, sampleCount), a);
+                auto NL = 2.0f * H.z * H.z - 1.0f;
+                if (NL <= 0.0f)
+                { continue; }
+
+                // NH = VH なので pdf = D / 4. サンプルの立体角に見合うミップを選ぶ.
+                auto pdf         = D_GGX(m2, H.z) * 0.25f;
+                auto sampleSolid = 1.0f / (float(sampleCount) * pdf + 1e-6f);
+
+                PrefilterSample sample;
+                sample.Dir    = XMFLOAT3(2.0f * H.z * H.x, 2.0f * H.z * H.y, NL);
+                sample.Weight = NL;
+                sample.Lod    = std::max(0.5f * log2f(sampleSolid / texelSolid) + 1.0f, 0.0f);
+                samples.push_back(sample);
+            }
+        }
+
+        ParallelFor(CubeFaceCount * mipSize, [&](size_t row)
+        {
+            auto face   = uint32_t(row / mipSize);
+            auto y      = uint32_t(row % mipSize);
+            auto pDst   = result.Texels.data() + GetCubeMapOffset(result, face, mip) + size_t(y) * mipSize;
+            auto v      = (float(y) + 0.5f) / float(mipSize) * 2.0f - 1.0f;
+
+            for(auto x=0u; x<mipSize; ++x)
+            {
+                auto u   = (float(x) + 0.5f) / float(mipSize) * 2.0f - 1.0f;
+                auto dir = GetCubeMapDirection(face, u, v);
+
+                // 法線を軸とする接空間を作る.
+                auto N  = XMLoadFloat3(&dir);
+                auto up = (fabsf(dir.z) < 0.999f) ? XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f) : XMVectorSet(1.0f, 0.0f, 0.0f, 0.0f);
+                auto T  = XMVector3Normalize(XMVector3Cross(up, N));
+                auto B  = XMVector3Cross(N, T);
+
+                auto sum    = XMVectorZero();
+                auto weight = 0.0f;
+                for(auto& sample : samples)
+                {
+                    auto L = XMVectorScale(T, sample.Dir.x);
+                    L = XMVectorMultiplyAdd(B, XMVectorReplicate(sample.Dir.y), L);
+                    L = XMVectorMultiplyAdd(N, XMVectorReplicate(sample.Dir.z), L);
+
+                    XMFLOAT3 L3;
+                    XMStoreFloat3(&L3, L);
+
+                    auto color = SampleCubeMapVector(environment, L3, sample.Lod);
+                    sum = XMVectorMultiplyAdd(color, XMVectorReplicate(sample.Weight), sum);
+                    weight += sample.Weight;
+                }
+
+                sum = XMVectorScale(sum, 1.0f / std::max(weight, 1e-6f));
+                XMStoreFloat4(&pDst[x], XMVectorSetW(sum, 1.0f));
+            }
+        });
+    }
+
+    // 正常終了.
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      キューブマップを球面調和関数に射影します.
+//-----------------------------------------------------------------------------
+bool ProjectIrradianceSH9(const IblCubeMap& environment, IblSH9& result)
+{
+    if (environment.Texels.empty() || environment.Size == 0)
+    { return false; }
+
+    auto size     = environment.Size;
+    auto rowCount = CubeFaceCount * size;
+    auto invSize  = 1.0f / float(size);
+
+    // 行ごとに部分和を求めてから足し合わせる.
+    std::vector<double> partials(size_t(rowCount) * 27, 0.0);
+
+    ParallelFor(rowCount, [&](size_t row)
+    {
+        auto face   = uint32_t(row / size);
+        auto y      = uint32_t(row % size);
+        auto pSrc   = environment.Texels.data() + GetCubeMapOffset(environment, face, 0) + size_t(y) * size;
+        auto pSum   = partials.data() + row * 27;
+        auto v0     = float(y) * 2.0f * invSize - 1.0f;
+        auto v1     = v0 + 2.0f * invSize;
+
+        for(auto x=0u; x<size; ++x)
+        {
+            auto u0 = float(x) * 2.0f * invSize - 1.0f;
+            auto u1 = u0 + 2.0f * invSize;
+
+            // テクセルの四隅から正確な立体角を求める.
+            auto solid = AreaElement(u0, v0) - AreaElement(u0, v1) - AreaElement(u1, v0) + AreaElement(u1, v1);
+
+            auto dir = GetCubeMapDirection(face, (u0 + u1) * 0.5f, (v0 + v1) * 0.5f);
+            float basis[9] = {
+                SH_Y0,
+                SH_Y1  * dir.y,
+                SH_Y1  * dir.z,
+                SH_Y1  * dir.x,
+                SH_Y2  * dir.x * dir.y,
+                SH_Y2  * dir.y * dir.z,
+                SH_Y20 * (3.0f * dir.z * dir.z - 1.0f),
+                SH_Y2  * dir.x * dir.z,
+                SH_Y22 * (dir.x * dir.x - dir.y * dir.y),
+            };
+
+            auto& color = pSrc[x];
+            for(auto i=0; i<9; ++i)
+            {
+                auto w = double(basis[i] * solid);
+                pSum[i * 3 + 0] += color.x * w;
+                pSum[i * 3 + 1] += color.y * w;
+                pSum[i * 3 + 2] += color.z * w;
+            }
+        }
+    });
+
+    double sums[27] = {};
+    for(size_t row=0; row<rowCount; ++row)
+    {
+        for(auto i=0; i<27; ++i)
+        { sums[i] += partials[row * 27 + i]; }
+    }
+
+    // 余弦ローブとの畳み込みは帯域ごとの係数を掛けるだけで済む.
+    const float bands[9] = {
+        F_PI,
+        F_PI * 2.0f / 3.0f, F_PI * 2.0f / 3.0f, F_PI * 2.0f / 3.0f,
+        F_PI * 0.25f, F_PI * 0.25f, F_PI * 0.25f, F_PI * 0.25f, F_PI * 0.25f,
+    };
+
+    for(auto i=0; i<9; ++i)
+    {
+        result.Coeffs[i] = XMFLOAT3(
+            float(sums[i * 3 + 0]) * bands[i],
+            float(sums[i * 3 + 1]) * bands[i],
+            float(sums[i * 3 + 2]) * bands[i]);
+    }
+
+    // 正常終了.
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      球面調和係数から放射照度を求めます.
+//-----------------------------------------------------------------------------
+XMFLOAT3 EvaluateIrradianceSH9(const IblSH9& sh, const XMFLOAT3& n)
+{
+    float basis[9] = {
+        SH_Y0,
+        SH_Y1  * n.y,
+        SH_Y1  * n.z,
+        SH_Y1  * n.x,
+        SH_Y2  * n.x * n.y,
+        SH_Y2  * n.y * n.z,
+        SH_Y20 * (3.0f * n.z * n.z - 1.0f),
+        SH_Y2  * n.x * n.z,
+        SH_Y22 * (n.x * n.x - n.y * n.y),
+    };
+
+    auto result = XMVectorZero();
+    for(auto i=0; i<9; ++i)
+    { result = XMVectorMultiplyAdd(XMLoadFloat3(&sh.Coeffs[i]), XMVectorReplicate(basis[i]), result); }
+
+    XMFLOAT3 irradiance;
+    XMStoreFloat3(&irradiance, XMVectorMax(result, XMVectorZero()));
+    return irradiance;
+}
+
+//-----------------------------------------------------------------------------
+//      キャッシュファイルのパスを求めます.
+//-----------------------------------------------------------------------------
+IblCachePaths GetIblCachePaths(const wchar_t* basePath, uint64_t sourceKey, const IblBakeDesc& desc)
+{
+    // BRDF LUT は環境光源に依存しないので別のハッシュにする.
+    auto lutHash = HashValue(0xcbf29ce484222325ull, desc.LutSize);
+    lutHash = HashValue(lutHash, desc.LutSamples);
+
+    auto envHash = HashValue(0xcbf29ce484222325ull, sourceKey);
+    envHash = HashValue(envHash, desc.EnvironmentSize);
+    envHash = HashValue(envHash, desc.SpecularSize);
+    envHash = HashValue(envHash, desc.SpecularMipLevels);
+    envHash = HashValue(envHash, desc.SpecularSamples);
+
+    wchar_t lutName[64];
+    wchar_t envName[64];
+    swprintf_s(lutName, L"%016llx", static_cast<unsigned long long>(lutHash));
+    swprintf_s(envName, L"%016llx", static_cast<unsigned long long>(envHash));
+
+    std::wstring base = (basePath != nullptr) ? basePath : L"";
+
+    IblCachePaths result;
+    result.BrdfLut    = base + L"_brdf_"       + lutName + L".dds";
+    result.Specular   = base + L"_specular_"   + envName + L".dds";
+    result.Irradiance = base + L"_irradiance_" + envName + L".dds";
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+//      IBL の各テクスチャを生成して保存します.
+//-----------------------------------------------------------------------------
+bool BakeIbl
+(
+    const IblSourceFunc&    source,
+    const IblBakeDesc&      desc,
+    const IblCachePaths&    paths,
+    bool                    force
+)
+{
+    auto needLut        = force || PathFileExistsW(paths.BrdfLut   .c_str()) == FALSE;
+    auto needSpecular   = force || PathFileExistsW(paths.Specular  .c_str()) == FALSE;
+    auto needIrradiance = force || PathFileExistsW(paths.Irradiance.c_str()) == FALSE;
+
+    if (needLut)
+    {
+        std::vector<XMFLOAT2> lut;
+        if (!BakeBrdfLut(desc.LutSize, desc.LutSamples, lut))
+        {
+            ELOG( "Error : BakeBrdfLut() Failed." );
+            return false;
+        }
+
+        if (!SaveBrdfLut(paths.BrdfLut, desc.LutSize, lut))
+        { return false; }
+
+        DLOG( "IBL : baked BRDF LUT. path = %ls", paths.BrdfLut.c_str() );
+    }
+
+    if (!needSpecular && !needIrradiance)
+    { return true; }
+
+    IblCubeMap environment;
+    if (!CaptureEnvironment(source, desc.EnvironmentSize, environment))
+    {
+        ELOG( "Error : CaptureEnvironment() Failed." );
+        return false;
+    }
+
+    if (needSpecular)
+    {
+        IblCubeMap specular;
+        if (!PrefilterEnvironment(environment, desc.SpecularSize, desc.SpecularMipLevels, desc.SpecularSamples, specular))
+        {
+            ELOG( "Error : PrefilterEnvironment() Failed." );
+            return false;
+        }
+
+        if (!SaveCubeMap(paths.Specular, specular))
+        { return false; }
+
+        DLOG( "IBL : baked specular cube map. path = %ls, mips = %u", paths.Specular.c_str(), specular.MipLevels );
+    }
+
+    if (needIrradiance)
+    {
+        IblSH9 sh;
+        if (!ProjectIrradianceSH9(environment, sh))
+        {
+            ELOG( "Error : ProjectIrradianceSH9() Failed." );
+            return false;
+        }
+
+        if (!SaveSH9(paths.Irradiance, sh))
+        { return false; }
+
+        DLOG( "IBL : baked irradiance SH9. path = %ls", paths.Irradiance.c_str() );
+    }
+
+    // 正常終了.
+    return true;
+}
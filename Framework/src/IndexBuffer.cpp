@@ -18,7 +18,9 @@
 //      コンストラクタです.
 //-----------------------------------------------------------------------------
 IndexBuffer::IndexBuffer()
-: m_pIB(nullptr)
+: m_pIB         (nullptr)
+, m_pAllocator  (nullptr)
+, m_Allocation  ()
 { memset(&m_View, 0, sizeof(m_View)); }
 
 //-----------------------------------------------------------------------------
@@ -30,8 +32,34 @@ IndexBuffer::~IndexBuffer()
 //-----------------------------------------------------------------------------
 //      初期化処理を行います.
 //-----------------------------------------------------------------------------
-bool IndexBuffer::Init(ID3D12Device* pDevice, size_t size, const uint32_t* pInitData)
+bool IndexBuffer::Init
+(
+    ID3D12Device*       pDevice,
+    size_t              size,
+    const uint32_t*     pInitData,
+    UploadAllocator*    pAllocator
+)
 {
+    // アロケータがあればページから切り出す.
+    if (pAllocator != nullptr)
+    {
+        if (!pAllocator->Allocate(size, sizeof(uint32_t), m_Allocation))
+        { return false; }
+
+        m_pAllocator = pAllocator;
+        m_pIB        = m_Allocation.pResource;
+
+        m_View.BufferLocation   = m_Allocation.GpuAddress;
+        m_View.Format           = DXGI_FORMAT_R32_UINT;
+        m_View.SizeInBytes      = UINT(size);
+
+        if (pInitData != nullptr)
+        { memcpy(m_Allocation.pCpu, pInitData, size); }
+
+        // 正常終了.
+        return true;
+    }
+
     // ヒーププロパティ.
     D3D12_HEAP_PROPERTIES prop = {};
     prop.Type                   = D3D12_HEAP_TYPE_UPLOAD;
@@ -79,7 +107,7 @@ bool IndexBuffer::Init(ID3D12Device* pDevice, size_t size, const uint32_t* pInit
 
         memcpy(ptr, pInitData, size);
 
-        m_pIB->Unmap(0, nullptr);
+        Unmap();
     }
 
     // 正常終了.
@@ -91,6 +119,14 @@ bool IndexBuffer::Init(ID3D12Device* pDevice, size_t size, const uint32_t* pInit
 //-----------------------------------------------------------------------------
 void IndexBuffer::Term()
 {
+    // アロケータから切り出した領域はアロケータに返却します.
+    if (m_pAllocator != nullptr)
+    {
+        m_pAllocator->Free(m_Allocation);
+        m_pAllocator = nullptr;
+        m_Allocation = UploadAllocation();
+    }
+
     m_pIB.Reset();
     memset(&m_View, 0, sizeof(m_View));
 }
@@ -100,6 +136,9 @@ void IndexBuffer::Term()
 //-----------------------------------------------------------------------------
 uint32_t* IndexBuffer::Map()
 {
+    if (m_pAllocator != nullptr)
+    { return reinterpret_cast<uint32_t*>(m_Allocation.pCpu); }
+
     uint32_t* ptr;
     auto hr = m_pIB->Map(0, nullptr, reinterpret_cast<void**>(&ptr));
     if (FAILED(hr))
@@ -112,7 +151,13 @@ uint32_t* IndexBuffer::Map()
 //      メモリマッピングを解除します.
 //-----------------------------------------------------------------------------
 void IndexBuffer::Unmap()
-{ m_pIB->Unmap(0, nullptr); }
+{
+    // アロケータのページは永続的にマップされています.
+    if (m_pAllocator != nullptr)
+    { return; }
+
+    m_pIB->Unmap(0, nullptr);
+}
 
 //-----------------------------------------------------------------------------
 //      インデックスバッファビューを取得します.
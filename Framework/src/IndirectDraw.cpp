@@ -0,0 +1,151 @@
+﻿//-----------------------------------------------------------------------------
+// File : IndirectDraw.cpp
+// Desc : Indirect Draw Argument Module.
+// Copyright(c) Pocol. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include "IndirectDraw.h"
+#include "Logger.h"
+#include <algorithm>
+
+
+//-----------------------------------------------------------------------------
+//      ドローの引数を詰めます.
+//-----------------------------------------------------------------------------
+uint32_t BuildIndirectDrawArgs
+(
+    const std::vector<GeometryArenaRange>&  ranges,
+    const IndirectDrawItem*                 pItems,
+    size_t                                  count,
+    uint32_t                                materialCount,
+    std::vector<IndirectDrawArgs>&          result
+)
+{
+    result.clear();
+    if (pItems == nullptr)
+    { return 0; }
+
+    result.reserve(count);
+
+    uint32_t triangles = 0;
+    for(size_t i=0; i<count; ++i)
+    {
+        auto& item = pItems[i];
+        if (item.Mesh >= ranges.size() || ranges[item.Mesh].Lods.empty())
+        { continue; }
+
+        auto& range = ranges[item.Mesh];
+        auto& level = range.Lods[std::min<size_t>(item.Lod, range.Lods.size() - 1)];
+        if (level.IndexCount == 0)
+        { continue; }
+
+        IndirectDrawArgs args = {};
+        args.Transform                      = item.Transform;
+        args.MaterialId                     = (range.MaterialId < materialCount) ? range.MaterialId : 0;
+        args.Draw.IndexCountPerInstance     = level.IndexCount;
+        args.Draw.InstanceCount             = 1;
+        args.Draw.StartIndexLocation        = level.IndexOffset;
+        args.Draw.BaseVertexLocation        = INT(range.BaseVertex);
+        args.Draw.StartInstanceLocation     = 0;
+        result.push_back(args);
+
+        triangles += level.IndexCount / 3;
+    }
+
+    return triangles;
+}
+
+//-----------------------------------------------------------------------------
+//      ドローの引数が結合したバッファの範囲内を指しているかチェックします.
+//-----------------------------------------------------------------------------
+bool ValidateIndirectDrawArgs
+(
+    const IndirectDrawArgs* pArgs,
+    size_t                  count,
+    const uint32_t*         pIndices,
+    uint32_t                indexCount,
+    uint32_t                vertexCount,
+    uint32_t                materialCount
+)
+{
+    if (pArgs == nullptr && count > 0)
+    { return false; }
+
+    for(size_t i=0; i<count; ++i)
+    {
+        auto& args = pArgs[i];
+        auto& draw = args.Draw;
+
+        if (args.Transform == 0 || args.MaterialId >= materialCount)
+        { return false; }
+
+        if (draw.InstanceCount == 0 || draw.BaseVertexLocation < 0 || uint32_t(draw.BaseVertexLocation) >= vertexCount)
+        { return false; }
+
+        if (uint64_t(draw.StartIndexLocation) + draw.IndexCountPerInstance > indexCount)
+        { return false; }
+
+        if (pIndices == nullptr)
+        { continue; }
+
+        // 頂点番号にベースを足した位置が頂点バッファの外に出ないこと.
+        for(auto j=0u; j<draw.IndexCountPerInstance; ++j)
+        {
+            if (uint64_t(pIndices[draw.StartIndexLocation + j]) + uint32_t(draw.BaseVertexLocation) >= vertexCount)
+            { return false; }
+        }
+    }
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      IndirectDrawArgs を解釈するコマンドシグニチャを生成します.
+//-----------------------------------------------------------------------------
+bool CreateIndirectDrawSignature
+(
+    ID3D12Device*               pDevice,
+    ID3D12RootSignature*        pRootSig,
+    uint32_t                    transformParam,
+    uint32_t                    materialParam,
+    ID3D12CommandSignature**    ppSignature
+)
+{
+    if (pDevice == nullptr || pRootSig == nullptr || ppSignature == nullptr)
+    {
+        ELOG( "Error : Invalid Argument." );
+        return false;
+    }
+
+    // IndirectDrawArgs のメンバと同じ順に並べる.
+    D3D12_INDIRECT_ARGUMENT_DESC args[3] = {};
+    args[0].Type                                  = D3D12_INDIRECT_ARGUMENT_TYPE_CONSTANT_BUFFER_VIEW;
+    args[0].ConstantBufferView.RootParameterIndex = transformParam;
+
+    args[1].Type                                  = D3D12_INDIRECT_ARGUMENT_TYPE_CONSTANT;
+    args[1].Constant.RootParameterIndex           = materialParam;
+    args[1].Constant.DestOffsetIn32BitValues      = 0;
+    args[1].Constant.Num32BitValuesToSet          = 1;
+
+    args[2].Type                                  = D3D12_INDIRECT_ARGUMENT_TYPE_DRAW_INDEXED;
+
+    D3D12_COMMAND_SIGNATURE_DESC desc = {};
+    desc.ByteStride         = sizeof(IndirectDrawArgs);
+    desc.NumArgumentDescs   = _countof(args);
+    desc.pArgumentDescs     = args;
+    desc.NodeMask           = 0;
+
+    // ルート引数を書き換えるのでルートシグニチャが必要.
+    auto hr = pDevice->CreateCommandSignature(&desc, pRootSig, IID_PPV_ARGS(ppSignature));
+    if (FAILED(hr))
+    {
+        ELOG( "Error : ID3D12Device::CreateCommandSignature() Failed. retcode = 0x%x", hr );
+        return false;
+    }
+
+    // 正常終了.
+    return true;
+}
@@ -0,0 +1,127 @@
+﻿//-----------------------------------------------------------------------------
+// File : MappedFile.cpp
+// Desc : Memory Mapped File Module.
+// Copyright(c) Pocol. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include "MappedFile.h"
+
+
+///////////////////////////////////////////////////////////////////////////////
+// MappedFile class
+///////////////////////////////////////////////////////////////////////////////
+
+//-----------------------------------------------------------------------------
+//      コンストラクタです.
+//-----------------------------------------------------------------------------
+MappedFile::MappedFile()
+: m_File    (INVALID_HANDLE_VALUE)
+, m_Mapping (nullptr)
+, m_pData   (nullptr)
+, m_Size    (0)
+{ /* DO_NOTHING */ }
+
+//-----------------------------------------------------------------------------
+//      デストラクタです.
+//-----------------------------------------------------------------------------
+MappedFile::~MappedFile()
+{ Close(); }
+
+//-----------------------------------------------------------------------------
+//      ファイルをメモリマッピングします.
+//-----------------------------------------------------------------------------
+bool MappedFile::Open(const wchar_t* filename)
+{
+    if (filename == nullptr)
+    { return false; }
+
+    Close();
+
+    // ファイルを開く.
+    m_File = CreateFileW(
+        filename,
+        GENERIC_READ,
+        FILE_SHARE_READ,
+        nullptr,
+        OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+        nullptr);
+    if (m_File == INVALID_HANDLE_VALUE)
+    { return false; }
+
+    // ファイルサイズを取得.
+    LARGE_INTEGER size = {};
+    if (!GetFileSizeEx(m_File, &size) || size.QuadPart == 0)
+    {
+        Close();
+        return false;
+    }
+
+    // マッピングオブジェクトを生成.
+    m_Mapping = CreateFileMappingW(m_File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (m_Mapping == nullptr)
+    {
+        Close();
+        return false;
+    }
+
+    // ビューをマッピング.
+    m_pData = static_cast<const uint8_t*>(MapViewOfFile(m_Mapping, FILE_MAP_READ, 0, 0, 0));
+    if (m_pData == nullptr)
+    {
+        Close();
+        return false;
+    }
+
+    m_Size = uint64_t(size.QuadPart);
+
+    // 正常終了.
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      マッピングを解除してファイルを閉じます.
+//-----------------------------------------------------------------------------
+void MappedFile::Close()
+{
+    if (m_pData != nullptr)
+    {
+        UnmapViewOfFile(m_pData);
+        m_pData = nullptr;
+    }
+
+    if (m_Mapping != nullptr)
+    {
+        CloseHandle(m_Mapping);
+        m_Mapping = nullptr;
+    }
+
+    if (m_File != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(m_File);
+        m_File = INVALID_HANDLE_VALUE;
+    }
+
+    m_Size = 0;
+}
+
+//-----------------------------------------------------------------------------
+//      マッピング済みの先頭ポインタを取得します.
+//-----------------------------------------------------------------------------
+const uint8_t* MappedFile::GetData() const
+{ return m_pData; }
+
+//-----------------------------------------------------------------------------
+//      ファイルサイズを取得します.
+//-----------------------------------------------------------------------------
+uint64_t MappedFile::GetSize() const
+{ return m_Size; }
+
+//-----------------------------------------------------------------------------
+//      マッピング済みかどうかチェックします.
+//-----------------------------------------------------------------------------
+bool MappedFile::IsOpen() const
+{ return m_pData != nullptr; }
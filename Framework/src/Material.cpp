@@ -8,8 +8,13 @@
 // Includes
 //-------------------------------------------------------------------------------------------------
 #include "Material.h"
+#include "BlockCompressor.h"
 #include "FileUtil.h"
 #include "Logger.h"
+#include "ParallelUtil.h"
+#include <DDSTextureLoader.h>
+#include <cstring>
+#include <memory>
 
 
 namespace {
@@ -19,6 +24,75 @@ namespace {
 //-----------------------------------------------------------------------------
 constexpr wchar_t* DummyTag = L"";
 
+///////////////////////////////////////////////////////////////////////////////
+// TextureLoadResult structure
+///////////////////////////////////////////////////////////////////////////////
+struct TextureLoadResult
+{
+    ComPtr<ID3D12Resource>              pResource;      //!< 生成したリソースです.
+    std::unique_ptr<uint8_t[]>          pData;          //!< ファイルデータです(Subresources が参照します).
+    std::vector<D3D12_SUBRESOURCE_DATA> Subresources;   //!< サブリソースデータです.
+    std::wstring                        LoadPath;       //!< 読み込んだファイルパスです.
+    bool                                IsCube;         //!< キューブマップかどうか.
+    HRESULT                             Result;         //!< 実行結果です.
+};
+
+//-----------------------------------------------------------------------------
+//      テクスチャファイルとして読み込めるパスを検索します.
+//-----------------------------------------------------------------------------
+bool FindTexturePath(const std::wstring& path, std::wstring& findPath)
+{
+    // ファイルパスが存在するかチェックします.
+    if (!SearchFilePathW(path.c_str(), findPath))
+    { return false; }
+
+    // ファイル名であることをチェック.
+    if (PathIsDirectoryW(findPath.c_str()) != FALSE)
+    { return false; }
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      テクスチャの使用用途に合わせた圧縮の種類を取得します.
+//-----------------------------------------------------------------------------
+BC_TEXTURE_TYPE GetBcTextureType(Material::TEXTURE_USAGE usage)
+{
+    switch(usage)
+    {
+    case Material::TEXTURE_USAGE_NORMAL:
+        return BC_TEXTURE_NORMAL;
+
+    case Material::TEXTURE_USAGE_SHININESS:
+    case Material::TEXTURE_USAGE_METALLIC:
+    case Material::TEXTURE_USAGE_ROUGHNESS:
+        return BC_TEXTURE_MASK;
+
+    default:
+        return BC_TEXTURE_COLOR;
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      読み込むテクスチャファイルのパスを求めます.
+//-----------------------------------------------------------------------------
+std::wstring GetLoadPath(const std::wstring& findPath, Material::TEXTURE_USAGE usage, bool compress)
+{
+    // ORM は PrepareOrmTexture() で3チャンネルを保ったまま圧縮済みなのでそのまま読み込む.
+    if (usage == Material::TEXTURE_USAGE_ORM)
+    { return findPath; }
+
+    // 非圧縮のテクスチャはブロック圧縮したキャッシュを読み込む. 圧縮できない場合は元のファイルのまま.
+    // 圧縮は時間が掛かるため, compress が false の場合は作成済みのキャッシュだけを使います.
+    std::wstring loadPath;
+    if (compress)
+    { PrepareCompressedTexture(findPath, GetBcTextureType(usage), loadPath); }
+    else
+    { FindCompressedTexture(findPath, GetBcTextureType(usage), loadPath); }
+
+    return loadPath;
+}
+
 }// namespace
 
 
@@ -30,8 +104,11 @@ constexpr wchar_t* DummyTag = L"";
 //      コンストラクタです.
 //-----------------------------------------------------------------------------
 Material::Material()
-: m_pDevice(nullptr)
-, m_pPool  (nullptr)
+: m_pDevice     (nullptr)
+, m_pPool       (nullptr)
+, m_pAllocator  (nullptr)
+, m_Table       ()
+, m_pStreamer   (nullptr)
 { /* DO_NOTHING */ }
 
 //-----------------------------------------------------------------------------
@@ -45,10 +122,11 @@ Material::~Material()
 //-----------------------------------------------------------------------------
 bool Material::Init
 (
-    ID3D12Device*   pDevice,
-    DescriptorPool* pPool,
-    size_t          bufferSize,
-    size_t          count
+    ID3D12Device*       pDevice,
+    DescriptorPool*     pPool,
+    size_t              bufferSize,
+    size_t              count,
+    UploadAllocator*    pAllocator
 )
 {
     if (pDevice == nullptr || pPool == nullptr || count == 0)
@@ -65,6 +143,8 @@ bool Material::Init
     m_pPool = pPool;
     m_pPool->AddRef();
 
+    m_pAllocator = pAllocator;
+
     m_Subset.resize(count);
 
     // ダミーテクスチャ生成.
@@ -107,7 +187,7 @@ bool Material::Init
                 return false;
             }
 
-            if (!pBuffer->Init(pDevice, pPool, bufferSize))
+            if (!pBuffer->Init(pDevice, pPool, bufferSize, pAllocator))
             {
                 ELOG( "Error : ConstantBuffer::Init() Failed." );
                 return false;
@@ -115,7 +195,10 @@ bool Material::Init
 
             m_Subset[i].pCostantBuffer = pBuffer;
             for(auto j=0; j<TEXTURE_USAGE_COUNT; ++j)
-            { m_Subset[i].TextureHandle[j].ptr = 0; }
+            {
+                m_Subset[i].TextureHandle[j].ptr = 0;
+                m_Subset[i].StreamId[j]          = TextureStreamer::InvalidId;
+            }
         }
     }
     else
@@ -124,7 +207,10 @@ bool Material::Init
         {
             m_Subset[i].pCostantBuffer = nullptr;
             for(auto j=0; j<TEXTURE_USAGE_COUNT; ++j)
-            { m_Subset[i].TextureHandle[j].ptr = 0; }
+            {
+                m_Subset[i].TextureHandle[j].ptr = 0;
+                m_Subset[i].StreamId[j]          = TextureStreamer::InvalidId;
+            }
         }
     }
 
@@ -156,7 +242,25 @@ void Material::Term()
         }
     }
 
+    // ストリーミングテクスチャは描画中の可能性があるので, ストリーマー側でフレーム完了後に破棄される.
+    if (m_pStreamer != nullptr)
+    {
+        for(auto& itr : m_Streamed)
+        { m_pStreamer->Unregister(itr.second); }
+    }
+
+    if (m_pAllocator != nullptr && m_Table.pResource != nullptr)
+    { m_pAllocator->Free(m_Table); }
+
+    m_pStreamer  = nullptr;
+
+    m_pAllocator = nullptr;
+    m_Table      = UploadAllocation();
+
     m_pTexture.clear();
+    m_Request.clear();
+    m_StreamReq.clear();
+    m_Streamed.clear();
     m_Subset.clear();
 
     if (m_pDevice != nullptr)
@@ -196,21 +300,15 @@ bool Material::SetTexture
 
     // ファイルパスが存在するかチェックします.
     std::wstring findPath;
-    if (!SearchFilePathW(path.c_str(), findPath))
+    if (!FindTexturePath(path, findPath))
     {
         // 存在しない場合はダミーテクスチャを設定.
         m_Subset[index].TextureHandle[usage] = m_pTexture[DummyTag]->GetHandleGPU();
         return true;
     }
 
-    // ファイル名であることをチェック.
-    {
-        if (PathIsDirectoryW(findPath.c_str()) != FALSE)
-        {
-            m_Subset[index].TextureHandle[usage] = m_pTexture[DummyTag]->GetHandleGPU();
-            return true;
-        }
-    }
+    // 呼び出しスレッドを止めないように, ブロック圧縮は作成済みのキャッシュがある場合だけ使います.
+    auto loadPath = GetLoadPath(findPath, usage, false);
 
     // インスタンス生成.
     auto pTexture = new (std::nothrow) Texture();
@@ -223,7 +321,7 @@ bool Material::SetTexture
     bool isSRGB = (usage == TEXTURE_USAGE_DIFFUSE);
 
     // 初期化.
-    if (!pTexture->Init(m_pDevice, m_pPool, findPath.c_str(), isSRGB, batch))
+    if (!pTexture->Init(m_pDevice, m_pPool, loadPath.c_str(), isSRGB, batch))
     {
         ELOG( "Error : Texture::Init() Failed." );
         pTexture->Term();
@@ -239,12 +337,431 @@ bool Material::SetTexture
     return true;
 }
 
+//-----------------------------------------------------------------------------
+//      テクスチャの非同期ロードを要求します.
+//-----------------------------------------------------------------------------
+bool Material::SetTextureAsync
+(
+    size_t                          index,
+    TEXTURE_USAGE                   usage,
+    const std::wstring&             path
+)
+{
+    // 範囲内であるかチェック.
+    if (index >= GetCount())
+    { return false; }
+
+    // 既にロード済みかチェック.
+    auto itr = m_pTexture.find(path);
+    if (itr != m_pTexture.end())
+    {
+        m_Subset[index].TextureHandle[usage] = itr->second->GetHandleGPU();
+        return true;
+    }
+
+    // 既に要求済みであれば設定対象を追加するだけにします.
+    auto req = m_Request.find(path);
+    if (req != m_Request.end())
+    {
+        req->second.Targets.push_back({ index, usage });
+        return true;
+    }
+
+    // ファイルパスが存在するかチェックします.
+    std::wstring findPath;
+    if (!FindTexturePath(path, findPath))
+    {
+        // 存在しない場合はダミーテクスチャを設定.
+        m_Subset[index].TextureHandle[usage] = m_pTexture[DummyTag]->GetHandleGPU();
+        return true;
+    }
+
+    // 要求を登録. ブロック圧縮は CommitTextures() のワーカースレッドで行います.
+    auto& request = m_Request[path];
+    request.FindPath = findPath;
+    request.Usage    = usage;
+    request.IsSRGB   = (usage == TEXTURE_USAGE_DIFFUSE);
+    request.Targets.push_back({ index, usage });
+
+    // ロード完了までの間はダミーテクスチャを設定しておく.
+    m_Subset[index].TextureHandle[usage] = m_pTexture[DummyTag]->GetHandleGPU();
+
+    // 正常終了.
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      要求済みのテクスチャをロードします.
+//-----------------------------------------------------------------------------
+bool Material::CommitTextures(DirectX::ResourceUploadBatch& batch)
+{
+    // ストリーミングテクスチャはミップの読み込みをストリーマーが行うので登録だけします.
+    auto ret = CommitStreamedTextures();
+
+    if (m_Request.empty())
+    { return ret; }
+
+    std::vector<const std::wstring*>    paths;
+    std::vector<TextureRequest*>        requests;
+    paths   .reserve(m_Request.size());
+    requests.reserve(m_Request.size());
+    for(auto& itr : m_Request)
+    {
+        paths   .push_back(&itr.first);
+        requests.push_back(&itr.second);
+    }
+
+    std::vector<TextureLoadResult> results(requests.size());
+
+    // ブロック圧縮とファイル読み込み, DDS解析, リソース生成をワーカースレッドで行います.
+    // ID3D12Device はフリースレッドなのでリソース生成も並列に行えます.
+    ParallelFor(requests.size(), [&](size_t i)
+    {
+        auto  request = requests[i];
+        auto& result  = results[i];
+
+        result.LoadPath = GetLoadPath(request->FindPath, request->Usage, true);
+
+        auto flag = DirectX::DDS_LOADER_MIP_AUTOGEN;
+        if (request->IsSRGB)
+        { flag |= DirectX::DDS_LOADER_FORCE_SRGB; }
+
+        result.IsCube = false;
+        result.Result = DirectX::LoadDDSTextureFromFileEx(
+            m_pDevice,
+            result.LoadPath.c_str(),
+            0,
+            D3D12_RESOURCE_FLAG_NONE,
+            flag,
+            result.pResource.GetAddressOf(),
+            result.pData,
+            result.Subresources,
+            nullptr,
+            &result.IsCube);
+    });
+
+    // アップロードバッチへの登録はスレッドセーフではないため呼び出しスレッドで行います.
+    for(size_t i=0; i<requests.size(); ++i)
+    {
+        auto  request = requests[i];
+        auto& result  = results[i];
+        auto  handle  = m_pTexture[DummyTag]->GetHandleGPU();
+
+        if (FAILED(result.Result))
+        {
+            ELOG( "Error : DirectX::LoadDDSTextureFromFileEx() Failed. filename = %ls, retcode = 0x%x",
+                result.LoadPath.c_str(), result.Result );
+            ret = false;
+        }
+        else
+        {
+            auto desc        = result.pResource->GetDesc();
+            auto generateMip = (result.Subresources.size() != desc.MipLevels);
+
+            // ミップマップ生成に対応していないフォーマットの場合はミップ無しで作り直します.
+            if (generateMip && !batch.IsSupportedForGenerateMips(desc.Format))
+            {
+                auto flag = DirectX::DDS_LOADER_DEFAULT;
+                if (request->IsSRGB)
+                { flag |= DirectX::DDS_LOADER_FORCE_SRGB; }
+
+                // 稀なケースなので呼び出しスレッドで読み直します.
+                result.pResource.Reset();
+                result.Result = DirectX::LoadDDSTextureFromFileEx(
+                    m_pDevice,
+                    result.LoadPath.c_str(),
+                    0,
+                    D3D12_RESOURCE_FLAG_NONE,
+                    flag,
+                    result.pResource.GetAddressOf(),
+                    result.pData,
+                    result.Subresources,
+                    nullptr,
+                    &result.IsCube);
+                generateMip = false;
+            }
+
+            auto pTexture = (SUCCEEDED(result.Result)) ? new (std::nothrow) Texture() : nullptr;
+            if (pTexture == nullptr)
+            {
+                ELOG( "Error : Texture Create Failed. filename = %ls", result.LoadPath.c_str() );
+                ret = false;
+            }
+            else if (!pTexture->Init(m_pDevice, m_pPool, result.pResource.Get(), result.IsCube))
+            {
+                ELOG( "Error : Texture::Init() Failed." );
+                pTexture->Term();
+                delete pTexture;
+                ret = false;
+            }
+            else
+            {
+                batch.Upload(
+                    result.pResource.Get(),
+                    0,
+                    result.Subresources.data(),
+                    UINT(result.Subresources.size()));
+
+                batch.Transition(
+                    result.pResource.Get(),
+                    D3D12_RESOURCE_STATE_COPY_DEST,
+                    D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+
+                if (generateMip)
+                { batch.GenerateMips(result.pResource.Get()); }
+
+                // 登録.
+                m_pTexture[*paths[i]] = pTexture;
+                handle = pTexture->GetHandleGPU();
+            }
+        }
+
+        for(auto& target : request->Targets)
+        { m_Subset[target.Index].TextureHandle[target.Usage] = handle; }
+    }
+
+    m_Request.clear();
+
+    return ret;
+}
+
+//-----------------------------------------------------------------------------
+//      テクスチャをストリーミングで設定します.
+//-----------------------------------------------------------------------------
+bool Material::SetTextureStreamed
+(
+    size_t                          index,
+    TEXTURE_USAGE                   usage,
+    const std::wstring&             path,
+    TextureStreamer*                pStreamer
+)
+{
+    // 範囲内であるかチェック.
+    if (index >= GetCount())
+    { return false; }
+
+    if (pStreamer == nullptr || (m_pStreamer != nullptr && m_pStreamer != pStreamer))
+    {
+        ELOG( "Error : Invalid Argument." );
+        return false;
+    }
+
+    auto& subset = m_Subset[index];
+
+    // 既に登録済みかチェック.
+    auto itr = m_Streamed.find(path);
+    if (itr != m_Streamed.end())
+    {
+        subset.TextureHandle[usage] = pStreamer->GetHandleGPU(itr->second);
+        subset.StreamId[usage]      = itr->second;
+        return true;
+    }
+
+    // 登録されるまではダミーテクスチャを設定.
+    subset.TextureHandle[usage] = m_pTexture[DummyTag]->GetHandleGPU();
+    subset.StreamId[usage]      = TextureStreamer::InvalidId;
+
+    // 既に要求済みであれば設定対象を追加するだけにします.
+    auto req = m_StreamReq.find(path);
+    if (req != m_StreamReq.end())
+    {
+        req->second.Targets.push_back({ index, usage });
+        return true;
+    }
+
+    // ファイルパスが存在するかチェックします.
+    std::wstring findPath;
+    if (!FindTexturePath(path, findPath))
+    { return true; }
+
+    // 要求を登録. ブロック圧縮とストリーマーへの登録は CommitTextures() で行います.
+    auto& request = m_StreamReq[path];
+    request.FindPath = findPath;
+    request.Usage    = usage;
+    request.IsSRGB   = (usage == TEXTURE_USAGE_DIFFUSE);
+    request.Targets.push_back({ index, usage });
+
+    m_pStreamer = pStreamer;
+
+    // 正常終了.
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      要求済みのストリーミングテクスチャをストリーマーに登録します.
+//-----------------------------------------------------------------------------
+bool Material::CommitStreamedTextures()
+{
+    if (m_StreamReq.empty())
+    { return true; }
+
+    std::vector<TextureRequest*> requests;
+    requests.reserve(m_StreamReq.size());
+    for(auto& itr : m_StreamReq)
+    { requests.push_back(&itr.second); }
+
+    // ブロック圧縮はワーカースレッドで行います.
+    std::vector<std::wstring> loadPaths(requests.size());
+    ParallelFor(requests.size(), [&](size_t i)
+    { loadPaths[i] = GetLoadPath(requests[i]->FindPath, requests[i]->Usage, true); });
+
+    auto   ret = true;
+    size_t i   = 0;
+    for(auto& itr : m_StreamReq)
+    {
+        auto& request  = itr.second;
+        auto& loadPath = loadPaths[i++];
+
+        // 末尾ミップのアップロードは次の TextureStreamer::Update() で投入されます.
+        auto id = m_pStreamer->Register(loadPath.c_str(), request.IsSRGB);
+        if (id == TextureStreamer::InvalidId)
+        {
+            ELOG( "Error : TextureStreamer::Register() Failed. filename = %ls", loadPath.c_str() );
+            ret = false;
+            continue;
+        }
+
+        m_Streamed[itr.first] = id;
+
+        for(auto& target : request.Targets)
+        {
+            auto& subset = m_Subset[target.Index];
+            subset.TextureHandle[target.Usage] = m_pStreamer->GetHandleGPU(id);
+            subset.StreamId     [target.Usage] = id;
+        }
+    }
+
+    m_StreamReq.clear();
+
+    return ret;
+}
+
+//-----------------------------------------------------------------------------
+//      ストリーミングテクスチャのミップを要求します.
+//-----------------------------------------------------------------------------
+void Material::RequestTextures(size_t index, float screenSize)
+{
+    if (index >= GetCount() || m_pStreamer == nullptr)
+    { return; }
+
+    for(auto i=0; i<TEXTURE_USAGE_COUNT; ++i)
+    {
+        auto id    = m_Subset[index].StreamId[i];
+        auto pInfo = m_pStreamer->GetInfo(id);
+        if (pInfo == nullptr)
+        { continue; }
+
+        // 画面上で大きく見えるものほど優先する.
+        auto mip = CalcStreamingMip(pInfo->Width, pInfo->Height, screenSize);
+        m_pStreamer->Request(id, mip, screenSize * screenSize);
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      ストリーミングテクスチャのハンドルを更新します.
+//-----------------------------------------------------------------------------
+bool Material::RefreshStreamedTextures()
+{
+    if (m_pStreamer == nullptr)
+    { return true; }
+
+    for(auto& subset : m_Subset)
+    {
+        for(auto i=0; i<TEXTURE_USAGE_COUNT; ++i)
+        {
+            if (subset.StreamId[i] != TextureStreamer::InvalidId)
+            { subset.TextureHandle[i] = m_pStreamer->GetHandleGPU(subset.StreamId[i]); }
+        }
+    }
+
+    // ディスクリプタが作り直されて番号が変わるのでテーブルも作り直す.
+    return CommitTable();
+}
+
+//-----------------------------------------------------------------------------
+//      マテリアルパラメータを設定します.
+//-----------------------------------------------------------------------------
+void Material::SetParam(size_t index, const MaterialParam& param)
+{
+    if (index >= GetCount())
+    { return; }
+
+    m_Subset[index].Param = param;
+}
+
+//-----------------------------------------------------------------------------
+//      マテリアルテーブルを構築します.
+//-----------------------------------------------------------------------------
+bool Material::CommitTable()
+{
+    if (m_pAllocator == nullptr || m_Subset.empty())
+    {
+        ELOG( "Error : Invalid Operation." );
+        return false;
+    }
+
+    // シェーダ側の並びに合わせてテクスチャ番号を取り出します.
+    static const TEXTURE_USAGE kUsage[MATERIAL_MAP_COUNT] = {
+        TEXTURE_USAGE_BASE_COLOR,
+        TEXTURE_USAGE_NORMAL,
+        TEXTURE_USAGE_ORM,
+    };
+
+    auto dummy = m_pTexture[DummyTag]->GetHandleGPU();
+
+    std::vector<MaterialParam> params(m_Subset.size());
+    std::vector<uint32_t>      maps  (m_Subset.size() * MATERIAL_MAP_COUNT);
+    for(size_t i=0; i<m_Subset.size(); ++i)
+    {
+        params[i] = m_Subset[i].Param;
+
+        // ダミーテクスチャは値が 0 なので, ORM が無い場合は環境光が消えないようにオクルージョンを無効にする.
+        auto orm = m_Subset[i].TextureHandle[TEXTURE_USAGE_ORM];
+        if (orm.ptr == 0 || orm.ptr == dummy.ptr)
+        { params[i].Occlusion = 0.0f; }
+
+        for(auto j=0; j<MATERIAL_MAP_COUNT; ++j)
+        {
+            auto handle = m_Subset[i].TextureHandle[kUsage[j]];
+            maps[i * MATERIAL_MAP_COUNT + j] = (handle.ptr != 0) ? m_pPool->GetHandleIndex(handle) : InvalidTextureIndex;
+        }
+    }
+
+    auto fallback = m_pPool->GetHandleIndex(dummy);
+
+    std::vector<MaterialEntry> table;
+    if (!PackMaterialTable(params, maps, fallback, m_pPool->GetHandleCount(), table))
+    {
+        ELOG( "Error : PackMaterialTable() Failed." );
+        return false;
+    }
+
+    UploadAllocation allocation;
+    auto size = sizeof(MaterialEntry) * table.size();
+    if (!m_pAllocator->Allocate(size, D3D12_RAW_UAV_SRV_BYTE_ALIGNMENT, allocation))
+    {
+        ELOG( "Error : UploadAllocator::Allocate() Failed." );
+        return false;
+    }
+
+    memcpy(allocation.pCpu, table.data(), size);
+
+    // 描画中の可能性があるので古いテーブルはフレーム完了後に回収させる.
+    if (m_Table.pResource != nullptr)
+    { m_pAllocator->Free(m_Table); }
+
+    m_Table = allocation;
+
+    // 正常終了.
+    return true;
+}
+
 //-----------------------------------------------------------------------------
 //      定数バッファのポインタを取得します.
 //-----------------------------------------------------------------------------
 void* Material::GetBufferPtr(size_t index) const
 {
-    if(index >= GetCount())
+    if(index >= GetCount() || m_Subset[index].pCostantBuffer == nullptr)
     { return nullptr; }
 
     return m_Subset[index].pCostantBuffer->GetPtr();
@@ -255,7 +772,7 @@ void* Material::GetBufferPtr(size_t index) const
 //-----------------------------------------------------------------------------
 D3D12_GPU_VIRTUAL_ADDRESS Material::GetBufferAddress(size_t index) const
 {
-    if (index >= GetCount())
+    if (index >= GetCount() || m_Subset[index].pCostantBuffer == nullptr)
     { return D3D12_GPU_VIRTUAL_ADDRESS(); }
 
     return m_Subset[index].pCostantBuffer->GetAddress();
@@ -272,6 +789,12 @@ D3D12_GPU_DESCRIPTOR_HANDLE Material::GetTextureHandle(size_t index, TEXTURE_USA
     return m_Subset[index].TextureHandle[usage];
 }
 
+//-----------------------------------------------------------------------------
+//      マテリアルテーブルのGPU仮想アドレスを取得します.
+//-----------------------------------------------------------------------------
+D3D12_GPU_VIRTUAL_ADDRESS Material::GetTableAddress() const
+{ return (m_Table.pResource != nullptr) ? m_Table.GpuAddress : D3D12_GPU_VIRTUAL_ADDRESS(); }
+
 //-----------------------------------------------------------------------------
 //      マテリアル数を取得します.
 //-----------------------------------------------------------------------------
@@ -0,0 +1,79 @@
+﻿//-----------------------------------------------------------------------------
+// File : MaterialTable.cpp
+// Desc : Bindless Material Table Module.
+// Copyright(c) Pocol. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <MaterialTable.h>
+#include <algorithm>
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+//      [0,1] に丸めます. NaN は 0 にします.
+//-----------------------------------------------------------------------------
+inline float Saturate(float value)
+{ return (value > 0.0f) ? std::min(value, 1.0f) : 0.0f; }
+
+//-----------------------------------------------------------------------------
+//      負の値を 0 にします. NaN も 0 にします.
+//-----------------------------------------------------------------------------
+inline float ClampPositive(float value)
+{ return (value > 0.0f) ? value : 0.0f; }
+
+} // namespace
+
+
+//-----------------------------------------------------------------------------
+//      1マテリアル分のエントリを詰めます.
+//-----------------------------------------------------------------------------
+MaterialEntry PackMaterialEntry
+(
+    const MaterialParam&    param,
+    const uint32_t*         pMaps,
+    uint32_t                fallback,
+    uint32_t                limit
+)
+{
+    MaterialEntry entry = {};
+    entry.BaseColor.x = ClampPositive(param.BaseColor.x);
+    entry.BaseColor.y = ClampPositive(param.BaseColor.y);
+    entry.BaseColor.z = ClampPositive(param.BaseColor.z);
+    entry.Alpha       = Saturate(param.Alpha);
+    entry.Roughness   = Saturate(param.Roughness);
+    entry.Metallic    = Saturate(param.Metallic);
+    entry.Occlusion   = Saturate(param.Occlusion);
+
+    // 範囲外の番号でヒープの外を読まないように代わりのテクスチャを指す.
+    for(auto i=0; i<MATERIAL_MAP_COUNT; ++i)
+    { entry.Maps[i] = (pMaps[i] < limit) ? pMaps[i] : fallback; }
+
+    return entry;
+}
+
+//-----------------------------------------------------------------------------
+//      マテリアルテーブルを詰めます.
+//-----------------------------------------------------------------------------
+bool PackMaterialTable
+(
+    const std::vector<MaterialParam>&   params,
+    const std::vector<uint32_t>&        maps,
+    uint32_t                            fallback,
+    uint32_t                            limit,
+    std::vector<MaterialEntry>&         result
+)
+{
+    if (maps.size() != params.size() * MATERIAL_MAP_COUNT || fallback >= limit)
+    { return false; }
+
+    result.resize(params.size());
+    for(size_t i=0; i<params.size(); ++i)
+    { result[i] = PackMaterialEntry(params[i], &maps[i * MATERIAL_MAP_COUNT], fallback, limit); }
+
+    // 正常終了.
+    return true;
+}
@@ -8,6 +8,7 @@
 // Includes
 //-----------------------------------------------------------------------------
 #include "Mesh.h"
+#include <algorithm>
 
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -20,6 +21,10 @@
 Mesh::Mesh()
 : m_MaterialId(UINT32_MAX)
 , m_IndexCount(0)
+, m_VertexCount(0)
+, m_Packed(false)
+, m_Quantization()
+, m_Bounds()
 { /* DO_NOTHING */ }
 
 //-----------------------------------------------------------------------------
@@ -31,22 +36,71 @@ Mesh::~Mesh()
 //-----------------------------------------------------------------------------
 //      初期化処理を行います.
 //-----------------------------------------------------------------------------
-bool Mesh::Init(ID3D12Device* pDevice, const ResMesh& resource)
+bool Mesh::Init
+(
+    ID3D12Device*       pDevice,
+    const ResMesh&      resource,
+    bool                packed,
+    UploadAllocator*    pAllocator
+)
 {
     if (pDevice == nullptr)
     { return false; }
 
-    if (!m_VB.Init(
-        pDevice, sizeof(MeshVertex) * resource.Vertices.size(), resource.Vertices.data()))
-    { return false; }
+    if (packed)
+    {
+        // 圧縮した頂点で作成すると頂点バッファは半分以下になります.
+        std::vector<PackedVertex> vertices;
+        PackVertices(resource.Vertices, vertices, m_Quantization);
 
-    if (!m_IB.Init(
-        pDevice, sizeof(uint32_t) * resource.Indices.size(), resource.Indices.data()))
-    { return false; }
+        if (!m_VB.Init(
+            pDevice, sizeof(PackedVertex) * vertices.size(), vertices.data(), pAllocator))
+        { return false; }
+    }
+    else
+    {
+        m_Quantization = PackedVertexQuantization();
+
+        if (!m_VB.Init(
+            pDevice, sizeof(MeshVertex) * resource.Vertices.size(), resource.Vertices.data(), pAllocator))
+        { return false; }
+    }
+
+    // LOD1 以降のインデックスは LOD0 の後ろに詰めて1つのバッファにします.
+    m_Lods.clear();
+    m_Lods.push_back({ 0, uint32_t(resource.Indices.size()), 0.0f, 0 });
+    if (resource.Lods.empty())
+    {
+        if (!m_IB.Init(
+            pDevice, sizeof(uint32_t) * resource.Indices.size(), resource.Indices.data(), pAllocator))
+        { return false; }
+    }
+    else
+    {
+        std::vector<uint32_t> indices;
+        indices.reserve(resource.Indices.size() + resource.LodIndices.size());
+        indices.insert(indices.end(), resource.Indices   .begin(), resource.Indices   .end());
+        indices.insert(indices.end(), resource.LodIndices.begin(), resource.LodIndices.end());
+
+        for(auto lod : resource.Lods)
+        {
+            lod.IndexOffset += uint32_t(resource.Indices.size());
+            m_Lods.push_back(lod);
+        }
+
+        if (!m_IB.Init(
+            pDevice, sizeof(uint32_t) * indices.size(), indices.data(), pAllocator))
+        { return false; }
+    }
+
+    // カリング用に圧縮前の位置から求めておく.
+    m_Bounds = resource.Vertices.empty() ? MeshBounds() : ComputeMeshBounds(
+        &resource.Vertices[0].Position, resource.Vertices.size(), sizeof(MeshVertex));
 
     m_MaterialId = resource.MaterialId;
     m_IndexCount = uint32_t(resource.Indices.size());
     m_VertexCount = uint32_t(resource.Vertices.size());
+    m_Packed      = packed;
     return true;
 }
 
@@ -60,23 +114,76 @@ void Mesh::Term()
     m_MaterialId = UINT32_MAX;
     m_IndexCount = 0;
     m_VertexCount = 0;
+    m_Packed = false;
+    m_Bounds = MeshBounds();
+    m_Lods.clear();
 }
 
 //-----------------------------------------------------------------------------
 //      描画処理を行います.
 //-----------------------------------------------------------------------------
-void Mesh::Draw(ID3D12GraphicsCommandList* pCmdList)
+void Mesh::Draw(ID3D12GraphicsCommandList* pCmdList, uint32_t lod)
 {
+    if (m_Lods.empty())
+    { return; }
+
+    auto& level = m_Lods[std::min<size_t>(lod, m_Lods.size() - 1)];
+
     auto VBV = m_VB.GetView();
     auto IBV = m_IB.GetView();
     pCmdList->IASetPrimitiveTopology( D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST );
     pCmdList->IASetVertexBuffers(0, 1, &VBV);
     pCmdList->IASetIndexBuffer(&IBV);
-    pCmdList->DrawIndexedInstanced(m_IndexCount, 1, 0, 0, 0);
+    pCmdList->DrawIndexedInstanced(level.IndexCount, 1, level.IndexOffset, 0, 0);
+}
+
+//-----------------------------------------------------------------------------
+//      投影後の誤差が閾値以下になる最も粗い詳細度を選択します.
+//-----------------------------------------------------------------------------
+uint32_t Mesh::SelectLod(float pixelsPerUnit, float threshold) const
+{
+    // 誤差は粗いレベルほど大きいので, 粗い方から探す.
+    for(auto i=uint32_t(m_Lods.size()); i>1; --i)
+    {
+        if (m_Lods[i - 1].Error * pixelsPerUnit <= threshold)
+        { return i - 1; }
+    }
+
+    return 0;
 }
 
+//-----------------------------------------------------------------------------
+//      詳細度の数を取得します.
+//-----------------------------------------------------------------------------
+uint32_t Mesh::GetLodCount() const
+{ return uint32_t(m_Lods.size()); }
+
+//-----------------------------------------------------------------------------
+//      詳細度のインデックス数を取得します.
+//-----------------------------------------------------------------------------
+uint32_t Mesh::GetLodIndexCount(uint32_t lod) const
+{ return (lod < m_Lods.size()) ? m_Lods[lod].IndexCount : 0; }
+
 //-----------------------------------------------------------------------------
 //      マテリアルIDを取得します.
 //-----------------------------------------------------------------------------
 uint32_t Mesh::GetMaterialId() const
 { return m_MaterialId; }
+
+//-----------------------------------------------------------------------------
+//      頂点バッファが PackedVertex 形式かどうかを取得します.
+//-----------------------------------------------------------------------------
+bool Mesh::IsPacked() const
+{ return m_Packed; }
+
+//-----------------------------------------------------------------------------
+//      位置の復元パラメータを取得します.
+//-----------------------------------------------------------------------------
+const PackedVertexQuantization& Mesh::GetQuantization() const
+{ return m_Quantization; }
+
+//-----------------------------------------------------------------------------
+//      ローカル空間のバウンディングボリュームを取得します.
+//-----------------------------------------------------------------------------
+const MeshBounds& Mesh::GetBounds() const
+{ return m_Bounds; }
@@ -0,0 +1,150 @@
+﻿//-----------------------------------------------------------------------------
+// File : MeshBounds.cpp
+// Desc : Mesh Bounding Volume Module.
+// Copyright(c) Pocol. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include "MeshBounds.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <immintrin.h>
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+//      頂点位置を読み込みます.
+//-----------------------------------------------------------------------------
+inline __m128 LoadPosition(const uint8_t* pData)
+{
+    auto pos = reinterpret_cast<const DirectX::XMFLOAT3*>(pData);
+    return _mm_setr_ps(pos->x, pos->y, pos->z, 0.0f);
+}
+
+//-----------------------------------------------------------------------------
+//      バウンディングボリュームを求めます.
+//-----------------------------------------------------------------------------
+template<typename GetPosition>
+MeshBounds ComputeBounds(size_t count, GetPosition getPosition)
+{
+    MeshBounds result = {};
+    if (count == 0)
+    { return result; }
+
+    // AABB を求める.
+    auto mini = getPosition(0);
+    auto maxi = mini;
+    for(size_t i=1; i<count; ++i)
+    {
+        auto pos = getPosition(i);
+        mini = _mm_min_ps(mini, pos);
+        maxi = _mm_max_ps(maxi, pos);
+    }
+
+    auto half   = _mm_set1_ps(0.5f);
+    auto center = _mm_mul_ps(_mm_add_ps(mini, maxi), half);
+    auto extent = _mm_mul_ps(_mm_sub_ps(maxi, mini), half);
+
+    // 境界球は AABB の中心から最も遠い頂点までとし, 対角線の半分より小さくなるようにする.
+    auto maxDist = _mm_setzero_ps();
+    for(size_t i=0; i<count; ++i)
+    {
+        auto d = _mm_sub_ps(getPosition(i), center);
+        d = _mm_mul_ps(d, d);
+        auto dist = _mm_add_ss(_mm_add_ss(d, _mm_shuffle_ps(d, d, _MM_SHUFFLE(1, 1, 1, 1))),
+                               _mm_shuffle_ps(d, d, _MM_SHUFFLE(2, 2, 2, 2)));
+        maxDist = _mm_max_ss(maxDist, dist);
+    }
+
+    alignas(16) float c[4];
+    alignas(16) float e[4];
+    _mm_store_ps(c, center);
+    _mm_store_ps(e, extent);
+
+    result.Center = DirectX::XMFLOAT3(c[0], c[1], c[2]);
+    result.Extent = DirectX::XMFLOAT3(e[0], e[1], e[2]);
+    result.Radius = std::sqrt(_mm_cvtss_f32(maxDist));
+
+    return result;
+}
+
+} // namespace
+
+
+//-----------------------------------------------------------------------------
+//      頂点位置からバウンディングボックスと境界球を求めます.
+//-----------------------------------------------------------------------------
+MeshBounds ComputeMeshBounds(const DirectX::XMFLOAT3* pPositions, size_t count, size_t stride)
+{
+    if (pPositions == nullptr)
+    { return MeshBounds(); }
+
+    auto pData = reinterpret_cast<const uint8_t*>(pPositions);
+    return ComputeBounds(count, [&](size_t i)
+    { return LoadPosition(pData + i * stride); });
+}
+
+//-----------------------------------------------------------------------------
+//      インデックスで参照される頂点からバウンディングボリュームを求めます.
+//-----------------------------------------------------------------------------
+MeshBounds ComputeMeshBounds
+(
+    const DirectX::XMFLOAT3*    pPositions,
+    size_t                      stride,
+    const uint32_t*             pIndices,
+    size_t                      indexCount
+)
+{
+    if (pPositions == nullptr || pIndices == nullptr)
+    { return MeshBounds(); }
+
+    auto pData = reinterpret_cast<const uint8_t*>(pPositions);
+    return ComputeBounds(indexCount, [&](size_t i)
+    { return LoadPosition(pData + pIndices[i] * stride); });
+}
+
+//-----------------------------------------------------------------------------
+//      バウンディングボリュームを行列で変換します.
+//-----------------------------------------------------------------------------
+MeshBounds TransformMeshBounds(const MeshBounds& bounds, const DirectX::XMMATRIX& transform)
+{
+    // 中心は行列で変換し, 半径は行列の絶対値で変換する.
+    const auto absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    auto r0 = transform.r[0];
+    auto r1 = transform.r[1];
+    auto r2 = transform.r[2];
+
+    auto center = _mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(_mm_set1_ps(bounds.Center.x), r0), _mm_mul_ps(_mm_set1_ps(bounds.Center.y), r1)),
+        _mm_add_ps(_mm_mul_ps(_mm_set1_ps(bounds.Center.z), r2), transform.r[3]));
+    auto extent = _mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(_mm_set1_ps(bounds.Extent.x), _mm_and_ps(r0, absMask)),
+                   _mm_mul_ps(_mm_set1_ps(bounds.Extent.y), _mm_and_ps(r1, absMask))),
+        _mm_mul_ps(_mm_set1_ps(bounds.Extent.z), _mm_and_ps(r2, absMask)));
+
+    // 球は最大の拡大率で広げる.
+    alignas(16) float m[3][4];
+    _mm_store_ps(m[0], r0);
+    _mm_store_ps(m[1], r1);
+    _mm_store_ps(m[2], r2);
+
+    auto scale = 0.0f;
+    for(auto i=0; i<3; ++i)
+    { scale = std::max(scale, m[i][0] * m[i][0] + m[i][1] * m[i][1] + m[i][2] * m[i][2]); }
+
+    alignas(16) float c[4];
+    alignas(16) float e[4];
+    _mm_store_ps(c, center);
+    _mm_store_ps(e, extent);
+
+    MeshBounds result;
+    result.Center = DirectX::XMFLOAT3(c[0], c[1], c[2]);
+    result.Extent = DirectX::XMFLOAT3(e[0], e[1], e[2]);
+    result.Radius = bounds.Radius * std::sqrt(scale);
+
+    return result;
+}
@@ -0,0 +1,570 @@
+﻿//-----------------------------------------------------------------------------
+// File : MeshCache.cpp
+// Desc : Binary Mesh Cache Module.
+// Copyright(c) Pocol. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include "MeshCache.h"
+#include "MappedFile.h"
+#include "Logger.h"
+#include <algorithm>
+#include <cstring>
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+constexpr uint32_t CacheMagic       = 0x48434D52;   // 'RMCH'
+constexpr uint32_t CacheVersion     = 4;            // レイアウトを変更したら更新すること.
+constexpr uint32_t MapCount         = 4;            // ResMaterial が持つマップパスの数.
+constexpr wchar_t  CacheExtension[] = L".rmc";
+
+///////////////////////////////////////////////////////////////////////////////
+// CacheHeader structure
+///////////////////////////////////////////////////////////////////////////////
+struct CacheHeader
+{
+    uint32_t    Magic;          //!< マジックナンバーです.
+    uint32_t    Version;        //!< フォーマットバージョンです.
+    uint32_t    ImportFlags;    //!< ポストプロセスフラグです.
+    uint32_t    VertexStride;   //!< 1頂点あたりのサイズです.
+    uint64_t    SourceTime;     //!< ソースファイルの最終更新時刻です.
+    uint64_t    SourceSize;     //!< ソースファイルのサイズです.
+    uint32_t    PathLength;     //!< ソースファイルパスの文字数です.
+    uint32_t    MeshCount;      //!< メッシュ数です.
+    uint32_t    MaterialCount;  //!< マテリアル数です.
+    uint32_t    Options;        //!< ロード後に適用した処理のフラグです.
+    uint32_t    NodeCount;      //!< ノード数です.
+    uint32_t    Reserved;       //!< 予約領域です.
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// CacheMesh structure
+///////////////////////////////////////////////////////////////////////////////
+struct CacheMesh
+{
+    uint32_t    MaterialId;             //!< マテリアル番号です.
+    uint32_t    VertexCount;            //!< 頂点数です.
+    uint32_t    IndexCount;             //!< インデックス数です.
+    uint32_t    MeshletCount;           //!< メッシュレット数です.
+    uint32_t    MeshletVertexCount;     //!< メッシュレットの頂点番号の数です.
+    uint32_t    MeshletTriangleCount;   //!< メッシュレットの三角形数です.
+    uint32_t    LodCount;               //!< LOD1 以降の詳細度の数です.
+    uint32_t    LodIndexCount;          //!< LOD1 以降のインデックス数です.
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// CacheMaterial structure
+///////////////////////////////////////////////////////////////////////////////
+struct CacheMaterial
+{
+    DirectX::XMFLOAT3   Diffuse;                //!< 拡散反射成分です.
+    DirectX::XMFLOAT3   Specular;               //!< 鏡面反射成分です.
+    float               Alpha;                  //!< 透過成分です.
+    float               Shininess;              //!< 鏡面反射強度です.
+    uint32_t            MapLength[MapCount];    //!< 各マップパスの文字数です.
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// CacheNode structure
+///////////////////////////////////////////////////////////////////////////////
+struct CacheNode
+{
+    DirectX::XMFLOAT4X4 Transform;      //!< 親ノードからの相対変換行列です.
+    uint32_t            Parent;         //!< 親ノード番号です.
+    uint32_t            MeshCount;      //!< 参照するメッシュ数です.
+    uint32_t            NameLength;     //!< ノード名の文字数です.
+    uint32_t            Reserved;       //!< 予約領域です.
+};
+
+static_assert(sizeof(CacheHeader)   == 56, "CacheHeader layout mismatch");
+static_assert(sizeof(CacheMesh)     == 32, "CacheMesh layout mismatch");
+static_assert(sizeof(CacheMaterial) == 48, "CacheMaterial layout mismatch");
+static_assert(sizeof(CacheNode)     == 80, "CacheNode layout mismatch");
+static_assert(sizeof(ResMeshlet)    == 64, "ResMeshlet layout mismatch");
+static_assert(sizeof(ResLod)        == 16, "ResLod layout mismatch");
+
+///////////////////////////////////////////////////////////////////////////////
+// CacheReader class
+///////////////////////////////////////////////////////////////////////////////
+class CacheReader
+{
+public:
+    CacheReader(const uint8_t* pData, uint64_t size)
+    : m_pData   (pData)
+    , m_Size    (size)
+    , m_Offset  (0)
+    { /* DO_NOTHING */ }
+
+    // 指定サイズのブロックを取り出します. 範囲外の場合は nullptr を返却します.
+    const uint8_t* Take(uint64_t size)
+    {
+        if (size > m_Size - m_Offset)
+        { return nullptr; }
+
+        auto ptr = m_pData + m_Offset;
+        m_Offset += size;
+        return ptr;
+    }
+
+    template<typename T>
+    bool Read(T& value)
+    {
+        auto ptr = Take(sizeof(T));
+        if (ptr == nullptr)
+        { return false; }
+
+        memcpy(&value, ptr, sizeof(T));
+        return true;
+    }
+
+    bool ReadString(uint32_t length, std::wstring& value)
+    {
+        auto ptr = Take(uint64_t(length) * sizeof(wchar_t));
+        if (ptr == nullptr)
+        { return false; }
+
+        value.assign(reinterpret_cast<const wchar_t*>(ptr), length);
+        return true;
+    }
+
+    bool IsEnd() const
+    { return m_Offset == m_Size; }
+
+private:
+    const uint8_t*  m_pData;
+    uint64_t        m_Size;
+    uint64_t        m_Offset;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// CacheWriter class
+///////////////////////////////////////////////////////////////////////////////
+class CacheWriter
+{
+public:
+    void Write(const void* pData, size_t size)
+    {
+        if (size == 0)
+        { return; }
+
+        auto offset = m_Buffer.size();
+        m_Buffer.resize(offset + size);
+        memcpy(m_Buffer.data() + offset, pData, size);
+    }
+
+    template<typename T>
+    void Write(const T& value)
+    { Write(&value, sizeof(T)); }
+
+    void WriteString(const std::wstring& value)
+    { Write(value.data(), value.size() * sizeof(wchar_t)); }
+
+    void Reserve(size_t size)
+    { m_Buffer.reserve(size); }
+
+    const std::vector<uint8_t>& GetBuffer() const
+    { return m_Buffer; }
+
+private:
+    std::vector<uint8_t>    m_Buffer;
+};
+
+//-----------------------------------------------------------------------------
+//      マテリアルのマップパスを番号で取得します.
+//-----------------------------------------------------------------------------
+const std::wstring* GetMapPaths(const ResMaterial& material, uint32_t index)
+{
+    switch(index)
+    {
+    case 0: return &material.DiffuseMap;
+    case 1: return &material.SpecularMap;
+    case 2: return &material.ShininessMap;
+    case 3: return &material.NormalMap;
+    default: break;
+    }
+
+    return nullptr;
+}
+
+//-----------------------------------------------------------------------------
+//      マテリアルのマップパスを取得します(書き込み用).
+//-----------------------------------------------------------------------------
+std::wstring* GetMapPaths(ResMaterial& material, uint32_t index)
+{ return const_cast<std::wstring*>(GetMapPaths(static_cast<const ResMaterial&>(material), index)); }
+
+//-----------------------------------------------------------------------------
+//      データを全て書き込みます.
+//-----------------------------------------------------------------------------
+bool WriteAll(HANDLE hFile, const uint8_t* pData, size_t size)
+{
+    // WriteFile() は1回で DWORD に収まるサイズしか書き込めないので分割する.
+    constexpr size_t MaxChunkSize = 1u << 30;
+
+    while (size > 0)
+    {
+        auto  chunk   = DWORD(std::min(size, MaxChunkSize));
+        DWORD written = 0;
+        if (!WriteFile(hFile, pData, chunk, &written, nullptr) || written != chunk)
+        { return false; }
+
+        pData += chunk;
+        size  -= chunk;
+    }
+
+    return true;
+}
+
+} // namespace
+
+
+//-----------------------------------------------------------------------------
+//      キャッシュキーを取得します.
+//-----------------------------------------------------------------------------
+bool GetMeshCacheKey
+(
+    const wchar_t*  filename,
+    uint32_t        importFlags,
+    uint32_t        options,
+    MeshCacheKey&   key
+)
+{
+    if (filename == nullptr)
+    { return false; }
+
+    // フルパスに変換.
+    wchar_t fullPath[MAX_PATH] = {};
+    auto length = GetFullPathNameW(filename, MAX_PATH, fullPath, nullptr);
+    if (length == 0 || length >= MAX_PATH)
+    { return false; }
+
+    // 最終更新時刻とサイズを取得.
+    WIN32_FILE_ATTRIBUTE_DATA data = {};
+    if (!GetFileAttributesExW(fullPath, GetFileExInfoStandard, &data))
+    { return false; }
+
+    key.SourcePath  = fullPath;
+    key.SourceTime  = (uint64_t(data.ftLastWriteTime.dwHighDateTime) << 32) | data.ftLastWriteTime.dwLowDateTime;
+    key.SourceSize  = (uint64_t(data.nFileSizeHigh) << 32) | data.nFileSizeLow;
+    key.ImportFlags = importFlags;
+    key.Options     = options;
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      キャッシュファイルパスを取得します.
+//-----------------------------------------------------------------------------
+std::wstring GetMeshCachePath(const wchar_t* filename)
+{
+    if (filename == nullptr)
+    { return std::wstring(); }
+
+    return std::wstring(filename) + CacheExtension;
+}
+
+//-----------------------------------------------------------------------------
+//      キャッシュファイルからメッシュをロードします.
+//-----------------------------------------------------------------------------
+bool LoadMeshCache
+(
+    const wchar_t*              cachePath,
+    const MeshCacheKey&         key,
+    std::vector<ResMesh>&       meshes,
+    std::vector<ResMaterial>&   materials,
+    std::vector<ResNode>&       nodes
+)
+{
+    if (cachePath == nullptr)
+    { return false; }
+
+    MappedFile file;
+    if (!file.Open(cachePath))
+    { return false; }
+
+    CacheReader reader(file.GetData(), file.GetSize());
+
+    // ヘッダをチェック.
+    CacheHeader header = {};
+    if (!reader.Read(header))
+    { return false; }
+
+    if (header.Magic        != CacheMagic
+     || header.Version      != CacheVersion
+     || header.VertexStride != sizeof(MeshVertex)
+     || header.ImportFlags  != key.ImportFlags
+     || header.Options      != key.Options
+     || header.SourceTime   != key.SourceTime
+     || header.SourceSize   != key.SourceSize)
+    { return false; }
+
+    std::wstring sourcePath;
+    if (!reader.ReadString(header.PathLength, sourcePath) || sourcePath != key.SourcePath)
+    { return false; }
+
+    std::vector<ResMesh>     dstMeshes;
+    std::vector<ResMaterial> dstMaterials;
+    std::vector<ResNode>     dstNodes;
+
+    // メッシュデータを読み込み.
+    dstMeshes.resize(header.MeshCount);
+    for(auto& mesh : dstMeshes)
+    {
+        CacheMesh info = {};
+        if (!reader.Read(info))
+        { return false; }
+
+        auto pVertices  = reader.Take(uint64_t(info.VertexCount)          * sizeof(MeshVertex));
+        auto pIndices   = reader.Take(uint64_t(info.IndexCount)           * sizeof(uint32_t));
+        auto pMeshlets  = reader.Take(uint64_t(info.MeshletCount)         * sizeof(ResMeshlet));
+        auto pMeshletVB = reader.Take(uint64_t(info.MeshletVertexCount)   * sizeof(uint32_t));
+        auto pMeshletIB = reader.Take(uint64_t(info.MeshletTriangleCount) * sizeof(uint32_t));
+        auto pLods      = reader.Take(uint64_t(info.LodCount)             * sizeof(ResLod));
+        auto pLodIB     = reader.Take(uint64_t(info.LodIndexCount)        * sizeof(uint32_t));
+        if (pVertices  == nullptr || pIndices   == nullptr
+         || pMeshlets  == nullptr || pMeshletVB == nullptr || pMeshletIB == nullptr
+         || pLods      == nullptr || pLodIB     == nullptr)
+        { return false; }
+
+        // 頂点毎の解析は行わず, まとめてコピーします.
+        mesh.MaterialId = info.MaterialId;
+        mesh.Vertices        .resize(info.VertexCount);
+        mesh.Indices         .resize(info.IndexCount);
+        mesh.Meshlets        .resize(info.MeshletCount);
+        mesh.MeshletVertices .resize(info.MeshletVertexCount);
+        mesh.MeshletTriangles.resize(info.MeshletTriangleCount);
+        mesh.Lods            .resize(info.LodCount);
+        mesh.LodIndices      .resize(info.LodIndexCount);
+        memcpy(mesh.Vertices        .data(), pVertices,  size_t(info.VertexCount)          * sizeof(MeshVertex));
+        memcpy(mesh.Indices         .data(), pIndices,   size_t(info.IndexCount)           * sizeof(uint32_t));
+        memcpy(mesh.Meshlets        .data(), pMeshlets,  size_t(info.MeshletCount)         * sizeof(ResMeshlet));
+        memcpy(mesh.MeshletVertices .data(), pMeshletVB, size_t(info.MeshletVertexCount)   * sizeof(uint32_t));
+        memcpy(mesh.MeshletTriangles.data(), pMeshletIB, size_t(info.MeshletTriangleCount) * sizeof(uint32_t));
+        memcpy(mesh.Lods            .data(), pLods,      size_t(info.LodCount)             * sizeof(ResLod));
+        memcpy(mesh.LodIndices      .data(), pLodIB,     size_t(info.LodIndexCount)        * sizeof(uint32_t));
+
+        // メッシュレットと詳細度の範囲だけは確認しておく.
+        for(auto& meshlet : mesh.Meshlets)
+        {
+            if (uint64_t(meshlet.VertexOffset)   + meshlet.VertexCount   > info.MeshletVertexCount
+             || uint64_t(meshlet.TriangleOffset) + meshlet.TriangleCount > info.MeshletTriangleCount)
+            { return false; }
+        }
+
+        for(auto& lod : mesh.Lods)
+        {
+            if (uint64_t(lod.IndexOffset) + lod.IndexCount > info.LodIndexCount)
+            { return false; }
+        }
+    }
+
+    // マテリアルデータを読み込み.
+    dstMaterials.resize(header.MaterialCount);
+    for(auto& material : dstMaterials)
+    {
+        CacheMaterial info = {};
+        if (!reader.Read(info))
+        { return false; }
+
+        material.Diffuse   = info.Diffuse;
+        material.Specular  = info.Specular;
+        material.Alpha     = info.Alpha;
+        material.Shininess = info.Shininess;
+
+        for(auto i=0u; i<MapCount; ++i)
+        {
+            if (!reader.ReadString(info.MapLength[i], *GetMapPaths(material, i)))
+            { return false; }
+        }
+    }
+
+    // ノードデータを読み込み.
+    dstNodes.resize(header.NodeCount);
+    for(auto i=0u; i<header.NodeCount; ++i)
+    {
+        CacheNode info = {};
+        if (!reader.Read(info))
+        { return false; }
+
+        // 親ノードは必ず前に並んでいる.
+        if (info.Parent != UINT32_MAX && info.Parent >= i)
+        { return false; }
+
+        auto& node = dstNodes[i];
+        node.Transform = info.Transform;
+        node.Parent    = info.Parent;
+
+        auto pMeshes = reader.Take(uint64_t(info.MeshCount) * sizeof(uint32_t));
+        if (pMeshes == nullptr)
+        { return false; }
+
+        node.Meshes.resize(info.MeshCount);
+        memcpy(node.Meshes.data(), pMeshes, size_t(info.MeshCount) * sizeof(uint32_t));
+
+        if (!reader.ReadString(info.NameLength, node.Name))
+        { return false; }
+    }
+
+    // 末尾に余分なデータがある場合は壊れているとみなす.
+    if (!reader.IsEnd())
+    { return false; }
+
+    meshes    = std::move(dstMeshes);
+    materials = std::move(dstMaterials);
+    nodes     = std::move(dstNodes);
+
+    // 正常終了.
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      メッシュをキャッシュファイルに保存します.
+//-----------------------------------------------------------------------------
+bool SaveMeshCache
+(
+    const wchar_t*                  cachePath,
+    const MeshCacheKey&             key,
+    const std::vector<ResMesh>&     meshes,
+    const std::vector<ResMaterial>& materials,
+    const std::vector<ResNode>&     nodes
+)
+{
+    if (cachePath == nullptr)
+    { return false; }
+
+    CacheWriter writer;
+
+    // 必要サイズを概算して予約.
+    {
+        size_t size = sizeof(CacheHeader) + key.SourcePath.size() * sizeof(wchar_t);
+        for(auto& mesh : meshes)
+        {
+            size += sizeof(CacheMesh);
+            size += mesh.Vertices        .size() * sizeof(MeshVertex);
+            size += mesh.Indices         .size() * sizeof(uint32_t);
+            size += mesh.Meshlets        .size() * sizeof(ResMeshlet);
+            size += mesh.MeshletVertices .size() * sizeof(uint32_t);
+            size += mesh.MeshletTriangles.size() * sizeof(uint32_t);
+            size += mesh.Lods            .size() * sizeof(ResLod);
+            size += mesh.LodIndices      .size() * sizeof(uint32_t);
+        }
+        size += materials.size() * sizeof(CacheMaterial);
+        for(auto& node : nodes)
+        {
+            size += sizeof(CacheNode);
+            size += node.Meshes.size() * sizeof(uint32_t);
+            size += node.Name  .size() * sizeof(wchar_t);
+        }
+        writer.Reserve(size);
+    }
+
+    // ヘッダを書き込み.
+    CacheHeader header = {};
+    header.Magic         = CacheMagic;
+    header.Version       = CacheVersion;
+    header.ImportFlags   = key.ImportFlags;
+    header.VertexStride  = sizeof(MeshVertex);
+    header.SourceTime    = key.SourceTime;
+    header.SourceSize    = key.SourceSize;
+    header.PathLength    = uint32_t(key.SourcePath.size());
+    header.MeshCount     = uint32_t(meshes.size());
+    header.MaterialCount = uint32_t(materials.size());
+    header.Options       = key.Options;
+    header.NodeCount     = uint32_t(nodes.size());
+    writer.Write(header);
+    writer.WriteString(key.SourcePath);
+
+    // メッシュデータを書き込み.
+    for(auto& mesh : meshes)
+    {
+        CacheMesh info = {};
+        info.MaterialId           = mesh.MaterialId;
+        info.VertexCount          = uint32_t(mesh.Vertices.size());
+        info.IndexCount           = uint32_t(mesh.Indices.size());
+        info.MeshletCount         = uint32_t(mesh.Meshlets.size());
+        info.MeshletVertexCount   = uint32_t(mesh.MeshletVertices.size());
+        info.MeshletTriangleCount = uint32_t(mesh.MeshletTriangles.size());
+        info.LodCount             = uint32_t(mesh.Lods.size());
+        info.LodIndexCount        = uint32_t(mesh.LodIndices.size());
+        writer.Write(info);
+        writer.Write(mesh.Vertices        .data(), mesh.Vertices        .size() * sizeof(MeshVertex));
+        writer.Write(mesh.Indices         .data(), mesh.Indices         .size() * sizeof(uint32_t));
+        writer.Write(mesh.Meshlets        .data(), mesh.Meshlets        .size() * sizeof(ResMeshlet));
+        writer.Write(mesh.MeshletVertices .data(), mesh.MeshletVertices .size() * sizeof(uint32_t));
+        writer.Write(mesh.MeshletTriangles.data(), mesh.MeshletTriangles.size() * sizeof(uint32_t));
+        writer.Write(mesh.Lods            .data(), mesh.Lods            .size() * sizeof(ResLod));
+        writer.Write(mesh.LodIndices      .data(), mesh.LodIndices      .size() * sizeof(uint32_t));
+    }
+
+    // マテリアルデータを書き込み.
+    for(auto& material : materials)
+    {
+        CacheMaterial info = {};
+        info.Diffuse   = material.Diffuse;
+        info.Specular  = material.Specular;
+        info.Alpha     = material.Alpha;
+        info.Shininess = material.Shininess;
+        for(auto i=0u; i<MapCount; ++i)
+        { info.MapLength[i] = uint32_t(GetMapPaths(material, i)->size()); }
+
+        writer.Write(info);
+        for(auto i=0u; i<MapCount; ++i)
+        { writer.WriteString(*GetMapPaths(material, i)); }
+    }
+
+    // ノードデータを書き込み.
+    for(auto& node : nodes)
+    {
+        CacheNode info = {};
+        info.Transform  = node.Transform;
+        info.Parent     = node.Parent;
+        info.MeshCount  = uint32_t(node.Meshes.size());
+        info.NameLength = uint32_t(node.Name.size());
+        writer.Write(info);
+        writer.Write(node.Meshes.data(), node.Meshes.size() * sizeof(uint32_t));
+        writer.WriteString(node.Name);
+    }
+
+    // 書き込み途中のファイルを読まれないように一時ファイルに書いてから置き換えます.
+    std::wstring tempPath = std::wstring(cachePath) + L".tmp";
+
+    auto hFile = CreateFileW(
+        tempPath.c_str(),
+        GENERIC_WRITE,
+        0,
+        nullptr,
+        CREATE_ALWAYS,
+        FILE_ATTRIBUTE_NORMAL,
+        nullptr);
+    if (hFile == INVALID_HANDLE_VALUE)
+    {
+        ELOG( "Error : CreateFileW() Failed. path = %ls", tempPath.c_str() );
+        return false;
+    }
+
+    auto& buffer = writer.GetBuffer();
+    auto  result = WriteAll(hFile, buffer.data(), buffer.size());
+    CloseHandle(hFile);
+
+    if (!result)
+    {
+        ELOG( "Error : WriteFile() Failed. path = %ls", tempPath.c_str() );
+        DeleteFileW(tempPath.c_str());
+        return false;
+    }
+
+    if (!MoveFileExW(tempPath.c_str(), cachePath, MOVEFILE_REPLACE_EXISTING))
+    {
+        ELOG( "Error : MoveFileExW() Failed. path = %ls", cachePath );
+        DeleteFileW(tempPath.c_str());
+        return false;
+    }
+
+    // 正常終了.
+    return true;
+}
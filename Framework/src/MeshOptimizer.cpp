@@ -0,0 +1,469 @@
+﻿//-----------------------------------------------------------------------------
+// File : MeshOptimizer.cpp
+// Desc : Mesh Optimization Module.
+// Copyright(c) Pocol. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <cmath>
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+constexpr uint32_t InvalidIndex = UINT32_MAX;
+
+///////////////////////////////////////////////////////////////////////////////
+// CacheSimulator class
+///////////////////////////////////////////////////////////////////////////////
+class CacheSimulator
+{
+public:
+    CacheSimulator(size_t vertexCount, uint32_t cacheSize)
+    : m_Stamp       (vertexCount, 0)
+    , m_Time        (cacheSize + 1)
+    , m_CacheSize   (cacheSize)
+    { /* DO_NOTHING */ }
+
+    //! 頂点を参照し, キャッシュミスした場合は true を返します.
+    bool Access(uint32_t index)
+    {
+        if (m_Time - m_Stamp[index] <= m_CacheSize)
+        { return false; }
+
+        m_Stamp[index] = m_Time++;
+        return true;
+    }
+
+    //! キャッシュを空にします.
+    void Reset()
+    { m_Time += m_CacheSize + 1; }
+
+private:
+    std::vector<uint32_t>   m_Stamp;
+    uint32_t                m_Time;
+    uint32_t                m_CacheSize;
+};
+
+//-----------------------------------------------------------------------------
+//      参照されている最大頂点番号 + 1 を求めます.
+//-----------------------------------------------------------------------------
+size_t GetVertexCount(const std::vector<uint32_t>& indices)
+{
+    uint32_t result = 0;
+    for(auto index : indices)
+    { result = std::max(result, index + 1); }
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+//      区間 [begin, end) の三角形を描画したときのキャッシュミス数を求めます.
+//-----------------------------------------------------------------------------
+uint32_t CountMisses
+(
+    const std::vector<uint32_t>&    indices,
+    size_t                          vertexCount,
+    uint32_t                        cacheSize,
+    uint32_t                        begin,
+    uint32_t                        end
+)
+{
+    CacheSimulator cache(vertexCount, cacheSize);
+    uint32_t misses = 0;
+    for(auto i=begin * 3; i<end * 3; ++i)
+    { misses += cache.Access(indices[i]) ? 1 : 0; }
+    return misses;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Adjacency structure
+///////////////////////////////////////////////////////////////////////////////
+struct Adjacency
+{
+    std::vector<uint32_t>   Offsets;    //!< 頂点ごとの三角形リストの開始位置です.
+    std::vector<uint32_t>   Triangles;  //!< 頂点を共有する三角形番号です.
+    std::vector<uint32_t>   Live;       //!< 未出力の三角形数です.
+
+    void Build(const std::vector<uint32_t>& indices, size_t vertexCount)
+    {
+        Offsets.assign(vertexCount + 1, 0);
+        Live   .assign(vertexCount, 0);
+
+        for(auto index : indices)
+        { Live[index]++; }
+
+        for(size_t i=0; i<vertexCount; ++i)
+        { Offsets[i + 1] = Offsets[i] + Live[i]; }
+
+        std::vector<uint32_t> cursor(Offsets.begin(), Offsets.end() - 1);
+        Triangles.resize(indices.size());
+        for(size_t i=0; i<indices.size(); ++i)
+        { Triangles[cursor[indices[i]]++] = uint32_t(i / 3); }
+    }
+};
+
+} // namespace
+
+
+//-----------------------------------------------------------------------------
+//      ACMR を求めます.
+//-----------------------------------------------------------------------------
+float ComputeACMR(const std::vector<uint32_t>& indices, uint32_t cacheSize)
+{
+    auto triangleCount = uint32_t(indices.size() / 3);
+    if (triangleCount == 0)
+    { return 0.0f; }
+
+    auto misses = CountMisses(indices, GetVertexCount(indices), cacheSize, 0, triangleCount);
+    return float(misses) / float(triangleCount);
+}
+
+//-----------------------------------------------------------------------------
+//      ATVR を求めます.
+//-----------------------------------------------------------------------------
+float ComputeATVR(const std::vector<uint32_t>& indices, uint32_t cacheSize)
+{
+    auto vertexCount = GetVertexCount(indices);
+    if (vertexCount == 0)
+    { return 0.0f; }
+
+    // 実際に参照されている頂点だけを数える.
+    std::vector<bool> used(vertexCount, false);
+    uint32_t uniqueCount = 0;
+    for(auto index : indices)
+    {
+        if (!used[index])
+        {
+            used[index] = true;
+            uniqueCount++;
+        }
+    }
+
+    auto misses = CountMisses(indices, vertexCount, cacheSize, 0, uint32_t(indices.size() / 3));
+    return float(misses) / float(uniqueCount);
+}
+
+//-----------------------------------------------------------------------------
+//      Tipsify 法でインデックスを並べ替えます.
+//      (Sander et al., "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw", 2007)
+//-----------------------------------------------------------------------------
+void OptimizeVertexCache
+(
+    std::vector<uint32_t>&  indices,
+    size_t                  vertexCount,
+    uint32_t                cacheSize,
+    std::vector<uint32_t>*  pClusters
+)
+{
+    if (pClusters != nullptr)
+    { pClusters->clear(); }
+
+    auto triangleCount = indices.size() / 3;
+    if (triangleCount == 0 || vertexCount == 0)
+    { return; }
+
+    Adjacency adj;
+    adj.Build(indices, vertexCount);
+
+    std::vector<uint32_t>   stamp   (vertexCount, 0);
+    std::vector<bool>       emitted (triangleCount, false);
+    std::vector<uint32_t>   deadEnd;
+    std::vector<uint32_t>   candidates;
+    std::vector<uint32_t>   result;
+    result  .reserve(indices.size());
+    deadEnd .reserve(indices.size());
+
+    auto time   = cacheSize + 1;
+    auto cursor = size_t(0);
+
+    // 行き止まりになった場合に次の起点を探します.
+    auto skipDeadEnd = [&]() -> uint32_t
+    {
+        while(!deadEnd.empty())
+        {
+            auto v = deadEnd.back();
+            deadEnd.pop_back();
+            if (adj.Live[v] > 0)
+            { return v; }
+        }
+
+        while(cursor < vertexCount)
+        {
+            if (adj.Live[cursor] > 0)
+            { return uint32_t(cursor); }
+            cursor++;
+        }
+
+        return InvalidIndex;
+    };
+
+    auto fan = skipDeadEnd();
+    if (pClusters != nullptr && fan != InvalidIndex)
+    { pClusters->push_back(0); }
+
+    while(fan != InvalidIndex)
+    {
+        candidates.clear();
+
+        // 扇状に隣接する三角形を出力.
+        for(auto i=adj.Offsets[fan]; i<adj.Offsets[fan + 1]; ++i)
+        {
+            auto t = adj.Triangles[i];
+            if (emitted[t])
+            { continue; }
+
+            for(auto j=0; j<3; ++j)
+            {
+                auto v = indices[t * 3 + j];
+                result    .push_back(v);
+                deadEnd   .push_back(v);
+                candidates.push_back(v);
+                adj.Live[v]--;
+
+                if (time - stamp[v] > cacheSize)
+                { stamp[v] = time++; }
+            }
+
+            emitted[t] = true;
+        }
+
+        // キャッシュに残り続ける頂点を優先して次の扇の中心を選ぶ.
+        auto next     = InvalidIndex;
+        auto priority = -1;
+        for(auto v : candidates)
+        {
+            if (adj.Live[v] == 0)
+            { continue; }
+
+            auto p = 0;
+            if (time - stamp[v] + 2 * adj.Live[v] <= cacheSize)
+            { p = int(time - stamp[v]); }
+
+            if (p > priority)
+            {
+                priority = p;
+                next     = v;
+            }
+        }
+
+        if (next == InvalidIndex)
+        {
+            next = skipDeadEnd();
+
+            // 行き止まりはクラスタの境界とします.
+            if (pClusters != nullptr && next != InvalidIndex)
+            { pClusters->push_back(uint32_t(result.size() / 3)); }
+        }
+
+        fan = next;
+    }
+
+    indices.swap(result);
+}
+
+//-----------------------------------------------------------------------------
+//      外側を向いたクラスタから描画されるように並べ替えます.
+//-----------------------------------------------------------------------------
+void OptimizeOverdraw
+(
+    ResMesh&                        mesh,
+    const std::vector<uint32_t>&    clusters,
+    uint32_t                        cacheSize,
+    float                           threshold
+)
+{
+    auto& indices       = mesh.Indices;
+    auto  triangleCount = uint32_t(indices.size() / 3);
+    auto  vertexCount   = mesh.Vertices.size();
+    if (triangleCount == 0 || clusters.empty())
+    { return; }
+
+    // 全体の ACMR に対して悪化しすぎない位置でクラスタを細分化します.
+    auto limit = ComputeACMR(indices, cacheSize) * threshold;
+
+    CacheSimulator        cache(vertexCount, cacheSize);
+    std::vector<uint32_t> bounds;
+    for(size_t c=0; c<clusters.size(); ++c)
+    {
+        auto begin = clusters[c];
+        auto end   = (c + 1 < clusters.size()) ? clusters[c + 1] : triangleCount;
+
+        cache.Reset();
+        uint32_t misses = 0;
+        auto     start  = begin;
+        bounds.push_back(begin);
+
+        for(auto t=begin; t<end; ++t)
+        {
+            for(auto j=0u; j<3; ++j)
+            { misses += cache.Access(indices[t * 3 + j]) ? 1 : 0; }
+
+            auto count = t - start + 1;
+            if (t + 1 < end && float(misses) / float(count) <= limit)
+            {
+                // 新しいクラスタはキャッシュが空の状態から始まるものとして数え直す.
+                bounds.push_back(t + 1);
+                cache.Reset();
+                misses = 0;
+                start  = t + 1;
+            }
+        }
+    }
+    bounds.push_back(triangleCount);
+
+    // メッシュ全体の重心.
+    auto meshX = 0.0f, meshY = 0.0f, meshZ = 0.0f, meshArea = 0.0f;
+
+    struct ClusterInfo
+    {
+        uint32_t    Begin;
+        uint32_t    End;
+        float       Center[3];
+        float       Normal[3];
+        float       Sort;
+    };
+
+    std::vector<ClusterInfo> infos(bounds.size() - 1);
+    for(size_t c=0; c<infos.size(); ++c)
+    {
+        auto& info = infos[c];
+        info.Begin = bounds[c];
+        info.End   = bounds[c + 1];
+
+        auto cx = 0.0f, cy = 0.0f, cz = 0.0f, area = 0.0f;
+        auto nx = 0.0f, ny = 0.0f, nz = 0.0f;
+        for(auto t=info.Begin; t<info.End; ++t)
+        {
+            auto& p0 = mesh.Vertices[indices[t * 3 + 0]].Position;
+            auto& p1 = mesh.Vertices[indices[t * 3 + 1]].Position;
+            auto& p2 = mesh.Vertices[indices[t * 3 + 2]].Position;
+
+            auto e1x = p1.x - p0.x, e1y = p1.y - p0.y, e1z = p1.z - p0.z;
+            auto e2x = p2.x - p0.x, e2y = p2.y - p0.y, e2z = p2.z - p0.z;
+            auto fx  = e1y * e2z - e1z * e2y;
+            auto fy  = e1z * e2x - e1x * e2z;
+            auto fz  = e1x * e2y - e1y * e2x;
+            auto a   = sqrtf(fx * fx + fy * fy + fz * fz);
+
+            // 面積で重み付けした重心と法線.
+            cx += (p0.x + p1.x + p2.x) * a / 3.0f;
+            cy += (p0.y + p1.y + p2.y) * a / 3.0f;
+            cz += (p0.z + p1.z + p2.z) * a / 3.0f;
+            nx += fx;
+            ny += fy;
+            nz += fz;
+            area += a;
+        }
+
+        meshX += cx;
+        meshY += cy;
+        meshZ += cz;
+        meshArea += area;
+
+        auto inv = (area > 0.0f) ? 1.0f / area : 0.0f;
+        info.Center[0] = cx * inv;
+        info.Center[1] = cy * inv;
+        info.Center[2] = cz * inv;
+
+        auto len = sqrtf(nx * nx + ny * ny + nz * nz);
+        auto invLen = (len > 0.0f) ? 1.0f / len : 0.0f;
+        info.Normal[0] = nx * invLen;
+        info.Normal[1] = ny * invLen;
+        info.Normal[2] = nz * invLen;
+    }
+
+    if (meshArea > 0.0f)
+    {
+        meshX /= meshArea;
+        meshY /= meshArea;
+        meshZ /= meshArea;
+    }
+
+    // 重心から見て外側を向いているクラスタほど手前を覆いやすいので先に描画します.
+    for(auto& info : infos)
+    {
+        info.Sort = (info.Center[0] - meshX) * info.Normal[0]
+                  + (info.Center[1] - meshY) * info.Normal[1]
+                  + (info.Center[2] - meshZ) * info.Normal[2];
+    }
+
+    std::stable_sort(infos.begin(), infos.end(),
+        [](const ClusterInfo& lhs, const ClusterInfo& rhs)
+        { return lhs.Sort > rhs.Sort; });
+
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+    for(auto& info : infos)
+    { result.insert(result.end(), indices.begin() + info.Begin * 3, indices.begin() + info.End * 3); }
+
+    indices.swap(result);
+}
+
+//-----------------------------------------------------------------------------
+//      インデックスの参照順に頂点を並べ替えます.
+//-----------------------------------------------------------------------------
+void OptimizeVertexFetch(ResMesh& mesh)
+{
+    std::vector<uint32_t>   remap(mesh.Vertices.size(), InvalidIndex);
+    std::vector<MeshVertex> vertices;
+    vertices.reserve(mesh.Vertices.size());
+
+    for(auto& index : mesh.Indices)
+    {
+        if (remap[index] == InvalidIndex)
+        {
+            remap[index] = uint32_t(vertices.size());
+            vertices.push_back(mesh.Vertices[index]);
+        }
+
+        index = remap[index];
+    }
+
+    mesh.Vertices.swap(vertices);
+}
+
+//-----------------------------------------------------------------------------
+//      メッシュを最適化します.
+//-----------------------------------------------------------------------------
+bool OptimizeMesh
+(
+    ResMesh&                    mesh,
+    const MeshOptimizeDesc&     desc,
+    MeshOptimizeStats*          pStats
+)
+{
+    if (mesh.Indices.size() % 3 != 0 || desc.CacheSize == 0)
+    { return false; }
+
+    for(auto index : mesh.Indices)
+    {
+        if (index >= mesh.Vertices.size())
+        { return false; }
+    }
+
+    if (pStats != nullptr)
+    {
+        pStats->ACMRBefore = ComputeACMR(mesh.Indices, desc.CacheSize);
+        pStats->ATVRBefore = ComputeATVR(mesh.Indices, desc.CacheSize);
+    }
+
+    std::vector<uint32_t> clusters;
+    OptimizeVertexCache(mesh.Indices, mesh.Vertices.size(), desc.CacheSize, &clusters);
+    OptimizeOverdraw(mesh, clusters, desc.CacheSize, desc.OverdrawThreshold);
+    OptimizeVertexFetch(mesh);
+
+    if (pStats != nullptr)
+    {
+        pStats->ACMRAfter = ComputeACMR(mesh.Indices, desc.CacheSize);
+        pStats->ATVRAfter = ComputeATVR(mesh.Indices, desc.CacheSize);
+    }
+
+    // 正常終了.
+    return true;
+}
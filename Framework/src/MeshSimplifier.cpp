@@ -0,0 +1,607 @@
+﻿//-----------------------------------------------------------------------------
+// File : MeshSimplifier.cpp
+// Desc : Mesh Simplification Module.
+// Copyright(c) Pocol. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include "MeshSimplifier.h"
+#include "MeshBounds.h"
+#include "MeshOptimizer.h"
+#include "ParallelUtil.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+constexpr uint32_t kInvalidIndex  = UINT32_MAX;
+constexpr float    kFlipThreshold = 0.25f;      // 縮約前後の法線の cos がこれ以下になる三角形があれば縮約しない(約75度).
+
+///////////////////////////////////////////////////////////////////////////////
+// Quadric structure
+///////////////////////////////////////////////////////////////////////////////
+struct Quadric
+{
+    double  A00, A01, A02, A11, A12, A22;   //!< 対称行列 A です.
+    double  B0, B1, B2;                     //!< ベクトル b です.
+    double  C;                              //!< 定数項です.
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Collapse structure
+///////////////////////////////////////////////////////////////////////////////
+struct Collapse
+{
+    uint32_t    From;   //!< 縮約で消える頂点です.
+    uint32_t    To;     //!< 寄せる先の頂点です.
+    float       Cost;   //!< 誤差の2乗です.
+};
+
+//-----------------------------------------------------------------------------
+//      平面 n・p + d = 0 までの距離の2乗を加えます.
+//-----------------------------------------------------------------------------
+void AddPlane(Quadric& q, double nx, double ny, double nz, double d)
+{
+    q.A00 += nx * nx; q.A01 += nx * ny; q.A02 += nx * nz;
+    q.A11 += ny * ny; q.A12 += ny * nz;
+    q.A22 += nz * nz;
+    q.B0  += nx * d;  q.B1  += ny * d;  q.B2  += nz * d;
+    q.C   += d  * d;
+}
+
+//-----------------------------------------------------------------------------
+//      二次誤差を加算します.
+//-----------------------------------------------------------------------------
+void AddQuadric(Quadric& dst, const Quadric& src)
+{
+    dst.A00 += src.A00; dst.A01 += src.A01; dst.A02 += src.A02;
+    dst.A11 += src.A11; dst.A12 += src.A12;
+    dst.A22 += src.A22;
+    dst.B0  += src.B0;  dst.B1  += src.B1;  dst.B2  += src.B2;
+    dst.C   += src.C;
+}
+
+//-----------------------------------------------------------------------------
+//      位置 p での誤差 p^T A p + 2 b・p + c を求めます.
+//-----------------------------------------------------------------------------
+double EvaluateQuadric(const Quadric& q, const DirectX::XMFLOAT3& p)
+{
+    double x = p.x, y = p.y, z = p.z;
+    auto result = q.A00 * x * x + 2.0 * q.A01 * x * y + 2.0 * q.A02 * x * z
+                + q.A11 * y * y + 2.0 * q.A12 * y * z
+                + q.A22 * z * z
+                + 2.0 * (q.B0 * x + q.B1 * y + q.B2 * z)
+                + q.C;
+    return std::max(result, 0.0);
+}
+
+//-----------------------------------------------------------------------------
+//      三角形の法線(正規化しない)を求めます.
+//-----------------------------------------------------------------------------
+void GetNormal
+(
+    const DirectX::XMFLOAT3& p0,
+    const DirectX::XMFLOAT3& p1,
+    const DirectX::XMFLOAT3& p2,
+    float&                   nx,
+    float&                   ny,
+    float&                   nz
+)
+{
+    auto ax = p1.x - p0.x, ay = p1.y - p0.y, az = p1.z - p0.z;
+    auto bx = p2.x - p0.x, by = p2.y - p0.y, bz = p2.z - p0.z;
+    nx = ay * bz - az * by;
+    ny = az * bx - ax * bz;
+    nz = ax * by - ay * bx;
+}
+
+//-----------------------------------------------------------------------------
+//      FNV-1a でハッシュ値を求めます.
+//-----------------------------------------------------------------------------
+uint32_t HashBytes(const void* pData, size_t size)
+{
+    auto ptr  = static_cast<const uint8_t*>(pData);
+    auto hash = 2166136261u;
+    for(size_t i=0; i<size; ++i)
+    {
+        hash ^= ptr[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+//-----------------------------------------------------------------------------
+//      同じ内容の頂点を先頭の頂点にまとめる変換テーブルを作成します.
+//-----------------------------------------------------------------------------
+template<typename Hash, typename Equal>
+void BuildRemap
+(
+    const std::vector<uint8_t>& used,
+    Hash                        hash,
+    Equal                       equal,
+    std::vector<uint32_t>&      remap
+)
+{
+    auto count = used.size();
+
+    size_t tableSize = 1;
+    while(tableSize < count * 2)
+    { tableSize <<= 1; }
+
+    std::vector<uint32_t> table(tableSize, kInvalidIndex);
+    auto mask = tableSize - 1;
+
+    remap.assign(count, kInvalidIndex);
+    for(size_t i=0; i<count; ++i)
+    {
+        if (!used[i])
+        { continue; }
+
+        // 開番地法で同じ内容の頂点を探す.
+        auto slot = hash(uint32_t(i)) & mask;
+        while(table[slot] != kInvalidIndex && !equal(table[slot], uint32_t(i)))
+        { slot = (slot + 1) & mask; }
+
+        if (table[slot] == kInvalidIndex)
+        { table[slot] = uint32_t(i); }
+
+        remap[i] = table[slot];
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      動かせない頂点(継ぎ目・境界・非多様体)を求めます.
+//-----------------------------------------------------------------------------
+void FindLockedVertices
+(
+    const std::vector<uint32_t>&    indices,
+    const std::vector<uint32_t>&    position,
+    const std::vector<uint32_t>&    remap,
+    std::vector<uint8_t>&           locked
+)
+{
+    auto count = position.size();
+
+    // 同じ位置に属性の異なる頂点が複数あれば継ぎ目.
+    std::vector<uint32_t> wedges(count, 0);
+    for(size_t i=0; i<count; ++i)
+    {
+        if (remap[i] == i)
+        { wedges[position[i]]++; }
+    }
+
+    std::vector<uint8_t> lockedPosition(count, 0);
+    for(size_t i=0; i<count; ++i)
+    {
+        if (wedges[i] > 1)
+        { lockedPosition[i] = 1; }
+    }
+
+    // 位置で繋いだ有向辺を集め, 逆向きの辺が無いか重複している辺を境界・非多様体とする.
+    std::vector<uint64_t> edges;
+    edges.reserve(indices.size());
+    for(size_t i=0; i<indices.size(); i+=3)
+    {
+        for(auto j=0; j<3; ++j)
+        {
+            uint64_t a = position[indices[i + j]];
+            uint64_t b = position[indices[i + (j + 1) % 3]];
+            edges.push_back((a << 32) | b);
+        }
+    }
+    std::sort(edges.begin(), edges.end());
+
+    for(size_t i=0; i<edges.size(); ++i)
+    {
+        auto a = uint32_t(edges[i] >> 32);
+        auto b = uint32_t(edges[i] & 0xffffffff);
+
+        auto duplicated = (i > 0 && edges[i - 1] == edges[i])
+                       || (i + 1 < edges.size() && edges[i + 1] == edges[i]);
+        auto reverse    = (uint64_t(b) << 32) | a;
+        auto range      = std::equal_range(edges.begin(), edges.end(), reverse);
+        if (duplicated || range.second - range.first != 1)
+        {
+            lockedPosition[a] = 1;
+            lockedPosition[b] = 1;
+        }
+    }
+
+    locked.assign(count, 0);
+    for(size_t i=0; i<count; ++i)
+    {
+        if (position[i] != kInvalidIndex)
+        { locked[i] = lockedPosition[position[i]]; }
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      頂点を動かすと裏返る三角形があるかどうか.
+//-----------------------------------------------------------------------------
+bool IsFlipped
+(
+    const ResMesh&                  mesh,
+    const std::vector<uint32_t>&    indices,
+    const std::vector<uint32_t>&    offsets,
+    const std::vector<uint32_t>&    triangles,
+    uint32_t                        from,
+    uint32_t                        to
+)
+{
+    auto& target = mesh.Vertices[to].Position;
+
+    for(auto i=offsets[from]; i<offsets[from + 1]; ++i)
+    {
+        auto tri = triangles[i];
+        auto i0  = indices[tri * 3 + 0];
+        auto i1  = indices[tri * 3 + 1];
+        auto i2  = indices[tri * 3 + 2];
+
+        // 縮約先を含む三角形は消えるので判定しない.
+        if (i0 == to || i1 == to || i2 == to)
+        { continue; }
+
+        auto& p0 = mesh.Vertices[i0].Position;
+        auto& p1 = mesh.Vertices[i1].Position;
+        auto& p2 = mesh.Vertices[i2].Position;
+
+        float ox, oy, oz;
+        GetNormal(p0, p1, p2, ox, oy, oz);
+
+        float nx, ny, nz;
+        GetNormal(
+            (i0 == from) ? target : p0,
+            (i1 == from) ? target : p1,
+            (i2 == from) ? target : p2,
+            nx, ny, nz);
+
+        // 縮約後に面積が無くなる三角形も作らない.
+        auto oldLength = ox * ox + oy * oy + oz * oz;
+        auto newLength = nx * nx + ny * ny + nz * nz;
+        if (newLength <= 0.0f)
+        { return true; }
+
+        if (oldLength <= 0.0f)
+        { continue; }
+
+        // 90度で判定すると, 90度近い縮約を重ねて裏返ることがあるので余裕を持たせる.
+        auto dot = ox * nx + oy * ny + oz * nz;
+        if (dot <= kFlipThreshold * sqrtf(oldLength * newLength))
+        { return true; }
+    }
+
+    return false;
+}
+
+//-----------------------------------------------------------------------------
+//      縮約すると面が折り重なるかどうか.
+//-----------------------------------------------------------------------------
+bool IsFolded
+(
+    const std::vector<uint32_t>&    indices,
+    const std::vector<uint32_t>&    offsets,
+    const std::vector<uint32_t>&    triangles,
+    uint32_t                        from,
+    uint32_t                        to,
+    std::vector<uint32_t>&          ring,
+    std::vector<uint32_t>&          shared
+)
+{
+    ring  .clear();
+    shared.clear();
+
+    for(auto i=offsets[from]; i<offsets[from + 1]; ++i)
+    {
+        for(auto j=0; j<3; ++j)
+        { ring.push_back(indices[triangles[i] * 3 + j]); }
+    }
+    std::sort(ring.begin(), ring.end());
+
+    for(auto i=offsets[to]; i<offsets[to + 1]; ++i)
+    {
+        for(auto j=0; j<3; ++j)
+        {
+            auto index = indices[triangles[i] * 3 + j];
+            if (index != from && index != to && std::binary_search(ring.begin(), ring.end(), index))
+            { shared.push_back(index); }
+        }
+    }
+    std::sort(shared.begin(), shared.end());
+
+    // 両端に共通する隣接頂点が辺の両側の2つより多いと, 縮約後に三角形が重なる.
+    return std::unique(shared.begin(), shared.end()) - shared.begin() > 2;
+}
+
+//-----------------------------------------------------------------------------
+//      インデックスが正しいかチェックします.
+//-----------------------------------------------------------------------------
+bool IsValid(const ResMesh& mesh, const std::vector<uint32_t>& indices)
+{
+    if (indices.size() % 3 != 0)
+    { return false; }
+
+    auto vertexCount = mesh.Vertices.size();
+    for(auto index : indices)
+    {
+        if (index >= vertexCount)
+        { return false; }
+    }
+
+    return true;
+}
+
+} // namespace
+
+
+//-----------------------------------------------------------------------------
+//      二次誤差計量による辺の縮約でインデックスを簡略化します.
+//-----------------------------------------------------------------------------
+bool SimplifyMesh
+(
+    const ResMesh&                  mesh,
+    const std::vector<uint32_t>&    indices,
+    uint32_t                        targetCount,
+    float                           maxError,
+    std::vector<uint32_t>&          result,
+    float*                          pError
+)
+{
+    if (!IsValid(mesh, indices))
+    { return false; }
+
+    auto vertexCount = mesh.Vertices.size();
+    auto pVertices   = mesh.Vertices.data();
+
+    std::vector<uint8_t> used(vertexCount, 0);
+    for(auto index : indices)
+    { used[index] = 1; }
+
+    // 属性まで一致する頂点はまとめ, 位置だけ一致する頂点は継ぎ目として扱う.
+    std::vector<uint32_t> remap;
+    BuildRemap(used,
+        [&](uint32_t i) { return HashBytes(&pVertices[i], sizeof(MeshVertex)); },
+        [&](uint32_t a, uint32_t b) { return memcmp(&pVertices[a], &pVertices[b], sizeof(MeshVertex)) == 0; },
+        remap);
+
+    std::vector<uint32_t> position;
+    BuildRemap(used,
+        [&](uint32_t i) { return HashBytes(&pVertices[i].Position, sizeof(DirectX::XMFLOAT3)); },
+        [&](uint32_t a, uint32_t b) { return memcmp(&pVertices[a].Position, &pVertices[b].Position, sizeof(DirectX::XMFLOAT3)) == 0; },
+        position);
+
+    result.resize(indices.size());
+    for(size_t i=0; i<indices.size(); ++i)
+    { result[i] = remap[indices[i]]; }
+
+    std::vector<uint8_t> locked;
+    FindLockedVertices(result, position, remap, locked);
+
+    // 頂点ごとに隣接する三角形の平面までの距離の2乗を集める.
+    std::vector<Quadric> quadrics(vertexCount, Quadric());
+    for(size_t i=0; i<result.size(); i+=3)
+    {
+        auto& p0 = pVertices[result[i + 0]].Position;
+        auto& p1 = pVertices[result[i + 1]].Position;
+        auto& p2 = pVertices[result[i + 2]].Position;
+
+        float nx, ny, nz;
+        GetNormal(p0, p1, p2, nx, ny, nz);
+
+        auto length = sqrt(double(nx) * nx + double(ny) * ny + double(nz) * nz);
+        if (length <= 0.0)
+        { continue; }
+
+        auto x = nx / length;
+        auto y = ny / length;
+        auto z = nz / length;
+        auto d = -(x * p0.x + y * p0.y + z * p0.z);
+
+        for(auto j=0; j<3; ++j)
+        { AddPlane(quadrics[result[i + j]], x, y, z, d); }
+    }
+
+    auto maxCost   = 0.0f;
+    auto limitCost = maxError * maxError;
+
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> triangles;
+    std::vector<Collapse> collapses;
+    std::vector<uint8_t>  touched;
+    std::vector<uint32_t> applied;
+    std::vector<uint32_t> ring;
+    std::vector<uint32_t> shared;
+    std::vector<uint32_t> target(vertexCount);
+    for(size_t i=0; i<vertexCount; ++i)
+    { target[i] = uint32_t(i); }
+
+    // 互いに影響しない縮約をコストの小さい順にまとめて行い, 目標に届くまで繰り返す.
+    while(result.size() > targetCount)
+    {
+        auto triangleCount = uint32_t(result.size() / 3);
+
+        // 頂点から三角形への隣接情報.
+        offsets.assign(vertexCount + 1, 0);
+        for(auto index : result)
+        { offsets[index + 1]++; }
+        for(size_t i=0; i<vertexCount; ++i)
+        { offsets[i + 1] += offsets[i]; }
+
+        triangles.resize(result.size());
+        {
+            std::vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+            for(auto i=0u; i<triangleCount; ++i)
+            {
+                for(auto j=0; j<3; ++j)
+                { triangles[cursor[result[i * 3 + j]]++] = i; }
+            }
+        }
+
+        // 各頂点から同じ三角形の他の頂点へ寄せる縮約を候補にする.
+        collapses.clear();
+        for(auto i=0u; i<triangleCount; ++i)
+        {
+            for(auto j=0; j<3; ++j)
+            {
+                auto from = result[i * 3 + j];
+                if (locked[from])
+                { continue; }
+
+                for(auto k=1; k<3; ++k)
+                {
+                    auto to   = result[i * 3 + (j + k) % 3];
+                    auto cost = float(EvaluateQuadric(quadrics[from], pVertices[to].Position));
+                    collapses.push_back({ from, to, cost });
+                }
+            }
+        }
+
+        if (collapses.empty())
+        { break; }
+
+        std::sort(collapses.begin(), collapses.end(),
+            [](const Collapse& a, const Collapse& b) { return a.Cost < b.Cost; });
+
+        // 1回の縮約でおおよそ2つの三角形が消える.
+        auto needed = std::max((triangleCount - targetCount / 3 + 1) / 2, 1u);
+
+        touched.assign(vertexCount, 0);
+        applied.clear();
+        for(auto& itr : collapses)
+        {
+            if (itr.Cost > limitCost)
+            { break; }
+
+            if (touched[itr.From] || touched[itr.To])
+            { continue; }
+
+            if (IsFlipped(mesh, result, offsets, triangles, itr.From, itr.To)
+             || IsFolded(result, offsets, triangles, itr.From, itr.To, ring, shared))
+            { continue; }
+
+            // 周囲の三角形の形が変わるので, この回では1リング近傍を動かさない.
+            for(auto i=offsets[itr.From]; i<offsets[itr.From + 1]; ++i)
+            {
+                auto tri = triangles[i];
+                touched[result[tri * 3 + 0]] = 1;
+                touched[result[tri * 3 + 1]] = 1;
+                touched[result[tri * 3 + 2]] = 1;
+            }
+
+            target[itr.From] = itr.To;
+            applied.push_back(itr.From);
+            AddQuadric(quadrics[itr.To], quadrics[itr.From]);
+            maxCost = std::max(maxCost, itr.Cost);
+
+            if (applied.size() >= needed)
+            { break; }
+        }
+
+        if (applied.empty())
+        { break; }
+
+        // 縮約を反映し, 潰れた三角形を取り除く.
+        size_t count = 0;
+        for(size_t i=0; i<result.size(); i+=3)
+        {
+            auto i0 = target[result[i + 0]];
+            auto i1 = target[result[i + 1]];
+            auto i2 = target[result[i + 2]];
+            if (i0 == i1 || i1 == i2 || i2 == i0)
+            { continue; }
+
+            result[count++] = i0;
+            result[count++] = i1;
+            result[count++] = i2;
+        }
+        result.resize(count);
+
+        for(auto index : applied)
+        { target[index] = index; }
+    }
+
+    if (pError != nullptr)
+    { *pError = sqrtf(maxCost); }
+
+    // 正常終了.
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      LOD チェインを生成します.
+//-----------------------------------------------------------------------------
+bool BuildMeshLods(ResMesh& mesh, const MeshLodDesc& desc)
+{
+    mesh.Lods      .clear();
+    mesh.LodIndices.clear();
+
+    if (!IsValid(mesh, mesh.Indices))
+    { return false; }
+
+    if (mesh.Vertices.empty())
+    { return true; }
+
+    // 許容誤差はメッシュの大きさに対する比率で指定する.
+    auto bounds   = ComputeMeshBounds(&mesh.Vertices[0].Position, mesh.Vertices.size(), sizeof(MeshVertex));
+    auto maxError = desc.MaxError * bounds.Radius;
+
+    std::vector<uint32_t> source = mesh.Indices;
+    std::vector<uint32_t> lod;
+    auto sourceError = 0.0f;
+
+    for(auto level=0u; level<desc.MaxLevels; ++level)
+    {
+        auto triangleCount = uint32_t(source.size() / 3);
+        auto targetCount   = uint32_t(float(triangleCount) * desc.Reduction);
+        if (targetCount < desc.MinTriangles)
+        { break; }
+
+        // 前のレベルからの誤差を足していくので, 残りの許容量で簡略化する.
+        auto error = 0.0f;
+        if (!SimplifyMesh(mesh, source, targetCount * 3, maxError - sourceError, lod, &error))
+        { return false; }
+
+        if (float(lod.size()) > float(source.size()) * desc.MinReduction)
+        { break; }
+
+        OptimizeVertexCache(lod, mesh.Vertices.size(), desc.CacheSize);
+
+        ResLod info = {};
+        info.IndexOffset = uint32_t(mesh.LodIndices.size());
+        info.IndexCount  = uint32_t(lod.size());
+        info.Error       = sourceError + error;
+        mesh.Lods.push_back(info);
+        mesh.LodIndices.insert(mesh.LodIndices.end(), lod.begin(), lod.end());
+
+        source.swap(lod);
+        sourceError = info.Error;
+    }
+
+    // 正常終了.
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      複数のメッシュの LOD チェインを生成します.
+//-----------------------------------------------------------------------------
+bool BuildMeshLods(std::vector<ResMesh>& meshes, const MeshLodDesc& desc)
+{
+    std::vector<uint8_t> result(meshes.size(), 0);
+
+    ParallelFor(meshes.size(), [&](size_t i)
+    { result[i] = BuildMeshLods(meshes[i], desc) ? 1 : 0; });
+
+    for(auto itr : result)
+    {
+        if (!itr)
+        { return false; }
+    }
+
+    return true;
+}
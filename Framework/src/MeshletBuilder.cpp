@@ -0,0 +1,385 @@
+﻿//-----------------------------------------------------------------------------
+// File : MeshletBuilder.cpp
+// Desc : Meshlet Builder Module.
+// Copyright(c) Pocol. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include "MeshletBuilder.h"
+#include "MeshBounds.h"
+#include "ParallelUtil.h"
+#include <algorithm>
+#include <cmath>
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+constexpr uint32_t kInvalidIndex        = UINT32_MAX;
+constexpr uint32_t kMaxMeshletVertices  = 256;      // ローカル頂点番号は 8bit.
+constexpr uint32_t kMaxMeshletTriangles = 512;      // メッシュシェーダの出力上限に合わせる.
+constexpr float    kMinConeDot          = 0.1f;     // これより法線が広がる場合はコーンを無効にする.
+
+///////////////////////////////////////////////////////////////////////////////
+// TriangleAdjacency structure
+///////////////////////////////////////////////////////////////////////////////
+struct TriangleAdjacency
+{
+    std::vector<uint32_t>   Offsets;    //!< 頂点ごとの開始位置です.
+    std::vector<uint32_t>   Triangles;  //!< 頂点を参照する三角形番号です.
+    std::vector<uint32_t>   Live;       //!< 頂点を参照する未出力の三角形数です.
+};
+
+//-----------------------------------------------------------------------------
+//      頂点から三角形への隣接情報を構築します.
+//-----------------------------------------------------------------------------
+void BuildAdjacency(const ResMesh& mesh, TriangleAdjacency& adjacency)
+{
+    auto vertexCount   = mesh.Vertices.size();
+    auto triangleCount = mesh.Indices.size() / 3;
+
+    adjacency.Offsets.assign(vertexCount + 1, 0);
+    adjacency.Live   .assign(vertexCount, 0);
+
+    for(auto index : mesh.Indices)
+    { adjacency.Live[index]++; }
+
+    for(size_t i=0; i<vertexCount; ++i)
+    { adjacency.Offsets[i + 1] = adjacency.Offsets[i] + adjacency.Live[i]; }
+
+    std::vector<uint32_t> cursor(adjacency.Offsets.begin(), adjacency.Offsets.end() - 1);
+    adjacency.Triangles.resize(mesh.Indices.size());
+    for(size_t i=0; i<triangleCount; ++i)
+    {
+        for(auto j=0; j<3; ++j)
+        { adjacency.Triangles[cursor[mesh.Indices[i * 3 + j]]++] = uint32_t(i); }
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      三角形をメッシュレットに振り分けます.
+//-----------------------------------------------------------------------------
+void PartitionMeshlets(ResMesh& mesh, const MeshletDesc& desc)
+{
+    auto triangleCount = uint32_t(mesh.Indices.size() / 3);
+
+    TriangleAdjacency adjacency;
+    BuildAdjacency(mesh, adjacency);
+
+    std::vector<uint32_t> local     (mesh.Vertices.size(), kInvalidIndex);
+    std::vector<uint8_t>  emitted   (triangleCount, 0);
+    std::vector<uint8_t>  candidate (triangleCount, 0);
+    std::vector<uint32_t> candidates;
+
+    auto pIndices = mesh.Indices.data();
+
+    mesh.Meshlets        .clear();
+    mesh.MeshletVertices .clear();
+    mesh.MeshletTriangles.clear();
+    mesh.MeshletTriangles.reserve(triangleCount);
+
+    ResMeshlet meshlet = {};
+
+    // 現在のメッシュレットを閉じ, 次のメッシュレットを開始します.
+    auto flush = [&]()
+    {
+        if (meshlet.TriangleCount == 0)
+        { return; }
+
+        for(auto i=0u; i<meshlet.VertexCount; ++i)
+        { local[mesh.MeshletVertices[meshlet.VertexOffset + i]] = kInvalidIndex; }
+
+        for(auto tri : candidates)
+        { candidate[tri] = 0; }
+        candidates.clear();
+
+        mesh.Meshlets.push_back(meshlet);
+
+        meshlet = {};
+        meshlet.VertexOffset   = uint32_t(mesh.MeshletVertices .size());
+        meshlet.TriangleOffset = uint32_t(mesh.MeshletTriangles.size());
+    };
+
+    // 三角形を追加するために必要な新規頂点数を求めます.
+    auto getCost = [&](uint32_t tri)
+    {
+        auto cost = 0u;
+        for(auto j=0; j<3; ++j)
+        { cost += (local[pIndices[tri * 3 + j]] == kInvalidIndex) ? 1 : 0; }
+        return cost;
+    };
+
+    uint32_t seed = 0;
+    for(auto n=0u; n<triangleCount; ++n)
+    {
+        // 共有頂点が多い候補を優先し, 同じなら残りの三角形が少ない頂点を持つものを選ぶ.
+        // 外周から閉じていくことで, 取り残された三角形で小さなメッシュレットができるのを防ぐ.
+        auto best      = kInvalidIndex;
+        auto bestCost  = UINT32_MAX;
+        auto bestLive  = UINT32_MAX;
+        size_t alive   = 0;
+        for(auto tri : candidates)
+        {
+            if (emitted[tri])
+            {
+                candidate[tri] = 0;
+                continue;
+            }
+
+            candidates[alive++] = tri;
+
+            auto cost = getCost(tri);
+            auto live = adjacency.Live[pIndices[tri * 3 + 0]]
+                      + adjacency.Live[pIndices[tri * 3 + 1]]
+                      + adjacency.Live[pIndices[tri * 3 + 2]];
+            if (cost < bestCost || (cost == bestCost && live < bestLive))
+            {
+                best     = tri;
+                bestCost = cost;
+                bestLive = live;
+            }
+        }
+        candidates.resize(alive);
+
+        // 隣接する候補が無ければ, 未出力の三角形から順番に取る.
+        if (best == kInvalidIndex)
+        {
+            while(emitted[seed])
+            { seed++; }
+
+            best     = seed;
+            bestCost = getCost(seed);
+        }
+
+        // 収まらなければ閉じる. 空のメッシュレットには必ず収まるので, そのまま次の種にする.
+        if (meshlet.VertexCount   + bestCost > desc.MaxVertices
+         || meshlet.TriangleCount + 1        > desc.MaxTriangles)
+        {
+            flush();
+            bestCost = 3;
+        }
+
+        uint32_t packed = 0;
+        for(auto j=0u; j<3; ++j)
+        {
+            auto index = pIndices[best * 3 + j];
+            if (local[index] == kInvalidIndex)
+            {
+                local[index] = meshlet.VertexCount++;
+                mesh.MeshletVertices.push_back(index);
+            }
+
+            packed |= local[index] << (j * 8);
+            adjacency.Live[index]--;
+        }
+
+        mesh.MeshletTriangles.push_back(packed);
+        meshlet.TriangleCount++;
+        emitted[best] = 1;
+
+        // 新しい三角形の頂点に隣接する三角形を候補に加える.
+        for(auto j=0u; j<3; ++j)
+        {
+            auto index = pIndices[best * 3 + j];
+            for(auto k=adjacency.Offsets[index]; k<adjacency.Offsets[index + 1]; ++k)
+            {
+                auto tri = adjacency.Triangles[k];
+                if (emitted[tri] || candidate[tri])
+                { continue; }
+
+                candidate[tri] = 1;
+                candidates.push_back(tri);
+            }
+        }
+    }
+
+    flush();
+}
+
+//-----------------------------------------------------------------------------
+//      メッシュレットの境界球と法線コーンを求めます.
+//-----------------------------------------------------------------------------
+void ComputeMeshletBounds(const ResMesh& mesh, ResMeshlet& meshlet)
+{
+    using namespace DirectX;
+
+    auto pPositions = &mesh.Vertices[0].Position;
+    auto bounds = ComputeMeshBounds(
+        pPositions,
+        sizeof(MeshVertex),
+        mesh.MeshletVertices.data() + meshlet.VertexOffset,
+        meshlet.VertexCount);
+
+    meshlet.Center     = bounds.Center;
+    meshlet.Radius     = bounds.Radius;
+    meshlet.ConeApex   = bounds.Center;
+    meshlet.ConeAxis   = XMFLOAT3(0.0f, 0.0f, 0.0f);
+    meshlet.ConeCutoff = 1.0f;
+    meshlet.Reserved   = 0;
+
+    // 三角形の法線を求める. 法線は cross(p1 - p0, p2 - p0) の向きとする.
+    XMVECTOR normals[kMaxMeshletTriangles];
+    XMVECTOR corners[kMaxMeshletTriangles];
+    auto count = 0u;
+    auto axis  = XMVectorZero();
+
+    auto pVertices  = mesh.MeshletVertices .data() + meshlet.VertexOffset;
+    auto pTriangles = mesh.MeshletTriangles.data() + meshlet.TriangleOffset;
+    for(auto i=0u; i<meshlet.TriangleCount; ++i)
+    {
+        auto p0 = XMLoadFloat3(&mesh.Vertices[pVertices[UnpackMeshletIndex(pTriangles[i], 0)]].Position);
+        auto p1 = XMLoadFloat3(&mesh.Vertices[pVertices[UnpackMeshletIndex(pTriangles[i], 1)]].Position);
+        auto p2 = XMLoadFloat3(&mesh.Vertices[pVertices[UnpackMeshletIndex(pTriangles[i], 2)]].Position);
+
+        auto n   = XMVector3Cross(XMVectorSubtract(p1, p0), XMVectorSubtract(p2, p0));
+        auto len = XMVectorGetX(XMVector3Length(n));
+
+        // 縮退した三角形は向きを持たないので除外する.
+        if (len <= 0.0f)
+        { continue; }
+
+        normals[count] = XMVectorScale(n, 1.0f / len);
+        corners[count] = p0;
+        axis = XMVectorAdd(axis, normals[count]);
+        count++;
+    }
+
+    auto axisLength = XMVectorGetX(XMVector3Length(axis));
+    if (count == 0 || axisLength <= 0.0f)
+    { return; }
+
+    axis = XMVectorScale(axis, 1.0f / axisLength);
+
+    auto minDot = 1.0f;
+    for(auto i=0u; i<count; ++i)
+    { minDot = std::min(minDot, XMVectorGetX(XMVector3Dot(axis, normals[i]))); }
+
+    if (minDot <= kMinConeDot)
+    { return; }
+
+    // 軸を中心から逆向きにたどり, 全ての三角形の裏側に入る位置をコーンの頂点とする.
+    auto center = XMLoadFloat3(&bounds.Center);
+    auto maxT   = 0.0f;
+    for(auto i=0u; i<count; ++i)
+    {
+        auto dc = XMVectorGetX(XMVector3Dot(XMVectorSubtract(center, corners[i]), normals[i]));
+        auto dn = XMVectorGetX(XMVector3Dot(axis, normals[i]));
+        maxT = std::max(maxT, dc / dn);
+    }
+
+    XMStoreFloat3(&meshlet.ConeApex, XMVectorSubtract(center, XMVectorScale(axis, maxT)));
+    XMStoreFloat3(&meshlet.ConeAxis, axis);
+    meshlet.ConeCutoff = sqrtf(1.0f - minDot * minDot);
+}
+
+//-----------------------------------------------------------------------------
+//      分割設定とインデックスが正しいかチェックします.
+//-----------------------------------------------------------------------------
+bool IsValid(const ResMesh& mesh, const MeshletDesc& desc)
+{
+    if (desc.MaxVertices  < 3 || desc.MaxVertices  > kMaxMeshletVertices
+     || desc.MaxTriangles < 1 || desc.MaxTriangles > kMaxMeshletTriangles)
+    { return false; }
+
+    if (mesh.Indices.size() % 3 != 0)
+    { return false; }
+
+    auto vertexCount = mesh.Vertices.size();
+    for(auto index : mesh.Indices)
+    {
+        if (index >= vertexCount)
+        { return false; }
+    }
+
+    return true;
+}
+
+} // namespace
+
+
+//-----------------------------------------------------------------------------
+//      メッシュの三角形をメッシュレットに分割します.
+//-----------------------------------------------------------------------------
+bool BuildMeshlets(ResMesh& mesh, const MeshletDesc& desc)
+{
+    if (!IsValid(mesh, desc))
+    { return false; }
+
+    PartitionMeshlets(mesh, desc);
+
+    for(auto& meshlet : mesh.Meshlets)
+    { ComputeMeshletBounds(mesh, meshlet); }
+
+    // 正常終了.
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      複数のメッシュをメッシュレットに分割します.
+//-----------------------------------------------------------------------------
+bool BuildMeshlets
+(
+    std::vector<ResMesh>&   meshes,
+    const MeshletDesc&      desc,
+    MeshletStats*           pStats
+)
+{
+    std::vector<uint8_t> result(meshes.size(), 0);
+
+    // 分割はメッシュ内で逐次的なので, メッシュ単位で並列に処理します.
+    ParallelFor(meshes.size(), [&](size_t i)
+    {
+        if (!IsValid(meshes[i], desc))
+        { return; }
+
+        PartitionMeshlets(meshes[i], desc);
+        result[i] = 1;
+    });
+
+    // バウンディングボリュームはメッシュレットごとに独立しているので, 全メッシュ分を平坦にして処理します.
+    struct Task
+    {
+        uint32_t Mesh;
+        uint32_t Meshlet;
+    };
+    std::vector<Task> tasks;
+    for(size_t i=0; i<meshes.size(); ++i)
+    {
+        for(size_t j=0; j<meshes[i].Meshlets.size(); ++j)
+        { tasks.push_back({ uint32_t(i), uint32_t(j) }); }
+    }
+
+    ParallelFor(tasks.size(), [&](size_t i)
+    {
+        auto& mesh = meshes[tasks[i].Mesh];
+        ComputeMeshletBounds(mesh, mesh.Meshlets[tasks[i].Meshlet]);
+    });
+
+    auto succeeded = true;
+    MeshletStats stats = {};
+    for(size_t i=0; i<meshes.size(); ++i)
+    {
+        if (!result[i])
+        {
+            succeeded = false;
+            continue;
+        }
+
+        for(auto& meshlet : meshes[i].Meshlets)
+        {
+            stats.MeshletCount++;
+            stats.VertexCount   += meshlet.VertexCount;
+            stats.TriangleCount += meshlet.TriangleCount;
+            stats.ConeCount     += (meshlet.ConeCutoff < 1.0f) ? 1 : 0;
+        }
+    }
+
+    if (pStats != nullptr)
+    { *pStats = stats; }
+
+    return succeeded;
+}
@@ -0,0 +1,369 @@
+﻿//-----------------------------------------------------------------------------
+// File : OcclusionBuffer.cpp
+// Desc : Software Occlusion Buffer Module.
+// Copyright(c) Pocol. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include "OcclusionBuffer.h"
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+#include <immintrin.h>
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+constexpr float kMinW = 1e-4f;      // これより手前の頂点はニアクリップ面をまたぐとみなす.
+
+//-----------------------------------------------------------------------------
+//      2のべき乗かどうか.
+//-----------------------------------------------------------------------------
+inline bool IsPow2(uint32_t value)
+{ return value != 0 && (value & (value - 1)) == 0; }
+
+//-----------------------------------------------------------------------------
+//      点をクリップ空間に変換します.
+//-----------------------------------------------------------------------------
+inline __m128 TransformPoint(const DirectX::XMMATRIX& m, float x, float y, float z)
+{
+    return _mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(_mm_set1_ps(x), m.r[0]), _mm_mul_ps(_mm_set1_ps(y), m.r[1])),
+        _mm_add_ps(_mm_mul_ps(_mm_set1_ps(z), m.r[2]), m.r[3]));
+}
+
+//-----------------------------------------------------------------------------
+//      辺関数を求めます.
+//-----------------------------------------------------------------------------
+inline float Edge(const float* a, const float* b, float x, float y)
+{ return (b[0] - a[0]) * (y - a[1]) - (b[1] - a[1]) * (x - a[0]); }
+
+} // namespace
+
+
+///////////////////////////////////////////////////////////////////////////////
+// OcclusionBuffer class
+///////////////////////////////////////////////////////////////////////////////
+
+//-----------------------------------------------------------------------------
+//      コンストラクタです.
+//-----------------------------------------------------------------------------
+OcclusionBuffer::OcclusionBuffer()
+{ DirectX::XMStoreFloat4x4(&m_ViewProj, DirectX::XMMatrixIdentity()); }
+
+//-----------------------------------------------------------------------------
+//      デストラクタです.
+//-----------------------------------------------------------------------------
+OcclusionBuffer::~OcclusionBuffer()
+{ Term(); }
+
+//-----------------------------------------------------------------------------
+//      初期化処理を行います.
+//-----------------------------------------------------------------------------
+bool OcclusionBuffer::Init(uint32_t width, uint32_t height)
+{
+    if (!IsPow2(width) || !IsPow2(height))
+    { return false; }
+
+    m_Levels.clear();
+
+    // 1x1 になるまで半分にしていく.
+    uint32_t offset = 0;
+    for(;;)
+    {
+        Level level = {};
+        level.Offset = offset;
+        level.Width  = width;
+        level.Height = height;
+        m_Levels.push_back(level);
+
+        offset += width * height;
+        if (width == 1 && height == 1)
+        { break; }
+
+        width  = std::max(width  / 2, 1u);
+        height = std::max(height / 2, 1u);
+    }
+
+    m_Depth.assign(offset, 1.0f);
+
+    // 正常終了.
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      終了処理を行います.
+//-----------------------------------------------------------------------------
+void OcclusionBuffer::Term()
+{
+    m_Depth .clear();
+    m_Levels.clear();
+}
+
+//-----------------------------------------------------------------------------
+//      深度をクリアして描画を開始します.
+//-----------------------------------------------------------------------------
+void OcclusionBuffer::Begin(const DirectX::XMMATRIX& viewProj)
+{
+    DirectX::XMStoreFloat4x4(&m_ViewProj, viewProj);
+    std::fill(m_Depth.begin(), m_Depth.end(), 1.0f);
+}
+
+//-----------------------------------------------------------------------------
+//      遮蔽物のメッシュを描画します.
+//-----------------------------------------------------------------------------
+uint32_t OcclusionBuffer::RasterizeMesh
+(
+    const DirectX::XMFLOAT3*    pPositions,
+    size_t                      stride,
+    const uint32_t*             pIndices,
+    uint32_t                    indexCount,
+    const DirectX::XMMATRIX&    world
+)
+{
+    if (m_Levels.empty() || pPositions == nullptr || pIndices == nullptr)
+    { return 0; }
+
+    auto viewProj = DirectX::XMLoadFloat4x4(&m_ViewProj);
+    auto matrix   = DirectX::XMMatrixMultiply(world, viewProj);
+    auto pData    = reinterpret_cast<const uint8_t*>(pPositions);
+
+    auto& level0 = m_Levels[0];
+    auto  width  = float(level0.Width);
+    auto  height = float(level0.Height);
+
+    uint32_t count = 0;
+    for(uint32_t i=0; i + 2<indexCount; i+=3)
+    {
+        alignas(16) float v[3][4];
+        auto culled = false;
+        for(auto j=0; j<3; ++j)
+        {
+            auto pos = reinterpret_cast<const DirectX::XMFLOAT3*>(pData + pIndices[i + j] * stride);
+            _mm_store_ps(v[j], TransformPoint(matrix, pos->x, pos->y, pos->z));
+
+            // ニアクリップ面をまたぐ遮蔽物は描画しなくても判定は保守的なままになる.
+            if (v[j][3] < kMinW || v[j][2] < 0.0f)
+            {
+                culled = true;
+                break;
+            }
+
+            auto invW = 1.0f / v[j][3];
+            v[j][0] = ( v[j][0] * invW * 0.5f + 0.5f) * width;
+            v[j][1] = (-v[j][1] * invW * 0.5f + 0.5f) * height;
+            v[j][2] =   v[j][2] * invW;
+        }
+
+        if (culled)
+        { continue; }
+
+        RasterizeTriangle(v[0], v[1], v[2]);
+        count++;
+    }
+
+    return count;
+}
+
+//-----------------------------------------------------------------------------
+//      描画を終了し, 階層Zを構築します.
+//-----------------------------------------------------------------------------
+void OcclusionBuffer::End()
+{
+    for(size_t i=1; i<m_Levels.size(); ++i)
+    {
+        auto& src = m_Levels[i - 1];
+        auto& dst = m_Levels[i];
+        auto pSrc = m_Depth.data() + src.Offset;
+        auto pDst = m_Depth.data() + dst.Offset;
+
+        // 片方の軸が既に 1 の場合はその軸は畳まない.
+        auto dx = (src.Width  > 1) ? 1u : 0u;
+        auto dy = (src.Height > 1) ? 1u : 0u;
+
+        for(auto y=0u; y<dst.Height; ++y)
+        {
+            auto row0 = pSrc + (y * (dy + 1)     ) * src.Width;
+            auto row1 = pSrc + (y * (dy + 1) + dy) * src.Width;
+            for(auto x=0u; x<dst.Width; ++x)
+            {
+                auto x0 = x * (dx + 1);
+                auto x1 = x0 + dx;
+                pDst[y * dst.Width + x] = std::max(
+                    std::max(row0[x0], row0[x1]),
+                    std::max(row1[x0], row1[x1]));
+            }
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      ボックスが遮蔽されていないかどうかを判定します.
+//-----------------------------------------------------------------------------
+bool OcclusionBuffer::IsVisible(const MeshBounds& bounds) const
+{
+    if (m_Levels.empty())
+    { return true; }
+
+    auto viewProj = DirectX::XMLoadFloat4x4(&m_ViewProj);
+
+    auto minX = FLT_MAX, minY = FLT_MAX, minZ = FLT_MAX;
+    auto maxX = -FLT_MAX, maxY = -FLT_MAX;
+
+    for(auto i=0; i<8; ++i)
+    {
+        auto x = bounds.Center.x + ((i & 1) ? bounds.Extent.x : -bounds.Extent.x);
+        auto y = bounds.Center.y + ((i & 2) ? bounds.Extent.y : -bounds.Extent.y);
+        auto z = bounds.Center.z + ((i & 4) ? bounds.Extent.z : -bounds.Extent.z);
+
+        alignas(16) float v[4];
+        _mm_store_ps(v, TransformPoint(viewProj, x, y, z));
+
+        // ニアクリップ面をまたぐボックスは判定できないので可視とする.
+        if (v[3] < kMinW)
+        { return true; }
+
+        auto invW = 1.0f / v[3];
+        minX = std::min(minX, v[0] * invW);
+        maxX = std::max(maxX, v[0] * invW);
+        minY = std::min(minY, v[1] * invW);
+        maxY = std::max(maxY, v[1] * invW);
+        minZ = std::min(minZ, v[2] * invW);
+    }
+
+    if (minZ < 0.0f)
+    { return true; }
+
+    // 画面外は視錐台カリングに任せる.
+    if (maxX < -1.0f || minX > 1.0f || maxY < -1.0f || minY > 1.0f)
+    { return true; }
+
+    auto& level0 = m_Levels[0];
+    auto  w      = int(level0.Width);
+    auto  h      = int(level0.Height);
+
+    auto x0 = std::clamp(int(std::floor(( minX * 0.5f + 0.5f) * w)), 0, w - 1);
+    auto x1 = std::clamp(int(std::floor(( maxX * 0.5f + 0.5f) * w)), 0, w - 1);
+    auto y0 = std::clamp(int(std::floor((-maxY * 0.5f + 0.5f) * h)), 0, h - 1);
+    auto y1 = std::clamp(int(std::floor((-minY * 0.5f + 0.5f) * h)), 0, h - 1);
+
+    // 矩形が 2x2 テクセル以内に収まるレベルを選ぶ.
+    uint32_t index = 0;
+    while (index + 1 < m_Levels.size()
+        && ((x1 >> index) - (x0 >> index) > 1 || (y1 >> index) - (y0 >> index) > 1))
+    { index++; }
+
+    auto& level = m_Levels[index];
+    auto  pData = m_Depth.data() + level.Offset;
+
+    auto lx0 = std::min(uint32_t(x0 >> index), level.Width  - 1);
+    auto lx1 = std::min(uint32_t(x1 >> index), level.Width  - 1);
+    auto ly0 = std::min(uint32_t(y0 >> index), level.Height - 1);
+    auto ly1 = std::min(uint32_t(y1 >> index), level.Height - 1);
+
+    auto maxDepth = 0.0f;
+    for(auto y=ly0; y<=ly1; ++y)
+    {
+        for(auto x=lx0; x<=lx1; ++x)
+        { maxDepth = std::max(maxDepth, pData[y * level.Width + x]); }
+    }
+
+    return minZ <= maxDepth;
+}
+
+//-----------------------------------------------------------------------------
+//      横幅を取得します.
+//-----------------------------------------------------------------------------
+uint32_t OcclusionBuffer::GetWidth() const
+{ return m_Levels.empty() ? 0 : m_Levels[0].Width; }
+
+//-----------------------------------------------------------------------------
+//      縦幅を取得します.
+//-----------------------------------------------------------------------------
+uint32_t OcclusionBuffer::GetHeight() const
+{ return m_Levels.empty() ? 0 : m_Levels[0].Height; }
+
+//-----------------------------------------------------------------------------
+//      階層Zのレベル数を取得します.
+//-----------------------------------------------------------------------------
+uint32_t OcclusionBuffer::GetLevelCount() const
+{ return uint32_t(m_Levels.size()); }
+
+//-----------------------------------------------------------------------------
+//      指定レベルの深度を取得します.
+//-----------------------------------------------------------------------------
+const float* OcclusionBuffer::GetDepth(uint32_t level) const
+{
+    assert(level < m_Levels.size());
+    return m_Depth.data() + m_Levels[level].Offset;
+}
+
+//-----------------------------------------------------------------------------
+//      三角形を描画します.
+//-----------------------------------------------------------------------------
+void OcclusionBuffer::RasterizeTriangle(const float* v0, const float* v1, const float* v2)
+{
+    auto area = Edge(v0, v1, v2[0], v2[1]);
+    if (std::fabs(area) < 1e-8f)
+    { return; }
+
+    auto& level0 = m_Levels[0];
+    auto  w      = int(level0.Width);
+    auto  h      = int(level0.Height);
+
+    auto minX = std::max(int(std::floor(std::min({ v0[0], v1[0], v2[0] }))), 0);
+    auto maxX = std::min(int(std::ceil (std::max({ v0[0], v1[0], v2[0] }))), w - 1);
+    auto minY = std::max(int(std::floor(std::min({ v0[1], v1[1], v2[1] }))), 0);
+    auto maxY = std::min(int(std::ceil (std::max({ v0[1], v1[1], v2[1] }))), h - 1);
+    if (minX > maxX || minY > maxY)
+    { return; }
+
+    // 面積で割っておくと向きに関係なく内側が正になる.
+    auto invArea = 1.0f / area;
+
+    // 辺関数は画素中心で評価し, x 方向には増分で進める.
+    auto px = float(minX) + 0.5f;
+    auto py = float(minY) + 0.5f;
+
+    float e[3], dx[3], dy[3];
+    const float* a[3] = { v1, v2, v0 };
+    const float* b[3] = { v2, v0, v1 };
+    for(auto i=0; i<3; ++i)
+    {
+        e [i] =  Edge(a[i], b[i], px, py) * invArea;
+        dx[i] = -(b[i][1] - a[i][1]) * invArea;
+        dy[i] =  (b[i][0] - a[i][0]) * invArea;
+    }
+
+    auto pDepth = m_Depth.data() + level0.Offset;
+    for(auto y=minY; y<=maxY; ++y)
+    {
+        auto w0 = e[0];
+        auto w1 = e[1];
+        auto w2 = e[2];
+        auto pRow = pDepth + y * w;
+
+        for(auto x=minX; x<=maxX; ++x)
+        {
+            if (w0 >= 0.0f && w1 >= 0.0f && w2 >= 0.0f)
+            {
+                auto z = w0 * v0[2] + w1 * v1[2] + w2 * v2[2];
+                pRow[x] = std::min(pRow[x], z);
+            }
+
+            w0 += dx[0];
+            w1 += dx[1];
+            w2 += dx[2];
+        }
+
+        e[0] += dy[0];
+        e[1] += dy[1];
+        e[2] += dy[2];
+    }
+}
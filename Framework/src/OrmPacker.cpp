@@ -0,0 +1,229 @@
+﻿//-----------------------------------------------------------------------------
+// File : OrmPacker.cpp
+// Desc : Occlusion/Roughness/Metallic Texture Packer Module.
+// Copyright(c) Pocol. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include "OrmPacker.h"
+#include "FileUtil.h"
+#include "Logger.h"
+#include "ParallelUtil.h"
+#include <Windows.h>
+#include <algorithm>
+#include <cwchar>
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+//      FNV-1a でハッシュ値を更新します.
+//-----------------------------------------------------------------------------
+inline uint64_t HashValue(uint64_t hash, uint64_t value)
+{
+    for(auto i=0; i<8; ++i)
+    {
+        hash ^= (value >> (i * 8)) & 0xff;
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+//-----------------------------------------------------------------------------
+//      ファイルの更新日時を取得します.
+//-----------------------------------------------------------------------------
+bool GetLastWriteTime(const std::wstring& path, FILETIME& result)
+{
+    WIN32_FILE_ATTRIBUTE_DATA attr = {};
+    if (!GetFileAttributesExW(path.c_str(), GetFileExInfoStandard, &attr))
+    { return false; }
+
+    result = attr.ftLastWriteTime;
+    return true;
+}
+
+} // namespace
+
+
+//-----------------------------------------------------------------------------
+//      3枚の画像を1枚の ORM 画像に詰めます.
+//-----------------------------------------------------------------------------
+bool PackOrmImage
+(
+    const OrmSourceImage    (&sources)[ORM_CHANNEL_COUNT],
+    uint32_t&               width,
+    uint32_t&               height,
+    std::vector<uint8_t>&   result
+)
+{
+    uint32_t w = 0;
+    uint32_t h = 0;
+    for(auto& source : sources)
+    {
+        if (source.pPixels == nullptr || source.Width == 0 || source.Height == 0 || source.Channel > 3)
+        { continue; }
+
+        w = std::max(w, source.Width);
+        h = std::max(h, source.Height);
+    }
+
+    if (w == 0 || h == 0)
+    { return false; }
+
+    // ブロック圧縮できるように4の倍数に切り上げる.
+    w = (w + 3) & ~3u;
+    h = (h + 3) & ~3u;
+    result.resize(size_t(w) * h * 4);
+
+    ParallelFor(h, [&](size_t y)
+    {
+        auto pDst = &result[y * w * 4];
+        for(auto x=0u; x<w; ++x, pDst+=4)
+        {
+            for(auto c=0; c<ORM_CHANNEL_COUNT; ++c)
+            {
+                auto& source = sources[c];
+                if (source.pPixels == nullptr || source.Width == 0 || source.Height == 0 || source.Channel > 3)
+                {
+                    pDst[c] = 255;
+                    continue;
+                }
+
+                auto sx = uint32_t(uint64_t(x) * source.Width  / w);
+                auto sy = uint32_t(uint64_t(y) * source.Height / h);
+                pDst[c] = source.pPixels[(size_t(sy) * source.Width + sx) * 4 + source.Channel];
+            }
+            pDst[3] = 255;
+        }
+    });
+
+    width  = w;
+    height = h;
+
+    // 正常終了.
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      ORM テクスチャのキャッシュファイルのパスを求めます.
+//-----------------------------------------------------------------------------
+std::wstring GetOrmCachePath(const OrmSourcePaths& sources)
+{
+    std::wstring base;
+    auto hash = HashValue(0xcbf29ce484222325ull, OrmTextureFormat);
+
+    for(auto c=0; c<ORM_CHANNEL_COUNT; ++c)
+    {
+        auto& path = sources.Paths[c];
+
+        // 区切りを入れて, 同じ文字列が別のチャンネルに入っている場合と区別する.
+        hash = HashValue(hash, c);
+        for(auto ch : path)
+        { hash = HashValue(hash, uint64_t(ch)); }
+
+        if (base.empty() && !path.empty())
+        {
+            auto sep = path.find_last_of(L"/\\");
+            base = (sep != std::wstring::npos) ? path.substr(0, sep + 1) : L"./";
+        }
+    }
+
+    if (base.empty())
+    { return std::wstring(); }
+
+    wchar_t name[64];
+    swprintf_s(name, L"orm_%016llx.dds", static_cast<unsigned long long>(hash));
+    return base + name;
+}
+
+//-----------------------------------------------------------------------------
+//      ORM テクスチャを用意します.
+//-----------------------------------------------------------------------------
+bool PrepareOrmTexture
+(
+    const OrmSourcePaths&   sources,
+    std::wstring&           result,
+    BcCompressStats*        pStats
+)
+{
+    result.clear();
+
+    // 見つからない入力は無いものとして扱う.
+    OrmSourcePaths resolved;
+    for(auto c=0; c<ORM_CHANNEL_COUNT; ++c)
+    {
+        if (sources.Paths[c].empty())
+        { continue; }
+
+        if (!SearchFilePathW(sources.Paths[c].c_str(), resolved.Paths[c]))
+        {
+            DLOG( "Warning : ORM Source Not Found. path = %ls", sources.Paths[c].c_str() );
+            resolved.Paths[c].clear();
+        }
+    }
+
+    auto cachePath = GetOrmCachePath(resolved);
+    if (cachePath.empty())
+    { return false; }
+
+    // すべての入力より新しいキャッシュがあればそれを使う.
+    FILETIME cacheTime = {};
+    auto upToDate = GetLastWriteTime(cachePath, cacheTime);
+    for(auto c=0; c<ORM_CHANNEL_COUNT && upToDate; ++c)
+    {
+        FILETIME sourceTime = {};
+        if (!resolved.Paths[c].empty())
+        { upToDate = GetLastWriteTime(resolved.Paths[c], sourceTime) && CompareFileTime(&cacheTime, &sourceTime) >= 0; }
+    }
+    if (upToDate)
+    {
+        result = cachePath;
+        return true;
+    }
+
+    std::vector<uint8_t> pixels[ORM_CHANNEL_COUNT];
+    OrmSourceImage images[ORM_CHANNEL_COUNT];
+    for(auto c=0; c<ORM_CHANNEL_COUNT; ++c)
+    {
+        if (resolved.Paths[c].empty())
+        { continue; }
+
+        if (!LoadTextureRGBA8(resolved.Paths[c].c_str(), images[c].Width, images[c].Height, pixels[c]))
+        {
+            DLOG( "Warning : ORM Source Load Failed. path = %ls", resolved.Paths[c].c_str() );
+            continue;
+        }
+
+        // 1チャンネルのマップは R に入っている.
+        images[c].pPixels = pixels[c].data();
+        images[c].Channel = 0;
+    }
+
+    uint32_t width  = 0;
+    uint32_t height = 0;
+    std::vector<uint8_t> packed;
+    if (!PackOrmImage(images, width, height, packed))
+    { return false; }
+
+    // ORM はリニアな値なので, ミップはそのまま平均する.
+    BcCompressDesc desc;
+    desc.Format = OrmTextureFormat;
+    desc.Type   = BC_TEXTURE_MASK;
+
+    BcCompressStats stats;
+    if (!CompressTexture(packed.data(), width, height, size_t(width) * 4, desc, cachePath.c_str(), &stats))
+    { return false; }
+
+    DLOG( "ORM : packed texture. path = %ls, %ux%u, PSNR = %.2f dB, %llu bytes",
+        cachePath.c_str(), width, height, stats.Psnr, (unsigned long long)stats.CompressedBytes );
+
+    if (pStats != nullptr)
+    { *pStats = stats; }
+
+    result = cachePath;
+
+    // 正常終了.
+    return true;
+}
@@ -0,0 +1,247 @@
+﻿//-----------------------------------------------------------------------------
+// File : PackedVertex.cpp
+// Desc : Packed Vertex Module.
+// Copyright(c) Pocol. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include "PackedVertex.h"
+#include <DirectXPackedVector.h>
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+constexpr float UnormMax        = 65535.0f;
+constexpr float SnormMax        = 32767.0f;
+constexpr float OctahedralError = 1e-4f;    // 16bit 八面体エンコードの最大角度誤差(実測 6.5e-5 rad に余裕を持たせた値).
+
+//-----------------------------------------------------------------------------
+//      符号を求めます(0 は正として扱います).
+//-----------------------------------------------------------------------------
+inline float SignNotZero(float value)
+{ return (value >= 0.0f) ? 1.0f : -1.0f; }
+
+//-----------------------------------------------------------------------------
+//      [-1, 1] を SNORM に変換します.
+//-----------------------------------------------------------------------------
+inline int16_t ToSnorm(float value)
+{
+    value = std::min(std::max(value, -1.0f), 1.0f);
+    return int16_t(lroundf(value * SnormMax));
+}
+
+//-----------------------------------------------------------------------------
+//      SNORM を [-1, 1] に変換します (D3D の変換規則と同じく -32768 は -1 に丸めます).
+//-----------------------------------------------------------------------------
+inline float FromSnorm(int16_t value)
+{ return std::max(float(value) / SnormMax, -1.0f); }
+
+//-----------------------------------------------------------------------------
+//      単位ベクトルを八面体エンコードします.
+//-----------------------------------------------------------------------------
+void EncodeOctahedral(const DirectX::XMFLOAT3& v, int16_t* pResult)
+{
+    auto len = fabsf(v.x) + fabsf(v.y) + fabsf(v.z);
+    if (len <= 0.0f)
+    {
+        // ゼロベクトルは +Z として扱う.
+        pResult[0] = 0;
+        pResult[1] = 0;
+        return;
+    }
+
+    auto x = v.x / len;
+    auto y = v.y / len;
+    if (v.z < 0.0f)
+    {
+        auto ox = (1.0f - fabsf(y)) * SignNotZero(x);
+        auto oy = (1.0f - fabsf(x)) * SignNotZero(y);
+        x = ox;
+        y = oy;
+    }
+
+    pResult[0] = ToSnorm(x);
+    pResult[1] = ToSnorm(y);
+}
+
+//-----------------------------------------------------------------------------
+//      八面体エンコードされたベクトルを復元します.
+//-----------------------------------------------------------------------------
+DirectX::XMFLOAT3 DecodeOctahedral(const int16_t* pValue)
+{
+    auto x = FromSnorm(pValue[0]);
+    auto y = FromSnorm(pValue[1]);
+    auto z = 1.0f - fabsf(x) - fabsf(y);
+    if (z < 0.0f)
+    {
+        auto ox = (1.0f - fabsf(y)) * SignNotZero(x);
+        auto oy = (1.0f - fabsf(x)) * SignNotZero(y);
+        x = ox;
+        y = oy;
+    }
+
+    auto inv = 1.0f / sqrtf(x * x + y * y + z * z);
+    return DirectX::XMFLOAT3(x * inv, y * inv, z * inv);
+}
+
+//-----------------------------------------------------------------------------
+//      AABB 内の位置を UNORM に量子化します.
+//-----------------------------------------------------------------------------
+inline uint16_t Quantize(float value, float offset, float scale)
+{
+    if (scale <= 0.0f)
+    { return 0; }
+
+    auto q = (value - offset) / scale;
+    return uint16_t(lroundf(std::min(std::max(q, 0.0f), UnormMax)));
+}
+
+} // namespace
+
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+const D3D12_INPUT_ELEMENT_DESC PackedVertex::InputElements[] = {
+    { "POSITION", 0, DXGI_FORMAT_R16G16B16A16_UNORM, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+    { "NORMAL",   0, DXGI_FORMAT_R16G16_SNORM,       0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+    { "TANGENT",  0, DXGI_FORMAT_R16G16_SNORM,       0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+    { "TEXCOORD", 0, DXGI_FORMAT_R16G16_FLOAT,       0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
+};
+const D3D12_INPUT_LAYOUT_DESC PackedVertex::InputLayout = { PackedVertex::InputElements, PackedVertex::InputElementCount };
+static_assert(sizeof(PackedVertex) == 20, "Vertex struct/layout mismatch");
+
+
+//-----------------------------------------------------------------------------
+//      量子化パラメータを求めます.
+//-----------------------------------------------------------------------------
+PackedVertexQuantization ComputeQuantization(const std::vector<MeshVertex>& vertices)
+{
+    PackedVertexQuantization result = {};
+    if (vertices.empty())
+    { return result; }
+
+    DirectX::XMFLOAT3 boxMin( FLT_MAX,  FLT_MAX,  FLT_MAX);
+    DirectX::XMFLOAT3 boxMax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+    for(auto& vertex : vertices)
+    {
+        boxMin.x = std::min(boxMin.x, vertex.Position.x);
+        boxMin.y = std::min(boxMin.y, vertex.Position.y);
+        boxMin.z = std::min(boxMin.z, vertex.Position.z);
+        boxMax.x = std::max(boxMax.x, vertex.Position.x);
+        boxMax.y = std::max(boxMax.y, vertex.Position.y);
+        boxMax.z = std::max(boxMax.z, vertex.Position.z);
+    }
+
+    result.Offset = boxMin;
+    result.Scale  = DirectX::XMFLOAT3(
+        (boxMax.x - boxMin.x) / UnormMax,
+        (boxMax.y - boxMin.y) / UnormMax,
+        (boxMax.z - boxMin.z) / UnormMax);
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+//      頂点を圧縮します.
+//-----------------------------------------------------------------------------
+PackedVertex EncodeVertex
+(
+    const MeshVertex&               vertex,
+    const PackedVertexQuantization& quantization,
+    float                           tangentSign
+)
+{
+    PackedVertex result;
+    result.Position[0] = Quantize(vertex.Position.x, quantization.Offset.x, quantization.Scale.x);
+    result.Position[1] = Quantize(vertex.Position.y, quantization.Offset.y, quantization.Scale.y);
+    result.Position[2] = Quantize(vertex.Position.z, quantization.Offset.z, quantization.Scale.z);
+    result.Position[3] = (tangentSign < 0.0f) ? 0 : uint16_t(UnormMax);
+
+    EncodeOctahedral(vertex.Normal,  result.Normal);
+    EncodeOctahedral(vertex.Tangent, result.Tangent);
+
+    result.TexCoord[0] = DirectX::PackedVector::XMConvertFloatToHalf(vertex.TexCoord.x);
+    result.TexCoord[1] = DirectX::PackedVector::XMConvertFloatToHalf(vertex.TexCoord.y);
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+//      頂点を復元します.
+//-----------------------------------------------------------------------------
+MeshVertex DecodeVertex
+(
+    const PackedVertex&             vertex,
+    const PackedVertexQuantization& quantization,
+    float*                          pTangentSign
+)
+{
+    MeshVertex result;
+    result.Position = DirectX::XMFLOAT3(
+        quantization.Offset.x + float(vertex.Position[0]) * quantization.Scale.x,
+        quantization.Offset.y + float(vertex.Position[1]) * quantization.Scale.y,
+        quantization.Offset.z + float(vertex.Position[2]) * quantization.Scale.z);
+    result.Normal   = DecodeOctahedral(vertex.Normal);
+    result.Tangent  = DecodeOctahedral(vertex.Tangent);
+    result.TexCoord = DirectX::XMFLOAT2(
+        DirectX::PackedVector::XMConvertHalfToFloat(vertex.TexCoord[0]),
+        DirectX::PackedVector::XMConvertHalfToFloat(vertex.TexCoord[1]));
+
+    if (pTangentSign != nullptr)
+    { *pTangentSign = (vertex.Position[3] >= 32768) ? 1.0f : -1.0f; }
+
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+//      メッシュの頂点をまとめて圧縮します.
+//-----------------------------------------------------------------------------
+void PackVertices
+(
+    const std::vector<MeshVertex>&  vertices,
+    std::vector<PackedVertex>&      packed,
+    PackedVertexQuantization&       quantization
+)
+{
+    quantization = ComputeQuantization(vertices);
+
+    packed.resize(vertices.size());
+    for(size_t i=0; i<vertices.size(); ++i)
+    { packed[i] = EncodeVertex(vertices[i], quantization); }
+}
+
+//-----------------------------------------------------------------------------
+//      圧縮による最大誤差を求めます.
+//-----------------------------------------------------------------------------
+PackedVertexError GetPackedVertexError
+(
+    const PackedVertexQuantization& quantization,
+    float                           maxTexCoord
+)
+{
+    PackedVertexError result;
+
+    // 位置は量子化ステップの半分 (+ 復元時の浮動小数点誤差).
+    auto offsetUlp = [](float offset, float scale)
+    { return (fabsf(offset) + scale * UnormMax) * FLT_EPSILON; };
+
+    result.Position = DirectX::XMFLOAT3(
+        quantization.Scale.x * 0.5f + offsetUlp(quantization.Offset.x, quantization.Scale.x),
+        quantization.Scale.y * 0.5f + offsetUlp(quantization.Offset.y, quantization.Scale.y),
+        quantization.Scale.z * 0.5f + offsetUlp(quantization.Offset.z, quantization.Scale.z));
+
+    result.Direction = OctahedralError;
+
+    // 半精度は仮数部 10bit なので, [2^e, 2^(e+1)) の値の誤差は 2^(e-11) 以下です.
+    int exponent = 0;
+    frexpf(std::max(fabsf(maxTexCoord), 6.1035156e-05f), &exponent);
+    result.TexCoord = ldexpf(1.0f, exponent - 12);
+
+    return result;
+}
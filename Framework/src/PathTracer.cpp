@@ -0,0 +1,633 @@
+﻿//-----------------------------------------------------------------------------
+// File : PathTracer.cpp
+// Desc : CPU Reference Path Tracer Module.
+// Copyright(c) Pocol. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include "PathTracer.h"
+#include "BRDF.h"
+#include "ParallelUtil.h"
+#include "Logger.h"
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <thread>
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+constexpr float     SamplePI        = 3.14159265358979f;   // サンプリング確率密度用の円周率です.
+constexpr uint32_t  RouletteBounce  = 3;                    // ロシアンルーレットを開始する反射回数です.
+constexpr float     RayEpsilon      = 1e-4f;                // 自己交差を避けるためのオフセットです.
+
+///////////////////////////////////////////////////////////////////////////////
+// Vec3 structure
+///////////////////////////////////////////////////////////////////////////////
+struct Vec3
+{
+    float x, y, z;
+
+    Vec3() = default;
+    Vec3(float x_, float y_, float z_) : x(x_), y(y_), z(z_) { /* DO_NOTHING */ }
+    Vec3(const DirectX::XMFLOAT3& v) : x(v.x), y(v.y), z(v.z) { /* DO_NOTHING */ }
+
+    operator DirectX::XMFLOAT3 () const
+    { return DirectX::XMFLOAT3(x, y, z); }
+
+    Vec3 operator + (const Vec3& v) const { return Vec3(x + v.x, y + v.y, z + v.z); }
+    Vec3 operator - (const Vec3& v) const { return Vec3(x - v.x, y - v.y, z - v.z); }
+    Vec3 operator * (const Vec3& v) const { return Vec3(x * v.x, y * v.y, z * v.z); }
+    Vec3 operator * (float s)       const { return Vec3(x * s, y * s, z * s); }
+    Vec3 operator - ()              const { return Vec3(-x, -y, -z); }
+
+    Vec3& operator += (const Vec3& v) { x += v.x; y += v.y; z += v.z; return *this; }
+    Vec3& operator *= (const Vec3& v) { x *= v.x; y *= v.y; z *= v.z; return *this; }
+    Vec3& operator *= (float s)       { x *= s;   y *= s;   z *= s;   return *this; }
+
+    float operator [] (int i) const { return (&x)[i]; }
+};
+
+inline float Dot(const Vec3& a, const Vec3& b)
+{ return a.x * b.x + a.y * b.y + a.z * b.z; }
+
+inline Vec3 Cross(const Vec3& a, const Vec3& b)
+{ return Vec3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x); }
+
+inline Vec3 Normalize(const Vec3& v)
+{
+    auto len = sqrtf(Dot(v, v));
+    return (len > 0.0f) ? v * (1.0f / len) : v;
+}
+
+inline float Saturate(float value)
+{ return std::min(std::max(value, 0.0f), 1.0f); }
+
+///////////////////////////////////////////////////////////////////////////////
+// Random class (PCG32)
+///////////////////////////////////////////////////////////////////////////////
+class Random
+{
+public:
+    Random(uint64_t seed, uint64_t sequence)
+    : m_State   (0)
+    , m_Inc     ((sequence << 1u) | 1u)
+    {
+        Next();
+        m_State += seed;
+        Next();
+    }
+
+    uint32_t Next()
+    {
+        auto old = m_State;
+        m_State = old * 6364136223846793005ULL + m_Inc;
+        auto xorshifted = uint32_t(((old >> 18u) ^ old) >> 27u);
+        auto rot        = uint32_t(old >> 59u);
+        return (xorshifted >> rot) | (xorshifted << ((~rot + 1u) & 31));
+    }
+
+    // [0, 1) の一様乱数を返却します.
+    float NextFloat()
+    { return float(Next() >> 8) * (1.0f / 16777216.0f); }
+
+private:
+    uint64_t    m_State;
+    uint64_t    m_Inc;
+};
+
+//-----------------------------------------------------------------------------
+//      法線から正規直交基底を求めます.
+//-----------------------------------------------------------------------------
+void CalcBasis(const Vec3& n, Vec3& t, Vec3& b)
+{
+    // Duff et al. "Building an Orthonormal Basis, Revisited"
+    auto sign = copysignf(1.0f, n.z);
+    auto a    = -1.0f / (sign + n.z);
+    auto c    = n.x * n.y * a;
+    t = Vec3(1.0f + sign * n.x * n.x * a, sign * c, -sign * n.x);
+    b = Vec3(c, sign + n.y * n.y * a, -n.y);
+}
+
+//-----------------------------------------------------------------------------
+//      マテリアルを変換します.
+//-----------------------------------------------------------------------------
+PathTracerMaterial ConvertMaterial(const ResMaterial& src)
+{
+    // テクスチャは参照せず, 定数値のみで近似します.
+    // Blinn-Phong の鏡面反射強度から GGX のラフネスへ変換 (a = sqrt(2 / (s + 2))).
+    PathTracerMaterial dst;
+    dst.BaseColor = src.Diffuse;
+    dst.Roughness = std::min(std::max(sqrtf(sqrtf(2.0f / (src.Shininess + 2.0f))), 0.05f), 1.0f);
+    dst.Metallic  = 0.0f;
+    return dst;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// SurfaceBRDF structure
+///////////////////////////////////////////////////////////////////////////////
+struct SurfaceBRDF
+{
+    Vec3    Kd;         //!< 拡散反射色です.
+    Vec3    F0;         //!< 垂直入射時のフレネル反射率です.
+    float   m2;         //!< GGX のパラメータ (α^2) です.
+    float   SpecProb;   //!< 鏡面反射をサンプリングする確率です.
+
+    explicit SurfaceBRDF(const PathTracerMaterial& material)
+    {
+        Vec3 base(material.BaseColor);
+        auto a = material.Roughness * material.Roughness;
+        Kd = base * (1.0f - material.Metallic);
+        F0 = Vec3(0.04f, 0.04f, 0.04f) * (1.0f - material.Metallic) + base * material.Metallic;
+        m2 = std::max(a * a, 1e-6f);
+        SpecProb = std::min(0.5f + 0.5f * material.Metallic, 0.9f);
+    }
+
+    // GGXPS.hlsl と同じ式で評価します.
+    Vec3 Evaluate(const Vec3& N, const Vec3& V, const Vec3& L) const
+    {
+        auto H  = Normalize(V + L);
+        auto NV = Saturate(Dot(N, V));
+        auto NH = Saturate(Dot(N, H));
+        auto NL = Saturate(Dot(N, L));
+        auto VH = Saturate(Dot(V, H));
+
+        auto diffuse = Kd * (1.0f / F_PI);
+
+        auto D  = D_GGX(m2, NH);
+        auto G2 = G2_Smith(NL, NV, m2);
+        Vec3 Fr = SchlickFresnel(F0, VH);
+
+        auto specular = Fr * (D * G2 / std::max(4.0f * NV * NL, 0.001f));
+        return diffuse + specular;
+    }
+
+    // 拡散反射と GGX 分布の混合確率密度です.
+    float Pdf(const Vec3& N, const Vec3& V, const Vec3& L) const
+    {
+        auto H  = Normalize(V + L);
+        auto NH = Saturate(Dot(N, H));
+        auto NL = Saturate(Dot(N, L));
+        auto VH = std::max(Dot(V, H), 1e-6f);
+
+        auto pdfSpec = D_GGX(m2, NH) * NH / (4.0f * VH);
+        auto pdfDiff = NL / SamplePI;
+        return SpecProb * pdfSpec + (1.0f - SpecProb) * pdfDiff;
+    }
+
+    // 次の方向をサンプリングします.
+    Vec3 Sample(const Vec3& N, const Vec3& V, Random& random) const
+    {
+        Vec3 T, B;
+        CalcBasis(N, T, B);
+
+        auto u0 = random.NextFloat();
+        auto u1 = random.NextFloat();
+        auto u2 = random.NextFloat();
+        auto phi = 2.0f * SamplePI * u1;
+
+        if (u0 < SpecProb)
+        {
+            // GGX 分布に従ってハーフベクトルをサンプリング.
+            auto cosTheta = sqrtf((1.0f - u2) / (1.0f + (m2 - 1.0f) * u2));
+            auto sinTheta = sqrtf(std::max(1.0f - cosTheta * cosTheta, 0.0f));
+            auto H = T * (sinTheta * cosf(phi)) + B * (sinTheta * sinf(phi)) + N * cosTheta;
+            return H * (2.0f * Dot(V, H)) - V;
+        }
+
+        // コサイン重み付きでサンプリング.
+        auto r = sqrtf(u2);
+        return T * (r * cosf(phi)) + B * (r * sinf(phi)) + N * sqrtf(std::max(1.0f - u2, 0.0f));
+    }
+};
+
+//-----------------------------------------------------------------------------
+//      RGBE形式に変換します.
+//-----------------------------------------------------------------------------
+void ToRGBE(const DirectX::XMFLOAT3& color, uint8_t* rgbe)
+{
+    auto v = std::max(color.x, std::max(color.y, color.z));
+    if (!(v > 1e-32f))
+    {
+        rgbe[0] = rgbe[1] = rgbe[2] = rgbe[3] = 0;
+        return;
+    }
+
+    int e = 0;
+    auto scale = frexpf(v, &e) * 256.0f / v;
+    rgbe[0] = uint8_t(std::max(color.x, 0.0f) * scale);
+    rgbe[1] = uint8_t(std::max(color.y, 0.0f) * scale);
+    rgbe[2] = uint8_t(std::max(color.z, 0.0f) * scale);
+    rgbe[3] = uint8_t(e + 128);
+}
+
+} // namespace
+
+
+///////////////////////////////////////////////////////////////////////////////
+// PathTracer class
+///////////////////////////////////////////////////////////////////////////////
+
+//-----------------------------------------------------------------------------
+//      コンストラクタです.
+//-----------------------------------------------------------------------------
+PathTracer::PathTracer()
+{ /* DO_NOTHING */ }
+
+//-----------------------------------------------------------------------------
+//      デストラクタです.
+//-----------------------------------------------------------------------------
+PathTracer::~PathTracer()
+{ Term(); }
+
+//-----------------------------------------------------------------------------
+//      初期化処理を行います.
+//-----------------------------------------------------------------------------
+bool PathTracer::Init
+(
+    const std::vector<ResMesh>&     meshes,
+    const std::vector<ResMaterial>& materials
+)
+{
+    Term();
+
+    size_t count = 0;
+    for(auto& mesh : meshes)
+    { count += mesh.Indices.size() / 3; }
+
+    if (count == 0)
+    {
+        ELOG( "Error : Invalid Argument." );
+        return false;
+    }
+
+    // マテリアルを変換.
+    m_Materials.resize(materials.size());
+    for(size_t i=0; i<materials.size(); ++i)
+    { m_Materials[i] = ConvertMaterial(materials[i]); }
+
+    // マテリアルが無い場合に備えて既定値を追加しておく.
+    PathTracerMaterial defaultMaterial = { DirectX::XMFLOAT3(0.5f, 0.5f, 0.5f), 0.5f, 0.0f };
+    auto defaultId = uint32_t(m_Materials.size());
+    m_Materials.push_back(defaultMaterial);
+
+    // 三角形を展開.
+    m_Triangles.reserve(count);
+    for(auto& mesh : meshes)
+    {
+        auto materialId = (mesh.MaterialId < defaultId) ? mesh.MaterialId : defaultId;
+
+        for(size_t i=0; i + 2<mesh.Indices.size(); i+=3)
+        {
+            auto i0 = mesh.Indices[i + 0];
+            auto i1 = mesh.Indices[i + 1];
+            auto i2 = mesh.Indices[i + 2];
+            // 不正な三角形も BVH の三角形番号と揃えるために縮退三角形として残します.
+            if (i0 >= mesh.Vertices.size() || i1 >= mesh.Vertices.size() || i2 >= mesh.Vertices.size())
+            {
+                m_Triangles.push_back(Triangle());
+                continue;
+            }
+
+            auto& v0 = mesh.Vertices[i0];
+            auto& v1 = mesh.Vertices[i1];
+            auto& v2 = mesh.Vertices[i2];
+
+            Triangle tri;
+            tri.P0          = v0.Position;
+            tri.E1          = Vec3(v1.Position) - Vec3(v0.Position);
+            tri.E2          = Vec3(v2.Position) - Vec3(v0.Position);
+            tri.N0          = v0.Normal;
+            tri.N1          = v1.Normal;
+            tri.N2          = v2.Normal;
+            tri.MaterialId  = materialId;
+            m_Triangles.push_back(tri);
+        }
+    }
+
+    if (!m_BVH.Init(meshes))
+    {
+        ELOG( "Error : BVH::Init() Failed." );
+        return false;
+    }
+
+    // 正常終了.
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      終了処理を行います.
+//-----------------------------------------------------------------------------
+void PathTracer::Term()
+{
+    m_BVH      .Term();
+    m_Triangles.clear();
+    m_Materials.clear();
+}
+
+//-----------------------------------------------------------------------------
+//      マテリアルを上書きします.
+//-----------------------------------------------------------------------------
+bool PathTracer::SetMaterial(size_t index, const PathTracerMaterial& material)
+{
+    if (index >= m_Materials.size())
+    { return false; }
+
+    m_Materials[index] = material;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      三角形数を取得します.
+//-----------------------------------------------------------------------------
+size_t PathTracer::GetTriangleCount() const
+{ return m_BVH.GetPrimitiveCount(); }
+
+//-----------------------------------------------------------------------------
+//      最近接交差を求めます.
+//-----------------------------------------------------------------------------
+bool PathTracer::Intersect
+(
+    const DirectX::XMFLOAT3&    origin,
+    const DirectX::XMFLOAT3&    dir,
+    float                       tmax,
+    HitRecord&                  hit
+) const
+{
+    BVHRay ray;
+    ray.Origin      = origin;
+    ray.TMin        = 0.0f;
+    ray.Direction   = dir;
+    ray.TMax        = tmax;
+
+    BVHHit result;
+    if (!m_BVH.Intersect(ray, result))
+    { return false; }
+
+    hit.Distance    = result.Distance;
+    hit.U           = result.U;
+    hit.V           = result.V;
+    hit.TriangleId  = result.PrimitiveId;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      遮蔽されているかどうかチェックします.
+//-----------------------------------------------------------------------------
+bool PathTracer::Occluded
+(
+    const DirectX::XMFLOAT3&    origin,
+    const DirectX::XMFLOAT3&    dir,
+    float                       tmax
+) const
+{
+    BVHRay ray;
+    ray.Origin      = origin;
+    ray.TMin        = 0.0f;
+    ray.Direction   = dir;
+    ray.TMax        = tmax;
+
+    return m_BVH.Occluded(ray);
+}
+
+//-----------------------------------------------------------------------------
+//      レンダリングを行います.
+//-----------------------------------------------------------------------------
+bool PathTracer::Render
+(
+    const PathTracerDesc&           desc,
+    std::vector<DirectX::XMFLOAT3>& pixels
+) const
+{
+    if (desc.Width == 0 || desc.Height == 0 || desc.SampleCount == 0 || m_BVH.GetNodeCount() == 0)
+    {
+        ELOG( "Error : Invalid Argument." );
+        return false;
+    }
+
+    pixels.resize(size_t(desc.Width) * desc.Height);
+
+    // カメラの基底を求める (右手座標系).
+    Vec3 eye(desc.Camera.Position);
+    auto front = Normalize(Vec3(desc.Camera.Target) - eye);
+    auto right = Normalize(Cross(front, Vec3(desc.Camera.Upward)));
+    auto upper = Cross(right, front);
+
+    auto tanY = tanf(desc.Camera.FovY * 0.5f);
+    auto tanX = tanY * float(desc.Width) / float(desc.Height);
+
+    Vec3 lightPos(desc.Light.Position);
+    auto lightRadiance = Vec3(desc.Light.Color) * desc.Light.Intensity;
+    Vec3 sky(desc.SkyColor);
+
+    // 1パスの放射輝度を求めます.
+    auto trace = [&](Vec3 origin, Vec3 dir, Random& random)
+    {
+        Vec3 radiance  (0.0f, 0.0f, 0.0f);
+        Vec3 throughput(1.0f, 1.0f, 1.0f);
+
+        for(auto bounce=0u; bounce<=desc.MaxBounce; ++bounce)
+        {
+            HitRecord hit;
+            if (!Intersect(origin, dir, FLT_MAX, hit))
+            {
+                radiance += throughput * sky;
+                break;
+            }
+
+            auto& tri = m_Triangles[hit.TriangleId];
+            auto w = 1.0f - hit.U - hit.V;
+            auto pos = origin + dir * hit.Distance;
+            auto Ng  = Normalize(Cross(Vec3(tri.E1), Vec3(tri.E2)));
+            auto Ns  = Normalize(Vec3(tri.N0) * w + Vec3(tri.N1) * hit.U + Vec3(tri.N2) * hit.V);
+            auto V   = -dir;
+
+            // 両面として扱います.
+            if (Dot(Ng, V) < 0.0f)
+            { Ng = -Ng; }
+            if (Dot(Ns, Ng) < 0.0f)
+            { Ns = -Ns; }
+
+            SurfaceBRDF brdf(m_Materials[tri.MaterialId]);
+            auto offset = RayEpsilon * std::max(1.0f, std::max(fabsf(pos.x), std::max(fabsf(pos.y), fabsf(pos.z))));
+            auto start  = pos + Ng * offset;
+
+            // 点光源を直接サンプリング (GGXPS.hlsl と同様に距離減衰はかけません).
+            {
+                auto toLight = lightPos - start;
+                auto dist    = sqrtf(Dot(toLight, toLight));
+                auto L       = toLight * (1.0f / dist);
+                auto NL      = Dot(Ns, L);
+                if (NL > 0.0f && Dot(Ng, L) > 0.0f && !Occluded(start, L, dist))
+                { radiance += throughput * brdf.Evaluate(Ns, V, L) * lightRadiance * NL; }
+            }
+
+            if (bounce == desc.MaxBounce)
+            { break; }
+
+            // 次の方向をサンプリング.
+            auto L  = Normalize(brdf.Sample(Ns, V, random));
+            auto NL = Dot(Ns, L);
+            if (NL <= 0.0f || Dot(Ng, L) <= 0.0f)
+            { break; }
+
+            auto pdf = brdf.Pdf(Ns, V, L);
+            if (!(pdf > 0.0f))
+            { break; }
+
+            throughput *= brdf.Evaluate(Ns, V, L) * (NL / pdf);
+
+            // ロシアンルーレット.
+            if (bounce >= RouletteBounce)
+            {
+                auto q = std::min(std::max(throughput.x, std::max(throughput.y, throughput.z)), 0.95f);
+                if (random.NextFloat() >= q)
+                { break; }
+                throughput *= 1.0f / q;
+            }
+
+            origin = start;
+            dir    = L;
+        }
+
+        return radiance;
+    };
+
+    // タイルを処理します.
+    auto tileSize   = (desc.TileSize > 0) ? desc.TileSize : 16;
+    auto tileCountX = (desc.Width  + tileSize - 1) / tileSize;
+    auto tileCountY = (desc.Height + tileSize - 1) / tileSize;
+    auto tileCount  = tileCountX * tileCountY;
+
+    auto renderTile = [&](uint32_t tile)
+    {
+        auto x0 = (tile % tileCountX) * tileSize;
+        auto y0 = (tile / tileCountX) * tileSize;
+        auto x1 = std::min(x0 + tileSize, desc.Width);
+        auto y1 = std::min(y0 + tileSize, desc.Height);
+
+        for(auto y=y0; y<y1; ++y)
+        {
+            for(auto x=x0; x<x1; ++x)
+            {
+                // ピクセル毎に乱数列を固定し, 実行順序に依存しない結果にします.
+                Random random(desc.Seed, uint64_t(y) * desc.Width + x);
+                Vec3 sum(0.0f, 0.0f, 0.0f);
+
+                for(auto s=0u; s<desc.SampleCount; ++s)
+                {
+                    auto sx = (2.0f * (float(x) + random.NextFloat()) / float(desc.Width)  - 1.0f) * tanX;
+                    auto sy = (1.0f - 2.0f * (float(y) + random.NextFloat()) / float(desc.Height)) * tanY;
+                    auto dir = Normalize(front + right * sx + upper * sy);
+                    sum += trace(eye, dir, random);
+                }
+
+                pixels[size_t(y) * desc.Width + x] = sum * (1.0f / float(desc.SampleCount));
+            }
+        }
+    };
+
+    // スレッド毎に連続したタイル範囲を割り当て, 自分の分が無くなったら他のスレッドから奪います.
+    struct TileQueue
+    {
+        std::atomic<uint32_t>   Next;
+        uint32_t                End;
+    };
+
+    auto threadCount = (desc.ThreadCount > 0) ? desc.ThreadCount : GetWorkerThreadCount();
+    threadCount = std::max(std::min(threadCount, tileCount), 1u);
+
+    std::unique_ptr<TileQueue[]> queues(new TileQueue[threadCount]);
+    for(auto i=0u; i<threadCount; ++i)
+    {
+        queues[i].Next.store(uint32_t(uint64_t(tileCount) * i / threadCount));
+        queues[i].End = uint32_t(uint64_t(tileCount) * (i + 1) / threadCount);
+    }
+
+    auto worker = [&](uint32_t id)
+    {
+        for(auto k=0u; k<threadCount; ++k)
+        {
+            auto& queue = queues[(id + k) % threadCount];
+            for(;;)
+            {
+                auto tile = queue.Next.fetch_add(1, std::memory_order_relaxed);
+                if (tile >= queue.End)
+                { break; }
+
+                renderTile(tile);
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(threadCount - 1);
+    for(auto i=1u; i<threadCount; ++i)
+    { threads.emplace_back(worker, i); }
+
+    worker(0);
+
+    for(auto& thread : threads)
+    { thread.join(); }
+
+    // 正常終了.
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      HDR画像を保存します.
+//-----------------------------------------------------------------------------
+bool SaveHDR
+(
+    const wchar_t*                          filename,
+    uint32_t                                width,
+    uint32_t                                height,
+    const std::vector<DirectX::XMFLOAT3>&   pixels
+)
+{
+    if (filename == nullptr || width == 0 || height == 0 || pixels.size() < size_t(width) * height)
+    {
+        ELOG( "Error : Invalid Argument." );
+        return false;
+    }
+
+    FILE* pFile = nullptr;
+    if (_wfopen_s(&pFile, filename, L"wb") != 0 || pFile == nullptr)
+    {
+        ELOG( "Error : File Open Failed. filename = %ls", filename );
+        return false;
+    }
+
+    // ヘッダを書き込み.
+    fprintf(pFile, "#?RADIANCE\n");
+    fprintf(pFile, "FORMAT=32-bit_rle_rgbe\n\n");
+    fprintf(pFile, "-Y %u +X %u\n", height, width);
+
+    // ランレングス圧縮は行わずにフラットなスキャンラインで書き出します.
+    std::vector<uint8_t> line(size_t(width) * 4);
+    for(auto y=0u; y<height; ++y)
+    {
+        for(auto x=0u; x<width; ++x)
+        { ToRGBE(pixels[size_t(y) * width + x], &line[size_t(x) * 4]); }
+
+        if (fwrite(line.data(), 1, line.size(), pFile) != line.size())
+        {
+            ELOG( "Error : File Write Failed. filename = %ls", filename );
+            fclose(pFile);
+            return false;
+        }
+    }
+
+    fclose(pFile);
+
+    // 正常終了.
+    return true;
+}
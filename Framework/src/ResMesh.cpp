@@ -8,11 +8,18 @@
 // Includes
 //-----------------------------------------------------------------------------
 #include "ResMesh.h"
+#include "MeshCache.h"
+#include "MeshOptimizer.h"
+#include "MeshletBuilder.h"
+#include "MeshSimplifier.h"
+#include "ParallelUtil.h"
+#include "Logger.h"
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 #include <assimp/cimport.h>
 #include <codecvt>
+#include <cstring>
 #include <cassert>
 
 
@@ -37,6 +44,94 @@ std::string ToUTF8(const std::wstring& value)
     return result;
 }
 
+//-----------------------------------------------------------------------------
+//      インポート時のポストプロセスフラグを取得します.
+//-----------------------------------------------------------------------------
+unsigned int GetImportFlags(bool preTransform)
+{
+    unsigned int flag = 0;
+    flag |= aiProcess_Triangulate;
+    if (preTransform)
+    { flag |= aiProcess_PreTransformVertices; }
+    flag |= aiProcess_CalcTangentSpace;
+    flag |= aiProcess_GenSmoothNormals;
+    flag |= aiProcess_GenUVCoords;
+    flag |= aiProcess_RemoveRedundantMaterials;
+    flag |= aiProcess_OptimizeMeshes;
+    return flag;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// LOAD_OPTION enum
+///////////////////////////////////////////////////////////////////////////////
+enum LOAD_OPTION
+{
+    LOAD_OPTION_OPTIMIZE  = 0x1,    //!< 頂点キャッシュ・オーバードロー最適化.
+    LOAD_OPTION_HIERARCHY = 0x2,    //!< ノード階層を保持.
+    LOAD_OPTION_MESHLET   = 0x4,    //!< メッシュレットを生成.
+    LOAD_OPTION_LOD       = 0x8,    //!< LOD チェインを生成.
+};
+
+//-----------------------------------------------------------------------------
+//      メッシュを最適化し, 最適化前後の統計を出力します.
+//-----------------------------------------------------------------------------
+void OptimizeMeshes(std::vector<ResMesh>& meshes)
+{
+    MeshOptimizeDesc desc;
+    std::vector<MeshOptimizeStats> stats(meshes.size());
+    std::vector<uint8_t>           result(meshes.size(), 0);
+
+    // メッシュ毎に独立しているので並列に処理します.
+    ParallelFor(meshes.size(), [&](size_t i)
+    { result[i] = OptimizeMesh(meshes[i], desc, &stats[i]) ? 1 : 0; });
+
+    for(size_t i=0; i<meshes.size(); ++i)
+    {
+        if (!result[i])
+        {
+            DLOG( "Warning : OptimizeMesh() Failed. index = %zu", i );
+            continue;
+        }
+
+        DLOG( "Mesh[%zu] ACMR : %.3f -> %.3f, ATVR : %.3f -> %.3f",
+            i, stats[i].ACMRBefore, stats[i].ACMRAfter, stats[i].ATVRBefore, stats[i].ATVRAfter );
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      LOD チェインを生成し, 各レベルの三角形数と誤差を出力します.
+//-----------------------------------------------------------------------------
+void GenerateLods(std::vector<ResMesh>& meshes)
+{
+    MeshLodDesc desc;
+    if (!BuildMeshLods(meshes, desc))
+    { DLOG( "Warning : BuildMeshLods() Failed." ); }
+
+    for(size_t i=0; i<meshes.size(); ++i)
+    {
+        for(size_t j=0; j<meshes[i].Lods.size(); ++j)
+        {
+            auto& lod = meshes[i].Lods[j];
+            DLOG( "Mesh[%zu] LOD%zu : triangles = %u, error = %f",
+                i, j + 1, lod.IndexCount / 3, lod.Error );
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      メッシュレットを生成し, 統計を出力します.
+//-----------------------------------------------------------------------------
+void GenerateMeshlets(std::vector<ResMesh>& meshes)
+{
+    MeshletDesc  desc;
+    MeshletStats stats = {};
+    if (!BuildMeshlets(meshes, desc, &stats))
+    { DLOG( "Warning : BuildMeshlets() Failed." ); }
+
+    DLOG( "Meshlet : count = %u, vertices = %u, triangles = %u, cones = %u",
+        stats.MeshletCount, stats.VertexCount, stats.TriangleCount, stats.ConeCount );
+}
+
 //-----------------------------------------------------------------------------
 //      std::wstring型に変換します.
 //-----------------------------------------------------------------------------
@@ -73,7 +168,9 @@ public:
     bool Load(
         const wchar_t*             filename,
         std::vector<ResMesh>&      meshes,
-        std::vector<ResMaterial>&  materials);
+        std::vector<ResMaterial>&  materials,
+        std::vector<ResNode>*      pNodes,
+        uint32_t                   threadCount = 0);
 
 private:
     //=========================================================================
@@ -86,6 +183,7 @@ private:
     //=========================================================================
     void ParseMesh(ResMesh& dstMesh, const aiMesh* pSrcMesh);
     void ParseMaterial(ResMaterial& dstMaterial, const aiMaterial* pSrcMaterial);
+    void ParseNodes(std::vector<ResNode>& dstNodes, const aiNode* pRootNode);
 };
 
 //-----------------------------------------------------------------------------
@@ -108,7 +206,9 @@ bool MeshLoader::Load
 (
     const wchar_t*             filename,
     std::vector<ResMesh>&      meshes,
-    std::vector<ResMaterial>&  materials
+    std::vector<ResMaterial>&  materials,
+    std::vector<ResNode>*      pNodes,
+    uint32_t                   threadCount
 )
 {
     if (filename == nullptr)
@@ -118,14 +218,7 @@ bool MeshLoader::Load
     auto path = ToUTF8(filename);
 
     Assimp::Importer importer;
-    unsigned int flag = 0;
-    flag |= aiProcess_Triangulate;
-    flag |= aiProcess_PreTransformVertices;
-    flag |= aiProcess_CalcTangentSpace;
-    flag |= aiProcess_GenSmoothNormals;
-    flag |= aiProcess_GenUVCoords;
-    flag |= aiProcess_RemoveRedundantMaterials;
-    flag |= aiProcess_OptimizeMeshes;
+    auto flag = GetImportFlags(pNodes == nullptr);
 
     // ファイルを読み込み.
     m_pScene = importer.ReadFile(path, flag);
@@ -134,27 +227,25 @@ bool MeshLoader::Load
     if (m_pScene == nullptr)
     { return false; }
 
-    // メッシュのメモリを確保.
+    // 出力先を先に確保しておき, 各スレッドは自分の要素だけに書き込みます.
     meshes.clear();
     meshes.resize(m_pScene->mNumMeshes);
 
-    // メッシュデータを変換.
-    for(size_t i=0; i<meshes.size(); ++i)
-    {
-        const auto pMesh = m_pScene->mMeshes[i];
-        ParseMesh(meshes[i], pMesh);
-    }
-
-    // マテリアルのメモリを確保.
     materials.clear();
     materials.resize(m_pScene->mNumMaterials);
 
-    // マテリアルデータを変換.
-    for(size_t i=0; i<materials.size(); ++i)
+    // メッシュとマテリアルは互いに独立しているのでまとめて並列に変換します.
+    auto meshCount = meshes.size();
+    ParallelFor(meshCount + materials.size(), [&](size_t i)
     {
-        const auto pMaterial = m_pScene->mMaterials[i];
-        ParseMaterial(materials[i], pMaterial);
-    }
+        if (i < meshCount)
+        { ParseMesh(meshes[i], m_pScene->mMeshes[i]); }
+        else
+        { ParseMaterial(materials[i - meshCount], m_pScene->mMaterials[i - meshCount]); }
+    }, threadCount);
+
+    if (pNodes != nullptr)
+    { ParseNodes(*pNodes, m_pScene->mRootNode); }
 
     // 不要になったのでクリア.
     importer.FreeScene();
@@ -172,37 +263,48 @@ void MeshLoader::ParseMesh(ResMesh& dstMesh, const aiMesh* pSrcMesh)
     // マテリアル番号を設定.
     dstMesh.MaterialId = pSrcMesh->mMaterialIndex;
 
-    aiVector3D zero3D(0.0f, 0.0f, 0.0f);
+    auto count = pSrcMesh->mNumVertices;
+
+    // 頂点データのメモリを確保 (ゼロ初期化されるので, 無い属性はそのままにします).
+    dstMesh.Vertices.resize(count);
+    auto pDst = dstMesh.Vertices.data();
 
-    // 頂点データのメモリを確保.
-    dstMesh.Vertices.resize(pSrcMesh->mNumVertices);
+    static_assert(sizeof(aiVector3D) == sizeof(DirectX::XMFLOAT3), "aiVector3D layout mismatch");
 
-    for(auto i=0u; i<pSrcMesh->mNumVertices; ++i)
+    // MeshVertex はインターリーブなので配列ごとの一括コピーはできません.
+    // 属性ごとに頂点配列を何度も走査しないよう, 1回の走査で全ての属性を詰めます.
+    auto pPosition = pSrcMesh->mVertices;
+    auto pNormal   = pSrcMesh->HasNormals()               ? pSrcMesh->mNormals          : nullptr;
+    auto pTexCoord = pSrcMesh->HasTextureCoords(0)        ? pSrcMesh->mTextureCoords[0] : nullptr;
+    auto pTangent  = pSrcMesh->HasTangentsAndBitangents() ? pSrcMesh->mTangents         : nullptr;
+
+    for(auto i=0u; i<count; ++i)
     {
-        auto pPosition = &(pSrcMesh->mVertices[i]);
-        auto pNormal   = &(pSrcMesh->mNormals[i]);
-        auto pTexCoord = (pSrcMesh->HasTextureCoords(0)) ? &(pSrcMesh->mTextureCoords[0][i]) : &zero3D;
-        auto pTangent  = (pSrcMesh->HasTangentsAndBitangents()) ? &(pSrcMesh->mTangents[i]) : &zero3D;
-
-        dstMesh.Vertices[i] = MeshVertex(
-            DirectX::XMFLOAT3(pPosition->x, pPosition->y, pPosition->z),
-            DirectX::XMFLOAT3(pNormal  ->x, pNormal  ->y, pNormal  ->z),
-            DirectX::XMFLOAT2(pTexCoord->x, pTexCoord->y),
-            DirectX::XMFLOAT3(pTangent ->x, pTangent ->y, pTangent ->z)
-        );
+        auto& dst = pDst[i];
+        memcpy(&dst.Position, &pPosition[i], sizeof(DirectX::XMFLOAT3));
+
+        if (pNormal != nullptr)
+        { memcpy(&dst.Normal, &pNormal[i], sizeof(DirectX::XMFLOAT3)); }
+
+        if (pTexCoord != nullptr)
+        { memcpy(&dst.TexCoord, &pTexCoord[i], sizeof(DirectX::XMFLOAT2)); }
+
+        if (pTangent != nullptr)
+        { memcpy(&dst.Tangent, &pTangent[i], sizeof(DirectX::XMFLOAT3)); }
     }
 
     // 頂点インデックスのメモリを確保.
     dstMesh.Indices.resize(pSrcMesh->mNumFaces * 3);
+    auto pIndex = dstMesh.Indices.data();
 
     for(auto i=0u; i<pSrcMesh->mNumFaces; ++i)
     {
         const auto& face = pSrcMesh->mFaces[i];
         assert(face.mNumIndices == 3);  // 三角形化しているので必ず3になっている.
 
-        dstMesh.Indices[i * 3 + 0] = face.mIndices[0];
-        dstMesh.Indices[i * 3 + 1] = face.mIndices[1];
-        dstMesh.Indices[i * 3 + 2] = face.mIndices[2];
+        pIndex[i * 3 + 0] = face.mIndices[0];
+        pIndex[i * 3 + 1] = face.mIndices[1];
+        pIndex[i * 3 + 2] = face.mIndices[2];
     }
 }
 
@@ -298,6 +400,110 @@ void MeshLoader::ParseMaterial(ResMaterial& dstMaterial, const aiMaterial* pSrcM
     }
 }
 
+//-----------------------------------------------------------------------------
+//      ノード階層を解析します.
+//-----------------------------------------------------------------------------
+void MeshLoader::ParseNodes(std::vector<ResNode>& dstNodes, const aiNode* pRootNode)
+{
+    dstNodes.clear();
+    if (pRootNode == nullptr)
+    { return; }
+
+    // 幅優先で辿るので, 親ノードは必ず子ノードより前に並ぶ.
+    std::vector<const aiNode*> queue;
+    queue.push_back(pRootNode);
+    dstNodes.push_back(ResNode());
+    dstNodes.back().Parent = UINT32_MAX;
+
+    for(size_t i=0; i<queue.size(); ++i)
+    {
+        auto pSrcNode = queue[i];
+        auto& dstNode = dstNodes[i];
+
+        dstNode.Name = Convert(pSrcNode->mName);
+
+        // aiMatrix4x4 は列ベクトル形式なので, 転置して行ベクトル形式にする.
+        const auto& m = pSrcNode->mTransformation;
+        dstNode.Transform = DirectX::XMFLOAT4X4(
+            m.a1, m.b1, m.c1, m.d1,
+            m.a2, m.b2, m.c2, m.d2,
+            m.a3, m.b3, m.c3, m.d3,
+            m.a4, m.b4, m.c4, m.d4);
+
+        dstNode.Meshes.assign(pSrcNode->mMeshes, pSrcNode->mMeshes + pSrcNode->mNumMeshes);
+
+        for(auto j=0u; j<pSrcNode->mNumChildren; ++j)
+        {
+            queue.push_back(pSrcNode->mChildren[j]);
+
+            ResNode child;
+            child.Parent = uint32_t(i);
+            dstNodes.push_back(std::move(child));
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      メッシュをロードします. pNodes が nullptr の場合は頂点をワールド空間に変換します.
+//-----------------------------------------------------------------------------
+bool LoadMeshInternal
+(
+    const wchar_t*             filename,
+    std::vector<ResMesh>&      meshes,
+    std::vector<ResMaterial>&  materials,
+    std::vector<ResNode>*      pNodes,
+    bool                       optimize,
+    bool                       meshlet,
+    bool                       lod
+)
+{
+    if (filename == nullptr)
+    { return false; }
+
+    // 階層の有無でインポート結果が異なるので, キャッシュファイルも分けます.
+    auto hierarchy = (pNodes != nullptr);
+    auto source    = hierarchy ? std::wstring(filename) + L".node" : std::wstring(filename);
+
+    // キャッシュが有効であれば Assimp を経由せずにロードします.
+    MeshCacheKey key;
+    auto options   = (optimize  ? uint32_t(LOAD_OPTION_OPTIMIZE)  : 0u)
+                   | (hierarchy ? uint32_t(LOAD_OPTION_HIERARCHY) : 0u)
+                   | (meshlet   ? uint32_t(LOAD_OPTION_MESHLET)   : 0u)
+                   | (lod       ? uint32_t(LOAD_OPTION_LOD)       : 0u);
+    auto hasKey    = GetMeshCacheKey(filename, GetImportFlags(!hierarchy), options, key);
+    auto cachePath = GetMeshCachePath(source.c_str());
+
+    std::vector<ResNode> nodes;
+    if (hasKey && LoadMeshCache(cachePath.c_str(), key, meshes, materials, nodes))
+    {
+        if (pNodes != nullptr)
+        { *pNodes = std::move(nodes); }
+        return true;
+    }
+
+    if (!ImportMesh(filename, meshes, materials, pNodes))
+    { return false; }
+
+    // 最適化結果もキャッシュに含めるので, 次回以降はこの処理は走りません.
+    if (optimize)
+    { OptimizeMeshes(meshes); }
+
+    // 頂点の並べ替えが終わってから作らないと, LOD のインデックスが無効になります.
+    if (lod)
+    { GenerateLods(meshes); }
+
+    // 最適化後の三角形順で分割した方が, メッシュレット内の頂点の再利用が良くなります.
+    if (meshlet)
+    { GenerateMeshlets(meshes); }
+
+    // キャッシュの保存に失敗してもロード自体は成功扱いとします.
+    if (hasKey && !SaveMeshCache(cachePath.c_str(), key, meshes, materials, (pNodes != nullptr) ? *pNodes : nodes))
+    { DLOG( "Warning : SaveMeshCache() Failed. path = %ls", cachePath.c_str() ); }
+
+    // 正常終了.
+    return true;
+}
+
 } // namespace
 
 //-----------------------------------------------------------------------------
@@ -320,9 +526,40 @@ bool LoadMesh
 (
     const wchar_t*            filename,
     std::vector<ResMesh>&      meshes,
-    std::vector<ResMaterial>&  materials
+    std::vector<ResMaterial>&  materials,
+    bool                       optimize,
+    bool                       meshlet,
+    bool                       lod
+)
+{ return LoadMeshInternal(filename, meshes, materials, nullptr, optimize, meshlet, lod); }
+
+//-----------------------------------------------------------------------------
+//      ノード階層を保ったままメッシュをロードします.
+//-----------------------------------------------------------------------------
+bool LoadMesh
+(
+    const wchar_t*            filename,
+    std::vector<ResMesh>&      meshes,
+    std::vector<ResMaterial>&  materials,
+    std::vector<ResNode>&      nodes,
+    bool                       optimize,
+    bool                       meshlet,
+    bool                       lod
+)
+{ return LoadMeshInternal(filename, meshes, materials, &nodes, optimize, meshlet, lod); }
+
+//-----------------------------------------------------------------------------
+//      キャッシュを使わずにメッシュを読み込みます.
+//-----------------------------------------------------------------------------
+bool ImportMesh
+(
+    const wchar_t*             filename,
+    std::vector<ResMesh>&      meshes,
+    std::vector<ResMaterial>&  materials,
+    std::vector<ResNode>*      pNodes,
+    uint32_t                   threadCount
 )
 {
     MeshLoader loader;
-    return loader.Load(filename, meshes, materials);
+    return loader.Load(filename, meshes, materials, pNodes, threadCount);
 }
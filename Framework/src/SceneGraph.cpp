@@ -0,0 +1,312 @@
+﻿//-----------------------------------------------------------------------------
+// File : SceneGraph.cpp
+// Desc : Scene Graph Module.
+// Copyright(c) Pocol. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include "SceneGraph.h"
+#include "ParallelUtil.h"
+#include <algorithm>
+#include <cassert>
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+constexpr size_t kBatchSize = 1024;     // 並列更新時に1タスクで処理するノード数.
+
+} // namespace
+
+
+///////////////////////////////////////////////////////////////////////////////
+// SceneGraph class
+///////////////////////////////////////////////////////////////////////////////
+
+//-----------------------------------------------------------------------------
+//      コンストラクタです.
+//-----------------------------------------------------------------------------
+SceneGraph::SceneGraph()
+: m_NeedSort(false)
+{ /* DO_NOTHING */ }
+
+//-----------------------------------------------------------------------------
+//      デストラクタです.
+//-----------------------------------------------------------------------------
+SceneGraph::~SceneGraph()
+{ Clear(); }
+
+//-----------------------------------------------------------------------------
+//      全てのノードを削除します.
+//-----------------------------------------------------------------------------
+void SceneGraph::Clear()
+{
+    m_Local  .clear();
+    m_World  .clear();
+    m_Parent .clear();
+    m_Dirty  .clear();
+    m_Node   .clear();
+    m_Slot   .clear();
+    m_Depth  .clear();
+    m_Levels .clear();
+    m_Work   .clear();
+    m_Updated.clear();
+
+    m_NeedSort = false;
+}
+
+//-----------------------------------------------------------------------------
+//      メモリを予約します.
+//-----------------------------------------------------------------------------
+void SceneGraph::Reserve(uint32_t count)
+{
+    m_Local .reserve(count);
+    m_World .reserve(count);
+    m_Parent.reserve(count);
+    m_Dirty .reserve(count);
+    m_Node  .reserve(count);
+    m_Slot  .reserve(count);
+    m_Depth .reserve(count);
+}
+
+//-----------------------------------------------------------------------------
+//      ノードを追加します.
+//-----------------------------------------------------------------------------
+uint32_t SceneGraph::AddNode(uint32_t parent, const DirectX::XMMATRIX& local)
+{
+    if (parent != InvalidNode && parent >= GetCount())
+    { return InvalidNode; }
+
+    auto node = uint32_t(m_Slot.size());
+    auto slot = uint32_t(m_Local.size());
+
+    m_Local .push_back(local);
+    m_World .push_back(local);
+    m_Parent.push_back((parent != InvalidNode) ? m_Slot[parent] : InvalidNode);
+    m_Dirty .push_back(1);
+    m_Node  .push_back(node);
+    m_Slot  .push_back(slot);
+    m_Depth .push_back((parent != InvalidNode) ? m_Depth[parent] + 1 : 0);
+
+    // 深さごとの範囲を作り直す.
+    m_NeedSort = true;
+
+    return node;
+}
+
+//-----------------------------------------------------------------------------
+//      LoadMesh() で読み込んだノード階層を追加します.
+//-----------------------------------------------------------------------------
+uint32_t SceneGraph::AddNodes(const std::vector<ResNode>& nodes, uint32_t parent)
+{
+    if (parent != InvalidNode && parent >= GetCount())
+    { return InvalidNode; }
+
+    // 途中で失敗しないように先に確認しておく.
+    for(size_t i=0; i<nodes.size(); ++i)
+    {
+        if (nodes[i].Parent != UINT32_MAX && nodes[i].Parent >= i)
+        { return InvalidNode; }
+    }
+
+    auto first = GetCount();
+    Reserve(first + uint32_t(nodes.size()));
+
+    for(auto& node : nodes)
+    {
+        auto local = DirectX::XMLoadFloat4x4(&node.Transform);
+        AddNode((node.Parent != UINT32_MAX) ? first + node.Parent : parent, local);
+    }
+
+    return first;
+}
+
+//-----------------------------------------------------------------------------
+//      親ノードからの相対変換行列を設定します.
+//-----------------------------------------------------------------------------
+void SceneGraph::SetLocal(uint32_t node, const DirectX::XMMATRIX& local)
+{
+    assert(node < GetCount());
+    auto slot = m_Slot[node];
+    m_Local[slot] = local;
+    m_Dirty[slot] = 1;
+}
+
+//-----------------------------------------------------------------------------
+//      ダーティなノードのワールド行列を更新します.
+//-----------------------------------------------------------------------------
+uint32_t SceneGraph::Update()
+{
+    m_Updated.clear();
+
+    if (m_NeedSort)
+    { Sort(); }
+
+    auto count = uint32_t(m_Local.size());
+    if (count == 0)
+    { return 0; }
+
+    // 親は必ず前にあるので, 先頭から1回走査すれば子孫まで伝わる.
+    for(auto slot=m_Levels[1]; slot<count; ++slot)
+    {
+        if (!m_Dirty[slot] && m_Dirty[m_Parent[slot]])
+        { m_Dirty[slot] = 1; }
+    }
+
+    auto pLocal  = m_Local .data();
+    auto pWorld  = m_World .data();
+    auto pParent = m_Parent.data();
+
+    for(size_t depth=0; depth + 1<m_Levels.size(); ++depth)
+    {
+        m_Work.clear();
+        for(auto slot=m_Levels[depth]; slot<m_Levels[depth + 1]; ++slot)
+        {
+            if (m_Dirty[slot])
+            { m_Work.push_back(slot); }
+        }
+
+        if (m_Work.empty())
+        { continue; }
+
+        auto pWork = m_Work.data();
+        auto multiply = [&](size_t begin, size_t end)
+        {
+            if (depth == 0)
+            {
+                for(auto i=begin; i<end; ++i)
+                { pWorld[pWork[i]] = pLocal[pWork[i]]; }
+                return;
+            }
+
+            // 同じ深さのノードは互いに依存しないので, まとめて乗算する.
+            for(auto i=begin; i<end; ++i)
+            {
+                auto slot = pWork[i];
+                pWorld[slot] = DirectX::XMMatrixMultiply(pLocal[slot], pWorld[pParent[slot]]);
+            }
+        };
+
+        auto workCount = m_Work.size();
+        if (workCount >= ParallelThreshold)
+        {
+            auto batchCount = (workCount + kBatchSize - 1) / kBatchSize;
+            ParallelFor(batchCount, [&](size_t index)
+            { multiply(index * kBatchSize, std::min(workCount, (index + 1) * kBatchSize)); });
+        }
+        else
+        { multiply(0, workCount); }
+
+        for(auto slot : m_Work)
+        {
+            m_Dirty[slot] = 0;
+            m_Updated.push_back(m_Node[slot]);
+        }
+    }
+
+    return uint32_t(m_Updated.size());
+}
+
+//-----------------------------------------------------------------------------
+//      親ノードからの相対変換行列を取得します.
+//-----------------------------------------------------------------------------
+DirectX::XMMATRIX SceneGraph::GetLocal(uint32_t node) const
+{
+    assert(node < GetCount());
+    return m_Local[m_Slot[node]];
+}
+
+//-----------------------------------------------------------------------------
+//      ワールド行列を取得します.
+//-----------------------------------------------------------------------------
+DirectX::XMMATRIX SceneGraph::GetWorld(uint32_t node) const
+{
+    assert(node < GetCount());
+    return m_World[m_Slot[node]];
+}
+
+//-----------------------------------------------------------------------------
+//      親ノード番号を取得します.
+//-----------------------------------------------------------------------------
+uint32_t SceneGraph::GetParent(uint32_t node) const
+{
+    assert(node < GetCount());
+    auto parent = m_Parent[m_Slot[node]];
+    return (parent != InvalidNode) ? m_Node[parent] : InvalidNode;
+}
+
+//-----------------------------------------------------------------------------
+//      ノードの深さを取得します.
+//-----------------------------------------------------------------------------
+uint32_t SceneGraph::GetDepth(uint32_t node) const
+{
+    assert(node < GetCount());
+    return m_Depth[node];
+}
+
+//-----------------------------------------------------------------------------
+//      ノード数を取得します.
+//-----------------------------------------------------------------------------
+uint32_t SceneGraph::GetCount() const
+{ return uint32_t(m_Slot.size()); }
+
+//-----------------------------------------------------------------------------
+//      直前の Update() でワールド行列が更新されたノード番号を取得します.
+//-----------------------------------------------------------------------------
+const std::vector<uint32_t>& SceneGraph::GetUpdatedNodes() const
+{ return m_Updated; }
+
+//-----------------------------------------------------------------------------
+//      ノードを深さ順に並べ替えます.
+//-----------------------------------------------------------------------------
+void SceneGraph::Sort()
+{
+    auto count = uint32_t(m_Local.size());
+
+    // 深さごとの個数から開始位置を求める(計数ソート).
+    uint32_t maxDepth = 0;
+    for(auto depth : m_Depth)
+    { maxDepth = std::max(maxDepth, depth); }
+
+    m_Levels.assign(maxDepth + 2, 0);
+    for(auto depth : m_Depth)
+    { m_Levels[depth + 1]++; }
+    for(size_t i=1; i<m_Levels.size(); ++i)
+    { m_Levels[i] += m_Levels[i - 1]; }
+
+    // 同じ深さの中では元の順序を保つ.
+    std::vector<uint32_t> cursor(m_Levels.begin(), m_Levels.end() - 1);
+    std::vector<uint32_t> remap(count);
+    for(auto slot=0u; slot<count; ++slot)
+    { remap[slot] = cursor[m_Depth[m_Node[slot]]]++; }
+
+    std::vector<DirectX::XMMATRIX> local (count);
+    std::vector<DirectX::XMMATRIX> world (count);
+    std::vector<uint32_t>           parent(count);
+    std::vector<uint8_t>            dirty (count);
+    std::vector<uint32_t>           node  (count);
+
+    for(auto slot=0u; slot<count; ++slot)
+    {
+        auto dst = remap[slot];
+        local [dst] = m_Local[slot];
+        world [dst] = m_World[slot];
+        parent[dst] = (m_Parent[slot] != InvalidNode) ? remap[m_Parent[slot]] : InvalidNode;
+        dirty [dst] = m_Dirty[slot];
+        node  [dst] = m_Node [slot];
+
+        m_Slot[m_Node[slot]] = dst;
+    }
+
+    m_Local .swap(local);
+    m_World .swap(world);
+    m_Parent.swap(parent);
+    m_Dirty .swap(dirty);
+    m_Node  .swap(node);
+
+    m_NeedSort = false;
+}
@@ -0,0 +1,532 @@
+﻿//-----------------------------------------------------------------------------
+// File : ShaderCache.cpp
+// Desc : Shader Cache Module.
+// Copyright(c) Pocol. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include "ShaderCache.h"
+#include "ParallelUtil.h"
+#include "Logger.h"
+#include <cstring>
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+constexpr uint32_t CacheMagic       = 0x48435352;               // 'RSCH'
+constexpr uint32_t CacheVersion     = 1;                        // レイアウトを変更したら更新すること.
+constexpr uint64_t HashOffsetBasis  = 0xcbf29ce484222325ull;    // FNV-1a のオフセット基底.
+constexpr uint64_t HashPrime        = 0x00000100000001b3ull;    // FNV-1a の素数.
+constexpr wchar_t  CacheExtension[] = L".dxil";
+
+///////////////////////////////////////////////////////////////////////////////
+// CacheHeader structure
+///////////////////////////////////////////////////////////////////////////////
+struct CacheHeader
+{
+    uint32_t    Magic;      //!< マジックナンバーです.
+    uint32_t    Version;    //!< フォーマットバージョンです.
+    uint64_t    Hash;       //!< キャッシュキーのハッシュ値です.
+    uint64_t    DataSize;   //!< バイナリのサイズです.
+};
+
+static_assert(sizeof(CacheHeader) == 24, "CacheHeader layout mismatch");
+
+//-----------------------------------------------------------------------------
+//      ハッシュ値にバイト列を加えます.
+//-----------------------------------------------------------------------------
+void HashBytes(uint64_t& hash, const void* pData, size_t size)
+{
+    auto ptr = static_cast<const uint8_t*>(pData);
+    for(size_t i=0; i<size; ++i)
+    {
+        hash ^= ptr[i];
+        hash *= HashPrime;
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      ハッシュ値に文字列を加えます. 連結で同じ値にならないよう長さも加えます.
+//-----------------------------------------------------------------------------
+template<typename CharType>
+void HashString(uint64_t& hash, const std::basic_string<CharType>& value)
+{
+    uint64_t length = value.size();
+    HashBytes(hash, &length, sizeof(length));
+    HashBytes(hash, value.data(), value.size() * sizeof(CharType));
+}
+
+//-----------------------------------------------------------------------------
+//      ファイルの内容を読み込みます.
+//-----------------------------------------------------------------------------
+bool ReadTextFile(const std::wstring& path, std::string& text)
+{
+    MappedFile file;
+    if (!file.Open(path.c_str()))
+    { return false; }
+
+    text.assign(reinterpret_cast<const char*>(file.GetData()), size_t(file.GetSize()));
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      ディレクトリ部分を取得します(末尾の区切り文字を含む).
+//-----------------------------------------------------------------------------
+std::wstring GetDirectory(const std::wstring& path)
+{
+    auto pos = path.find_last_of(L"/\\");
+    if (pos == std::wstring::npos)
+    { return std::wstring(); }
+
+    return path.substr(0, pos + 1);
+}
+
+//-----------------------------------------------------------------------------
+//      ディレクトリとファイル名を連結します.
+//-----------------------------------------------------------------------------
+std::wstring CombinePath(const std::wstring& dir, const std::wstring& name)
+{
+    if (dir.empty())
+    { return name; }
+
+    auto last = dir.back();
+    if (last == L'/' || last == L'\\')
+    { return dir + name; }
+
+    return dir + L'/' + name;
+}
+
+//-----------------------------------------------------------------------------
+//      ソースから #include で指定されたファイル名を抜き出します.
+//-----------------------------------------------------------------------------
+void ParseIncludes(const std::string& source, std::vector<std::wstring>& names)
+{
+    size_t pos = 0;
+    while(pos < source.size())
+    {
+        auto end = source.find('\n', pos);
+        if (end == std::string::npos)
+        { end = source.size(); }
+
+        // 行頭の空白を読み飛ばし, '#' で始まる行だけを見る.
+        auto i = pos;
+        while(i < end && (source[i] == ' ' || source[i] == '\t'))
+        { i++; }
+
+        if (i < end && source[i] == '#')
+        {
+            i++;
+            while(i < end && (source[i] == ' ' || source[i] == '\t'))
+            { i++; }
+
+            const char  directive[] = "include";
+            const size_t length     = sizeof(directive) - 1;
+            if (source.compare(i, length, directive) == 0)
+            {
+                i += length;
+                while(i < end && (source[i] == ' ' || source[i] == '\t'))
+                { i++; }
+
+                if (i < end && (source[i] == '"' || source[i] == '<'))
+                {
+                    auto close = (source[i] == '"') ? '"' : '>';
+                    auto first = i + 1;
+                    auto last  = source.find(close, first);
+                    if (last != std::string::npos && last < end)
+                    { names.emplace_back(source.begin() + first, source.begin() + last); }
+                }
+            }
+        }
+
+        pos = end + 1;
+    }
+}
+
+} // namespace
+
+
+///////////////////////////////////////////////////////////////////////////////
+// ShaderBinary class
+///////////////////////////////////////////////////////////////////////////////
+
+//-----------------------------------------------------------------------------
+//      コンストラクタです.
+//-----------------------------------------------------------------------------
+ShaderBinary::ShaderBinary()
+: m_pData   (nullptr)
+, m_Size    (0)
+{ /* DO_NOTHING */ }
+
+//-----------------------------------------------------------------------------
+//      キャッシュファイルをマッピングして参照します.
+//-----------------------------------------------------------------------------
+bool ShaderBinary::Map(const wchar_t* path, size_t headerSize, void* pHeader)
+{
+    if (path == nullptr || pHeader == nullptr)
+    { return false; }
+
+    if (!m_File.Open(path))
+    { return false; }
+
+    if (m_File.GetSize() < headerSize)
+    {
+        m_File.Close();
+        return false;
+    }
+
+    memcpy(pHeader, m_File.GetData(), headerSize);
+
+    m_Data.clear();
+    m_pData = m_File.GetData() + headerSize;
+    m_Size  = size_t(m_File.GetSize() - headerSize);
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      キャッシュファイルのマッピングを解除します.
+//-----------------------------------------------------------------------------
+void ShaderBinary::Unmap()
+{
+    if (!m_File.IsOpen())
+    { return; }
+
+    m_File.Close();
+    m_pData = nullptr;
+    m_Size  = 0;
+}
+
+//-----------------------------------------------------------------------------
+//      メモリ上のバイナリを設定します.
+//-----------------------------------------------------------------------------
+void ShaderBinary::Assign(std::vector<uint8_t>&& data)
+{
+    m_File.Close();
+    m_Data  = std::move(data);
+    m_pData = m_Data.data();
+    m_Size  = m_Data.size();
+}
+
+//-----------------------------------------------------------------------------
+//      バイナリの先頭ポインタを取得します.
+//-----------------------------------------------------------------------------
+const uint8_t* ShaderBinary::GetData() const
+{ return m_pData; }
+
+//-----------------------------------------------------------------------------
+//      バイナリのサイズを取得します.
+//-----------------------------------------------------------------------------
+size_t ShaderBinary::GetSize() const
+{ return m_Size; }
+
+//-----------------------------------------------------------------------------
+//      キャッシュファイルをマッピングしているかどうかチェックします.
+//-----------------------------------------------------------------------------
+bool ShaderBinary::IsMapped() const
+{ return m_File.IsOpen(); }
+
+
+///////////////////////////////////////////////////////////////////////////////
+// ShaderCache class
+///////////////////////////////////////////////////////////////////////////////
+
+//-----------------------------------------------------------------------------
+//      コンストラクタです.
+//-----------------------------------------------------------------------------
+ShaderCache::ShaderCache()
+: m_pCompiler   (nullptr)
+, m_HitCount    (0)
+, m_CompileCount(0)
+{ /* DO_NOTHING */ }
+
+//-----------------------------------------------------------------------------
+//      デストラクタです.
+//-----------------------------------------------------------------------------
+ShaderCache::~ShaderCache()
+{ Term(); }
+
+//-----------------------------------------------------------------------------
+//      初期化処理を行います.
+//-----------------------------------------------------------------------------
+bool ShaderCache::Init(ShaderCompiler* pCompiler, const wchar_t* cacheDir)
+{
+    if (pCompiler == nullptr || cacheDir == nullptr)
+    { return false; }
+
+    if (!CreateDirectoryW(cacheDir, nullptr) && GetLastError() != ERROR_ALREADY_EXISTS)
+    {
+        ELOG( "Error : CreateDirectoryW() Failed. path = %ls", cacheDir );
+        return false;
+    }
+
+    m_pCompiler       = pCompiler;
+    m_CacheDir        = cacheDir;
+    m_CompilerVersion = pCompiler->GetVersion();
+    m_HitCount        = 0;
+    m_CompileCount    = 0;
+
+    // 正常終了.
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      終了処理を行います.
+//-----------------------------------------------------------------------------
+void ShaderCache::Term()
+{
+    m_pCompiler = nullptr;
+    m_CacheDir.clear();
+    m_CompilerVersion.clear();
+}
+
+//-----------------------------------------------------------------------------
+//      キャッシュキーを求めます.
+//-----------------------------------------------------------------------------
+bool ShaderCache::GetKey(const ShaderDesc& desc, ShaderCacheKey& key) const
+{
+    std::string source;
+    if (!ReadTextFile(desc.Path, source))
+    {
+        ELOG( "Error : Shader File Not Found. path = %ls", desc.Path.c_str() );
+        return false;
+    }
+
+    auto hash = HashOffsetBasis;
+    HashString(hash, m_CompilerVersion);
+    HashString(hash, desc.Target);
+
+    uint64_t count = desc.Defines.size();
+    HashBytes(hash, &count, sizeof(count));
+    for(auto& define : desc.Defines)
+    {
+        HashString(hash, define.Name);
+        HashString(hash, define.Value);
+    }
+
+    count = desc.Arguments.size();
+    HashBytes(hash, &count, sizeof(count));
+    for(auto& arg : desc.Arguments)
+    { HashString(hash, arg); }
+
+    HashString(hash, source);
+
+    // インクルードを幅優先でたどり, 解決できたファイルの名前と内容をハッシュに加える.
+    // 解決できなかった名前も加えておき, 後からファイルが追加された場合に無効化されるようにする.
+    struct Pending
+    {
+        std::wstring    Directory;
+        std::string     Source;
+    };
+
+    std::vector<std::wstring> dependencies;
+    std::vector<Pending>      pending;
+    pending.push_back({ GetDirectory(desc.Path), source });
+
+    for(size_t index = 0; index < pending.size(); ++index)
+    {
+        std::vector<std::wstring> names;
+        ParseIncludes(pending[index].Source, names);
+
+        auto directory = pending[index].Directory;
+        for(auto& name : names)
+        {
+            HashString(hash, name);
+
+            std::wstring resolved;
+            std::string  text;
+
+            auto candidate = CombinePath(directory, name);
+            if (ReadTextFile(candidate, text))
+            { resolved = candidate; }
+
+            for(size_t i=0; resolved.empty() && i<desc.IncludeDirs.size(); ++i)
+            {
+                candidate = CombinePath(desc.IncludeDirs[i], name);
+                if (ReadTextFile(candidate, text))
+                { resolved = candidate; }
+            }
+
+            if (resolved.empty())
+            {
+                uint8_t missing = 0;
+                HashBytes(hash, &missing, sizeof(missing));
+                continue;
+            }
+
+            // 既に走査したファイルは内容が同じなので名前だけで十分.
+            auto found = false;
+            for(auto& dependency : dependencies)
+            {
+                if (dependency == resolved)
+                {
+                    found = true;
+                    break;
+                }
+            }
+
+            if (found)
+            { continue; }
+
+            HashString(hash, text);
+            dependencies.push_back(resolved);
+            pending.push_back({ GetDirectory(resolved), std::move(text) });
+        }
+    }
+
+    key.Hash         = hash;
+    key.Source       = std::move(source);
+    key.Dependencies = std::move(dependencies);
+
+    // 正常終了.
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      キャッシュファイルパスを取得します.
+//-----------------------------------------------------------------------------
+std::wstring ShaderCache::GetCachePath(uint64_t hash) const
+{
+    wchar_t name[17] = {};
+    for(auto i=0; i<16; ++i)
+    {
+        auto digit = uint32_t(hash >> (60 - i * 4)) & 0xF;
+        name[i] = wchar_t((digit < 10) ? (L'0' + digit) : (L'a' + digit - 10));
+    }
+
+    return CombinePath(m_CacheDir, name) + CacheExtension;
+}
+
+//-----------------------------------------------------------------------------
+//      シェーダをロードします.
+//-----------------------------------------------------------------------------
+std::shared_ptr<ShaderBinary> ShaderCache::Load(const ShaderDesc& desc)
+{
+    if (m_pCompiler == nullptr)
+    { return nullptr; }
+
+    ShaderCacheKey key;
+    if (!GetKey(desc, key))
+    { return nullptr; }
+
+    auto path   = GetCachePath(key.Hash);
+    auto binary = std::make_shared<ShaderBinary>();
+
+    // キャッシュがあればマッピングしたまま返す.
+    {
+        CacheHeader header = {};
+        if (binary->Map(path.c_str(), sizeof(header), &header))
+        {
+            if (header.Magic    == CacheMagic
+             && header.Version  == CacheVersion
+             && header.Hash     == key.Hash
+             && header.DataSize == binary->GetSize()
+             && header.DataSize != 0)
+            {
+                m_HitCount++;
+                return binary;
+            }
+
+            // マッピングしたままだと古いキャッシュファイルを置き換えられない.
+            binary->Unmap();
+        }
+    }
+
+    // コンパイル.
+    std::vector<uint8_t> data;
+    std::string          message;
+    m_CompileCount++;
+    if (!m_pCompiler->Compile(desc, key.Source, data, message) || data.empty())
+    {
+        ELOG( "Error : Shader Compile Failed. path = %ls\n%s", desc.Path.c_str(), message.c_str() );
+        return nullptr;
+    }
+
+    // 保存に失敗してもコンパイル結果は使える.
+    {
+        CacheHeader header = {};
+        header.Magic    = CacheMagic;
+        header.Version  = CacheVersion;
+        header.Hash     = key.Hash;
+        header.DataSize = data.size();
+
+        // 書き込み途中のファイルを読まれないように一時ファイルに書いてから置き換えます.
+        std::wstring tempPath = path + L".tmp";
+
+        auto hFile = CreateFileW(
+            tempPath.c_str(),
+            GENERIC_WRITE,
+            0,
+            nullptr,
+            CREATE_ALWAYS,
+            FILE_ATTRIBUTE_NORMAL,
+            nullptr);
+        if (hFile != INVALID_HANDLE_VALUE)
+        {
+            DWORD headerWritten = 0;
+            DWORD dataWritten   = 0;
+            auto result = WriteFile(hFile, &header, DWORD(sizeof(header)), &headerWritten, nullptr)
+                       && WriteFile(hFile, data.data(), DWORD(data.size()), &dataWritten, nullptr);
+            CloseHandle(hFile);
+
+            if (!result
+             || headerWritten != DWORD(sizeof(header))
+             || dataWritten   != DWORD(data.size())
+             || !MoveFileExW(tempPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING))
+            {
+                ELOG( "Error : Shader Cache Write Failed. path = %ls", path.c_str() );
+                DeleteFileW(tempPath.c_str());
+            }
+        }
+        else
+        {
+            ELOG( "Error : CreateFileW() Failed. path = %ls", tempPath.c_str() );
+        }
+    }
+
+    binary->Assign(std::move(data));
+    return binary;
+}
+
+//-----------------------------------------------------------------------------
+//      独立した複数のシェーダを並列にロードします.
+//-----------------------------------------------------------------------------
+bool ShaderCache::LoadParallel
+(
+    const ShaderDesc*               pDescs,
+    size_t                          count,
+    std::shared_ptr<ShaderBinary>*  pResults
+)
+{
+    if (pDescs == nullptr || pResults == nullptr)
+    { return false; }
+
+    ParallelFor(count, [&](size_t index)
+    {
+        pResults[index] = Load(pDescs[index]);
+    });
+
+    for(size_t i=0; i<count; ++i)
+    {
+        if (pResults[i] == nullptr)
+        { return false; }
+    }
+
+    // 正常終了.
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      キャッシュからロードできた回数を取得します.
+//-----------------------------------------------------------------------------
+uint32_t ShaderCache::GetHitCount() const
+{ return m_HitCount; }
+
+//-----------------------------------------------------------------------------
+//      コンパイラを呼び出した回数を取得します.
+//-----------------------------------------------------------------------------
+uint32_t ShaderCache::GetCompileCount() const
+{ return m_CompileCount; }
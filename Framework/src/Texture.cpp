@@ -209,6 +209,48 @@ bool Texture::Init
     return true;
 }
 
+//-----------------------------------------------------------------------------
+//      生成済みのリソースを用いて初期化処理を行います.
+//-----------------------------------------------------------------------------
+bool Texture::Init
+(
+    ID3D12Device*               pDevice,
+    DescriptorPool*             pPool,
+    ID3D12Resource*             pResource,
+    bool                        isCube
+)
+{
+    if (pDevice == nullptr || pPool == nullptr || pResource == nullptr)
+    {
+        ELOG( "Error : Invalid Argument." );
+        return false;
+    }
+
+    assert(m_pPool   == nullptr);
+    assert(m_pHandle == nullptr);
+
+    // ディスクリプタプールを設定.
+    m_pPool = pPool;
+    m_pPool->AddRef();
+
+    // ディスクリプタハンドルを取得.
+    m_pHandle = pPool->AllocHandle();
+    if (m_pHandle == nullptr)
+    { return false; }
+
+    // リソースを保持.
+    m_pTex = pResource;
+
+    // シェーダリソースビューの設定を求める.
+    auto viewDesc = GetViewDesc(isCube);
+
+    // シェーダリソースビューを生成します.
+    pDevice->CreateShaderResourceView(m_pTex.Get(), &viewDesc, m_pHandle->HandleCPU);
+
+    // 正常終了.
+    return true;
+}
+
 //-----------------------------------------------------------------------------
 //      終了処理を行います.
 //-----------------------------------------------------------------------------
@@ -0,0 +1,764 @@
+﻿//-----------------------------------------------------------------------------
+// File : TextureStreamer.cpp
+// Desc : Texture Mip Streaming Module.
+// Copyright(c) Pocol. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include "TextureStreamer.h"
+#include "Logger.h"
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+//      SRGBフォーマットに変換します.
+//-----------------------------------------------------------------------------
+DXGI_FORMAT ConvertToSRGB(DXGI_FORMAT format)
+{
+    switch(format)
+    {
+    case DXGI_FORMAT_R8G8B8A8_UNORM:    return DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
+    case DXGI_FORMAT_BC1_UNORM:         return DXGI_FORMAT_BC1_UNORM_SRGB;
+    case DXGI_FORMAT_BC2_UNORM:         return DXGI_FORMAT_BC2_UNORM_SRGB;
+    case DXGI_FORMAT_BC3_UNORM:         return DXGI_FORMAT_BC3_UNORM_SRGB;
+    case DXGI_FORMAT_B8G8R8A8_UNORM:    return DXGI_FORMAT_B8G8R8A8_UNORM_SRGB;
+    case DXGI_FORMAT_B8G8R8X8_UNORM:    return DXGI_FORMAT_B8G8R8X8_UNORM_SRGB;
+    case DXGI_FORMAT_BC7_UNORM:         return DXGI_FORMAT_BC7_UNORM_SRGB;
+    default:                            return format;
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      指定ミップ以降の合計サイズを求めます.
+//-----------------------------------------------------------------------------
+uint64_t SumMipBytes(const std::vector<uint64_t>& mipBytes, uint32_t firstMip)
+{
+    uint64_t result = 0;
+    for(auto i=size_t(firstMip); i<mipBytes.size(); ++i)
+    { result += mipBytes[i]; }
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+//      テクスチャのミップ0にできるかチェックします.
+//-----------------------------------------------------------------------------
+bool IsValidFirstMip(const DdsInfo& info, uint32_t mip)
+{
+    // ブロック圧縮のリソースはミップ0の縦横が4の倍数である必要がある.
+    if (mip == 0 || !IsDdsBlockCompressed(info.Format))
+    { return true; }
+
+    auto w = std::max(info.Width  >> mip, 1u);
+    auto h = std::max(info.Height >> mip, 1u);
+    return (w % 4) == 0 && (h % 4) == 0;
+}
+
+//-----------------------------------------------------------------------------
+//      ミップ0にできる, 指定ミップ以下で最も粗いミップを求めます.
+//-----------------------------------------------------------------------------
+uint32_t FindValidFirstMip(const DdsInfo& info, uint32_t mip)
+{
+    while (mip > 0 && !IsValidFirstMip(info, mip))
+    { mip--; }
+    return mip;
+}
+
+//-----------------------------------------------------------------------------
+//      ミップを1段ずつ割り当てます.
+//-----------------------------------------------------------------------------
+template<typename LimitFunc>
+void AssignMips
+(
+    const std::vector<TextureResidency>&    textures,
+    const std::vector<uint32_t>&            order,
+    LimitFunc                               limit,
+    uint64_t                                budget,
+    uint64_t&                               used,
+    std::vector<uint32_t>&                  result
+)
+{
+    // 1周で各テクスチャを1段ずつ詳細にし, 予算に収まらなくなったテクスチャは以降も収まらないので外す.
+    std::vector<uint8_t> blocked(textures.size(), 0);
+
+    auto progress = true;
+    while (progress)
+    {
+        progress = false;
+        for(auto i : order)
+        {
+            if (blocked[i] || result[i] <= limit(textures[i]))
+            { continue; }
+
+            auto cost = textures[i].MipBytes[result[i] - 1];
+            if (used + cost > budget)
+            {
+                blocked[i] = 1;
+                continue;
+            }
+
+            used += cost;
+            result[i]--;
+            progress = true;
+        }
+    }
+}
+
+} // namespace
+
+
+//-----------------------------------------------------------------------------
+//      予算内で常駐させるミップを決めます.
+//-----------------------------------------------------------------------------
+uint64_t SelectResidentMips
+(
+    const std::vector<TextureResidency>&    textures,
+    uint64_t                                budget,
+    std::vector<uint32_t>&                  result
+)
+{
+    result.resize(textures.size());
+
+    // 末尾ミップは予算に関わらず常駐させる.
+    uint64_t used = 0;
+    for(size_t i=0; i<textures.size(); ++i)
+    {
+        result[i] = textures[i].TailMip;
+        used += SumMipBytes(textures[i].MipBytes, textures[i].TailMip);
+    }
+
+    // 要求のあるミップを優先度の高い順に割り当てる.
+    std::vector<uint32_t> order;
+    order.reserve(textures.size());
+    for(size_t i=0; i<textures.size(); ++i)
+    {
+        if (textures[i].RequestedMip < textures[i].TailMip)
+        { order.push_back(uint32_t(i)); }
+    }
+
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t lhs, uint32_t rhs)
+    { return textures[lhs].Priority > textures[rhs].Priority; });
+
+    AssignMips(textures, order,
+        [](const TextureResidency& texture) { return texture.RequestedMip; },
+        budget, used, result);
+
+    // 余った予算で常駐済みのミップを最近要求された順に残す.
+    order.clear();
+    for(size_t i=0; i<textures.size(); ++i)
+    {
+        if (textures[i].ResidentMip < result[i])
+        { order.push_back(uint32_t(i)); }
+    }
+
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t lhs, uint32_t rhs)
+    {
+        if (textures[lhs].LastRequestFrame != textures[rhs].LastRequestFrame)
+        { return textures[lhs].LastRequestFrame > textures[rhs].LastRequestFrame; }
+        return textures[lhs].Priority > textures[rhs].Priority;
+    });
+
+    AssignMips(textures, order,
+        [](const TextureResidency& texture) { return texture.ResidentMip; },
+        budget, used, result);
+
+    return used;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// D3D12TextureStreamBackend class
+///////////////////////////////////////////////////////////////////////////////
+
+//-----------------------------------------------------------------------------
+//      コンストラクタです.
+//-----------------------------------------------------------------------------
+D3D12TextureStreamBackend::D3D12TextureStreamBackend()
+: m_pDevice     (nullptr)
+, m_pPool       (nullptr)
+, m_pQueue      (nullptr)
+, m_Recording   (false)
+{ /* DO_NOTHING */ }
+
+//-----------------------------------------------------------------------------
+//      デストラクタです.
+//-----------------------------------------------------------------------------
+D3D12TextureStreamBackend::~D3D12TextureStreamBackend()
+{ Term(); }
+
+//-----------------------------------------------------------------------------
+//      初期化処理を行います.
+//-----------------------------------------------------------------------------
+bool D3D12TextureStreamBackend::Init(ID3D12Device* pDevice, DescriptorPool* pPool, ID3D12CommandQueue* pQueue)
+{
+    if (pDevice == nullptr || pPool == nullptr || pQueue == nullptr)
+    { return false; }
+
+    m_pBatch.reset(new (std::nothrow) DirectX::ResourceUploadBatch(pDevice));
+    if (m_pBatch == nullptr)
+    { return false; }
+
+    m_pDevice = pDevice;
+    m_pPool   = pPool;
+    m_pQueue  = pQueue;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      終了処理を行います.
+//-----------------------------------------------------------------------------
+void D3D12TextureStreamBackend::Term()
+{
+    Flush();
+
+    for(auto& future : m_Futures)
+    { future.wait(); }
+    m_Futures.clear();
+
+    m_pBatch.reset();
+    m_pDevice = nullptr;
+    m_pPool   = nullptr;
+    m_pQueue  = nullptr;
+}
+
+//-----------------------------------------------------------------------------
+//      テクスチャを生成し, アップロードバッチに積みます.
+//-----------------------------------------------------------------------------
+bool D3D12TextureStreamBackend::CreateTexture
+(
+    const DdsInfo&                  info,
+    uint32_t                        firstMip,
+    bool                            isSRGB,
+    const D3D12_SUBRESOURCE_DATA*   pSubresources,
+    uint32_t                        count,
+    StreamTexture&                  result
+)
+{
+    if (m_pDevice == nullptr || pSubresources == nullptr || firstMip >= info.MipLevels)
+    { return false; }
+
+    auto isVolume = (info.Depth > 1);
+    auto format   = (isSRGB) ? ConvertToSRGB(info.Format) : info.Format;
+
+    D3D12_HEAP_PROPERTIES prop = {};
+    prop.Type                   = D3D12_HEAP_TYPE_DEFAULT;
+    prop.CPUPageProperty        = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+    prop.MemoryPoolPreference   = D3D12_MEMORY_POOL_UNKNOWN;
+    prop.CreationNodeMask       = 1;
+    prop.VisibleNodeMask        = 1;
+
+    D3D12_RESOURCE_DESC desc = {};
+    desc.Dimension          = (isVolume) ? D3D12_RESOURCE_DIMENSION_TEXTURE3D : D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+    desc.Alignment          = 0;
+    desc.Width              = std::max(info.Width  >> firstMip, 1u);
+    desc.Height             = std::max(info.Height >> firstMip, 1u);
+    desc.DepthOrArraySize   = UINT16((isVolume) ? std::max(info.Depth >> firstMip, 1u) : info.ArraySize);
+    desc.MipLevels          = UINT16(info.MipLevels - firstMip);
+    desc.Format             = format;
+    desc.SampleDesc.Count   = 1;
+    desc.SampleDesc.Quality = 0;
+    desc.Layout             = D3D12_TEXTURE_LAYOUT_UNKNOWN;
+    desc.Flags              = D3D12_RESOURCE_FLAG_NONE;
+
+    ID3D12Resource* pResource = nullptr;
+    auto hr = m_pDevice->CreateCommittedResource(
+        &prop,
+        D3D12_HEAP_FLAG_NONE,
+        &desc,
+        D3D12_RESOURCE_STATE_COPY_DEST,
+        nullptr,
+        IID_PPV_ARGS(&pResource));
+    if (FAILED(hr))
+    {
+        ELOG( "Error : ID3D12Device::CreateCommittedResource() Failed. retcode = 0x%x", hr );
+        return false;
+    }
+
+    auto pHandle = m_pPool->AllocHandle();
+    if (pHandle == nullptr)
+    {
+        pResource->Release();
+        return false;
+    }
+
+    // シェーダリソースビューを生成.
+    D3D12_SHADER_RESOURCE_VIEW_DESC viewDesc = {};
+    viewDesc.Format                  = format;
+    viewDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+    if (info.IsCube)
+    {
+        viewDesc.ViewDimension                  = D3D12_SRV_DIMENSION_TEXTURECUBE;
+        viewDesc.TextureCube.MipLevels          = desc.MipLevels;
+    }
+    else if (isVolume)
+    {
+        viewDesc.ViewDimension                  = D3D12_SRV_DIMENSION_TEXTURE3D;
+        viewDesc.Texture3D.MipLevels            = desc.MipLevels;
+    }
+    else if (info.ArraySize > 1)
+    {
+        viewDesc.ViewDimension                  = D3D12_SRV_DIMENSION_TEXTURE2DARRAY;
+        viewDesc.Texture2DArray.MipLevels       = desc.MipLevels;
+        viewDesc.Texture2DArray.ArraySize       = info.ArraySize;
+    }
+    else
+    {
+        viewDesc.ViewDimension                  = D3D12_SRV_DIMENSION_TEXTURE2D;
+        viewDesc.Texture2D.MipLevels            = desc.MipLevels;
+    }
+    m_pDevice->CreateShaderResourceView(pResource, &viewDesc, pHandle->HandleCPU);
+
+    // 描画と同じキューに投入するので, 以降のフレームの描画より前にコピーが終わる.
+    if (!m_Recording)
+    {
+        m_pBatch->Begin();
+        m_Recording = true;
+    }
+
+    m_pBatch->Upload(pResource, 0, pSubresources, count);
+    m_pBatch->Transition(
+        pResource,
+        D3D12_RESOURCE_STATE_COPY_DEST,
+        D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+
+    result.pResource = pResource;
+    result.pHandle   = pHandle;
+
+    // 正常終了.
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      テクスチャを破棄します.
+//-----------------------------------------------------------------------------
+void D3D12TextureStreamBackend::DestroyTexture(StreamTexture& texture)
+{
+    if (texture.pResource != nullptr)
+    { texture.pResource->Release(); }
+
+    if (texture.pHandle != nullptr && m_pPool != nullptr)
+    { m_pPool->FreeHandle(texture.pHandle); }
+
+    texture = StreamTexture();
+}
+
+//-----------------------------------------------------------------------------
+//      アップロードバッチをコマンドキューに投入します.
+//-----------------------------------------------------------------------------
+void D3D12TextureStreamBackend::Flush()
+{
+    if (m_Recording)
+    {
+        m_Futures.push_back(m_pBatch->End(m_pQueue));
+        m_Recording = false;
+    }
+
+    // 完了したバッチの通知を取り除く. future の破棄は完了まで待つので残しておく必要がある.
+    m_Futures.erase(
+        std::remove_if(m_Futures.begin(), m_Futures.end(), [](std::future<void>& future)
+        { return future.wait_for(std::chrono::seconds(0)) == std::future_status::ready; }),
+        m_Futures.end());
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// TextureStreamer class
+///////////////////////////////////////////////////////////////////////////////
+
+//-----------------------------------------------------------------------------
+//      コンストラクタです.
+//-----------------------------------------------------------------------------
+TextureStreamer::TextureStreamer()
+: m_pBackend        (nullptr)
+, m_UpdateCount     (0)
+, m_UploadedBytes   (0)
+, m_EvictedCount    (0)
+{ /* DO_NOTHING */ }
+
+//-----------------------------------------------------------------------------
+//      デストラクタです.
+//-----------------------------------------------------------------------------
+TextureStreamer::~TextureStreamer()
+{ Term(); }
+
+//-----------------------------------------------------------------------------
+//      初期化処理を行います.
+//-----------------------------------------------------------------------------
+bool TextureStreamer::Init(TextureStreamBackend* pBackend, const TextureStreamDesc& desc)
+{
+    if (pBackend == nullptr)
+    { return false; }
+
+    Term();
+
+    m_pBackend = pBackend;
+    m_Desc     = desc;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      終了処理を行います.
+//-----------------------------------------------------------------------------
+void TextureStreamer::Term()
+{
+    if (m_pBackend != nullptr)
+    {
+        for(auto& entry : m_Entries)
+        {
+            if (entry.pFile != nullptr)
+            { m_pBackend->DestroyTexture(entry.Texture); }
+        }
+
+        for(auto& texture : m_FrameRelease)
+        { m_pBackend->DestroyTexture(texture); }
+
+        for(auto& frame : m_Pending)
+        {
+            for(auto& texture : frame.Textures)
+            { m_pBackend->DestroyTexture(texture); }
+        }
+    }
+
+    m_Entries     .clear();
+    m_FreeIds     .clear();
+    m_FrameRelease.clear();
+    m_Pending     .clear();
+
+    m_pBackend      = nullptr;
+    m_UpdateCount   = 0;
+    m_UploadedBytes = 0;
+    m_EvictedCount  = 0;
+}
+
+//-----------------------------------------------------------------------------
+//      テクスチャを登録します.
+//-----------------------------------------------------------------------------
+uint32_t TextureStreamer::Register(const wchar_t* filename, bool isSRGB)
+{
+    if (m_pBackend == nullptr || filename == nullptr)
+    { return InvalidId; }
+
+    Entry entry;
+    entry.pFile.reset(new (std::nothrow) MappedFile());
+    if (entry.pFile == nullptr || !entry.pFile->Open(filename))
+    {
+        ELOG( "Error : MappedFile::Open() Failed. filename = %ls", filename );
+        return InvalidId;
+    }
+
+    auto pData = entry.pFile->GetData();
+    auto size  = size_t(entry.pFile->GetSize());
+    if (!ParseDdsHeader(pData, size, entry.Info) || !ComputeDdsLayout(entry.Info, size, entry.Layout))
+    {
+        ELOG( "Error : Invalid DDS File. filename = %ls", filename );
+        return InvalidId;
+    }
+
+    auto& info      = entry.Info;
+    auto& residency = entry.Residency;
+
+    residency.MipBytes.assign(info.MipLevels, 0);
+    for(auto item=0u; item<info.ArraySize; ++item)
+    {
+        for(auto mip=0u; mip<info.MipLevels; ++mip)
+        { residency.MipBytes[mip] += entry.Layout[item * info.MipLevels + mip].Size; }
+    }
+
+    // 末尾から TailBytes に収まるミップを常駐させる. 配列やボリュームは全て常駐させる.
+    auto tailMip = 0u;
+    if (info.ArraySize == 1 && info.Depth == 1)
+    {
+        tailMip = info.MipLevels - 1;
+        auto tailBytes = residency.MipBytes[tailMip];
+        while (tailMip > 0 && tailBytes + residency.MipBytes[tailMip - 1] <= m_Desc.TailBytes)
+        {
+            tailMip--;
+            tailBytes += residency.MipBytes[tailMip];
+        }
+        tailMip = FindValidFirstMip(info, tailMip);
+    }
+
+    residency.TailMip           = tailMip;
+    residency.ResidentMip       = info.MipLevels;
+    residency.RequestedMip      = info.MipLevels;
+    residency.Priority          = 0.0f;
+    residency.LastRequestFrame  = 0;
+    entry.Texture               = StreamTexture();
+    entry.IsSRGB                = isSRGB;
+
+    if (!Recreate(entry, tailMip))
+    { return InvalidId; }
+
+    // 番号を割り当てて登録.
+    uint32_t id;
+    if (!m_FreeIds.empty())
+    {
+        id = m_FreeIds.back();
+        m_FreeIds.pop_back();
+        m_Entries[id] = std::move(entry);
+    }
+    else
+    {
+        id = uint32_t(m_Entries.size());
+        m_Entries.push_back(std::move(entry));
+    }
+
+    return id;
+}
+
+//-----------------------------------------------------------------------------
+//      テクスチャの登録を解除します.
+//-----------------------------------------------------------------------------
+void TextureStreamer::Unregister(uint32_t id)
+{
+    if (!IsValid(id))
+    { return; }
+
+    auto& entry = m_Entries[id];
+    if (entry.Texture.pResource != nullptr)
+    { m_FrameRelease.push_back(entry.Texture); }
+
+    entry = Entry();
+    m_FreeIds.push_back(id);
+}
+
+//-----------------------------------------------------------------------------
+//      このフレームで必要なミップを要求します.
+//-----------------------------------------------------------------------------
+void TextureStreamer::Request(uint32_t id, uint32_t mip, float priority)
+{
+    if (!IsValid(id))
+    { return; }
+
+    auto& residency = m_Entries[id].Residency;
+    residency.RequestedMip      = std::min(residency.RequestedMip, mip);
+    residency.Priority         += priority;
+    residency.LastRequestFrame  = m_UpdateCount;
+}
+
+//-----------------------------------------------------------------------------
+//      常駐させるミップを更新します.
+//-----------------------------------------------------------------------------
+bool TextureStreamer::Update()
+{
+    if (m_pBackend == nullptr)
+    { return false; }
+
+    std::vector<uint32_t>           ids;
+    std::vector<TextureResidency>   textures;
+    ids     .reserve(m_Entries.size());
+    textures.reserve(m_Entries.size());
+    for(size_t i=0; i<m_Entries.size(); ++i)
+    {
+        if (m_Entries[i].pFile == nullptr)
+        { continue; }
+
+        ids     .push_back(uint32_t(i));
+        textures.push_back(m_Entries[i].Residency);
+    }
+
+    std::vector<uint32_t> targets;
+    SelectResidentMips(textures, m_Desc.BudgetBytes, targets);
+
+    auto changed = false;
+    m_UploadedBytes = 0;
+    m_EvictedCount  = 0;
+
+    // 予算を守るため, ミップを手放すテクスチャはアップロード量に関わらず先に作り直す.
+    std::vector<uint32_t> upgrades;
+    for(size_t i=0; i<ids.size(); ++i)
+    {
+        auto& entry  = m_Entries[ids[i]];
+        auto  target = FindValidFirstMip(entry.Info, targets[i]);
+        targets[i] = target;
+
+        if (target > entry.Residency.ResidentMip)
+        {
+            if (Recreate(entry, target))
+            {
+                changed = true;
+                m_EvictedCount++;
+            }
+        }
+        else if (target < entry.Residency.ResidentMip)
+        { upgrades.push_back(uint32_t(i)); }
+    }
+
+    // 詳細にするテクスチャは優先度の高い順に, 1回の更新のアップロード量の目安に収まる分だけ作り直す.
+    std::stable_sort(upgrades.begin(), upgrades.end(), [&](uint32_t lhs, uint32_t rhs)
+    { return textures[lhs].Priority > textures[rhs].Priority; });
+
+    for(auto i : upgrades)
+    {
+        auto& entry     = m_Entries[ids[i]];
+        auto& mipBytes  = entry.Residency.MipBytes;
+        auto  resident  = entry.Residency.ResidentMip;
+        auto  firstMip  = targets[i];
+
+        while (firstMip + 1 < resident && m_UploadedBytes + SumMipBytes(mipBytes, firstMip) > m_Desc.MaxUploadBytes)
+        { firstMip = FindValidFirstMip(entry.Info, firstMip + 1); }
+
+        // 目安を超える場合も, 何もアップロードしていなければ1段は進める.
+        if (firstMip >= resident)
+        { continue; }
+
+        if (m_UploadedBytes > 0 && m_UploadedBytes + SumMipBytes(mipBytes, firstMip) > m_Desc.MaxUploadBytes)
+        { continue; }
+
+        if (Recreate(entry, firstMip))
+        { changed = true; }
+    }
+
+    // 要求は毎フレーム積み直す.
+    for(auto& entry : m_Entries)
+    {
+        entry.Residency.RequestedMip = entry.Info.MipLevels;
+        entry.Residency.Priority     = 0.0f;
+    }
+
+    m_pBackend->Flush();
+    m_UpdateCount++;
+
+    return changed;
+}
+
+//-----------------------------------------------------------------------------
+//      フレームを終了します.
+//-----------------------------------------------------------------------------
+void TextureStreamer::FrameEnd(uint64_t fenceValue)
+{
+    if (m_FrameRelease.empty())
+    { return; }
+
+    assert(m_Pending.empty() || m_Pending.back().FenceValue <= fenceValue);
+
+    PendingFrame frame;
+    frame.FenceValue = fenceValue;
+    frame.Textures.swap(m_FrameRelease);
+    m_Pending.push_back(std::move(frame));
+}
+
+//-----------------------------------------------------------------------------
+//      GPUの処理が完了した古いテクスチャを破棄します.
+//-----------------------------------------------------------------------------
+void TextureStreamer::Retire(uint64_t completedValue)
+{
+    while(!m_Pending.empty() && m_Pending.front().FenceValue <= completedValue)
+    {
+        for(auto& texture : m_Pending.front().Textures)
+        { m_pBackend->DestroyTexture(texture); }
+
+        m_Pending.pop_front();
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      GPUディスクリプタハンドルを取得します.
+//-----------------------------------------------------------------------------
+D3D12_GPU_DESCRIPTOR_HANDLE TextureStreamer::GetHandleGPU(uint32_t id) const
+{
+    if (!IsValid(id) || m_Entries[id].Texture.pHandle == nullptr)
+    { return D3D12_GPU_DESCRIPTOR_HANDLE(); }
+
+    return m_Entries[id].Texture.pHandle->HandleGPU;
+}
+
+//-----------------------------------------------------------------------------
+//      DDS ファイルの情報を取得します.
+//-----------------------------------------------------------------------------
+const DdsInfo* TextureStreamer::GetInfo(uint32_t id) const
+{
+    if (!IsValid(id))
+    { return nullptr; }
+
+    return &m_Entries[id].Info;
+}
+
+//-----------------------------------------------------------------------------
+//      常駐している最も詳細なミップを取得します.
+//-----------------------------------------------------------------------------
+uint32_t TextureStreamer::GetResidentMip(uint32_t id) const
+{
+    if (!IsValid(id))
+    { return 0; }
+
+    return m_Entries[id].Residency.ResidentMip;
+}
+
+//-----------------------------------------------------------------------------
+//      統計を取得します.
+//-----------------------------------------------------------------------------
+TextureStreamStats TextureStreamer::GetStats() const
+{
+    TextureStreamStats result = {};
+    result.BudgetBytes   = m_Desc.BudgetBytes;
+    result.UploadedBytes = m_UploadedBytes;
+    result.EvictedCount  = m_EvictedCount;
+
+    for(auto& entry : m_Entries)
+    {
+        if (entry.pFile == nullptr)
+        { continue; }
+
+        result.TextureCount++;
+        result.ResidentBytes += SumMipBytes(entry.Residency.MipBytes, entry.Residency.ResidentMip);
+    }
+
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+//      有効なテクスチャ番号かどうかチェックします.
+//-----------------------------------------------------------------------------
+bool TextureStreamer::IsValid(uint32_t id) const
+{ return id < m_Entries.size() && m_Entries[id].pFile != nullptr; }
+
+//-----------------------------------------------------------------------------
+//      指定ミップ以降だけを持つテクスチャを作り直します.
+//-----------------------------------------------------------------------------
+bool TextureStreamer::Recreate(Entry& entry, uint32_t firstMip)
+{
+    auto& info     = entry.Info;
+    auto  mipCount = info.MipLevels - firstMip;
+    auto  pData    = entry.pFile->GetData();
+
+    // 常駐済みのミップもファイルから読み直す. マッピング済みなので OS のページキャッシュから読める.
+    std::vector<D3D12_SUBRESOURCE_DATA> subresources;
+    subresources.reserve(size_t(info.ArraySize) * mipCount);
+    for(auto item=0u; item<info.ArraySize; ++item)
+    {
+        for(auto mip=firstMip; mip<info.MipLevels; ++mip)
+        {
+            auto& layout = entry.Layout[item * info.MipLevels + mip];
+
+            D3D12_SUBRESOURCE_DATA data = {};
+            data.pData      = pData + layout.Offset;
+            data.RowPitch   = LONG_PTR(layout.RowPitch);
+            data.SlicePitch = LONG_PTR(layout.SlicePitch);
+            subresources.push_back(data);
+        }
+    }
+
+    StreamTexture texture = {};
+    if (!m_pBackend->CreateTexture(info, firstMip, entry.IsSRGB, subresources.data(), uint32_t(subresources.size()), texture))
+    {
+        ELOG( "Error : TextureStreamBackend::CreateTexture() Failed." );
+        return false;
+    }
+
+    // 古いテクスチャは描画中の可能性があるので, フレームの完了後に破棄する.
+    if (entry.Texture.pResource != nullptr)
+    { m_FrameRelease.push_back(entry.Texture); }
+
+    entry.Texture               = texture;
+    entry.Residency.ResidentMip = firstMip;
+    m_UploadedBytes            += SumMipBytes(entry.Residency.MipBytes, firstMip);
+
+    // 正常終了.
+    return true;
+}
@@ -0,0 +1,370 @@
+﻿//-----------------------------------------------------------------------------
+// File : TlasInstanceCache.cpp
+// Desc : Top Level Acceleration Structure Instance Cache Module.
+// Copyright(c) Pocol. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include "TlasInstanceCache.h"
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cstring>
+#include <immintrin.h>
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+//      行優先の 4x4 行列を転置して 3x4 のインスタンス変換行列に詰めます.
+//-----------------------------------------------------------------------------
+inline void PackTransform(const DirectX::XMMATRIX& transform, __m128 rows[3])
+{
+    // DirectXMath は行ベクトル形式なので, 転置した上位3行がインスタンス記述子の行になる.
+    auto r0 = transform.r[0];
+    auto r1 = transform.r[1];
+    auto r2 = transform.r[2];
+    auto r3 = transform.r[3];
+    _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+
+    rows[0] = r0;
+    rows[1] = r1;
+    rows[2] = r2;
+}
+
+//-----------------------------------------------------------------------------
+//      AABB の表面積を求めます.
+//-----------------------------------------------------------------------------
+inline double SurfaceArea(__m128 mini, __m128 maxi)
+{
+    alignas(16) float size[4];
+    _mm_store_ps(size, _mm_max_ps(_mm_sub_ps(maxi, mini), _mm_setzero_ps()));
+    return 2.0 * (double(size[0]) * size[1] + double(size[1]) * size[2] + double(size[2]) * size[0]);
+}
+
+//-----------------------------------------------------------------------------
+//      構築時の AABB と現在の AABB の和集合による表面積の増加量を求めます.
+//-----------------------------------------------------------------------------
+inline double GetGrowth(const float* buildMin, const float* buildMax, const float* worldMin, const float* worldMax)
+{
+    auto bmin = _mm_load_ps(buildMin);
+    auto bmax = _mm_load_ps(buildMax);
+    auto umin = _mm_min_ps(bmin, _mm_load_ps(worldMin));
+    auto umax = _mm_max_ps(bmax, _mm_load_ps(worldMax));
+    return SurfaceArea(umin, umax) - SurfaceArea(bmin, bmax);
+}
+
+} // namespace
+
+
+///////////////////////////////////////////////////////////////////////////////
+// TlasInstanceCache class
+///////////////////////////////////////////////////////////////////////////////
+
+//-----------------------------------------------------------------------------
+//      コンストラクタです.
+//-----------------------------------------------------------------------------
+TlasInstanceCache::TlasInstanceCache()
+: m_BufferMask   (1)
+, m_FullWriteMask(1)
+, m_BuildArea    (0.0)
+, m_GrowthArea   (0.0)
+, m_RebuildRatio (DefaultRebuildRatio)
+, m_NeedRebuild  (true)
+{ /* DO_NOTHING */ }
+
+//-----------------------------------------------------------------------------
+//      デストラクタです.
+//-----------------------------------------------------------------------------
+TlasInstanceCache::~TlasInstanceCache()
+{ Clear(); }
+
+//-----------------------------------------------------------------------------
+//      全てのインスタンスを削除します.
+//-----------------------------------------------------------------------------
+void TlasInstanceCache::Clear()
+{
+    m_Descs    .clear();
+    m_Bounds   .clear();
+    m_Dirty    .clear();
+    m_DirtyList.clear();
+    m_StaleMask.clear();
+    m_StaleList.clear();
+
+    m_FullWriteMask = m_BufferMask;
+    m_BuildArea   = 0.0;
+    m_GrowthArea  = 0.0;
+    m_NeedRebuild = true;
+}
+
+//-----------------------------------------------------------------------------
+//      インスタンスを追加します.
+//-----------------------------------------------------------------------------
+uint32_t TlasInstanceCache::AddInstance
+(
+    D3D12_GPU_VIRTUAL_ADDRESS   blas,
+    const DirectX::XMMATRIX&    transform,
+    const TlasInstanceBounds&   bounds,
+    uint32_t                    instanceId,
+    uint32_t                    hitGroupIndex,
+    uint8_t                     mask,
+    uint32_t                    flags
+)
+{
+    auto index = uint32_t(m_Descs.size());
+
+    D3D12_RAYTRACING_INSTANCE_DESC desc = {};
+    desc.InstanceID                          = instanceId;
+    desc.InstanceMask                        = mask;
+    desc.InstanceContributionToHitGroupIndex = hitGroupIndex;
+    desc.Flags                               = flags;
+    desc.AccelerationStructure               = blas;
+
+    __m128 rows[3];
+    PackTransform(transform, rows);
+    _mm_storeu_ps(desc.Transform[0], rows[0]);
+    _mm_storeu_ps(desc.Transform[1], rows[1]);
+    _mm_storeu_ps(desc.Transform[2], rows[2]);
+
+    Bounds box = {};
+    box.LocalCenter[0] = (bounds.Min.x + bounds.Max.x) * 0.5f;
+    box.LocalCenter[1] = (bounds.Min.y + bounds.Max.y) * 0.5f;
+    box.LocalCenter[2] = (bounds.Min.z + bounds.Max.z) * 0.5f;
+    box.LocalExtent[0] = (bounds.Max.x - bounds.Min.x) * 0.5f;
+    box.LocalExtent[1] = (bounds.Max.y - bounds.Min.y) * 0.5f;
+    box.LocalExtent[2] = (bounds.Max.z - bounds.Min.z) * 0.5f;
+
+    m_Descs .push_back(desc);
+    m_Bounds.push_back(box);
+    m_Dirty .push_back(0);
+    m_StaleMask.push_back(0);
+
+    UpdateWorldBounds(index, transform);
+
+    // 構成が変わったのでリフィットはできない.
+    m_NeedRebuild = true;
+
+    return index;
+}
+
+//-----------------------------------------------------------------------------
+//      ワールド行列を設定します.
+//-----------------------------------------------------------------------------
+bool TlasInstanceCache::SetTransform(uint32_t index, const DirectX::XMMATRIX& transform)
+{
+    assert(index < m_Descs.size());
+    auto& desc = m_Descs[index];
+
+    __m128 rows[3];
+    PackTransform(transform, rows);
+
+    // 3行まとめて比較し, 完全に一致すれば何もしない.
+    auto eq = _mm_and_ps(
+        _mm_and_ps(
+            _mm_cmpeq_ps(rows[0], _mm_loadu_ps(desc.Transform[0])),
+            _mm_cmpeq_ps(rows[1], _mm_loadu_ps(desc.Transform[1]))),
+        _mm_cmpeq_ps(rows[2], _mm_loadu_ps(desc.Transform[2])));
+    if (_mm_movemask_ps(eq) == 0xF)
+    { return false; }
+
+    _mm_storeu_ps(desc.Transform[0], rows[0]);
+    _mm_storeu_ps(desc.Transform[1], rows[1]);
+    _mm_storeu_ps(desc.Transform[2], rows[2]);
+
+    UpdateWorldBounds(index, transform);
+
+    if (!m_Dirty[index])
+    {
+        m_Dirty[index] = 1;
+        m_DirtyList.push_back(index);
+    }
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      書き込み先のバッファ数を設定します.
+//-----------------------------------------------------------------------------
+void TlasInstanceCache::SetBufferCount(uint32_t count)
+{
+    count = std::min(std::max(count, 1u), 32u);
+    m_BufferMask = (count == 32) ? ~0u : ((1u << count) - 1);
+
+    // まだ書き込んでいないバッファは全て書き込む.
+    for(auto index : m_StaleList)
+    { m_StaleMask[index] = 0; }
+    m_StaleList.clear();
+    m_FullWriteMask = m_BufferMask;
+}
+
+//-----------------------------------------------------------------------------
+//      リビルドを行う表面積比を設定します.
+//-----------------------------------------------------------------------------
+void TlasInstanceCache::SetRebuildRatio(float ratio)
+{ m_RebuildRatio = std::max(ratio, 1.0f); }
+
+//-----------------------------------------------------------------------------
+//      次の更新方法を求めます.
+//-----------------------------------------------------------------------------
+TlasInstanceCache::UPDATE_MODE TlasInstanceCache::GetUpdateMode(bool allowRefit) const
+{
+    if (m_NeedRebuild)
+    { return UPDATE_MODE_REBUILD; }
+
+    if (m_DirtyList.empty())
+    { return UPDATE_MODE_NONE; }
+
+    if (!allowRefit)
+    { return UPDATE_MODE_REBUILD; }
+
+    if (GetGrowthRatio() > m_RebuildRatio)
+    { return UPDATE_MODE_REBUILD; }
+
+    return UPDATE_MODE_REFIT;
+}
+
+//-----------------------------------------------------------------------------
+//      インスタンス記述子を書き込みます.
+//-----------------------------------------------------------------------------
+uint32_t TlasInstanceCache::Write
+(
+    D3D12_RAYTRACING_INSTANCE_DESC* pDescs,
+    UPDATE_MODE                     mode,
+    uint32_t                        bufferIndex
+)
+{
+    if (pDescs == nullptr || mode == UPDATE_MODE_NONE)
+    { return 0; }
+
+    assert(bufferIndex < 32 && (m_BufferMask & (1u << bufferIndex)) != 0);
+    const auto bit = 1u << bufferIndex;
+
+    uint32_t count = 0;
+
+    if (mode == UPDATE_MODE_REFIT)
+    {
+        // 変更されたインスタンスは全てのバッファに反映する必要がある.
+        for(auto index : m_DirtyList)
+        {
+            if (m_StaleMask[index] == 0)
+            { m_StaleList.push_back(index); }
+
+            m_StaleMask[index] = m_BufferMask;
+            m_Dirty    [index] = 0;
+        }
+
+        // リビルド後に一度も書き込んでいないバッファは全て書き込む.
+        auto full = (m_FullWriteMask & bit) != 0;
+        if (full)
+        {
+            memcpy(pDescs, m_Descs.data(), m_Descs.size() * sizeof(D3D12_RAYTRACING_INSTANCE_DESC));
+            m_FullWriteMask &= ~bit;
+            count = uint32_t(m_Descs.size());
+        }
+
+        // このバッファに未反映のインスタンスだけを書き込む.
+        size_t keep = 0;
+        for(auto index : m_StaleList)
+        {
+            if (!full && (m_StaleMask[index] & bit) != 0)
+            {
+                memcpy(&pDescs[index], &m_Descs[index], sizeof(D3D12_RAYTRACING_INSTANCE_DESC));
+                count++;
+            }
+
+            m_StaleMask[index] &= ~bit;
+            if (m_StaleMask[index] != 0)
+            { m_StaleList[keep++] = index; }
+        }
+        m_StaleList.resize(keep);
+    }
+    else
+    {
+        memcpy(pDescs, m_Descs.data(), m_Descs.size() * sizeof(D3D12_RAYTRACING_INSTANCE_DESC));
+
+        // 現在の配置を基準にし直す.
+        m_BuildArea  = 0.0;
+        m_GrowthArea = 0.0;
+        for(size_t i=0; i<m_Bounds.size(); ++i)
+        {
+            auto& box = m_Bounds[i];
+            _mm_store_ps(box.BuildMin, _mm_load_ps(box.WorldMin));
+            _mm_store_ps(box.BuildMax, _mm_load_ps(box.WorldMax));
+            box.Growth = 0.0;
+
+            m_BuildArea += SurfaceArea(_mm_load_ps(box.BuildMin), _mm_load_ps(box.BuildMax));
+            m_Dirty    [i] = 0;
+            m_StaleMask[i] = 0;
+        }
+        m_StaleList.clear();
+
+        // 他のバッファは次に使うときに全て書き込む.
+        m_FullWriteMask = m_BufferMask & ~bit;
+        m_NeedRebuild   = false;
+        count = uint32_t(m_Descs.size());
+    }
+
+    m_DirtyList.clear();
+    return count;
+}
+
+//-----------------------------------------------------------------------------
+//      インスタンス数を取得します.
+//-----------------------------------------------------------------------------
+uint32_t TlasInstanceCache::GetCount() const
+{ return uint32_t(m_Descs.size()); }
+
+//-----------------------------------------------------------------------------
+//      ダーティなインスタンス数を取得します.
+//-----------------------------------------------------------------------------
+uint32_t TlasInstanceCache::GetDirtyCount() const
+{ return uint32_t(m_DirtyList.size()); }
+
+//-----------------------------------------------------------------------------
+//      構築時に対する現在の表面積比を取得します.
+//-----------------------------------------------------------------------------
+float TlasInstanceCache::GetGrowthRatio() const
+{
+    if (m_BuildArea <= 0.0)
+    { return (m_GrowthArea > 0.0) ? FLT_MAX : 1.0f; }
+
+    return float((m_BuildArea + m_GrowthArea) / m_BuildArea);
+}
+
+//-----------------------------------------------------------------------------
+//      ワールド空間の AABB を更新します.
+//-----------------------------------------------------------------------------
+void TlasInstanceCache::UpdateWorldBounds(uint32_t index, const DirectX::XMMATRIX& transform)
+{
+    auto& box = m_Bounds[index];
+
+    // 中心は行列で変換し, 半径は行列の絶対値で変換する.
+    const auto absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    auto cx = _mm_set1_ps(box.LocalCenter[0]);
+    auto cy = _mm_set1_ps(box.LocalCenter[1]);
+    auto cz = _mm_set1_ps(box.LocalCenter[2]);
+    auto ex = _mm_set1_ps(box.LocalExtent[0]);
+    auto ey = _mm_set1_ps(box.LocalExtent[1]);
+    auto ez = _mm_set1_ps(box.LocalExtent[2]);
+
+    auto center = _mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(cx, transform.r[0]), _mm_mul_ps(cy, transform.r[1])),
+        _mm_add_ps(_mm_mul_ps(cz, transform.r[2]), transform.r[3]));
+    auto extent = _mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(ex, _mm_and_ps(transform.r[0], absMask)),
+                   _mm_mul_ps(ey, _mm_and_ps(transform.r[1], absMask))),
+        _mm_mul_ps(ez, _mm_and_ps(transform.r[2], absMask)));
+
+    _mm_store_ps(box.WorldMin, _mm_sub_ps(center, extent));
+    _mm_store_ps(box.WorldMax, _mm_add_ps(center, extent));
+
+    // 構築前は基準が無いので増加量は数えない.
+    if (m_NeedRebuild)
+    { return; }
+
+    auto growth = GetGrowth(box.BuildMin, box.BuildMax, box.WorldMin, box.WorldMax);
+    m_GrowthArea += growth - box.Growth;
+    box.Growth    = growth;
+}
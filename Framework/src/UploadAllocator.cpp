@@ -0,0 +1,436 @@
+﻿//-----------------------------------------------------------------------------
+// File : UploadAllocator.cpp
+// Desc : Upload Heap Allocator Module.
+// Copyright(c) Pocol. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include "UploadAllocator.h"
+#include <Logger.h>
+#include <cassert>
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+constexpr uint32_t InvalidPage = UINT32_MAX;
+
+//-----------------------------------------------------------------------------
+//      アライメントに切り上げます.
+//-----------------------------------------------------------------------------
+inline uint64_t AlignUp(uint64_t value, uint64_t alignment)
+{ return (value + (alignment - 1)) & ~(alignment - 1); }
+
+} // namespace
+
+
+///////////////////////////////////////////////////////////////////////////////
+// D3D12UploadPageBackend class
+///////////////////////////////////////////////////////////////////////////////
+
+//-----------------------------------------------------------------------------
+//      コンストラクタです.
+//-----------------------------------------------------------------------------
+D3D12UploadPageBackend::D3D12UploadPageBackend()
+: m_pDevice(nullptr)
+{ /* DO_NOTHING */ }
+
+//-----------------------------------------------------------------------------
+//      デストラクタです.
+//-----------------------------------------------------------------------------
+D3D12UploadPageBackend::~D3D12UploadPageBackend()
+{ Term(); }
+
+//-----------------------------------------------------------------------------
+//      初期化処理を行います.
+//-----------------------------------------------------------------------------
+bool D3D12UploadPageBackend::Init(ID3D12Device* pDevice)
+{
+    if (pDevice == nullptr)
+    { return false; }
+
+    m_pDevice = pDevice;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      終了処理を行います.
+//-----------------------------------------------------------------------------
+void D3D12UploadPageBackend::Term()
+{ m_pDevice = nullptr; }
+
+//-----------------------------------------------------------------------------
+//      ページを生成します.
+//-----------------------------------------------------------------------------
+bool D3D12UploadPageBackend::CreatePage(uint64_t size, UploadPage& page)
+{
+    if (m_pDevice == nullptr || size == 0)
+    { return false; }
+
+    // ヒーププロパティ.
+    D3D12_HEAP_PROPERTIES prop = {};
+    prop.Type                   = D3D12_HEAP_TYPE_UPLOAD;
+    prop.CPUPageProperty        = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+    prop.MemoryPoolPreference   = D3D12_MEMORY_POOL_UNKNOWN;
+    prop.CreationNodeMask       = 1;
+    prop.VisibleNodeMask        = 1;
+
+    // リソースの設定.
+    D3D12_RESOURCE_DESC desc = {};
+    desc.Dimension          = D3D12_RESOURCE_DIMENSION_BUFFER;
+    desc.Alignment          = 0;
+    desc.Width              = size;
+    desc.Height             = 1;
+    desc.DepthOrArraySize   = 1;
+    desc.MipLevels          = 1;
+    desc.Format             = DXGI_FORMAT_UNKNOWN;
+    desc.SampleDesc.Count   = 1;
+    desc.SampleDesc.Quality = 0;
+    desc.Layout             = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+    desc.Flags              = D3D12_RESOURCE_FLAG_NONE;
+
+    // リソースを生成.
+    ID3D12Resource* pResource = nullptr;
+    auto hr = m_pDevice->CreateCommittedResource(
+        &prop,
+        D3D12_HEAP_FLAG_NONE,
+        &desc,
+        D3D12_RESOURCE_STATE_GENERIC_READ,
+        nullptr,
+        IID_PPV_ARGS(&pResource));
+    if (FAILED(hr))
+    {
+        ELOG("Error : ID3D12Device::CreateCommittedResource() Failed.");
+        return false;
+    }
+
+    // 永続的にマップしておきます.
+    void* ptr = nullptr;
+    hr = pResource->Map(0, nullptr, &ptr);
+    if (FAILED(hr))
+    {
+        ELOG("Error : ID3D12Resource::Map() Failed.");
+        pResource->Release();
+        return false;
+    }
+
+    page.pResource  = pResource;
+    page.pCpu       = static_cast<uint8_t*>(ptr);
+    page.GpuAddress = pResource->GetGPUVirtualAddress();
+    page.Size       = size;
+
+    // 正常終了.
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      ページを破棄します.
+//-----------------------------------------------------------------------------
+void D3D12UploadPageBackend::DestroyPage(UploadPage& page)
+{
+    if (page.pResource != nullptr)
+    {
+        page.pResource->Unmap(0, nullptr);
+        page.pResource->Release();
+    }
+
+    page = UploadPage();
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// UploadAllocator class
+///////////////////////////////////////////////////////////////////////////////
+
+//-----------------------------------------------------------------------------
+//      コンストラクタです.
+//-----------------------------------------------------------------------------
+UploadAllocator::UploadAllocator()
+: m_pBackend    (nullptr)
+, m_PageSize    (0)
+, m_CurrentPage (InvalidPage)
+{ /* DO_NOTHING */ }
+
+//-----------------------------------------------------------------------------
+//      デストラクタです.
+//-----------------------------------------------------------------------------
+UploadAllocator::~UploadAllocator()
+{ Term(); }
+
+//-----------------------------------------------------------------------------
+//      初期化処理を行います.
+//-----------------------------------------------------------------------------
+bool UploadAllocator::Init(UploadPageBackend* pBackend, uint64_t pageSize)
+{
+    if (pBackend == nullptr || pageSize == 0)
+    { return false; }
+
+    std::lock_guard<std::mutex> locker(m_Mutex);
+    assert(m_pBackend == nullptr);
+
+    m_pBackend    = pBackend;
+    m_PageSize    = AlignUp(pageSize, D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT);
+    m_CurrentPage = InvalidPage;
+
+    // 正常終了.
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      終了処理を行います.
+//-----------------------------------------------------------------------------
+void UploadAllocator::Term()
+{
+    std::lock_guard<std::mutex> locker(m_Mutex);
+
+    for(uint32_t i=0; i<uint32_t(m_Pages.size()); ++i)
+    {
+        if (m_Pages[i].Valid)
+        { DestroyPage(i); }
+    }
+
+    m_Pages       .clear();
+    m_FreePages   .clear();
+    m_FreeSlots   .clear();
+    m_FrameRelease.clear();
+    m_Pending     .clear();
+
+    m_CurrentPage = InvalidPage;
+    m_PageSize    = 0;
+    m_pBackend    = nullptr;
+}
+
+//-----------------------------------------------------------------------------
+//      Free() するまで有効な領域を確保します.
+//-----------------------------------------------------------------------------
+bool UploadAllocator::Allocate(uint64_t size, uint64_t alignment, UploadAllocation& result)
+{
+    std::lock_guard<std::mutex> locker(m_Mutex);
+    return AllocateInternal(size, alignment, result);
+}
+
+//-----------------------------------------------------------------------------
+//      現在のフレームの間だけ有効な領域を確保します.
+//-----------------------------------------------------------------------------
+bool UploadAllocator::AllocateTransient(uint64_t size, uint64_t alignment, UploadAllocation& result)
+{
+    std::lock_guard<std::mutex> locker(m_Mutex);
+    if (!AllocateInternal(size, alignment, result))
+    { return false; }
+
+    // 確保と同時に解放を予約しておく.
+    m_FrameRelease.push_back(result.PageIndex);
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      領域を解放します.
+//-----------------------------------------------------------------------------
+void UploadAllocator::Free(const UploadAllocation& allocation)
+{
+    std::lock_guard<std::mutex> locker(m_Mutex);
+    if (m_pBackend == nullptr || allocation.pResource == nullptr)
+    { return; }
+
+    assert(allocation.PageIndex < m_Pages.size());
+    m_FrameRelease.push_back(allocation.PageIndex);
+}
+
+//-----------------------------------------------------------------------------
+//      フレームを終了します.
+//-----------------------------------------------------------------------------
+void UploadAllocator::FrameEnd(uint64_t fenceValue)
+{
+    std::lock_guard<std::mutex> locker(m_Mutex);
+    if (m_FrameRelease.empty())
+    { return; }
+
+    assert(m_Pending.empty() || m_Pending.back().FenceValue <= fenceValue);
+
+    PendingFrame frame;
+    frame.FenceValue = fenceValue;
+    frame.Pages.swap(m_FrameRelease);
+    m_Pending.push_back(std::move(frame));
+}
+
+//-----------------------------------------------------------------------------
+//      GPUの処理が完了した領域を回収します.
+//-----------------------------------------------------------------------------
+void UploadAllocator::Retire(uint64_t completedValue)
+{
+    std::lock_guard<std::mutex> locker(m_Mutex);
+
+    while(!m_Pending.empty() && m_Pending.front().FenceValue <= completedValue)
+    {
+        for(auto index : m_Pending.front().Pages)
+        { Release(index); }
+
+        m_Pending.pop_front();
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      生成済みのページ数を取得します.
+//-----------------------------------------------------------------------------
+uint32_t UploadAllocator::GetPageCount() const
+{
+    std::lock_guard<std::mutex> locker(m_Mutex);
+    return uint32_t(m_Pages.size() - m_FreeSlots.size());
+}
+
+//-----------------------------------------------------------------------------
+//      ページサイズを取得します.
+//-----------------------------------------------------------------------------
+uint64_t UploadAllocator::GetPageSize() const
+{ return m_PageSize; }
+
+//-----------------------------------------------------------------------------
+//      領域を確保します.
+//-----------------------------------------------------------------------------
+bool UploadAllocator::AllocateInternal(uint64_t size, uint64_t alignment, UploadAllocation& result)
+{
+    if (m_pBackend == nullptr || size == 0)
+    { return false; }
+
+    if (alignment == 0)
+    { alignment = 1; }
+    assert((alignment & (alignment - 1)) == 0);
+
+    uint32_t index  = InvalidPage;
+    uint64_t offset = 0;
+
+    if (AlignUp(size, alignment) > m_PageSize)
+    {
+        // ページに収まらないものは専用ページを割り当てる.
+        if (!CreatePage(AlignUp(size, D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT), true, index))
+        { return false; }
+    }
+    else
+    {
+        if (m_CurrentPage != InvalidPage)
+        {
+            auto& current = m_Pages[m_CurrentPage];
+            offset = AlignUp(current.Offset, alignment);
+            if (offset + size <= current.Page.Size)
+            { index = m_CurrentPage; }
+            else if (current.LiveCount == 0)
+            {
+                // 全て回収済みなので先頭から使い直す.
+                current.Offset = 0;
+                offset = 0;
+                index  = m_CurrentPage;
+            }
+            else
+            {
+                // 割り当て中のページは回収されたときに空きリストに戻る.
+                m_CurrentPage = InvalidPage;
+            }
+        }
+
+        if (index == InvalidPage)
+        {
+            if (!m_FreePages.empty())
+            {
+                index = m_FreePages.back();
+                m_FreePages.pop_back();
+            }
+            else if (!CreatePage(m_PageSize, false, index))
+            { return false; }
+
+            m_CurrentPage = index;
+            offset = 0;
+        }
+    }
+
+    auto& state = m_Pages[index];
+    state.Offset = offset + size;
+    state.LiveCount++;
+
+    result.pResource  = state.Page.pResource;
+    result.pCpu       = state.Page.pCpu + offset;
+    result.GpuAddress = state.Page.GpuAddress + offset;
+    result.Offset     = offset;
+    result.Size       = size;
+    result.PageIndex  = index;
+
+    // 正常終了.
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      ページを生成します.
+//-----------------------------------------------------------------------------
+bool UploadAllocator::CreatePage(uint64_t size, bool dedicated, uint32_t& index)
+{
+    PageState state = {};
+    if (!m_pBackend->CreatePage(size, state.Page))
+    { return false; }
+
+    state.Offset    = 0;
+    state.LiveCount = 0;
+    state.Dedicated = dedicated;
+    state.Valid     = true;
+
+    if (!m_FreeSlots.empty())
+    {
+        index = m_FreeSlots.back();
+        m_FreeSlots.pop_back();
+        m_Pages[index] = state;
+    }
+    else
+    {
+        index = uint32_t(m_Pages.size());
+        m_Pages.push_back(state);
+    }
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      ページを破棄します.
+//-----------------------------------------------------------------------------
+void UploadAllocator::DestroyPage(uint32_t index)
+{
+    auto& state = m_Pages[index];
+    m_pBackend->DestroyPage(state.Page);
+
+    state = PageState();
+    m_FreeSlots.push_back(index);
+}
+
+//-----------------------------------------------------------------------------
+//      割り当てを1つ回収します.
+//-----------------------------------------------------------------------------
+void UploadAllocator::Release(uint32_t index)
+{
+    auto& state = m_Pages[index];
+    assert(state.Valid && state.LiveCount > 0);
+
+    state.LiveCount--;
+    if (state.LiveCount > 0)
+    { return; }
+
+    if (state.Dedicated)
+    {
+        DestroyPage(index);
+        return;
+    }
+
+    // 割り当て中のページはそのまま使い続ける.
+    if (index == m_CurrentPage)
+    { return; }
+
+    if (m_FreePages.size() < MaxFreePages)
+    {
+        state.Offset = 0;
+        m_FreePages.push_back(index);
+    }
+    else
+    {
+        DestroyPage(index);
+    }
+}
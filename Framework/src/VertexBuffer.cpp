@@ -18,7 +18,9 @@
 //      コンストラクタです.
 //-----------------------------------------------------------------------------
 VertexBuffer::VertexBuffer()
-: m_pVB(nullptr)
+: m_pVB         (nullptr)
+, m_pAllocator  (nullptr)
+, m_Allocation  ()
 { memset(&m_View, 0, sizeof(m_View)); }
 
 //-----------------------------------------------------------------------------
@@ -30,12 +32,40 @@ VertexBuffer::~VertexBuffer()
 //-----------------------------------------------------------------------------
 //      初期化処理を行います.
 //-----------------------------------------------------------------------------
-bool VertexBuffer::Init(ID3D12Device* pDevice, size_t size, size_t stride, const void* pInitData)
+bool VertexBuffer::Init
+(
+    ID3D12Device*       pDevice,
+    size_t              size,
+    size_t              stride,
+    const void*         pInitData,
+    UploadAllocator*    pAllocator
+)
 {
     // 引数チェック.
     if (pDevice == nullptr || size == 0 || stride == 0)
     { return false; }
 
+    // アロケータがあればページから切り出す.
+    if (pAllocator != nullptr)
+    {
+        // ストライドは2のべき乗とは限らないので, 要素の最大サイズ(float4)に揃える.
+        if (!pAllocator->Allocate(size, 16, m_Allocation))
+        { return false; }
+
+        m_pAllocator = pAllocator;
+        m_pVB        = m_Allocation.pResource;
+
+        m_View.BufferLocation = m_Allocation.GpuAddress;
+        m_View.StrideInBytes  = UINT(stride);
+        m_View.SizeInBytes    = UINT(size);
+
+        if (pInitData != nullptr)
+        { memcpy(m_Allocation.pCpu, pInitData, size); }
+
+        // 正常終了.
+        return true;
+    }
+
     // ヒーププロパティ.
     D3D12_HEAP_PROPERTIES prop = {};
     prop.Type                   = D3D12_HEAP_TYPE_UPLOAD;
@@ -83,7 +113,7 @@ bool VertexBuffer::Init(ID3D12Device* pDevice, size_t size, size_t stride, const
 
         memcpy(ptr, pInitData, size);
 
-        m_pVB->Unmap(0, nullptr);
+        Unmap();
     }
 
     // 正常終了.
@@ -95,6 +125,14 @@ bool VertexBuffer::Init(ID3D12Device* pDevice, size_t size, size_t stride, const
 //-----------------------------------------------------------------------------
 void VertexBuffer::Term()
 {
+    // アロケータから切り出した領域はアロケータに返却します.
+    if (m_pAllocator != nullptr)
+    {
+        m_pAllocator->Free(m_Allocation);
+        m_pAllocator = nullptr;
+        m_Allocation = UploadAllocation();
+    }
+
     m_pVB.Reset();
     memset(&m_View, 0, sizeof(m_View));
 }
@@ -104,6 +142,9 @@ void VertexBuffer::Term()
 //-----------------------------------------------------------------------------
 void* VertexBuffer::Map()
 {
+    if (m_pAllocator != nullptr)
+    { return m_Allocation.pCpu; }
+
     void* ptr;
     auto hr = m_pVB->Map(0, nullptr, &ptr);
     if (FAILED(hr))
@@ -116,7 +157,13 @@ void* VertexBuffer::Map()
 //      メモリマッピングを解除します.
 //-----------------------------------------------------------------------------
 void VertexBuffer::Unmap()
-{ m_pVB->Unmap(0, nullptr); }
+{
+    // アロケータのページは永続的にマップされています.
+    if (m_pAllocator != nullptr)
+    { return; }
+
+    m_pVB->Unmap(0, nullptr);
+}
 
 //-----------------------------------------------------------------------------
 //      頂点バッファビューを取得します.
@@ -12,6 +12,13 @@
 #include <Material.h>
 #include <ImguiUtil.h>
 #include <WindowEvent.h>
+#include <BlasManager.h>
+#include <DxcShaderCompiler.h>
+#include <FrustumCuller.h>
+#include <GeometryArena.h>
+#include <IndirectDraw.h>
+#include <SceneGraph.h>
+#include <TlasInstanceCache.h>
 #include <optional>
 #include <SimpleMath.h>
 
@@ -24,7 +31,6 @@
 #define IDC_RICHEDIT 101
 
 #include "../extern/nv_helpers_dx12/include/ShaderBindingTableGenerator.h"
-#include "../extern/nv_helpers_dx12/include/TopLevelASGenerator.h"
 
 ///////////////////////////////////////////////////////////////////////////////
 // SampleApp class
@@ -62,15 +68,61 @@ public:
     float                           m_movescale = 10.0f;
     float                           m_LightIntensity = 0.3f;
     float                           m_fovY_degrees = 37.5;
+    bool                            m_OcclusionCulling = false;     // CPU の遮蔽カリングを行うかどうか.
+    CullingStats                    m_CullingStats = {};            // 直前のフレームのカリング統計.
+    float                           m_LodThreshold = 1.0f;          // LOD 選択で許容する誤差のピクセル数.
+    uint32_t                        m_DrawnTriangles = 0;           // 直前のフレームで描画した三角形数.
+    bool                            m_IndirectDraw = true;          // ExecuteIndirect でまとめて描画するかどうか.
+    uint32_t                        m_DrawCalls = 0;                // 直前のフレームで発行したドロー数.
+    bool                            m_PackedVertex = false;         // 20 byte の PackedVertex で描画するかどうか(初期化時のみ参照).
+    float                           m_intensity_environment = 1.0f; // 環境光(IBL)の強度.
+    float                           m_rotation_environment = 0.0f;  // 環境光(IBL)の Y 軸回りの回転角(度).
 
 private:
     //=========================================================================
     // private variables.
     //=========================================================================
+    ///////////////////////////////////////////////////////////////////////////
+    // MeshInstance structure
+    ///////////////////////////////////////////////////////////////////////////
+    struct MeshInstance
+    {
+        uint32_t    Node;       //!< シーングラフのノード番号です.
+        uint32_t    Mesh;       //!< メッシュ番号です.
+    };
+
     std::vector<Mesh*>              m_pMesh;            //!< メッシュです.
+    SceneGraph                      m_SceneGraph;       //!< 変換行列の階層です.
+    uint32_t                        m_RootNode;         //!< 回転させるルートノードです.
+    std::vector<MeshInstance>       m_MeshInstances;    //!< 描画するメッシュインスタンスです.
+    std::vector<D3D12_GPU_VIRTUAL_ADDRESS> m_InstanceTransforms; //!< インスタンスごとの変換行列のアドレスです.
+    std::vector<uint32_t>           m_InstanceLods;     //!< インスタンスごとに選択した詳細度です.
+    GeometryArena                   m_GeometryArena;    //!< 全メッシュを結合した頂点・インデックスバッファです.
+    ComPtr<ID3D12CommandSignature>  m_pDrawSignature;   //!< IndirectDrawArgs を解釈するコマンドシグニチャです.
+    std::vector<IndirectDrawItem>   m_DrawItems;        //!< 可視インスタンスの描画要求です.
+    std::vector<IndirectDrawArgs>   m_DrawArgs;         //!< ExecuteIndirect() に渡すドローの引数です.
+
+    ///////////////////////////////////////////////////////////////////////////
+    // OccluderMesh structure
+    ///////////////////////////////////////////////////////////////////////////
+    struct OccluderMesh
+    {
+        std::vector<DirectX::XMFLOAT3>  Positions;  //!< 頂点位置です.
+        std::vector<uint32_t>           Indices;    //!< 頂点インデックスです.
+    };
+
+    FrustumCuller                   m_Culler;           //!< インスタンスの視錐台カリングです.
+    OcclusionBuffer                 m_OcclusionBuffer;  //!< CPU の遮蔽判定用深度バッファです.
+    std::vector<OccluderMesh>       m_Occluders;        //!< 遮蔽物として描画するメッシュです.
+    std::vector<uint32_t>           m_VisibleInstances; //!< 可視のメッシュインスタンス番号です.
     std::vector<ConstantBuffer*>    m_Transform;        //!< 変換行列です.
-    ConstantBuffer*                 m_pLight;           //!< ライトです.
+    std::vector<ConstantBuffer*>    m_Light;            //!< ライトです.
     Material                        m_Material;         //!< マテリアルです.
+    Texture                         m_IblBrdfLut;       //!< スプリットサム近似の BRDF LUT です.
+    Texture                         m_IblSpecular;      //!< 事前フィルタ済みの環境キューブマップです.
+    Texture                         m_IblIrradiance;    //!< 放射照度の球面調和係数です.
+    uint32_t                        m_IblMaps[4];       //!< IBL テクスチャのディスクリプタ番号です.
+    uint32_t                        m_IblMipLevels;     //!< 事前フィルタ済みキューブマップのミップ数です.
     ComPtr<ID3D12PipelineState>     m_pPSO;             //!< パイプラインステートです.
     ComPtr<ID3D12RootSignature>     m_pRootSig;         //!< ルートシグニチャです.
     float                           m_RotateAngle;      //!< 回転角です.      
@@ -100,8 +152,6 @@ private:
     bool                            m_ShiftPush = false;
 
     float                           m_RotateAngle_right;// 回転角です.
-    float                           m_intensity_environment = 1.0f;
-    float                           m_rotation_environment = 0.0f;
 
     int                             m_xPos = 0;
     int                             m_yPos = 0;
@@ -203,9 +253,14 @@ private:
 
     ComPtr<ID3D12Resource> m_bottomLevelAS; // Storage for the bottom Level AS
 
-    nv_helpers_dx12::TopLevelASGenerator m_topLevelASGenerator;
     AccelerationStructureBuffers m_topLevelASBuffers;
+    ComPtr<ID3D12Resource> m_tlasInstanceDescs[FrameCount];  // フレームごとのインスタンス記述子です.
     std::vector<std::pair<ComPtr<ID3D12Resource>, DirectX::XMMATRIX>> m_instances;
+    std::vector<TlasInstanceBounds> m_instanceBounds;  // m_instances と同じ順の BLAS ローカル AABB.
+    TlasInstanceCache m_tlasInstances;                 // 変更されたインスタンスだけを書き込む.
+    BlasManager m_BlasManager;                         // 読み込んだメッシュの圧縮済み BLAS.
+    std::vector<uint32_t> m_MeshBlasIndex;             // メッシュごとの BLAS 番号. 圧縮頂点のメッシュは UINT32_MAX.
+    std::vector<uint32_t> m_TlasMeshNodes;             // TLAS に配置したメッシュのノード番号. m_instances の後に並ぶ.
 
     /// Create the acceleration structure of an instance
     ///
@@ -220,7 +275,8 @@ private:
     /// all instances of the scene
     /// \param     instances : pair of BLAS and transform
     // #DXR Extra - Refitting
-    /// \param     updateOnly: if true, perform a refit instead of a full build
+    /// \param     updateOnly: if true, only changed transforms are uploaded and
+    ///                        TlasInstanceCache picks refit, rebuild or nothing
     void CreateTopLevelAS(
         const std::vector<std::pair<ComPtr<ID3D12Resource>, DirectX::XMMATRIX>>
         & instances,
@@ -238,6 +294,10 @@ private:
 
     void CreateRaytracingPipeline();
 
+    // シェーダライブラリのコンパイル結果をディスクにキャッシュする.
+    DxcShaderCompiler m_ShaderCompiler;
+    ShaderCache m_ShaderCache;
+
     //HLSLのコードをGPUが理解できるようにBlobデータ形式に変換
     ComPtr<IDxcBlob> m_rayGenLibrary;
     ComPtr<IDxcBlob> m_hitLibrary;
@@ -262,14 +322,14 @@ private:
     // #DXR
     void CreateShaderBindingTable();
     nv_helpers_dx12::ShaderBindingTableGenerator m_sbtHelper;
-    ComPtr<ID3D12Resource> m_sbtStorage;
+    ComPtr<ID3D12Resource> m_sbtStorage[FrameCount];  // フレームごとのカメラバッファを参照します.
 
     // #DXR Extra: Perspective Camera
     void CreateCameraBuffer();
     void UpdateCameraBuffer();
     ComPtr<ID3D12Resource> m_cameraBuffer;
     ComPtr<ID3D12DescriptorHeap> m_constHeap;
-    uint32_t m_cameraBufferSize = 0;
+    uint32_t m_cameraBufferSize = 0;    // 1フレーム分のサイズです. バッファは FrameCount 倍あります.
 
     // #DXR Extra: Perspective Camera++
     //void OnButtonDown(UINT32 lParam);
@@ -7,6 +7,7 @@
 //-----------------------------------------------------------------------------
 // Constant Values
 //-----------------------------------------------------------------------------
+// BRDF 項を変更した場合は CPU 側の Framework/include/BRDF.h も合わせて更新すること.
 static const float F_PI = 3.141596535f;
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -40,27 +41,41 @@ cbuffer LightBuffer : register( b1 )
     float3 LightPosition : packoffset(c0);
     float4 LightColor : packoffset(c1);
     float3 CameraPosition : packoffset(c2);
+    float4 IblParam : packoffset(c3);   // x:強度, y:回転角(ラジアン), z:最大ミップレベル
+    uint4  IblMaps : packoffset(c4);    // x:BRDF LUT, y:事前フィルタ済みキューブマップ, z:放射照度 SH9
 };
 
 ///////////////////////////////////////////////////////////////////////////////
-// MaterialBuffer
+// MaterialEntry structure
 ///////////////////////////////////////////////////////////////////////////////
-cbuffer MaterialBuffer : register( b2 )
+// CPU 側の Framework/include/MaterialTable.h と同じレイアウトにすること.
+struct MaterialEntry
 {
-    float3 BaseColor : packoffset( c0 );    
-    float  Alpha     : packoffset( c1.w );  
-    float  Roughness : packoffset( c1 );    
-    float  Metallic  : packoffset( c1.y );  
+    float3  BaseColor;
+    float   Alpha;
+    float   Roughness;
+    float   Metallic;
+    float   Occlusion;
+    uint3   Maps;       // x:BaseColor, y:Normal, z:ORM (r:Occlusion, g:Roughness, b:Metallic)
+    uint2   Reserved;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// DrawConstants
+///////////////////////////////////////////////////////////////////////////////
+cbuffer DrawConstants : register( b2 )
+{
+    uint MaterialIndex;
 };
 
 //-----------------------------------------------------------------------------
 // Textures and Samplers
 //-----------------------------------------------------------------------------
-SamplerState WrapSmp  : register( s0 );
-Texture2D    BaseColorMap : register( t0 );
-Texture2D    NormalMap : register( t1 );
-Texture2D    RoughnessMap : register( t2 );
-Texture2D    MetallicMap : register( t3 );
+SamplerState                    WrapSmp    : register( s0 );
+SamplerState                    ClampSmp   : register( s1 );
+StructuredBuffer<MaterialEntry> Materials  : register( t0 );
+Texture2D                       Textures[] : register( t0, space1 );
+TextureCube                     Cubes[]    : register( t0, space2 );
 
 //-----------------------------------------------------------------------------
 //      Schlick
@@ -90,6 +105,35 @@ float G2_Smith(float NL, float NV, float m2)
     return G_light * G_view;
 }
 
+//-----------------------------------------------------------------------------
+//      環境光の回転を適用します.
+//-----------------------------------------------------------------------------
+float3 RotateEnvironment(float3 dir)
+{
+    float s, c;
+    sincos(IblParam.y, s, c);
+    return float3(c * dir.x - s * dir.z, dir.y, s * dir.x + c * dir.z);
+}
+
+//-----------------------------------------------------------------------------
+//      球面調和係数から放射照度を求めます.
+//-----------------------------------------------------------------------------
+// 係数の並びと定数は Framework/src/IblBaker.cpp の EvaluateIrradianceSH9() と合わせること.
+float3 EvaluateIrradianceSH9(float3 n)
+{
+    Texture2D sh = Textures[IblMaps.z];
+    float3 result = sh.Load(int3(0, 0, 0)).rgb * 0.282095f;
+    result += sh.Load(int3(1, 0, 0)).rgb * (0.488603f * n.y);
+    result += sh.Load(int3(2, 0, 0)).rgb * (0.488603f * n.z);
+    result += sh.Load(int3(3, 0, 0)).rgb * (0.488603f * n.x);
+    result += sh.Load(int3(4, 0, 0)).rgb * (1.092548f * n.x * n.y);
+    result += sh.Load(int3(5, 0, 0)).rgb * (1.092548f * n.y * n.z);
+    result += sh.Load(int3(6, 0, 0)).rgb * (0.315392f * (3.0f * n.z * n.z - 1.0f));
+    result += sh.Load(int3(7, 0, 0)).rgb * (1.092548f * n.x * n.z);
+    result += sh.Load(int3(8, 0, 0)).rgb * (0.546274f * (n.x * n.x - n.y * n.y));
+    return max(result, 0.0f);
+}
+
 //-----------------------------------------------------------------------------
 //      main
 //-----------------------------------------------------------------------------
@@ -98,7 +142,7 @@ PSOutput main(VSOutput input)
     PSOutput output = (PSOutput)0;
     float2 uv = float2(input.TexCoord.x, 1.0f - input.TexCoord.y);
     
-    //float3 N = NormalMap.Sample(WrapSmp, uv /*input.TexCoord*/).xyz * 2.0f - 1.0f;
+    //float3 N = Textures[material.Maps.y].Sample(WrapSmp, uv /*input.TexCoord*/).xyz * 2.0f - 1.0f;
     //N = normalize(mul(input.InvTangentBasis, N));
     
     float3 N = normalize(input.Normal);
@@ -111,9 +155,14 @@ PSOutput main(VSOutput input)
     float NL = saturate(dot(N, L));
     float VH = saturate(dot(V, H));
     
-    float4 basecolor = BaseColorMap.Sample(WrapSmp, uv);
-    float roughness = RoughnessMap.Sample(WrapSmp, uv).r;
-    float metallic = MetallicMap.Sample(WrapSmp, uv).r;
+    // マテリアル番号は描画ごとに一様なので NonUniformResourceIndex は不要.
+    MaterialEntry material = Materials[MaterialIndex];
+
+    float4 basecolor = Textures[material.Maps.x].Sample(WrapSmp, uv) * float4(material.BaseColor, 1.0f);
+    float3 orm = Textures[material.Maps.z].Sample(WrapSmp, uv).rgb;
+    float roughness = orm.g * material.Roughness;
+    float metallic = orm.b * material.Metallic;
+    float occlusion = lerp(1.0f, orm.r, material.Occlusion);
     float3 Kd = basecolor * (1.0f - metallic);
     
     float3 diffuse  = Kd * (1.0 / F_PI);
@@ -140,7 +189,16 @@ PSOutput main(VSOutput input)
     float3 L_color = LightColor.rgb;
     float L_intensity = LightColor.a;
     
-    output.Color = float4((diffuse + specular) * L_color * L_intensity * saturate(NL), basecolor.a * Alpha);
+    float3 direct = (diffuse + specular) * L_color * L_intensity * saturate(NL);
+
+    // スプリットサム近似の環境光. LUT と事前フィルタは CPU 側で BRDF.h と同じ項から生成している.
+    float3 R = reflect(-V, N);
+    float2 brdf       = Textures[IblMaps.x].SampleLevel(ClampSmp, float2(NV, roughness), 0).rg;
+    float3 prefilter  = Cubes[IblMaps.y].SampleLevel(ClampSmp, RotateEnvironment(R), roughness * IblParam.z).rgb;
+    float3 irradiance = EvaluateIrradianceSH9(RotateEnvironment(N));
+    float3 ambient    = (Kd * irradiance * (1.0f / F_PI) + prefilter * (F0 * brdf.x + brdf.y)) * occlusion;
+
+    output.Color = float4(direct + ambient * IblParam.x, basecolor.a * material.Alpha);
 
     return output;
 }
@@ -4,6 +4,11 @@
 // Copyright(c) Pocol. All right reserved.
 //-----------------------------------------------------------------------------
 
+#ifdef PACKED_VERTEX
+// PackedVertex (20 byte) で入力する場合は PACKED_VERTEX を定義してコンパイルします.
+#include "PackedVertex.hlsli"
+#endif//PACKED_VERTEX
+
 ///////////////////////////////////////////////////////////////////////////////
 // VSInput structure
 ///////////////////////////////////////////////////////////////////////////////
@@ -37,13 +42,29 @@ cbuffer Transform : register( b0 )
     float4x4 Proj  : packoffset( c8 ); // �ˉe�s��ł�.
     //float4x4 InvView : packoffset( c12 );
     //float4x4 InvProj : packoffset( c16 );
+    float4   QuantOffset : packoffset( c21 );  // PackedVertex の位置の復元オフセットです.
+    float4   QuantScale  : packoffset( c22 );  // PackedVertex の位置の復元スケールです.
 }
 
 //-----------------------------------------------------------------------------
 //      main(TBN)
 //-----------------------------------------------------------------------------
+#ifdef PACKED_VERTEX
+VSOutput main( PackedVSInput packed )
+{
+    // 復元して通常の頂点と同じ処理に流す.
+    VSInput input;
+    input.Position = DecodePosition( packed.Position, QuantOffset.xyz, QuantScale.xyz );
+    input.Normal   = DecodeOctahedral( packed.Normal );
+    input.Tangent  = DecodeOctahedral( packed.Tangent );
+    input.TexCoord = packed.TexCoord;
+    float tangentSign = DecodeTangentSign( packed.Position );
+#else
 VSOutput main( VSInput input )
 {
+    float tangentSign = 1.0f;
+#endif//PACKED_VERTEX
+
     VSOutput output = (VSOutput)0;
 
     float4 localPos = float4( input.Position, 1.0f );
@@ -58,7 +79,7 @@ VSOutput main( VSInput input )
     
     float3 N = normalize(mul((float3x3)World, input.Normal));
     float3 T = normalize(mul((float3x3)World, input.Tangent));
-    float3 B = normalize(cross(N, T));
+    float3 B = normalize(cross(N, T)) * tangentSign;
     output.InvTangentBasis = transpose(float3x3(T, B, N));
 
     return output;
@@ -0,0 +1,46 @@
+//-----------------------------------------------------------------------------
+// File : PackedVertex.hlsli
+// Desc : Packed Vertex Decoding.
+// Copyright(c) Pocol. All right reserved.
+//-----------------------------------------------------------------------------
+// CPU 側の Framework/src/PackedVertex.cpp と同じ復元処理です. 変更する場合は両方を更新すること.
+
+///////////////////////////////////////////////////////////////////////////////
+// PackedVSInput structure
+///////////////////////////////////////////////////////////////////////////////
+struct PackedVSInput
+{
+    float4  Position : POSITION;    // R16G16B16A16_UNORM. xyz は量子化位置, w は接線の符号です.
+    float2  Normal   : NORMAL;      // R16G16_SNORM. 八面体エンコードした法線です.
+    float2  Tangent  : TANGENT;     // R16G16_SNORM. 八面体エンコードした接線です.
+    float2  TexCoord : TEXCOORD;    // R16G16_FLOAT. テクスチャ座標です.
+};
+
+//-----------------------------------------------------------------------------
+//      八面体エンコードされたベクトルを復元します.
+//-----------------------------------------------------------------------------
+float3 DecodeOctahedral(float2 e)
+{
+    float3 v = float3(e.xy, 1.0f - abs(e.x) - abs(e.y));
+    if (v.z < 0.0f)
+    {
+        float2 s = float2(e.x >= 0.0f ? 1.0f : -1.0f, e.y >= 0.0f ? 1.0f : -1.0f);
+        v.xy = (1.0f - abs(e.yx)) * s;
+    }
+    return normalize(v);
+}
+
+//-----------------------------------------------------------------------------
+//      量子化された位置を復元します.
+//-----------------------------------------------------------------------------
+float3 DecodePosition(float4 position, float3 offset, float3 scale)
+{
+    // UNORM は [0, 1] で読み込まれるので 65535 を掛けて量子化値に戻します.
+    return offset + position.xyz * 65535.0f * scale;
+}
+
+//-----------------------------------------------------------------------------
+//      接線の符号を復元します.
+//-----------------------------------------------------------------------------
+float DecodeTangentSign(float4 position)
+{ return (position.w >= 0.5f) ? 1.0f : -1.0f; }
@@ -130,6 +130,36 @@ void ImGuiUtil::ShowPanel(uint32_t W, uint32_t H, RENDER_TYPE& type, SampleApp*
         ImGui::TreePop();
     }
 
+    if (ImGui::TreeNode("Culling")) {
+        ImGui::Checkbox("Occlusion Culling", &(app->m_OcclusionCulling));
+
+        const auto& stats = app->m_CullingStats;
+        ImGui::Text("Tested    : %u", stats.Tested);
+        ImGui::Text("Frustum   : %u", stats.FrustumCulled);
+        ImGui::Text("Occlusion : %u", stats.OcclusionCulled);
+        ImGui::Text("Visible   : %u", stats.Visible);
+        ImGui::TreePop();
+    }
+
+    if (ImGui::TreeNode("LOD")) {
+        ImGui::SliderFloat("Error Threshold (px)", &(app->m_LodThreshold), 0.0f, 8.0f);
+        ImGui::Text("Triangles : %u", app->m_DrawnTriangles);
+        ImGui::TreePop();
+    }
+
+    if (ImGui::TreeNode("Draw")) {
+        ImGui::Checkbox("Indirect Draw", &(app->m_IndirectDraw));
+        ImGui::Text("Draw Calls : %u", app->m_DrawCalls);
+        ImGui::Text("Vertex : %s", app->m_PackedVertex ? "PackedVertex (20 byte)" : "MeshVertex (44 byte)");
+        ImGui::TreePop();
+    }
+
+    if (ImGui::TreeNode("IBL")) {
+        ImGui::SliderFloat("Intensity", &(app->m_intensity_environment), 0.0f, 4.0f, "%.2f");
+        ImGui::SliderFloat("Rotation (deg)", &(app->m_rotation_environment), 0.0f, 360.0f, "%.1f");
+        ImGui::TreePop();
+    }
+
     //static char importpath_mesh[256] = "";
     //ImGui::Text("Import Mesh");
     //ImGui::InputText("##File Path_mesh", importpath_mesh, sizeof(importpath_mesh));
@@ -19,6 +19,8 @@
 #include "ImguiUtil.h"
 #include <iostream>
 #include <EnumUtil.h>
+#include <IblBaker.h>
+#include <OrmPacker.h>
 #include <windows.h>
 #include <shellapi.h>
 #include <tchar.h>
@@ -42,6 +44,11 @@ using namespace DirectX::SimpleMath;
 
 namespace {
 
+//-----------------------------------------------------------------------------
+// Constant Values
+//-----------------------------------------------------------------------------
+constexpr uint64_t SkySourceKey = 1;    // SkyRadiance() を変更したら更新すること.
+
 ///////////////////////////////////////////////////////////////////////////////
 // Transform structure
 ///////////////////////////////////////////////////////////////////////////////
@@ -53,6 +60,8 @@ struct Transform
     Matrix   InvView;    //!< ビュー行列の逆行列です.
     Matrix   InvProj;    //!< 射影行列の逆行列です.
     Vector4  CameraPos;
+    Vector4  QuantOffset;   //!< PackedVertex の位置の復元オフセットです(xyz).
+    Vector4  QuantScale;    //!< PackedVertex の位置の復元スケールです(xyz).
 };
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -63,18 +72,18 @@ struct LightBuffer
     Vector4  LightPosition;     //!< ライト位置です.
     Color    LightColor;        //!< ライトカラーです.
     Vector4  CameraPosition;    //!< カメラ位置です.
+    Vector4  IblParam;          //!< x:環境光の強度, y:回転角(ラジアン), z:最大ミップレベルです.
+    uint32_t IblMaps[4];        //!< x:BRDF LUT, y:事前フィルタ済みキューブマップ, z:放射照度のディスクリプタ番号です.
 };
 
-///////////////////////////////////////////////////////////////////////////////
-// MaterialBuffer structure
-///////////////////////////////////////////////////////////////////////////////
-struct MaterialBuffer
+//-----------------------------------------------------------------------------
+//      空の放射輝度を求めます. Miss.hlsl の背景と同じグラデーションです.
+//-----------------------------------------------------------------------------
+DirectX::XMFLOAT3 SkyRadiance(const DirectX::XMFLOAT3& dir)
 {
-    Vector3 BaseColor;  //!< 基本色.
-    float   Alpha;      //!< 透過度.
-    float   Roughness;  //!< 面の粗さです(範囲は[0,1]).
-    float   Metallic;   //!< 金属度です(範囲は[0,1]).
-};
+    auto t = 0.5f * (1.0f - dir.y);
+    return DirectX::XMFLOAT3(1.0f - 0.2f * t, 1.0f - 0.3f * t, 1.0f - 0.4f * t);
+}
 
 } // namespace
 
@@ -86,18 +95,29 @@ DWORD CALLBACK MyReadProc(DWORD_PTR dwCookie, LPBYTE pbBuf, LONG cb, LONG* pcb);
 void SetTextureSet(
     const std::wstring& base_path,
     Material& material,
-    DirectX::ResourceUploadBatch& batch
+    TextureStreamer& streamer
 )
 {
     std::wstring pathBC = base_path + L"basecolor.dds";
     std::wstring pathM = base_path + L"metallic.dds";
     std::wstring pathR = base_path + L"roughness.dds";
     std::wstring pathN = base_path + L"normal.dds";
-
-    material.SetTexture(0, TU_BASE_COLOR, pathBC, batch);
-    material.SetTexture(0, TU_METALLIC, pathM, batch);
-    material.SetTexture(0, TU_ROUGHNESS, pathR, batch);
-    material.SetTexture(0, TU_NORMAL, pathN, batch);
+    std::wstring pathAO = base_path + L"ao.dds";
+
+    // オクルージョン・ラフネス・メタリックは1枚の ORM テクスチャに詰めてから読み込みます.
+    OrmSourcePaths ormSources;
+    ormSources.Paths[ORM_CHANNEL_OCCLUSION] = pathAO;
+    ormSources.Paths[ORM_CHANNEL_ROUGHNESS] = pathR;
+    ormSources.Paths[ORM_CHANNEL_METALLIC]  = pathM;
+
+    std::wstring pathORM;
+    if (!PrepareOrmTexture(ormSources, pathORM))
+    { DLOG( "Warning : PrepareOrmTexture() Failed. base_path = %ls", base_path.c_str() ); }
+
+    // 末尾ミップだけを常駐させ, 詳細なミップは画面上の大きさに応じて毎フレーム要求します.
+    material.SetTextureStreamed(0, TU_BASE_COLOR, pathBC, &streamer);
+    material.SetTextureStreamed(0, TU_ORM, pathORM, &streamer);
+    material.SetTextureStreamed(0, TU_NORMAL, pathN, &streamer);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -109,7 +129,10 @@ void SetTextureSet(
 //-----------------------------------------------------------------------------
 SampleApp::SampleApp(uint32_t width, uint32_t height)
 : App(width, height)
+, m_RootNode(SceneGraph::InvalidNode)
 , m_RotateAngle(0.0)
+, m_IblMaps{}
+, m_IblMipLevels(1)
 { /* DO_NOTHING */ }
 
 //-----------------------------------------------------------------------------
@@ -203,9 +226,11 @@ bool SampleApp::OnInit()
 
         std::vector<ResMesh>        resMesh;
         std::vector<ResMaterial>    resMaterial;
+        std::vector<ResNode>        resNode;
         
-        // メッシュリソースをロード.
-        if (!LoadMesh(path.c_str(), resMesh, resMaterial))
+        // メッシュリソースをロード. ノード階層はシーングラフで扱うので頂点には焼き込まない.
+        // メッシュレットと LOD もここで生成し, キャッシュに含めておく.
+        if (!LoadMesh(path.c_str(), resMesh, resMaterial, resNode, true, true, true))
         {
             ELOG("Error : Load Mesh Failed. filepath = %ls", path.c_str());
             return false;
@@ -228,7 +253,7 @@ bool SampleApp::OnInit()
             }
 
             // 初期化処理.
-            if (!mesh->Init(m_pDevice.Get(), resMesh[i]))
+            if (!mesh->Init(m_pDevice.Get(), resMesh[i], m_PackedVertex, &m_UploadAllocator))
             {
                 ELOG( "Error : Mesh Initialize Failed.");
                 delete mesh;
@@ -242,53 +267,146 @@ bool SampleApp::OnInit()
         // メモリ最適化.
         m_pMesh.shrink_to_fit();
 
-        // マテリアル初期化.
+        // ExecuteIndirect() で描画できるように全メッシュを1組のバッファにまとめる.
+        if (!m_GeometryArena.Init(m_pDevice.Get(), resMesh, m_PackedVertex))
+        {
+            ELOG( "Error : GeometryArena::Init() Failed.");
+            return false;
+        }
+
+        // 遮蔽カリング用に位置だけCPU側に残しておく.
+        m_Occluders.resize(resMesh.size());
+        for (size_t i = 0; i < resMesh.size(); ++i)
+        {
+            auto& occluder = m_Occluders[i];
+            occluder.Positions.resize(resMesh[i].Vertices.size());
+            for (size_t j = 0; j < resMesh[i].Vertices.size(); ++j)
+            { occluder.Positions[j] = resMesh[i].Vertices[j].Position; }
+            occluder.Indices = resMesh[i].Indices;
+        }
+
+        if (!m_OcclusionBuffer.Init())
+        {
+            ELOG( "Error : OcclusionBuffer::Init() Failed.");
+            return false;
+        }
+
+        // シーングラフを構築. ルートノードの下に読み込んだ階層をぶら下げる.
+        m_SceneGraph.Clear();
+        m_RootNode = m_SceneGraph.AddNode(SceneGraph::InvalidNode, DirectX::XMMatrixIdentity());
+
+        auto firstNode = m_SceneGraph.AddNodes(resNode, m_RootNode);
+        if (firstNode == SceneGraph::InvalidNode)
+        {
+            ELOG( "Error : SceneGraph::AddNodes() Failed.");
+            return false;
+        }
+
+        // 同じメッシュを参照するノードはジオメトリを共有したインスタンスになる.
+        m_MeshInstances.clear();
+        for (size_t i = 0; i < resNode.size(); ++i)
+        {
+            for (auto meshId : resNode[i].Meshes)
+            {
+                if (meshId < m_pMesh.size())
+                { m_MeshInstances.push_back({ firstNode + uint32_t(i), meshId }); }
+            }
+        }
+
+        // マテリアル初期化. パラメータはマテリアルテーブルに詰めるので定数バッファは作らない.
         if (!m_Material.Init(
             m_pDevice.Get(),
             m_pPool[POOL_TYPE_RES],
-            sizeof(MaterialBuffer),
-            resMaterial.size()))
+            0,
+            resMaterial.size(),
+            &m_UploadAllocator))
         {
             ELOG( "Error : Material::Init() Failed.");
             return false;
         }
 
+        // IBL テクスチャを生成. キャッシュがあれば生成を省略します.
+        IblBakeDesc iblDesc;
+        auto iblPaths = GetIblCachePaths(L"../../../Sample/res/sky", SkySourceKey, iblDesc);
+        if (!BakeIbl(SkyRadiance, iblDesc, iblPaths))
+        {
+            ELOG( "Error : BakeIbl() Failed.");
+            return false;
+        }
+        m_IblMipLevels = iblDesc.SpecularMipLevels;
+
         // リソースバッチを用意.
         DirectX::ResourceUploadBatch batch(m_pDevice.Get());
 
         // バッチ開始.
         batch.Begin();
 
-        SetTextureSet(L"../../../Sample/res/buster_sword/", m_Material, batch);
+        SetTextureSet(L"../../../Sample/res/buster_sword/", m_Material, m_TextureStreamer);
+
+        // 要求したテクスチャをまとめて登録. 失敗したものはダミーテクスチャで描画します.
+        if (!m_Material.CommitTextures(batch))
+        { DLOG( "Warning : Material::CommitTextures() Failed." ); }
+
+        if (!m_IblBrdfLut   .Init(m_pDevice.Get(), m_pPool[POOL_TYPE_RES], iblPaths.BrdfLut   .c_str(), false, batch)
+         || !m_IblSpecular  .Init(m_pDevice.Get(), m_pPool[POOL_TYPE_RES], iblPaths.Specular  .c_str(), false, batch)
+         || !m_IblIrradiance.Init(m_pDevice.Get(), m_pPool[POOL_TYPE_RES], iblPaths.Irradiance.c_str(), false, batch))
+        {
+            ELOG( "Error : Texture::Init() Failed.");
+            return false;
+        }
         // バッチ終了.
         auto future = batch.End(m_pQueue.Get());
 
         // バッチ完了を待機.
         future.wait();
-    }
 
-    // ライトバッファの設定.
-    {
-        auto pCB = new (std::nothrow) ConstantBuffer();
-        if (pCB == nullptr)
+        // テクスチャ番号が確定したのでマテリアルテーブルを構築.
+        if (!m_Material.CommitTable())
         {
-            ELOG( "Error : Out of memory." );
+            ELOG( "Error : Material::CommitTable() Failed.");
             return false;
         }
 
-        if (!pCB->Init(m_pDevice.Get(), m_pPool[POOL_TYPE_RES], sizeof(LightBuffer)))
+        // シェーダからはマテリアルと同じくヒープ先頭からの番号で参照する.
+        m_IblMaps[0] = m_pPool[POOL_TYPE_RES]->GetHandleIndex(m_IblBrdfLut   .GetHandleGPU());
+        m_IblMaps[1] = m_pPool[POOL_TYPE_RES]->GetHandleIndex(m_IblSpecular  .GetHandleGPU());
+        m_IblMaps[2] = m_pPool[POOL_TYPE_RES]->GetHandleIndex(m_IblIrradiance.GetHandleGPU());
+        if (m_IblMaps[0] == UINT32_MAX || m_IblMaps[1] == UINT32_MAX || m_IblMaps[2] == UINT32_MAX)
         {
-            ELOG( "Error : ConstantBuffer::Init() Failed." );
+            ELOG( "Error : IBL texture is not in the shader visible descriptor heap." );
             return false;
         }
+    }
 
-        auto ptr = pCB->GetPtr<LightBuffer>();
-        
-        ptr->LightPosition  = Vector4(0.0f, -100.0f, 1500.0f, 0.0);//Vector4(m_eyePos.x, m_eyePos.y, m_eyePos.z + 10000.0f, 0.0f);
-        ptr->LightColor     = Color(1.0f,  1.0f, 1.0f, m_LightIntensity);
-        m_eyePos = Vector3(0.0f, 0.0f, 3.0f);
-        ptr->CameraPosition = Vector4(m_eyePos.x, m_eyePos.y, m_eyePos.z, 0.0f);//ptr->CameraPosition = Vector4(0.0f, 0.0f, 3.0f, 0.0f);
-        m_pLight = pCB;
+    // ライトバッファの設定.
+    {
+        m_Light.reserve(FrameCount);
+
+        for(auto i=0u; i<FrameCount; ++i)
+        {
+            auto pCB = new (std::nothrow) ConstantBuffer();
+            if (pCB == nullptr)
+            {
+                ELOG( "Error : Out of memory." );
+                return false;
+            }
+
+            if (!pCB->Init(m_pDevice.Get(), m_pPool[POOL_TYPE_RES], sizeof(LightBuffer), &m_UploadAllocator))
+            {
+                ELOG( "Error : ConstantBuffer::Init() Failed." );
+                return false;
+            }
+
+            auto ptr = pCB->GetPtr<LightBuffer>();
+
+            ptr->LightPosition  = Vector4(0.0f, -100.0f, 1500.0f, 0.0);//Vector4(m_eyePos.x, m_eyePos.y, m_eyePos.z + 10000.0f, 0.0f);
+            ptr->LightColor     = Color(1.0f,  1.0f, 1.0f, m_LightIntensity);
+            m_eyePos = Vector3(0.0f, 0.0f, 3.0f);
+            ptr->CameraPosition = Vector4(m_eyePos.x, m_eyePos.y, m_eyePos.z, 0.0f);//ptr->CameraPosition = Vector4(0.0f, 0.0f, 3.0f, 0.0f);
+            ptr->IblParam       = Vector4(m_intensity_environment, DirectX::XMConvertToRadians(m_rotation_environment), float(m_IblMipLevels - 1), 0.0f);
+            memcpy(ptr->IblMaps, m_IblMaps, sizeof(m_IblMaps));
+            m_Light.push_back(pCB);
+        }
     }
 
     // ルートシグニチャの生成.
@@ -299,33 +417,23 @@ bool SampleApp::OnInit()
         flag |= D3D12_ROOT_SIGNATURE_FLAG_DENY_GEOMETRY_SHADER_ROOT_ACCESS;
 
         // ディスクリプタレンジを設定.
-        D3D12_DESCRIPTOR_RANGE range[4] = {};
-        range[0].RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
-        range[0].NumDescriptors = 1;
-        range[0].BaseShaderRegister = 0;
-        range[0].RegisterSpace = 0;
-        range[0].OffsetInDescriptorsFromTableStart = 0;
-
-        range[1].RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
-        range[1].NumDescriptors = 1;
-        range[1].BaseShaderRegister = 1;
-        range[1].RegisterSpace = 0;
-        range[1].OffsetInDescriptorsFromTableStart = 0;
-
-        range[2].RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
-        range[2].NumDescriptors = 1;
-        range[2].BaseShaderRegister = 2;
-        range[2].RegisterSpace = 0;
-        range[2].OffsetInDescriptorsFromTableStart = 0;
-
-        range[3].RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
-        range[3].NumDescriptors = 1;
-        range[3].BaseShaderRegister = 3;
-        range[3].RegisterSpace = 0;
-        range[3].OffsetInDescriptorsFromTableStart = 0;
+        // ヒープ全体を1つのテーブルとして公開し, テクスチャはマテリアルテーブルの番号で引く.
+        // キューブマップは同じヒープを別のレジスタ空間に TextureCube として公開する.
+        D3D12_DESCRIPTOR_RANGE range[2] = {};
+        range[0].RangeType                          = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
+        range[0].NumDescriptors                     = UINT_MAX;
+        range[0].BaseShaderRegister                 = 0;
+        range[0].RegisterSpace                      = 1;
+        range[0].OffsetInDescriptorsFromTableStart  = 0;
+
+        range[1].RangeType                          = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
+        range[1].NumDescriptors                     = UINT_MAX;
+        range[1].BaseShaderRegister                 = 0;
+        range[1].RegisterSpace                      = 2;
+        range[1].OffsetInDescriptorsFromTableStart  = 0;
 
         // ルートパラメータの設定.
-        D3D12_ROOT_PARAMETER param[7] = {};
+        D3D12_ROOT_PARAMETER param[6] = {};
         param[0].ParameterType             = D3D12_ROOT_PARAMETER_TYPE_CBV;
         param[0].Descriptor.ShaderRegister = 0;
         param[0].Descriptor.RegisterSpace  = 0;
@@ -336,53 +444,57 @@ bool SampleApp::OnInit()
         param[1].Descriptor.RegisterSpace   = 0;
         param[1].ShaderVisibility           = D3D12_SHADER_VISIBILITY_PIXEL;
 
-        param[2].ParameterType              = D3D12_ROOT_PARAMETER_TYPE_CBV;
-        param[2].Descriptor.ShaderRegister  = 2;
-        param[2].Descriptor.RegisterSpace   = 0;
+        // 描画ごとに変わるのはマテリアル番号だけ.
+        param[2].ParameterType              = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
+        param[2].Constants.ShaderRegister   = 2;
+        param[2].Constants.RegisterSpace    = 0;
+        param[2].Constants.Num32BitValues   = 1;
         param[2].ShaderVisibility           = D3D12_SHADER_VISIBILITY_PIXEL;
 
-        param[3].ParameterType                       = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
-        param[3].DescriptorTable.NumDescriptorRanges = 1;
-        param[3].DescriptorTable.pDescriptorRanges   = &range[0];
-        param[3].ShaderVisibility                    = D3D12_SHADER_VISIBILITY_PIXEL;
+        param[3].ParameterType              = D3D12_ROOT_PARAMETER_TYPE_SRV;
+        param[3].Descriptor.ShaderRegister  = 0;
+        param[3].Descriptor.RegisterSpace   = 0;
+        param[3].ShaderVisibility           = D3D12_SHADER_VISIBILITY_PIXEL;
 
-        param[4].ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+        param[4].ParameterType                       = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
         param[4].DescriptorTable.NumDescriptorRanges = 1;
-        param[4].DescriptorTable.pDescriptorRanges = &range[1];
-        param[4].ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
+        param[4].DescriptorTable.pDescriptorRanges   = &range[0];
+        param[4].ShaderVisibility                    = D3D12_SHADER_VISIBILITY_PIXEL;
 
-        param[5].ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+        param[5].ParameterType                       = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
         param[5].DescriptorTable.NumDescriptorRanges = 1;
-        param[5].DescriptorTable.pDescriptorRanges = &range[2];
-        param[5].ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
-
-        param[6].ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
-        param[6].DescriptorTable.NumDescriptorRanges = 1;
-        param[6].DescriptorTable.pDescriptorRanges = &range[3];
-        param[6].ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
+        param[5].DescriptorTable.pDescriptorRanges   = &range[1];
+        param[5].ShaderVisibility                    = D3D12_SHADER_VISIBILITY_PIXEL;
 
         // スタティックサンプラーの設定.
-        D3D12_STATIC_SAMPLER_DESC sampler = {};
-        sampler.Filter              = D3D12_FILTER_MIN_MAG_MIP_LINEAR;
-        sampler.AddressU            = D3D12_TEXTURE_ADDRESS_MODE_WRAP;
-        sampler.AddressV            = D3D12_TEXTURE_ADDRESS_MODE_WRAP;
-        sampler.AddressW            = D3D12_TEXTURE_ADDRESS_MODE_WRAP;
-        sampler.MipLODBias          = D3D12_DEFAULT_MIP_LOD_BIAS;
-        sampler.MaxAnisotropy       = 1;
-        sampler.ComparisonFunc      = D3D12_COMPARISON_FUNC_NEVER;
-        sampler.BorderColor         = D3D12_STATIC_BORDER_COLOR_TRANSPARENT_BLACK;
-        sampler.MinLOD              = -D3D12_FLOAT32_MAX;
-        sampler.MaxLOD              = +D3D12_FLOAT32_MAX;
-        sampler.ShaderRegister      = 0;
-        sampler.RegisterSpace       = 0;
-        sampler.ShaderVisibility    = D3D12_SHADER_VISIBILITY_PIXEL;
+        D3D12_STATIC_SAMPLER_DESC sampler[2] = {};
+        sampler[0].Filter           = D3D12_FILTER_MIN_MAG_MIP_LINEAR;
+        sampler[0].AddressU         = D3D12_TEXTURE_ADDRESS_MODE_WRAP;
+        sampler[0].AddressV         = D3D12_TEXTURE_ADDRESS_MODE_WRAP;
+        sampler[0].AddressW         = D3D12_TEXTURE_ADDRESS_MODE_WRAP;
+        sampler[0].MipLODBias       = D3D12_DEFAULT_MIP_LOD_BIAS;
+        sampler[0].MaxAnisotropy    = 1;
+        sampler[0].ComparisonFunc   = D3D12_COMPARISON_FUNC_NEVER;
+        sampler[0].BorderColor      = D3D12_STATIC_BORDER_COLOR_TRANSPARENT_BLACK;
+        sampler[0].MinLOD           = -D3D12_FLOAT32_MAX;
+        sampler[0].MaxLOD           = +D3D12_FLOAT32_MAX;
+        sampler[0].ShaderRegister   = 0;
+        sampler[0].RegisterSpace    = 0;
+        sampler[0].ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
+
+        // BRDF LUT は端で折り返さないようにクランプする.
+        sampler[1] = sampler[0];
+        sampler[1].AddressU         = D3D12_TEXTURE_ADDRESS_MODE_CLAMP;
+        sampler[1].AddressV         = D3D12_TEXTURE_ADDRESS_MODE_CLAMP;
+        sampler[1].AddressW         = D3D12_TEXTURE_ADDRESS_MODE_CLAMP;
+        sampler[1].ShaderRegister   = 1;
 
         // ルートシグニチャの設定.
         D3D12_ROOT_SIGNATURE_DESC desc = {};
         desc.NumParameters      = _countof(param);
-        desc.NumStaticSamplers  = 1;
+        desc.NumStaticSamplers  = _countof(sampler);
         desc.pParameters        = param;
-        desc.pStaticSamplers    = &sampler;
+        desc.pStaticSamplers    = sampler;
         desc.Flags              = flag;
 
         ComPtr<ID3DBlob> pBlob;
@@ -408,6 +520,13 @@ bool SampleApp::OnInit()
             ELOG( "Error : Root Signature Create Failed. retcode = 0x%x", hr );
             return false;
         }
+
+        // 変換行列(b0)とマテリアル番号(b2)を描画ごとに差し替えるコマンドシグニチャを生成.
+        if (!CreateIndirectDrawSignature(m_pDevice.Get(), m_pRootSig.Get(), 0, 2, m_pDrawSignature.GetAddressOf()))
+        {
+            ELOG( "Error : CreateIndirectDrawSignature() Failed." );
+            return false;
+        }
     }
 
     // パイプラインステートの生成.
@@ -415,8 +534,8 @@ bool SampleApp::OnInit()
         std::wstring vsPath;
         std::wstring psPath;
 
-        // 頂点シェーダを検索.
-        if (!SearchFilePath(L"GGXVS.cso", vsPath))
+        // 頂点シェーダを検索. 圧縮頂点は PACKED_VERTEX を定義してコンパイルした版を使う.
+        if (!SearchFilePath(m_PackedVertex ? L"GGXPackedVS.cso" : L"GGXVS.cso", vsPath))
         {
             ELOG( "Error : Vertex Shader Not Found.");
             return false;
@@ -450,7 +569,7 @@ bool SampleApp::OnInit()
 
         // グラフィックスパイプラインステートを設定.
         D3D12_GRAPHICS_PIPELINE_STATE_DESC desc = {};
-        desc.InputLayout            = MeshVertex::InputLayout;
+        desc.InputLayout            = m_PackedVertex ? PackedVertex::InputLayout : MeshVertex::InputLayout;
         desc.pRootSignature         = m_pRootSig.Get();
         desc.VS                     = { pVSBlob->GetBufferPointer(), pVSBlob->GetBufferSize() };
         desc.PS                     = { pPSBlob->GetBufferPointer(), pPSBlob->GetBufferSize() };
@@ -489,7 +608,7 @@ bool SampleApp::OnInit()
             }
 
             // 定数バッファ初期化.
-            if (!pCB->Init(m_pDevice.Get(), m_pPool[POOL_TYPE_RES], sizeof(Transform) * 2))
+            if (!pCB->Init(m_pDevice.Get(), m_pPool[POOL_TYPE_RES], sizeof(Transform) * 2, &m_UploadAllocator))
             {
                 ELOG( "Error : ConstantBuffer::Init() Failed." );
                 return false;
@@ -518,6 +637,8 @@ bool SampleApp::OnInit()
             ptr->InvProj = ptr->Proj;
             ptr->InvProj.Invert();
             ptr->CameraPos = Vector4(m_eyePos.x, m_eyePos.y, m_eyePos.z, 1.0f);
+            ptr->QuantOffset = Vector4(0.0f, 0.0f, 0.0f, 0.0f);
+            ptr->QuantScale  = Vector4(1.0f, 1.0f, 1.0f, 0.0f);
 
             /*ptr->World = ptr->World.Transpose();
             ptr->View = ptr->View.Transpose();
@@ -548,23 +669,51 @@ bool SampleApp::OnInit()
 void SampleApp::OnTerm()
 {
     m_ImGuiUtil.Finalize();
+    // BLAS 破棄.
+    m_BlasManager.Term();
+
     // メッシュ破棄.
     for(size_t i=0; i<m_pMesh.size(); ++i)
     { SafeTerm(m_pMesh[i]); }
     m_pMesh.clear();
     m_pMesh.shrink_to_fit();
 
+    m_GeometryArena.Term();
+    m_pDrawSignature.Reset();
+    m_DrawItems.clear();
+    m_DrawArgs.clear();
+
+    m_MeshInstances.clear();
+    m_SceneGraph.Clear();
+
+    m_Culler.Clear();
+    m_OcclusionBuffer.Term();
+    m_Occluders.clear();
+    m_VisibleInstances.clear();
+
     // マテリアル破棄.
     m_Material.Term();
 
+    // IBL テクスチャ破棄.
+    m_IblBrdfLut   .Term();
+    m_IblSpecular  .Term();
+    m_IblIrradiance.Term();
+
     // ライト破棄.
-    SafeDelete(m_pLight);
+    for(size_t i=0; i<m_Light.size(); ++i)
+    { SafeDelete(m_Light[i]); }
+    m_Light.clear();
+    m_Light.shrink_to_fit();
 
     // 変換バッファ破棄.
     for(size_t i=0; i<m_Transform.size(); ++i)
     { SafeTerm(m_Transform[i]); }
     m_Transform.clear();
     m_Transform.shrink_to_fit();
+
+    // シェーダキャッシュ破棄.
+    m_ShaderCache.Term();
+    m_ShaderCompiler.Term();
 }
 
 //-----------------------------------------------------------------------------
@@ -650,8 +799,12 @@ void SampleApp::OnRender()
 
         
         //カメラの情報の更新
-        auto pTransform = m_Transform[m_FrameIndex]->GetPtr<Transform>();
-        pTransform->World = Matrix::CreateRotationY(m_RotateAngle);
+        auto pTransform = m_Transform[m_FrameSlot]->GetPtr<Transform>();
+        // ルートノードを回転させ, ダーティになったノードだけワールド行列を更新する.
+        m_SceneGraph.SetLocal(m_RootNode, Matrix::CreateRotationY(m_RotateAngle));
+        m_SceneGraph.Update();
+
+        pTransform->World = m_SceneGraph.GetWorld(m_RootNode);
         pTransform->View = Matrix::CreateLookAt(m_eyePos, m_targetPos, m_upward);
         pTransform->InvView = pTransform->View;
         pTransform->InvView.Invert();
@@ -661,10 +814,12 @@ void SampleApp::OnRender()
         pTransform->CameraPos = Vector4(m_eyePos.x, m_eyePos.y, m_eyePos.z, 1.0f);
 
         //ライトバッファの更新
-        auto pLight = m_pLight->GetPtr<LightBuffer>();
+        auto pLight = m_Light[m_FrameSlot]->GetPtr<LightBuffer>();
         pLight->LightPosition = Vector4(0.0f, -100.0f, 1500.0f, 0.0);
         pLight->LightColor = Color(1.0f, 1.0f, 1.0f, m_LightIntensity);
         pLight->CameraPosition = Vector4(m_eyePos.x, m_eyePos.y, m_eyePos.z, 0.0f);
+        pLight->IblParam = Vector4(m_intensity_environment, DirectX::XMConvertToRadians(m_rotation_environment), float(m_IblMipLevels - 1), 0.0f);
+        memcpy(pLight->IblMaps, m_IblMaps, sizeof(m_IblMaps));
         
     }
     //##########################################################
@@ -673,7 +828,7 @@ void SampleApp::OnRender()
     m_ImGuiUtil.ShowPanel(m_Width, m_Height, m_RenderType, this);
 
     // コマンドリストの記録を開始.
-    auto pCmd = m_CommandList.Reset();
+    auto pCmd = m_CommandList.Reset(m_FrameSlot);
 
     // 書き込み用リソースバリア設定.
     DirectX::TransitionResource(pCmd,
@@ -731,44 +886,192 @@ void SampleApp::OnRender()
             // 深度ステンシルビューをクリア.
             pCmd->ClearDepthStencilView(handleDSV->HandleCPU, D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0, nullptr);
 
-            // 描画処理.
+            // 描画処理. メッシュを範囲ごとに分割して, ワーカースレッドで別々のリストに記録する.
             {
                 ID3D12DescriptorHeap* const pHeaps[] = {
                     m_pPool[POOL_TYPE_RES]->GetHeap()
                 };
 
-                pCmd->SetGraphicsRootSignature(m_pRootSig.Get());
-                pCmd->SetDescriptorHeaps(1, pHeaps);
-                pCmd->SetGraphicsRootConstantBufferView(0, m_Transform[m_FrameIndex]->GetAddress());
-                pCmd->SetGraphicsRootConstantBufferView(1, m_pLight->GetAddress());
-                pCmd->SetPipelineState(m_pPSO.Get());
+                // インスタンスごとにワールド行列だけ差し替えた変換行列をこのフレーム用の領域に書き込む.
+                // アロケータはスレッドセーフではないので, 記録を始める前にまとめて確保する.
+                auto pSrcTransform = m_Transform[m_FrameSlot]->GetPtr<Transform>();
+
+                // 視錐台と遮蔽で描画するインスタンスを絞り込む.
+                {
+                    auto viewProj = pSrcTransform->View * pSrcTransform->Proj;
+
+                    m_Culler.Clear();
+                    m_Culler.Reserve(uint32_t(m_MeshInstances.size()));
+                    for (auto& instance : m_MeshInstances)
+                    {
+                        m_Culler.Add(TransformMeshBounds(
+                            m_pMesh[instance.Mesh]->GetBounds(),
+                            m_SceneGraph.GetWorld(instance.Node)));
+                    }
+
+                    const OcclusionBuffer* pOcclusion = nullptr;
+                    if (m_OcclusionCulling)
+                    {
+                        m_OcclusionBuffer.Begin(viewProj);
+                        for (auto& instance : m_MeshInstances)
+                        {
+                            auto& occluder = m_Occluders[instance.Mesh];
+                            m_OcclusionBuffer.RasterizeMesh(
+                                occluder.Positions.data(),
+                                sizeof(DirectX::XMFLOAT3),
+                                occluder.Indices.data(),
+                                uint32_t(occluder.Indices.size()),
+                                m_SceneGraph.GetWorld(instance.Node));
+                        }
+                        m_OcclusionBuffer.End();
+                        pOcclusion = &m_OcclusionBuffer;
+                    }
+
+                    m_Culler.Cull(viewProj, pOcclusion, m_VisibleInstances);
+                    m_CullingStats = m_Culler.GetStats();
+                }
+
+                // 単位長さあたりのピクセル数は, 距離 1 の位置で (画面の高さ / 2) * Proj._22 になる.
+                auto projScale = 0.5f * m_Viewport.Height * pSrcTransform->Proj._22;
 
-                for (size_t i = 0; i < m_pMesh.size(); ++i)
+                m_InstanceTransforms.resize(m_VisibleInstances.size());
+                m_InstanceLods      .resize(m_VisibleInstances.size());
+                m_DrawnTriangles = 0;
+                for (size_t i = 0; i < m_VisibleInstances.size(); ++i)
                 {
-                    // マテリアルIDを取得.
-                    auto id = m_pMesh[i]->GetMaterialId();
-
-                    // 定数バッファを設定.
-                    pCmd->SetGraphicsRootConstantBufferView(2, m_Material.GetBufferAddress(i));
-
-                    // テクスチャを設定.
-                    pCmd->SetGraphicsRootDescriptorTable(3, m_Material.GetTextureHandle(id, TU_BASE_COLOR));
-                    pCmd->SetGraphicsRootDescriptorTable(4, m_Material.GetTextureHandle(id, TU_NORMAL));
-                    pCmd->SetGraphicsRootDescriptorTable(5, m_Material.GetTextureHandle(id, TU_ROUGHNESS));
-                    pCmd->SetGraphicsRootDescriptorTable(6, m_Material.GetTextureHandle(id, TU_METALLIC));
-
-                    // メッシュを描画.
-                    m_pMesh[i]->Draw(pCmd);
-                    
-                    
+                    auto& instance = m_MeshInstances[m_VisibleInstances[i]];
+
+                    // 境界球の手前側までの距離で, 投影後の誤差が閾値に収まる詳細度を選ぶ.
+                    {
+                        auto pMesh  = m_pMesh[instance.Mesh];
+                        auto local  = pMesh->GetBounds();
+                        auto bounds = TransformMeshBounds(local, m_SceneGraph.GetWorld(instance.Node));
+                        auto scale  = (local.Radius > 0.0f) ? bounds.Radius / local.Radius : 1.0f;
+                        auto dist   = Vector3::Distance(m_eyePos, Vector3(bounds.Center)) - bounds.Radius;
+                        dist = std::max(dist, 1.0f);
+
+                        m_InstanceLods[i] = pMesh->SelectLod(projScale * scale / dist, m_LodThreshold);
+                        m_DrawnTriangles += pMesh->GetLodIndexCount(m_InstanceLods[i]) / 3;
+
+                        // テクスチャは境界球の画面上の直径に見合うミップを要求する.
+                        m_Material.RequestTextures(pMesh->GetMaterialId(), 2.0f * projScale * bounds.Radius / dist);
+                    }
+
+                    UploadAllocation allocation = {};
+                    if (!m_UploadAllocator.AllocateTransient(sizeof(Transform), D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT, allocation))
+                    {
+                        m_InstanceTransforms[i] = m_Transform[m_FrameSlot]->GetAddress();
+                        continue;
+                    }
+
+                    auto pDst = reinterpret_cast<Transform*>(allocation.pCpu);
+                    *pDst = *pSrcTransform;
+                    pDst->World = m_SceneGraph.GetWorld(instance.Node);
+
+                    // 圧縮頂点の位置はメッシュごとの AABB で量子化されている.
+                    auto& quantization = m_pMesh[instance.Mesh]->GetQuantization();
+                    pDst->QuantOffset = Vector4(quantization.Offset.x, quantization.Offset.y, quantization.Offset.z, 0.0f);
+                    pDst->QuantScale  = Vector4(quantization.Scale.x,  quantization.Scale.y,  quantization.Scale.z,  0.0f);
+                    m_InstanceTransforms[i] = allocation.GpuAddress;
                 }
 
+                // 要求に応じてミップを入れ替え, 作り直されたテクスチャの番号でテーブルを更新する.
+                if (m_TextureStreamer.Update())
+                {
+                    if (!m_Material.RefreshStreamedTextures())
+                    { ELOG("Error : Material::RefreshStreamedTextures() Failed."); }
+                }
+
+                // 可視インスタンスのドロー引数を詰めて, 1回の ExecuteIndirect() で描画する.
+                // 引数の領域を確保できない場合はメッシュごとに描画する.
+                UploadAllocation drawArgs = {};
+                auto indirect = false;
+                if (m_IndirectDraw && m_pDrawSignature != nullptr)
+                {
+                    m_DrawItems.resize(m_VisibleInstances.size());
+                    for (size_t i = 0; i < m_VisibleInstances.size(); ++i)
+                    {
+                        m_DrawItems[i].Mesh      = m_MeshInstances[m_VisibleInstances[i]].Mesh;
+                        m_DrawItems[i].Lod       = m_InstanceLods[i];
+                        m_DrawItems[i].Transform = m_InstanceTransforms[i];
+                    }
+
+                    BuildIndirectDrawArgs(
+                        m_GeometryArena.GetRanges(),
+                        m_DrawItems.data(),
+                        m_DrawItems.size(),
+                        uint32_t(m_Material.GetCount()),
+                        m_DrawArgs);
+
+                    auto size = sizeof(IndirectDrawArgs) * m_DrawArgs.size();
+                    indirect = (size == 0) || m_UploadAllocator.AllocateTransient(size, D3D12_RAW_UAV_SRV_BYTE_ALIGNMENT, drawArgs);
+                    if (indirect && size > 0)
+                    { memcpy(drawArgs.pCpu, m_DrawArgs.data(), size); }
+                }
+
+                m_DrawCalls = (indirect) ? uint32_t(!m_DrawArgs.empty()) : uint32_t(m_VisibleInstances.size());
+
+                auto listCount = (indirect) ? 1u : CommandListPool::GetParallelListCount(m_VisibleInstances.size());
+                m_CommandListPool.RecordParallel(listCount, m_VisibleInstances.size(),
+                    [&](ID3D12GraphicsCommandList4* pList, uint32_t, size_t begin, size_t end)
+                {
+                    if (pList == nullptr)
+                    { return; }
+
+                    // リスト間で状態は引き継がれないので, それぞれで設定する.
+                    pList->OMSetRenderTargets(1, &handleRTV->HandleCPU, FALSE, &handleDSV->HandleCPU);
+                    pList->RSSetViewports(1, &m_Viewport);
+                    pList->RSSetScissorRects(1, &m_Scissor);
+                    pList->SetGraphicsRootSignature(m_pRootSig.Get());
+                    pList->SetDescriptorHeaps(1, pHeaps);
+                    pList->SetGraphicsRootConstantBufferView(0, m_Transform[m_FrameSlot]->GetAddress());
+                    pList->SetGraphicsRootConstantBufferView(1, m_Light[m_FrameSlot]->GetAddress());
+                    pList->SetGraphicsRootShaderResourceView(3, m_Material.GetTableAddress());
+                    pList->SetGraphicsRootDescriptorTable(4, pHeaps[0]->GetGPUDescriptorHandleForHeapStart());
+                    pList->SetGraphicsRootDescriptorTable(5, pHeaps[0]->GetGPUDescriptorHandleForHeapStart());
+                    pList->SetPipelineState(m_pPSO.Get());
+
+                    if (indirect)
+                    {
+                        // 変換行列とマテリアル番号はコマンドシグニチャで描画ごとに差し替わる.
+                        m_GeometryArena.Bind(pList);
+                        if (!m_DrawArgs.empty())
+                        {
+                            pList->ExecuteIndirect(
+                                m_pDrawSignature.Get(),
+                                UINT(m_DrawArgs.size()),
+                                drawArgs.pResource,
+                                drawArgs.Offset,
+                                nullptr,
+                                0);
+                        }
+                        return;
+                    }
+
+                    for (size_t i = begin; i < end; ++i)
+                    {
+                        auto meshId = m_MeshInstances[m_VisibleInstances[i]].Mesh;
+
+                        // マテリアルIDを取得. ルートSRVは範囲外を検出しないのでここで丸める.
+                        auto id = m_pMesh[meshId]->GetMaterialId();
+                        if (id >= m_Material.GetCount())
+                        { id = 0; }
+
+                        // 定数バッファとマテリアル番号を設定.
+                        pList->SetGraphicsRootConstantBufferView(0, m_InstanceTransforms[i]);
+                        pList->SetGraphicsRoot32BitConstant(2, id, 0);
+
+                        // メッシュを描画.
+                        m_pMesh[meshId]->Draw(pList, m_InstanceLods[i]);
+                    }
+                });
             }
             break;
 
         case RENDER_TYPE::RAYTRACE:
 
-            auto pTransform = m_Transform[m_FrameIndex]->GetPtr<Transform>();
+            // カメラバッファとインスタンス記述子はフレームごとに持つので, GPU の完了を待つ必要はない.
+            auto pTransform = m_Transform[m_FrameSlot]->GetPtr<Transform>();
 
             // 送信用の一時的な構造体を作る
             Transform gpuData = *pTransform;
@@ -782,8 +1085,9 @@ void SampleApp::OnRender()
             //CameraPosは転置させない（行列ではないため）
             void* pMappedData = nullptr;
             if (SUCCEEDED(m_cameraBuffer->Map(0, nullptr, &pMappedData))) {
-                // 転置済みのデータをコピー
-                memcpy(pMappedData, &gpuData, sizeof(Transform));
+                // 転置済みのデータを今のフレームの領域にコピー
+                auto pSlotData = static_cast<uint8_t*>(pMappedData) + size_t(m_FrameSlot) * m_cameraBufferSize;
+                memcpy(pSlotData, &gpuData, sizeof(Transform));
                 m_cameraBuffer->Unmap(0, nullptr);
             }
 
@@ -820,22 +1124,24 @@ void SampleApp::OnRender()
 
             D3D12_DISPATCH_RAYS_DESC desc = {};
 
+            auto pSbtStorage = m_sbtStorage[m_FrameSlot].Get();
+
             uint32_t rayGenerationSectionSizeInBytes =
                 m_sbtHelper.GetRayGenSectionSize();
             desc.RayGenerationShaderRecord.StartAddress =
-                m_sbtStorage->GetGPUVirtualAddress();
+                pSbtStorage->GetGPUVirtualAddress();
             desc.RayGenerationShaderRecord.SizeInBytes =
                 rayGenerationSectionSizeInBytes;
 
 
             uint32_t missSectionSizeInBytes = m_sbtHelper.GetMissSectionSize();
             desc.MissShaderTable.StartAddress =
-                m_sbtStorage->GetGPUVirtualAddress() + rayGenerationSectionSizeInBytes;
+                pSbtStorage->GetGPUVirtualAddress() + rayGenerationSectionSizeInBytes;
             desc.MissShaderTable.SizeInBytes = missSectionSizeInBytes;
             desc.MissShaderTable.StrideInBytes = m_sbtHelper.GetMissEntrySize();
 
             uint32_t hitGroupsSectionSize = m_sbtHelper.GetHitGroupSectionSize();
-            desc.HitGroupTable.StartAddress = m_sbtStorage->GetGPUVirtualAddress() +
+            desc.HitGroupTable.StartAddress = pSbtStorage->GetGPUVirtualAddress() +
                 rayGenerationSectionSizeInBytes +
                 missSectionSizeInBytes;
             desc.HitGroupTable.SizeInBytes = hitGroupsSectionSize;
@@ -867,24 +1173,39 @@ void SampleApp::OnRender()
     }
     
     
-    // ImGui 描画処理を追加.
-    ID3D12DescriptorHeap* heaps[] = { m_ImGuiUtil.GetSRVHeap() };
-    pCmd->SetDescriptorHeaps(1, heaps);
-    m_ImGuiUtil.Render(pCmd);
-
-    // 表示用リソースバリア設定.
-    DirectX::TransitionResource(pCmd,
-        m_ColorTarget[m_FrameIndex].GetResource(),
-        D3D12_RESOURCE_STATE_RENDER_TARGET,
-        D3D12_RESOURCE_STATE_PRESENT);
-
-    // コマンドリストの記録を終了.
+    // クリアとレイトレーシングのコマンドを先に実行.
     pCmd->Close();
 
-    // コマンドリストを実行.
     ID3D12CommandList* pLists[] = { pCmd };
     m_pQueue->ExecuteCommandLists( 1, pLists );
 
+    // ImGui と表示用のバリアは, 並列に記録した描画リストの後に実行する.
+    auto post  = m_CommandListPool.Reserve(1);
+    auto pPost = m_CommandListPool.Begin(post);
+    if (pPost != nullptr)
+    {
+        pPost->OMSetRenderTargets(1, &handleRTV->HandleCPU, FALSE, &handleDSV->HandleCPU);
+        pPost->RSSetViewports(1, &m_Viewport);
+        pPost->RSSetScissorRects(1, &m_Scissor);
+
+        // ImGui 描画処理を追加.
+        ID3D12DescriptorHeap* heaps[] = { m_ImGuiUtil.GetSRVHeap() };
+        pPost->SetDescriptorHeaps(1, heaps);
+        m_ImGuiUtil.Render(pPost);
+
+        // 表示用リソースバリア設定.
+        DirectX::TransitionResource(pPost,
+            m_ColorTarget[m_FrameIndex].GetResource(),
+            D3D12_RESOURCE_STATE_RENDER_TARGET,
+            D3D12_RESOURCE_STATE_PRESENT);
+
+        // コマンドリストの記録を終了.
+        m_CommandListPool.End(post);
+    }
+
+    // 予約順に実行.
+    m_CommandListPool.Submit();
+
     // 画面に表示.
     Present(1);
 }
@@ -1089,10 +1410,16 @@ void SampleApp::CreateTopLevelAS(
     // gather all the instances into the builder helper
     if (!updateOnly) {
         std::cout << instances.size() << std::endl;
+        m_tlasInstances.Clear();
+        m_tlasInstances.SetBufferCount(FrameCount);
         for (size_t i = 0; i < instances.size(); i++) {
-            m_topLevelASGenerator.AddInstance(
-                instances[i].first.Get(), instances[i].second, static_cast<UINT>(i),
-                static_cast<UINT>(/*2 * i*/i));
+            TlasInstanceBounds bounds = { { -1.0f, -1.0f, -1.0f }, { 1.0f, 1.0f, 1.0f } };
+            if (i < m_instanceBounds.size())
+                bounds = m_instanceBounds[i];
+
+            m_tlasInstances.AddInstance(
+                instances[i].first->GetGPUVirtualAddress(), instances[i].second, bounds,
+                static_cast<uint32_t>(i), static_cast<uint32_t>(i));
 
             std::cout << "instances[i].first.Get() = " << instances[i].first.Get() << std::endl;
             //行列の表示
@@ -1106,14 +1433,46 @@ void SampleApp::CreateTopLevelAS(
             }
         }
 
+        // 読み込んだメッシュの圧縮済み BLAS をノードごとに配置する. シェーディングは床と同じヒットグループを使う.
+        m_TlasMeshNodes.clear();
+        for (auto& instance : m_MeshInstances) {
+            auto blasIndex = m_MeshBlasIndex[instance.Mesh];
+            if (blasIndex == UINT32_MAX)
+                continue;
+
+            auto& box = m_pMesh[instance.Mesh]->GetBounds();
+            TlasInstanceBounds bounds = {
+                { box.Center.x - box.Extent.x, box.Center.y - box.Extent.y, box.Center.z - box.Extent.z },
+                { box.Center.x + box.Extent.x, box.Center.y + box.Extent.y, box.Center.z + box.Extent.z }
+            };
+
+            m_tlasInstances.AddInstance(
+                m_BlasManager.GetAddress(blasIndex), m_SceneGraph.GetWorld(instance.Node), bounds,
+                m_tlasInstances.GetCount(), 0);
+            m_TlasMeshNodes.push_back(instance.Node);
+        }
+
         /*Bottom - Level AS の構築には、実際の AS（結果）に加えて、一時データを保存するためのスクラッチ領域が必要になります。
         また Top - Level AS の場合は、インスタンスディスクリプタも GPU メモリ上に配置する必要があります。
-        この呼び出しは、それぞれに必要なメモリ量（スクラッチ、結果、インスタンスディスクリプタ）を出力し、
-        アプリケーションが対応するメモリを確保できるようにします。*/
-        UINT64 scratchSize, resultSize, instanceDescsSize;
-
-        m_topLevelASGenerator.ComputeASBufferSizes(
-            m_pDevice.Get(), true, &scratchSize, &resultSize, &instanceDescsSize);
+        プリビルド情報からそれぞれに必要なメモリ量（スクラッチ、結果、インスタンスディスクリプタ）を求め、
+        対応するメモリを確保します。リフィットにも使うので更新用のスクラッチも含めます。*/
+        D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS prebuildDesc = {};
+        prebuildDesc.Type = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL;
+        prebuildDesc.DescsLayout = D3D12_ELEMENTS_LAYOUT_ARRAY;
+        prebuildDesc.NumDescs = m_tlasInstances.GetCount();
+        prebuildDesc.Flags = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_ALLOW_UPDATE;
+
+        D3D12_RAYTRACING_ACCELERATION_STRUCTURE_PREBUILD_INFO info = {};
+        m_pDevice->GetRaytracingAccelerationStructurePrebuildInfo(&prebuildDesc, &info);
+
+        UINT64 scratchSize = ROUND_UP(
+            std::max(info.ScratchDataSizeInBytes, info.UpdateScratchDataSizeInBytes),
+            D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BYTE_ALIGNMENT);
+        UINT64 resultSize = ROUND_UP(
+            info.ResultDataMaxSizeInBytes, D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BYTE_ALIGNMENT);
+        UINT64 instanceDescsSize = ROUND_UP(
+            sizeof(D3D12_RAYTRACING_INSTANCE_DESC) * UINT64(prebuildDesc.NumDescs),
+            D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BYTE_ALIGNMENT);
 
         m_topLevelASBuffers.pScratch = nv_helpers_dx12::CreateBuffer(
             m_pDevice.Get(), scratchSize, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS,
@@ -1125,18 +1484,59 @@ void SampleApp::CreateTopLevelAS(
             D3D12_RESOURCE_STATE_RAYTRACING_ACCELERATION_STRUCTURE,
             nv_helpers_dx12::kDefaultHeapProps);
 
-        m_topLevelASBuffers.pInstanceDesc = nv_helpers_dx12::CreateBuffer(
-            m_pDevice.Get(), instanceDescsSize, D3D12_RESOURCE_FLAG_NONE,
-            D3D12_RESOURCE_STATE_GENERIC_READ, nv_helpers_dx12::kUploadHeapProps);
+        // インスタンス記述子は GPU が前のフレームで読んでいる間に書き換えないようにフレームごとに持つ.
+        for (auto i = 0u; i < FrameCount; ++i) {
+            m_tlasInstanceDescs[i] = nv_helpers_dx12::CreateBuffer(
+                m_pDevice.Get(), instanceDescsSize, D3D12_RESOURCE_FLAG_NONE,
+                D3D12_RESOURCE_STATE_GENERIC_READ, nv_helpers_dx12::kUploadHeapProps);
+        }
     }
 
-    
-    m_topLevelASGenerator.Generate(m_CommandList.GetCommandList(),
-        m_topLevelASBuffers.pScratch.Get(),
-        m_topLevelASBuffers.pResult.Get(),
-        m_topLevelASBuffers.pInstanceDesc.Get(),
-        updateOnly, m_topLevelASBuffers.pResult.Get());
+    else {
+        // ワールド行列が変わったインスタンスだけがダーティになる.
+        for (size_t i = 0; i < instances.size(); i++)
+            m_tlasInstances.SetTransform(static_cast<uint32_t>(i), instances[i].second);
 
+        for (size_t i = 0; i < m_TlasMeshNodes.size(); i++)
+            m_tlasInstances.SetTransform(
+                static_cast<uint32_t>(instances.size() + i), m_SceneGraph.GetWorld(m_TlasMeshNodes[i]));
+    }
+
+    // 変更が無ければ書き込みも構築も行わない. 表面積の増加が大きければリビルドになる.
+    auto mode = m_tlasInstances.GetUpdateMode();
+    if (mode == TlasInstanceCache::UPDATE_MODE_NONE)
+        return;
+
+    // インスタンス記述子はアップロードヒープに残っているので, このフレームのバッファに未反映の分だけ上書きする.
+    auto pInstanceDescBuffer = m_tlasInstanceDescs[m_FrameSlot].Get();
+    D3D12_RAYTRACING_INSTANCE_DESC* pInstanceDescs = nullptr;
+    D3D12_RANGE readRange = { 0, 0 };
+    ThrowIfFailed(pInstanceDescBuffer->Map(
+        0, &readRange, reinterpret_cast<void**>(&pInstanceDescs)));
+    m_tlasInstances.Write(pInstanceDescs, mode, m_FrameSlot);
+    pInstanceDescBuffer->Unmap(0, nullptr);
+
+    auto refit = (mode == TlasInstanceCache::UPDATE_MODE_REFIT);
+
+    D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC buildDesc = {};
+    buildDesc.Inputs.Type = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL;
+    buildDesc.Inputs.DescsLayout = D3D12_ELEMENTS_LAYOUT_ARRAY;
+    buildDesc.Inputs.InstanceDescs = pInstanceDescBuffer->GetGPUVirtualAddress();
+    buildDesc.Inputs.NumDescs = m_tlasInstances.GetCount();
+    buildDesc.Inputs.Flags = refit
+        ? (D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_ALLOW_UPDATE | D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PERFORM_UPDATE)
+        : D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_ALLOW_UPDATE;
+    buildDesc.DestAccelerationStructureData = m_topLevelASBuffers.pResult->GetGPUVirtualAddress();
+    buildDesc.ScratchAccelerationStructureData = m_topLevelASBuffers.pScratch->GetGPUVirtualAddress();
+    buildDesc.SourceAccelerationStructureData = refit ? m_topLevelASBuffers.pResult->GetGPUVirtualAddress() : 0;
+
+    auto pCmd = m_CommandList.GetCommandList();
+    pCmd->BuildRaytracingAccelerationStructure(&buildDesc, 0, nullptr);
+
+    D3D12_RESOURCE_BARRIER uavBarrier = {};
+    uavBarrier.Type = D3D12_RESOURCE_BARRIER_TYPE_UAV;
+    uavBarrier.UAV.pResource = m_topLevelASBuffers.pResult.Get();
+    pCmd->ResourceBarrier(1, &uavBarrier);
 }
 
 //-----------------------------------------------------------------------------
@@ -1146,6 +1546,30 @@ void SampleApp::CreateTopLevelAS(
 void SampleApp::CreateAccelerationStructures() {
     //AccelerationStructureBuffers bottomLevelBuffers = CreateBottomLevelAS(
     //    { {m_vertexBuffer.Get(), 4} }, { {m_indexBuffer.Get(),12} });
+
+    // 読み込んだ全メッシュの BLAS をまとめて構築し, 圧縮する.
+    if (!m_BlasManager.Init(m_pDevice.Get()))
+    { throw std::logic_error("BlasManager::Init() Failed."); }
+
+    // BLAS は 32bit 浮動小数の位置が必要なので, 圧縮頂点のメッシュは含めない.
+    m_MeshBlasIndex.assign(m_pMesh.size(), UINT32_MAX);
+    for (size_t i = 0; i < m_pMesh.size(); ++i)
+    {
+        if (m_pMesh[i]->IsPacked())
+        { continue; }
+
+        m_MeshBlasIndex[i] = m_BlasManager.AddMesh(m_pMesh[i]);
+    }
+
+    if (!m_BlasManager.Build(m_pQueue.Get(), m_CommandList, m_Fence))
+    { throw std::logic_error("BlasManager::Build() Failed."); }
+
+    DLOG( "BLAS : %llu bytes -> %llu bytes (compacted)",
+        m_BlasManager.GetSourceSize(), m_BlasManager.GetCompactedSize() );
+
+    // TLAS にメッシュを配置するので, 最初のフレームより前にワールド行列を求めておく.
+    m_SceneGraph.Update();
+
     auto pCmd = m_CommandList.Reset();
     
     AccelerationStructureBuffers planeBottomLevelBuffers =
@@ -1169,6 +1593,10 @@ void SampleApp::CreateAccelerationStructures() {
         {planeBottomLevelBuffers.pResult, DirectX::XMMatrixTranslation(0, 0, 0)}
         //{RenderMeshBuffers.pResult, DirectX::XMMatrixTranslation(0, 0, 0)}
     };
+    // CreatePlaneVB() の頂点範囲.
+    m_instanceBounds = {
+        { { -1.5f, -0.8f, -1.5f }, { 1.5f, -0.8f, 1.5f } }
+    };
 
     CreateTopLevelAS(m_instances);
 
@@ -1233,13 +1661,41 @@ void SampleApp::CreateRaytracingPipeline() {
     //IDxcBlob*型の返り値 //"C:\Users\7544k\Github\DirectX12\rasterization\DirectX12Renderer_GGX\Sample\res\RayGen.hlsl"
     
     //m_rayGenLibrary = nv_helpers_dx12::CompileShaderLibrary(/*L"RayGen.hlsl"*/L"../../../Sample/res/RayGen.hlsl");
-    m_rayGenLibrary = nv_helpers_dx12::CompileShaderLibrary(L"C:/Users/7544k/Github/DirectX12/rasterization/Direct3D12Renderer/Sample/res/RayGen.hlsl");
     //m_missLibrary = nv_helpers_dx12::CompileShaderLibrary(/*L"Miss.hlsl"*/L"../../../Sample/res/Miss.hlsl");
-    m_missLibrary = nv_helpers_dx12::CompileShaderLibrary(L"C:/Users/7544k/Github/DirectX12/rasterization/Direct3D12Renderer/Sample/res/Miss.hlsl");
     //m_hitLibrary = nv_helpers_dx12::CompileShaderLibrary(/*L"Hit.hlsl"*/L"../../../Sample/res/Hit.hlsl");
-    m_hitLibrary = nv_helpers_dx12::CompileShaderLibrary(L"C:/Users/7544k/Github/DirectX12/rasterization/Direct3D12Renderer/Sample/res/Hit.hlsl");
     //m_shadowLibrary = nv_helpers_dx12::CompileShaderLibrary(/*L"ShadowRay.hlsl"*/L"../../../Sample/res/ShadowRay.hlsl");
-    m_shadowLibrary = nv_helpers_dx12::CompileShaderLibrary(L"C:/Users/7544k/Github/DirectX12/rasterization/Direct3D12Renderer/Sample/res/ShadowRay.hlsl");
+
+    // 4つのライブラリは互いに独立しているので並列にコンパイルし, 結果はキャッシュから再利用する.
+    if (!m_ShaderCompiler.Init() || !m_ShaderCache.Init(&m_ShaderCompiler, L"ShaderCache"))
+    { throw std::logic_error("Cannot initialize shader cache"); }
+
+    const wchar_t* libraryPaths[] = {
+        L"C:/Users/7544k/Github/DirectX12/rasterization/Direct3D12Renderer/Sample/res/RayGen.hlsl",
+        L"C:/Users/7544k/Github/DirectX12/rasterization/Direct3D12Renderer/Sample/res/Miss.hlsl",
+        L"C:/Users/7544k/Github/DirectX12/rasterization/Direct3D12Renderer/Sample/res/Hit.hlsl",
+        L"C:/Users/7544k/Github/DirectX12/rasterization/Direct3D12Renderer/Sample/res/ShadowRay.hlsl",
+    };
+    const size_t libraryCount = _countof(libraryPaths);
+
+    ShaderDesc libraryDescs[libraryCount];
+    for (size_t i = 0; i < libraryCount; ++i)
+    {
+        libraryDescs[i].Path   = libraryPaths[i];
+        libraryDescs[i].Target = L"lib_6_3";
+    }
+
+    std::shared_ptr<ShaderBinary> libraries[libraryCount];
+    if (!m_ShaderCache.LoadParallel(libraryDescs, libraryCount, libraries))
+    { throw std::logic_error("Cannot compile shader library"); }
+
+    ComPtr<IDxcBlob>* libraryBlobs[libraryCount] = {
+        &m_rayGenLibrary, &m_missLibrary, &m_hitLibrary, &m_shadowLibrary
+    };
+    for (size_t i = 0; i < libraryCount; ++i)
+    {
+        if (!CreateShaderBlob(libraries[i], libraryBlobs[i]->ReleaseAndGetAddressOf()))
+        { throw std::logic_error("Cannot create shader blob"); }
+    }
 
 
     //m_librariesにLibraryをemplace_backしている。
@@ -1306,37 +1762,39 @@ void SampleApp::CreateRaytracingOutputBuffer() {
 // シェーダーからまとめて利用できるようにしています。
 void SampleApp::CreateShaderResourceHeap() {
 
-    //3つ分のスロット（場所）を持つヒープが作られます。描画結果、AS構造、
+    //3つ分のスロット（場所）をフレームごとに持つヒープが作られます。描画結果、AS構造、カメラ
     m_srvUavHeap = nv_helpers_dx12::CreateDescriptorHeap(
-        m_pDevice.Get(), 3, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, true);
+        m_pDevice.Get(), 3 * FrameCount, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, true);
 
+    auto incrementSize = m_pDevice->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
     D3D12_CPU_DESCRIPTOR_HANDLE srvHandle = m_srvUavHeap->GetCPUDescriptorHandleForHeapStart();
-    D3D12_UNORDERED_ACCESS_VIEW_DESC uavDesc = {};
-    uavDesc.ViewDimension = D3D12_UAV_DIMENSION_TEXTURE2D;
-    m_pDevice->CreateUnorderedAccessView(m_outputResource.Get(), nullptr, &uavDesc, srvHandle);
-    srvHandle.ptr += m_pDevice->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
-
-    D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc;
-    srvDesc.Format = DXGI_FORMAT_UNKNOWN;
-    srvDesc.ViewDimension = D3D12_SRV_DIMENSION_RAYTRACING_ACCELERATION_STRUCTURE;
-    srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-    srvDesc.RaytracingAccelerationStructure.Location =
-        m_topLevelASBuffers.pResult->GetGPUVirtualAddress();
-    // Write the acceleration structure view in the heap
-    m_pDevice->CreateShaderResourceView(nullptr, &srvDesc, srvHandle);
 
-    // #DXR Extra: Perspective Camera
-    // Add the constant buffer for the camera after the TLAS
-    srvHandle.ptr += m_pDevice->GetDescriptorHandleIncrementSize(
-        D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
-
-    // Describe and create a constant buffer view for the camera
-    D3D12_CONSTANT_BUFFER_VIEW_DESC cbvDesc = {};
-    cbvDesc.BufferLocation = m_cameraBuffer->GetGPUVirtualAddress();
-    cbvDesc.SizeInBytes = m_cameraBufferSize;
-    /*cbvDesc.BufferLocation = m_Transform[m_FrameIndex]->GetAddress();
-    cbvDesc.SizeInBytes = m_Transform[m_FrameIndex]->GetSizeInByte();*/
-    m_pDevice->CreateConstantBufferView(&cbvDesc, srvHandle);
+    for (auto i = 0u; i < FrameCount; ++i) {
+        D3D12_UNORDERED_ACCESS_VIEW_DESC uavDesc = {};
+        uavDesc.ViewDimension = D3D12_UAV_DIMENSION_TEXTURE2D;
+        m_pDevice->CreateUnorderedAccessView(m_outputResource.Get(), nullptr, &uavDesc, srvHandle);
+        srvHandle.ptr += incrementSize;
+
+        D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc;
+        srvDesc.Format = DXGI_FORMAT_UNKNOWN;
+        srvDesc.ViewDimension = D3D12_SRV_DIMENSION_RAYTRACING_ACCELERATION_STRUCTURE;
+        srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+        srvDesc.RaytracingAccelerationStructure.Location =
+            m_topLevelASBuffers.pResult->GetGPUVirtualAddress();
+        // Write the acceleration structure view in the heap
+        m_pDevice->CreateShaderResourceView(nullptr, &srvDesc, srvHandle);
+
+        // #DXR Extra: Perspective Camera
+        // Add the constant buffer for the camera after the TLAS
+        srvHandle.ptr += incrementSize;
+
+        // Describe and create a constant buffer view for the camera of this frame
+        D3D12_CONSTANT_BUFFER_VIEW_DESC cbvDesc = {};
+        cbvDesc.BufferLocation = m_cameraBuffer->GetGPUVirtualAddress() + UINT64(i) * m_cameraBufferSize;
+        cbvDesc.SizeInBytes = m_cameraBufferSize;
+        m_pDevice->CreateConstantBufferView(&cbvDesc, srvHandle);
+        srvHandle.ptr += incrementSize;
+    }
 
 }
 
@@ -1349,29 +1807,33 @@ void SampleApp::CreateShaderBindingTable() {
     else {
         std::cout << "ヒープは作成されている！！！" << std::endl;
     }
-    m_sbtHelper.Reset();
-
     D3D12_GPU_DESCRIPTOR_HANDLE srvUavHeapHandle = 
         m_srvUavHeap->GetGPUDescriptorHandleForHeapStart();
+    auto incrementSize = m_pDevice->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+
+    // フレームごとのカメラバッファを参照するように, ヒープの位置だけを変えてフレーム数分作る.
+    for (auto i = 0u; i < FrameCount; ++i) {
+        m_sbtHelper.Reset();
+
+        auto heapPointer = reinterpret_cast<UINT64*>(srvUavHeapHandle.ptr + UINT64(i) * 3 * incrementSize);
+        // The ray generation only uses heap data
+        m_sbtHelper.AddRayGenerationProgram(L"RayGen", { heapPointer });
+        m_sbtHelper.AddMissProgram(L"Miss", {});
+        m_sbtHelper.AddMissProgram(L"ShadowMiss", {});
+        m_sbtHelper.AddHitGroup(L"PlaneHitGroup", { heapPointer });
+        m_sbtHelper.AddHitGroup(L"ShadowHitGroup", {});
+
+        uint32_t sbtSize = m_sbtHelper.ComputeSBTSize();
+        m_sbtStorage[i] = nv_helpers_dx12::CreateBuffer(
+            m_pDevice.Get(), sbtSize, D3D12_RESOURCE_FLAG_NONE,
+            D3D12_RESOURCE_STATE_GENERIC_READ, nv_helpers_dx12::kUploadHeapProps);
 
-    auto heapPointer = reinterpret_cast<UINT64*>(srvUavHeapHandle.ptr);
-    // The ray generation only uses heap data
-    m_sbtHelper.AddRayGenerationProgram(L"RayGen", { heapPointer });
-    m_sbtHelper.AddMissProgram(L"Miss", {});
-    m_sbtHelper.AddMissProgram(L"ShadowMiss", {});
-    m_sbtHelper.AddHitGroup(L"PlaneHitGroup", { heapPointer });
-    m_sbtHelper.AddHitGroup(L"ShadowHitGroup", {});
-
-    uint32_t sbtSize = m_sbtHelper.ComputeSBTSize();
-    m_sbtStorage = nv_helpers_dx12::CreateBuffer(
-        m_pDevice.Get(), sbtSize, D3D12_RESOURCE_FLAG_NONE,
-        D3D12_RESOURCE_STATE_GENERIC_READ, nv_helpers_dx12::kUploadHeapProps);
+        if (!m_sbtStorage[i]) {
+            throw std::logic_error("Could not allocate the shader biding table.");
+        }
 
-    if (!m_sbtStorage) {
-        throw std::logic_error("Could not allocate the shader biding table.");
+        m_sbtHelper.Generate(m_sbtStorage[i].Get(), m_rtStateObjectProps.Get());
     }
-
-    m_sbtHelper.Generate(m_sbtStorage.Get(), m_rtStateObjectProps.Get());
 }
 
 void SampleApp::CreateCameraBuffer() {
@@ -1383,9 +1845,9 @@ void SampleApp::CreateCameraBuffer() {
     m_cameraBufferSize = (m_cameraBufferSize + 255) & ~255;
 
     std::cout << "m_cameraBufferSize (Aligned): " << m_cameraBufferSize << std::endl;
-    //create the constant buffer for all matrices
+    //create the constant buffer for all matrices (1フレーム分ずつ FrameCount 個並べる)
     m_cameraBuffer = nv_helpers_dx12::CreateBuffer(
-        m_pDevice.Get(), m_cameraBufferSize, D3D12_RESOURCE_FLAG_NONE,
+        m_pDevice.Get(), UINT64(m_cameraBufferSize) * FrameCount, D3D12_RESOURCE_FLAG_NONE,
         D3D12_RESOURCE_STATE_GENERIC_READ, nv_helpers_dx12::kUploadHeapProps);
 
     // #DXR Extra - Refitting
@@ -1430,7 +1892,7 @@ void SampleApp::UpdateCameraBuffer() {
     //XMMATRIX は内部的に r[4] という XMVECTOR（4要素ベクトル）が4つ並んだ構造体
     //matrices[0].r は XMVECTOR[4] の配列。
     //matrices[0].r->m128_f32[0] は、最初のXMVECTOR（r[0]）の最初のfloat成分（m128_f32[0]）を指します。
-    auto pTransform = m_Transform[m_FrameIndex]->GetPtr<Transform>();
+    auto pTransform = m_Transform[m_FrameSlot]->GetPtr<Transform>();
     DirectX::XMFLOAT4X4 mat4x4;
     DirectX::XMStoreFloat4x4(&mat4x4, pTransform->View);
     const float* ptr = &mat4x4.m[0][0];
@@ -1451,7 +1913,7 @@ void SampleApp::UpdateCameraBuffer() {
     // Copy the matrix contents
     uint8_t* pData;
     ThrowIfFailed(m_cameraBuffer->Map(0, nullptr, (void**)&pData));
-    memcpy(pData, matrices.data(), m_cameraBufferSize);
+    memcpy(pData + size_t(m_FrameSlot) * m_cameraBufferSize, matrices.data(), matrices.size() * sizeof(DirectX::XMMATRIX));
     m_cameraBuffer->Unmap(0, nullptr);
 }
 
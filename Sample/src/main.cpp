@@ -13,6 +13,69 @@
 // Includes
 //-----------------------------------------------------------------------------
 #include "SampleApp.h"
+#include <PathTracer.h>
+#include <FileUtil.h>
+#include <Logger.h>
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+//      GPU g킸Ƀt@X摜o͂܂.
+//-----------------------------------------------------------------------------
+bool RenderReference(const wchar_t* outputPath)
+{
+    std::wstring path;
+    if (!SearchFilePath(L"../../../Sample/res/buster_sword/sword.obj", path))
+    {
+        ELOG("Error : File Not Found.");
+        return false;
+    }
+
+    std::vector<ResMesh>        resMesh;
+    std::vector<ResMaterial>    resMaterial;
+    if (!LoadMesh(path.c_str(), resMesh, resMaterial, true))
+    {
+        ELOG("Error : Load Mesh Failed. filepath = %ls", path.c_str());
+        return false;
+    }
+
+    PathTracer tracer;
+    if (!tracer.Init(resMesh, resMaterial))
+    {
+        ELOG("Error : PathTracer::Init() Failed.");
+        return false;
+    }
+
+    // SampleApp ̏JECgɍ킹܂.
+    PathTracerDesc desc = {};
+    desc.Width              = 960;
+    desc.Height             = 800;
+    desc.SampleCount        = 64;
+    desc.MaxBounce          = 4;
+    desc.TileSize           = 16;
+    desc.ThreadCount        = 0;
+    desc.Seed               = 0;
+    desc.Camera.Position    = DirectX::XMFLOAT3(0.0f, 0.0f, 3.0f);
+    desc.Camera.Target      = DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f);
+    desc.Camera.Upward      = DirectX::XMFLOAT3(0.0f, 1.0f, 0.0f);
+    desc.Camera.FovY        = DirectX::XMConvertToRadians(37.5f);
+    desc.Light.Position     = DirectX::XMFLOAT3(0.0f, -100.0f, 1500.0f);
+    desc.Light.Color        = DirectX::XMFLOAT3(1.0f, 1.0f, 1.0f);
+    desc.Light.Intensity    = 0.3f;
+    desc.SkyColor           = DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f);
+
+    std::vector<DirectX::XMFLOAT3> pixels;
+    if (!tracer.Render(desc, pixels))
+    {
+        ELOG("Error : PathTracer::Render() Failed.");
+        return false;
+    }
+
+    return SaveHDR(outputPath, desc.Width, desc.Height, pixels);
+}
+
+} // namespace
 
 
 //-----------------------------------------------------------------------------
@@ -24,6 +87,10 @@ int wmain(int argc, wchar_t** argv, wchar_t** envp)
     _CrtSetDbgFlag( _CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF );
 #endif//defined(DEBUG) || defined(_DEBUG)
 
+    // -pathtrace <output.hdr> w肳ꂽꍇ̓EBhE炸 CPU Ń_O܂.
+    if (argc >= 3 && wcscmp(argv[1], L"-pathtrace") == 0)
+    { return RenderReference(argv[2]) ? 0 : -1; }
+
     SampleApp(960, 800).Run();
     //SampleApp(1600, 900).Run();
     return 0;
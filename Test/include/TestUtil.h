@@ -0,0 +1,109 @@
+﻿//-----------------------------------------------------------------------------
+// File : TestUtil.h
+// Desc : Unit Test Utility Module.
+// Copyright(c) Pocol. All right reserved.
+//-----------------------------------------------------------------------------
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <cstdio>
+#include <cstdint>
+#include <string>
+#include <chrono>
+
+
+//-----------------------------------------------------------------------------
+// Macros
+//-----------------------------------------------------------------------------
+#define TEST_WIDEN_(x)  L ## x
+#define TEST_WIDEN(x)   TEST_WIDEN_(x)
+
+//-----------------------------------------------------------------------------
+//! @brief      テストケースを定義します.
+//!
+//! @param[in]      suite       スイート名です. ctest にはスイート単位で登録されます.
+//! @param[in]      name        テスト名です.
+//-----------------------------------------------------------------------------
+#define TEST_CASE(suite, name)                                              \
+    static void Test_##suite##_##name();                                    \
+    static TestRegistrar s_Registrar_##suite##_##name(                      \
+        #suite, #name, Test_##suite##_##name);                              \
+    static void Test_##suite##_##name()
+
+//-----------------------------------------------------------------------------
+//! @brief      条件を検証します. 失敗してもテストは継続します.
+//-----------------------------------------------------------------------------
+#define CHECK(expr)                                                         \
+    do { if (!(expr)) { ReportFailure(__FILE__, __LINE__, #expr); } } while(0)
+
+//-----------------------------------------------------------------------------
+//! @brief      条件を検証します. 失敗した場合はテストを中断します.
+//-----------------------------------------------------------------------------
+#define REQUIRE(expr)                                                       \
+    do { if (!(expr)) { ReportFailure(__FILE__, __LINE__, #expr); return; } } while(0)
+
+
+///////////////////////////////////////////////////////////////////////////////
+// TestRegistrar class
+///////////////////////////////////////////////////////////////////////////////
+class TestRegistrar
+{
+public:
+    //-------------------------------------------------------------------------
+    //! @brief      テストケースを登録します.
+    //-------------------------------------------------------------------------
+    TestRegistrar(const char* suite, const char* name, void (*func)());
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// TestTimer class
+///////////////////////////////////////////////////////////////////////////////
+class TestTimer
+{
+public:
+    //-------------------------------------------------------------------------
+    //! @brief      コンストラクタです. 計測を開始します.
+    //-------------------------------------------------------------------------
+    TestTimer()
+    : m_Start(std::chrono::steady_clock::now())
+    { /* DO_NOTHING */ }
+
+    //-------------------------------------------------------------------------
+    //! @brief      経過時間をミリ秒単位で取得します.
+    //-------------------------------------------------------------------------
+    double GetElapsedMsec() const
+    {
+        auto diff = std::chrono::steady_clock::now() - m_Start;
+        return std::chrono::duration<double, std::milli>(diff).count();
+    }
+
+private:
+    std::chrono::steady_clock::time_point   m_Start;    //!< 計測開始時刻です.
+};
+
+//-----------------------------------------------------------------------------
+//! @brief      検証失敗を報告します.
+//!
+//! @param[in]      file        ファイル名です.
+//! @param[in]      line        行番号です.
+//! @param[in]      expr        失敗した式です.
+//-----------------------------------------------------------------------------
+void ReportFailure(const char* file, int line, const char* expr);
+
+//-----------------------------------------------------------------------------
+//! @brief      サンプルのリソースファイルパスを取得します.
+//!
+//! @param[in]      relativePath    Sample/res からの相対パスです.
+//! @return     絶対パスを返却します.
+//-----------------------------------------------------------------------------
+std::wstring GetTestResourcePath(const wchar_t* relativePath);
+
+//-----------------------------------------------------------------------------
+//! @brief      テスト用の一時ファイルパスを取得します.
+//!
+//! @param[in]      fileName        ファイル名です.
+//! @return     ビルドディレクトリ配下のパスを返却します.
+//-----------------------------------------------------------------------------
+std::wstring GetTestTempPath(const wchar_t* fileName);
@@ -0,0 +1,407 @@
+﻿//-----------------------------------------------------------------------------
+// File : BVHTest.cpp
+// Desc : BVH Unit Test.
+// Copyright(c) Pocol. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <TestUtil.h>
+#include <BVH.h>
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <random>
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+constexpr uint32_t  RayCount    = 2000;     // 単一レイのテストで飛ばすレイの数です.
+constexpr uint32_t  PacketCount = 500;      // パケットのテストで飛ばすパケットの数です.
+
+///////////////////////////////////////////////////////////////////////////////
+// Scene structure
+///////////////////////////////////////////////////////////////////////////////
+struct Scene
+{
+    std::vector<DirectX::XMFLOAT3>  Positions;  //!< 三角形番号順に3頂点ずつ並べた位置です.
+    DirectX::XMFLOAT3               Center;     //!< バウンディングボックスの中心です.
+    float                           Radius;     //!< バウンディングボックスの対角線の半分です.
+};
+
+//-----------------------------------------------------------------------------
+//      BVH と同じ三角形番号順に頂点位置を展開します.
+//-----------------------------------------------------------------------------
+void BuildScene(const std::vector<ResMesh>& meshes, Scene& scene)
+{
+    DirectX::XMFLOAT3 boxMin( FLT_MAX,  FLT_MAX,  FLT_MAX);
+    DirectX::XMFLOAT3 boxMax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+    for(auto& mesh : meshes)
+    {
+        for(size_t i=0; i + 2<mesh.Indices.size(); i+=3)
+        {
+            for(auto j=0; j<3; ++j)
+            {
+                auto& p = mesh.Vertices[mesh.Indices[i + j]].Position;
+                scene.Positions.push_back(p);
+
+                boxMin = DirectX::XMFLOAT3(std::min(boxMin.x, p.x), std::min(boxMin.y, p.y), std::min(boxMin.z, p.z));
+                boxMax = DirectX::XMFLOAT3(std::max(boxMax.x, p.x), std::max(boxMax.y, p.y), std::max(boxMax.z, p.z));
+            }
+        }
+    }
+
+    scene.Center = DirectX::XMFLOAT3(
+        (boxMin.x + boxMax.x) * 0.5f,
+        (boxMin.y + boxMax.y) * 0.5f,
+        (boxMin.z + boxMax.z) * 0.5f);
+
+    auto dx = boxMax.x - boxMin.x;
+    auto dy = boxMax.y - boxMin.y;
+    auto dz = boxMax.z - boxMin.z;
+    scene.Radius = 0.5f * std::sqrt(dx * dx + dy * dy + dz * dz);
+}
+
+//-----------------------------------------------------------------------------
+//      全ての三角形と総当たりで最近接交差を求めます.
+//-----------------------------------------------------------------------------
+BVHHit IntersectBruteForce(const Scene& scene, const BVHRay& ray)
+{
+    BVHHit hit;
+    hit.Distance    = ray.TMax;
+    hit.U           = 0.0f;
+    hit.V           = 0.0f;
+    hit.PrimitiveId = UINT32_MAX;
+
+    float d[3] = { ray.Direction.x, ray.Direction.y, ray.Direction.z };
+
+    // BVH と同じ Moller-Trumbore 法で判定し, 丸め方を揃えます.
+    auto count = uint32_t(scene.Positions.size() / 3);
+    for(auto i=0u; i<count; ++i)
+    {
+        auto& p0 = scene.Positions[i * 3 + 0];
+        auto& p1 = scene.Positions[i * 3 + 1];
+        auto& p2 = scene.Positions[i * 3 + 2];
+
+        float e1[3] = { p1.x - p0.x, p1.y - p0.y, p1.z - p0.z };
+        float e2[3] = { p2.x - p0.x, p2.y - p0.y, p2.z - p0.z };
+
+        float p[3] = {
+            d[1] * e2[2] - d[2] * e2[1],
+            d[2] * e2[0] - d[0] * e2[2],
+            d[0] * e2[1] - d[1] * e2[0] };
+        auto det = e1[0] * p[0] + e1[1] * p[1] + e1[2] * p[2];
+        if (std::fabs(det) < 1e-12f)
+        { continue; }
+
+        auto invDet = 1.0f / det;
+        float s[3] = { ray.Origin.x - p0.x, ray.Origin.y - p0.y, ray.Origin.z - p0.z };
+        auto u = (s[0] * p[0] + s[1] * p[1] + s[2] * p[2]) * invDet;
+        if (u < 0.0f || u > 1.0f)
+        { continue; }
+
+        float q[3] = {
+            s[1] * e1[2] - s[2] * e1[1],
+            s[2] * e1[0] - s[0] * e1[2],
+            s[0] * e1[1] - s[1] * e1[0] };
+        auto v = (d[0] * q[0] + d[1] * q[1] + d[2] * q[2]) * invDet;
+        if (v < 0.0f || u + v > 1.0f)
+        { continue; }
+
+        auto dist = (e2[0] * q[0] + e2[1] * q[1] + e2[2] * q[2]) * invDet;
+        if (dist <= ray.TMin || dist >= hit.Distance)
+        { continue; }
+
+        hit.Distance    = dist;
+        hit.U           = u;
+        hit.V           = v;
+        hit.PrimitiveId = i;
+    }
+
+    return hit;
+}
+
+//-----------------------------------------------------------------------------
+//      テスト用のレイを生成します.
+//-----------------------------------------------------------------------------
+//      外側の球面からメッシュ内部の点を狙うレイを主に生成し, 軸に平行なレイ,
+//      内部から出発するレイ, 途中で打ち切るレイも混ぜます.
+BVHRay GenerateRay(const Scene& scene, std::mt19937& rng, uint32_t index)
+{
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+
+    auto& c = scene.Center;
+    auto  r = scene.Radius;
+
+    // 細長いメッシュでも当たるように, 目標点はランダムな三角形上の点にします.
+    // 一部は三角形から外して, 外れるレイや別の三角形に当たるレイも作ります.
+    std::uniform_int_distribution<size_t> pick(0, scene.Positions.size() / 3 - 1);
+    auto tri = pick(rng);
+    auto& p0 = scene.Positions[tri * 3 + 0];
+    auto& p1 = scene.Positions[tri * 3 + 1];
+    auto& p2 = scene.Positions[tri * 3 + 2];
+    auto  u  = std::fabs(dist(rng));
+    auto  v  = std::fabs(dist(rng)) * (1.0f - u);
+    auto  w  = 1.0f - u - v;
+    auto  jitter = ((index % 3) == 0) ? r * 0.05f : 0.0f;
+
+    DirectX::XMFLOAT3 target(
+        p0.x * w + p1.x * u + p2.x * v + dist(rng) * jitter,
+        p0.y * w + p1.y * u + p2.y * v + dist(rng) * jitter,
+        p0.z * w + p1.z * u + p2.z * v + dist(rng) * jitter);
+    DirectX::XMFLOAT3 origin;
+    if ((index % 5) == 4)
+    {
+        // 内部から出発.
+        origin = DirectX::XMFLOAT3(c.x + dist(rng) * r * 0.3f, c.y + dist(rng) * r * 0.3f, c.z + dist(rng) * r * 0.3f);
+    }
+    else
+    {
+        DirectX::XMFLOAT3 dir(dist(rng), dist(rng), dist(rng));
+        auto len = std::sqrt(dir.x * dir.x + dir.y * dir.y + dir.z * dir.z) + 1e-6f;
+        origin = DirectX::XMFLOAT3(c.x + dir.x / len * r * 2.0f, c.y + dir.y / len * r * 2.0f, c.z + dir.z / len * r * 2.0f);
+    }
+
+    BVHRay ray;
+    ray.Origin    = origin;
+    ray.Direction = DirectX::XMFLOAT3(target.x - origin.x, target.y - origin.y, target.z - origin.z);
+    ray.TMin      = 0.0f;
+    ray.TMax      = FLT_MAX;
+
+    // 軸に平行なレイ (逆数が無限大になる成分を含む).
+    if ((index % 7) == 3)
+    {
+        auto axis = index % 3;
+        ray.Origin.x  = (axis == 0) ? c.x - r * 2.0f : target.x;
+        ray.Origin.y  = (axis == 1) ? c.y - r * 2.0f : target.y;
+        ray.Origin.z  = (axis == 2) ? c.z - r * 2.0f : target.z;
+        ray.Direction = DirectX::XMFLOAT3((axis == 0) ? 1.0f : 0.0f, (axis == 1) ? 1.0f : 0.0f, (axis == 2) ? 1.0f : 0.0f);
+    }
+
+    // 途中で打ち切るレイ. 方向は正規化していないので目標点までが 1 になります.
+    if ((index % 11) == 5)
+    {
+        ray.TMin = 0.2f;
+        ray.TMax = 0.9f;
+    }
+
+    return ray;
+}
+
+//-----------------------------------------------------------------------------
+//      交差結果が総当たりと一致するかチェックします.
+//-----------------------------------------------------------------------------
+bool IsSameHit(bool found, const BVHHit& hit, const BVHHit& expected)
+{
+    if (found != (expected.PrimitiveId != UINT32_MAX))
+    { return false; }
+
+    if (!found)
+    { return hit.PrimitiveId == UINT32_MAX; }
+
+    // 同じ距離の三角形が複数ある場合は番号が異なっても良いものとします.
+    auto tolerance = 1e-5f * std::max(1.0f, expected.Distance);
+    if (std::fabs(hit.Distance - expected.Distance) > tolerance)
+    { return false; }
+
+    if (hit.PrimitiveId == expected.PrimitiveId)
+    { return std::fabs(hit.U - expected.U) <= 1e-5f && std::fabs(hit.V - expected.V) <= 1e-5f; }
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      単一レイの交差判定を総当たりと比較します.
+//-----------------------------------------------------------------------------
+template<typename T>
+void TestSingleRay(const T& bvh, const Scene& scene, uint32_t& hitCount, uint32_t& mismatch)
+{
+    std::mt19937 rng(12345);
+
+    hitCount = 0;
+    mismatch = 0;
+    for(auto i=0u; i<RayCount; ++i)
+    {
+        auto ray      = GenerateRay(scene, rng, i);
+        auto expected = IntersectBruteForce(scene, ray);
+
+        BVHHit hit;
+        auto found = bvh.Intersect(ray, hit);
+        if (!IsSameHit(found, hit, expected))
+        { mismatch++; }
+
+        if (bvh.Occluded(ray) != (expected.PrimitiveId != UINT32_MAX))
+        { mismatch++; }
+
+        if (expected.PrimitiveId != UINT32_MAX)
+        { hitCount++; }
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      4本のレイのパケット判定を総当たりと比較します.
+//-----------------------------------------------------------------------------
+template<typename T>
+void TestPacket(const T& bvh, const Scene& scene, uint32_t& hitCount, uint32_t& mismatch)
+{
+    std::mt19937 rng(67890);
+
+    hitCount = 0;
+    mismatch = 0;
+    for(auto i=0u; i<PacketCount; ++i)
+    {
+        BVHRay rays[4];
+        for(auto j=0u; j<4; ++j)
+        { rays[j] = GenerateRay(scene, rng, i * 4 + j); }
+
+        // 半分のパケットは原点を揃えて, コヒーレントなレイにします.
+        if ((i % 2) == 0)
+        {
+            for(auto j=1u; j<4; ++j)
+            {
+                rays[j].Direction.x += rays[j].Origin.x - rays[0].Origin.x;
+                rays[j].Direction.y += rays[j].Origin.y - rays[0].Origin.y;
+                rays[j].Direction.z += rays[j].Origin.z - rays[0].Origin.z;
+                rays[j].Origin = rays[0].Origin;
+            }
+        }
+
+        // 長さ 0 のレイを含むパケット.
+        if ((i % 13) == 7)
+        { rays[3].TMax = rays[3].TMin; }
+
+        BVHRayPacket4 packet;
+        for(auto j=0u; j<4; ++j)
+        {
+            packet.OriginX   [j] = rays[j].Origin.x;
+            packet.OriginY   [j] = rays[j].Origin.y;
+            packet.OriginZ   [j] = rays[j].Origin.z;
+            packet.DirectionX[j] = rays[j].Direction.x;
+            packet.DirectionY[j] = rays[j].Direction.y;
+            packet.DirectionZ[j] = rays[j].Direction.z;
+            packet.TMin      [j] = rays[j].TMin;
+            packet.TMax      [j] = rays[j].TMax;
+        }
+
+        BVHHitPacket4 hits;
+        auto hitMask      = bvh.Intersect4(packet, hits);
+        auto occludedMask = bvh.Occluded4(packet);
+
+        for(auto j=0u; j<4; ++j)
+        {
+            auto expected = IntersectBruteForce(scene, rays[j]);
+            auto isHit    = (expected.PrimitiveId != UINT32_MAX);
+
+            BVHHit hit;
+            hit.Distance    = hits.Distance[j];
+            hit.U           = hits.U[j];
+            hit.V           = hits.V[j];
+            hit.PrimitiveId = hits.PrimitiveId[j];
+
+            if (!IsSameHit(((hitMask >> j) & 0x1) != 0, hit, expected))
+            { mismatch++; }
+
+            if ((((occludedMask >> j) & 0x1) != 0) != isHit)
+            { mismatch++; }
+
+            if (isHit)
+            { hitCount++; }
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      sword.obj を読み込みます.
+//-----------------------------------------------------------------------------
+bool LoadSword(std::vector<ResMesh>& meshes, Scene& scene)
+{
+    std::vector<ResMaterial> materials;
+    auto path = GetTestResourcePath(L"buster_sword/sword.obj");
+    if (!LoadMesh(path.c_str(), meshes, materials))
+    { return false; }
+
+    BuildScene(meshes, scene);
+    return !scene.Positions.empty();
+}
+
+} // namespace
+
+
+//-----------------------------------------------------------------------------
+//      BVH4 / BVH8 の単一レイの交差判定が総当たりと一致することを確認します.
+//-----------------------------------------------------------------------------
+TEST_CASE(BVH, SingleRay)
+{
+    std::vector<ResMesh> meshes;
+    Scene scene;
+    REQUIRE(LoadSword(meshes, scene));
+
+    BVH4 bvh4;
+    BVH8 bvh8;
+    REQUIRE(bvh4.Init(meshes));
+    REQUIRE(bvh8.Init(meshes));
+    CHECK(bvh4.GetPrimitiveCount() == scene.Positions.size() / 3);
+    CHECK(bvh8.GetPrimitiveCount() == scene.Positions.size() / 3);
+
+    uint32_t hitCount = 0;
+    uint32_t mismatch = 0;
+
+    TestSingleRay(bvh4, scene, hitCount, mismatch);
+    CHECK(mismatch == 0);
+    CHECK(hitCount > RayCount / 4);     // 当たらないレイばかりにならないこと.
+    CHECK(hitCount < RayCount);         // 外れるレイも含まれること.
+
+    TestSingleRay(bvh8, scene, hitCount, mismatch);
+    CHECK(mismatch == 0);
+}
+
+//-----------------------------------------------------------------------------
+//      BVH4 / BVH8 の4本レイのパケット判定が総当たりと一致することを確認します.
+//-----------------------------------------------------------------------------
+TEST_CASE(BVH, Packet4)
+{
+    std::vector<ResMesh> meshes;
+    Scene scene;
+    REQUIRE(LoadSword(meshes, scene));
+
+    BVH4 bvh4;
+    BVH8 bvh8;
+    REQUIRE(bvh4.Init(meshes));
+    REQUIRE(bvh8.Init(meshes));
+
+    uint32_t hitCount = 0;
+    uint32_t mismatch = 0;
+
+    TestPacket(bvh4, scene, hitCount, mismatch);
+    CHECK(mismatch == 0);
+    CHECK(hitCount > PacketCount);
+    CHECK(hitCount < PacketCount * 4);
+
+    TestPacket(bvh8, scene, hitCount, mismatch);
+    CHECK(mismatch == 0);
+}
+
+//-----------------------------------------------------------------------------
+//      空の BVH は何にも交差しないことを確認します.
+//-----------------------------------------------------------------------------
+TEST_CASE(BVH, Empty)
+{
+    BVH8 bvh;
+
+    BVHRay ray;
+    ray.Origin    = DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f);
+    ray.Direction = DirectX::XMFLOAT3(0.0f, 0.0f, 1.0f);
+    ray.TMin      = 0.0f;
+    ray.TMax      = FLT_MAX;
+
+    BVHHit hit;
+    CHECK(!bvh.Intersect(ray, hit));
+    CHECK(hit.PrimitiveId == UINT32_MAX);
+    CHECK(!bvh.Occluded(ray));
+    CHECK(bvh.GetNodeCount() == 0);
+}
@@ -0,0 +1,243 @@
+﻿//-----------------------------------------------------------------------------
+// File : BlasBuildPlannerTest.cpp
+// Desc : BlasBuildPlanner Unit Test.
+// Copyright(c) Pocol. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <TestUtil.h>
+#include <BlasBuildPlanner.h>
+#include <algorithm>
+#include <random>
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+constexpr uint64_t Alignment = 256;     // D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BYTE_ALIGNMENT.
+
+//-----------------------------------------------------------------------------
+//      計画が入力と矛盾していないか確認します.
+//-----------------------------------------------------------------------------
+void CheckPlan(const std::vector<BlasSizeInfo>& sizes, uint64_t budget, const BlasBuildPlan& plan)
+{
+    // 全ての BLAS が入力順に1回ずつ現れる.
+    REQUIRE(plan.Items.size() == sizes.size());
+    for(size_t i=0; i<plan.Items.size(); ++i)
+    { CHECK(plan.Items[i].Index == uint32_t(i)); }
+
+    uint32_t next         = 0;
+    uint64_t maxScratch   = 0;
+    uint64_t maxResult    = 0;
+    uint32_t maxCount     = 0;
+
+    for(size_t b=0; b<plan.Batches.size(); ++b)
+    {
+        auto& batch = plan.Batches[b];
+        REQUIRE(batch.Count > 0);
+        REQUIRE(batch.First == next);
+        REQUIRE(batch.First + batch.Count <= plan.Items.size());
+        next += batch.Count;
+
+        // バッチ内ではアリーナの先頭から隙間なく, 重ならずに並ぶ.
+        uint64_t scratch = 0;
+        uint64_t result  = 0;
+        for(auto i=batch.First; i<batch.First + batch.Count; ++i)
+        {
+            auto& item = plan.Items[i];
+            auto& size = sizes[item.Index];
+
+            CHECK(item.ScratchOffset % Alignment == 0);
+            CHECK(item.ResultOffset  % Alignment == 0);
+            CHECK(item.ScratchOffset == scratch);
+            CHECK(item.ResultOffset  == result);
+
+            scratch += AlignBlasSize(size.ScratchSize);
+            result  += AlignBlasSize(size.ResultSize);
+        }
+
+        CHECK(batch.ScratchSize == scratch);
+        CHECK(batch.ResultSize  == result);
+        CHECK(batch.ScratchSize <= plan.ScratchArenaSize);
+        CHECK(batch.ResultSize  <= plan.ResultArenaSize);
+
+        // 上限を超えてよいのは1つだけのバッチだけ.
+        if (batch.Count > 1)
+        { CHECK(batch.ScratchSize + batch.ResultSize <= budget); }
+
+        // 次の BLAS が入る余地があったのにバッチを閉じていない.
+        if (b + 1 < plan.Batches.size())
+        {
+            auto& following = sizes[plan.Items[next].Index];
+            auto  used      = batch.ScratchSize + batch.ResultSize;
+            CHECK(used + AlignBlasSize(following.ScratchSize) + AlignBlasSize(following.ResultSize) > budget);
+        }
+
+        maxScratch = std::max(maxScratch, batch.ScratchSize);
+        maxResult  = std::max(maxResult,  batch.ResultSize);
+        maxCount   = std::max(maxCount,   batch.Count);
+    }
+
+    CHECK(next == plan.Items.size());
+
+    // アリーナは全バッチで共有するので, 最大のバッチに合わせる.
+    CHECK(plan.ScratchArenaSize == maxScratch);
+    CHECK(plan.ResultArenaSize  == maxResult);
+    CHECK(plan.MaxBatchCount    == maxCount);
+    CHECK(plan.ScratchArenaSize % Alignment == 0);
+    CHECK(plan.ResultArenaSize  % Alignment == 0);
+}
+
+} // namespace
+
+
+//-----------------------------------------------------------------------------
+//      256 バイト単位に切り上げられるか確認します.
+//-----------------------------------------------------------------------------
+TEST_CASE(BlasBuildPlanner, Alignment)
+{
+    CHECK(AlignBlasSize(0)   == 0);
+    CHECK(AlignBlasSize(1)   == 256);
+    CHECK(AlignBlasSize(255) == 256);
+    CHECK(AlignBlasSize(256) == 256);
+    CHECK(AlignBlasSize(257) == 512);
+    CHECK(AlignBlasSize((1ull << 32) + 1) == (1ull << 32) + 256);
+
+    // 端数のあるサイズでも配置は揃う.
+    std::vector<BlasSizeInfo> sizes = {
+        { 100, 1000 },
+        {   0,  300 },
+        { 513,    1 },
+    };
+
+    BlasBuildPlan plan;
+    REQUIRE(PlanBlasBuild(sizes.data(), uint32_t(sizes.size()), UINT64_MAX, plan));
+    REQUIRE(plan.Batches.size() == 1);
+    CHECK(plan.Items[1].ScratchOffset == 256);
+    CHECK(plan.Items[1].ResultOffset  == 1024);
+    CHECK(plan.Items[2].ScratchOffset == 256);
+    CHECK(plan.Items[2].ResultOffset  == 1536);
+    CHECK(plan.ScratchArenaSize == 256 + 768);
+    CHECK(plan.ResultArenaSize  == 1024 + 512 + 256);
+    CheckPlan(sizes, UINT64_MAX, plan);
+}
+
+//-----------------------------------------------------------------------------
+//      上限でバッチが分かれ, アリーナを共有するか確認します.
+//-----------------------------------------------------------------------------
+TEST_CASE(BlasBuildPlanner, BatchSplitting)
+{
+    // 1つあたり 256 + 768 = 1024 バイト. 上限 2048 なら2つずつになる.
+    std::vector<BlasSizeInfo> sizes(5, BlasSizeInfo{ 200, 700 });
+
+    BlasBuildPlan plan;
+    REQUIRE(PlanBlasBuild(sizes.data(), uint32_t(sizes.size()), 2048, plan));
+    REQUIRE(plan.Batches.size() == 3);
+    CHECK(plan.Batches[0].Count == 2);
+    CHECK(plan.Batches[1].Count == 2);
+    CHECK(plan.Batches[2].Count == 1);
+    CHECK(plan.MaxBatchCount    == 2);
+    CHECK(plan.ScratchArenaSize == 512);
+    CHECK(plan.ResultArenaSize  == 1536);
+
+    // 各バッチはアリーナの先頭から使い直す.
+    CHECK(plan.Items[2].ScratchOffset == 0);
+    CHECK(plan.Items[2].ResultOffset  == 0);
+    CHECK(plan.Items[4].ScratchOffset == 0);
+    CheckPlan(sizes, 2048, plan);
+
+    // 上限を超える BLAS は単独のバッチになり, アリーナはそれに合わせて大きくなる.
+    sizes = {
+        { 256,  256 },
+        { 256, 8192 },
+        { 256,  256 },
+        { 256,  256 },
+    };
+    REQUIRE(PlanBlasBuild(sizes.data(), uint32_t(sizes.size()), 2048, plan));
+    REQUIRE(plan.Batches.size() == 3);
+    CHECK(plan.Batches[0].Count == 1);
+    CHECK(plan.Batches[1].Count == 1);
+    CHECK(plan.Batches[1].First == 1);
+    CHECK(plan.Batches[2].Count == 2);
+    CHECK(plan.ResultArenaSize  == 8192);
+    CheckPlan(sizes, 2048, plan);
+
+    // 上限がちょうどの場合は同じバッチに入る.
+    sizes = std::vector<BlasSizeInfo>(4, BlasSizeInfo{ 256, 256 });
+    REQUIRE(PlanBlasBuild(sizes.data(), uint32_t(sizes.size()), 2048, plan));
+    CHECK(plan.Batches.size() == 1);
+    CheckPlan(sizes, 2048, plan);
+}
+
+//-----------------------------------------------------------------------------
+//      不正な入力を扱えるか確認します.
+//-----------------------------------------------------------------------------
+TEST_CASE(BlasBuildPlanner, InvalidInput)
+{
+    BlasBuildPlan plan;
+    REQUIRE(PlanBlasBuild(nullptr, 0, 1024, plan));
+    CHECK(plan.Items.empty());
+    CHECK(plan.Batches.empty());
+    CHECK(plan.ScratchArenaSize == 0);
+    CHECK(plan.ResultArenaSize  == 0);
+
+    CHECK(!PlanBlasBuild(nullptr, 1, 1024, plan));
+
+    // 結果サイズが 0 の BLAS は構築できない.
+    BlasSizeInfo empty = { 256, 0 };
+    CHECK(!PlanBlasBuild(&empty, 1, 1024, plan));
+}
+
+//-----------------------------------------------------------------------------
+//      ランダムなサイズと上限で計画が矛盾しないか確認します.
+//-----------------------------------------------------------------------------
+TEST_CASE(BlasBuildPlanner, Randomized)
+{
+    std::mt19937_64 rng(12345);
+    std::uniform_int_distribution<uint32_t> countDist(1, 64);
+    std::uniform_int_distribution<uint64_t> sizeDist(1, 64 * 1024);
+    std::uniform_int_distribution<uint64_t> budgetDist(256, 512 * 1024);
+
+    for(auto iteration=0; iteration<500; ++iteration)
+    {
+        std::vector<BlasSizeInfo> sizes(countDist(rng));
+        for(auto& size : sizes)
+        {
+            size.ScratchSize = sizeDist(rng);
+            size.ResultSize  = sizeDist(rng);
+        }
+
+        auto budget = budgetDist(rng);
+
+        BlasBuildPlan plan;
+        REQUIRE(PlanBlasBuild(sizes.data(), uint32_t(sizes.size()), budget, plan));
+        CheckPlan(sizes, budget, plan);
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      圧縮後の BLAS が 256 バイト単位で詰められるか確認します.
+//-----------------------------------------------------------------------------
+TEST_CASE(BlasBuildPlanner, Compaction)
+{
+    const uint64_t compacted[] = { 300, 256, 1, 1000 };
+    const uint64_t source   [] = { 900, 512, 2, 4000 };
+
+    BlasCompactionPlan plan;
+    PlanBlasCompaction(compacted, source, 4, plan);
+    REQUIRE(plan.Offsets.size() == 4);
+    CHECK(plan.Offsets[0] == 0);
+    CHECK(plan.Offsets[1] == 512);
+    CHECK(plan.Offsets[2] == 768);
+    CHECK(plan.Offsets[3] == 1024);
+    CHECK(plan.TotalSize  == 2048);
+    CHECK(plan.SourceSize == 1024 + 512 + 256 + 4096);
+
+    PlanBlasCompaction(compacted, nullptr, 4, plan);
+    CHECK(plan.TotalSize  == 2048);
+    CHECK(plan.SourceSize == 0);
+}
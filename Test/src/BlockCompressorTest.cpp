@@ -0,0 +1,377 @@
+﻿//-----------------------------------------------------------------------------
+// File : BlockCompressorTest.cpp
+// Desc : BlockCompressor Unit Test.
+// Copyright(c) Pocol. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <TestUtil.h>
+#include <BlockCompressor.h>
+#include <DdsFile.h>
+#include <MappedFile.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+constexpr uint32_t kBC7Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+//-----------------------------------------------------------------------------
+//      なめらかなグラデーションに小さなノイズを加えた RGBA8 画像を生成します.
+//-----------------------------------------------------------------------------
+std::vector<uint8_t> MakeTestImage(uint32_t width, uint32_t height)
+{
+    std::vector<uint8_t> result(size_t(width) * height * 4);
+    std::mt19937 rng(7);
+
+    for(auto y=0u; y<height; ++y)
+    {
+        for(auto x=0u; x<width; ++x)
+        {
+            auto p = &result[(size_t(y) * width + x) * 4];
+            int value[4] = {
+                int(x * 255 / std::max(width  - 1, 1u)),
+                int(y * 255 / std::max(height - 1, 1u)),
+                int(128 + 100 * sinf(x * 0.2f + y * 0.1f)),
+                int(255 - (x + y) * 2),
+            };
+
+            for(auto c=0; c<4; ++c)
+            { p[c] = uint8_t(std::min(std::max(value[c] + int(rng() % 9) - 4, 0), 255)); }
+        }
+    }
+
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+//      ブロックの指定ビットに値を書き込みます(LSB から数える).
+//-----------------------------------------------------------------------------
+void SetBits(uint8_t* pBlock, uint32_t offset, uint32_t count, uint32_t value)
+{
+    for(auto i=0u; i<count; ++i)
+    {
+        auto bit = offset + i;
+        if ((value >> i) & 1)
+        { pBlock[bit / 8] |= uint8_t(1u << (bit % 8)); }
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      ブロックの指定ビットを読み出します(LSB から数える).
+//-----------------------------------------------------------------------------
+uint32_t GetBits(const uint8_t* pBlock, uint32_t offset, uint32_t count)
+{
+    uint32_t result = 0;
+    for(auto i=0u; i<count; ++i)
+    {
+        auto bit = offset + i;
+        result |= uint32_t((pBlock[bit / 8] >> (bit % 8)) & 1) << i;
+    }
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+//      2つの 4x4 ブロックのチャンネルごとの最大誤差を求めます.
+//-----------------------------------------------------------------------------
+int MaxError(const uint8_t* pLhs, const uint8_t* pRhs)
+{
+    auto result = 0;
+    for(auto i=0; i<64; ++i)
+    { result = std::max(result, std::abs(int(pLhs[i]) - int(pRhs[i]))); }
+    return result;
+}
+
+} // namespace
+
+
+//-----------------------------------------------------------------------------
+//      フォーマットごとに圧縮して展開した画像の PSNR が十分高いことを確認します.
+//-----------------------------------------------------------------------------
+TEST_CASE(BlockCompressor, RoundTripPsnr)
+{
+    struct Case
+    {
+        DXGI_FORMAT Format;
+        uint32_t    ChannelCount;
+        size_t      BlockSize;
+        double      MinPsnr;
+    };
+
+    const Case cases[] = {
+        { DXGI_FORMAT_BC1_UNORM, 3,  8, 32.0 },
+        { DXGI_FORMAT_BC3_UNORM, 4, 16, 33.0 },
+        { DXGI_FORMAT_BC4_UNORM, 1,  8, 45.0 },
+        { DXGI_FORMAT_BC5_UNORM, 2, 16, 45.0 },
+        { DXGI_FORMAT_BC7_UNORM, 4, 16, 36.0 },
+    };
+
+    const uint32_t width  = 64;
+    const uint32_t height = 64;
+    auto image = MakeTestImage(width, height);
+
+    for(auto& item : cases)
+    {
+        std::vector<uint8_t> blocks, decoded;
+        REQUIRE(CompressImage(image.data(), width, height, width * 4, item.Format, blocks));
+        CHECK(blocks.size() == (width / 4) * (height / 4) * item.BlockSize);
+
+        REQUIRE(DecompressImage(blocks.data(), width, height, item.Format, decoded));
+        CHECK(decoded.size() == image.size());
+
+        auto psnr = CalcPsnr(image.data(), decoded.data(), width, height, item.ChannelCount);
+        CHECK(psnr >= item.MinPsnr);
+    }
+
+    // 4の倍数でない大きさは端のピクセルを繰り返して埋めるので, 埋めた画像を圧縮した結果と一致する.
+    auto odd = MakeTestImage(13, 7);
+    std::vector<uint8_t> padded(16 * 8 * 4);
+    for(auto y=0u; y<8; ++y)
+    {
+        for(auto x=0u; x<16; ++x)
+        { memcpy(&padded[(y * 16 + x) * 4], &odd[(std::min(y, 6u) * 13 + std::min(x, 12u)) * 4], 4); }
+    }
+
+    std::vector<uint8_t> blocks, paddedBlocks, decoded;
+    REQUIRE(CompressImage(odd.data(), 13, 7, 13 * 4, DXGI_FORMAT_BC1_UNORM, blocks));
+    REQUIRE(CompressImage(padded.data(), 16, 8, 16 * 4, DXGI_FORMAT_BC1_UNORM, paddedBlocks));
+    CHECK(blocks.size() == 4 * 2 * 8);
+    CHECK(blocks == paddedBlocks);
+    REQUIRE(DecompressImage(blocks.data(), 13, 7, DXGI_FORMAT_BC1_UNORM, decoded));
+    CHECK(decoded.size() == odd.size());
+
+    // 同じ画像なら PSNR は無限大.
+    CHECK(std::isinf(CalcPsnr(image.data(), image.data(), width, height, 4)));
+    CHECK(!CompressImage(image.data(), width, height, width * 4, DXGI_FORMAT_R8G8B8A8_UNORM, blocks));
+}
+
+//-----------------------------------------------------------------------------
+//      仕様どおりに組み立てたモード6のブロックを展開できることを確認します.
+//-----------------------------------------------------------------------------
+TEST_CASE(BlockCompressor, BC7Mode6Decode)
+{
+    // 端点は 7 ビット + P ビット. 先頭ピクセルの番号は最上位ビットを省略して 3 ビット.
+    const uint32_t endpoint[2][4] = {
+        { 127,   0, 64, 127 },
+        {   0, 127, 64, 127 },
+    };
+    const uint32_t pbit[2] = { 1, 0 };
+
+    uint8_t block[16] = {};
+    SetBits(block, 0, 7, 0x40);
+    for(auto c=0u; c<4; ++c)
+    {
+        SetBits(block, 7 + c * 14 + 0, 7, endpoint[0][c]);
+        SetBits(block, 7 + c * 14 + 7, 7, endpoint[1][c]);
+    }
+    SetBits(block, 63, 1, pbit[0]);
+    SetBits(block, 64, 1, pbit[1]);
+
+    uint32_t indices[16];
+    indices[0] = 5;
+    SetBits(block, 65, 3, indices[0]);
+    for(auto i=1u; i<16; ++i)
+    {
+        indices[i] = (i * 7) % 16;
+        SetBits(block, 68 + (i - 1) * 4, 4, indices[i]);
+    }
+
+    uint8_t decoded[64];
+    REQUIRE(DecompressBlock(DXGI_FORMAT_BC7_UNORM, block, decoded));
+
+    for(auto i=0u; i<16; ++i)
+    {
+        auto w = kBC7Weights[indices[i]];
+        for(auto c=0u; c<4; ++c)
+        {
+            auto e0 = (endpoint[0][c] << 1) | pbit[0];
+            auto e1 = (endpoint[1][c] << 1) | pbit[1];
+            CHECK(decoded[i * 4 + c] == uint8_t(((64 - w) * e0 + w * e1 + 32) >> 6));
+        }
+    }
+
+    // モード6以外は展開しない.
+    block[0] = 0x01;
+    CHECK(!DecompressBlock(DXGI_FORMAT_BC7_UNORM, block, decoded));
+}
+
+//-----------------------------------------------------------------------------
+//      先頭ピクセルが端点の逆側にある場合も, 端点を入れ替えて正しく表せることを確認します.
+//-----------------------------------------------------------------------------
+TEST_CASE(BlockCompressor, BC7Mode6Anchor)
+{
+    // 先頭ピクセルが最も明るい場合と最も暗い場合. 主軸の向きに関わらずどちらかは入れ替えが必要になる.
+    for(auto brightFirst=0; brightFirst<2; ++brightFirst)
+    {
+        uint8_t source[64];
+        for(auto i=0; i<16; ++i)
+        {
+            auto t     = brightFirst ? 15 - i : i;
+            auto value = uint8_t(t * 17);
+            source[i * 4 + 0] = value;
+            source[i * 4 + 1] = uint8_t(255 - value);
+            source[i * 4 + 2] = uint8_t(value / 2);
+            source[i * 4 + 3] = 255;
+        }
+
+        uint8_t block[16];
+        CompressBlockBC7(source, block);
+        CHECK(GetBits(block, 0, 7) == 0x40);
+
+        uint8_t decoded[64];
+        REQUIRE(DecompressBlock(DXGI_FORMAT_BC7_UNORM, block, decoded));
+
+        // 先頭ピクセルの番号が 3 ビットに収まっていなければ, 反対側の色に化ける.
+        for(auto c=0; c<4; ++c)
+        { CHECK(std::abs(int(decoded[c]) - int(source[c])) <= 8); }
+        CHECK(MaxError(source, decoded) <= 8);
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      P ビットで奇数と偶数の値を誤差なく表せることを確認します.
+//-----------------------------------------------------------------------------
+TEST_CASE(BlockCompressor, BC7Mode6PBit)
+{
+    struct Case
+    {
+        uint8_t     Color[4];
+        uint32_t    PBit;       //!< 期待する P ビットです. 2 は問わない.
+    };
+
+    const Case cases[] = {
+        { { 255, 255, 255, 255 }, 1 },
+        { {   0,   0,   0,   0 }, 0 },
+        { {   1,   3, 129, 255 }, 1 },
+        { {   2,  64, 200, 254 }, 0 },
+        { { 255,   0, 128,  77 }, 2 },
+    };
+
+    for(auto& item : cases)
+    {
+        uint8_t source[64];
+        for(auto i=0; i<16; ++i)
+        { memcpy(&source[i * 4], item.Color, 4); }
+
+        uint8_t block[16];
+        CompressBlockBC7(source, block);
+
+        uint8_t decoded[64];
+        REQUIRE(DecompressBlock(DXGI_FORMAT_BC7_UNORM, block, decoded));
+
+        if (item.PBit != 2)
+        {
+            // 全チャンネルの偶奇が揃っていれば単色は誤差なく表せる.
+            CHECK(MaxError(source, decoded) == 0);
+            CHECK(GetBits(block, 63, 1) == item.PBit || GetBits(block, 64, 1) == item.PBit);
+        }
+        else
+        {
+            // 偶奇が混ざる場合も補間で1以内に収まる.
+            CHECK(MaxError(source, decoded) <= 1);
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      保存した DDS ファイルのヘッダとピッチを確認します.
+//-----------------------------------------------------------------------------
+TEST_CASE(BlockCompressor, DdsHeader)
+{
+    const uint32_t width  = 64;
+    const uint32_t height = 32;
+    auto image = MakeTestImage(width, height);
+    auto path  = GetTestTempPath(L"block_compressor_bc7.dds");
+
+    BcCompressDesc desc;
+    desc.Format       = DXGI_FORMAT_BC7_UNORM;
+    desc.Type         = BC_TEXTURE_COLOR_ALPHA;
+    desc.GenerateMips = true;
+
+    BcCompressStats stats = {};
+    REQUIRE(CompressTexture(image.data(), width, height, width * 4, desc, path.c_str(), &stats));
+
+    // 64x32 から 1x1 まで 7 段. 4x4 未満のミップも1ブロックを占める.
+    const size_t mipBytes  = 2048 + 512 + 128 + 32 + 16 + 16 + 16;
+    const size_t headerEnd = sizeof(uint32_t) + sizeof(DdsHeader) + sizeof(DdsHeaderDX10);
+    CHECK(stats.CompressedBytes == mipBytes);
+    CHECK(stats.SourceBytes     == uint64_t(64 * 32 + 32 * 16 + 16 * 8 + 8 * 4 + 4 * 2 + 2 * 1 + 1) * 4);
+    CHECK(stats.Psnr            >= 33.0);
+
+    MappedFile file;
+    REQUIRE(file.Open(path.c_str()));
+    REQUIRE(size_t(file.GetSize()) == headerEnd + mipBytes);
+
+    uint32_t      magic;
+    DdsHeader     header;
+    DdsHeaderDX10 ext;
+    memcpy(&magic,  file.GetData(), sizeof(magic));
+    memcpy(&header, file.GetData() + sizeof(uint32_t), sizeof(header));
+    memcpy(&ext,    file.GetData() + sizeof(uint32_t) + sizeof(DdsHeader), sizeof(ext));
+
+    // ブロック圧縮はピッチではなくミップ0のサイズを書く.
+    CHECK(magic                     == DdsMagic);
+    CHECK(header.Size               == sizeof(DdsHeader));
+    CHECK(header.Width              == width);
+    CHECK(header.Height             == height);
+    CHECK(header.MipMapCount        == 7);
+    CHECK((header.Flags & DdsFlagLinearSize)  != 0);
+    CHECK((header.Flags & DdsFlagPitch)       == 0);
+    CHECK((header.Flags & DdsFlagMipMapCount) != 0);
+    CHECK(header.PitchOrLinearSize  == 2048);
+    CHECK((header.Caps & DdsCapsMipMap) != 0);
+    CHECK(header.PixelFormat.Flags  == DdsPixelFourCC);
+    CHECK(header.PixelFormat.FourCC == DdsFourCCDX10);
+    CHECK(ext.Format                == uint32_t(DXGI_FORMAT_BC7_UNORM));
+    CHECK(ext.ResourceDimension     == DdsDimensionTexture2D);
+    CHECK(ext.ArraySize             == 1);
+
+    DdsInfo info = {};
+    std::vector<DdsSubresource> layout;
+    REQUIRE(ParseDdsHeader(file.GetData(), size_t(file.GetSize()), info));
+    REQUIRE(ComputeDdsLayout(info, size_t(file.GetSize()), layout));
+    CHECK(layout[0].RowPitch == 16 * 16);
+    CHECK(layout[0].RowCount == 8);
+    CHECK(layout.back().Offset + layout.back().Size == size_t(file.GetSize()));
+    file.Close();
+
+    // 読み戻したミップ0は圧縮時の PSNR と一致する.
+    uint32_t loadWidth = 0, loadHeight = 0;
+    std::vector<uint8_t> loaded;
+    REQUIRE(LoadTextureRGBA8(path.c_str(), loadWidth, loadHeight, loaded));
+    CHECK(loadWidth  == width);
+    CHECK(loadHeight == height);
+    CHECK(std::fabs(CalcPsnr(image.data(), loaded.data(), width, height, 4) - stats.Psnr) < 1e-6);
+
+    // 非圧縮はミップ0の1行のバイト数を書く.
+    DdsInfo raw = {};
+    raw.Width     = 13;
+    raw.Height    = 7;
+    raw.Depth     = 1;
+    raw.ArraySize = 1;
+    raw.MipLevels = 1;
+    raw.Format    = DXGI_FORMAT_R8G8B8A8_UNORM;
+
+    auto rawPath = GetTestTempPath(L"block_compressor_rgba8.dds");
+    auto pixels  = MakeTestImage(13, 7);
+    REQUIRE(SaveDdsFile(rawPath.c_str(), raw, pixels.data(), pixels.size()));
+    REQUIRE(file.Open(rawPath.c_str()));
+    memcpy(&header, file.GetData() + sizeof(uint32_t), sizeof(header));
+    CHECK((header.Flags & DdsFlagPitch)      != 0);
+    CHECK((header.Flags & DdsFlagLinearSize) == 0);
+    CHECK(header.PitchOrLinearSize == 13 * 4);
+    file.Close();
+
+    // 4の倍数でない大きさは圧縮できない.
+    CHECK(!CompressTexture(pixels.data(), 13, 7, 13 * 4, desc, path.c_str()));
+}
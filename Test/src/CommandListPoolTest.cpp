@@ -0,0 +1,252 @@
+﻿//-----------------------------------------------------------------------------
+// File : CommandListPoolTest.cpp
+// Desc : CommandListPool Unit Test.
+// Copyright(c) Pocol. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <TestUtil.h>
+#include <CommandListPool.h>
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+constexpr uint32_t  kFrameCount = 3;    // フレームごとの資源の数です.
+
+///////////////////////////////////////////////////////////////////////////////
+// Range structure
+///////////////////////////////////////////////////////////////////////////////
+struct Range
+{
+    size_t      Begin   = 0;    //!< 開始番号です.
+    size_t      End     = 0;    //!< 終了番号です.
+    uint32_t    Calls   = 0;    //!< 呼び出し回数です.
+};
+
+//-----------------------------------------------------------------------------
+//      前後に1つずつリストを挟んで並列記録し, 実行までを行います.
+//-----------------------------------------------------------------------------
+uint32_t RecordFrame
+(
+    CommandListPool&    pool,
+    uint32_t            frame,
+    uint32_t            listCount,
+    size_t              itemCount,
+    std::vector<Range>& ranges
+)
+{
+    pool.BeginFrame(frame % kFrameCount);
+
+    auto pre = pool.Reserve(1);
+    pool.Begin(pre);
+    pool.End(pre);
+
+    ranges.assign(listCount, Range());
+    auto first = pool.RecordParallel(listCount, itemCount,
+        [&](ID3D12GraphicsCommandList4*, uint32_t index, size_t begin, size_t end)
+    {
+        // リストごとに別の要素を書くのでロックは不要.
+        ranges[index].Begin = begin;
+        ranges[index].End   = end;
+        ranges[index].Calls++;
+    });
+
+    auto post = pool.Reserve(1);
+    pool.Begin(post);
+    pool.End(post);
+
+    pool.Submit();
+    return first;
+}
+
+} // namespace
+
+
+//-----------------------------------------------------------------------------
+//      描画範囲が隙間無く重複無く分割されることを確認します.
+//-----------------------------------------------------------------------------
+TEST_CASE(CommandListPool, Partition)
+{
+    NullCommandListBackend backend;
+    CommandListPool pool;
+    REQUIRE(pool.Init(&backend, kFrameCount));
+
+    const uint32_t kListCounts[] = { 1, 2, 3, 8, 13 };
+    const size_t   kItemCounts[] = { 0, 1, 7, 64, 1000, 1037 };
+
+    auto frame = 0u;
+    for(auto listCount : kListCounts)
+    {
+        for(auto itemCount : kItemCounts)
+        {
+            std::vector<Range> ranges;
+            auto first = RecordFrame(pool, frame++, listCount, itemCount, ranges);
+            CHECK(first == 1);
+
+            auto badCall  = 0u;
+            auto badRange = 0u;
+            for(auto i=0u; i<listCount; ++i)
+            {
+                if (ranges[i].Calls != 1)
+                { badCall++; }
+
+                // 前の範囲の直後から始まり, 大きさの差は高々1.
+                auto prevEnd = (i == 0) ? 0 : ranges[i - 1].End;
+                auto size    = ranges[i].End - ranges[i].Begin;
+                if (ranges[i].Begin != prevEnd || ranges[i].End < ranges[i].Begin
+                 || size < itemCount / listCount || size > (itemCount + listCount - 1) / listCount)
+                { badRange++; }
+            }
+            CHECK(badCall  == 0);
+            CHECK(badRange == 0);
+            CHECK(ranges.back().End == itemCount);
+        }
+    }
+
+    // リスト数 0 は 1 として扱う.
+    std::vector<Range> ranges;
+    pool.BeginFrame(0);
+    auto calls = 0u;
+    pool.RecordParallel(0, 10, [&](ID3D12GraphicsCommandList4*, uint32_t index, size_t begin, size_t end)
+    {
+        calls++;
+        CHECK(index == 0);
+        CHECK(begin == 0);
+        CHECK(end   == 10);
+    });
+    pool.Submit();
+    CHECK(calls == 1);
+}
+
+//-----------------------------------------------------------------------------
+//      記録の完了順に関係なく予約順に実行され, リストが再利用されることを確認します.
+//-----------------------------------------------------------------------------
+TEST_CASE(CommandListPool, SubmitOrder)
+{
+    NullCommandListBackend backend;
+    CommandListPool pool;
+    REQUIRE(pool.Init(&backend, kFrameCount));
+
+    const uint32_t kListCount  = 8;
+    const uint32_t kFrames     = 10;
+
+    auto badOrder = 0u;
+    for(auto frame=0u; frame<kFrames; ++frame)
+    {
+        auto before = backend.GetExecuted().size();
+
+        std::vector<Range> ranges;
+        RecordFrame(pool, frame, kListCount, 1000 + frame * 37, ranges);
+
+        // 前 + 並列 + 後の順に連番で実行される.
+        auto& executed = backend.GetExecuted();
+        if (executed.size() != before + kListCount + 2)
+        {
+            badOrder++;
+            continue;
+        }
+
+        for(auto i=0u; i<kListCount + 2; ++i)
+        {
+            if (executed[before + i] != i)
+            { badOrder++; }
+        }
+    }
+    CHECK(badOrder == 0);
+
+    // 必要な数だけ生成され, 以降のフレームでは再利用される.
+    CHECK(backend.GetListCount()  == kListCount + 2);
+    CHECK(backend.GetBeginCount() == (kListCount + 2) * kFrames);
+    CHECK(backend.GetEndCount()   == (kListCount + 2) * kFrames);
+
+    // 何も予約しなければ何も実行しない.
+    auto before = backend.GetExecuted().size();
+    pool.BeginFrame(0);
+    pool.Submit();
+    CHECK(backend.GetExecuted().size() == before);
+}
+
+//-----------------------------------------------------------------------------
+//      記録を開始できなかったリストや記録を終えていないリストが実行されないことを確認します.
+//-----------------------------------------------------------------------------
+TEST_CASE(CommandListPool, BeginFailure)
+{
+    NullCommandListBackend backend;
+    CommandListPool pool;
+    REQUIRE(pool.Init(&backend, kFrameCount));
+
+    // 1フレーム目は全て成功させて, 全てのリストに前回の内容を残しておく.
+    std::vector<Range> ranges;
+    RecordFrame(pool, 0, 4, 100, ranges);
+    REQUIRE(backend.GetExecuted().size() == 6);
+
+    // 並列記録の3番目(連番3)の開始を失敗させる.
+    backend.SetBeginFailure(3, true);
+    auto ends   = backend.GetEndCount();
+    auto before = backend.GetExecuted().size();
+    RecordFrame(pool, 1, 4, 100, ranges);
+
+    CHECK(ranges[2].Calls == 0);
+    CHECK(ranges[0].Calls == 1 && ranges[1].Calls == 1 && ranges[3].Calls == 1);
+    CHECK(backend.GetEndCount() == ends + 5);
+
+    const uint32_t kExpected[] = { 0, 1, 2, 4, 5 };
+    auto& executed = backend.GetExecuted();
+    REQUIRE(executed.size() == before + 5);
+    for(auto i=0u; i<5; ++i)
+    { CHECK(executed[before + i] == kExpected[i]); }
+
+    // 失敗したリストを直接 Begin() すると nullptr が返り, End() しても実行されない.
+    pool.BeginFrame(2);
+    auto first = pool.Reserve(4);
+    CHECK(first == 0);
+    CHECK(pool.Begin(3) == nullptr);
+    CHECK(!pool.IsRecording(3));
+    pool.End(3);
+
+    // 開始したが終了していないリスト, 予約しただけのリストも実行しない.
+    pool.Begin(0);
+    CHECK(pool.IsRecording(0));
+    pool.End(0);
+    CHECK(!pool.IsRecording(0));
+    pool.Begin(1);
+    CHECK(pool.IsRecording(1));
+
+    before = backend.GetExecuted().size();
+    pool.Submit();
+    REQUIRE(backend.GetExecuted().size() == before + 1);
+    CHECK(backend.GetExecuted()[before] == 0);
+
+    // 範囲外の連番は記録できない.
+    CHECK(pool.Begin(100) == nullptr);
+    CHECK(!pool.IsRecording(100));
+
+    // 失敗が解消すれば再び実行される.
+    backend.SetBeginFailure(3, false);
+    before = backend.GetExecuted().size();
+    RecordFrame(pool, 3, 4, 100, ranges);
+    CHECK(backend.GetExecuted().size() == before + 6);
+}
+
+//-----------------------------------------------------------------------------
+//      描画数から求めるリスト数を確認します.
+//-----------------------------------------------------------------------------
+TEST_CASE(CommandListPool, ParallelListCount)
+{
+    auto threads = GetWorkerThreadCount();
+
+    CHECK(CommandListPool::GetParallelListCount(0) == 1);
+    CHECK(CommandListPool::GetParallelListCount(1) == 1);
+    CHECK(CommandListPool::GetParallelListCount(64) == 1);
+    CHECK(CommandListPool::GetParallelListCount(65) == std::min(2u, threads));
+    CHECK(CommandListPool::GetParallelListCount(1000000) == threads);
+    CHECK(CommandListPool::GetParallelListCount(10, 0) == std::min(10u, threads));
+}
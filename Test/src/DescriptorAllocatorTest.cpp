@@ -0,0 +1,533 @@
+﻿//-----------------------------------------------------------------------------
+// File : DescriptorAllocatorTest.cpp
+// Desc : DescriptorRangeAllocator and DescriptorPool Unit Test.
+// Copyright(c) Pocol. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <TestUtil.h>
+#include <DescriptorAllocator.h>
+#include <DescriptorPool.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+constexpr uint32_t  kIncrementSize  = 32;               //!< ディスクリプタ間のバイト数です.
+constexpr uint64_t  kHeapStride     = 1ull << 32;       //!< ヒープごとのハンドルの間隔です.
+
+///////////////////////////////////////////////////////////////////////////////
+// FakeHeapBackend class
+///////////////////////////////////////////////////////////////////////////////
+//! @brief      GPU を使わずに番号だけのヒープを払い出すバックエンドです.
+class FakeHeapBackend : public DescriptorHeapBackend
+{
+public:
+    bool        ShaderVisible = false;      //!< GPUハンドルを持たせるかどうか.
+    uint32_t    MaxHeapSize   = UINT32_MAX; //!< 1ヒープあたりのディスクリプタ数の上限です.
+    uint32_t    CreateCount   = 0;          //!< CreateHeap() の呼び出し回数です.
+    uint32_t    DestroyCount  = 0;          //!< DestroyHeap() の呼び出し回数です.
+    uint32_t    LastCount     = 0;          //!< 最後に生成したヒープのディスクリプタ数です.
+
+    bool CreateHeap(uint32_t count, DescriptorHeapPage& page) override
+    {
+        CreateCount++;
+        page.pHeap         = reinterpret_cast<ID3D12DescriptorHeap*>(uintptr_t(CreateCount));
+        page.HandleCPU.ptr = size_t(kHeapStride * CreateCount);
+        page.HandleGPU.ptr = ShaderVisible ? kHeapStride * CreateCount + 8 : 0;
+        page.Count         = count;
+        LastCount          = count;
+        return true;
+    }
+
+    void DestroyHeap(DescriptorHeapPage& page) override
+    {
+        page = DescriptorHeapPage();
+        DestroyCount++;
+    }
+
+    uint32_t GetIncrementSize() const override
+    { return kIncrementSize; }
+
+    uint32_t GetMaxHeapSize() const override
+    { return MaxHeapSize; }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// ShadowHeap class
+///////////////////////////////////////////////////////////////////////////////
+//! @brief      ディスクリプタ番号ごとに使用中かどうかを保持する検証用のヒープです.
+class ShadowHeap
+{
+public:
+    explicit ShadowHeap(uint32_t capacity)
+    : m_Used(capacity, false)
+    { /* DO_NOTHING */ }
+
+    //-------------------------------------------------------------------------
+    //! @brief      範囲が空いているか確認して使用中にします.
+    //-------------------------------------------------------------------------
+    bool Mark(const DescriptorRange& range)
+    {
+        if (range.Offset + range.Count > m_Used.size())
+        { return false; }
+
+        for(auto i=range.Offset; i<range.Offset + range.Count; ++i)
+        {
+            if (m_Used[i])
+            { return false; }
+            m_Used[i] = true;
+        }
+        return true;
+    }
+
+    //-------------------------------------------------------------------------
+    //! @brief      範囲を空きにします.
+    //-------------------------------------------------------------------------
+    void Unmark(const DescriptorRange& range)
+    {
+        for(auto i=range.Offset; i<range.Offset + range.Count; ++i)
+        { m_Used[i] = false; }
+    }
+
+    //-------------------------------------------------------------------------
+    //! @brief      使用中の数, 空きブロック数, 最大の空きブロックを数えます.
+    //-------------------------------------------------------------------------
+    void Count(uint32_t& used, uint32_t& freeBlocks, uint32_t& largest) const
+    {
+        used = freeBlocks = largest = 0;
+
+        uint32_t run = 0;
+        for(auto flag : m_Used)
+        {
+            if (flag)
+            {
+                used++;
+                run = 0;
+                continue;
+            }
+
+            if (run == 0)
+            { freeBlocks++; }
+
+            run++;
+            largest = std::max(largest, run);
+        }
+    }
+
+private:
+    std::vector<bool>   m_Used;
+};
+
+} // namespace
+
+
+//-----------------------------------------------------------------------------
+//      全体を割り当てて解放すると1つの空きブロックに戻ることを確認します.
+//-----------------------------------------------------------------------------
+TEST_CASE(DescriptorRangeAllocator, Coalesce)
+{
+    DescriptorRangeAllocator allocator;
+    CHECK(!allocator.Init(0));
+    REQUIRE(allocator.Init(100));
+
+    DescriptorRange a = {}, b = {}, c = {}, d = {};
+    REQUIRE(allocator.Allocate(10, a));
+    REQUIRE(allocator.Allocate(20, b));
+    REQUIRE(allocator.Allocate(70, c));
+    CHECK(a.Offset == 0);
+    CHECK(b.Offset == 10);
+    CHECK(c.Offset == 30);
+
+    // 空きが無ければ失敗する.
+    CHECK(!allocator.Allocate(1, d));
+    CHECK(!allocator.Allocate(0, d));
+    CHECK(allocator.GetUsedCount() == 100);
+
+    // 間を空けると断片化する.
+    allocator.Free(a);
+    allocator.Free(c);
+    auto stats = allocator.GetStats();
+    CHECK(stats.FreeBlockCount   == 2);
+    CHECK(stats.LargestFreeBlock == 70);
+    CHECK(stats.AllocationCount  == 1);
+    CHECK(!allocator.Allocate(71, d));
+
+    // 真ん中を解放すると前後と結合する.
+    allocator.Free(b);
+    stats = allocator.GetStats();
+    CHECK(stats.UsedCount        == 0);
+    CHECK(stats.FreeBlockCount   == 1);
+    CHECK(stats.LargestFreeBlock == 100);
+    CHECK(stats.Fragmentation    == 0.0f);
+
+    REQUIRE(allocator.Allocate(100, d));
+    CHECK(d.Offset == 0);
+}
+
+//-----------------------------------------------------------------------------
+//      拡張で割り当て済みの範囲が変わらず, 末尾の空きと結合することを確認します.
+//-----------------------------------------------------------------------------
+TEST_CASE(DescriptorRangeAllocator, Grow)
+{
+    DescriptorRangeAllocator allocator;
+    CHECK(!allocator.Grow(10));
+    REQUIRE(allocator.Init(10));
+    CHECK(!allocator.Grow(10));
+    CHECK(!allocator.Grow(5));
+
+    // 末尾が使用中の場合は新しい空きブロックを追加する.
+    DescriptorRange a = {}, b = {}, c = {};
+    REQUIRE(allocator.Allocate(4, a));
+    REQUIRE(allocator.Allocate(6, b));
+    REQUIRE(allocator.Grow(16));
+    CHECK(allocator.GetCapacity() == 16);
+    CHECK(a.Offset == 0 && b.Offset == 4);
+
+    auto stats = allocator.GetStats();
+    CHECK(stats.FreeBlockCount   == 1);
+    CHECK(stats.LargestFreeBlock == 6);
+
+    // 解放した末尾の範囲と拡張した範囲は結合する.
+    allocator.Free(b);
+    stats = allocator.GetStats();
+    CHECK(stats.FreeBlockCount   == 1);
+    CHECK(stats.LargestFreeBlock == 12);
+
+    // 末尾が空きの場合はそのブロックを伸ばす.
+    REQUIRE(allocator.Grow(40));
+    stats = allocator.GetStats();
+    CHECK(stats.Capacity         == 40);
+    CHECK(stats.FreeBlockCount   == 1);
+    CHECK(stats.LargestFreeBlock == 36);
+
+    REQUIRE(allocator.Allocate(36, c));
+    CHECK(c.Offset == 4);
+    CHECK(allocator.GetUsedCount() == 40);
+
+    // 全て解放すると1つの空きブロックに戻る.
+    allocator.Free(a);
+    allocator.Free(c);
+    stats = allocator.GetStats();
+    CHECK(stats.UsedCount        == 0);
+    CHECK(stats.FreeBlockCount   == 1);
+    CHECK(stats.LargestFreeBlock == 40);
+}
+
+//-----------------------------------------------------------------------------
+//      ランダムな割り当てと解放で範囲が重ならず, 統計が実際の空きと一致することを確認します.
+//-----------------------------------------------------------------------------
+TEST_CASE(DescriptorRangeAllocator, Fuzz)
+{
+    const uint32_t capacities[] = { 1, 17, 1000, 4099 };
+
+    for(auto capacity : capacities)
+    {
+        DescriptorRangeAllocator allocator;
+        REQUIRE(allocator.Init(capacity));
+
+        ShadowHeap                   shadow(capacity);
+        std::vector<DescriptorRange> live;
+        std::mt19937                 rng(capacity);
+
+        for(auto step=0; step<20000; ++step)
+        {
+            // 割り当てを多めにして, 満杯付近の状態も通るようにする.
+            if (live.empty() || rng() % 8 < 5)
+            {
+                // 小さい要求を中心に, たまにクラス境界をまたぐ大きな要求を混ぜる.
+                auto count = (rng() % 4 == 0)
+                    ? 1 + uint32_t(rng() % std::max(capacity / 4, 1u))
+                    : 1 + uint32_t(rng() % 8);
+
+                uint32_t used, freeBlocks, largest;
+                shadow.Count(used, freeBlocks, largest);
+
+                // 足りる空きブロックがある限り失敗してはいけない.
+                DescriptorRange range = {};
+                auto result = allocator.Allocate(count, range);
+                CHECK(result == (count <= largest));
+                if (!result)
+                { continue; }
+
+                CHECK(range.Count == count);
+                CHECK(shadow.Mark(range));
+                live.push_back(range);
+            }
+            else
+            {
+                auto index = size_t(rng() % live.size());
+                allocator.Free(live[index]);
+                shadow.Unmark(live[index]);
+                live[index] = live.back();
+                live.pop_back();
+            }
+
+            // 解放時は必ず結合するので, 空きブロック数も一致する.
+            uint32_t used, freeBlocks, largest;
+            shadow.Count(used, freeBlocks, largest);
+
+            auto stats = allocator.GetStats();
+            CHECK(stats.Capacity         == capacity);
+            CHECK(stats.UsedCount        == used);
+            CHECK(stats.AllocationCount  == uint32_t(live.size()));
+            CHECK(stats.FreeBlockCount   == freeBlocks);
+            CHECK(stats.LargestFreeBlock == largest);
+        }
+
+        for(auto& range : live)
+        { allocator.Free(range); }
+
+        auto stats = allocator.GetStats();
+        CHECK(stats.UsedCount        == 0);
+        CHECK(stats.FreeBlockCount   == 1);
+        CHECK(stats.LargestFreeBlock == capacity);
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      シェーダから見えないプールは空きが無くなるとヒープを連結することを確認します.
+//-----------------------------------------------------------------------------
+TEST_CASE(DescriptorPool, ChainCpuHeap)
+{
+    FakeHeapBackend backend;
+    DescriptorPool* pPool = nullptr;
+    REQUIRE(DescriptorPool::Create(&backend, 4, &pPool));
+
+    auto pA = pPool->AllocRange(3);
+    auto pB = pPool->AllocRange(3);
+    auto pC = pPool->AllocRange(10);
+    REQUIRE(pA != nullptr && pB != nullptr && pC != nullptr);
+
+    CHECK(pPool->GetHeapCount() == 3);
+    CHECK(pA->HeapIndex == 0);
+    CHECK(pB->HeapIndex == 1);
+    CHECK(pC->HeapIndex == 2);
+    CHECK(pPool->GetHandleCount() == 4 + 4 + 10);
+    CHECK(!pA->HasGPU());
+    CHECK(pB->HandleCPU.ptr == size_t(kHeapStride * 2));
+    CHECK(pB->GetCPU(2).ptr - pB->HandleCPU.ptr == 2 * kIncrementSize);
+
+    // GPUハンドルを持たないので番号は引けない.
+    CHECK(pPool->GetHandleIndex(pA->HandleGPU) == UINT32_MAX);
+
+    pPool->FreeHandle(pA);
+    pPool->FreeHandle(pB);
+    pPool->FreeHandle(pC);
+    CHECK(pA == nullptr);
+    CHECK(pPool->GetAllocatedHandleCount() == 0);
+
+    pPool->Release();
+    CHECK(backend.DestroyCount == backend.CreateCount);
+}
+
+//-----------------------------------------------------------------------------
+//      シェーダから見えるプールはヒープを連結せずに失敗することを確認します.
+//-----------------------------------------------------------------------------
+TEST_CASE(DescriptorPool, ShaderVisibleNoChain)
+{
+    FakeHeapBackend backend;
+    backend.ShaderVisible = true;
+
+    DescriptorPool* pPool = nullptr;
+    REQUIRE(DescriptorPool::Create(&backend, 8, &pPool));
+
+    auto pA = pPool->AllocRange(5);
+    REQUIRE(pA != nullptr);
+    CHECK(pA->HasGPU());
+    CHECK(pPool->GetHandleIndex(pA->HandleGPU) == 0);
+    CHECK(pPool->GetHandleIndex(pA->GetGPU(4)) == 4);
+
+    // 足りなければヒープを追加せずに失敗する.
+    CHECK(pPool->AllocRange(4) == nullptr);
+    CHECK(pPool->GetHeapCount() == 1);
+    CHECK(backend.CreateCount   == 1);
+
+    DescriptorHandle transient = {};
+    CHECK(!pPool->AllocTransient(DescriptorPool::TransientChunkSize, transient));
+    CHECK(pPool->GetHeapCount() == 1);
+
+    // 残りに収まる要求は成功し, 番号はヒープ先頭から数える.
+    auto pB = pPool->AllocRange(3);
+    REQUIRE(pB != nullptr);
+    CHECK(pB->HeapIndex == 0);
+    CHECK(pPool->GetHandleIndex(pB->HandleGPU) == 5);
+
+    // ヒープ外やディスクリプタ境界に無いハンドルは番号にならない.
+    CHECK(pPool->GetHandleIndex(pB->GetGPU(3)) == UINT32_MAX);
+    CHECK(pPool->GetHandleIndex(D3D12_GPU_DESCRIPTOR_HANDLE{ pA->HandleGPU.ptr + 1 }) == UINT32_MAX);
+    CHECK(pPool->GetHandleIndex(D3D12_GPU_DESCRIPTOR_HANDLE{ pA->HandleGPU.ptr - kIncrementSize }) == UINT32_MAX);
+
+    // 解放すれば再び割り当てられる.
+    pPool->FreeHandle(pA);
+    auto pC = pPool->AllocRange(4);
+    REQUIRE(pC != nullptr);
+    CHECK(pPool->GetHeapCount() == 1);
+
+    pPool->FreeHandle(pB);
+    pPool->FreeHandle(pC);
+    pPool->Release();
+    CHECK(backend.DestroyCount == 1);
+}
+
+//-----------------------------------------------------------------------------
+//      シェーダから見えるプールがヒープを作り直さずに最大数まで広がることを確認します.
+//-----------------------------------------------------------------------------
+TEST_CASE(DescriptorPool, ShaderVisibleGrow)
+{
+    const uint32_t kInitial = 16;
+    const uint32_t kMax     = 200;
+
+    FakeHeapBackend backend;
+    backend.ShaderVisible = true;
+
+    DescriptorPool* pPool = nullptr;
+    REQUIRE(DescriptorPool::Create(&backend, kInitial, kMax, &pPool));
+
+    // 最大数で1つだけ生成し, 割り当て可能な数は最初の数から始まる.
+    CHECK(backend.CreateCount == 1);
+    CHECK(backend.LastCount   == kMax);
+    CHECK(pPool->GetHandleCount()    == kInitial);
+    CHECK(pPool->GetMaxHandleCount() == kMax);
+
+    // 1つずつ割り当てて最初の数を超えても失敗しない.
+    std::vector<DescriptorHandle*>          handles;
+    std::vector<D3D12_GPU_DESCRIPTOR_HANDLE> gpuHandles;
+    std::vector<bool>                        used(kMax, false);
+    auto badIndex = 0u;
+    for(auto i=0u; i<kMax - 10; ++i)
+    {
+        auto pHandle = pPool->AllocHandle();
+        REQUIRE(pHandle != nullptr);
+
+        auto index = pPool->GetHandleIndex(pHandle->HandleGPU);
+        if (pHandle->HeapIndex != 0 || index >= kMax || used[index])
+        { badIndex++; }
+        else
+        { used[index] = true; }
+
+        handles   .push_back(pHandle);
+        gpuHandles.push_back(pHandle->HandleGPU);
+    }
+    CHECK(badIndex == 0);
+    CHECK(pPool->GetHeapCount() == 1);
+    CHECK(backend.CreateCount   == 1);
+    CHECK(pPool->GetHandleCount() >  kInitial);
+    CHECK(pPool->GetHandleCount() <= kMax);
+
+    // 倍々に広がるので, 割り当て数の2倍を超えない.
+    CHECK(pPool->GetHandleCount() <= std::max(2 * (kMax - 10), kInitial));
+
+    // 広げた後も先に割り当てたハンドルは変わらない.
+    auto moved = 0u;
+    for(size_t i=0; i<handles.size(); ++i)
+    {
+        if (handles[i]->HandleGPU.ptr != gpuHandles[i].ptr
+         || pPool->GetHandleIndex(gpuHandles[i]) != uint32_t(i))
+        { moved++; }
+    }
+    CHECK(moved == 0);
+
+    // 残りより大きな要求は最大数に達するので失敗し, ヒープは追加しない.
+    CHECK(pPool->AllocRange(11) == nullptr);
+    CHECK(pPool->GetHandleCount() == kMax);
+    CHECK(pPool->GetHeapCount()   == 1);
+
+    // 残りちょうどは成功する. 一時的な範囲は最大数に達しているので失敗する.
+    auto pRest = pPool->AllocRange(10);
+    REQUIRE(pRest != nullptr);
+    CHECK(pPool->GetHandleIndex(pRest->HandleGPU) == kMax - 10);
+    DescriptorHandle transient = {};
+    CHECK(!pPool->AllocTransient(1, transient));
+
+    for(auto& pHandle : handles)
+    { pPool->FreeHandle(pHandle); }
+    pPool->FreeHandle(pRest);
+    CHECK(pPool->GetAllocatedHandleCount() == 0);
+
+    pPool->Release();
+    CHECK(backend.DestroyCount == 1);
+}
+
+//-----------------------------------------------------------------------------
+//      大きな範囲の要求でも1回の拡張で割り当てられることを確認します.
+//-----------------------------------------------------------------------------
+TEST_CASE(DescriptorPool, GrowLargeRequest)
+{
+    FakeHeapBackend backend;
+    backend.ShaderVisible = true;
+
+    DescriptorPool* pPool = nullptr;
+    REQUIRE(DescriptorPool::Create(&backend, 8, 1024, &pPool));
+
+    auto pA = pPool->AllocRange(6);
+    REQUIRE(pA != nullptr);
+
+    // 倍にしても足りない要求は要求分だけ広げ, 末尾の空きと続けて割り当てる.
+    auto pB = pPool->AllocRange(100);
+    REQUIRE(pB != nullptr);
+    CHECK(pPool->GetHandleIndex(pB->HandleGPU) == 6);
+    CHECK(pPool->GetHandleCount() == 108);
+
+    // 一時的な範囲も広げて割り当てる.
+    DescriptorHandle transient = {};
+    CHECK(pPool->AllocTransient(DescriptorPool::TransientChunkSize, transient));
+    CHECK(pPool->GetHandleIndex(transient.HandleGPU) != UINT32_MAX);
+    CHECK(pPool->GetHeapCount() == 1);
+
+    pPool->FrameEnd(1);
+    pPool->Retire(1);
+    pPool->FreeHandle(pA);
+    pPool->FreeHandle(pB);
+    CHECK(pPool->GetAllocatedHandleCount() == 0);
+    pPool->Release();
+}
+
+//-----------------------------------------------------------------------------
+//      最大数がデバイスの上限に丸められることを確認します.
+//-----------------------------------------------------------------------------
+TEST_CASE(DescriptorPool, DeviceLimit)
+{
+    FakeHeapBackend backend;
+    backend.ShaderVisible = true;
+    backend.MaxHeapSize   = 64;
+
+    // 最大数が上限に丸められる.
+    DescriptorPool* pPool = nullptr;
+    REQUIRE(DescriptorPool::Create(&backend, 16, 100000, &pPool));
+    CHECK(backend.LastCount == 64);
+    CHECK(pPool->GetMaxHandleCount() == 64);
+
+    auto pA = pPool->AllocRange(64);
+    REQUIRE(pA != nullptr);
+    CHECK(pPool->AllocHandle() == nullptr);
+    pPool->FreeHandle(pA);
+    pPool->Release();
+
+    // 最初の数も上限に丸められる.
+    REQUIRE(DescriptorPool::Create(&backend, 100, &pPool));
+    CHECK(backend.LastCount == 64);
+    CHECK(pPool->GetHandleCount() == 64);
+    pPool->Release();
+
+    // シェーダから見えないプールは最大数に達すると連結する.
+    FakeHeapBackend cpuBackend;
+    REQUIRE(DescriptorPool::Create(&cpuBackend, 4, 8, &pPool));
+    auto pB = pPool->AllocRange(8);
+    auto pC = pPool->AllocRange(2);
+    REQUIRE(pB != nullptr && pC != nullptr);
+    CHECK(pB->HeapIndex == 0);
+    CHECK(pC->HeapIndex == 1);
+    CHECK(pPool->GetHandleCount()    == 8 + 4);
+    CHECK(pPool->GetMaxHandleCount() == 8 + 4);
+    pPool->FreeHandle(pB);
+    pPool->FreeHandle(pC);
+    pPool->Release();
+}
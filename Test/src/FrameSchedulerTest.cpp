@@ -0,0 +1,247 @@
+﻿//-----------------------------------------------------------------------------
+// File : FrameSchedulerTest.cpp
+// Desc : FrameScheduler Unit Test.
+// Copyright(c) Pocol. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <TestUtil.h>
+#include <FrameScheduler.h>
+#include <cmath>
+#include <vector>
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+constexpr uint32_t  FrameCount  = 100;      // シミュレーションするフレーム数です.
+constexpr double    Tolerance   = 1e-6;     // 時間の比較に使う許容誤差です.
+
+///////////////////////////////////////////////////////////////////////////////
+// RunResult structure
+///////////////////////////////////////////////////////////////////////////////
+struct RunResult
+{
+    double      CpuTime;        //!< 全フレームを終えて GPU の完了を待つまでの CPU 時間です.
+    double      StallTime;      //!< CPU のストール時間です.
+    double      OverlapTime;    //!< CPU と GPU の並行動作時間です.
+    uint64_t    WaitCount;      //!< BeginFrame() で待機した回数です.
+};
+
+//-----------------------------------------------------------------------------
+//      一定の CPU/GPU 処理時間でフレームを回します.
+//-----------------------------------------------------------------------------
+bool Run(uint32_t latency, double cpuCost, double gpuCost, RunResult& result)
+{
+    SimulatedFrameTimeline timeline;
+    FrameScheduler scheduler;
+    if (!scheduler.Init(&timeline, latency))
+    { return false; }
+
+    timeline.SetGpuCost(gpuCost);
+    for(auto i=0u; i<FrameCount; ++i)
+    {
+        scheduler.BeginFrame();
+        timeline.AdvanceCpu(cpuCost);
+        scheduler.EndFrame();
+    }
+    scheduler.WaitIdle();
+
+    result.CpuTime     = timeline.GetCpuTime();
+    result.StallTime   = timeline.GetStallTime();
+    result.OverlapTime = timeline.GetOverlapTime();
+    result.WaitCount   = scheduler.GetWaitCount();
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      許容誤差内で等しいかチェックします.
+//-----------------------------------------------------------------------------
+bool IsNear(double a, double b)
+{ return std::fabs(a - b) <= Tolerance; }
+
+} // namespace
+
+
+//-----------------------------------------------------------------------------
+//      CPU と GPU が同じ負荷の場合の待機回数とストール・並行動作時間を確認します.
+//-----------------------------------------------------------------------------
+TEST_CASE(FrameScheduler, BalancedLatency)
+{
+    const double kCost = 10.0;
+
+    // レイテンシ1: 毎フレーム直前のフレームの完了を待つので CPU と GPU が交互に動く.
+    RunResult r1;
+    REQUIRE(Run(1, kCost, kCost, r1));
+    CHECK(r1.WaitCount == FrameCount - 1);
+    CHECK(IsNear(r1.StallTime,   (FrameCount - 1) * kCost + kCost));   // 最後の WaitIdle() も含む.
+    CHECK(IsNear(r1.OverlapTime, 0.0));
+    CHECK(IsNear(r1.CpuTime,     FrameCount * kCost * 2.0));
+
+    // レイテンシ2, 3: 1フレーム前の GPU 処理と重なり, 待機は発生しない.
+    for(auto latency=2u; latency<=3u; ++latency)
+    {
+        RunResult r;
+        REQUIRE(Run(latency, kCost, kCost, r));
+        CHECK(r.WaitCount == 0);
+        CHECK(IsNear(r.StallTime,   kCost));                            // 最後の WaitIdle() だけ.
+        CHECK(IsNear(r.OverlapTime, (FrameCount - 1) * kCost));
+        CHECK(IsNear(r.CpuTime,     (FrameCount + 1) * kCost));
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      GPU 律速の場合に先行できるフレーム数だけ待機が減ることを確認します.
+//-----------------------------------------------------------------------------
+TEST_CASE(FrameScheduler, GpuBoundLatency)
+{
+    const double kCpuCost = 4.0;
+    const double kGpuCost = 10.0;
+
+    for(auto latency=1u; latency<=FrameScheduler::MaxLatency; ++latency)
+    {
+        RunResult r;
+        REQUIRE(Run(latency, kCpuCost, kGpuCost, r));
+
+        // 最初の latency フレームはスロットが空いているので待たない.
+        CHECK(r.WaitCount == FrameCount - latency);
+
+        // CPU は自分の処理時間以外は GPU を待っている.
+        CHECK(IsNear(r.StallTime, r.CpuTime - FrameCount * kCpuCost));
+
+        if (latency == 1)
+        {
+            // CPU と GPU が交互に動くので, 1フレームに両方の時間がかかる.
+            CHECK(IsNear(r.CpuTime, FrameCount * (kCpuCost + kGpuCost)));
+            CHECK(IsNear(r.OverlapTime, 0.0));
+        }
+        else
+        {
+            // GPU は最初のフレームの投入後は隙間なく動き続ける.
+            CHECK(IsNear(r.CpuTime, kCpuCost + FrameCount * kGpuCost));
+
+            // 最初のフレーム以外の CPU 処理は全て GPU 処理と重なる.
+            CHECK(IsNear(r.OverlapTime, (FrameCount - 1) * kCpuCost));
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      BeginFrame() の時点でスロットを前回使ったフレームが完了していることを確認します.
+//-----------------------------------------------------------------------------
+TEST_CASE(FrameScheduler, SlotFenceComplete)
+{
+    for(auto latency=1u; latency<=FrameScheduler::MaxLatency; ++latency)
+    {
+        SimulatedFrameTimeline timeline;
+        FrameScheduler scheduler;
+        REQUIRE(scheduler.Init(&timeline, latency));
+
+        std::vector<uint64_t> fences;
+        auto wrongSlot   = 0u;
+        auto notComplete = 0u;
+        for(auto i=0u; i<FrameCount; ++i)
+        {
+            // CPU と GPU の負荷を揺らして, 待つフレームと待たないフレームを混ぜる.
+            timeline.SetGpuCost(double((i * 7) % 13));
+
+            auto slot = scheduler.BeginFrame();
+            if (slot != i % latency || slot != scheduler.GetFrameSlot())
+            { wrongSlot++; }
+
+            if (i >= latency && timeline.GetCompletedValue() < fences[i - latency])
+            { notComplete++; }
+
+            timeline.AdvanceCpu(double((i * 5) % 11));
+            fences.push_back(scheduler.EndFrame());
+        }
+
+        CHECK(wrongSlot   == 0);
+        CHECK(notComplete == 0);
+        CHECK(scheduler.GetFrameNumber() == FrameCount);
+
+        // フェンス値はフレームごとに増えていく.
+        auto notIncreasing = 0u;
+        for(size_t i=1; i<fences.size(); ++i)
+        {
+            if (fences[i] <= fences[i - 1])
+            { notIncreasing++; }
+        }
+        CHECK(notIncreasing == 0);
+
+        scheduler.WaitIdle();
+        CHECK(timeline.GetCompletedValue() == fences.back());
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      SetLatency() が投入済みのフレームを完了させてからスロットを割り当て直すことを確認します.
+//-----------------------------------------------------------------------------
+TEST_CASE(FrameScheduler, SetLatencyDrains)
+{
+    SimulatedFrameTimeline timeline;
+    FrameScheduler scheduler;
+    REQUIRE(scheduler.Init(&timeline, 3));
+
+    // GPU 律速で3フレーム先行させておく.
+    timeline.SetGpuCost(10.0);
+    uint64_t last = 0;
+    for(auto i=0u; i<3; ++i)
+    {
+        scheduler.BeginFrame();
+        timeline.AdvanceCpu(1.0);
+        last = scheduler.EndFrame();
+    }
+    REQUIRE(timeline.GetCompletedValue() < last);
+
+    // 同じ値であれば待たない.
+    auto stall = timeline.GetStallTime();
+    CHECK(scheduler.SetLatency(3));
+    CHECK(IsNear(timeline.GetStallTime(), stall));
+    CHECK(timeline.GetCompletedValue() < last);
+
+    // 範囲外は拒否する.
+    CHECK(!scheduler.SetLatency(0));
+    CHECK(!scheduler.SetLatency(FrameScheduler::MaxLatency + 1));
+    CHECK(scheduler.GetLatency() == 3);
+
+    // 変更すると投入済みのフレームが全て完了する.
+    CHECK(scheduler.SetLatency(2));
+    CHECK(scheduler.GetLatency() == 2);
+    CHECK(timeline.GetCompletedValue() == last);
+    CHECK(timeline.GetStallTime() > stall);
+
+    // スロットのフェンスはリセットされるので, 直後の2フレームは待たない.
+    auto waitCount = scheduler.GetWaitCount();
+    for(auto i=0u; i<2; ++i)
+    {
+        auto slot = scheduler.BeginFrame();
+        CHECK(slot == (3 + i) % 2);
+        timeline.AdvanceCpu(1.0);
+        scheduler.EndFrame();
+    }
+    CHECK(scheduler.GetWaitCount() == waitCount);
+
+    // フレーム中は変更できない.
+    scheduler.BeginFrame();
+    CHECK(!scheduler.SetLatency(1));
+    scheduler.EndFrame();
+    CHECK(scheduler.GetLatency() == 2);
+}
+
+//-----------------------------------------------------------------------------
+//      不正な引数で初期化できないことを確認します.
+//-----------------------------------------------------------------------------
+TEST_CASE(FrameScheduler, InvalidArgument)
+{
+    SimulatedFrameTimeline timeline;
+    FrameScheduler scheduler;
+    CHECK(!scheduler.Init(nullptr, 2));
+    CHECK(!scheduler.Init(&timeline, 0));
+    CHECK(!scheduler.Init(&timeline, FrameScheduler::MaxLatency + 1));
+    CHECK(scheduler.Init(&timeline, FrameScheduler::MaxLatency));
+}
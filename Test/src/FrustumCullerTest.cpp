@@ -0,0 +1,270 @@
+﻿//-----------------------------------------------------------------------------
+// File : FrustumCullerTest.cpp
+// Desc : FrustumCuller / OcclusionBuffer Unit Test.
+// Copyright(c) Pocol. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <TestUtil.h>
+#include <FrustumCuller.h>
+#include <OcclusionBuffer.h>
+#include <algorithm>
+#include <cmath>
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+constexpr float NearZ = 1.0f;       // テストで使うニアクリップ距離です.
+constexpr float FarZ  = 100.0f;     // テストで使うファークリップ距離です.
+
+//-----------------------------------------------------------------------------
+//      ボックスのバウンディングボリュームを作成します.
+//-----------------------------------------------------------------------------
+MeshBounds MakeBox(float x, float y, float z, float ex, float ey, float ez)
+{
+    MeshBounds bounds;
+    bounds.Center = DirectX::XMFLOAT3(x, y, z);
+    bounds.Extent = DirectX::XMFLOAT3(ex, ey, ez);
+    bounds.Radius = std::sqrt(ex * ex + ey * ey + ez * ez);
+    return bounds;
+}
+
+//-----------------------------------------------------------------------------
+//      立方体のバウンディングボリュームを作成します.
+//-----------------------------------------------------------------------------
+MeshBounds MakeCube(float x, float y, float z, float extent)
+{ return MakeBox(x, y, z, extent, extent, extent); }
+
+//-----------------------------------------------------------------------------
+//      原点から +Z を向いた画角 90 度, アスペクト比 1 の射影行列を作成します.
+//-----------------------------------------------------------------------------
+DirectX::XMMATRIX MakeProjection()
+{ return DirectX::XMMatrixPerspectiveFovLH(DirectX::XM_PIDIV2, 1.0f, NearZ, FarZ); }
+
+//-----------------------------------------------------------------------------
+//      可視リストに含まれるかチェックします.
+//-----------------------------------------------------------------------------
+bool Contains(const std::vector<uint32_t>& visible, uint32_t index)
+{ return std::find(visible.begin(), visible.end(), index) != visible.end(); }
+
+} // namespace
+
+
+//-----------------------------------------------------------------------------
+//      6枚の平面のそれぞれで内側と外側を正しく判定するか確認します.
+//-----------------------------------------------------------------------------
+TEST_CASE(FrustumCuller, PlaneExtraction)
+{
+    // 画角 90 度なので, 奥行き z での側面は x = ±z, y = ±z になる.
+    const float e = 0.01f;
+    const MeshBounds inside[] = {
+        MakeCube(-9.9f,  0.0f,  10.0f, e),    // 左.
+        MakeCube( 9.9f,  0.0f,  10.0f, e),    // 右.
+        MakeCube( 0.0f, -9.9f,  10.0f, e),    // 下.
+        MakeCube( 0.0f,  9.9f,  10.0f, e),    // 上.
+        MakeCube( 0.0f,  0.0f,  NearZ + 0.1f, e),   // 前.
+        MakeCube( 0.0f,  0.0f,  FarZ  - 0.1f, e),   // 後.
+    };
+    const MeshBounds outside[] = {
+        MakeCube(-10.1f,  0.0f,  10.0f, e),
+        MakeCube( 10.1f,  0.0f,  10.0f, e),
+        MakeCube(  0.0f,-10.1f,  10.0f, e),
+        MakeCube(  0.0f, 10.1f,  10.0f, e),
+        MakeCube(  0.0f,  0.0f,  NearZ - 0.1f, e),
+        MakeCube(  0.0f,  0.0f,  FarZ  + 0.1f, e),
+    };
+
+    FrustumCuller culler;
+    for(auto& bounds : inside)
+    { culler.Add(bounds); }
+    for(auto& bounds : outside)
+    { culler.Add(bounds); }
+    REQUIRE(culler.GetCount() == 12);
+
+    std::vector<uint32_t> visible;
+    CHECK(culler.Cull(MakeProjection(), nullptr, visible) == 6);
+    for(auto i=0u; i<6; ++i)
+    {
+        CHECK( Contains(visible, i));
+        CHECK(!Contains(visible, i + 6));
+    }
+
+    auto& stats = culler.GetStats();
+    CHECK(stats.Tested          == 12);
+    CHECK(stats.FrustumCulled   == 6);
+    CHECK(stats.OcclusionCulled == 0);
+    CHECK(stats.Visible         == 6);
+
+    // 平面をまたぐボリュームは可視になる.
+    culler.Clear();
+    culler.Add(MakeCube(-10.0f, 0.0f, 10.0f, 0.5f));
+    culler.Add(MakeCube(  0.0f, 0.0f, FarZ,  0.5f));
+    culler.Add(MakeCube(  0.0f, 0.0f, NearZ, 0.5f));
+    CHECK(culler.Cull(MakeProjection(), nullptr, visible) == 3);
+}
+
+//-----------------------------------------------------------------------------
+//      カメラを動かした右手系の行列でも判定できるか確認します.
+//-----------------------------------------------------------------------------
+TEST_CASE(FrustumCuller, ViewProjection)
+{
+    // サンプルと同じ右手系. (0, 0, 10) から原点を見る.
+    auto view = DirectX::XMMatrixLookAtRH(
+        DirectX::XMVectorSet(0.0f, 0.0f, 10.0f, 1.0f),
+        DirectX::XMVectorSet(0.0f, 0.0f,  0.0f, 1.0f),
+        DirectX::XMVectorSet(0.0f, 1.0f,  0.0f, 0.0f));
+    auto proj = DirectX::XMMatrixPerspectiveFovRH(DirectX::XM_PIDIV4, 16.0f / 9.0f, 0.1f, 50.0f);
+    auto viewProj = DirectX::XMMatrixMultiply(view, proj);
+
+    FrustumCuller culler;
+    culler.Add(MakeCube(  0.0f, 0.0f,   0.0f, 1.0f));    // 正面.
+    culler.Add(MakeCube(  0.0f, 0.0f,  20.0f, 1.0f));    // 背後.
+    culler.Add(MakeCube( 30.0f, 0.0f,   0.0f, 1.0f));    // 右の外.
+    culler.Add(MakeCube(  0.0f, 0.0f, -35.0f, 1.0f));    // 遠方の内側.
+    culler.Add(MakeCube(  0.0f, 0.0f, -60.0f, 1.0f));    // ファークリップの外.
+
+    std::vector<uint32_t> visible;
+    CHECK(culler.Cull(viewProj, nullptr, visible) == 2);
+    CHECK(Contains(visible, 0));
+    CHECK(Contains(visible, 3));
+
+    // 更新した値で判定する.
+    culler.Set(1, MakeCube(0.0f, 0.0f, 5.0f, 1.0f));
+    CHECK(culler.Cull(viewProj, nullptr, visible) == 3);
+    CHECK(Contains(visible, 1));
+
+    // 可視リストは番号順.
+    CHECK(std::is_sorted(visible.begin(), visible.end()));
+}
+
+//-----------------------------------------------------------------------------
+//      境界球と AABB の小さい方の半径で判定するか確認します.
+//-----------------------------------------------------------------------------
+TEST_CASE(FrustumCuller, SphereAndBox)
+{
+    FrustumCuller culler;
+
+    // 左平面に沿った細長い AABB. 境界球は左平面をまたぐが, AABB は外側にある.
+    culler.Add(MakeBox(-11.0f, 0.0f, 10.0f, 0.1f, 5.0f, 0.1f));
+
+    // 球状のメッシュ. AABB は左平面(斜め)をまたぐが, 境界球は外側にある.
+    {
+        auto bounds = MakeCube(-11.8f, 0.0f, 10.0f, 1.0f);
+        bounds.Radius = 1.0f;
+        culler.Add(bounds);
+    }
+
+    // どちらでも外側.
+    culler.Add(MakeCube(-20.0f, 0.0f, 10.0f, 1.0f));
+
+    // どちらでも内側.
+    culler.Add(MakeCube(0.0f, 0.0f, 10.0f, 1.0f));
+
+    // 4の倍数でない個数の余りも判定される.
+    culler.Add(MakeCube(0.0f, 0.0f, 20.0f, 1.0f));
+
+    std::vector<uint32_t> visible;
+    CHECK(culler.Cull(MakeProjection(), nullptr, visible) == 2);
+    CHECK(Contains(visible, 3));
+    CHECK(Contains(visible, 4));
+    CHECK(culler.GetStats().FrustumCulled == 3);
+
+    // 境界球だけなら交差と判定される配置であることを確かめておく.
+    {
+        // 左平面は x + z = 0. 法線の長さで割った距離で比べる.
+        auto distance = [](const MeshBounds& b) { return (b.Center.x + b.Center.z) / std::sqrt(2.0f); };
+
+        auto box = MakeBox(-11.0f, 0.0f, 10.0f, 0.1f, 5.0f, 0.1f);
+        CHECK(distance(box) + box.Radius > 0.0f);
+        CHECK(distance(box) + (box.Extent.x + box.Extent.z) / std::sqrt(2.0f) < 0.0f);
+
+        auto sphere = MakeCube(-11.8f, 0.0f, 10.0f, 1.0f);
+        CHECK(distance(sphere) + (sphere.Extent.x + sphere.Extent.z) / std::sqrt(2.0f) > 0.0f);
+        CHECK(distance(sphere) + 1.0f < 0.0f);
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      遮蔽物の後ろにあるボリュームを除外するか確認します.
+//-----------------------------------------------------------------------------
+TEST_CASE(OcclusionBuffer, Occlusion)
+{
+    auto viewProj = MakeProjection();
+
+    OcclusionBuffer buffer;
+    CHECK(!buffer.Init(100, 64));
+    REQUIRE(buffer.Init(64, 32));
+    CHECK(buffer.GetWidth()      == 64);
+    CHECK(buffer.GetHeight()     == 32);
+    CHECK(buffer.GetLevelCount() == 7);
+
+    // z = 5 に 4x4 の壁を置く.
+    const DirectX::XMFLOAT3 positions[] = {
+        { -2.0f, -2.0f, 5.0f },
+        {  2.0f, -2.0f, 5.0f },
+        {  2.0f,  2.0f, 5.0f },
+        { -2.0f,  2.0f, 5.0f },
+    };
+    const uint32_t indices[] = { 0, 1, 2, 0, 2, 3 };
+
+    buffer.Begin(viewProj);
+    CHECK(buffer.RasterizeMesh(positions, sizeof(positions[0]), indices, 6, DirectX::XMMatrixIdentity()) == 2);
+    buffer.End();
+
+    // 上位レベルは下位レベルの 2x2 の最大値になる.
+    for(auto level=1u; level<buffer.GetLevelCount(); ++level)
+    {
+        auto pSrc = buffer.GetDepth(level - 1);
+        auto pDst = buffer.GetDepth(level);
+        auto srcW = std::max(buffer.GetWidth()  >> (level - 1), 1u);
+        auto srcH = std::max(buffer.GetHeight() >> (level - 1), 1u);
+        auto dstW = std::max(buffer.GetWidth()  >> level, 1u);
+        auto dstH = std::max(buffer.GetHeight() >> level, 1u);
+
+        for(auto y=0u; y<dstH; ++y)
+        {
+            for(auto x=0u; x<dstW; ++x)
+            {
+                auto expected = 0.0f;
+                for(auto sy=y*2; sy<std::min(y*2+2, srcH); ++sy)
+                    for(auto sx=x*2; sx<std::min(x*2+2, srcW); ++sx)
+                        expected = std::max(expected, pSrc[sy * srcW + sx]);
+
+                CHECK(pDst[y * dstW + x] == expected);
+            }
+        }
+    }
+
+    CHECK( buffer.IsVisible(MakeCube(0.0f, 0.0f,  3.0f, 0.5f)));   // 手前.
+    CHECK(!buffer.IsVisible(MakeCube(0.0f, 0.0f, 10.0f, 1.0f)));   // 真後ろ.
+    CHECK(!buffer.IsVisible(MakeCube(0.0f, 0.0f, 30.0f, 2.0f)));   // 遠くの後ろ.
+    CHECK( buffer.IsVisible(MakeCube(0.0f, 0.0f, 10.0f, 5.0f)));   // 壁からはみ出す.
+    CHECK( buffer.IsVisible(MakeCube(6.0f, 0.0f, 10.0f, 1.0f)));   // 横にずれている.
+    CHECK( buffer.IsVisible(MakeCube(0.0f, 0.0f,  1.0f, 2.0f)));   // ニアクリップ面をまたぐ.
+
+    // 視錐台カリングと組み合わせる.
+    FrustumCuller culler;
+    culler.Add(MakeCube(  0.0f, 0.0f,  3.0f, 0.5f));
+    culler.Add(MakeCube(  0.0f, 0.0f, 10.0f, 1.0f));
+    culler.Add(MakeCube(-50.0f, 0.0f, 10.0f, 1.0f));
+    culler.Add(MakeCube(  6.0f, 0.0f, 10.0f, 1.0f));
+    culler.Add(MakeCube(  0.0f, 0.0f, 30.0f, 2.0f));
+
+    std::vector<uint32_t> visible;
+    CHECK(culler.Cull(viewProj, &buffer, visible) == 2);
+    CHECK(Contains(visible, 0));
+    CHECK(Contains(visible, 3));
+    CHECK(culler.GetStats().FrustumCulled   == 1);
+    CHECK(culler.GetStats().OcclusionCulled == 2);
+
+    // 描画し直すと遮蔽物は消える.
+    buffer.Begin(viewProj);
+    buffer.End();
+    CHECK(culler.Cull(viewProj, &buffer, visible) == 4);
+    CHECK(culler.GetStats().OcclusionCulled == 0);
+}
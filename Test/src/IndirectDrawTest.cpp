@@ -0,0 +1,298 @@
+﻿//-----------------------------------------------------------------------------
+// File : IndirectDrawTest.cpp
+// Desc : IndirectDraw / GeometryArena Unit Test.
+// Copyright(c) Pocol. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <TestUtil.h>
+#include <IndirectDraw.h>
+#include <algorithm>
+#include <vector>
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+constexpr uint32_t                  kMaterialCount  = 4;            // マテリアル数です.
+constexpr D3D12_GPU_VIRTUAL_ADDRESS kTransformBase  = 0x10000;      // 変換行列のアドレスです.
+
+//-----------------------------------------------------------------------------
+//      テスト用のメッシュを生成します.
+//-----------------------------------------------------------------------------
+ResMesh MakeMesh
+(
+    uint32_t                        vertexCount,
+    uint32_t                        triangleCount,
+    uint32_t                        materialId,
+    const std::vector<uint32_t>&    lodTriangles,
+    uint32_t                        seed
+)
+{
+    ResMesh mesh = {};
+    mesh.MaterialId = materialId;
+
+    mesh.Vertices.resize(vertexCount);
+    for(auto i=0u; i<vertexCount; ++i)
+    { mesh.Vertices[i].Position = DirectX::XMFLOAT3(float(seed * 1000 + i), 0.0f, 0.0f); }
+
+    for(auto i=0u; i<triangleCount * 3; ++i)
+    { mesh.Indices.push_back((i * 7 + seed) % vertexCount); }
+
+    for(auto count : lodTriangles)
+    {
+        ResLod lod = {};
+        lod.IndexOffset = uint32_t(mesh.LodIndices.size());
+        lod.IndexCount  = count * 3;
+        lod.Error       = float(mesh.Lods.size() + 1);
+        mesh.Lods.push_back(lod);
+
+        for(auto i=0u; i<count * 3; ++i)
+        { mesh.LodIndices.push_back((i * 5 + seed + 1) % vertexCount); }
+    }
+
+    return mesh;
+}
+
+//-----------------------------------------------------------------------------
+//      テスト用のメッシュ群を生成します.
+//-----------------------------------------------------------------------------
+std::vector<ResMesh> MakeMeshes()
+{
+    std::vector<ResMesh> meshes;
+    meshes.push_back(MakeMesh(12, 8,  0, { 4, 2 }, 1));
+    meshes.push_back(MakeMesh(5,  3,  2, {},       2));
+    meshes.push_back(MakeMesh(0,  0,  1, {},       3));    // 空のメッシュ.
+    meshes.push_back(MakeMesh(9,  6,  9, { 3 },    4));    // 範囲外のマテリアル番号.
+    return meshes;
+}
+
+//-----------------------------------------------------------------------------
+//      Mesh::Init() と同じメッシュ単体のインデックスの並びを求めます.
+//-----------------------------------------------------------------------------
+void GetMeshLayout(const ResMesh& mesh, std::vector<uint32_t>& indices, std::vector<ResLod>& lods)
+{
+    indices = mesh.Indices;
+    indices.insert(indices.end(), mesh.LodIndices.begin(), mesh.LodIndices.end());
+
+    lods.clear();
+    lods.push_back({ 0, uint32_t(mesh.Indices.size()), 0.0f, 0 });
+    for(auto lod : mesh.Lods)
+    {
+        lod.IndexOffset += uint32_t(mesh.Indices.size());
+        lods.push_back(lod);
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      結合したバッファと引数を生成します.
+//-----------------------------------------------------------------------------
+struct ArenaData
+{
+    std::vector<ResMesh>            Meshes;
+    std::vector<MeshVertex>         Vertices;
+    std::vector<uint32_t>           Indices;
+    std::vector<GeometryArenaRange> Ranges;
+};
+
+bool MakeArena(ArenaData& data)
+{
+    data.Meshes = MakeMeshes();
+    return BuildGeometryArena(data.Meshes, data.Vertices, data.Indices, data.Ranges);
+}
+
+} // namespace
+
+
+//-----------------------------------------------------------------------------
+//      結合したバッファの各範囲がメッシュ単体の並びと一致することを確認します.
+//-----------------------------------------------------------------------------
+TEST_CASE(IndirectDraw, ArenaLayout)
+{
+    ArenaData data;
+    REQUIRE(MakeArena(data));
+    REQUIRE(data.Ranges.size() == data.Meshes.size());
+
+    size_t vertexCount = 0;
+    size_t indexCount  = 0;
+    for(auto& mesh : data.Meshes)
+    {
+        vertexCount += mesh.Vertices.size();
+        indexCount  += mesh.Indices.size() + mesh.LodIndices.size();
+    }
+    CHECK(data.Vertices.size() == vertexCount);
+    CHECK(data.Indices .size() == indexCount);
+
+    auto mismatch   = 0u;
+    auto baseVertex = 0u;
+    auto baseIndex  = 0u;
+    for(size_t i=0; i<data.Meshes.size(); ++i)
+    {
+        auto& mesh  = data.Meshes[i];
+        auto& range = data.Ranges[i];
+
+        CHECK(range.BaseVertex  == baseVertex);
+        CHECK(range.VertexCount == mesh.Vertices.size());
+        CHECK(range.MaterialId  == mesh.MaterialId);
+
+        // 頂点はそのまま並ぶ.
+        for(auto v=0u; v<range.VertexCount; ++v)
+        {
+            if (data.Vertices[range.BaseVertex + v].Position.x != mesh.Vertices[v].Position.x)
+            { mismatch++; }
+        }
+
+        std::vector<uint32_t> indices;
+        std::vector<ResLod>   lods;
+        GetMeshLayout(mesh, indices, lods);
+
+        REQUIRE(range.Lods.size() == lods.size());
+        for(size_t l=0; l<lods.size(); ++l)
+        {
+            // オフセットはメッシュの先頭分だけずれ, 値は頂点番号のまま.
+            CHECK(range.Lods[l].IndexOffset == baseIndex + lods[l].IndexOffset);
+            CHECK(range.Lods[l].IndexCount  == lods[l].IndexCount);
+            CHECK(range.Lods[l].Error       == lods[l].Error);
+            for(auto j=0u; j<lods[l].IndexCount; ++j)
+            {
+                if (data.Indices[range.Lods[l].IndexOffset + j] != indices[lods[l].IndexOffset + j])
+                { mismatch++; }
+            }
+        }
+
+        baseVertex += range.VertexCount;
+        baseIndex  += uint32_t(indices.size());
+    }
+    CHECK(mismatch == 0);
+}
+
+//-----------------------------------------------------------------------------
+//      詳細度とマテリアル番号が丸められ, 描画できないインスタンスが除かれることを確認します.
+//-----------------------------------------------------------------------------
+TEST_CASE(IndirectDraw, BuildArgs)
+{
+    ArenaData data;
+    REQUIRE(MakeArena(data));
+
+    const IndirectDrawItem items[] = {
+        { 0, 0,  kTransformBase + 0x000 },
+        { 0, 2,  kTransformBase + 0x100 },
+        { 0, 99, kTransformBase + 0x200 },  // 最も粗いレベルに丸める.
+        { 1, 1,  kTransformBase + 0x300 },  // LOD が無いので LOD0.
+        { 2, 0,  kTransformBase + 0x400 },  // 空のメッシュは詰めない.
+        { 3, 1,  kTransformBase + 0x500 },  // マテリアル番号は 0 に丸める.
+        { 4, 0,  kTransformBase + 0x600 },  // 範囲外のメッシュは詰めない.
+        { 7, 0,  kTransformBase + 0x700 },
+    };
+    const uint32_t expectLod [] = { 0, 2, 2, 0, 1 };
+    const size_t   expectItem[] = { 0, 1, 2, 3, 5 };
+
+    std::vector<IndirectDrawArgs> args;
+    auto triangles = BuildIndirectDrawArgs(data.Ranges, items, _countof(items), kMaterialCount, args);
+    REQUIRE(args.size() == _countof(expectItem));
+
+    auto expectTriangles = 0u;
+    for(size_t i=0; i<args.size(); ++i)
+    {
+        auto& item  = items[expectItem[i]];
+        auto& range = data.Ranges[item.Mesh];
+        auto& level = range.Lods[expectLod[i]];
+        auto& draw  = args[i].Draw;
+
+        CHECK(args[i].Transform         == item.Transform);
+        CHECK(args[i].MaterialId        == ((range.MaterialId < kMaterialCount) ? range.MaterialId : 0));
+        CHECK(draw.IndexCountPerInstance == level.IndexCount);
+        CHECK(draw.InstanceCount         == 1);
+        CHECK(draw.StartIndexLocation    == level.IndexOffset);
+        CHECK(draw.BaseVertexLocation    == INT(range.BaseVertex));
+        CHECK(draw.StartInstanceLocation == 0);
+
+        expectTriangles += level.IndexCount / 3;
+    }
+    CHECK(args[4].MaterialId == 0);
+    CHECK(triangles == expectTriangles);
+
+    // 詰めた引数は結合したバッファの範囲内を指す.
+    CHECK(ValidateIndirectDrawArgs(
+        args.data(), args.size(),
+        data.Indices.data(), uint32_t(data.Indices.size()),
+        uint32_t(data.Vertices.size()), kMaterialCount));
+
+    // インスタンスが無い場合は空.
+    CHECK(BuildIndirectDrawArgs(data.Ranges, nullptr, 3, kMaterialCount, args) == 0);
+    CHECK(args.empty());
+}
+
+//-----------------------------------------------------------------------------
+//      範囲外を指す引数が検出されることを確認します.
+//-----------------------------------------------------------------------------
+TEST_CASE(IndirectDraw, ValidateRejects)
+{
+    ArenaData data;
+    REQUIRE(MakeArena(data));
+
+    std::vector<IndirectDrawItem> items;
+    for(auto i=0u; i<uint32_t(data.Ranges.size()); ++i)
+    { items.push_back({ i, 0, kTransformBase + i * 0x100 }); }
+
+    std::vector<IndirectDrawArgs> args;
+    BuildIndirectDrawArgs(data.Ranges, items.data(), items.size(), kMaterialCount, args);
+    REQUIRE(args.size() == 3);
+
+    auto pIndices    = data.Indices.data();
+    auto indexCount  = uint32_t(data.Indices.size());
+    auto vertexCount = uint32_t(data.Vertices.size());
+
+    auto validate = [&](const std::vector<IndirectDrawArgs>& value, const uint32_t* pIdx)
+    { return ValidateIndirectDrawArgs(value.data(), value.size(), pIdx, indexCount, vertexCount, kMaterialCount); };
+
+    REQUIRE(validate(args, pIndices));
+
+    auto bad = args;
+    bad[1].Transform = 0;
+    CHECK(!validate(bad, nullptr));
+
+    bad = args;
+    bad[1].MaterialId = kMaterialCount;
+    CHECK(!validate(bad, nullptr));
+
+    bad = args;
+    bad[2].Draw.InstanceCount = 0;
+    CHECK(!validate(bad, nullptr));
+
+    bad = args;
+    bad[0].Draw.BaseVertexLocation = -1;
+    CHECK(!validate(bad, nullptr));
+
+    bad = args;
+    bad[0].Draw.BaseVertexLocation = INT(vertexCount);
+    CHECK(!validate(bad, nullptr));
+
+    // インデックスの範囲がバッファの末尾を超える.
+    bad = args;
+    bad[2].Draw.StartIndexLocation = indexCount - bad[2].Draw.IndexCountPerInstance + 1;
+    CHECK(!validate(bad, nullptr));
+
+    bad = args;
+    bad[2].Draw.StartIndexLocation    = 1;
+    bad[2].Draw.IndexCountPerInstance = UINT32_MAX;
+    CHECK(!validate(bad, nullptr));
+
+    // ベース頂点を足すと頂点バッファの外に出るのはインデックスを見て検出する.
+    bad = args;
+    bad[2].Draw.BaseVertexLocation = INT(vertexCount - 1);
+    CHECK( validate(bad, nullptr));
+    CHECK(!validate(bad, pIndices));
+
+    // 末尾ちょうどまでは有効.
+    bad = args;
+    bad[2].Draw.StartIndexLocation = indexCount - bad[2].Draw.IndexCountPerInstance;
+    CHECK(validate(bad, nullptr));
+
+    CHECK(!ValidateIndirectDrawArgs(nullptr, 1, nullptr, indexCount, vertexCount, kMaterialCount));
+    CHECK( ValidateIndirectDrawArgs(nullptr, 0, nullptr, indexCount, vertexCount, kMaterialCount));
+}
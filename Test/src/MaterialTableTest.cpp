@@ -0,0 +1,214 @@
+﻿//-----------------------------------------------------------------------------
+// File : MaterialTableTest.cpp
+// Desc : MaterialTable Unit Test.
+// Copyright(c) Pocol. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <TestUtil.h>
+#include <MaterialTable.h>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+constexpr uint32_t  kLimit      = 16;   // ディスクリプタ数です.
+constexpr uint32_t  kFallback   = 3;    // 代わりに使うテクスチャ番号です.
+
+//-----------------------------------------------------------------------------
+//      係数が [0,1] に収まっているかチェックします.
+//-----------------------------------------------------------------------------
+bool IsSaturated(float value)
+{ return value >= 0.0f && value <= 1.0f; }
+
+} // namespace
+
+
+//-----------------------------------------------------------------------------
+//      範囲内のテクスチャ番号と係数がそのまま詰められることを確認します.
+//-----------------------------------------------------------------------------
+TEST_CASE(MaterialTable, PackEntry)
+{
+    MaterialParam param;
+    param.BaseColor = DirectX::XMFLOAT3(0.25f, 0.5f, 2.0f);
+    param.Alpha     = 0.75f;
+    param.Roughness = 0.5f;
+    param.Metallic  = 0.0f;
+    param.Occlusion = 1.0f;
+
+    const uint32_t maps[MATERIAL_MAP_COUNT] = { 0, 7, kLimit - 1 };
+    auto entry = PackMaterialEntry(param, maps, kFallback, kLimit);
+
+    // ベースカラーは HDR を許すので上は丸めない.
+    CHECK(entry.BaseColor.x == 0.25f);
+    CHECK(entry.BaseColor.y == 0.5f);
+    CHECK(entry.BaseColor.z == 2.0f);
+    CHECK(entry.Alpha       == 0.75f);
+    CHECK(entry.Roughness   == 0.5f);
+    CHECK(entry.Metallic    == 0.0f);
+    CHECK(entry.Occlusion   == 1.0f);
+
+    CHECK(entry.Maps[MATERIAL_MAP_BASE_COLOR] == 0);
+    CHECK(entry.Maps[MATERIAL_MAP_NORMAL]     == 7);
+    CHECK(entry.Maps[MATERIAL_MAP_ORM]        == kLimit - 1);
+    CHECK(entry.Reserved[0] == 0);
+    CHECK(entry.Reserved[1] == 0);
+}
+
+//-----------------------------------------------------------------------------
+//      未設定と範囲外のテクスチャ番号が代わりの番号になることを確認します.
+//-----------------------------------------------------------------------------
+TEST_CASE(MaterialTable, MapFallback)
+{
+    MaterialParam param;
+
+    const uint32_t kCases[][MATERIAL_MAP_COUNT] = {
+        { InvalidTextureIndex, 1, 2 },
+        { 1, kLimit, 2 },
+        { 1, 2, kLimit + 100 },
+        { InvalidTextureIndex, InvalidTextureIndex, InvalidTextureIndex },
+        { kLimit - 1, kLimit, InvalidTextureIndex - 1 },
+    };
+
+    auto mismatch = 0u;
+    for(auto& maps : kCases)
+    {
+        auto entry = PackMaterialEntry(param, maps, kFallback, kLimit);
+        for(auto i=0; i<MATERIAL_MAP_COUNT; ++i)
+        {
+            auto expected = (maps[i] < kLimit) ? maps[i] : kFallback;
+            if (entry.Maps[i] != expected)
+            { mismatch++; }
+        }
+    }
+    CHECK(mismatch == 0);
+
+    // 上限が 0 であれば全て代わりの番号になる.
+    const uint32_t zero[MATERIAL_MAP_COUNT] = { 0, 0, 0 };
+    auto entry = PackMaterialEntry(param, zero, kFallback, 0);
+    CHECK(entry.Maps[0] == kFallback && entry.Maps[1] == kFallback && entry.Maps[2] == kFallback);
+}
+
+//-----------------------------------------------------------------------------
+//      係数が [0,1] に丸められ, NaN が 0 になることを確認します.
+//-----------------------------------------------------------------------------
+TEST_CASE(MaterialTable, Saturate)
+{
+    const auto kNaN = std::numeric_limits<float>::quiet_NaN();
+    const auto kInf = std::numeric_limits<float>::infinity();
+
+    struct Case { float Input; float Expected; };
+    const Case kCases[] = {
+        { -1.0f,    0.0f },
+        { -0.0f,    0.0f },
+        {  0.0f,    0.0f },
+        {  0.3f,    0.3f },
+        {  1.0f,    1.0f },
+        {  1.5f,    1.0f },
+        {  kInf,    1.0f },
+        { -kInf,    0.0f },
+        {  kNaN,    0.0f },
+        { -kNaN,    0.0f },
+    };
+
+    const uint32_t maps[MATERIAL_MAP_COUNT] = { 0, 1, 2 };
+
+    auto mismatch = 0u;
+    for(auto& c : kCases)
+    {
+        MaterialParam param;
+        param.Alpha     = c.Input;
+        param.Roughness = c.Input;
+        param.Metallic  = c.Input;
+        param.Occlusion = c.Input;
+
+        auto entry = PackMaterialEntry(param, maps, kFallback, kLimit);
+        const float values[] = { entry.Alpha, entry.Roughness, entry.Metallic, entry.Occlusion };
+        for(auto v : values)
+        {
+            if (!IsSaturated(v) || v != c.Expected)
+            { mismatch++; }
+        }
+    }
+    CHECK(mismatch == 0);
+
+    // ベースカラーは負の値と NaN だけを 0 にする.
+    MaterialParam param;
+    param.BaseColor = DirectX::XMFLOAT3(-2.0f, kNaN, 8.0f);
+    auto entry = PackMaterialEntry(param, maps, kFallback, kLimit);
+    CHECK(entry.BaseColor.x == 0.0f);
+    CHECK(entry.BaseColor.y == 0.0f);
+    CHECK(entry.BaseColor.z == 8.0f);
+}
+
+//-----------------------------------------------------------------------------
+//      テーブルがマテリアル番号順に詰められることを確認します.
+//-----------------------------------------------------------------------------
+TEST_CASE(MaterialTable, PackTable)
+{
+    std::vector<MaterialParam> params(4);
+    std::vector<uint32_t>      maps;
+    for(auto i=0u; i<params.size(); ++i)
+    {
+        params[i].Roughness = 0.25f * float(i);
+        maps.push_back(i);
+        maps.push_back(InvalidTextureIndex);
+        maps.push_back(kLimit + i);
+    }
+
+    std::vector<MaterialEntry> result(10);   // 既存の内容は置き換わる.
+    REQUIRE(PackMaterialTable(params, maps, kFallback, kLimit, result));
+    REQUIRE(result.size() == params.size());
+
+    auto mismatch = 0u;
+    for(auto i=0u; i<params.size(); ++i)
+    {
+        if (result[i].Roughness != 0.25f * float(i)
+         || result[i].Maps[MATERIAL_MAP_BASE_COLOR] != i
+         || result[i].Maps[MATERIAL_MAP_NORMAL]     != kFallback
+         || result[i].Maps[MATERIAL_MAP_ORM]        != kFallback)
+        { mismatch++; }
+    }
+    CHECK(mismatch == 0);
+
+    // 空のテーブル.
+    std::vector<MaterialParam> empty;
+    std::vector<uint32_t>      emptyMaps;
+    CHECK(PackMaterialTable(empty, emptyMaps, kFallback, kLimit, result));
+    CHECK(result.empty());
+}
+
+//-----------------------------------------------------------------------------
+//      不正な引数を拒否することを確認します.
+//-----------------------------------------------------------------------------
+TEST_CASE(MaterialTable, InvalidArgument)
+{
+    std::vector<MaterialParam> params(2);
+    std::vector<uint32_t>      maps(params.size() * MATERIAL_MAP_COUNT, 0);
+
+    // 要素数の不一致.
+    std::vector<MaterialEntry> result;
+    std::vector<uint32_t> shortMaps(maps.size() - 1, 0);
+    std::vector<uint32_t> longMaps (maps.size() + 1, 0);
+    CHECK(!PackMaterialTable(params, shortMaps, kFallback, kLimit, result));
+    CHECK(!PackMaterialTable(params, longMaps,  kFallback, kLimit, result));
+    CHECK(result.empty());
+
+    // 代わりの番号が範囲外.
+    CHECK(!PackMaterialTable(params, maps, kLimit,     kLimit, result));
+    CHECK(!PackMaterialTable(params, maps, kLimit + 1, kLimit, result));
+    CHECK(!PackMaterialTable(params, maps, InvalidTextureIndex, kLimit, result));
+    CHECK(!PackMaterialTable(params, maps, 0, 0, result));
+    CHECK(result.empty());
+
+    // 境界の値は受け付ける.
+    CHECK(PackMaterialTable(params, maps, kLimit - 1, kLimit, result));
+    CHECK(result.size() == params.size());
+}
@@ -0,0 +1,341 @@
+﻿//-----------------------------------------------------------------------------
+// File : MeshLoadTest.cpp
+// Desc : Mesh Loading Unit Test.
+// Copyright(c) Pocol. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <TestUtil.h>
+#include <ResMesh.h>
+#include <ParallelUtil.h>
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+const wchar_t* SampleMeshes[] = {
+    L"buster_sword/sword.obj",
+    L"teapot/teapot.obj",
+};
+constexpr uint32_t  SubmeshCount    = 1000;     // 生成するシーンのサブメッシュ数です.
+constexpr uint32_t  SubmeshGridSize = 8;        // サブメッシュ1つあたりの格子の分割数です.
+
+//-----------------------------------------------------------------------------
+//      要素ごとにバイト比較します.
+//-----------------------------------------------------------------------------
+template<typename T>
+bool IsSameArray(const std::vector<T>& a, const std::vector<T>& b)
+{
+    if (a.size() != b.size())
+    { return false; }
+
+    return a.empty() || memcmp(a.data(), b.data(), sizeof(T) * a.size()) == 0;
+}
+
+//-----------------------------------------------------------------------------
+//      2つの読み込み結果が同一かどうか確認します.
+//-----------------------------------------------------------------------------
+void CheckIdentical
+(
+    const std::vector<ResMesh>&     meshesA,
+    const std::vector<ResMaterial>& materialsA,
+    const std::vector<ResNode>&     nodesA,
+    const std::vector<ResMesh>&     meshesB,
+    const std::vector<ResMaterial>& materialsB,
+    const std::vector<ResNode>&     nodesB
+)
+{
+    REQUIRE(meshesA.size() == meshesB.size());
+    for(size_t i=0; i<meshesA.size(); ++i)
+    {
+        CHECK(meshesA[i].MaterialId == meshesB[i].MaterialId);
+        CHECK(IsSameArray(meshesA[i].Vertices, meshesB[i].Vertices));
+        CHECK(IsSameArray(meshesA[i].Indices,  meshesB[i].Indices));
+    }
+
+    REQUIRE(materialsA.size() == materialsB.size());
+    for(size_t i=0; i<materialsA.size(); ++i)
+    {
+        auto& a = materialsA[i];
+        auto& b = materialsB[i];
+        CHECK(memcmp(&a.Diffuse,  &b.Diffuse,  sizeof(a.Diffuse))  == 0);
+        CHECK(memcmp(&a.Specular, &b.Specular, sizeof(a.Specular)) == 0);
+        CHECK(a.Alpha        == b.Alpha);
+        CHECK(a.Shininess    == b.Shininess);
+        CHECK(a.DiffuseMap   == b.DiffuseMap);
+        CHECK(a.SpecularMap  == b.SpecularMap);
+        CHECK(a.ShininessMap == b.ShininessMap);
+        CHECK(a.NormalMap    == b.NormalMap);
+    }
+
+    REQUIRE(nodesA.size() == nodesB.size());
+    for(size_t i=0; i<nodesA.size(); ++i)
+    {
+        CHECK(nodesA[i].Name   == nodesB[i].Name);
+        CHECK(nodesA[i].Parent == nodesB[i].Parent);
+        CHECK(nodesA[i].Meshes == nodesB[i].Meshes);
+        CHECK(memcmp(&nodesA[i].Transform, &nodesB[i].Transform, sizeof(nodesA[i].Transform)) == 0);
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      ファイルに書き込みます.
+//-----------------------------------------------------------------------------
+bool WriteTextFile(const std::wstring& path, const std::string& text)
+{
+    auto hFile = CreateFileW(
+        path.c_str(),
+        GENERIC_WRITE,
+        0,
+        nullptr,
+        CREATE_ALWAYS,
+        FILE_ATTRIBUTE_NORMAL,
+        nullptr);
+    if (hFile == INVALID_HANDLE_VALUE)
+    { return false; }
+
+    DWORD written = 0;
+    auto result = WriteFile(hFile, text.data(), DWORD(text.size()), &written, nullptr);
+    CloseHandle(hFile);
+
+    return result && written == DWORD(text.size());
+}
+
+//-----------------------------------------------------------------------------
+//      サブメッシュを大量に含むシーンを OBJ ファイルとして一時フォルダに書き出します.
+//-----------------------------------------------------------------------------
+//      サブメッシュごとに別のマテリアルを割り当てるので, 頂点をワールド空間に変換して
+//      マテリアル単位にまとめる読み込み方でもサブメッシュ数は減りません.
+bool WriteManySubmeshScene(std::wstring& path)
+{
+    const auto n = SubmeshGridSize;
+
+    std::string obj;
+    std::string mtl;
+    obj.reserve(SubmeshCount * (n + 1) * (n + 1) * 96);
+    obj += "mtllib many_submesh.mtl\n";
+
+    char line[256];
+    auto base = 1u;
+    for(auto m=0u; m<SubmeshCount; ++m)
+    {
+        snprintf(line, sizeof(line), "newmtl part%u\nKd %.3f %.3f %.3f\nNs %u\n\n",
+            m, float(m % 10) / 10.0f, float((m / 10) % 10) / 10.0f, float(m / 100) / 10.0f, 1 + m % 64);
+        mtl += line;
+
+        snprintf(line, sizeof(line), "o part%u\nusemtl part%u\n", m, m);
+        obj += line;
+
+        // 少しずつずらして並べた, 起伏のある格子です.
+        auto ox = float(m % 32) * 1.5f;
+        auto oz = float(m / 32) * 1.5f;
+        for(auto y=0u; y<=n; ++y)
+        {
+            for(auto x=0u; x<=n; ++x)
+            {
+                auto u = float(x) / float(n);
+                auto v = float(y) / float(n);
+                snprintf(line, sizeof(line), "v %.4f %.4f %.4f\nvt %.4f %.4f\nvn 0 1 0\n",
+                    ox + u, 0.1f * float((x * 7 + y * 3 + m) % 5), oz + v, u, v);
+                obj += line;
+            }
+        }
+
+        for(auto y=0u; y<n; ++y)
+        {
+            for(auto x=0u; x<n; ++x)
+            {
+                auto i0 = base + y * (n + 1) + x;
+                auto i1 = i0 + 1;
+                auto i2 = i0 + (n + 1);
+                auto i3 = i2 + 1;
+                snprintf(line, sizeof(line), "f %u/%u/%u %u/%u/%u %u/%u/%u\nf %u/%u/%u %u/%u/%u %u/%u/%u\n",
+                    i0, i0, i0, i2, i2, i2, i1, i1, i1,
+                    i1, i1, i1, i2, i2, i2, i3, i3, i3);
+                obj += line;
+            }
+        }
+
+        base += (n + 1) * (n + 1);
+    }
+
+    path = GetTestTempPath(L"many_submesh.obj");
+    return WriteTextFile(GetTestTempPath(L"many_submesh.mtl"), mtl)
+        && WriteTextFile(path, obj);
+}
+
+//-----------------------------------------------------------------------------
+//      並列読み込みに使うスレッド数を取得します.
+//-----------------------------------------------------------------------------
+uint32_t GetParallelThreadCount()
+{ return std::max(GetWorkerThreadCount(), 4u); }
+
+} // namespace
+
+
+//-----------------------------------------------------------------------------
+//      並列に変換した結果が逐次処理と一致するか確認します(ワールド空間に変換する場合).
+//-----------------------------------------------------------------------------
+TEST_CASE(MeshLoad, ParallelMatchesSerial)
+{
+    for(auto relativePath : SampleMeshes)
+    {
+        auto path = GetTestResourcePath(relativePath);
+
+        std::vector<ResMesh>     serialMeshes,    parallelMeshes;
+        std::vector<ResMaterial> serialMaterials, parallelMaterials;
+        REQUIRE(ImportMesh(path.c_str(), serialMeshes,   serialMaterials,   nullptr, 1));
+        REQUIRE(ImportMesh(path.c_str(), parallelMeshes, parallelMaterials, nullptr, GetParallelThreadCount()));
+        REQUIRE(!serialMeshes.empty());
+
+        CheckIdentical(
+            serialMeshes,   serialMaterials,   std::vector<ResNode>(),
+            parallelMeshes, parallelMaterials, std::vector<ResNode>());
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      並列に変換した結果が逐次処理と一致するか確認します(ノード階層を保つ場合).
+//-----------------------------------------------------------------------------
+TEST_CASE(MeshLoad, ParallelMatchesSerialHierarchy)
+{
+    for(auto relativePath : SampleMeshes)
+    {
+        auto path = GetTestResourcePath(relativePath);
+
+        std::vector<ResMesh>     serialMeshes,    parallelMeshes;
+        std::vector<ResMaterial> serialMaterials, parallelMaterials;
+        std::vector<ResNode>     serialNodes,     parallelNodes;
+        REQUIRE(ImportMesh(path.c_str(), serialMeshes,   serialMaterials,   &serialNodes,   1));
+        REQUIRE(ImportMesh(path.c_str(), parallelMeshes, parallelMaterials, &parallelNodes, GetParallelThreadCount()));
+        REQUIRE(!serialNodes.empty());
+
+        CheckIdentical(
+            serialMeshes,   serialMaterials,   serialNodes,
+            parallelMeshes, parallelMaterials, parallelNodes);
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      1000 個のサブメッシュを含むシーンで並列と逐次の結果が一致するか確認します.
+//-----------------------------------------------------------------------------
+TEST_CASE(MeshLoad, ManySubmeshes)
+{
+    std::wstring path;
+    REQUIRE(WriteManySubmeshScene(path));
+
+    const auto triangleCount = SubmeshGridSize * SubmeshGridSize * 2;
+
+    // ノード階層を保つ場合.
+    {
+        std::vector<ResMesh>     serialMeshes,    parallelMeshes;
+        std::vector<ResMaterial> serialMaterials, parallelMaterials;
+        std::vector<ResNode>     serialNodes,     parallelNodes;
+        REQUIRE(ImportMesh(path.c_str(), serialMeshes,   serialMaterials,   &serialNodes,   1));
+        REQUIRE(ImportMesh(path.c_str(), parallelMeshes, parallelMaterials, &parallelNodes, GetParallelThreadCount()));
+        REQUIRE(serialMeshes.size() == SubmeshCount);
+        CHECK(serialMaterials.size() >= SubmeshCount);
+
+        auto wrongSize = 0u;
+        for(auto& mesh : serialMeshes)
+        {
+            if (mesh.Indices.size() != triangleCount * 3 || mesh.Vertices.empty())
+            { wrongSize++; }
+        }
+        CHECK(wrongSize == 0);
+
+        CheckIdentical(
+            serialMeshes,   serialMaterials,   serialNodes,
+            parallelMeshes, parallelMaterials, parallelNodes);
+    }
+
+    // ワールド空間に変換する場合.
+    {
+        std::vector<ResMesh>     serialMeshes,    parallelMeshes;
+        std::vector<ResMaterial> serialMaterials, parallelMaterials;
+        REQUIRE(ImportMesh(path.c_str(), serialMeshes,   serialMaterials,   nullptr, 1));
+        REQUIRE(ImportMesh(path.c_str(), parallelMeshes, parallelMaterials, nullptr, GetParallelThreadCount()));
+        REQUIRE(serialMeshes.size() == SubmeshCount);
+
+        CheckIdentical(
+            serialMeshes,   serialMaterials,   std::vector<ResNode>(),
+            parallelMeshes, parallelMaterials, std::vector<ResNode>());
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      サンプルのアセットの読み込み時間を計測します.
+//-----------------------------------------------------------------------------
+TEST_CASE(MeshLoadBench, SampleAssets)
+{
+    const auto kRepeat = 3;
+
+    for(auto relativePath : SampleMeshes)
+    {
+        auto path = GetTestResourcePath(relativePath);
+
+        // 各スレッド数で数回読み込み, 最短時間を採用する.
+        double best[2] = { 1e30, 1e30 };
+        uint32_t threadCounts[2] = { 1, GetParallelThreadCount() };
+        size_t vertexCount = 0;
+        for(auto r=0; r<kRepeat; ++r)
+        {
+            for(auto t=0; t<2; ++t)
+            {
+                std::vector<ResMesh>     meshes;
+                std::vector<ResMaterial> materials;
+                std::vector<ResNode>     nodes;
+
+                TestTimer timer;
+                REQUIRE(ImportMesh(path.c_str(), meshes, materials, &nodes, threadCounts[t]));
+                best[t] = std::min(best[t], timer.GetElapsedMsec());
+
+                vertexCount = 0;
+                for(auto& mesh : meshes)
+                { vertexCount += mesh.Vertices.size(); }
+            }
+        }
+
+        printf_s("    %ls : %zu vertices, serial %.2f ms, %u threads %.2f ms\n",
+            relativePath, vertexCount, best[0], threadCounts[1], best[1]);
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      1000 個のサブメッシュを含むシーンの読み込み時間を計測します.
+//-----------------------------------------------------------------------------
+TEST_CASE(MeshLoadBench, ManySubmeshes)
+{
+    const auto kRepeat = 3;
+
+    std::wstring path;
+    REQUIRE(WriteManySubmeshScene(path));
+
+    // 各スレッド数で数回読み込み, 最短時間を採用する.
+    double best[2] = { 1e30, 1e30 };
+    uint32_t threadCounts[2] = { 1, GetParallelThreadCount() };
+    for(auto r=0; r<kRepeat; ++r)
+    {
+        for(auto t=0; t<2; ++t)
+        {
+            std::vector<ResMesh>     meshes;
+            std::vector<ResMaterial> materials;
+            std::vector<ResNode>     nodes;
+
+            TestTimer timer;
+            REQUIRE(ImportMesh(path.c_str(), meshes, materials, &nodes, threadCounts[t]));
+            best[t] = std::min(best[t], timer.GetElapsedMsec());
+            REQUIRE(meshes.size() == SubmeshCount);
+        }
+    }
+
+    printf_s("    %u submeshes : serial %.2f ms, %u threads %.2f ms\n",
+        SubmeshCount, best[0], threadCounts[1], best[1]);
+}
@@ -0,0 +1,258 @@
+﻿//-----------------------------------------------------------------------------
+// File : OrmPackerTest.cpp
+// Desc : OrmPacker Unit Test.
+// Copyright(c) Pocol. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <TestUtil.h>
+#include <OrmPacker.h>
+#include <vector>
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+//      チャンネルごとに異なる値を持つ RGBA8 画像を生成します.
+//-----------------------------------------------------------------------------
+std::vector<uint8_t> MakeImage(uint32_t width, uint32_t height, uint8_t seed)
+{
+    std::vector<uint8_t> pixels(size_t(width) * height * 4);
+    for(auto y=0u; y<height; ++y)
+    {
+        for(auto x=0u; x<width; ++x)
+        {
+            auto p = &pixels[(size_t(y) * width + x) * 4];
+            for(auto c=0u; c<4; ++c)
+            { p[c] = uint8_t(seed + (y * width + x) * 4 + c * 61); }
+        }
+    }
+    return pixels;
+}
+
+//-----------------------------------------------------------------------------
+//      入力画像を設定します.
+//-----------------------------------------------------------------------------
+OrmSourceImage MakeSource(const std::vector<uint8_t>& pixels, uint32_t width, uint32_t height, uint32_t channel)
+{
+    OrmSourceImage source;
+    source.pPixels = pixels.data();
+    source.Width   = width;
+    source.Height  = height;
+    source.Channel = channel;
+    return source;
+}
+
+} // namespace
+
+
+//-----------------------------------------------------------------------------
+//      入力画像の指定チャンネルが R/G/B に詰められることを確認します.
+//-----------------------------------------------------------------------------
+TEST_CASE(OrmPacker, ChannelPlacement)
+{
+    auto ao    = MakeImage(4, 4, 10);
+    auto rough = MakeImage(4, 4, 20);
+    auto metal = MakeImage(4, 4, 30);
+
+    // 入力ごとに別のチャンネルから取り出す.
+    const OrmSourceImage sources[ORM_CHANNEL_COUNT] = {
+        MakeSource(ao,    4, 4, 0),
+        MakeSource(rough, 4, 4, 1),
+        MakeSource(metal, 4, 4, 3),
+    };
+
+    uint32_t width  = 0;
+    uint32_t height = 0;
+    std::vector<uint8_t> result;
+    REQUIRE(PackOrmImage(sources, width, height, result));
+    REQUIRE(width  == 4);
+    REQUIRE(height == 4);
+    REQUIRE(result.size() == 4 * 4 * 4);
+
+    auto mismatch = 0u;
+    for(auto i=0u; i<16; ++i)
+    {
+        if (result[i * 4 + 0] != ao   [i * 4 + 0]) { mismatch++; }
+        if (result[i * 4 + 1] != rough[i * 4 + 1]) { mismatch++; }
+        if (result[i * 4 + 2] != metal[i * 4 + 3]) { mismatch++; }
+        if (result[i * 4 + 3] != 255)              { mismatch++; }
+    }
+    CHECK(mismatch == 0);
+}
+
+//-----------------------------------------------------------------------------
+//      入力の無いチャンネルが 255 で埋められることを確認します.
+//-----------------------------------------------------------------------------
+TEST_CASE(OrmPacker, MissingChannel)
+{
+    auto rough = MakeImage(4, 4, 20);
+
+    // オクルージョンは未設定, メタリックは不正なチャンネル番号.
+    OrmSourceImage sources[ORM_CHANNEL_COUNT] = {
+        OrmSourceImage(),
+        MakeSource(rough, 4, 4, 2),
+        MakeSource(rough, 4, 4, 4),
+    };
+
+    uint32_t width  = 0;
+    uint32_t height = 0;
+    std::vector<uint8_t> result;
+    REQUIRE(PackOrmImage(sources, width, height, result));
+    REQUIRE(result.size() == 4 * 4 * 4);
+
+    auto mismatch = 0u;
+    for(auto i=0u; i<16; ++i)
+    {
+        if (result[i * 4 + 0] != 255)              { mismatch++; }
+        if (result[i * 4 + 1] != rough[i * 4 + 2]) { mismatch++; }
+        if (result[i * 4 + 2] != 255)              { mismatch++; }
+        if (result[i * 4 + 3] != 255)              { mismatch++; }
+    }
+    CHECK(mismatch == 0);
+
+    // 入力が1枚もない場合は失敗する.
+    sources[ORM_CHANNEL_ROUGHNESS].Width = 0;
+    CHECK(!PackOrmImage(sources, width, height, result));
+}
+
+//-----------------------------------------------------------------------------
+//      サイズの異なる入力が最近傍で拡大されることを確認します.
+//-----------------------------------------------------------------------------
+TEST_CASE(OrmPacker, NearestResample)
+{
+    auto ao    = MakeImage(8, 8, 10);
+    auto rough = MakeImage(2, 2, 20);
+    auto metal = MakeImage(4, 8, 30);
+
+    const OrmSourceImage sources[ORM_CHANNEL_COUNT] = {
+        MakeSource(ao,    8, 8, 0),
+        MakeSource(rough, 2, 2, 0),
+        MakeSource(metal, 4, 8, 0),
+    };
+
+    uint32_t width  = 0;
+    uint32_t height = 0;
+    std::vector<uint8_t> result;
+    REQUIRE(PackOrmImage(sources, width, height, result));
+    REQUIRE(width  == 8);
+    REQUIRE(height == 8);
+
+    auto mismatch = 0u;
+    for(auto y=0u; y<8; ++y)
+    {
+        for(auto x=0u; x<8; ++x)
+        {
+            auto p = &result[(y * 8 + x) * 4];
+            if (p[0] != ao   [(y * 8 + x) * 4])             { mismatch++; }
+            if (p[1] != rough[((y / 4) * 2 + (x / 4)) * 4]) { mismatch++; }
+            if (p[2] != metal[(y * 4 + (x / 2)) * 4])       { mismatch++; }
+        }
+    }
+    CHECK(mismatch == 0);
+}
+
+//-----------------------------------------------------------------------------
+//      出力が4の倍数に切り上げられることを確認します.
+//-----------------------------------------------------------------------------
+TEST_CASE(OrmPacker, PadToBlock)
+{
+    auto ao    = MakeImage(5, 3, 10);
+    auto rough = MakeImage(2, 6, 20);
+
+    const OrmSourceImage sources[ORM_CHANNEL_COUNT] = {
+        MakeSource(ao,    5, 3, 0),
+        MakeSource(rough, 2, 6, 1),
+        OrmSourceImage(),
+    };
+
+    uint32_t width  = 0;
+    uint32_t height = 0;
+    std::vector<uint8_t> result;
+    REQUIRE(PackOrmImage(sources, width, height, result));
+
+    // 最大サイズ 5x6 を切り上げて 8x8.
+    CHECK(width  == 8);
+    CHECK(height == 8);
+    REQUIRE(result.size() == 8 * 8 * 4);
+
+    // 切り上げた領域も最近傍で入力を引き伸ばして埋める.
+    auto mismatch = 0u;
+    for(auto y=0u; y<8; ++y)
+    {
+        for(auto x=0u; x<8; ++x)
+        {
+            auto p  = &result[(y * 8 + x) * 4];
+            auto ax = x * 5 / 8;
+            auto ay = y * 3 / 8;
+            auto rx = x * 2 / 8;
+            auto ry = y * 6 / 8;
+            if (p[0] != ao   [(ay * 5 + ax) * 4 + 0]) { mismatch++; }
+            if (p[1] != rough[(ry * 2 + rx) * 4 + 1]) { mismatch++; }
+            if (p[2] != 255)                          { mismatch++; }
+            if (p[3] != 255)                          { mismatch++; }
+        }
+    }
+    CHECK(mismatch == 0);
+
+    // 4の倍数であればそのまま.
+    const OrmSourceImage exact[ORM_CHANNEL_COUNT] = {
+        MakeSource(ao, 4, 3, 0),
+        OrmSourceImage(),
+        OrmSourceImage(),
+    };
+    REQUIRE(PackOrmImage(exact, width, height, result));
+    CHECK(width  == 4);
+    CHECK(height == 4);
+}
+
+//-----------------------------------------------------------------------------
+//      同じ入力の組み合わせは同じキャッシュ名になり, チャンネルが異なれば区別されることを確認します.
+//-----------------------------------------------------------------------------
+TEST_CASE(OrmPacker, CachePath)
+{
+    OrmSourcePaths a;
+    a.Paths[ORM_CHANNEL_OCCLUSION] = L"res/model/ao.dds";
+    a.Paths[ORM_CHANNEL_ROUGHNESS] = L"res/model/rough.dds";
+    a.Paths[ORM_CHANNEL_METALLIC]  = L"res/model/metal.dds";
+
+    auto path = GetOrmCachePath(a);
+
+    // 最初の入力と同じフォルダの orm_<16桁>.dds.
+    const std::wstring prefix = L"res/model/orm_";
+    REQUIRE(path.size() == prefix.size() + 16 + 4);
+    CHECK(path.compare(0, prefix.size(), prefix) == 0);
+    CHECK(path.compare(path.size() - 4, 4, L".dds") == 0);
+
+    // 同じ組み合わせのマテリアルは共有する.
+    OrmSourcePaths b = a;
+    CHECK(GetOrmCachePath(b) == path);
+
+    // 入力が1つ違えば別のキャッシュ.
+    b.Paths[ORM_CHANNEL_METALLIC] = L"res/model/metal2.dds";
+    CHECK(GetOrmCachePath(b) != path);
+
+    // 同じファイルでもチャンネルが異なれば区別する.
+    OrmSourcePaths c;
+    OrmSourcePaths d;
+    c.Paths[ORM_CHANNEL_ROUGHNESS] = L"res/model/mask.dds";
+    d.Paths[ORM_CHANNEL_METALLIC]  = L"res/model/mask.dds";
+    CHECK(GetOrmCachePath(c) != GetOrmCachePath(d));
+
+    // 入れ替えても区別する.
+    OrmSourcePaths e;
+    e.Paths[ORM_CHANNEL_OCCLUSION] = L"res/model/rough.dds";
+    e.Paths[ORM_CHANNEL_ROUGHNESS] = L"res/model/ao.dds";
+    e.Paths[ORM_CHANNEL_METALLIC]  = L"res/model/metal.dds";
+    CHECK(GetOrmCachePath(e) != path);
+
+    // フォルダが無い場合はカレントフォルダ.
+    OrmSourcePaths f;
+    f.Paths[ORM_CHANNEL_METALLIC] = L"metal.dds";
+    CHECK(GetOrmCachePath(f).compare(0, 6, L"./orm_") == 0);
+
+    // 入力が無い場合は空文字.
+    CHECK(GetOrmCachePath(OrmSourcePaths()).empty());
+}
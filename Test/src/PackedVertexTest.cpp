@@ -0,0 +1,141 @@
+﻿//-----------------------------------------------------------------------------
+// File : PackedVertexTest.cpp
+// Desc : PackedVertex Unit Test.
+// Copyright(c) Pocol. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <TestUtil.h>
+#include <PackedVertex.h>
+#include <algorithm>
+#include <cmath>
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+//      2つの方向ベクトルのなす角 [rad] を求めます. 長さ 0 の場合は負値を返却します.
+//-----------------------------------------------------------------------------
+double AngleBetween(const DirectX::XMFLOAT3& a, const DirectX::XMFLOAT3& b)
+{
+    double ax = a.x, ay = a.y, az = a.z;
+    double bx = b.x, by = b.y, bz = b.z;
+    if (ax * ax + ay * ay + az * az <= 1e-12)
+    { return -1.0; }
+
+    // acos は 1 付近で精度が落ちるので atan2 で求める.
+    auto cx = ay * bz - az * by;
+    auto cy = az * bx - ax * bz;
+    auto cz = ax * by - ay * bx;
+    auto c  = sqrt(cx * cx + cy * cy + cz * cz);
+    auto d  = ax * bx + ay * by + az * bz;
+    return atan2(c, d);
+}
+
+//-----------------------------------------------------------------------------
+//      サンプルのメッシュを圧縮・復元し, 誤差が上限に収まるか確認します.
+//-----------------------------------------------------------------------------
+void CheckRoundTrip(const wchar_t* relativePath)
+{
+    auto path = GetTestResourcePath(relativePath);
+
+    std::vector<ResMesh>     meshes;
+    std::vector<ResMaterial> materials;
+    REQUIRE(LoadMesh(path.c_str(), meshes, materials));
+    REQUIRE(!meshes.empty());
+
+    for(auto& mesh : meshes)
+    {
+        REQUIRE(!mesh.Vertices.empty());
+
+        std::vector<PackedVertex> packed;
+        PackedVertexQuantization  quantization;
+        PackVertices(mesh.Vertices, packed, quantization);
+        REQUIRE(packed.size() == mesh.Vertices.size());
+
+        auto maxTexCoord = 0.0f;
+        for(auto& vertex : mesh.Vertices)
+        {
+            maxTexCoord = std::max(maxTexCoord, fabsf(vertex.TexCoord.x));
+            maxTexCoord = std::max(maxTexCoord, fabsf(vertex.TexCoord.y));
+        }
+
+        auto bound = GetPackedVertexError(quantization, maxTexCoord);
+
+        PackedVertexError actual = {};
+        auto tangentSignOk = true;
+        for(size_t i=0; i<packed.size(); ++i)
+        {
+            auto& src = mesh.Vertices[i];
+
+            float tangentSign = 0.0f;
+            auto  dst = DecodeVertex(packed[i], quantization, &tangentSign);
+            tangentSignOk &= (tangentSign == 1.0f);
+
+            actual.Position.x = std::max(actual.Position.x, fabsf(dst.Position.x - src.Position.x));
+            actual.Position.y = std::max(actual.Position.y, fabsf(dst.Position.y - src.Position.y));
+            actual.Position.z = std::max(actual.Position.z, fabsf(dst.Position.z - src.Position.z));
+
+            auto normalError  = AngleBetween(src.Normal,  dst.Normal);
+            auto tangentError = AngleBetween(src.Tangent, dst.Tangent);
+            actual.Direction = std::max(actual.Direction, float(std::max(normalError, tangentError)));
+
+            actual.TexCoord = std::max(actual.TexCoord, fabsf(dst.TexCoord.x - src.TexCoord.x));
+            actual.TexCoord = std::max(actual.TexCoord, fabsf(dst.TexCoord.y - src.TexCoord.y));
+        }
+
+        printf_s("    %ls : %zu vertices, position (%g, %g, %g) <= (%g, %g, %g), direction %g <= %g, texcoord %g <= %g\n",
+            relativePath, packed.size(),
+            actual.Position.x, actual.Position.y, actual.Position.z,
+            bound .Position.x, bound .Position.y, bound .Position.z,
+            actual.Direction, bound.Direction,
+            actual.TexCoord,  bound.TexCoord);
+
+        CHECK(tangentSignOk);
+        CHECK(actual.Position.x <= bound.Position.x);
+        CHECK(actual.Position.y <= bound.Position.y);
+        CHECK(actual.Position.z <= bound.Position.z);
+        CHECK(actual.Direction  <= bound.Direction);
+        CHECK(actual.TexCoord   <= bound.TexCoord);
+    }
+}
+
+} // namespace
+
+
+//-----------------------------------------------------------------------------
+//      buster_sword を圧縮・復元します.
+//-----------------------------------------------------------------------------
+TEST_CASE(PackedVertex, RoundTripSword)
+{ CheckRoundTrip(L"buster_sword/sword.obj"); }
+
+//-----------------------------------------------------------------------------
+//      teapot を圧縮・復元します.
+//-----------------------------------------------------------------------------
+TEST_CASE(PackedVertex, RoundTripTeapot)
+{ CheckRoundTrip(L"teapot/teapot.obj"); }
+
+//-----------------------------------------------------------------------------
+//      接線の符号を保持できるか確認します.
+//-----------------------------------------------------------------------------
+TEST_CASE(PackedVertex, TangentSign)
+{
+    MeshVertex vertex(
+        DirectX::XMFLOAT3(0.25f, 0.5f, 0.75f),
+        DirectX::XMFLOAT3(0.0f, 0.0f, -1.0f),
+        DirectX::XMFLOAT2(0.5f, 0.5f),
+        DirectX::XMFLOAT3(1.0f, 0.0f, 0.0f));
+
+    PackedVertexQuantization quantization = {};
+    quantization.Scale = DirectX::XMFLOAT3(1.0f / 65535.0f, 1.0f / 65535.0f, 1.0f / 65535.0f);
+
+    for(auto sign : { -1.0f, 1.0f })
+    {
+        float decoded = 0.0f;
+        auto result = DecodeVertex(EncodeVertex(vertex, quantization, sign), quantization, &decoded);
+        CHECK(decoded == sign);
+        CHECK(AngleBetween(vertex.Normal, result.Normal) <= 1e-4);
+    }
+}
@@ -0,0 +1,153 @@
+﻿//-----------------------------------------------------------------------------
+// File : ParallelUtilTest.cpp
+// Desc : Parallel Utility Unit Test.
+// Copyright(c) Pocol. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <TestUtil.h>
+#include <ParallelUtil.h>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+// Global Variables.
+//-----------------------------------------------------------------------------
+std::atomic<uint32_t> g_ThreadMarkerCount(0);  // ThreadMarker を生成したスレッドの数です.
+
+///////////////////////////////////////////////////////////////////////////////
+// ThreadMarker structure
+///////////////////////////////////////////////////////////////////////////////
+// スレッドごとに1回だけ生成されるので, スレッド ID が再利用されても新しいスレッドを数えられます.
+struct ThreadMarker
+{
+    ThreadMarker()
+    { g_ThreadMarkerCount.fetch_add(1); }
+};
+
+} // namespace
+
+//-----------------------------------------------------------------------------
+//      全てのインデックスがちょうど1回ずつ処理されることを確認します.
+//-----------------------------------------------------------------------------
+TEST_CASE(ParallelFor, VisitOnce)
+{
+    const size_t kCounts[] = { 1, 2, 7, 1000, 100000 };
+
+    for(auto count : kCounts)
+    {
+        std::unique_ptr<std::atomic<uint32_t>[]> visits(new std::atomic<uint32_t>[count]);
+        for(size_t i=0; i<count; ++i)
+        { visits[i].store(0); }
+
+        ParallelFor(count, [&](size_t index) { visits[index].fetch_add(1); });
+
+        auto mismatch = 0u;
+        for(size_t i=0; i<count; ++i)
+        {
+            if (visits[i].load() != 1)
+            { mismatch++; }
+        }
+        CHECK(mismatch == 0);
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      呼び出しを繰り返してもスレッドを生成せず, プールのスレッドを使い回すことを確認します.
+//-----------------------------------------------------------------------------
+TEST_CASE(ParallelFor, ReuseThreads)
+{
+    auto& pool = WorkerPool::GetDefault();
+    CHECK(pool.GetThreadCount() == GetWorkerThreadCount() - 1);
+
+    // 1回目の呼び出しでワーカースレッドと呼び出し元スレッドに印を付けます.
+    auto mark = [](size_t)
+    {
+        thread_local ThreadMarker marker;
+        (void)marker;
+        std::this_thread::sleep_for(std::chrono::microseconds(10));
+    };
+
+    ParallelFor(256, mark);
+    auto first = g_ThreadMarkerCount.load();
+    CHECK(first <= pool.GetThreadCount() + 1);
+
+    // 以降の呼び出しで新しいスレッドが現れないこと.
+    for(auto frame=0; frame<200; ++frame)
+    { ParallelFor(64, mark); }
+
+    CHECK(g_ThreadMarkerCount.load() <= pool.GetThreadCount() + 1);
+}
+
+//-----------------------------------------------------------------------------
+//      threadCount に 1 を指定した場合は呼び出し元スレッドだけで処理することを確認します.
+//-----------------------------------------------------------------------------
+TEST_CASE(ParallelFor, SingleThread)
+{
+    auto caller = std::this_thread::get_id();
+    auto other  = 0u;
+
+    ParallelFor(256, [&](size_t)
+    {
+        if (std::this_thread::get_id() != caller)
+        { other++; }
+    }, 1);
+
+    CHECK(other == 0);
+}
+
+//-----------------------------------------------------------------------------
+//      ワーカースレッドから入れ子で呼び出しても止まらずに完了することを確認します.
+//-----------------------------------------------------------------------------
+TEST_CASE(ParallelFor, Nested)
+{
+    const size_t kOuter = 32;
+    const size_t kInner = 257;
+
+    std::atomic<size_t> total(0);
+    ParallelFor(kOuter, [&](size_t)
+    {
+        ParallelFor(kInner, [&](size_t index) { total.fetch_add(index + 1); });
+    });
+
+    CHECK(total.load() == kOuter * (kInner * (kInner + 1) / 2));
+}
+
+//-----------------------------------------------------------------------------
+//      投入したジョブが全てワーカースレッドで実行されることを確認します.
+//-----------------------------------------------------------------------------
+TEST_CASE(ParallelFor, WorkerPoolDrain)
+{
+    const auto kJobCount = 1000u;
+
+    std::atomic<uint32_t> done(0);
+    auto caller = std::this_thread::get_id();
+    auto onCaller = std::make_shared<std::atomic<uint32_t>>(0);
+    {
+        WorkerPool pool(3);
+        CHECK(pool.GetThreadCount() == 3);
+
+        for(auto i=0u; i<kJobCount; ++i)
+        {
+            pool.Submit([&done, caller, onCaller]()
+            {
+                if (std::this_thread::get_id() == caller)
+                { onCaller->fetch_add(1); }
+                done.fetch_add(1);
+            });
+        }
+
+        // デストラクタで積まれたジョブを全て実行してから終了する.
+    }
+
+    CHECK(done.load() == kJobCount);
+    CHECK(onCaller->load() == 0);
+}
@@ -0,0 +1,304 @@
+﻿//-----------------------------------------------------------------------------
+// File : PathTracerTest.cpp
+// Desc : PathTracer Unit Test.
+// Copyright(c) Pocol. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <TestUtil.h>
+#include <PathTracer.h>
+#include <algorithm>
+#include <cmath>
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+constexpr uint32_t  ImageWidth  = 32;   // テスト画像の横幅です.
+constexpr uint32_t  ImageHeight = 24;   // テスト画像の縦幅です.
+constexpr uint32_t  BlockCount  = 4;    // 参照値を比較するブロックの縦横の分割数です.
+
+// 下記のシーンと設定で描画した画像を 4x4 ブロックに分けた輝度の平均値です.
+// 浮動小数点演算の順序がコンパイラで変わっても収まる程度の許容誤差で比較します.
+constexpr float ReferenceBlocks[BlockCount * BlockCount] = {
+    0.2932f, 0.2932f, 0.2932f, 0.2932f,
+    0.4114f, 0.3707f, 0.3868f, 0.4516f,
+    0.5772f, 0.4029f, 0.5779f, 0.6983f,
+    0.6318f, 0.6745f, 0.7201f, 0.7490f,
+};
+constexpr float ReferenceTolerance = 0.02f;
+
+//-----------------------------------------------------------------------------
+//      四角形を追加します.
+//-----------------------------------------------------------------------------
+void AddQuad(
+    ResMesh&                    mesh,
+    const DirectX::XMFLOAT3&    p0,
+    const DirectX::XMFLOAT3&    p1,
+    const DirectX::XMFLOAT3&    p2,
+    const DirectX::XMFLOAT3&    p3,
+    const DirectX::XMFLOAT3&    normal)
+{
+    auto base = uint32_t(mesh.Vertices.size());
+    for(auto& p : { p0, p1, p2, p3 })
+    {
+        MeshVertex v = {};
+        v.Position = p;
+        v.Normal   = normal;
+        v.TexCoord = DirectX::XMFLOAT2(0.0f, 0.0f);
+        v.Tangent  = DirectX::XMFLOAT3(1.0f, 0.0f, 0.0f);
+        mesh.Vertices.push_back(v);
+    }
+
+    uint32_t indices[] = { 0, 1, 2, 0, 2, 3 };
+    for(auto i : indices)
+    { mesh.Indices.push_back(base + i); }
+}
+
+//-----------------------------------------------------------------------------
+//      床と箱のシーンを作成します.
+//-----------------------------------------------------------------------------
+bool InitScene(PathTracer& tracer)
+{
+    std::vector<ResMesh> meshes(2);
+
+    // 床 (マテリアル0).
+    meshes[0].MaterialId = 0;
+    AddQuad(meshes[0],
+        DirectX::XMFLOAT3(-4.0f, 0.0f, -4.0f), DirectX::XMFLOAT3(-4.0f, 0.0f,  4.0f),
+        DirectX::XMFLOAT3( 4.0f, 0.0f,  4.0f), DirectX::XMFLOAT3( 4.0f, 0.0f, -4.0f),
+        DirectX::XMFLOAT3( 0.0f, 1.0f,  0.0f));
+
+    // 箱の上面と側面 (マテリアル1).
+    meshes[1].MaterialId = 1;
+    const float e = 0.5f;
+    AddQuad(meshes[1],
+        DirectX::XMFLOAT3(-e, 2 * e, -e), DirectX::XMFLOAT3(-e, 2 * e,  e),
+        DirectX::XMFLOAT3( e, 2 * e,  e), DirectX::XMFLOAT3( e, 2 * e, -e),
+        DirectX::XMFLOAT3( 0.0f, 1.0f, 0.0f));
+    AddQuad(meshes[1],
+        DirectX::XMFLOAT3(-e, 0.0f, e), DirectX::XMFLOAT3( e, 0.0f, e),
+        DirectX::XMFLOAT3( e, 2 * e, e), DirectX::XMFLOAT3(-e, 2 * e, e),
+        DirectX::XMFLOAT3( 0.0f, 0.0f, 1.0f));
+    AddQuad(meshes[1],
+        DirectX::XMFLOAT3( e, 0.0f,  e), DirectX::XMFLOAT3( e, 0.0f, -e),
+        DirectX::XMFLOAT3( e, 2 * e, -e), DirectX::XMFLOAT3( e, 2 * e,  e),
+        DirectX::XMFLOAT3( 1.0f, 0.0f, 0.0f));
+    AddQuad(meshes[1],
+        DirectX::XMFLOAT3(-e, 0.0f, -e), DirectX::XMFLOAT3(-e, 0.0f,  e),
+        DirectX::XMFLOAT3(-e, 2 * e,  e), DirectX::XMFLOAT3(-e, 2 * e, -e),
+        DirectX::XMFLOAT3(-1.0f, 0.0f, 0.0f));
+
+    std::vector<ResMaterial> materials(2);
+    if (!tracer.Init(meshes, materials))
+    { return false; }
+
+    // ResMaterial からの変換に依存しないように直接設定します.
+    PathTracerMaterial floor = { DirectX::XMFLOAT3(0.8f, 0.8f, 0.8f), 0.9f, 0.0f };
+    PathTracerMaterial box   = { DirectX::XMFLOAT3(0.9f, 0.5f, 0.2f), 0.4f, 0.5f };
+    return tracer.SetMaterial(0, floor) && tracer.SetMaterial(1, box);
+}
+
+//-----------------------------------------------------------------------------
+//      テスト用の描画設定を取得します.
+//-----------------------------------------------------------------------------
+PathTracerDesc GetDesc()
+{
+    PathTracerDesc desc = {};
+    desc.Width          = ImageWidth;
+    desc.Height         = ImageHeight;
+    desc.SampleCount    = 16;
+    desc.MaxBounce      = 4;
+    desc.TileSize       = 8;
+    desc.ThreadCount    = 1;
+    desc.Seed           = 1234;
+    desc.Camera.Position = DirectX::XMFLOAT3(0.0f, 2.0f, 4.0f);
+    desc.Camera.Target   = DirectX::XMFLOAT3(0.0f, 0.5f, 0.0f);
+    desc.Camera.Upward   = DirectX::XMFLOAT3(0.0f, 1.0f, 0.0f);
+    desc.Camera.FovY     = 0.8f;
+    desc.Light.Position  = DirectX::XMFLOAT3(2.0f, 4.0f, 2.0f);
+    desc.Light.Color     = DirectX::XMFLOAT3(1.0f, 1.0f, 1.0f);
+    desc.Light.Intensity = 2.0f;
+    desc.SkyColor        = DirectX::XMFLOAT3(0.2f, 0.3f, 0.5f);
+    return desc;
+}
+
+//-----------------------------------------------------------------------------
+//      画像のビット列から FNV-1a ハッシュを求めます.
+//-----------------------------------------------------------------------------
+uint64_t CalcChecksum(const std::vector<DirectX::XMFLOAT3>& pixels)
+{
+    auto hash = 14695981039346656037ull;
+    auto ptr  = reinterpret_cast<const uint8_t*>(pixels.data());
+    auto size = pixels.size() * sizeof(DirectX::XMFLOAT3);
+    for(size_t i=0; i<size; ++i)
+    {
+        hash ^= ptr[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+//-----------------------------------------------------------------------------
+//      ブロックごとの輝度の平均値を求めます.
+//-----------------------------------------------------------------------------
+void CalcBlockLuminance(const std::vector<DirectX::XMFLOAT3>& pixels, float* result)
+{
+    const auto bw = ImageWidth  / BlockCount;
+    const auto bh = ImageHeight / BlockCount;
+
+    for(auto by=0u; by<BlockCount; ++by)
+    {
+        for(auto bx=0u; bx<BlockCount; ++bx)
+        {
+            auto sum = 0.0;
+            for(auto y=by * bh; y<(by + 1) * bh; ++y)
+            {
+                for(auto x=bx * bw; x<(bx + 1) * bw; ++x)
+                {
+                    auto& p = pixels[size_t(y) * ImageWidth + x];
+                    sum += 0.2126 * p.x + 0.7152 * p.y + 0.0722 * p.z;
+                }
+            }
+            result[by * BlockCount + bx] = float(sum / double(bw * bh));
+        }
+    }
+}
+
+} // namespace
+
+
+//-----------------------------------------------------------------------------
+//      同じシードで描画した結果が参照値と一致し, 値が有限であることを確認します.
+//-----------------------------------------------------------------------------
+TEST_CASE(PathTracer, Reference)
+{
+    PathTracer tracer;
+    REQUIRE(InitScene(tracer));
+    CHECK(tracer.GetTriangleCount() == 10);
+
+    std::vector<DirectX::XMFLOAT3> pixels;
+    REQUIRE(tracer.Render(GetDesc(), pixels));
+    REQUIRE(pixels.size() == size_t(ImageWidth) * ImageHeight);
+
+    auto invalid = 0u;
+    for(auto& p : pixels)
+    {
+        if (!std::isfinite(p.x) || !std::isfinite(p.y) || !std::isfinite(p.z) || p.x < 0.0f || p.y < 0.0f || p.z < 0.0f)
+        { invalid++; }
+    }
+    CHECK(invalid == 0);
+
+    float blocks[BlockCount * BlockCount];
+    CalcBlockLuminance(pixels, blocks);
+
+    auto mismatch = 0u;
+    for(auto i=0u; i<BlockCount * BlockCount; ++i)
+    {
+        auto tolerance = ReferenceTolerance * std::max(1.0f, ReferenceBlocks[i]);
+        if (std::fabs(blocks[i] - ReferenceBlocks[i]) > tolerance)
+        { mismatch++; }
+    }
+    CHECK(mismatch == 0);
+
+    // 同じ設定で描き直しても同じ結果になること.
+    std::vector<DirectX::XMFLOAT3> again;
+    REQUIRE(tracer.Render(GetDesc(), again));
+    CHECK(CalcChecksum(again) == CalcChecksum(pixels));
+
+    // シードを変えると結果が変わること.
+    auto desc = GetDesc();
+    desc.Seed++;
+    std::vector<DirectX::XMFLOAT3> other;
+    REQUIRE(tracer.Render(desc, other));
+    CHECK(CalcChecksum(other) != CalcChecksum(pixels));
+}
+
+//-----------------------------------------------------------------------------
+//      スレッド数とタイルサイズによらずビット単位で同じ結果になることを確認します.
+//-----------------------------------------------------------------------------
+TEST_CASE(PathTracer, ThreadInvariance)
+{
+    PathTracer tracer;
+    REQUIRE(InitScene(tracer));
+
+    auto desc = GetDesc();
+    std::vector<DirectX::XMFLOAT3> pixels;
+    REQUIRE(tracer.Render(desc, pixels));
+    auto expected = CalcChecksum(pixels);
+
+    const uint32_t kThreadCounts[] = { 2, 3, 8, 0 };
+    for(auto threadCount : kThreadCounts)
+    {
+        desc.ThreadCount = threadCount;
+        REQUIRE(tracer.Render(desc, pixels));
+        CHECK(CalcChecksum(pixels) == expected);
+    }
+
+    const uint32_t kTileSizes[] = { 1, 5, 32 };
+    for(auto tileSize : kTileSizes)
+    {
+        desc.ThreadCount = 4;
+        desc.TileSize    = tileSize;
+        REQUIRE(tracer.Render(desc, pixels));
+        CHECK(CalcChecksum(pixels) == expected);
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      何にも当たらないレイは空の放射輝度そのものになることを確認します.
+//-----------------------------------------------------------------------------
+TEST_CASE(PathTracer, SkyOnly)
+{
+    PathTracer tracer;
+    REQUIRE(InitScene(tracer));
+
+    // 床より上を見上げます.
+    auto desc = GetDesc();
+    desc.Camera.Position = DirectX::XMFLOAT3(0.0f, 5.0f, 0.0f);
+    desc.Camera.Target   = DirectX::XMFLOAT3(0.0f, 10.0f, 0.1f);
+    desc.Camera.Upward   = DirectX::XMFLOAT3(0.0f, 0.0f, 1.0f);
+
+    std::vector<DirectX::XMFLOAT3> pixels;
+    REQUIRE(tracer.Render(desc, pixels));
+
+    auto mismatch = 0u;
+    for(auto& p : pixels)
+    {
+        // サンプルの平均を取るので丸め誤差だけ許容します.
+        if (std::fabs(p.x - desc.SkyColor.x) > 1.0e-5f
+         || std::fabs(p.y - desc.SkyColor.y) > 1.0e-5f
+         || std::fabs(p.z - desc.SkyColor.z) > 1.0e-5f)
+        { mismatch++; }
+    }
+    CHECK(mismatch == 0);
+}
+
+//-----------------------------------------------------------------------------
+//      不正な設定を拒否することを確認します.
+//-----------------------------------------------------------------------------
+TEST_CASE(PathTracer, InvalidArgument)
+{
+    std::vector<DirectX::XMFLOAT3> pixels;
+
+    // 初期化前.
+    PathTracer empty;
+    CHECK(!empty.Render(GetDesc(), pixels));
+
+    PathTracer tracer;
+    REQUIRE(InitScene(tracer));
+
+    auto desc = GetDesc();
+    desc.SampleCount = 0;
+    CHECK(!tracer.Render(desc, pixels));
+
+    desc = GetDesc();
+    desc.Width = 0;
+    CHECK(!tracer.Render(desc, pixels));
+
+    CHECK(!tracer.SetMaterial(3, PathTracerMaterial()));
+}
@@ -0,0 +1,396 @@
+﻿//-----------------------------------------------------------------------------
+// File : PoolTest.cpp
+// Desc : Pool Unit Test.
+// Copyright(c) Pocol. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <TestUtil.h>
+#include <Pool.h>
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+namespace {
+
+///////////////////////////////////////////////////////////////////////////////
+// Slot structure
+///////////////////////////////////////////////////////////////////////////////
+struct Slot
+{
+    uint32_t    Index;      //!< プール内インデックスです.
+    uint32_t    Owner;      //!< 確保したスレッド番号です.
+    uint64_t    Sequence;   //!< 確保ごとの通し番号です.
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// MutexPool class
+///////////////////////////////////////////////////////////////////////////////
+// ロックフリー化する前の Pool と同じ構造 (アクティブ/フリーの双方向リストを
+// std::mutex で保護) の比較用実装です.
+template<typename T>
+class MutexPool
+{
+public:
+    MutexPool()
+    : m_pBuffer (nullptr)
+    , m_pActive (nullptr)
+    , m_pFree   (nullptr)
+    , m_Capacity(0)
+    , m_Count   (0)
+    { /* DO_NOTHING */ }
+
+    ~MutexPool()
+    { Term(); }
+
+    bool Init(uint32_t count)
+    {
+        std::lock_guard<std::mutex> guard(m_Mutex);
+
+        m_pBuffer = static_cast<uint8_t*>(malloc(sizeof(Item) * (count + 2)));
+        if (m_pBuffer == nullptr)
+        { return false; }
+
+        m_Capacity = count;
+
+        for(auto i=2u, j=0u; i<m_Capacity + 2; ++i, ++j)
+        {
+            auto item = GetItem(i);
+            item->m_Index = j;
+        }
+
+        m_pActive = GetItem(0);
+        m_pActive->m_pPrev = m_pActive->m_pNext = m_pActive;
+        m_pActive->m_Index = UINT32_MAX;
+
+        m_pFree = GetItem(1);
+        m_pFree->m_Index = UINT32_MAX - 1;
+
+        for(auto i=2u; i<m_Capacity + 2; ++i)
+        {
+            GetItem(i)->m_pPrev = nullptr;
+            GetItem(i)->m_pNext = GetItem(i + 1);
+        }
+
+        GetItem(m_Capacity + 1)->m_pPrev = m_pFree;
+        m_pFree->m_pPrev = GetItem(m_Capacity + 1);
+        m_pFree->m_pNext = GetItem(2);
+
+        return true;
+    }
+
+    void Term()
+    {
+        std::lock_guard<std::mutex> guard(m_Mutex);
+
+        if (m_pBuffer)
+        {
+            free(m_pBuffer);
+            m_pBuffer = nullptr;
+        }
+
+        m_pActive  = nullptr;
+        m_pFree    = nullptr;
+        m_Capacity = 0;
+        m_Count    = 0;
+    }
+
+    T* Alloc(std::function<void(uint32_t, T*)> func = nullptr)
+    {
+        std::lock_guard<std::mutex> guard(m_Mutex);
+
+        if (m_pFree->m_pNext == m_pFree || m_Count + 1 > m_Capacity)
+        { return nullptr; }
+
+        auto item = m_pFree->m_pNext;
+        m_pFree->m_pNext = item->m_pNext;
+
+        item->m_pPrev = m_pActive->m_pPrev;
+        item->m_pNext = m_pActive;
+        item->m_pPrev->m_pNext = item->m_pNext->m_pPrev = item;
+
+        m_Count++;
+
+        auto val = new ((void*)item) T();
+        if (func != nullptr)
+        { func(item->m_Index, val); }
+
+        return val;
+    }
+
+    void Free(T* pValue)
+    {
+        if (pValue == nullptr)
+        { return; }
+
+        std::lock_guard<std::mutex> guard(m_Mutex);
+
+        auto item = reinterpret_cast<Item*>(pValue);
+
+        item->m_pPrev->m_pNext = item->m_pNext;
+        item->m_pNext->m_pPrev = item->m_pPrev;
+
+        item->m_pPrev = nullptr;
+        item->m_pNext = m_pFree->m_pNext;
+
+        m_pFree->m_pNext = item;
+        m_Count--;
+    }
+
+    uint32_t GetUsedCount() const
+    { return m_Count; }
+
+private:
+    struct Item
+    {
+        T           m_Value;
+        uint32_t    m_Index;
+        Item*       m_pNext;
+        Item*       m_pPrev;
+    };
+
+    uint8_t*    m_pBuffer;
+    Item*       m_pActive;
+    Item*       m_pFree;
+    uint32_t    m_Capacity;
+    uint32_t    m_Count;
+    std::mutex  m_Mutex;
+
+    Item* GetItem(uint32_t index)
+    { return reinterpret_cast<Item*>(m_pBuffer + sizeof(Item) * index); }
+};
+
+//-----------------------------------------------------------------------------
+//      使用するスレッド数を取得します.
+//-----------------------------------------------------------------------------
+uint32_t GetThreadCount()
+{
+    // コア数が少ない環境でもプリエンプションで競合が起きるよう最低 8 スレッドとする.
+    auto count = std::thread::hardware_concurrency();
+    return std::clamp(count, 8u, 16u);
+}
+
+//-----------------------------------------------------------------------------
+//      複数スレッドで確保・解放を繰り返し, 所要時間 [msec] を返却します.
+//-----------------------------------------------------------------------------
+template<typename PoolType>
+double RunChurn(PoolType& pool, uint32_t threadCount, uint32_t iterations)
+{
+    std::atomic<bool> start(false);
+    std::vector<std::thread> threads;
+
+    for(auto t=0u; t<threadCount; ++t)
+    {
+        threads.emplace_back([&pool, &start, t, iterations]()
+        {
+            while(!start.load(std::memory_order_acquire))
+            { std::this_thread::yield(); }
+
+            Slot* held[4] = {};
+            for(auto i=0u; i<iterations; ++i)
+            {
+                auto& slot = held[i & 3];
+                if (slot != nullptr)
+                { pool.Free(slot); }
+
+                slot = pool.Alloc([t](uint32_t index, Slot* value)
+                {
+                    value->Index = index;
+                    value->Owner = t;
+                });
+            }
+
+            for(auto& slot : held)
+            { pool.Free(slot); }
+        });
+    }
+
+    TestTimer timer;
+    start.store(true, std::memory_order_release);
+    for(auto& thread : threads)
+    { thread.join(); }
+
+    return timer.GetElapsedMsec();
+}
+
+} // namespace
+
+
+//-----------------------------------------------------------------------------
+//      確保数の上限と全インデックスの一意性を確認します.
+//-----------------------------------------------------------------------------
+TEST_CASE(Pool, Exhaustion)
+{
+    const uint32_t kCount = 64;
+
+    Pool<Slot> pool;
+    REQUIRE(pool.Init(kCount));
+
+    std::vector<Slot*>  items;
+    std::vector<bool>   seen(kCount, false);
+    for(auto i=0u; i<kCount; ++i)
+    {
+        auto item = pool.Alloc([](uint32_t index, Slot* value) { value->Index = index; });
+        REQUIRE(item != nullptr);
+        REQUIRE(item->Index < kCount);
+        CHECK(!seen[item->Index]);
+        seen[item->Index] = true;
+        items.push_back(item);
+    }
+
+    CHECK(pool.Alloc() == nullptr);
+    CHECK(pool.GetUsedCount() == kCount);
+    CHECK(pool.GetAvailableCount() == 0);
+
+    for(auto item : items)
+    { pool.Free(item); }
+
+    CHECK(pool.GetUsedCount() == 0);
+    CHECK(pool.GetAvailableCount() == kCount);
+}
+
+//-----------------------------------------------------------------------------
+//      複数スレッドから確保・解放を繰り返し, 同じアイテムが二重に
+//      払い出されないこと (ABA による二重登録が起きないこと) を確認します.
+//-----------------------------------------------------------------------------
+TEST_CASE(Pool, ConcurrentStress)
+{
+    // アイテム数をスレッド数より少し多い程度に抑え, フリーリスト先頭の競合を増やす.
+    const auto kThreadCount = GetThreadCount();
+    const auto kCount       = kThreadCount * 2;
+    const auto kIterations  = 500000u;
+
+    Pool<Slot> pool;
+    REQUIRE(pool.Init(kCount));
+
+    // インデックスごとの所有者 (0 は未使用).
+    std::unique_ptr<std::atomic<uint32_t>[]> owners(new std::atomic<uint32_t>[kCount]);
+    for(auto i=0u; i<kCount; ++i)
+    { owners[i].store(0); }
+
+    std::atomic<uint32_t> doubleAlloc  (0);
+    std::atomic<uint32_t> corrupted    (0);
+    std::atomic<uint32_t> exhausted    (0);
+    std::atomic<bool>     start        (false);
+
+    std::vector<std::thread> threads;
+    for(auto t=0u; t<kThreadCount; ++t)
+    {
+        threads.emplace_back([&, t]()
+        {
+            const uint32_t ownerId = t + 1;
+
+            while(!start.load(std::memory_order_acquire))
+            { std::this_thread::yield(); }
+
+            Slot*    held[2] = {};
+            uint64_t seq     = 0;
+            for(auto i=0u; i<kIterations; ++i)
+            {
+                auto& slot = held[i & 1];
+                if (slot != nullptr)
+                {
+                    // 保持中に他スレッドから書き換えられていないか確認する.
+                    if (slot->Owner != ownerId)
+                    { corrupted++; }
+
+                    uint32_t expected = ownerId;
+                    if (!owners[slot->Index].compare_exchange_strong(expected, 0))
+                    { corrupted++; }
+
+                    pool.Free(slot);
+                    slot = nullptr;
+                }
+
+                slot = pool.Alloc([&](uint32_t index, Slot* value)
+                {
+                    value->Index    = index;
+                    value->Owner    = ownerId;
+                    value->Sequence = seq++;
+                });
+
+                if (slot == nullptr)
+                {
+                    exhausted++;
+                    continue;
+                }
+
+                uint32_t expected = 0;
+                if (!owners[slot->Index].compare_exchange_strong(expected, ownerId))
+                { doubleAlloc++; }
+            }
+
+            for(auto& slot : held)
+            {
+                if (slot == nullptr)
+                { continue; }
+
+                owners[slot->Index].store(0);
+                pool.Free(slot);
+            }
+        });
+    }
+
+    start.store(true, std::memory_order_release);
+    for(auto& thread : threads)
+    { thread.join(); }
+
+    CHECK(doubleAlloc.load() == 0);
+    CHECK(corrupted  .load() == 0);
+    CHECK(exhausted  .load() == 0);
+    CHECK(pool.GetUsedCount() == 0);
+
+    // フリーリストが壊れていなければ全アイテムをちょうど一回ずつ取り出せる.
+    std::vector<bool>   seen(kCount, false);
+    std::vector<Slot*>  items;
+    for(auto i=0u; i<kCount; ++i)
+    {
+        auto item = pool.Alloc([](uint32_t index, Slot* value) { value->Index = index; });
+        REQUIRE(item != nullptr);
+        CHECK(!seen[item->Index]);
+        seen[item->Index] = true;
+        items.push_back(item);
+    }
+    CHECK(pool.Alloc() == nullptr);
+
+    for(auto item : items)
+    { pool.Free(item); }
+}
+
+//-----------------------------------------------------------------------------
+//      ロックフリー版と mutex 版の確保・解放の所要時間を比較します.
+//-----------------------------------------------------------------------------
+TEST_CASE(PoolBench, LockFreeVsMutex)
+{
+    const auto kIterations  = 500000u;
+    const auto kCount       = 1024u;
+
+    // 1, 4, 16 スレッドで固定し, 環境ごとの結果を比べられるようにする.
+    for(auto threadCount : { 1u, 4u, 16u })
+    {
+        Pool<Slot>      lockFree;
+        MutexPool<Slot> locked;
+        REQUIRE(lockFree.Init(kCount));
+        REQUIRE(locked  .Init(kCount));
+
+        auto lockFreeMsec = RunChurn(lockFree, threadCount, kIterations);
+        auto lockedMsec   = RunChurn(locked,   threadCount, kIterations);
+
+        CHECK(lockFree.GetUsedCount() == 0);
+        CHECK(locked  .GetUsedCount() == 0);
+
+        // 1回の反復で確保と解放を1回ずつ行うので, それぞれを1操作として1秒あたりの操作数を出力する.
+        auto ops = 2.0 * threadCount * kIterations;
+        printf_s("    threads = %2u : lock-free %8.2f Mops/sec, mutex %8.2f Mops/sec\n",
+            threadCount,
+            ops / (lockFreeMsec * 1.0e3),
+            ops / (lockedMsec   * 1.0e3));
+    }
+}
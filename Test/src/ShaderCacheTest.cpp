@@ -0,0 +1,369 @@
+﻿//-----------------------------------------------------------------------------
+// File : ShaderCacheTest.cpp
+// Desc : ShaderCache Unit Test.
+// Copyright(c) Pocol. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <TestUtil.h>
+#include <ShaderCache.h>
+#include <cstring>
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+constexpr size_t VersionOffset  = 4;    // CacheHeader::Version の位置です.
+constexpr size_t HashOffset     = 8;    // CacheHeader::Hash の位置です.
+constexpr size_t DataSizeOffset = 16;   // CacheHeader::DataSize の位置です.
+constexpr size_t HeaderSize     = 24;   // CacheHeader のサイズです.
+
+///////////////////////////////////////////////////////////////////////////////
+// StubCompiler class
+///////////////////////////////////////////////////////////////////////////////
+//! @brief      ソースとターゲットをそのままバイナリとして返すコンパイラです.
+class StubCompiler : public ShaderCompiler
+{
+public:
+    std::string Version = "stub-1.0";   //!< キャッシュキーに含まれるバージョンです.
+    uint32_t    CompileCount = 0;       //!< Compile() の呼び出し回数です.
+
+    std::string GetVersion() const override
+    { return Version; }
+
+    bool Compile(
+        const ShaderDesc&       desc,
+        const std::string&      source,
+        std::vector<uint8_t>&   binary,
+        std::string&            message) override
+    {
+        CompileCount++;
+        if (source.find("#error") != std::string::npos)
+        {
+            message = "stub error";
+            return false;
+        }
+
+        binary.assign(source.begin(), source.end());
+        binary.insert(binary.end(), desc.Target.begin(), desc.Target.end());
+        return true;
+    }
+};
+
+//-----------------------------------------------------------------------------
+//      テスト用のディレクトリを作成し, パスを返却します(末尾の区切り文字を含む).
+//-----------------------------------------------------------------------------
+std::wstring MakeTestDirectory(const wchar_t* name)
+{
+    auto path = GetTestTempPath(name);
+    CreateDirectoryW(path.c_str(), nullptr);
+    return path + L"/";
+}
+
+//-----------------------------------------------------------------------------
+//      ファイルに書き込みます.
+//-----------------------------------------------------------------------------
+bool WriteBinaryFile(const std::wstring& path, const void* pData, size_t size)
+{
+    auto hFile = CreateFileW(
+        path.c_str(),
+        GENERIC_WRITE,
+        0,
+        nullptr,
+        CREATE_ALWAYS,
+        FILE_ATTRIBUTE_NORMAL,
+        nullptr);
+    if (hFile == INVALID_HANDLE_VALUE)
+    { return false; }
+
+    DWORD written = 0;
+    auto result = WriteFile(hFile, pData, DWORD(size), &written, nullptr);
+    CloseHandle(hFile);
+
+    return result && written == DWORD(size);
+}
+
+//-----------------------------------------------------------------------------
+//      テキストファイルに書き込みます.
+//-----------------------------------------------------------------------------
+bool WriteTextFile(const std::wstring& path, const std::string& text)
+{ return WriteBinaryFile(path, text.data(), text.size()); }
+
+//-----------------------------------------------------------------------------
+//      ファイルの内容を読み込みます.
+//-----------------------------------------------------------------------------
+bool ReadBinaryFile(const std::wstring& path, std::vector<uint8_t>& data)
+{
+    MappedFile file;
+    if (!file.Open(path.c_str()))
+    { return false; }
+
+    data.assign(file.GetData(), file.GetData() + size_t(file.GetSize()));
+    file.Close();
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      文字列が指定した接尾辞で終わるかチェックします.
+//-----------------------------------------------------------------------------
+bool EndsWith(const std::wstring& value, const std::wstring& suffix)
+{
+    return value.size() >= suffix.size()
+        && value.compare(value.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+//-----------------------------------------------------------------------------
+//      バイナリがコンパイル結果と一致するかチェックします.
+//-----------------------------------------------------------------------------
+bool IsSameBinary(const ShaderBinary& binary, const std::string& source, const std::wstring& target)
+{
+    std::vector<uint8_t> expected(source.begin(), source.end());
+    expected.insert(expected.end(), target.begin(), target.end());
+
+    return binary.GetSize() == expected.size()
+        && memcmp(binary.GetData(), expected.data(), expected.size()) == 0;
+}
+
+} // namespace
+
+
+//-----------------------------------------------------------------------------
+//      キャッシュキーがソース, インクルード, マクロ, バージョンを反映するか確認します.
+//-----------------------------------------------------------------------------
+TEST_CASE(ShaderCache, KeyTracksInputs)
+{
+    auto dir = MakeTestDirectory(L"ShaderCacheKey");
+    CreateDirectoryW((dir + L"nested").c_str(), nullptr);
+    CreateDirectoryW((dir + L"inc").c_str(), nullptr);
+    DeleteFileW((dir + L"missing.hlsli").c_str());
+
+    REQUIRE(WriteTextFile(dir + L"main.hlsl",
+        "#include \"common.hlsli\"\n"
+        "  #  include <shared.hlsli>\n"
+        "#include \"missing.hlsli\"\n"
+        "// #include \"comment.hlsli\"\n"
+        "float4 main() : SV_TARGET { return 0; }\n"));
+    REQUIRE(WriteTextFile(dir + L"common.hlsli", "#include \"nested/inner.hlsli\"\n"));
+    REQUIRE(WriteTextFile(dir + L"nested/inner.hlsli", "static const float A = 1.0f;\n"));
+    REQUIRE(WriteTextFile(dir + L"inc/shared.hlsli", "#include \"common.hlsli\"\n"));
+
+    StubCompiler compiler;
+    ShaderCache  cache;
+    REQUIRE(cache.Init(&compiler, (dir + L"cache").c_str()));
+
+    ShaderDesc desc;
+    desc.Path        = dir + L"main.hlsl";
+    desc.Target      = L"ps_6_0";
+    desc.IncludeDirs = { dir + L"inc" };
+
+    ShaderCacheKey base;
+    REQUIRE(cache.GetKey(desc, base));
+
+    // 行頭の '#' だけを見るので, コメント内のインクルードは含まない.
+    // inc/shared.hlsli からの common.hlsli は inc 側に無いので解決できない.
+    REQUIRE(base.Dependencies.size() == 3);
+    CHECK(EndsWith(base.Dependencies[0], L"common.hlsli"));
+    CHECK(EndsWith(base.Dependencies[1], L"shared.hlsli"));
+    CHECK(EndsWith(base.Dependencies[2], L"inner.hlsli"));
+
+    // 同じ入力なら同じハッシュになる.
+    {
+        ShaderCacheKey key;
+        REQUIRE(cache.GetKey(desc, key));
+        CHECK(key.Hash == base.Hash);
+    }
+
+    // ネストしたインクルードの内容を変えると無効になり, 戻すと元に戻る.
+    {
+        ShaderCacheKey key;
+        REQUIRE(WriteTextFile(dir + L"nested/inner.hlsli", "static const float A = 2.0f;\n"));
+        REQUIRE(cache.GetKey(desc, key));
+        CHECK(key.Hash != base.Hash);
+
+        REQUIRE(WriteTextFile(dir + L"nested/inner.hlsli", "static const float A = 1.0f;\n"));
+        REQUIRE(cache.GetKey(desc, key));
+        CHECK(key.Hash == base.Hash);
+    }
+
+    // マクロ, ターゲット, 引数はそれぞれキーに含まれる.
+    {
+        ShaderCacheKey key;
+        auto modified = desc;
+        modified.Defines.push_back({ L"USE_SHADOW", L"1" });
+        REQUIRE(cache.GetKey(modified, key));
+        CHECK(key.Hash != base.Hash);
+
+        modified = desc;
+        modified.Target = L"ps_6_6";
+        REQUIRE(cache.GetKey(modified, key));
+        CHECK(key.Hash != base.Hash);
+
+        modified = desc;
+        modified.Arguments.push_back(L"-O3");
+        REQUIRE(cache.GetKey(modified, key));
+        CHECK(key.Hash != base.Hash);
+    }
+
+    // マクロ名と値の区切りがずれても同じ値にならない.
+    {
+        ShaderCacheKey keyA, keyB;
+        auto modifiedA = desc;
+        auto modifiedB = desc;
+        modifiedA.Defines.push_back({ L"AB", L"C" });
+        modifiedB.Defines.push_back({ L"A",  L"BC" });
+        REQUIRE(cache.GetKey(modifiedA, keyA));
+        REQUIRE(cache.GetKey(modifiedB, keyB));
+        CHECK(keyA.Hash != keyB.Hash);
+    }
+
+    // コンパイラのバージョンが変わると無効になる.
+    {
+        StubCompiler newer;
+        newer.Version = "stub-1.1";
+
+        ShaderCache    other;
+        ShaderCacheKey key;
+        REQUIRE(other.Init(&newer, (dir + L"cache").c_str()));
+        REQUIRE(other.GetKey(desc, key));
+        CHECK(key.Hash != base.Hash);
+    }
+
+    // 解決できなかったインクルードが後から追加されると無効になる.
+    {
+        ShaderCacheKey key;
+        REQUIRE(WriteTextFile(dir + L"missing.hlsli", "\n"));
+        REQUIRE(cache.GetKey(desc, key));
+        CHECK(key.Hash != base.Hash);
+        CHECK(key.Dependencies.size() == 4);
+        DeleteFileW((dir + L"missing.hlsli").c_str());
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      コンパイル結果が保存され, 2回目はマッピングして返すか確認します.
+//-----------------------------------------------------------------------------
+TEST_CASE(ShaderCache, CompileThenHit)
+{
+    auto dir = MakeTestDirectory(L"ShaderCacheHit");
+    const std::string source = "float4 main() : SV_TARGET { return 1; }\n";
+    REQUIRE(WriteTextFile(dir + L"main.hlsl", source));
+
+    StubCompiler compiler;
+    ShaderCache  cache;
+    REQUIRE(cache.Init(&compiler, (dir + L"cache").c_str()));
+
+    ShaderDesc desc;
+    desc.Path   = dir + L"main.hlsl";
+    desc.Target = L"ps_6_0";
+
+    ShaderCacheKey key;
+    REQUIRE(cache.GetKey(desc, key));
+    DeleteFileW(cache.GetCachePath(key.Hash).c_str());
+
+    auto first = cache.Load(desc);
+    REQUIRE(first != nullptr);
+    CHECK(!first->IsMapped());
+    CHECK(IsSameBinary(*first, source, desc.Target));
+    CHECK(compiler.CompileCount == 1);
+    CHECK(cache.GetHitCount() == 0);
+
+    auto second = cache.Load(desc);
+    REQUIRE(second != nullptr);
+    CHECK(second->IsMapped());
+    CHECK(IsSameBinary(*second, source, desc.Target));
+    CHECK(compiler.CompileCount == 1);
+    CHECK(cache.GetHitCount() == 1);
+
+    // ソースが変われば別のキャッシュになる.
+    REQUIRE(WriteTextFile(dir + L"main.hlsl", source + "// edited\n"));
+    ShaderCacheKey edited;
+    REQUIRE(cache.GetKey(desc, edited));
+    CHECK(edited.Hash != key.Hash);
+    DeleteFileW(cache.GetCachePath(edited.Hash).c_str());
+
+    auto third = cache.Load(desc);
+    REQUIRE(third != nullptr);
+    CHECK(!third->IsMapped());
+    CHECK(compiler.CompileCount == 2);
+
+    // コンパイルに失敗した場合は何も保存しない.
+    REQUIRE(WriteTextFile(dir + L"main.hlsl", "#error broken\n"));
+    CHECK(cache.Load(desc) == nullptr);
+    CHECK(cache.Load(desc) == nullptr);
+    CHECK(compiler.CompileCount == 4);
+    CHECK(cache.GetHitCount() == 1);
+}
+
+//-----------------------------------------------------------------------------
+//      壊れた, または古いキャッシュファイルを再コンパイルして置き換えるか確認します.
+//-----------------------------------------------------------------------------
+TEST_CASE(ShaderCache, ReplacesStaleCache)
+{
+    auto dir = MakeTestDirectory(L"ShaderCacheStale");
+    const std::string source = "float4 main() : SV_TARGET { return 2; }\n";
+    REQUIRE(WriteTextFile(dir + L"main.hlsl", source));
+
+    StubCompiler compiler;
+    ShaderCache  cache;
+    REQUIRE(cache.Init(&compiler, (dir + L"cache").c_str()));
+
+    ShaderDesc desc;
+    desc.Path   = dir + L"main.hlsl";
+    desc.Target = L"cs_6_0";
+
+    ShaderCacheKey key;
+    REQUIRE(cache.GetKey(desc, key));
+    auto path = cache.GetCachePath(key.Hash);
+    DeleteFileW(path.c_str());
+
+    // 正しいキャッシュファイルを作って, それを元に壊したファイルを作る.
+    REQUIRE(cache.Load(desc) != nullptr);
+
+    std::vector<uint8_t> valid;
+    REQUIRE(ReadBinaryFile(path, valid));
+    REQUIRE(valid.size() > HeaderSize);
+
+    // 値を1増やす位置です. SIZE_MAX の場合はファイルを切り詰めます.
+    const size_t corruptions[] = {
+        VersionOffset,      // フォーマットバージョンの更新.
+        HashOffset,         // ハッシュ値の不一致.
+        DataSizeOffset,     // サイズの不一致.
+        SIZE_MAX,           // 書き込み途中で切れたファイル.
+    };
+
+    for(auto offset : corruptions)
+    {
+        auto data = valid;
+        if (offset == SIZE_MAX)
+        { data.resize(HeaderSize + (valid.size() - HeaderSize) / 2); }
+        else
+        { data[offset]++; }
+
+        REQUIRE(WriteBinaryFile(path, data.data(), data.size()));
+
+        auto compileCount = compiler.CompileCount;
+        auto hitCount     = cache.GetHitCount();
+
+        // 古いファイルは使わずにコンパイルし直す.
+        auto binary = cache.Load(desc);
+        REQUIRE(binary != nullptr);
+        CHECK(!binary->IsMapped());
+        CHECK(IsSameBinary(*binary, source, desc.Target));
+        CHECK(compiler.CompileCount == compileCount + 1);
+
+        // 置き換えに成功していれば, 次はキャッシュから読める.
+        std::vector<uint8_t> replaced;
+        REQUIRE(ReadBinaryFile(path, replaced));
+        CHECK(replaced == valid);
+
+        binary = cache.Load(desc);
+        REQUIRE(binary != nullptr);
+        CHECK(binary->IsMapped());
+        CHECK(compiler.CompileCount == compileCount + 1);
+        CHECK(cache.GetHitCount() == hitCount + 1);
+    }
+}
@@ -0,0 +1,574 @@
+﻿//-----------------------------------------------------------------------------
+// File : TextureStreamerTest.cpp
+// Desc : DdsFile and TextureStreamer Unit Test.
+// Copyright(c) Pocol. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <TestUtil.h>
+#include <DdsFile.h>
+#include <TextureStreamer.h>
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+constexpr uint32_t kFourCCDXT1 = 0x31545844;    //!< "DXT1" です.
+
+///////////////////////////////////////////////////////////////////////////////
+// FakeStreamBackend class
+///////////////////////////////////////////////////////////////////////////////
+//! @brief      GPU を使わずにテクスチャの生成回数とアップロード内容を記録するバックエンドです.
+class FakeStreamBackend : public TextureStreamBackend
+{
+public:
+    uint32_t                CreateCount     = 0;    //!< CreateTexture() の呼び出し回数です.
+    uint32_t                LiveCount       = 0;    //!< 破棄されていないテクスチャ数です.
+    uint32_t                InvalidCount    = 0;    //!< 不正な引数で呼ばれた回数です.
+    uint64_t                LastBytes       = 0;    //!< 直前にアップロードしたサイズです.
+    std::vector<uint32_t>   FirstMips;              //!< 生成したテクスチャの先頭ミップです.
+
+    bool CreateTexture
+    (
+        const DdsInfo&                  info,
+        uint32_t                        firstMip,
+        bool                            isSRGB,
+        const D3D12_SUBRESOURCE_DATA*   pSubresources,
+        uint32_t                        count,
+        StreamTexture&                  result
+    ) override
+    {
+        (void)isSRGB;
+
+        // ブロック圧縮のリソースはミップ0の縦横が4の倍数でなければ生成できない.
+        auto w = std::max(info.Width  >> firstMip, 1u);
+        auto h = std::max(info.Height >> firstMip, 1u);
+        if (IsDdsBlockCompressed(info.Format) && firstMip > 0 && ((w % 4) != 0 || (h % 4) != 0))
+        { InvalidCount++; }
+
+        if (count != (info.MipLevels - firstMip) * info.ArraySize)
+        { InvalidCount++; }
+
+        LastBytes = 0;
+        for(auto i=0u; i<count; ++i)
+        { LastBytes += uint64_t(pSubresources[i].SlicePitch); }
+
+        CreateCount++;
+        LiveCount++;
+        FirstMips.push_back(firstMip);
+
+        result.pResource = reinterpret_cast<ID3D12Resource*>(uintptr_t(CreateCount));
+        result.pHandle   = nullptr;
+        return true;
+    }
+
+    void DestroyTexture(StreamTexture& texture) override
+    {
+        if (texture.pResource != nullptr)
+        { LiveCount--; }
+
+        texture = StreamTexture();
+    }
+
+    void Flush() override
+    { /* DO_NOTHING */ }
+};
+
+//-----------------------------------------------------------------------------
+//      2次元テクスチャの情報を生成します.
+//-----------------------------------------------------------------------------
+DdsInfo MakeInfo(DXGI_FORMAT format, uint32_t width, uint32_t height, uint32_t mipLevels, uint32_t arraySize = 1)
+{
+    DdsInfo info = {};
+    info.Width      = width;
+    info.Height     = height;
+    info.Depth      = 1;
+    info.ArraySize  = arraySize;
+    info.MipLevels  = mipLevels;
+    info.Format     = format;
+    info.IsCube     = false;
+    info.DataOffset = 0;
+    return info;
+}
+
+//-----------------------------------------------------------------------------
+//      ピクセルデータの合計サイズを求めます.
+//-----------------------------------------------------------------------------
+size_t CalcDataSize(const DdsInfo& info)
+{
+    std::vector<DdsSubresource> layout;
+    if (!ComputeDdsLayout(info, SIZE_MAX, layout))
+    { return 0; }
+
+    return layout.back().Offset + layout.back().Size - info.DataOffset;
+}
+
+//-----------------------------------------------------------------------------
+//      位置ごとに異なる値を持つピクセルデータで DDS ファイルを書き出します.
+//-----------------------------------------------------------------------------
+bool WriteTestDds(const std::wstring& path, const DdsInfo& info, std::vector<uint8_t>& pixels)
+{
+    pixels.resize(CalcDataSize(info));
+    for(size_t i=0; i<pixels.size(); ++i)
+    { pixels[i] = uint8_t(i * 31 + (i >> 8)); }
+
+    return !pixels.empty() && SaveDdsFile(path.c_str(), info, pixels.data(), pixels.size());
+}
+
+//-----------------------------------------------------------------------------
+//      ミップごとのサイズが 1/4 ずつ小さくなる常駐情報を生成します.
+//-----------------------------------------------------------------------------
+TextureResidency MakeResidency
+(
+    uint32_t    mipLevels,
+    uint64_t    baseBytes,
+    uint32_t    tailMip,
+    uint32_t    residentMip,
+    uint32_t    requestedMip,
+    float       priority,
+    uint64_t    lastRequestFrame
+)
+{
+    TextureResidency result;
+    for(auto i=0u; i<mipLevels; ++i)
+    { result.MipBytes.push_back(std::max<uint64_t>(baseBytes >> (2 * i), 16)); }
+
+    result.TailMip          = tailMip;
+    result.ResidentMip      = residentMip;
+    result.RequestedMip     = requestedMip;
+    result.Priority         = priority;
+    result.LastRequestFrame = lastRequestFrame;
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+//      指定ミップ以降の合計サイズを求めます.
+//-----------------------------------------------------------------------------
+uint64_t SumBytes(const TextureResidency& texture, uint32_t firstMip)
+{
+    uint64_t result = 0;
+    for(auto i=firstMip; i<uint32_t(texture.MipBytes.size()); ++i)
+    { result += texture.MipBytes[i]; }
+    return result;
+}
+
+} // namespace
+
+
+//-----------------------------------------------------------------------------
+//      1枚のサーフェイスのピッチと行数を確認します.
+//-----------------------------------------------------------------------------
+TEST_CASE(DdsFile, SurfaceInfo)
+{
+    size_t   rowPitch   = 0;
+    uint32_t rowCount   = 0;
+    size_t   slicePitch = 0;
+
+    // ブロック圧縮は 4x4 のブロック単位で切り上げる.
+    REQUIRE(GetDdsSurfaceInfo(DXGI_FORMAT_BC1_UNORM, 5, 3, rowPitch, rowCount, slicePitch));
+    CHECK(rowPitch   == 16);
+    CHECK(rowCount   == 1);
+    CHECK(slicePitch == 16);
+
+    REQUIRE(GetDdsSurfaceInfo(DXGI_FORMAT_BC7_UNORM, 1, 1, rowPitch, rowCount, slicePitch));
+    CHECK(rowPitch   == 16);
+    CHECK(rowCount   == 1);
+    CHECK(slicePitch == 16);
+
+    REQUIRE(GetDdsSurfaceInfo(DXGI_FORMAT_BC3_UNORM, 9, 8, rowPitch, rowCount, slicePitch));
+    CHECK(rowPitch   == 48);
+    CHECK(rowCount   == 2);
+    CHECK(slicePitch == 96);
+
+    REQUIRE(GetDdsSurfaceInfo(DXGI_FORMAT_R8G8B8A8_UNORM, 7, 5, rowPitch, rowCount, slicePitch));
+    CHECK(rowPitch   == 28);
+    CHECK(rowCount   == 5);
+    CHECK(slicePitch == 140);
+
+    CHECK(!GetDdsSurfaceInfo(DXGI_FORMAT_UNKNOWN, 4, 4, rowPitch, rowCount, slicePitch));
+}
+
+//-----------------------------------------------------------------------------
+//      配列要素ごとにミップ0から隙間なく並ぶことを確認します.
+//-----------------------------------------------------------------------------
+TEST_CASE(DdsFile, MipOffsets)
+{
+    // 64x32 の BC1 は 1x1 まで 7 段. 4x4 未満のミップも1ブロックを占める.
+    auto info = MakeInfo(DXGI_FORMAT_BC1_UNORM, 64, 32, 7, 2);
+    info.DataOffset = 148;
+
+    const size_t   sizes  [] = { 1024, 256, 64, 16, 8, 8, 8 };
+    const uint32_t widths [] = { 64, 32, 16, 8, 4, 2, 1 };
+    const uint32_t heights[] = { 32, 16,  8, 4, 2, 1, 1 };
+    const size_t   perItem   = 1024 + 256 + 64 + 16 + 8 + 8 + 8;
+
+    std::vector<DdsSubresource> layout;
+    REQUIRE(ComputeDdsLayout(info, 148 + perItem * 2, layout));
+    REQUIRE(layout.size() == 14);
+
+    auto offset = size_t(148);
+    for(auto item=0u; item<2; ++item)
+    {
+        for(auto mip=0u; mip<7; ++mip)
+        {
+            auto& sub = layout[item * 7 + mip];
+            CHECK(sub.Offset     == offset);
+            CHECK(sub.Size       == sizes[mip]);
+            CHECK(sub.SlicePitch == sizes[mip]);
+            CHECK(sub.Width      == widths[mip]);
+            CHECK(sub.Height     == heights[mip]);
+            CHECK(sub.Depth      == 1);
+            CHECK(sub.RowPitch * sub.RowCount == sub.SlicePitch);
+            offset += sizes[mip];
+        }
+    }
+
+    // ファイルが1バイトでも足りなければ失敗する.
+    CHECK(!ComputeDdsLayout(info, 148 + perItem * 2 - 1, layout));
+
+    // 非圧縮はピクセル単位.
+    info = MakeInfo(DXGI_FORMAT_R8G8B8A8_UNORM, 7, 5, 3);
+    REQUIRE(ComputeDdsLayout(info, 140 + 24 + 4, layout));
+    REQUIRE(layout.size() == 3);
+    CHECK(layout[1].Offset   == 140);
+    CHECK(layout[1].RowPitch == 12);
+    CHECK(layout[1].RowCount == 2);
+    CHECK(layout[2].Offset   == 164);
+    CHECK(layout[2].Size     == 4);
+}
+
+//-----------------------------------------------------------------------------
+//      保存したファイルと旧形式のヘッダを解析できることを確認します.
+//-----------------------------------------------------------------------------
+TEST_CASE(DdsFile, SaveAndParse)
+{
+    auto path = GetTestTempPath(L"dds_save_and_parse.dds");
+    auto info = MakeInfo(DXGI_FORMAT_BC1_UNORM, 64, 32, 7);
+
+    std::vector<uint8_t> pixels;
+    REQUIRE(WriteTestDds(path, info, pixels));
+
+    MappedFile file;
+    REQUIRE(file.Open(path.c_str()));
+
+    DdsInfo parsed = {};
+    REQUIRE(ParseDdsHeader(file.GetData(), size_t(file.GetSize()), parsed));
+    CHECK(parsed.Width      == 64);
+    CHECK(parsed.Height     == 32);
+    CHECK(parsed.MipLevels  == 7);
+    CHECK(parsed.ArraySize  == 1);
+    CHECK(parsed.Format     == DXGI_FORMAT_BC1_UNORM);
+    CHECK(parsed.DataOffset == sizeof(uint32_t) + sizeof(DdsHeader) + sizeof(DdsHeaderDX10));
+    CHECK(size_t(file.GetSize()) == parsed.DataOffset + pixels.size());
+
+    std::vector<DdsSubresource> layout;
+    REQUIRE(ComputeDdsLayout(parsed, size_t(file.GetSize()), layout));
+    CHECK(layout[0].Offset == parsed.DataOffset);
+    CHECK(memcmp(file.GetData() + parsed.DataOffset, pixels.data(), pixels.size()) == 0);
+
+    // 途中で切れたヘッダは解析しない.
+    CHECK(!ParseDdsHeader(file.GetData(), sizeof(uint32_t) + sizeof(DdsHeader) - 1, parsed));
+    file.Close();
+
+    // 旧形式の DXT1 ヘッダは DX10 拡張ヘッダ無しでピクセルデータが続く.
+    DdsHeader header = {};
+    header.Size                 = sizeof(DdsHeader);
+    header.Width                = 8;
+    header.Height               = 8;
+    header.MipMapCount          = 4;
+    header.PixelFormat.Size     = sizeof(DdsPixelFormat);
+    header.PixelFormat.Flags    = DdsPixelFourCC;
+    header.PixelFormat.FourCC   = kFourCCDXT1;
+
+    std::vector<uint8_t> legacy(sizeof(uint32_t) + sizeof(DdsHeader) + 32 + 8 + 8 + 8);
+    memcpy(legacy.data(), &DdsMagic, sizeof(DdsMagic));
+    memcpy(legacy.data() + sizeof(uint32_t), &header, sizeof(header));
+
+    REQUIRE(ParseDdsHeader(legacy.data(), legacy.size(), parsed));
+    CHECK(parsed.Format     == DXGI_FORMAT_BC1_UNORM);
+    CHECK(parsed.MipLevels  == 4);
+    CHECK(parsed.DataOffset == sizeof(uint32_t) + sizeof(DdsHeader));
+    CHECK(ComputeDdsLayout(parsed, legacy.size(), layout));
+    CHECK(layout.back().Offset + layout.back().Size == legacy.size());
+
+    // マジックが違えば DDS ファイルではない.
+    legacy[0] = 'X';
+    CHECK(!ParseDdsHeader(legacy.data(), legacy.size(), parsed));
+}
+
+//-----------------------------------------------------------------------------
+//      予算内で優先度の高いテクスチャからミップが割り当てられることを確認します.
+//-----------------------------------------------------------------------------
+TEST_CASE(TextureStreamer, SelectUnderBudget)
+{
+    // 末尾ミップ(5以降)は予算が 0 でも常駐させる.
+    std::vector<TextureResidency> textures = {
+        MakeResidency(8, 1 << 20, 5, 8, 0, 10.0f, 0),
+        MakeResidency(8, 1 << 20, 5, 8, 0,  1.0f, 0),
+    };
+    auto tail = SumBytes(textures[0], 5);
+
+    std::vector<uint32_t> result;
+    auto used = SelectResidentMips(textures, 0, result);
+    CHECK(result[0] == 5);
+    CHECK(result[1] == 5);
+    CHECK(used == tail * 2);
+
+    // 1段ずつ交互に割り当て, 同じ段では優先度の高い方が先に取る.
+    auto budget = tail * 2 + (4096 + 16384) * 2 + 65536;
+    used = SelectResidentMips(textures, budget, result);
+    CHECK(result[0] == 2);
+    CHECK(result[1] == 3);
+    CHECK(used == budget);
+
+    // 要求より詳細なミップは割り当てない.
+    textures[1].RequestedMip = 4;
+    used = SelectResidentMips(textures, 8ull << 20, result);
+    CHECK(result[0] == 0);
+    CHECK(result[1] == 4);
+    CHECK(used == SumBytes(textures[0], 0) + SumBytes(textures[1], 4));
+}
+
+//-----------------------------------------------------------------------------
+//      ランダムな状態で予算と要求の制約を満たし, 余った予算を残さないことを確認します.
+//-----------------------------------------------------------------------------
+TEST_CASE(TextureStreamer, SelectRandomized)
+{
+    std::mt19937 rng(1234);
+    for(auto iteration=0; iteration<500; ++iteration)
+    {
+        std::vector<TextureResidency> textures(1 + rng() % 8);
+        for(auto& texture : textures)
+        {
+            auto mips     = 1 + uint32_t(rng() % 10);
+            auto tail     = uint32_t(rng() % mips);
+            auto resident = uint32_t(rng() % (tail + 1));
+            auto request  = uint32_t(rng() % (mips + 1));
+            texture = MakeResidency(mips, 1ull << (10 + rng() % 12), tail, resident, request, float(rng() % 4), rng() % 16);
+        }
+
+        auto budget = uint64_t(rng() % (4u << 20));
+
+        std::vector<uint32_t> result;
+        auto used = SelectResidentMips(textures, budget, result);
+        REQUIRE(result.size() == textures.size());
+
+        uint64_t tails = 0, sum = 0;
+        for(size_t i=0; i<textures.size(); ++i)
+        {
+            auto& texture = textures[i];
+            tails += SumBytes(texture, texture.TailMip);
+            sum   += SumBytes(texture, result[i]);
+
+            // 末尾ミップは常に常駐し, 要求も常駐もしていないミップは割り当てない.
+            CHECK(result[i] <= texture.TailMip);
+            CHECK(result[i] >= std::min(texture.RequestedMip, texture.ResidentMip));
+        }
+
+        CHECK(used == sum);
+        CHECK(used <= std::max(budget, tails));
+
+        // まだ詳細にできるテクスチャは, 次の1段が予算に収まらない.
+        for(size_t i=0; i<textures.size(); ++i)
+        {
+            auto& texture = textures[i];
+            auto  limit   = std::min(texture.RequestedMip, texture.ResidentMip);
+            if (result[i] > limit)
+            { CHECK(used + texture.MipBytes[result[i] - 1] > budget); }
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      登録時に末尾ミップだけを読み込み, 要求に応じて詳細にすることを確認します.
+//-----------------------------------------------------------------------------
+TEST_CASE(TextureStreamer, TailPreload)
+{
+    // 256x256 の BC1 は 9 段. 末尾から 1024 バイトに収まるのはミップ3以降(696 バイト).
+    auto path = GetTestTempPath(L"stream_tail.dds");
+    auto info = MakeInfo(DXGI_FORMAT_BC1_UNORM, 256, 256, 9);
+
+    std::vector<uint8_t> pixels;
+    REQUIRE(WriteTestDds(path, info, pixels));
+
+    FakeStreamBackend backend;
+    TextureStreamDesc desc;
+    desc.TailBytes      = 1024;
+    desc.BudgetBytes    = 1 << 20;
+    desc.MaxUploadBytes = 1 << 20;
+
+    TextureStreamer streamer;
+    REQUIRE(streamer.Init(&backend, desc));
+
+    auto id = streamer.Register(path.c_str(), false);
+    REQUIRE(id != TextureStreamer::InvalidId);
+    CHECK(streamer.GetResidentMip(id) == 3);
+    CHECK(backend.LastBytes == 512 + 128 + 32 + 8 + 8 + 8);
+    CHECK(streamer.GetStats().ResidentBytes == backend.LastBytes);
+
+    // 存在しないファイルは登録できない.
+    CHECK(streamer.Register(GetTestTempPath(L"stream_missing.dds").c_str(), false) == TextureStreamer::InvalidId);
+
+    // 要求が無ければ末尾ミップのまま.
+    CHECK(!streamer.Update());
+    CHECK(streamer.GetResidentMip(id) == 3);
+
+    streamer.Request(id, CalcStreamingMip(256, 256, 64.0f), 1.0f);
+    CHECK(streamer.Update());
+    CHECK(streamer.GetResidentMip(id) == 2);
+    CHECK(streamer.GetStats().UploadedBytes == 2048 + 696);
+
+    // 古いテクスチャはフェンスの完了まで残る.
+    CHECK(backend.LiveCount == 2);
+    streamer.FrameEnd(1);
+    streamer.Retire(0);
+    CHECK(backend.LiveCount == 2);
+    streamer.Retire(1);
+    CHECK(backend.LiveCount == 1);
+
+    streamer.Term();
+    CHECK(backend.LiveCount    == 0);
+    CHECK(backend.InvalidCount == 0);
+}
+
+//-----------------------------------------------------------------------------
+//      ブロック圧縮の先頭ミップが4の倍数の大きさになることを確認します.
+//-----------------------------------------------------------------------------
+TEST_CASE(TextureStreamer, BlockAlignedFirstMip)
+{
+    // 40x24 の BC1 は 40x24, 20x12, 10x6, 5x3, 2x1, 1x1.
+    // 末尾から 100 バイトに収まるのはミップ2以降だが, 10x6 は先頭にできないのでミップ1から読み込む.
+    auto path = GetTestTempPath(L"stream_align.dds");
+    auto info = MakeInfo(DXGI_FORMAT_BC1_UNORM, 40, 24, 6);
+
+    std::vector<uint8_t> pixels;
+    REQUIRE(WriteTestDds(path, info, pixels));
+
+    FakeStreamBackend backend;
+    TextureStreamDesc desc;
+    desc.TailBytes      = 100;
+    desc.BudgetBytes    = 1 << 20;
+    desc.MaxUploadBytes = 1 << 20;
+
+    TextureStreamer streamer;
+    REQUIRE(streamer.Init(&backend, desc));
+
+    auto id = streamer.Register(path.c_str(), false);
+    REQUIRE(id != TextureStreamer::InvalidId);
+    CHECK(streamer.GetResidentMip(id) == 1);
+
+    // どのミップを要求しても, 先頭にできるミップに丸められる.
+    for(auto mip=0u; mip<6; ++mip)
+    {
+        streamer.Request(id, mip, 1.0f);
+        streamer.Update();
+        CHECK(streamer.GetResidentMip(id) <= 1);
+        CHECK(streamer.GetResidentMip(id) <= mip || mip > 1);
+    }
+
+    // 予算が末尾ミップにも足りない場合も, 読み込み済みの末尾ミップより粗くはしない.
+    desc.BudgetBytes = 100;
+    streamer.Term();
+    REQUIRE(streamer.Init(&backend, desc));
+    id = streamer.Register(path.c_str(), false);
+    REQUIRE(id != TextureStreamer::InvalidId);
+    streamer.Request(id, 0, 1.0f);
+    streamer.Update();
+    CHECK(streamer.GetResidentMip(id) == 1);
+
+    for(auto mip : backend.FirstMips)
+    {
+        auto w = std::max(info.Width  >> mip, 1u);
+        auto h = std::max(info.Height >> mip, 1u);
+        CHECK(mip == 0 || ((w % 4) == 0 && (h % 4) == 0));
+    }
+
+    streamer.Term();
+    CHECK(backend.LiveCount    == 0);
+    CHECK(backend.InvalidCount == 0);
+}
+
+//-----------------------------------------------------------------------------
+//      予算が足りない場合は最も長く要求されていないテクスチャから手放すことを確認します.
+//-----------------------------------------------------------------------------
+TEST_CASE(TextureStreamer, EvictLeastRecent)
+{
+    auto path = GetTestTempPath(L"stream_lru.dds");
+    auto info = MakeInfo(DXGI_FORMAT_BC1_UNORM, 256, 256, 9);
+
+    std::vector<uint8_t> pixels;
+    REQUIRE(WriteTestDds(path, info, pixels));
+
+    // 末尾ミップ3つ分と, 全ミップ1枚分, さらにミップ1以降2枚分とミップ0の1枚分が収まる予算.
+    const uint64_t tail  = 696;
+    const uint64_t full  = 43704;
+    const uint64_t extra = (2048 + 8192) * 2 + 32768;
+
+    FakeStreamBackend backend;
+    TextureStreamDesc desc;
+    desc.TailBytes      = 1024;
+    desc.BudgetBytes    = tail * 3 + (full - tail) + extra;
+    desc.MaxUploadBytes = 1 << 20;
+
+    TextureStreamer streamer;
+    REQUIRE(streamer.Init(&backend, desc));
+
+    uint32_t ids[3];
+    for(auto& id : ids)
+    {
+        id = streamer.Register(path.c_str(), false);
+        REQUIRE(id != TextureStreamer::InvalidId);
+    }
+
+    // A, B の順に全ミップを要求する. 予算に収まるので両方残る.
+    uint64_t fence = 0;
+    for(auto i=0; i<2; ++i)
+    {
+        streamer.Request(ids[i], 0, 1.0f);
+        streamer.Update();
+        streamer.FrameEnd(++fence);
+        streamer.Retire(fence);
+    }
+    CHECK(streamer.GetResidentMip(ids[0]) == 0);
+    CHECK(streamer.GetResidentMip(ids[1]) == 0);
+    CHECK(streamer.GetResidentMip(ids[2]) == 3);
+
+    // C を要求すると, 最近要求された B を残して A を手放す.
+    streamer.Request(ids[2], 0, 1.0f);
+    streamer.Update();
+    CHECK(streamer.GetResidentMip(ids[2]) == 0);
+    CHECK(streamer.GetResidentMip(ids[1]) == 0);
+    CHECK(streamer.GetResidentMip(ids[0]) == 1);
+    CHECK(streamer.GetStats().EvictedCount  == 1);
+    CHECK(streamer.GetStats().ResidentBytes <= desc.BudgetBytes);
+    streamer.FrameEnd(++fence);
+    streamer.Retire(fence);
+
+    // 再び A を要求すると, 今度は最も古い B を手放す.
+    streamer.Request(ids[0], 0, 1.0f);
+    streamer.Update();
+    CHECK(streamer.GetResidentMip(ids[0]) == 0);
+    CHECK(streamer.GetResidentMip(ids[2]) == 0);
+    CHECK(streamer.GetResidentMip(ids[1]) == 1);
+    CHECK(streamer.GetStats().ResidentBytes <= desc.BudgetBytes);
+
+    // 登録を解除したテクスチャはフェンスの完了後に破棄され, 番号は再利用される.
+    streamer.Unregister(ids[1]);
+    streamer.FrameEnd(++fence);
+    streamer.Retire(fence);
+    CHECK(backend.LiveCount == 2);
+    CHECK(streamer.Register(path.c_str(), false) == ids[1]);
+
+    streamer.Term();
+    CHECK(backend.LiveCount    == 0);
+    CHECK(backend.InvalidCount == 0);
+}
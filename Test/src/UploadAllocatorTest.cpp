@@ -0,0 +1,356 @@
+﻿//-----------------------------------------------------------------------------
+// File : UploadAllocatorTest.cpp
+// Desc : UploadAllocator Unit Test.
+// Copyright(c) Pocol. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <TestUtil.h>
+#include <UploadAllocator.h>
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <random>
+
+
+namespace {
+
+///////////////////////////////////////////////////////////////////////////////
+// FakePageBackend class
+///////////////////////////////////////////////////////////////////////////////
+//! @brief      GPU を使わずにシステムメモリをページとして払い出すバックエンドです.
+class FakePageBackend : public UploadPageBackend
+{
+public:
+    static constexpr D3D12_GPU_VIRTUAL_ADDRESS PageStride = 1ull << 32;    //!< ページごとの仮想アドレスの間隔です.
+
+    uint32_t    CreateCount  = 0;   //!< CreatePage() の呼び出し回数です.
+    uint32_t    DestroyCount = 0;   //!< DestroyPage() の呼び出し回数です.
+
+    bool CreatePage(uint64_t size, UploadPage& page) override
+    {
+        std::unique_ptr<uint8_t[]> memory(new uint8_t[size_t(size)]);
+
+        page.pResource  = reinterpret_cast<ID3D12Resource*>(memory.get());
+        page.pCpu       = memory.get();
+        page.GpuAddress = PageStride * (++CreateCount);
+        page.Size       = size;
+
+        m_Memory.push_back(std::move(memory));
+        return true;
+    }
+
+    void DestroyPage(UploadPage& page) override
+    {
+        for(auto itr = m_Memory.begin(); itr != m_Memory.end(); ++itr)
+        {
+            if (itr->get() == page.pCpu)
+            {
+                m_Memory.erase(itr);
+                break;
+            }
+        }
+
+        page = UploadPage();
+        DestroyCount++;
+    }
+
+    uint32_t GetLiveCount() const
+    { return uint32_t(m_Memory.size()); }
+
+private:
+    std::vector<std::unique_ptr<uint8_t[]>> m_Memory;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// LiveRange structure
+///////////////////////////////////////////////////////////////////////////////
+struct LiveRange
+{
+    D3D12_GPU_VIRTUAL_ADDRESS   Begin;      //!< 先頭アドレスです.
+    D3D12_GPU_VIRTUAL_ADDRESS   End;        //!< 終端アドレスです.
+    uint64_t                    Fence;      //!< 解放したフレームのフェンス値です (0 は未解放).
+};
+
+//-----------------------------------------------------------------------------
+//      割り当てが使用中の領域と重なっていないか確認します.
+//-----------------------------------------------------------------------------
+bool IsDisjoint(const std::deque<LiveRange>& live, const UploadAllocation& allocation)
+{
+    auto begin = allocation.GpuAddress;
+    auto end   = allocation.GpuAddress + allocation.Size;
+    for(auto& range : live)
+    {
+        if (begin < range.End && range.Begin < end)
+        { return false; }
+    }
+    return true;
+}
+
+} // namespace
+
+
+//-----------------------------------------------------------------------------
+//      1ページ内に先頭から詰めて割り当てられるか確認します.
+//-----------------------------------------------------------------------------
+TEST_CASE(UploadAllocator, SubAllocation)
+{
+    FakePageBackend backend;
+    UploadAllocator allocator;
+    REQUIRE(allocator.Init(&backend, 64 * 1024));
+
+    UploadAllocation a = {}, b = {}, c = {};
+    REQUIRE(allocator.Allocate(100, 256, a));
+    REQUIRE(allocator.Allocate(100, 256, b));
+    REQUIRE(allocator.Allocate(300, 256, c));
+
+    CHECK(backend.CreateCount == 1);
+    CHECK(allocator.GetPageCount() == 1);
+    CHECK(a.PageIndex == b.PageIndex && b.PageIndex == c.PageIndex);
+    CHECK(a.Offset == 0);
+    CHECK(b.Offset == 256);
+    CHECK(c.Offset == 512);
+    CHECK(c.Size   == 300);
+    CHECK(b.pCpu - a.pCpu == 256);
+    CHECK(c.GpuAddress - a.GpuAddress == 512);
+    CHECK(a.pResource == b.pResource);
+
+    // 書き込んでも隣の割り当てを壊さない.
+    memset(a.pCpu, 0xAA, size_t(a.Size));
+    memset(b.pCpu, 0xBB, size_t(b.Size));
+    CHECK(a.pCpu[a.Size - 1] == 0xAA);
+    CHECK(b.pCpu[0] == 0xBB);
+
+    // ページに収まらなくなったら次のページへ移る.
+    UploadAllocation d = {};
+    REQUIRE(allocator.Allocate(64 * 1024 - 512, 256, d));
+    CHECK(d.PageIndex != a.PageIndex);
+    CHECK(d.Offset == 0);
+    CHECK(allocator.GetPageCount() == 2);
+
+    allocator.Term();
+    CHECK(backend.GetLiveCount() == 0);
+}
+
+//-----------------------------------------------------------------------------
+//      オフセットと GPU アドレスがアライメントを満たすか確認します.
+//-----------------------------------------------------------------------------
+TEST_CASE(UploadAllocator, Alignment)
+{
+    FakePageBackend backend;
+    UploadAllocator allocator;
+    REQUIRE(allocator.Init(&backend, 1000));
+
+    // ページサイズは CBV の配置アライメントに切り上げられる.
+    CHECK(allocator.GetPageSize() == 1024);
+
+    const uint64_t alignments[] = { 1, 4, 16, 256, 512, 0 };
+    const uint64_t sizes     [] = { 1, 3, 17, 255, 5, 7 };
+
+    std::deque<LiveRange> live;
+    for(auto i=0; i<12; ++i)
+    {
+        auto alignment = alignments[i % 6];
+        auto size      = sizes     [i % 6];
+
+        UploadAllocation allocation = {};
+        REQUIRE(allocator.Allocate(size, alignment, allocation));
+
+        auto expected = (alignment == 0) ? 1 : alignment;
+        CHECK(allocation.Offset     % expected == 0);
+        CHECK(allocation.GpuAddress % expected == 0);
+        CHECK(allocation.Offset + allocation.Size <= allocator.GetPageSize());
+        CHECK(IsDisjoint(live, allocation));
+
+        live.push_back({ allocation.GpuAddress, allocation.GpuAddress + allocation.Size, 0 });
+    }
+
+    // ページサイズを超える割り当ては専用ページになり, 回収時に破棄される.
+    UploadAllocation large = {};
+    REQUIRE(allocator.Allocate(5000, 256, large));
+    CHECK(large.Offset == 0);
+    CHECK(large.Size   == 5000);
+
+    auto destroyed = backend.DestroyCount;
+    allocator.Free(large);
+    allocator.FrameEnd(1);
+    allocator.Retire(1);
+    CHECK(backend.DestroyCount == destroyed + 1);
+}
+
+//-----------------------------------------------------------------------------
+//      フェンスが完了するまで解放した領域が再利用されないことを確認します.
+//-----------------------------------------------------------------------------
+TEST_CASE(UploadAllocator, FenceRetirement)
+{
+    FakePageBackend backend;
+    UploadAllocator allocator;
+    REQUIRE(allocator.Init(&backend, 1024));
+
+    // 1ページを使い切る.
+    UploadAllocation a = {}, b = {};
+    REQUIRE(allocator.Allocate(512, 256, a));
+    REQUIRE(allocator.Allocate(512, 256, b));
+    auto firstPage = a.PageIndex;
+
+    allocator.Free(a);
+    allocator.Free(b);
+
+    // FrameEnd() 前は回収されない.
+    allocator.Retire(100);
+    UploadAllocation c = {};
+    REQUIRE(allocator.Allocate(256, 256, c));
+    CHECK(c.PageIndex != firstPage);
+
+    // フェンス値 5 のフレームとして登録し, 完了前は回収されない.
+    allocator.FrameEnd(5);
+    allocator.Retire(4);
+
+    UploadAllocation d = {};
+    REQUIRE(allocator.Allocate(1024, 256, d));
+    CHECK(d.PageIndex != firstPage);
+
+    // 完了後は空きページとして再利用される.
+    allocator.Retire(5);
+    UploadAllocation e = {};
+    REQUIRE(allocator.Allocate(1024, 256, e));
+    CHECK(e.PageIndex == firstPage);
+    CHECK(e.Offset    == 0);
+    CHECK(backend.CreateCount == 3);
+}
+
+//-----------------------------------------------------------------------------
+//      一時領域をフレームごとに確保しても, ページが使い回されることを確認します.
+//-----------------------------------------------------------------------------
+TEST_CASE(UploadAllocator, TransientRing)
+{
+    const uint64_t kFramesInFlight = 2;
+
+    FakePageBackend backend;
+    UploadAllocator allocator;
+    REQUIRE(allocator.Init(&backend, 4096));
+
+    std::deque<LiveRange> live;
+    for(uint64_t frame=1; frame<=200; ++frame)
+    {
+        // GPU が kFramesInFlight フレーム遅れて完了する想定.
+        auto completed = (frame > kFramesInFlight) ? frame - kFramesInFlight : 0;
+        allocator.Retire(completed);
+        while(!live.empty() && live.front().Fence <= completed)
+        { live.pop_front(); }
+
+        for(auto i=0; i<12; ++i)
+        {
+            UploadAllocation allocation = {};
+            REQUIRE(allocator.AllocateTransient(512, 256, allocation));
+            CHECK(IsDisjoint(live, allocation));
+            live.push_back({ allocation.GpuAddress, allocation.GpuAddress + allocation.Size, frame });
+        }
+
+        allocator.FrameEnd(frame);
+    }
+
+    // 1フレームあたり 6KB なので, 処理中の 3 フレーム分 + 割り当て中の 1 ページ程度に収まる.
+    CHECK(allocator.GetPageCount() <= 6);
+    CHECK(backend.CreateCount - backend.DestroyCount == allocator.GetPageCount());
+}
+
+//-----------------------------------------------------------------------------
+//      ランダムな確保・解放で, 回収前の領域が払い出されないことを確認します.
+//-----------------------------------------------------------------------------
+TEST_CASE(UploadAllocator, RandomizedRetirement)
+{
+    FakePageBackend backend;
+    UploadAllocator allocator;
+    REQUIRE(allocator.Init(&backend, 8192));
+
+    std::mt19937 rng(12345);
+
+    std::vector<UploadAllocation>   held;
+    std::deque<LiveRange>           pending;    // 解放済みで回収待ちの領域です.
+    std::deque<LiveRange>           owned;      // Free() していない領域です.
+
+    auto checkDisjoint = [&](const UploadAllocation& allocation)
+    { return IsDisjoint(pending, allocation) && IsDisjoint(owned, allocation); };
+
+    uint64_t completed = 0;
+    for(uint64_t frame=1; frame<=500; ++frame)
+    {
+        auto count = rng() % 8;
+        for(auto i=0u; i<count; ++i)
+        {
+            auto size      = 1 + rng() % 3000;
+            auto alignment = 1ull << (rng() % 10);
+
+            UploadAllocation allocation = {};
+            if (rng() % 2)
+            {
+                REQUIRE(allocator.AllocateTransient(size, alignment, allocation));
+                CHECK(checkDisjoint(allocation));
+                pending.push_back({ allocation.GpuAddress, allocation.GpuAddress + allocation.Size, frame });
+            }
+            else
+            {
+                REQUIRE(allocator.Allocate(size, alignment, allocation));
+                CHECK(checkDisjoint(allocation));
+                held .push_back(allocation);
+                owned.push_back({ allocation.GpuAddress, allocation.GpuAddress + allocation.Size, 0 });
+            }
+            CHECK(allocation.GpuAddress % alignment == 0);
+        }
+
+        // 保持している割り当ての一部を解放する.
+        for(size_t i=0; i<held.size(); )
+        {
+            if (rng() % 4 != 0)
+            {
+                ++i;
+                continue;
+            }
+
+            allocator.Free(held[i]);
+            for(auto itr = owned.begin(); itr != owned.end(); ++itr)
+            {
+                if (itr->Begin == held[i].GpuAddress)
+                {
+                    pending.push_back({ itr->Begin, itr->End, frame });
+                    owned.erase(itr);
+                    break;
+                }
+            }
+
+            held[i] = held.back();
+            held.pop_back();
+        }
+
+        allocator.FrameEnd(frame);
+
+        // 完了は 0〜3 フレーム遅れでランダムに進める.
+        auto target = (frame > 3) ? frame - rng() % 4 : 0;
+        completed = std::max(completed, target);
+        allocator.Retire(completed);
+
+        for(auto itr = pending.begin(); itr != pending.end(); )
+        {
+            if (itr->Fence <= completed)
+            { itr = pending.erase(itr); }
+            else
+            { ++itr; }
+        }
+    }
+
+    // 全て解放して完了させればページは空きリストの上限まで縮む.
+    for(auto& allocation : held)
+    { allocator.Free(allocation); }
+    allocator.FrameEnd(1000);
+    allocator.Retire(1000);
+
+    CHECK(allocator.GetPageCount() <= UploadAllocator::MaxFreePages + 1);
+    CHECK(backend.CreateCount - backend.DestroyCount == allocator.GetPageCount());
+
+    allocator.Term();
+    CHECK(backend.GetLiveCount() == 0);
+}
@@ -0,0 +1,116 @@
+﻿//-----------------------------------------------------------------------------
+// File : main.cpp
+// Desc : Unit Test Main Entry Point.
+// Copyright(c) Pocol. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <TestUtil.h>
+#include <cstring>
+#include <vector>
+
+
+namespace {
+
+///////////////////////////////////////////////////////////////////////////////
+// TestEntry structure
+///////////////////////////////////////////////////////////////////////////////
+struct TestEntry
+{
+    const char*     Suite;      //!< スイート名です.
+    const char*     Name;       //!< テスト名です.
+    void            (*Func)();  //!< テスト関数です.
+};
+
+//-----------------------------------------------------------------------------
+//      登録済みテストケースを取得します.
+//-----------------------------------------------------------------------------
+std::vector<TestEntry>& GetEntries()
+{
+    static std::vector<TestEntry> s_Entries;
+    return s_Entries;
+}
+
+uint32_t g_FailureCount = 0;    //!< 実行中のテストの失敗数です.
+
+} // namespace
+
+
+//-----------------------------------------------------------------------------
+//      テストケースを登録します.
+//-----------------------------------------------------------------------------
+TestRegistrar::TestRegistrar(const char* suite, const char* name, void (*func)())
+{ GetEntries().push_back({suite, name, func}); }
+
+//-----------------------------------------------------------------------------
+//      検証失敗を報告します.
+//-----------------------------------------------------------------------------
+void ReportFailure(const char* file, int line, const char* expr)
+{
+    printf_s("    %s(%d) : CHECK( %s ) failed.\n", file, line, expr);
+    g_FailureCount++;
+}
+
+//-----------------------------------------------------------------------------
+//      サンプルのリソースファイルパスを取得します.
+//-----------------------------------------------------------------------------
+std::wstring GetTestResourcePath(const wchar_t* relativePath)
+{
+    std::wstring result = TEST_WIDEN(TEST_RES_DIR);
+    result += relativePath;
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+//      テスト用の一時ファイルパスを取得します.
+//-----------------------------------------------------------------------------
+std::wstring GetTestTempPath(const wchar_t* fileName)
+{
+    std::wstring result = TEST_WIDEN(TEST_TEMP_DIR);
+    result += fileName;
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+//      メインエントリーポイントです.
+//-----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+    // 引数でスイート名が指定された場合はそのスイートのみ実行する.
+    const char* filter = (argc > 1) ? argv[1] : nullptr;
+
+    auto testCount = 0u;
+    auto failCount = 0u;
+
+    for(auto& entry : GetEntries())
+    {
+        if (filter != nullptr && strcmp(filter, entry.Suite) != 0)
+        { continue; }
+
+        printf_s("[ RUN    ] %s.%s\n", entry.Suite, entry.Name);
+
+        g_FailureCount = 0;
+        TestTimer timer;
+        entry.Func();
+
+        auto elapsed = timer.GetElapsedMsec();
+        printf_s("[ %s ] %s.%s (%.1f ms)\n",
+            (g_FailureCount == 0) ? "    OK" : "FAILED",
+            entry.Suite, entry.Name, elapsed);
+
+        testCount++;
+        if (g_FailureCount != 0)
+        { failCount++; }
+    }
+
+    if (testCount == 0)
+    {
+        printf_s("No test case matched. filter = %s\n", (filter != nullptr) ? filter : "(none)");
+        return 1;
+    }
+
+    printf_s("%u / %u passed.\n", testCount - failCount, testCount);
+    return (failCount == 0) ? 0 : 1;
+}